@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The Qitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+'''
+Replay stored block files through ProcessNewBlock on a fresh datadir and report
+the time spent in the stages of connecting the blocks as JSON.
+
+The blocks are loaded with -loadblock, the stage timings are the ones logged with
+-debug=bench and are read with the getblockconnecttimings RPC once the node stopped
+connecting blocks.
+'''
+
+import argparse
+import base64
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+from http.client import HTTPConnection
+
+RPC_USER = 'replay'
+RPC_PASSWORD = 'replay'
+
+
+class RPC:
+    def __init__(self, port):
+        self.port = port
+        self.authhdr = b'Basic ' + base64.b64encode(('%s:%s' % (RPC_USER, RPC_PASSWORD)).encode('utf-8'))
+
+    def call(self, method, *params):
+        conn = HTTPConnection('127.0.0.1', port=self.port, timeout=600)
+        try:
+            conn.request('POST', '/', json.dumps({'version': '1.1', 'method': method, 'params': list(params), 'id': 0}),
+                         {'Authorization': self.authhdr, 'Content-type': 'application/json'})
+            resp = json.loads(conn.getresponse().read().decode('utf-8'))
+        finally:
+            conn.close()
+        if resp.get('error') is not None:
+            raise RuntimeError('%s: %s' % (method, resp['error']))
+        return resp['result']
+
+
+def wait_for_rpc(rpc, process, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if process.poll() is not None:
+            raise RuntimeError('node exited with code %d during startup' % process.returncode)
+        try:
+            return rpc.call('getblockcount')
+        except (OSError, RuntimeError):
+            time.sleep(0.5)
+    raise RuntimeError('node did not start within %d seconds' % timeout)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('blocksdir', help='directory with the blk*.dat files to replay')
+    parser.add_argument('--daemon', default=os.path.join('src', 'qitcoind'), help='node binary (default: %(default)s)')
+    parser.add_argument('--files', type=int, default=0, help='replay only the first N block files (default: all)')
+    parser.add_argument('--height', type=int, default=0, help='stop measuring once the tip reached this height (default: all blocks)')
+    parser.add_argument('--idle', type=int, default=30, help='seconds without a new tip after which the replay is complete (default: %(default)s)')
+    parser.add_argument('--datadir', help='fresh datadir to replay into (default: a temporary directory, removed afterwards)')
+    parser.add_argument('--rpcport', type=int, default=18990, help='RPC port of the node (default: %(default)s)')
+    parser.add_argument('--output', help='write the JSON report to this file (default: stdout)')
+    parser.add_argument('nodeargs', nargs='*', help='further arguments for the node, separated by --, e.g. -- -dbcache=4000 -omni')
+    args = parser.parse_args()
+
+    files = sorted(glob.glob(os.path.join(args.blocksdir, 'blk[0-9]*.dat')))
+    if args.files > 0:
+        files = files[:args.files]
+    if not files:
+        print('No block files found in %s' % args.blocksdir, file=sys.stderr)
+        return 1
+
+    datadir = args.datadir or tempfile.mkdtemp(prefix='replay_')
+    os.makedirs(datadir, exist_ok=True)
+    if os.listdir(datadir):
+        print('Datadir %s is not empty' % datadir, file=sys.stderr)
+        return 1
+
+    cmd = [args.daemon, '-datadir=' + datadir, '-server', '-listen=0', '-connect=0', '-dnsseed=0',
+           '-rpcport=%d' % args.rpcport, '-rpcuser=' + RPC_USER, '-rpcpassword=' + RPC_PASSWORD]
+    cmd += ['-loadblock=' + os.path.abspath(f) for f in files]
+    cmd += args.nodeargs
+    process = subprocess.Popen(cmd, stdout=subprocess.DEVNULL)
+    rpc = RPC(args.rpcport)
+    try:
+        wait_for_rpc(rpc, process, 300)
+        start = time.time()
+        height = -1
+        last_change = time.time()
+        while True:
+            current = rpc.call('getblockcount')
+            if current != height:
+                height = current
+                last_change = time.time()
+            if args.height > 0 and height >= args.height:
+                break
+            if time.time() - last_change > args.idle:
+                break
+            time.sleep(1)
+        elapsed = last_change - start
+
+        report = {
+            'files': len(files),
+            'height': height,
+            'elapsed': round(elapsed, 3),
+            'timings_us': rpc.call('getblockconnecttimings'),
+        }
+        rpc.call('stop')
+        process.wait(timeout=600)
+    finally:
+        if process.poll() is None:
+            process.kill()
+        if not args.datadir:
+            shutil.rmtree(datadir, ignore_errors=True)
+
+    output = json.dumps(report, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w', encoding='utf8') as f:
+            f.write(output + '\n')
+    else:
+        print(output)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -138,7 +138,10 @@ CAddrDB::CAddrDB()
 
 bool CAddrDB::Write(const CAddrMan& addr)
 {
-    return SerializeFileDB("peers", pathAddr, addr);
+    // Serialize the tables once, so that the file and its checksum cover the same state
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+    ssPeers << addr;
+    return SerializeFileDB("peers", pathAddr, ssPeers);
 }
 
 bool CAddrDB::Read(CAddrMan& addr)
@@ -84,6 +84,7 @@ CAddrInfo* CAddrMan::Create(const CAddress& addr, const CNetAddr& addrSource, in
     mapAddr[addr] = nId;
     mapInfo[nId].nRandomPos = vRandom.size();
     vRandom.push_back(nId);
+    nAddrCount = vRandom.size();
     if (pnId)
         *pnId = nId;
     return &mapInfo[nId];
@@ -118,6 +119,7 @@ void CAddrMan::Delete(int nId)
 
     SwapRandom(info.nRandomPos, vRandom.size() - 1);
     vRandom.pop_back();
+    nAddrCount = vRandom.size();
     mapAddr.erase(info);
     mapInfo.erase(nId);
     nNew--;
@@ -13,9 +13,11 @@
 #include <timedata.h>
 #include <util/system.h>
 
+#include <atomic>
 #include <map>
 #include <set>
 #include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -209,6 +211,12 @@ private:
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discipline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! number of changes to the tables, to skip writing unchanged tables to disk (memory only)
+    uint64_t nModifications GUARDED_BY(cs);
+
+    //! number of entries in vRandom, read without taking the lock
+    std::atomic<size_t> nAddrCount{0};
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -296,53 +304,68 @@ public:
      *
      * We don't use ADD_SERIALIZE_METHODS since the serialization and deserialization code has
      * very little in common.
+     *
+     * The tables are copied under the lock and written without it, so that writing peers.dat to
+     * a slow disk does not stall the connection threads and the addr message processing.
      */
     template<typename Stream>
     void Serialize(Stream &s) const
     {
-        LOCK(cs);
+        uint256 nKeyCopy;
+        std::vector<CAddrInfo> vNewInfo;
+        std::vector<CAddrInfo> vTriedInfo;
+        std::vector<int> vNewIndex(ADDRMAN_NEW_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE, -1);
+        {
+            LOCK(cs);
+            nKeyCopy = nKey;
+            vNewInfo.reserve(nNew);
+            vTriedInfo.reserve(nTried);
+            std::unordered_map<int, int> mapUnkIds;
+            mapUnkIds.reserve(nNew);
+            for (const auto& entry : mapInfo) {
+                const CAddrInfo &info = entry.second;
+                if (info.nRefCount) {
+                    assert(vNewInfo.size() != (size_t)nNew); // this means nNew was wrong, oh ow
+                    mapUnkIds[entry.first] = vNewInfo.size();
+                    vNewInfo.push_back(info);
+                }
+                if (info.fInTried) {
+                    assert(vTriedInfo.size() != (size_t)nTried); // this means nTried was wrong, oh ow
+                    vTriedInfo.push_back(info);
+                }
+            }
+            for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+                for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+                    if (vvNew[bucket][i] != -1)
+                        vNewIndex[bucket * ADDRMAN_BUCKET_SIZE + i] = mapUnkIds[vvNew[bucket][i]];
+                }
+            }
+        }
 
         unsigned char nVersion = 1;
         s << nVersion;
         s << ((unsigned char)32);
-        s << nKey;
-        s << nNew;
-        s << nTried;
+        s << nKeyCopy;
+        s << (int)vNewInfo.size();
+        s << (int)vTriedInfo.size();
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
-        int nIds = 0;
-        for (const auto& entry : mapInfo) {
-            mapUnkIds[entry.first] = nIds;
-            const CAddrInfo &info = entry.second;
-            if (info.nRefCount) {
-                assert(nIds != nNew); // this means nNew was wrong, oh ow
-                s << info;
-                nIds++;
-            }
-        }
-        nIds = 0;
-        for (const auto& entry : mapInfo) {
-            const CAddrInfo &info = entry.second;
-            if (info.fInTried) {
-                assert(nIds != nTried); // this means nTried was wrong, oh ow
-                s << info;
-                nIds++;
-            }
-        }
+        for (const CAddrInfo& info : vNewInfo)
+            s << info;
+        for (const CAddrInfo& info : vTriedInfo)
+            s << info;
         for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
+            const int* pIndex = &vNewIndex[bucket * ADDRMAN_BUCKET_SIZE];
             int nSize = 0;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1)
+                if (pIndex[i] != -1)
                     nSize++;
             }
             s << nSize;
             for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
-                if (vvNew[bucket][i] != -1) {
-                    int nIndex = mapUnkIds[vvNew[bucket][i]];
-                    s << nIndex;
-                }
+                if (pIndex[i] != -1)
+                    s << pIndex[i];
             }
         }
     }
@@ -449,6 +472,7 @@ public:
         if (nLost + nLostUnk > 0) {
             LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions\n", nLostUnk, nLost);
         }
+        nAddrCount = vRandom.size();
 
         Check();
     }
@@ -475,9 +499,11 @@ public:
         nLastGood = 1; //Initially at 1 so that "never" is strictly worse.
         mapInfo.clear();
         mapAddr.clear();
+        nModifications++;
+        nAddrCount = 0;
     }
 
-    CAddrMan()
+    CAddrMan() : nModifications(0)
     {
         Clear();
     }
@@ -490,8 +516,14 @@ public:
     //! Return the number of (unique) addresses in all tables.
     size_t size() const
     {
-        LOCK(cs); // TODO: Cache this in an atomic to avoid this overhead
-        return vRandom.size();
+        return nAddrCount;
+    }
+
+    //! Number of changes to the tables so far, unchanged tables need not be written to disk again.
+    uint64_t GetModifications() const
+    {
+        LOCK(cs);
+        return nModifications;
     }
 
     //! Consistency check
@@ -514,6 +546,7 @@ public:
         bool fRet = false;
         Check();
         fRet |= Add_(addr, source, nTimePenalty);
+        nModifications++;
         Check();
         if (fRet) {
             LogPrint(BCLog::ADDRMAN, "Added %s from %s: %i tried, %i new\n", addr.ToStringIPPort(), source.ToString(), nTried, nNew);
@@ -529,6 +562,7 @@ public:
         Check();
         for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
             nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
+        nModifications++;
         Check();
         if (nAdd) {
             LogPrint(BCLog::ADDRMAN, "Added %i addresses from %s: %i tried, %i new\n", nAdd, source.ToString(), nTried, nNew);
@@ -542,6 +576,7 @@ public:
         LOCK(cs);
         Check();
         Good_(addr, test_before_evict, nTime);
+        nModifications++;
         Check();
     }
 
@@ -551,6 +586,7 @@ public:
         LOCK(cs);
         Check();
         Attempt_(addr, fCountFailure, nTime);
+        nModifications++;
         Check();
     }
 
@@ -559,6 +595,7 @@ public:
     {
         LOCK(cs);
         Check();
+        nModifications += !m_tried_collisions.empty();
         ResolveCollisions_();
         Check();
     }
@@ -610,6 +647,7 @@ public:
         LOCK(cs);
         Check();
         Connected_(addr, nTime);
+        nModifications++;
         Check();
     }
 
@@ -618,6 +656,7 @@ public:
         LOCK(cs);
         Check();
         SetServices_(addr, nServices);
+        nModifications++;
         Check();
     }
 
@@ -0,0 +1,198 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <key.h>
+#include <random.h>
+#include <script/standard.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <vector>
+
+/* Number of staking pools receiving the point and staking coins */
+static const size_t POOL_COUNT = 100;
+
+/* Number of bind entries of the bound plotter */
+static const size_t BIND_ENTRY_COUNT = 100;
+
+/* Number of modified coins of the overlay cache */
+static const size_t OVERLAY_COIN_COUNT = 10 * 1000;
+
+static CAccountID RandomAccountID()
+{
+    CAccountID accountID;
+    GetRandBytes(accountID.begin(), CAccountID::WIDTH);
+    return accountID;
+}
+
+/**
+ * An in-memory coins database of synthetic accounts. Every account owns plain, point and
+ * staking coins in turn, the point and staking coins are debited to the pools.
+ */
+class AccountIndexDB
+{
+public:
+    CCoinsViewDB db;
+    std::vector<CAccountID> accounts;
+    std::vector<CAccountID> pools;
+    uint64_t plotterId;
+
+    AccountIndexDB(size_t nAccounts, size_t nCoinsPerAccount) : db("coins_account_index", 8 << 20, true, true), plotterId(0)
+    {
+        for (size_t i = 0; i < POOL_COUNT; i++)
+            pools.push_back(RandomAccountID());
+
+        CCoinsMap map;
+        for (size_t i = 0; i < nAccounts; i++) {
+            accounts.push_back(RandomAccountID());
+            for (size_t j = 0; j < nCoinsPerAccount; j++)
+                AddCoin(map, accounts.back(), j);
+        }
+
+        // The bind history of one plotter
+        CKey key;
+        key.MakeNewKey(true);
+        CTxDestination dest;
+        ExtractDestination(GetScriptForPubKey(key.GetPubKey()), dest);
+        const bls::PrivateKey farmerKey = bls::AugSchemeMPL().KeyGen(std::vector<uint8_t>(32, 0x5a));
+        for (size_t i = 0; i < BIND_ENTRY_COUNT; i++) {
+            const int nHeight = 1000 + i;
+            CCoinsCacheEntry entry;
+            entry.coin = Coin(CTxOut(PROTOCOL_BINDPLOTTER_LOCKAMOUNT, GetScriptForDestination(dest),
+                SignBindPlotterScript(GetBindPlotterScriptForDestination(dest, farmerKey, nHeight), key)), nHeight, false);
+            assert(entry.coin.IsBindPlotter());
+            plotterId = BindPlotterPayload::As(entry.coin.GetPayload())->GetId();
+            entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+            map.emplace(COutPoint(GetRandHash(), 0), std::move(entry));
+        }
+
+        bool fWritten = db.BatchWrite(map, GetRandHash());
+        assert(fWritten);
+    }
+
+    //! The n-th coin of an account: a plain, a point or a staking coin
+    Coin MakeCoin(const CAccountID& accountID, size_t n) const
+    {
+        const CAccountID& poolID = pools[n % pools.size()];
+        switch (n % 3) {
+        case 1:
+            return Coin(CTxOut(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(accountID),
+                GetPointScriptForDestination(ExtractDestination(poolID), PROTOCOL_POINT_LOCK_BLOCKS_FULL_AMOUNT)), 100, false);
+        case 2:
+            return Coin(CTxOut(PROTOCOL_STAKING_AMOUNT_MIN, GetScriptForAccountID(accountID),
+                GetStakingScriptForDestination(ExtractDestination(poolID), PROTOCOL_STAKING_LOCK_BLOCKS_FULL_AMOUNT)), 100, false);
+        default:
+            return Coin(CTxOut(COIN, GetScriptForAccountID(accountID)), 100, false);
+        }
+    }
+
+    void AddCoin(CCoinsMap& map, const CAccountID& accountID, size_t n) const
+    {
+        CCoinsCacheEntry entry;
+        entry.coin = MakeCoin(accountID, n);
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        map.emplace(COutPoint(GetRandHash(), 0), std::move(entry));
+    }
+
+    //! Fill a cache on top of the database with new coins of the accounts
+    void FillOverlay(CCoinsViewCache& cache, size_t nCoins) const
+    {
+        for (size_t i = 0; i < nCoins; i++)
+            cache.AddCoin(COutPoint(GetRandHash(), 0), MakeCoin(accounts[i % accounts.size()], i), false);
+    }
+};
+
+static void CoinsDBGetAccountBalance(benchmark::State& state, size_t nAccounts, size_t nOverlayCoins)
+{
+    LOCK(cs_main);
+    AccountIndexDB fixture(nAccounts, 10);
+    CCoinsViewCache cache(&fixture.db);
+    fixture.FillOverlay(cache, nOverlayCoins);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        CAmount balanceBindPlotter = 0, balancePoint[2] = {0, 0}, balanceStaking[2] = {0, 0};
+        cache.GetAccountBalance(fixture.accounts[i++ % fixture.accounts.size()], &balanceBindPlotter, balancePoint, balanceStaking);
+    }
+}
+
+static void CoinsDBGetAccountBalance_1k(benchmark::State& state)
+{
+    CoinsDBGetAccountBalance(state, 1000, 0);
+}
+
+static void CoinsDBGetAccountBalance_10k(benchmark::State& state)
+{
+    CoinsDBGetAccountBalance(state, 10 * 1000, 0);
+}
+
+static void CoinsDBGetAccountBalanceOverlay_1k(benchmark::State& state)
+{
+    CoinsDBGetAccountBalance(state, 1000, OVERLAY_COIN_COUNT);
+}
+
+static void CoinsDBGetTopStakingAccounts(benchmark::State& state, size_t nAccounts, size_t nOverlayCoins)
+{
+    LOCK(cs_main);
+    AccountIndexDB fixture(nAccounts, 10);
+    CCoinsViewCache cache(&fixture.db);
+    fixture.FillOverlay(cache, nOverlayCoins);
+    while (state.KeepRunning()) {
+        cache.GetTopStakingAccounts(PROTOCOL_SATURN_STAKING_NODES_MAX);
+    }
+}
+
+static void CoinsDBGetTopStakingAccounts_1k(benchmark::State& state)
+{
+    CoinsDBGetTopStakingAccounts(state, 1000, 0);
+}
+
+static void CoinsDBGetTopStakingAccountsOverlay_1k(benchmark::State& state)
+{
+    CoinsDBGetTopStakingAccounts(state, 1000, OVERLAY_COIN_COUNT);
+}
+
+static void CoinsDBGetBindPlotterEntries(benchmark::State& state)
+{
+    LOCK(cs_main);
+    const AccountIndexDB fixture(1000, 10);
+    while (state.KeepRunning()) {
+        CBindPlotterCoinsMap entries = fixture.db.GetBindPlotterEntries(fixture.plotterId);
+        assert(entries.size() == BIND_ENTRY_COUNT);
+    }
+}
+
+static void CoinsDBBatchWrite(benchmark::State& state, size_t nBatchCoins)
+{
+    LOCK(cs_main);
+    AccountIndexDB fixture(1000, 10);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        // New coins of the accounts, the batch is consumed by the write
+        CCoinsMap map;
+        for (size_t n = 0; n < nBatchCoins; n++, i++)
+            fixture.AddCoin(map, fixture.accounts[i % fixture.accounts.size()], i);
+        fixture.db.BatchWrite(map, GetRandHash());
+    }
+}
+
+static void CoinsDBBatchWrite_100(benchmark::State& state)
+{
+    CoinsDBBatchWrite(state, 100);
+}
+
+static void CoinsDBBatchWrite_10k(benchmark::State& state)
+{
+    CoinsDBBatchWrite(state, 10 * 1000);
+}
+
+BENCHMARK(CoinsDBGetAccountBalance_1k, 100 * 1000);
+BENCHMARK(CoinsDBGetAccountBalance_10k, 100 * 1000);
+BENCHMARK(CoinsDBGetAccountBalanceOverlay_1k, 100 * 1000);
+BENCHMARK(CoinsDBGetTopStakingAccounts_1k, 200);
+BENCHMARK(CoinsDBGetTopStakingAccountsOverlay_1k, 50);
+BENCHMARK(CoinsDBGetBindPlotterEntries, 20 * 1000);
+BENCHMARK(CoinsDBBatchWrite_100, 500);
+BENCHMARK(CoinsDBBatchWrite_10k, 5);
@@ -59,6 +59,19 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void SHA256DMulti_1024(benchmark::State& state)
+{
+    // Transaction sized messages
+    std::vector<uint8_t> in(250 * 1024, 0);
+    std::vector<const uint8_t*> ptrs(1024);
+    std::vector<size_t> lens(1024, 250);
+    for (size_t i = 0; i < ptrs.size(); i++) ptrs[i] = in.data() + 250 * i;
+    std::vector<uint8_t> out(32 * 1024);
+    while (state.KeepRunning()) {
+        SHA256DMulti(out.data(), ptrs.data(), lens.data(), 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -100,5 +113,6 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256DMulti_1024, 1800);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/policy.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    int64_t nTime = 0;
+    unsigned int nHeight = 1;
+    bool spendsCoinbase = false;
+    unsigned int sigOpCost = 4;
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, 1000LL, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
+}
+
+// A long unconfirmed chain, as Omni sends of one address build: every transaction walks
+// its ancestors when it enters, and removing the root walks all its descendants.
+static void MempoolLongChain(benchmark::State& state)
+{
+    const int CHAIN_LENGTH = 500;
+    std::vector<CTransactionRef> chain;
+    chain.reserve(CHAIN_LENGTH);
+    for (int i = 0; i < CHAIN_LENGTH; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        if (chain.empty()) {
+            tx.vin[0].scriptSig = CScript() << OP_1;
+        } else {
+            tx.vin[0].prevout = COutPoint(chain.back()->GetHash(), 0);
+        }
+        tx.vin[0].scriptWitness.stack.push_back({1});
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        chain.push_back(MakeTransactionRef(std::move(tx)));
+    }
+
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    while (state.KeepRunning()) {
+        for (const CTransactionRef& tx : chain) {
+            AddTx(tx, pool);
+        }
+        CTxMemPool::setEntries setAncestors;
+        uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        pool.CalculateMemPoolAncestors(*pool.mapTx.find(chain.back()->GetHash()), setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        assert(setAncestors.size() == chain.size() - 1);
+        pool.removeRecursive(*chain.front(), MemPoolRemovalReason::CONFLICT);
+        assert(pool.size() == 0);
+    }
+}
+
+BENCHMARK(MempoolLongChain, 10);
@@ -0,0 +1,215 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <coins.h>
+#include <key.h>
+#include <key_io.h>
+#include <omnicore/consensushash.h>
+#include <omnicore/createpayload.h>
+#include <omnicore/encoding.h>
+#include <omnicore/mdex.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/persistence.h>
+#include <omnicore/rules.h>
+#include <omnicore/script.h>
+#include <omnicore/sto.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/standard.h>
+#include <tinyformat.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mastercore;
+
+/* Property of the synthetic balances */
+static const uint32_t BENCH_PROPERTY = 3;
+
+/* Index of the balances in the persisted state files, see PersistInMemoryState() */
+static const int BALANCES_STATE_FILE = 0;
+
+/**
+ * Runs Omni Core on top of the bench chain, and clears the state built by the bench
+ * before shutting it down again.
+ */
+class OmniSetup
+{
+public:
+    OmniSetup()
+    {
+        LOCK(cs_main);
+        mastercore_init();
+    }
+
+    ~OmniSetup()
+    {
+        LOCK(cs_main);
+        clear_all_state();
+        mastercore_shutdown();
+    }
+};
+
+static PKHash RandomKeyHash()
+{
+    uint160 hash;
+    GetRandBytes(hash.begin(), hash.size());
+    return PKHash(hash);
+}
+
+//! Credit n new addresses with balances of the property, returns the addresses
+static std::vector<std::string> FillTallyMap(size_t n, uint32_t propertyId, int64_t nBalance = 1000 * 1000)
+{
+    std::vector<std::string> addresses;
+    addresses.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        addresses.push_back(EncodeDestination(RandomKeyHash()));
+        bool fCredited = update_tally_map(addresses.back(), propertyId, nBalance + i, BALANCE);
+        assert(fCredited);
+    }
+    return addresses;
+}
+
+//! A Class C transaction, which spends the prevout and sends one token to the receiver
+static CMutableTransaction CreateSimpleSendTx(const COutPoint& prevout, const CScript& scriptReceiver)
+{
+    std::vector<std::pair<CScript, int64_t>> vecOutputs;
+    bool fEncoded = OmniCore_Encode_ClassC(CreatePayload_SimpleSend(OMNI_PROPERTY_MSC, 1), vecOutputs);
+    assert(fEncoded);
+
+    CMutableTransaction tx;
+    tx.vin.emplace_back(prevout);
+    for (const auto& output : vecOutputs) {
+        tx.vout.emplace_back(output.second, output.first);
+    }
+    tx.vout.emplace_back(OmniGetDustThreshold(scriptReceiver), scriptReceiver);
+    return tx;
+}
+
+static void OmniHandlerTx(benchmark::State& state, bool fOmni)
+{
+    const OmniSetup omni;
+    LOCK(cs_main);
+    const CBlockIndex* pBlockIndex = ::ChainActive().Tip();
+    const int nBlock = ConsensusParams().GENESIS_BLOCK + 1;
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptSender = GetScriptForDestination(PKHash(key.GetPubKey()));
+    const CScript scriptReceiver = GetScriptForDestination(RandomKeyHash());
+    update_tally_map(EncodeDestination(PKHash(key.GetPubKey())), OMNI_PROPERTY_MSC, std::numeric_limits<int32_t>::max(), BALANCE);
+
+    // The spent coins are handed over as removed coins, instead of being looked up in the chain
+    std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = std::make_shared<std::map<COutPoint, Coin>>();
+    unsigned int idx = 0;
+    while (state.KeepRunning()) {
+        const COutPoint prevout(GetRandHash(), 0);
+        removedCoins->emplace(prevout, Coin(CTxOut(COIN, scriptSender), 1, false));
+
+        CMutableTransaction tx;
+        if (fOmni) {
+            tx = CreateSimpleSendTx(prevout, scriptReceiver);
+        } else {
+            tx.vin.emplace_back(prevout);
+            tx.vout.emplace_back(COIN / 2, scriptReceiver);
+        }
+        mastercore_handler_tx(CTransaction(tx), nBlock, idx++, pBlockIndex, removedCoins);
+    }
+}
+
+static void OmniHandlerTxPlain(benchmark::State& state)
+{
+    OmniHandlerTx(state, false);
+}
+
+static void OmniHandlerTxSimpleSend(benchmark::State& state)
+{
+    OmniHandlerTx(state, true);
+}
+
+static void OmniUpdateTallyMap_1M(benchmark::State& state)
+{
+    const OmniSetup omni;
+    LOCK(cs_tally);
+    const std::vector<std::string> addresses = FillTallyMap(1000 * 1000, BENCH_PROPERTY);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        // Credit and debit in turn, which keeps the balances and the holders index stable
+        const std::string& address = addresses[(i / 2) % addresses.size()];
+        update_tally_map(address, BENCH_PROPERTY, (i % 2) ? -1 : 1, BALANCE);
+        i++;
+    }
+}
+
+static void OmniMetaDExAdd(benchmark::State& state)
+{
+    const OmniSetup omni;
+    LOCK(cs_tally);
+    const int nBlock = ConsensusParams().GENESIS_BLOCK + 1;
+    const int64_t nAmount = 1000;
+    const size_t nDepth = 10 * 1000;
+
+    // A book of offers to sell the property, each one at a higher price than the one before
+    const std::vector<std::string> sellers = FillTallyMap(nDepth, BENCH_PROPERTY, std::numeric_limits<int32_t>::max());
+    for (size_t i = 0; i < nDepth; i++) {
+        MetaDEx_ADD(sellers[i], BENCH_PROPERTY, nAmount, nBlock, OMNI_PROPERTY_MSC, nAmount + i, GetRandHash(), 0);
+    }
+    const std::string buyer = FillTallyMap(1, OMNI_PROPERTY_MSC, std::numeric_limits<int64_t>::max() / 2).front();
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        // Take the best offer as a whole, and refill the book at its far end
+        MetaDEx_ADD(buyer, OMNI_PROPERTY_MSC, nAmount + i, nBlock, BENCH_PROPERTY, nAmount, GetRandHash(), 0);
+        MetaDEx_ADD(sellers[i % nDepth], BENCH_PROPERTY, nAmount, nBlock, OMNI_PROPERTY_MSC, nAmount + nDepth + i, GetRandHash(), 0);
+        i++;
+    }
+}
+
+static void OmniSTOGetReceivers(benchmark::State& state)
+{
+    const OmniSetup omni;
+    LOCK(cs_tally);
+    const std::vector<std::string> addresses = FillTallyMap(100 * 1000, BENCH_PROPERTY);
+    while (state.KeepRunning()) {
+        STO_GetReceivers(addresses.front(), BENCH_PROPERTY, 1000 * 1000);
+    }
+}
+
+static void OmniGetConsensusHash(benchmark::State& state)
+{
+    const OmniSetup omni;
+    LOCK(cs_tally);
+    FillTallyMap(100 * 1000, BENCH_PROPERTY);
+    while (state.KeepRunning()) {
+        GetConsensusHash();
+    }
+}
+
+static void OmniPersistRestoreState(benchmark::State& state)
+{
+    const OmniSetup omni;
+    LOCK2(cs_main, cs_tally);
+    FillTallyMap(100 * 1000, BENCH_PROPERTY);
+    const CBlockIndex* pBlockIndex = ::ChainActive().Tip();
+    const fs::path pathBalances = GetOmniDataDir() / "MP_persist" / strprintf("balances-%s.dat", pBlockIndex->GetBlockHash().ToString());
+    while (state.KeepRunning()) {
+        PersistInMemoryState(pBlockIndex);
+        RestoreInMemoryState(pathBalances.string(), BALANCES_STATE_FILE, true);
+    }
+}
+
+BENCHMARK(OmniHandlerTxPlain, 200 * 1000);
+BENCHMARK(OmniHandlerTxSimpleSend, 2000);
+BENCHMARK(OmniUpdateTallyMap_1M, 500 * 1000);
+BENCHMARK(OmniMetaDExAdd, 2000);
+BENCHMARK(OmniSTOGetReceivers, 20);
+BENCHMARK(OmniGetConsensusHash, 20);
+BENCHMARK(OmniPersistRestoreState, 5);
@@ -0,0 +1,229 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/curve25519.h>
+#include <crypto/shabal256.h>
+#include <poc/poc.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <validation.h>
+
+#include <vector>
+
+/* Number of bytes to hash per iteration */
+static const uint64_t BUFFER_SIZE = 1000*1000;
+
+/* Number of nonces of a batched deadline computation */
+static const size_t DEADLINE_BATCH_SIZE = 64;
+
+/* Number of plotter signatures of a batched verification */
+static const size_t VERIFY_BATCH_SIZE = 64;
+
+static CBlockIndex PoCPrevBlockIndex(const Consensus::Params& params)
+{
+    CBlockIndex prevBlockIndex;
+    prevBlockIndex.nHeight = 1000;
+    prevBlockIndex.nTime = params.nBeginMiningTime;
+    prevBlockIndex.nBaseTarget = poc::INITIAL_BASE_TARGET;
+    prevBlockIndex.SetNextGenerationSignature(GetRandHash());
+    return prevBlockIndex;
+}
+
+static void Shabal256(benchmark::State& state)
+{
+    uint8_t hash[CShabal256::OUTPUT_SIZE];
+    std::vector<uint8_t> in(BUFFER_SIZE,0);
+    while (state.KeepRunning())
+        CShabal256().Write(in.data(), in.size()).Finalize(hash);
+}
+
+static void Shabal256_64b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64,0);
+    while (state.KeepRunning()) {
+        CShabal256()
+            .Write(in.data(), in.size())
+            .Finalize(in.data());
+    }
+}
+
+static void Shabal256Lanes_64b(benchmark::State& state)
+{
+    const size_t nLanes = Shabal256MaxLanes();
+    std::vector<std::vector<uint8_t>> vBuffers(nLanes, std::vector<uint8_t>(64, 0));
+    std::vector<unsigned char*> vOut(nLanes);
+    std::vector<const unsigned char*> vIn(nLanes);
+    for (size_t i = 0; i < nLanes; i++) {
+        vOut[i] = vBuffers[i].data();
+        vIn[i] = vBuffers[i].data();
+    }
+    while (state.KeepRunning()) {
+        Shabal256Lanes(vOut.data(), vIn.data(), 64, nLanes);
+    }
+}
+
+static void PoCCalculateDeadline(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlockIndex prevBlockIndex = PoCPrevBlockIndex(chainParams->GetConsensus());
+    CBlockHeader block;
+    block.nPlotterId = GetRand(std::numeric_limits<uint64_t>::max());
+    while (state.KeepRunning()) {
+        block.nNonce++;
+        poc::CalculateDeadline(prevBlockIndex, block, chainParams->GetConsensus());
+    }
+}
+
+static void PoCCalculateDeadlines(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlockIndex prevBlockIndex = PoCPrevBlockIndex(chainParams->GetConsensus());
+    std::vector<CBlockHeader> blocks(DEADLINE_BATCH_SIZE);
+    for (CBlockHeader& block : blocks) {
+        block.nPlotterId = GetRand(std::numeric_limits<uint64_t>::max());
+    }
+    while (state.KeepRunning()) {
+        for (CBlockHeader& block : blocks) {
+            block.nNonce++;
+        }
+        poc::CalculateDeadlines(prevBlockIndex, blocks, chainParams->GetConsensus());
+    }
+}
+
+static void PoCCalculateBaseTarget(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // The base target averages the 80 previous blocks
+    std::vector<CBlockIndex> vIndexes(100);
+    for (size_t i = 0; i < vIndexes.size(); i++) {
+        vIndexes[i].pprev = i > 0 ? &vIndexes[i - 1] : nullptr;
+        vIndexes[i].nHeight = 1000 + i;
+        vIndexes[i].nTime = params.nBeginMiningTime + i * params.nPowTargetSpacing;
+        vIndexes[i].nBaseTarget = poc::INITIAL_BASE_TARGET / (1 + i % 7);
+    }
+    CBlockHeader block;
+    block.nTime = vIndexes.back().nTime + params.nPowTargetSpacing;
+    while (state.KeepRunning()) {
+        poc::CalculateBaseTarget(vIndexes.back(), block, params);
+    }
+}
+
+static void PoCCalculateBaseTargetMemoized(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // Entries with a hash have their averaging window memoized, like the ones of the block index
+    std::vector<uint256> vHashes(100);
+    std::vector<CBlockIndex> vIndexes(100);
+    for (size_t i = 0; i < vIndexes.size(); i++) {
+        vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+        vIndexes[i].phashBlock = &vHashes[i];
+        vIndexes[i].pprev = i > 0 ? &vIndexes[i - 1] : nullptr;
+        vIndexes[i].nHeight = 1000 + i;
+        vIndexes[i].nTime = params.nBeginMiningTime + i * params.nPowTargetSpacing;
+        vIndexes[i].nBaseTarget = poc::INITIAL_BASE_TARGET / (1 + i % 7);
+    }
+    CBlockHeader block;
+    block.nTime = vIndexes.back().nTime + params.nPowTargetSpacing;
+    while (state.KeepRunning()) {
+        block.nTime++;
+        poc::CalculateBaseTarget(vIndexes.back(), block, params);
+    }
+}
+
+static void PoCGetNetCapacity(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // Put a full capacity eval window of blocks on top of the active chain for the duration of the bench
+    LOCK(cs_main);
+    CBlockIndex* pindexOldTip = ::ChainActive().Tip();
+    std::vector<CBlockIndex> vIndexes(params.nCapacityEvalWindow);
+    std::vector<uint256> vHashes(vIndexes.size());
+    for (size_t i = 0; i < vIndexes.size(); i++) {
+        vHashes[i] = GetRandHash();
+        vIndexes[i].phashBlock = &vHashes[i];
+        vIndexes[i].pprev = i > 0 ? &vIndexes[i - 1] : pindexOldTip;
+        vIndexes[i].nHeight = vIndexes[i].pprev->nHeight + 1;
+        vIndexes[i].nBaseTarget = poc::INITIAL_BASE_TARGET / (1 + i % 7);
+        vIndexes[i].nPlotterId = i % 100;
+    }
+    ::ChainActive().SetTip(&vIndexes.back());
+    const int nHeight = ::ChainActive().Height();
+
+    while (state.KeepRunning()) {
+        int nMinedCount = 0;
+        poc::GetNetCapacity(nHeight, params, [&nMinedCount](const CBlockIndex& block) {
+            if (block.nPlotterId == 0)
+                nMinedCount++;
+        });
+    }
+
+    ::ChainActive().SetTip(pindexOldTip);
+}
+
+static void PoCCheckProofOfCapacity(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlockIndex prevBlockIndex = PoCPrevBlockIndex(chainParams->GetConsensus());
+    CBlockHeader block;
+    block.hashPrevBlock = GetRandHash();
+    block.nBaseTarget = prevBlockIndex.nBaseTarget;
+    block.nPlotterId = GetRand(std::numeric_limits<uint64_t>::max());
+    block.nTime = prevBlockIndex.nTime + chainParams->GetConsensus().nPowTargetSpacing;
+    while (state.KeepRunning()) {
+        // A new nonce for every check, which keeps it out of the checked headers cache
+        block.nNonce++;
+        poc::CheckProofOfCapacity(prevBlockIndex, block, chainParams->GetConsensus());
+    }
+}
+
+static void PlotterSignatures(std::vector<unsigned char>& v, std::vector<unsigned char>& h, std::vector<unsigned char>& P)
+{
+    for (size_t n = 0; n < VERIFY_BATCH_SIZE; n++) {
+        const uint256 data = GetRandHash();
+        unsigned char signature[64];
+        poc::Sign("plotter passphrase " + std::to_string(n), data.begin(), signature, &P[n * 32]);
+        memcpy(&v[n * 32], signature, 32);
+        memcpy(&h[n * 32], signature + 32, 32);
+    }
+}
+
+static void PoCVerify(benchmark::State& state)
+{
+    std::vector<unsigned char> Y(VERIFY_BATCH_SIZE * 32), v(VERIFY_BATCH_SIZE * 32), h(VERIFY_BATCH_SIZE * 32), P(VERIFY_BATCH_SIZE * 32);
+    PlotterSignatures(v, h, P);
+    while (state.KeepRunning()) {
+        for (size_t n = 0; n < VERIFY_BATCH_SIZE; n++)
+            crypto::curve25519_verify(&Y[n * 32], &v[n * 32], &h[n * 32], &P[n * 32]);
+    }
+}
+
+static void PoCVerifyBatch(benchmark::State& state)
+{
+    std::vector<unsigned char> Y(VERIFY_BATCH_SIZE * 32), v(VERIFY_BATCH_SIZE * 32), h(VERIFY_BATCH_SIZE * 32), P(VERIFY_BATCH_SIZE * 32);
+    PlotterSignatures(v, h, P);
+    while (state.KeepRunning()) {
+        crypto::curve25519_verify_batch(VERIFY_BATCH_SIZE, Y.data(), v.data(), h.data(), P.data());
+    }
+}
+
+BENCHMARK(Shabal256, 200);
+BENCHMARK(Shabal256_64b, 1000 * 1000);
+BENCHMARK(Shabal256Lanes_64b, 500 * 1000);
+BENCHMARK(PoCCalculateDeadline, 300);
+BENCHMARK(PoCCalculateDeadlines, 20);
+BENCHMARK(PoCCalculateBaseTarget, 2 * 1000 * 1000);
+BENCHMARK(PoCCalculateBaseTargetMemoized, 2 * 1000 * 1000);
+BENCHMARK(PoCGetNetCapacity, 20 * 1000);
+BENCHMARK(PoCCheckProofOfCapacity, 300);
+BENCHMARK(PoCVerify, 20);
+BENCHMARK(PoCVerifyBatch, 20);
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <txmempool.h>
+
+#include <vector>
+
+// Every block decays the averages of all feerate buckets and confirmation targets
+// of the three horizons, whatever the number of transactions it confirms.
+static void PolicyEstimatorBlock(benchmark::State& state)
+{
+    const int TXS_PER_BLOCK = 10;
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < TXS_PER_BLOCK; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = i;
+        txs.push_back(MakeTransactionRef(std::move(tx)));
+    }
+
+    CBlockPolicyEstimator estimator;
+    unsigned int nHeight = 0;
+    std::vector<CTxMemPoolEntry> entries;
+    while (state.KeepRunning()) {
+        // Confirm the transactions received on top of the previous block
+        std::vector<const CTxMemPoolEntry*> block;
+        for (const CTxMemPoolEntry& entry : entries)
+            block.push_back(&entry);
+        estimator.processBlock(++nHeight, block);
+
+        entries.clear();
+        for (int i = 0; i < TXS_PER_BLOCK; i++) {
+            entries.emplace_back(txs[i], 1000 * (i + 1), /* time */ 0, nHeight, /* spendsCoinbase */ false, /* sigOpCost */ 4, LockPoints());
+            estimator.processTransaction(entries.back(), true);
+        }
+    }
+}
+
+BENCHMARK(PolicyEstimatorBlock, 5000);
@@ -0,0 +1,173 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <poc/poc.h>
+#include <pos/pos.h>
+#include <primitives/block.h>
+#include <random.h>
+
+#include <chiapos/api.h>
+
+#include <vector>
+
+/* Plot size of the proofs */
+static const int32_t PLOT_K = 32;
+
+struct PoSKeys {
+    const bls::PrivateKey masterPrivateKey;
+    const bls::PrivateKey localPrivateKey;
+    const bls::PrivateKey farmerPrivateKey;
+    const bls::G1Element localPubKey;
+    const bls::G1Element farmerPubKey;
+
+    PoSKeys() :
+        masterPrivateKey(pos::GeneratePrivateKey("qitcoin pos bench")),
+        localPrivateKey(pos::DeriveMasterToLocal(masterPrivateKey)),
+        farmerPrivateKey(pos::DeriveMasterToFarmer(masterPrivateKey)),
+        localPubKey(localPrivateKey.GetG1Element()),
+        farmerPubKey(farmerPrivateKey.GetG1Element()) {}
+};
+
+static std::vector<unsigned char> RandomBytes(size_t size)
+{
+    std::vector<unsigned char> vch(size);
+    GetRandBytes(vch.data(), vch.size());
+    return vch;
+}
+
+static void PoSCreatePlotPubKey(benchmark::State& state)
+{
+    const PoSKeys keys;
+    while (state.KeepRunning()) {
+        pos::CreatePlotPubKey(keys.localPubKey, keys.farmerPubKey, false);
+    }
+}
+
+static void PoSCreatePlotPubKeyTaproot(benchmark::State& state)
+{
+    const PoSKeys keys;
+    while (state.KeepRunning()) {
+        pos::CreatePlotPubKey(keys.localPubKey, keys.farmerPubKey, true);
+    }
+}
+
+static void PoSPlotFilter(benchmark::State& state)
+{
+    const PoSKeys keys;
+    const pos::Bytes vchPoolPubKey = RandomBytes(bls::G1Element::SIZE);
+    const pos::Bytes vchPlotPubKey = pos::CreatePlotPubKey(keys.localPubKey, keys.farmerPubKey).Serialize();
+    const int nFilterBits = CreateChainParams(CBaseChainParams::MAIN)->GetConsensus().nMercuryPosFilterBits;
+    uint256 challenge = GetRandHash();
+    while (state.KeepRunning()) {
+        challenge = pos::CreateChallenge(challenge, 1);
+        pos::PassesPlotFilter(pos::CreatePlotId(vchPoolPubKey, vchPlotPubKey), challenge, nFilterBits);
+    }
+}
+
+static void PoSBLSVerify(benchmark::State& state)
+{
+    const PoSKeys keys;
+    const uint256 challenge = GetRandHash();
+    const std::vector<uint8_t> message(challenge.begin(), challenge.end());
+    const bls::G2Element signature = bls::AugSchemeMPL().Sign(keys.farmerPrivateKey, message);
+    while (state.KeepRunning()) {
+        bool fVerified = bls::AugSchemeMPL().Verify(keys.farmerPubKey, message, signature);
+        assert(fVerified);
+    }
+}
+
+static void PoSValidateProof(benchmark::State& state)
+{
+    // A proof of random bytes, which is rejected after walking the proof tables
+    const uint256 plotId = GetRandHash();
+    const std::vector<uint8_t> vchProof = RandomBytes(PLOT_K * 8);
+    uint256 challenge = GetRandHash();
+    while (state.KeepRunning()) {
+        challenge = pos::CreateChallenge(challenge, 1);
+        chiapos::ValidateProof(
+            std::vector<uint8_t>(plotId.begin(), plotId.end()),
+            static_cast<uint8_t>(PLOT_K),
+            std::vector<uint8_t>(challenge.begin(), challenge.end()),
+            vchProof);
+    }
+}
+
+static void PoSCalculateIterations(benchmark::State& state)
+{
+    const pos::Bytes quality = RandomBytes(32);
+    uint256 challenge = GetRandHash();
+    while (state.KeepRunning()) {
+        challenge = pos::CreateChallenge(challenge, 1);
+        pos::CalculateIterations(quality, challenge, PLOT_K, poc::INITIAL_BASE_TARGET / 1000);
+    }
+}
+
+static void PoSVerifyBlockHeader(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    const PoSKeys keys;
+
+    CBlockIndex prevBlockIndex;
+    prevBlockIndex.nHeight = params.nMercuryActiveHeight + 1000;
+    prevBlockIndex.nBaseTarget = poc::INITIAL_BASE_TARGET / 1000;
+    prevBlockIndex.SetNextGenerationSignature(GetRandHash());
+
+    // A header with a valid plot signature, whose plot passes the filter of the challenge
+    CBlockHeader block;
+    block.pos.vchFarmerPubKey = keys.farmerPubKey.Serialize();
+    block.pos.vchLocalPubKey = keys.localPubKey.Serialize();
+    block.pos.vchProof = RandomBytes(PLOT_K * 8);
+    block.pos.nPlotK = PLOT_K;
+    block.pos.nScanIterations = 1;
+    block.nPlotterId = pos::ToFarmerId(block.pos.vchFarmerPubKey.ToVector());
+
+    const bls::G1Element plotPubKey = pos::CreatePlotPubKey(keys.localPubKey, keys.farmerPubKey);
+    const uint256 challenge = pos::CreateChallenge(prevBlockIndex.GetNextGenerationSignature(), block.pos.nScanIterations);
+    do {
+        block.pos.vchPoolPubKey = RandomBytes(bls::G1Element::SIZE);
+    } while (!pos::PassesPlotFilter(pos::CreatePlotId(block.pos.vchPoolPubKey.ToVector(), plotPubKey.Serialize()), challenge, params.nMercuryPosFilterBits));
+    const bls::PrivateKey plotPrivateKey = bls::PrivateKey::Aggregate({keys.localPrivateKey, keys.farmerPrivateKey});
+    block.pos.vchSignature = bls::AugSchemeMPL().Sign(plotPrivateKey, std::vector<uint8_t>(challenge.begin(), challenge.end())).Serialize();
+
+    // The first check verifies the signature and rejects the proof, later checks of the same
+    // header are answered by the plot key, signature and proof quality caches
+    while (state.KeepRunning()) {
+        pos::VerifyBlockHeader(prevBlockIndex, block, params);
+    }
+}
+
+static void PoSGenerateStakingPoolNonces(benchmark::State& state, uint64_t votePower)
+{
+    const uint256 epochHash = GetRandHash();
+    CAccountID poolID;
+    GetRandBytes(poolID.begin(), CAccountID::WIDTH);
+    uint32_t nTargetHeight = 700000;
+    while (state.KeepRunning()) {
+        pos::GenerateStakingPoolNonces(epochHash, nTargetHeight++, poolID, votePower);
+    }
+}
+
+static void PoSGenerateStakingPoolNonces_1k(benchmark::State& state)
+{
+    PoSGenerateStakingPoolNonces(state, 1000);
+}
+
+static void PoSGenerateStakingPoolNonces_100k(benchmark::State& state)
+{
+    PoSGenerateStakingPoolNonces(state, 100 * 1000);
+}
+
+BENCHMARK(PoSCreatePlotPubKey, 20 * 1000);
+BENCHMARK(PoSCreatePlotPubKeyTaproot, 2000);
+BENCHMARK(PoSPlotFilter, 1000 * 1000);
+BENCHMARK(PoSBLSVerify, 500);
+BENCHMARK(PoSValidateProof, 1000);
+BENCHMARK(PoSCalculateIterations, 500 * 1000);
+BENCHMARK(PoSVerifyBlockHeader, 200 * 1000);
+BENCHMARK(PoSGenerateStakingPoolNonces_1k, 5000);
+BENCHMARK(PoSGenerateStakingPoolNonces_100k, 50);
@@ -6,6 +6,8 @@
 
 #include <bench/bench.h>
 #include <bloom.h>
+#include <crypto/common.h>
+#include <uint256.h>
 
 static void RollingBloom(benchmark::State& state)
 {
@@ -36,5 +38,46 @@ static void RollingBloomReset(benchmark::State& state)
     }
 }
 
+static void RollingBloomHash(benchmark::State& state)
+{
+    CRollingBloomFilter filter(50000, 0.000001);
+    uint256 hash;
+    uint32_t count = 0;
+    while (state.KeepRunning()) {
+        count++;
+        WriteLE32(hash.begin(), count);
+        filter.insert(hash);
+
+        WriteBE32(hash.begin(), count);
+        filter.contains(hash);
+    }
+}
+
+static void RollingCuckoo(benchmark::State& state)
+{
+    CRollingCuckooFilter filter(50000, 50000, 0);
+    uint256 hash;
+    uint32_t count = 0;
+    while (state.KeepRunning()) {
+        count++;
+        WriteLE32(hash.begin(), count);
+        filter.insert(hash);
+
+        WriteBE32(hash.begin(), count);
+        filter.contains(hash);
+    }
+}
+
+static void RollingCuckooReset(benchmark::State& state)
+{
+    CRollingCuckooFilter filter(50000, 50000, 0);
+    while (state.KeepRunning()) {
+        filter.reset();
+    }
+}
+
 BENCHMARK(RollingBloom, 1500 * 1000);
 BENCHMARK(RollingBloomReset, 20000);
+BENCHMARK(RollingBloomHash, 1500 * 1000);
+BENCHMARK(RollingCuckoo, 1500 * 1000);
+BENCHMARK(RollingCuckooReset, 20000);
@@ -10,12 +10,16 @@
 #include <crypto/siphash.h>
 #include <random.h>
 #include <streams.h>
+#include <threadpool.h>
 #include <txmempool.h>
 #include <validation.h>
 #include <util/system.h>
 
 #include <unordered_map>
 
+//! Minimum number of mempool short IDs computed by each thread when reconstructing a block
+static const size_t SHORTID_MIN_PER_THREAD = 2048;
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
         shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
@@ -106,29 +110,43 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     {
     LOCK(pool->cs);
     const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
-    for (size_t i = 0; i < vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
-                mempool_count++;
-            } else {
-                // If we find two mempool txn that match the short id, just request it.
-                // This should be rare enough that the extra bandwidth doesn't matter,
-                // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
-                    mempool_count--;
+    // The short IDs of the mempool are computed in chunks on the shared thread pool, and matched in order
+    const int nThreads = GetThreadPool().GetThreadCount() + 1;
+    const size_t nChunkSize = SHORTID_MIN_PER_THREAD * nThreads;
+    std::vector<uint64_t> vShortIds;
+    for (size_t nChunk = 0; nChunk < vTxHashes.size() && mempool_count != shorttxids.size(); nChunk += nChunkSize) {
+        const size_t nChunkEnd = std::min(vTxHashes.size(), nChunk + nChunkSize);
+        vShortIds.resize(nChunkEnd - nChunk);
+        const int nSlices = std::max(1, std::min(nThreads, (int) (vShortIds.size() / SHORTID_MIN_PER_THREAD)));
+        GetThreadPool().RunParallel(TaskPriority::CRITICAL, nSlices, [&](int nSlice) {
+            const size_t nBegin = vShortIds.size() * nSlice / nSlices, nEnd = vShortIds.size() * (nSlice + 1) / nSlices;
+            for (size_t i = nBegin; i < nEnd; i++)
+                vShortIds[i] = cmpctblock.GetShortID(vTxHashes[nChunk + i].first);
+        });
+        for (size_t i = nChunk; i < nChunkEnd; i++) {
+            uint64_t shortid = vShortIds[i - nChunk];
+            std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
+            if (idit != shorttxids.end()) {
+                if (!have_txn[idit->second]) {
+                    txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
+                    have_txn[idit->second]  = true;
+                    mempool_count++;
+                } else {
+                    // If we find two mempool txn that match the short id, just request it.
+                    // This should be rare enough that the extra bandwidth doesn't matter,
+                    // but eating a round-trip due to FillBlock failure would be annoying
+                    if (txn_available[idit->second]) {
+                        txn_available[idit->second].reset();
+                        mempool_count--;
+                    }
                 }
             }
+            // Though ideally we'd continue scanning for the two-txn-match-shortid case,
+            // the performance win of an early exit here is too good to pass up and worth
+            // the extra risk.
+            if (mempool_count == shorttxids.size())
+                break;
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
     }
     }
 
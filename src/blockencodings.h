@@ -209,4 +209,155 @@ public:
     ReadStatus FillBlock(CBlock& block, const std::vector<CTransactionRef>& vtx_missing);
 };
 
+//! Number of keys a compressed headers message can refer back to
+static const unsigned int MAX_COMPRESSED_HEADER_KEYS = 64;
+
+/**
+ * Encodes and decodes the headers of a "cheaders" message, one header after the other.
+ *
+ * The hash of the previous block is left out when it is the hash of the header before, and the version when
+ * it did not change. The generator and farmer keys, which repeat across the blocks of a generator, are coded
+ * against the last MAX_COMPRESSED_HEADER_KEYS keys of the message. The decoded headers are the original ones.
+ */
+class CompressedHeaderCoder {
+private:
+    enum : uint8_t {
+        HEADER_PREV = 0x01,     //!< hashPrevBlock is not the hash of the header before
+        HEADER_VERSION = 0x02,  //!< nVersion differs from the header before
+        HEADER_POS = 0x04,      //!< has a Chia proof of space
+        HEADER_SIGNED = 0x08,   //!< has a generator signature
+    };
+    static const uint64_t BASE_TARGET_MASK = 0x0000ffffffffffffL;
+
+    bool fHavePrev = false;
+    uint256 hashPrev;
+    int32_t nPrevVersion = 0;
+    std::vector<std::vector<unsigned char>> vKeys;
+    size_t nNextKey = 0;
+
+    void AddKey(std::vector<unsigned char>&& vch) {
+        if (vKeys.size() < MAX_COMPRESSED_HEADER_KEYS)
+            vKeys.push_back(std::move(vch));
+        else
+            vKeys[nNextKey] = std::move(vch);
+        nNextKey = (nNextKey + 1) % MAX_COMPRESSED_HEADER_KEYS;
+    }
+
+    //! A key is written as 0 and the key, or as 1 + its index
+    template <typename Stream, unsigned int N>
+    void WriteKey(Stream& s, const HeaderBytes<N>& key) {
+        for (size_t i = 0; i < vKeys.size(); i++) {
+            if (vKeys[i].size() == key.size() && std::equal(key.begin(), key.end(), vKeys[i].begin())) {
+                WriteCompactSize(s, i + 1);
+                return;
+            }
+        }
+        WriteCompactSize(s, 0);
+        s << key;
+        AddKey(key.ToVector());
+    }
+
+    template <typename Stream, unsigned int N>
+    void ReadKey(Stream& s, HeaderBytes<N>& key) {
+        uint64_t nCode = ReadCompactSize(s);
+        if (nCode == 0) {
+            std::vector<unsigned char> vch;
+            s >> LIMITED_VECTOR(vch, N);
+            key = HeaderBytes<N>(vch);
+            AddKey(std::move(vch));
+        } else {
+            if (nCode > vKeys.size())
+                throw std::ios_base::failure("compressed header key out of range");
+            key = HeaderBytes<N>(vKeys[nCode - 1]);
+        }
+    }
+
+    void SetPrev(const CBlockHeader& header) {
+        fHavePrev = true;
+        hashPrev = header.GetHash();
+        nPrevVersion = header.nVersion;
+    }
+
+public:
+    template <typename Stream>
+    void Encode(Stream& s, const CBlockHeader& header) {
+        uint8_t nFields = 0;
+        if (!fHavePrev || header.hashPrevBlock != hashPrev)
+            nFields |= HEADER_PREV;
+        if (!fHavePrev || header.nVersion != nPrevVersion)
+            nFields |= HEADER_VERSION;
+        if (!header.pos.IsNull())
+            nFields |= HEADER_POS;
+        if (!header.vchPubKey.empty())
+            nFields |= HEADER_SIGNED;
+
+        s << nFields;
+        if (nFields & HEADER_VERSION)
+            s << header.nVersion;
+        if (nFields & HEADER_PREV)
+            s << header.hashPrevBlock;
+        s << header.hashMerkleRoot << header.nTime << (header.nBaseTarget & BASE_TARGET_MASK) << header.nNonce << header.nPlotterId;
+        if (nFields & HEADER_POS) {
+            WriteKey(s, header.pos.vchFarmerPubKey);
+            WriteKey(s, header.pos.vchPoolPubKey);
+            s << header.pos.vchLocalPubKey << header.pos.vchProof << header.pos.nPlotK;
+            s << header.pos.vchSignature << header.pos.nScanIterations;
+        }
+        if (nFields & HEADER_SIGNED) {
+            WriteKey(s, header.vchPubKey);
+            s << header.vchSignature;
+        }
+
+        SetPrev(header);
+    }
+
+    template <typename Stream>
+    void Decode(Stream& s, CBlockHeader& header) {
+        header.SetNull();
+
+        uint8_t nFields;
+        s >> nFields;
+        if (!fHavePrev && (nFields & (HEADER_PREV | HEADER_VERSION)) != (HEADER_PREV | HEADER_VERSION))
+            throw std::ios_base::failure("first compressed header is incomplete");
+
+        header.nVersion = nPrevVersion;
+        if (nFields & HEADER_VERSION)
+            s >> header.nVersion;
+        header.hashPrevBlock = hashPrev;
+        if (nFields & HEADER_PREV)
+            s >> header.hashPrevBlock;
+        s >> header.hashMerkleRoot >> header.nTime >> header.nBaseTarget >> header.nNonce >> header.nPlotterId;
+        header.nBaseTarget &= BASE_TARGET_MASK;
+        if (nFields & HEADER_POS) {
+            ReadKey(s, header.pos.vchFarmerPubKey);
+            ReadKey(s, header.pos.vchPoolPubKey);
+            s >> header.pos.vchLocalPubKey >> header.pos.vchProof >> header.pos.nPlotK;
+            s >> header.pos.vchSignature >> header.pos.nScanIterations;
+        }
+        if (nFields & HEADER_SIGNED) {
+            ReadKey(s, header.vchPubKey);
+            s >> header.vchSignature;
+        }
+
+        SetPrev(header);
+    }
+};
+
+/** The headers of a "cheaders" message, sent in the place of a "headers" message to the peers asking for them */
+class CompressedBlockHeaders {
+public:
+    std::vector<CBlockHeader> headers;
+
+    CompressedBlockHeaders() {}
+    explicit CompressedBlockHeaders(const std::vector<CBlock>& blocks) : headers(blocks.begin(), blocks.end()) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        CompressedHeaderCoder coder;
+        WriteCompactSize(s, headers.size());
+        for (const CBlockHeader& header : headers)
+            coder.Encode(s, header);
+    }
+};
+
 #endif // BITCOIN_BLOCKENCODINGS_H
@@ -7,10 +7,12 @@
 #include <set>
 
 #include <blockfilter.h>
+#include <crypto/common.h>
 #include <crypto/siphash.h>
 #include <hash.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/standard.h>
 #include <streams.h>
 
 /// SerType used to serialize parameters in GCS filter encoding.
@@ -21,8 +23,17 @@ static constexpr int GCS_SER_VERSION = 0;
 
 static const std::map<BlockFilterType, std::string> g_filter_types = {
     {BlockFilterType::BASIC, "basic"},
+    {BlockFilterType::EXTENDED, "extended"},
 };
 
+/// Tags of the extended filter elements, which keep them apart from the scripts of basic elements.
+static constexpr unsigned char EXTENDED_ELEMENT_PLOTTER = 0xf0;
+static constexpr unsigned char EXTENDED_ELEMENT_RECEIVER = 0xf1;
+static constexpr unsigned char EXTENDED_ELEMENT_OMNI_MARKER = 0xf2;
+
+/// The "omni" marker, which starts the first data push of the OP_RETURN output of Omni Class C transactions.
+static const unsigned char OMNI_MARKER[] = {0x6f, 0x6d, 0x6e, 0x69};
+
 template <typename OStream>
 static void GolombRiceEncode(BitStreamWriter<OStream>& bitwriter, uint8_t P, uint64_t x)
 {
@@ -279,6 +290,85 @@ static GCSFilter::ElementSet BasicFilterElements(const CBlock& block,
     return elements;
 }
 
+GCSFilter::Element ExtendedFilterPlotterElement(uint64_t plotterId)
+{
+    GCSFilter::Element element(1 + sizeof(plotterId));
+    element[0] = EXTENDED_ELEMENT_PLOTTER;
+    WriteLE64(element.data() + 1, plotterId);
+    return element;
+}
+
+GCSFilter::Element ExtendedFilterReceiverElement(const CAccountID& receiverID)
+{
+    GCSFilter::Element element(1, EXTENDED_ELEMENT_RECEIVER);
+    element.insert(element.end(), receiverID.begin(), receiverID.end());
+    return element;
+}
+
+GCSFilter::Element ExtendedFilterOmniMarkerElement()
+{
+    GCSFilter::Element element(1, EXTENDED_ELEMENT_OMNI_MARKER);
+    element.insert(element.end(), OMNI_MARKER, OMNI_MARKER + sizeof(OMNI_MARKER));
+    return element;
+}
+
+static void AddPayloadElements(GCSFilter::ElementSet& elements, const CTxOutPayloadRef& payload)
+{
+    if (!payload)
+        return;
+    if (payload->type == TXOUT_TYPE_BINDPLOTTER)
+        elements.insert(ExtendedFilterPlotterElement(BindPlotterPayload::As(payload)->GetId()));
+    else if (payload->type == TXOUT_TYPE_POINT)
+        elements.insert(ExtendedFilterReceiverElement(PointPayload::As(payload)->GetReceiverID()));
+    else if (payload->type == TXOUT_TYPE_STAKING)
+        elements.insert(ExtendedFilterReceiverElement(StakingPayload::As(payload)->GetReceiverID()));
+}
+
+/// Whether the first data push of an OP_RETURN output starts with the "omni" marker. This matches
+/// every transaction Omni Core may parse as Class C transaction, independent of feature activations.
+static bool HasOmniMarker(const CTransaction& tx)
+{
+    for (const CTxOut& txout : tx.vout) {
+        const CScript& script = txout.scriptPubKey;
+        if (script.size() < 2 || script[0] != OP_RETURN) continue;
+
+        CScript::const_iterator pc = script.begin() + 1;
+        opcodetype opcode;
+        std::vector<unsigned char> data;
+        if (script.GetOp(pc, opcode, data) && opcode <= OP_PUSHDATA4 && data.size() >= sizeof(OMNI_MARKER) &&
+                std::equal(OMNI_MARKER, OMNI_MARKER + sizeof(OMNI_MARKER), data.begin())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static GCSFilter::ElementSet ExtendedFilterElements(const CBlock& block,
+                                                    const CBlockUndo& block_undo)
+{
+    GCSFilter::ElementSet elements = BasicFilterElements(block, block_undo);
+
+    // Height 0 skips the checks depending on the height, so the filter may match a few payloads
+    // the consensus rules reject at the height of the block, but never misses one
+    for (const CTransactionRef& tx : block.vtx) {
+        for (const CTxOut& txout : tx->vout) {
+            if (txout.payload.empty()) continue;
+            AddPayloadElements(elements, ExtractTxoutPayload(txout, 0, {TXOUT_TYPE_BINDPLOTTER, TXOUT_TYPE_POINT, TXOUT_TYPE_STAKING}));
+        }
+        if (HasOmniMarker(*tx)) {
+            elements.insert(ExtendedFilterOmniMarkerElement());
+        }
+    }
+
+    for (const CTxUndo& tx_undo : block_undo.vtxundo) {
+        for (const Coin& prevout : tx_undo.vprevout) {
+            AddPayloadElements(elements, prevout.GetPayload());
+        }
+    }
+
+    return elements;
+}
+
 BlockFilter::BlockFilter(BlockFilterType filter_type, const uint256& block_hash,
                          std::vector<unsigned char> filter)
     : m_filter_type(filter_type), m_block_hash(block_hash)
@@ -297,13 +387,18 @@ BlockFilter::BlockFilter(BlockFilterType filter_type, const CBlock& block, const
     if (!BuildParams(params)) {
         throw std::invalid_argument("unknown filter_type");
     }
-    m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
+    if (m_filter_type == BlockFilterType::EXTENDED) {
+        m_filter = GCSFilter(params, ExtendedFilterElements(block, block_undo));
+    } else {
+        m_filter = GCSFilter(params, BasicFilterElements(block, block_undo));
+    }
 }
 
 bool BlockFilter::BuildParams(GCSFilter::Params& params) const
 {
     switch (m_filter_type) {
     case BlockFilterType::BASIC:
+    case BlockFilterType::EXTENDED:
         params.m_siphash_k0 = m_block_hash.GetUint64(0);
         params.m_siphash_k1 = m_block_hash.GetUint64(1);
         params.m_P = BASIC_FILTER_P;
@@ -88,9 +88,20 @@ constexpr uint32_t BASIC_FILTER_M = 784931;
 enum class BlockFilterType : uint8_t
 {
     BASIC = 0,
+    //! The basic elements, plus the elements derived from bind plotter, point and staking payloads and the Omni marker
+    EXTENDED = 1,
     INVALID = 255,
 };
 
+/** Element of an extended filter for the blocks creating or spending a bind of the plotter */
+GCSFilter::Element ExtendedFilterPlotterElement(uint64_t plotterId);
+
+/** Element of an extended filter for the blocks creating or spending a point or staking to the receiver */
+GCSFilter::Element ExtendedFilterReceiverElement(const CAccountID& receiverID);
+
+/** Element of an extended filter for the blocks with a transaction carrying the Omni marker */
+GCSFilter::Element ExtendedFilterOmniMarkerElement();
+
 /** Get the human-readable name for a filter type. Returns empty string for unknown types. */
 const std::string& BlockFilterTypeName(BlockFilterType filter_type);
 
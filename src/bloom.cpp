@@ -5,11 +5,14 @@
 #include <bloom.h>
 
 #include <primitives/transaction.h>
+#include <crypto/siphash.h>
 #include <hash.h>
+#include <memusage.h>
 #include <script/script.h>
 #include <script/standard.h>
 #include <random.h>
 #include <streams.h>
+#include <util/time.h>
 
 #include <math.h>
 #include <stdlib.h>
@@ -307,3 +310,194 @@ void CRollingBloomFilter::reset()
     nGeneration = 1;
     std::fill(data.begin(), data.end(), 0);
 }
+
+//! Slots of a cuckoo filter bucket, compared together
+static const int CUCKOO_BUCKET_SLOTS = 4;
+//! Share of the slots used when all 3 generations are full
+static const double CUCKOO_MAX_LOAD = 0.9;
+//! Entries moved to make room for an insert, before the last moved one is dropped
+static const int CUCKOO_MAX_KICKS = 128;
+
+/* The generations work like the ones of CRollingBloomFilter: entries are inserted with generation
+ * 1, 2 or 3, and moving to the next generation drops the entries of its previous use. */
+struct CRollingCuckooFilter::Table {
+    //! Fingerprints, CUCKOO_BUCKET_SLOTS per bucket, 0 if the slot is empty
+    std::vector<uint32_t> vSlots;
+    //! Generation of the slots of a bucket, 2 bits per slot
+    std::vector<uint8_t> vGenerations;
+    uint32_t nBuckets;
+    int nEntriesPerGeneration;
+    int nEntriesThisGeneration;
+    int nGeneration;
+
+    explicit Table(unsigned int nElements)
+    {
+        nEntriesPerGeneration = (nElements + 1) / 2;
+        const double nSlots = nEntriesPerGeneration * 3 / CUCKOO_MAX_LOAD;
+        nBuckets = std::max<uint32_t>(1, (uint32_t) ceil(nSlots / CUCKOO_BUCKET_SLOTS));
+        vSlots.assign((size_t) nBuckets * CUCKOO_BUCKET_SLOTS, 0);
+        vGenerations.assign(nBuckets, 0);
+        nEntriesThisGeneration = 0;
+        nGeneration = 1;
+    }
+
+    //! The other bucket of a fingerprint. Applied twice, it returns the bucket it started with
+    uint32_t AltBucket(uint32_t nBucket, uint32_t fp) const
+    {
+        const uint32_t m = FastMod(fp * 0x9E3779B1, nBuckets);
+        return (m + nBuckets - nBucket) % nBuckets;
+    }
+
+    bool BucketContains(uint32_t nBucket, uint32_t fp) const
+    {
+        const uint32_t* slots = &vSlots[(size_t) nBucket * CUCKOO_BUCKET_SLOTS];
+        return (slots[0] == fp) | (slots[1] == fp) | (slots[2] == fp) | (slots[3] == fp);
+    }
+
+    bool Contains(uint32_t nBucket, uint32_t fp) const
+    {
+        return BucketContains(nBucket, fp) || BucketContains(AltBucket(nBucket, fp), fp);
+    }
+
+    int GetGeneration(uint32_t nBucket, int nSlot) const { return (vGenerations[nBucket] >> (2 * nSlot)) & 3; }
+
+    void Set(uint32_t nBucket, int nSlot, uint32_t fp, int nGen)
+    {
+        vSlots[(size_t) nBucket * CUCKOO_BUCKET_SLOTS + nSlot] = fp;
+        vGenerations[nBucket] = (vGenerations[nBucket] & ~(3 << (2 * nSlot))) | (nGen << (2 * nSlot));
+    }
+
+    //! Move the fingerprint to the generation, if it is in the bucket
+    bool TryRenew(uint32_t nBucket, uint32_t fp, int nGen)
+    {
+        const uint32_t* slots = &vSlots[(size_t) nBucket * CUCKOO_BUCKET_SLOTS];
+        for (int i = 0; i < CUCKOO_BUCKET_SLOTS; i++) {
+            if (slots[i] == fp) {
+                Set(nBucket, i, fp, nGen);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool TryPlace(uint32_t nBucket, uint32_t fp, int nGen)
+    {
+        const uint32_t* slots = &vSlots[(size_t) nBucket * CUCKOO_BUCKET_SLOTS];
+        for (int i = 0; i < CUCKOO_BUCKET_SLOTS; i++) {
+            if (slots[i] == 0) {
+                Set(nBucket, i, fp, nGen);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Insert(uint32_t nBucket, uint32_t fp, uint64_t& nKickState)
+    {
+        if (nEntriesThisGeneration == nEntriesPerGeneration) {
+            nEntriesThisGeneration = 0;
+            nGeneration++;
+            if (nGeneration == 4) {
+                nGeneration = 1;
+            }
+            /* Wipe old entries that used this generation number. */
+            for (uint32_t b = 0; b < nBuckets; b++) {
+                for (int i = 0; i < CUCKOO_BUCKET_SLOTS; i++) {
+                    if (GetGeneration(b, i) == nGeneration)
+                        Set(b, i, 0, 0);
+                }
+            }
+        }
+        nEntriesThisGeneration++;
+
+        const uint32_t nAltBucket = AltBucket(nBucket, fp);
+        if (TryRenew(nBucket, fp, nGeneration) || TryRenew(nAltBucket, fp, nGeneration) ||
+            TryPlace(nBucket, fp, nGeneration) || TryPlace(nAltBucket, fp, nGeneration))
+            return;
+
+        // Move entries to their other bucket until one finds an empty slot
+        int nGen = nGeneration;
+        uint32_t b = (nKickState & 1) ? nAltBucket : nBucket;
+        for (int n = 0; n < CUCKOO_MAX_KICKS; n++) {
+            nKickState ^= nKickState << 13;
+            nKickState ^= nKickState >> 7;
+            nKickState ^= nKickState << 17;
+            const int nSlot = nKickState % CUCKOO_BUCKET_SLOTS;
+            const uint32_t fpKicked = vSlots[(size_t) b * CUCKOO_BUCKET_SLOTS + nSlot];
+            const int nGenKicked = GetGeneration(b, nSlot);
+            Set(b, nSlot, fp, nGen);
+            fp = fpKicked;
+            nGen = nGenKicked;
+            b = AltBucket(b, fp);
+            if (TryPlace(b, fp, nGen))
+                return;
+        }
+        // The table is overfull, the last moved entry is forgotten
+    }
+};
+
+CRollingCuckooFilter::CRollingCuckooFilter(unsigned int nMinElementsIn, unsigned int nMaxElementsIn, int64_t nRetentionIn) :
+    nMinElements(nMinElementsIn), nMaxElements(std::max(nMinElementsIn, nMaxElementsIn)), nRetention(nRetentionIn)
+{
+    reset();
+}
+
+CRollingCuckooFilter::~CRollingCuckooFilter() {}
+
+/* The fingerprint and the first bucket are taken from the two halves of the salted hash. */
+static inline uint32_t CuckooFingerprint(uint64_t h)
+{
+    const uint32_t fp = (uint32_t) h;
+    return fp != 0 ? fp : 1;
+}
+
+void CRollingCuckooFilter::insert(const uint256& hash)
+{
+    if (table->nEntriesThisGeneration == table->nEntriesPerGeneration) {
+        // Entries stay for 2 to 3 generations, grow if a generation fills up faster than half the retention
+        const int64_t nNow = GetTime();
+        if (nElements < nMaxElements && nNow - nGenerationStart < nRetention / 2) {
+            nElements = std::min(nElements * 2, nMaxElements);
+            tablePrev = std::move(table);
+            table.reset(new Table(nElements));
+            nInsertedSinceGrow = 0;
+        }
+        nGenerationStart = nNow;
+    }
+
+    const uint64_t h = SipHashUint256(k0, k1, hash);
+    table->Insert(FastMod(h >> 32, table->nBuckets), CuckooFingerprint(h), nKickState);
+
+    // The previous table holds at most 3 generations, which the new one holds by now
+    if (tablePrev && ++nInsertedSinceGrow >= (unsigned int) tablePrev->nEntriesPerGeneration * 3)
+        tablePrev.reset();
+}
+
+bool CRollingCuckooFilter::contains(const uint256& hash) const
+{
+    const uint64_t h = SipHashUint256(k0, k1, hash);
+    const uint32_t fp = CuckooFingerprint(h);
+    if (table->Contains(FastMod(h >> 32, table->nBuckets), fp))
+        return true;
+    return tablePrev && tablePrev->Contains(FastMod(h >> 32, tablePrev->nBuckets), fp);
+}
+
+void CRollingCuckooFilter::reset()
+{
+    k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    k1 = GetRand(std::numeric_limits<uint64_t>::max());
+    nKickState = k0 | 1;
+    nElements = nMinElements;
+    nGenerationStart = GetTime();
+    nInsertedSinceGrow = 0;
+    table.reset(new Table(nElements));
+    tablePrev.reset();
+}
+
+size_t CRollingCuckooFilter::DynamicMemoryUsage() const
+{
+    size_t nUsage = memusage::MallocUsage(sizeof(Table)) + memusage::DynamicUsage(table->vSlots) + memusage::DynamicUsage(table->vGenerations);
+    if (tablePrev)
+        nUsage += memusage::MallocUsage(sizeof(Table)) + memusage::DynamicUsage(tablePrev->vSlots) + memusage::DynamicUsage(tablePrev->vGenerations);
+    return nUsage;
+}
@@ -7,6 +7,8 @@
 
 #include <serialize.h>
 
+#include <memory>
+#include <stdint.h>
 #include <vector>
 
 class COutPoint;
@@ -136,4 +138,50 @@ private:
     int nHashFuncs;
 };
 
+/**
+ * RollingCuckooFilter is a "keep track of most recently inserted" set of hashes, like
+ * CRollingBloomFilter, for the per-peer inventory filters. The hashes are stored as salted
+ * 32-bit fingerprints in a cuckoo table of 4-slot buckets, with a 2-bit generation per slot.
+ *
+ * contains(hash) returns true if hash was one of the last N to 1.5*N insert()'ed, where N grows
+ * from nMinElements up to nMaxElements, but may also return true for hashes that were not
+ * inserted, with a rate of about 2e-9. A lookup compares the slots of 2 buckets, and an entry
+ * takes about 7 bytes per element of N, where CRollingBloomFilter takes 11 bytes at a rate of 1e-6.
+ *
+ * N doubles when the entries inserted within nRetention seconds no longer fit, so that peers which
+ * announce little keep small filters. The previous table is probed until the new one holds as
+ * many entries.
+ */
+class CRollingCuckooFilter
+{
+public:
+    CRollingCuckooFilter(unsigned int nMinElements, unsigned int nMaxElements, int64_t nRetention);
+    ~CRollingCuckooFilter();
+
+    void insert(const uint256& hash);
+    bool contains(const uint256& hash) const;
+
+    //! Forget all entries, change the salt and shrink back to nMinElements
+    void reset();
+
+    size_t DynamicMemoryUsage() const;
+    unsigned int GetElements() const { return nElements; }
+
+private:
+    struct Table;
+
+    const unsigned int nMinElements;
+    const unsigned int nMaxElements;
+    const int64_t nRetention;
+    unsigned int nElements;
+    uint64_t k0, k1;
+    //! State of the generator picking the slots to evict
+    uint64_t nKickState;
+    //! Start of the current generation, to tell whether it filled up within nRetention
+    int64_t nGenerationStart;
+    unsigned int nInsertedSinceGrow;
+    std::unique_ptr<Table> table;
+    std::unique_ptr<Table> tablePrev;
+};
+
 #endif // BITCOIN_BLOOM_H
@@ -8,8 +8,12 @@
 #include <logging.h>
 #include <poc/poc.h>
 #include <script/standard.h>
+#include <sync.h>
 #include <validation.h>
 
+#include <deque>
+#include <unordered_map>
+
 /**
  * CChain implementation
  */
@@ -152,22 +156,137 @@ CBlockIndex* CBlockIndex::GetAncestor(int height)
     return const_cast<CBlockIndex*>(static_cast<const CBlockIndex*>(this)->GetAncestor(height));
 }
 
-void CBlockIndex::Update(const Consensus::Params& params)
+static const CBlockIndexSignature emptySignature;
+
+const BlockPubKeyBytes& CBlockIndex::GetPubKey() const
 {
-    // Genearation signature
-    static uint256 dummyGenerationSignature;
+    return psignature ? psignature->vchPubKey : emptySignature.vchPubKey;
+}
 
-    generationSignature = pprev ? &pprev->nextGenerationSignature : &dummyGenerationSignature;
-    if (nHeight <= 1) {
-        nextGenerationSignature.SetNull();
-    } else {
-        assert(generationSignature != nullptr);
-        uint64_t plotterId = htobe64(nPlotterId);
+const BlockSignatureBytes& CBlockIndex::GetSignature() const
+{
+    return psignature ? psignature->vchSignature : emptySignature.vchSignature;
+}
+
+void CBlockIndex::SetSignature(const BlockPubKeyBytes& vchPubKey, const BlockSignatureBytes& vchSignature)
+{
+    if (vchPubKey.empty() && vchSignature.empty()) {
+        psignature.reset();
+        return;
+    }
+    std::shared_ptr<CBlockIndexSignature> signature = std::make_shared<CBlockIndexSignature>();
+    signature->vchPubKey = vchPubKey;
+    signature->vchSignature = vchSignature;
+    psignature = std::move(signature);
+}
+
+void CBlockIndex::SetMinerRewardTxOut(CTxOut txOut)
+{
+    minerRewardTxOut = std::move(txOut);
+    generatorAccountID = ExtractAccountID(minerRewardTxOut.scriptPubKey);
+}
+
+CChiaProofOfSpace CBlockIndex::GetPos() const
+{
+    std::shared_ptr<const CChiaProofOfSpace> pposCached = std::atomic_load(&ppos);
+    if (pposCached)
+        return *pposCached;
+
+    CChiaProofOfSpace pos;
+    if ((nStatus & BLOCK_HAVE_POS) && phashBlock != nullptr && pblocktree) {
+        if (!pblocktree->ReadBlockIndexPos(GetBlockHash(), pos))
+            LogPrintf("%s: failed to read PoS data of block %s\n", __func__, GetBlockHash().ToString());
+    }
+    return pos;
+}
+
+namespace {
+
+/** Side table of derived next generation signatures, see GENERATION_SIGNATURE_CHECKPOINT_INTERVAL. */
+struct CGenerationSignatureCache
+{
+    Mutex cs;
+    std::unordered_map<const CBlockIndex*, uint256> mapSignatures GUARDED_BY(cs);
+    //! Cached entries that are not checkpoints, oldest first
+    std::deque<const CBlockIndex*> dequeRecent GUARDED_BY(cs);
+
+    void Insert(const CBlockIndex* pindex, const uint256& signature) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        if (!mapSignatures.emplace(pindex, signature).second)
+            return;
+        pindex->fGenerationSignatureCached = true;
+        if (pindex->nHeight % GENERATION_SIGNATURE_CHECKPOINT_INTERVAL == 0)
+            return;
+        dequeRecent.push_back(pindex);
+        if (dequeRecent.size() > MAX_RECENT_GENERATION_SIGNATURES) {
+            auto it = mapSignatures.find(dequeRecent.front());
+            if (it != mapSignatures.end() && it->first->nHeight % GENERATION_SIGNATURE_CHECKPOINT_INTERVAL != 0) {
+                it->first->fGenerationSignatureCached = false;
+                mapSignatures.erase(it);
+            }
+            dequeRecent.pop_front();
+        }
+    }
+};
+
+// Block index entries may outlive static objects, never destroy the cache
+CGenerationSignatureCache& GetGenerationSignatureCache()
+{
+    static CGenerationSignatureCache* cache = new CGenerationSignatureCache();
+    return *cache;
+}
+
+} // namespace
+
+CBlockIndex::~CBlockIndex()
+{
+    if (fGenerationSignatureCached) {
+        CGenerationSignatureCache& cache = GetGenerationSignatureCache();
+        LOCK(cache.cs);
+        cache.mapSignatures.erase(this);
+    }
+}
+
+uint256 CBlockIndex::GetNextGenerationSignature() const
+{
+    if (nHeight <= 1)
+        return uint256();
+
+    CGenerationSignatureCache& cache = GetGenerationSignatureCache();
+    LOCK(cache.cs);
+
+    // Walk back to the nearest ancestor with a known next generation signature
+    std::vector<const CBlockIndex*> vPath;
+    uint256 signature;
+    for (const CBlockIndex* pindex = this; pindex && pindex->nHeight > 1; pindex = pindex->pprev) {
+        if (pindex->fGenerationSignatureCached) {
+            auto it = cache.mapSignatures.find(pindex);
+            if (it != cache.mapSignatures.end()) {
+                signature = it->second;
+                break;
+            }
+        }
+        vPath.push_back(pindex);
+    }
+
+    // Derive forward
+    for (auto it = vPath.rbegin(); it != vPath.rend(); ++it) {
+        const uint64_t plotterId = htobe64((*it)->nPlotterId);
         CShabal256()
-            .Write(generationSignature->begin(), generationSignature->size())
+            .Write(signature.begin(), signature.size())
             .Write((const unsigned char*)&plotterId, 8)
-            .Finalize(nextGenerationSignature.begin());
+            .Finalize(signature.begin());
+        cache.Insert(*it, signature);
     }
+    return signature;
+}
+
+void CBlockIndex::SetNextGenerationSignature(const uint256& signature) const
+{
+    CGenerationSignatureCache& cache = GetGenerationSignatureCache();
+    LOCK(cache.cs);
+    cache.mapSignatures[this] = signature;
+    fGenerationSignatureCached = true;
 }
 
 void CBlockIndex::BuildSkip()
@@ -176,6 +295,14 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
+void CBlockIndex::BuildEpoch(int nEpochBlocks)
+{
+    if (nEpochBlocks <= 0 || nHeight % nEpochBlocks == 0)
+        pepoch = this;
+    else if (pprev)
+        pepoch = pprev->pepoch;
+}
+
 arith_uint256 GetBlockProof(const CBlockHeader& header, const Consensus::Params& params)
 {
     //! Same nBaseTarget select biggest hash
@@ -185,7 +312,8 @@ arith_uint256 GetBlockProof(const CBlockHeader& header, const Consensus::Params&
 arith_uint256 GetBlockProof(const CBlockIndex& block, const Consensus::Params& params)
 {
     //! Same nBaseTarget select biggest hash
-    return (poc::TWO64 / block.nBaseTarget) * 100 + (block.vchSignature.empty() ? 0 : block.vchSignature.back()) % 100;
+    const auto& vchSignature = block.GetSignature();
+    return (poc::TWO64 / block.nBaseTarget) * 100 + (vchSignature.empty() ? 0 : vchSignature.back()) % 100;
 }
 
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params& params)
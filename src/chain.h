@@ -13,6 +13,7 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <memory>
 #include <vector>
 
 /**
@@ -37,6 +38,16 @@ static constexpr int64_t TIMESTAMP_WINDOW = 2 * 60 * 60;
  */
 static constexpr int64_t MAX_BLOCK_TIME_GAP = 90 * 60;
 
+/**
+ * Next generation signatures are kept permanently only for block index
+ * entries at heights multiple of this interval. Others are derived from the
+ * nearest cached ancestor.
+ */
+static constexpr int GENERATION_SIGNATURE_CHECKPOINT_INTERVAL = 1024;
+
+/** Number of recently derived next generation signatures kept besides the checkpoints. */
+static constexpr size_t MAX_RECENT_GENERATION_SIGNATURES = 4096;
+
 class CBlockFileInfo
 {
 public:
@@ -133,6 +144,13 @@ enum BlockStatus: uint32_t {
     BLOCK_HAVE_POS          =   256, //!< include PoS data
 };
 
+/** Block signature of a CBlockIndex. Held out of line, as it is only read when the header is served or written */
+struct CBlockIndexSignature
+{
+    BlockPubKeyBytes vchPubKey;
+    BlockSignatureBytes vchSignature;
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -150,6 +168,9 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    //! (memory only) pointer to the index of the first block of the Saturn epoch of this block, see BuildEpoch()
+    CBlockIndex* pepoch;
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -177,8 +198,11 @@ public:
     //! Verification status of this block. See enum BlockStatus
     uint32_t nStatus;
 
-    //! The miner reward output
+    //! The miner reward output. Like the header fields, it stays in the block index when the block
+    //! data is pruned, so capacity, epoch and reward lookups never read blocks from disk
     CTxOut minerRewardTxOut;
+    //! (memory only) Account of the miner reward output, see SetMinerRewardTxOut()
+    CAccountID generatorAccountID;
 
     //! block header
     int32_t nVersion;
@@ -187,9 +211,10 @@ public:
     uint64_t nBaseTarget;
     uint64_t nNonce;
     uint64_t nPlotterId;
-    CChiaProofOfSpace pos;
-    std::vector<unsigned char> vchPubKey;
-    std::vector<unsigned char> vchSignature;
+    //! PoS data, see GetPos(). Only held in memory until the entry is written to the block tree DB
+    mutable std::shared_ptr<const CChiaProofOfSpace> ppos;
+    //! Block signature, see GetPubKey() and GetSignature(). Null if the block has none
+    std::shared_ptr<const CBlockIndexSignature> psignature;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
@@ -197,18 +222,15 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax;
 
-    //! (memory only) Generation signature. Reference previous nextGenerationSignature.
-    uint256 *generationSignature;
-
-    //! (memory only) Generation signature. From current block data.
-    //! Generate next block required this value.
-    uint256 nextGenerationSignature;
+    //! (memory only) Next generation signature of this entry is held by the generation signature cache.
+    mutable bool fGenerationSignatureCached;
 
     void SetNull()
     {
         phashBlock = nullptr;
         pprev = nullptr;
         pskip = nullptr;
+        pepoch = nullptr;
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -218,10 +240,10 @@ public:
         nChainTx = 0;
         nStatus = 0;
         minerRewardTxOut.SetNull();
+        generatorAccountID.SetNull();
         nSequenceId = 0;
         nTimeMax = 0;
-        generationSignature = nullptr;
-        nextGenerationSignature.SetNull();
+        fGenerationSignatureCached = false;
 
         nVersion       = 0;
         hashMerkleRoot = uint256();
@@ -229,9 +251,8 @@ public:
         nBaseTarget    = 0;
         nNonce         = 0;
         nPlotterId     = 0;
-        pos.SetNull();
-        vchPubKey.clear();
-        vchSignature.clear();
+        ppos.reset();
+        psignature.reset();
     }
 
     CBlockIndex()
@@ -249,11 +270,13 @@ public:
         nBaseTarget    = block.nBaseTarget;
         nNonce         = block.nNonce;
         nPlotterId     = block.nPlotterId;
-        pos            = block.pos;
-        vchPubKey      = block.vchPubKey;
-        vchSignature   = block.vchSignature;
+        if (!block.pos.IsNull())
+            ppos       = std::make_shared<const CChiaProofOfSpace>(block.pos);
+        SetSignature(block.vchPubKey, block.vchSignature);
     }
 
+    ~CBlockIndex();
+
     FlatFilePos GetBlockPos() const {
         FlatFilePos ret;
         if (nStatus & BLOCK_HAVE_DATA) {
@@ -283,12 +306,28 @@ public:
         block.nBaseTarget    = nBaseTarget;
         block.nNonce         = nNonce;
         block.nPlotterId     = nPlotterId;
-        block.pos            = pos;
-        block.vchPubKey      = vchPubKey;
-        block.vchSignature   = vchSignature;
+        block.pos            = GetPos();
+        block.vchPubKey      = GetPubKey();
+        block.vchSignature   = GetSignature();
         return block;
     }
 
+    const BlockPubKeyBytes& GetPubKey() const;
+    const BlockSignatureBytes& GetSignature() const;
+    void SetSignature(const BlockPubKeyBytes& vchPubKey, const BlockSignatureBytes& vchSignature);
+
+    //! Set the miner reward output and the generator account derived from it
+    void SetMinerRewardTxOut(CTxOut txOut);
+
+    //! PoS data of the block, read from the block tree DB when it is not held in memory
+    CChiaProofOfSpace GetPos() const;
+
+    //! Release the PoS data held in memory, once the entry is written to the block tree DB
+    void UncachePos() const
+    {
+        std::atomic_store(&ppos, std::shared_ptr<const CChiaProofOfSpace>());
+    }
+
     uint256 GetBlockHash() const
     {
         return *phashBlock;
@@ -363,23 +402,25 @@ public:
     //! Build the skiplist pointer for this entry.
     void BuildSkip();
 
+    //! Build the epoch pointer for this entry, after that of the predecessor.
+    void BuildEpoch(int nEpochBlocks);
+
     //! Efficiently find an ancestor of this block.
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
 
-    //! Update block index
-    void Update(const Consensus::Params& params);
-
-    const uint256& GetGenerationSignature() const
+    //! Generation signature of this block, the next generation signature of the previous block.
+    uint256 GetGenerationSignature() const
     {
-        assert(generationSignature);
-        return *generationSignature;
+        return pprev ? pprev->GetNextGenerationSignature() : uint256();
     }
 
-    const uint256& GetNextGenerationSignature() const
-    {
-        return nextGenerationSignature;
-    }
+    //! Generation signature of the next block. Derived on demand from the nearest
+    //! cached ancestor, see GENERATION_SIGNATURE_CHECKPOINT_INTERVAL.
+    uint256 GetNextGenerationSignature() const;
+
+    //! Override the derived next generation signature. Only for entries without a parent chain.
+    void SetNextGenerationSignature(const uint256& signature) const;
 };
 
 arith_uint256 GetBlockProof(const CBlockHeader& header, const Consensus::Params&);
@@ -389,12 +430,46 @@ int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& fr
 /** Find the forking point between two chain tips. */
 const CBlockIndex* LastCommonAncestor(const CBlockIndex* pa, const CBlockIndex* pb);
 
+/**
+ * Allocates block index entries in chunks, instead of one heap allocation per entry. Entries
+ * created one after another, like the whole index loaded in height order at startup, are
+ * contiguous, which keeps walks over pprev and pskip within a few pages. Entries are owned by
+ * the arena and only destroyed all at once by Clear().
+ */
+class CBlockIndexArena
+{
+private:
+    //! Entries per chunk, the capacity of each chunk is reserved so that entries never move
+    static const size_t CHUNK_SIZE = 4096;
+
+    std::vector<std::vector<CBlockIndex>> m_chunks;
+
+public:
+    template<typename... Args>
+    CBlockIndex* Create(Args&&... args)
+    {
+        if (m_chunks.empty() || m_chunks.back().size() == CHUNK_SIZE) {
+            m_chunks.emplace_back();
+            m_chunks.back().reserve(CHUNK_SIZE);
+        }
+        m_chunks.back().emplace_back(std::forward<Args>(args)...);
+        return &m_chunks.back().back();
+    }
+
+    void Clear() { m_chunks.clear(); }
+
+    size_t DynamicMemoryUsage() const { return m_chunks.size() * CHUNK_SIZE * sizeof(CBlockIndex); }
+};
+
 
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex
 {
 public:
     uint256 hashPrev;
+    CChiaProofOfSpace pos;
+    BlockPubKeyBytes vchPubKey;
+    BlockSignatureBytes vchSignature;
 
     CDiskBlockIndex() {
         hashPrev = uint256();
@@ -402,6 +477,9 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        pos = pindex->GetPos();
+        vchPubKey = pindex->GetPubKey();
+        vchSignature = pindex->GetSignature();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -22,7 +22,7 @@ CCoinsViewCursorRef CCoinsView::PointSendCursor(const CAccountID &accountID) con
 CCoinsViewCursorRef CCoinsView::PointReceiveCursor(const CAccountID &accountID) const { return nullptr; }
 CCoinsViewCursorRef CCoinsView::StakingSendCursor(const CAccountID &accountID) const { return nullptr; }
 CCoinsViewCursorRef CCoinsView::StakingReceiveCursor(const CAccountID &accountID) const { return nullptr; }
-CAmount CCoinsView::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins) const {
+CAmount CCoinsView::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const {
     if (balanceBindPlotter != nullptr) *balanceBindPlotter = 0;
     if (balancePoint != nullptr) {
         balancePoint[0] = 0;
@@ -36,8 +36,10 @@ CAmount CCoinsView::GetAccountBalance(const CAccountID &accountID, CAmount *bala
 }
 CBindPlotterCoinsMap CCoinsView::GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId) const { return {}; }
 CBindPlotterCoinsMap CCoinsView::GetBindPlotterEntries(const uint64_t &plotterId) const { return {}; }
-CAccountBalanceList CCoinsView::GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins) const { return {}; }
+bool CCoinsView::GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded) const { return false; }
+CAccountBalanceList CCoinsView::GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins) const { return {}; }
 CStakingPoolList CCoinsView::GetStakingPools(const uint256 &epochHash) const { return {}; }
+bool CCoinsView::GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const { return false; }
 CStakingPoolUserList CCoinsView::GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const { return {}; }
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const {
     Coin coin;
@@ -58,8 +60,8 @@ CCoinsViewCursorRef CCoinsViewBacked::PointReceiveCursor(const CAccountID &accou
 CCoinsViewCursorRef CCoinsViewBacked::StakingSendCursor(const CAccountID &accountID) const { return base->StakingSendCursor(accountID); }
 CCoinsViewCursorRef CCoinsViewBacked::StakingReceiveCursor(const CAccountID &accountID) const { return base->StakingReceiveCursor(accountID); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
-CAmount CCoinsViewBacked::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins) const {
-    return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, mapModifiedCoins);
+CAmount CCoinsViewBacked::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const {
+    return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, modifiedCoins);
 }
 CBindPlotterCoinsMap CCoinsViewBacked::GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId) const {
     return base->GetAccountBindPlotterEntries(accountID, plotterId);
@@ -67,28 +69,56 @@ CBindPlotterCoinsMap CCoinsViewBacked::GetAccountBindPlotterEntries(const CAccou
 CBindPlotterCoinsMap CCoinsViewBacked::GetBindPlotterEntries(const uint64_t &plotterId) const {
     return base->GetBindPlotterEntries(plotterId);
 }
-CAccountBalanceList CCoinsViewBacked::GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins) const {
-    return base->GetTopStakingAccounts(n, mapModifiedCoins);
+bool CCoinsViewBacked::GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded) const {
+    return base->GetLastBindPlotterEntry(plotterId, entry, excluded);
+}
+CAccountBalanceList CCoinsViewBacked::GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins) const {
+    return base->GetTopStakingAccounts(n, modifiedCoins);
 }
 CStakingPoolList CCoinsViewBacked::GetStakingPools(const uint256 &epochHash) const {
     return base->GetStakingPools(epochHash);
 }
+bool CCoinsViewBacked::GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const {
+    return base->GetStakingPool(epochHash, poolID, pool);
+}
 CStakingPoolUserList CCoinsViewBacked::GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const {
     return base->GetStakingPoolUsers(epochHash, poolID);
 }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn),
+    cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return memusage::DynamicUsage(cacheCoins) + memusage::DynamicUsage(cacheBindPlotterOutpoints) + memusage::DynamicUsage(cacheStakingOutpoints) +
+        memusage::DynamicUsage(cacheAccountOutpoints) + cachedCoinsUsage;
+}
+
+void CCoinsViewCache::IndexModifiedCoin(const COutPoint &outpoint, const Coin &coin) const {
+    if (coin.IsBindPlotter()) {
+        cacheBindPlotterOutpoints.insert(outpoint);
+    } else if (coin.IsStaking()) {
+        cacheStakingOutpoints.insert(outpoint);
+    }
+
+    if (!coin.GetAccountID().IsNull()) {
+        cacheAccountOutpoints.emplace(coin.GetAccountID(), outpoint);
+        if (coin.IsPoint()) {
+            cacheAccountOutpoints.emplace(PointPayload::As(coin.GetPayload())->GetReceiverID(), outpoint);
+        } else if (coin.IsStaking()) {
+            cacheAccountOutpoints.emplace(StakingPayload::As(coin.GetPayload())->GetReceiverID(), outpoint);
+        }
+    }
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
     CCoinsMap::iterator it = cacheCoins.find(outpoint);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        cacheHits.store(cacheHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
         return it;
+    }
+    cacheMisses.store(cacheMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
@@ -120,6 +150,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     bool fresh = false;
     if (!inserted) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+        IndexModifiedCoin(outpoint, it->second.coin);
     }
     if (!possible_overwrite) {
         if (!it->second.coin.IsSpent()) {
@@ -129,17 +160,21 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     }
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
+    IndexModifiedCoin(outpoint, it->second.coin);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
-void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check) {
+void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check, bool verified_payloads) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
     for (size_t i = 0; i < tx.vout.size(); ++i) {
         bool overwrite = check ? cache.HaveCoin(COutPoint(txid, i)) : fCoinbase;
+        Coin coin(tx.vout[i], nHeight, fCoinbase);
+        if (verified_payloads)
+            coin.DecodeVerified();
         // Always set the possible_overwrite flag to AddCoin for coinbase txn, in order to correctly
         // deal with the pre-BIP30 occurrences of duplicate coinbase transactions.
-        cache.AddCoin(COutPoint(txid, i), Coin(tx.vout[i], nHeight, fCoinbase), overwrite);
+        cache.AddCoin(COutPoint(txid, i), std::move(coin), overwrite);
     }
 }
 
@@ -156,6 +191,7 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
         cacheCoins.erase(it);
     } else {
         it->second.flags |= CCoinsCacheEntry::DIRTY;
+        IndexModifiedCoin(outpoint, it->second.coin);
         it->second.coin.Clear();
     }
     return true;
@@ -209,6 +245,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 entry.coin = std::move(it->second.coin);
                 cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
                 entry.flags = CCoinsCacheEntry::DIRTY;
+                IndexModifiedCoin(it->first, entry.coin);
                 // We can mark it FRESH in the parent if it was FRESH in the child
                 // Otherwise it might have just been flushed from the parent's cache
                 // and already exist in the grandparent
@@ -235,6 +272,8 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
             } else {
                 // A normal modification.
                 cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
+                IndexModifiedCoin(it->first, itUs->second.coin);
+                IndexModifiedCoin(it->first, it->second.coin);
                 itUs->second.coin = std::move(it->second.coin);
                 cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
                 itUs->second.flags |= CCoinsCacheEntry::DIRTY;
@@ -250,87 +289,20 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
     return true;
 }
 
-CAmount CCoinsViewCache::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins) const
+CAmount CCoinsViewCache::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const
 {
-    if (cacheCoins.empty()) {
-        return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, mapModifiedCoins);
-    } else if (mapModifiedCoins.empty()) {
-        return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, cacheCoins);
-    } else {
-        CCoinsMap mapCoinsMerged;
-        // Copy mine relative coins
-        for (CCoinsMap::const_iterator it = cacheCoins.cbegin(); it != cacheCoins.cend(); it++) {
-            if (it->second.coin.outAccountID != accountID &&
-                (!it->second.coin.IsPoint() || PointPayload::As(it->second.coin.payload)->GetReceiverID() != accountID) &&
-                (!it->second.coin.IsStaking() || StakingPayload::As(it->second.coin.payload)->GetReceiverID() != accountID)) {
-                // NOT mine and NOT debit to me
-                continue;
-            }
-            mapCoinsMerged[it->first] = it->second;
-        }
-        if (mapCoinsMerged.empty()) {
-            return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, mapModifiedCoins);
-        } else {
-            // Merge child and mine coins
-            // See CCoinsViewCache::BatchWrite()
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                // Ignore non-dirty entries (optimization).
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
-                    continue;
-                }
-                if (it->second.coin.outAccountID != accountID &&
-                    (!it->second.coin.IsPoint() || PointPayload::As(it->second.coin.payload)->GetReceiverID() != accountID) &&
-                    (!it->second.coin.IsStaking() || StakingPayload::As(it->second.coin.payload)->GetReceiverID() != accountID)) {
-                    // NOT mine and NOT debit to me
-                    continue;
-                }
-                CCoinsMap::iterator itUs = mapCoinsMerged.find(it->first);
-                if (itUs == mapCoinsMerged.end()) {
-                    // The parent cache does not have an entry, while the child does
-                    // We can ignore it if it's both FRESH and pruned in the child
-                    if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent())) {
-                        // Otherwise we will need to create it in the parent
-                        // and move the data up and mark it as dirty
-                        CCoinsCacheEntry& entry = mapCoinsMerged[it->first];
-                        entry.coin = it->second.coin;
-                        entry.flags = CCoinsCacheEntry::DIRTY;
-                        // We can mark it FRESH in the parent if it was FRESH in the child
-                        // Otherwise it might have just been flushed from the parent's cache
-                        // and already exist in the grandparent
-                        if (it->second.flags & CCoinsCacheEntry::FRESH) {
-                            entry.flags |= CCoinsCacheEntry::FRESH;
-                        }
-                    }
-                } else {
-                    // Assert that the child cache entry was not marked FRESH if the
-                    // parent cache entry has unspent outputs. If this ever happens,
-                    // it means the FRESH flag was misapplied and there is a logic
-                    // error in the calling code.
-                    if ((it->second.flags & CCoinsCacheEntry::FRESH) && !itUs->second.coin.IsSpent()) {
-                        throw std::logic_error("FRESH flag misapplied to cache entry for base transaction with spendable outputs");
-                    }
-
-                    // Found the entry in the parent cache
-                    if ((itUs->second.flags & CCoinsCacheEntry::FRESH) && it->second.coin.IsSpent()) {
-                        // The grandparent does not have an entry, and the child is
-                        // modified and being pruned. This means we can just delete
-                        // it from the parent.
-                        mapCoinsMerged.erase(itUs);
-                    } else {
-                        // A normal modification.
-                        itUs->second.coin = it->second.coin;
-                        itUs->second.flags |= CCoinsCacheEntry::DIRTY;
-                        // NOTE: It is possible the child has a FRESH flag here in
-                        // the event the entry we found in the parent is pruned. But
-                        // we must not copy that FRESH flag to the parent as that
-                        // pruned state likely still needs to be communicated to the
-                        // grandparent.
-                    }
-                }
-            }
-            return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, mapCoinsMerged);
-        }
+    // Reference mine modified relative coins
+    CCoinsModifiedChain::Entries entries;
+    for (auto itIndex = cacheAccountOutpoints.lower_bound(std::make_pair(accountID, COutPoint(uint256(), 0)));
+            itIndex != cacheAccountOutpoints.end() && itIndex->first == accountID; itIndex++) {
+        CCoinsMap::const_iterator it = cacheCoins.find(itIndex->second);
+        if (it != cacheCoins.cend() && (it->second.flags & CCoinsCacheEntry::DIRTY))
+            entries.push_back(it);
     }
+
+    if (entries.empty())
+        return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, modifiedCoins);
+    return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, CCoinsModifiedChain(cacheCoins, entries, modifiedCoins));
 }
 
 CBindPlotterCoinsMap CCoinsViewCache::GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId) const {
@@ -338,30 +310,31 @@ CBindPlotterCoinsMap CCoinsViewCache::GetAccountBindPlotterEntries(const CAccoun
     CBindPlotterCoinsMap outpoints = base->GetAccountBindPlotterEntries(accountID, plotterId);
 
     // Apply modified
-    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
-        if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
+    for (const COutPoint& outpoint : cacheBindPlotterOutpoints) {
+        CCoinsMap::iterator it = cacheCoins.find(outpoint);
+        if (it == cacheCoins.end() || !(it->second.flags & CCoinsCacheEntry::DIRTY))
             continue;
 
-        if (accountID != it->second.coin.outAccountID || !it->second.coin.IsBindPlotter()) {
+        if (accountID != it->second.coin.GetAccountID() || !it->second.coin.IsBindPlotter()) {
             outpoints.erase(it->first);
             continue;
         }
 
         auto itSelected = outpoints.find(it->first);
         if (itSelected != outpoints.end()) {
-            if (!it->second.coin.IsSpent() && (plotterId == 0 || plotterId == BindPlotterPayload::As(it->second.coin.payload)->GetId())) {
+            if (!it->second.coin.IsSpent() && (plotterId == 0 || plotterId == BindPlotterPayload::As(it->second.coin.GetPayload())->GetId())) {
                 itSelected->second.nHeight = it->second.coin.nHeight;
-                itSelected->second.accountID = it->second.coin.outAccountID;
-                itSelected->second.plotterId = BindPlotterPayload::As(it->second.coin.payload)->GetId();
+                itSelected->second.accountID = it->second.coin.GetAccountID();
+                itSelected->second.plotterId = BindPlotterPayload::As(it->second.coin.GetPayload())->GetId();
             } else {
                 outpoints.erase(itSelected);
             }
         } else {
-            if (!it->second.coin.IsSpent() && (plotterId == 0 || plotterId == BindPlotterPayload::As(it->second.coin.payload)->GetId())) {
+            if (!it->second.coin.IsSpent() && (plotterId == 0 || plotterId == BindPlotterPayload::As(it->second.coin.GetPayload())->GetId())) {
                 CBindPlotterCoinInfo &info = outpoints[it->first];
                 info.nHeight = it->second.coin.nHeight;
-                info.accountID = it->second.coin.outAccountID;
-                info.plotterId = BindPlotterPayload::As(it->second.coin.payload)->GetId();
+                info.accountID = it->second.coin.GetAccountID();
+                info.plotterId = BindPlotterPayload::As(it->second.coin.GetPayload())->GetId();
             }
         }
     }
@@ -374,8 +347,9 @@ CBindPlotterCoinsMap CCoinsViewCache::GetBindPlotterEntries(const uint64_t &plot
     CBindPlotterCoinsMap outpoints = base->GetBindPlotterEntries(plotterId);
 
     // Apply modified
-    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
-        if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
+    for (const COutPoint& outpoint : cacheBindPlotterOutpoints) {
+        CCoinsMap::iterator it = cacheCoins.find(outpoint);
+        if (it == cacheCoins.end() || !(it->second.flags & CCoinsCacheEntry::DIRTY))
             continue;
 
         if (!it->second.coin.IsBindPlotter()) {
@@ -385,19 +359,19 @@ CBindPlotterCoinsMap CCoinsViewCache::GetBindPlotterEntries(const uint64_t &plot
 
         auto itSelected = outpoints.find(it->first);
         if (itSelected != outpoints.end()) {
-            if (!it->second.coin.IsSpent() && plotterId == BindPlotterPayload::As(it->second.coin.payload)->GetId()) {
+            if (!it->second.coin.IsSpent() && plotterId == BindPlotterPayload::As(it->second.coin.GetPayload())->GetId()) {
                 itSelected->second.nHeight = it->second.coin.nHeight;
-                itSelected->second.accountID = it->second.coin.outAccountID;
-                itSelected->second.plotterId = BindPlotterPayload::As(it->second.coin.payload)->GetId();
+                itSelected->second.accountID = it->second.coin.GetAccountID();
+                itSelected->second.plotterId = BindPlotterPayload::As(it->second.coin.GetPayload())->GetId();
             } else {
                 outpoints.erase(itSelected);
             }
         } else {
-            if (!it->second.coin.IsSpent() && plotterId == BindPlotterPayload::As(it->second.coin.payload)->GetId()) {
+            if (!it->second.coin.IsSpent() && plotterId == BindPlotterPayload::As(it->second.coin.GetPayload())->GetId()) {
                 CBindPlotterCoinInfo &info = outpoints[it->first];
                 info.nHeight = it->second.coin.nHeight;
-                info.accountID = it->second.coin.outAccountID;
-                info.plotterId = BindPlotterPayload::As(it->second.coin.payload)->GetId();
+                info.accountID = it->second.coin.GetAccountID();
+                info.plotterId = BindPlotterPayload::As(it->second.coin.GetPayload())->GetId();
             }
         }
     }
@@ -405,60 +379,61 @@ CBindPlotterCoinsMap CCoinsViewCache::GetBindPlotterEntries(const uint64_t &plot
     return outpoints;
 }
 
-CAccountBalanceList CCoinsViewCache::GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins) const {
-    assert(n > 0);
-    if (cacheCoins.empty()) {
-        return base->GetTopStakingAccounts(n, mapModifiedCoins);
-    } else if (mapModifiedCoins.empty()) {
-        return base->GetTopStakingAccounts(n, cacheCoins);
-    } else {
-        CCoinsMap mapCoinsMerged;
-        // Copy mine relative coins
-        for (CCoinsMap::const_iterator it = cacheCoins.cbegin(); it != cacheCoins.cend(); it++) {
-            if (!it->second.coin.IsStaking() ) {
-                // NOT staking
-                continue;
-            }
-            mapCoinsMerged[it->first] = it->second;
+bool CCoinsViewCache::GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded) const {
+    // Modified coins override base view
+    std::set<COutPoint> excludedMerged = excluded;
+    bool found = false;
+    for (const COutPoint& outpoint : cacheBindPlotterOutpoints) {
+        CCoinsMap::iterator it = cacheCoins.find(outpoint);
+        if (it == cacheCoins.end() || !(it->second.flags & CCoinsCacheEntry::DIRTY) || excluded.count(it->first))
+            continue;
+
+        if (!it->second.coin.IsBindPlotter()) {
+            excludedMerged.insert(it->first);
+            continue;
         }
-        if (mapCoinsMerged.empty()) {
-            return base->GetTopStakingAccounts(n, mapModifiedCoins);
-        } else {
-            // Merge child and mine coins
-            // See CCoinsViewCache::BatchWrite()
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
-                    continue;
-                }
-                if (!it->second.coin.IsStaking()) {
-                    // NOT staking
-                    continue;
-                }
-                CCoinsMap::iterator itUs = mapCoinsMerged.find(it->first);
-                if (itUs == mapCoinsMerged.end()) {
-                    if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent())) {
-                        CCoinsCacheEntry& entry = mapCoinsMerged[it->first];
-                        entry.coin = it->second.coin;
-                        entry.flags = CCoinsCacheEntry::DIRTY;
-                        if (it->second.flags & CCoinsCacheEntry::FRESH) {
-                            entry.flags |= CCoinsCacheEntry::FRESH;
-                        }
-                    }
-                } else {
-                    if ((it->second.flags & CCoinsCacheEntry::FRESH) && !itUs->second.coin.IsSpent()) {
-                        throw std::logic_error("FRESH flag misapplied to cache entry for base transaction with spendable outputs");
-                    }
-                    if ((itUs->second.flags & CCoinsCacheEntry::FRESH) && it->second.coin.IsSpent()) {
-                        mapCoinsMerged.erase(itUs);
-                    } else {
-                        itUs->second.coin = it->second.coin;
-                        itUs->second.flags |= CCoinsCacheEntry::DIRTY;
-                    }
-                }
-            }
-            return base->GetTopStakingAccounts(n, mapCoinsMerged);
+        if (plotterId != BindPlotterPayload::As(it->second.coin.GetPayload())->GetId())
+            continue;
+
+        excludedMerged.insert(it->first);
+        if (!it->second.coin.IsSpent() && (!found ||
+                (entry.second.nHeight < (int) it->second.coin.nHeight) ||
+                (entry.second.nHeight == (int) it->second.coin.nHeight && entry.first < it->first))) {
+            entry.first = it->first;
+            entry.second.nHeight = it->second.coin.nHeight;
+            entry.second.accountID = it->second.coin.GetAccountID();
+            entry.second.plotterId = plotterId;
+            found = true;
         }
     }
+
+    // From base view
+    CBindPlotterCoinPair baseEntry;
+    if (base->GetLastBindPlotterEntry(plotterId, baseEntry, excludedMerged)) {
+        if (!found ||
+                (entry.second.nHeight < baseEntry.second.nHeight) ||
+                (entry.second.nHeight == baseEntry.second.nHeight && entry.first < baseEntry.first)) {
+            entry = baseEntry;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+CAccountBalanceList CCoinsViewCache::GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins) const {
+    assert(n > 0);
+    // Reference mine modified staking coins
+    CCoinsModifiedChain::Entries entries;
+    for (const COutPoint& outpoint : cacheStakingOutpoints) {
+        CCoinsMap::const_iterator it = cacheCoins.find(outpoint);
+        if (it != cacheCoins.cend() && (it->second.flags & CCoinsCacheEntry::DIRTY) && it->second.coin.IsStaking())
+            entries.push_back(it);
+    }
+
+    if (entries.empty())
+        return base->GetTopStakingAccounts(n, modifiedCoins);
+    return base->GetTopStakingAccounts(n, CCoinsModifiedChain(cacheCoins, entries, modifiedCoins));
 }
 
 CBindPlotterInfo CCoinsViewCache::GetChangeBindPlotterInfo(const CBindPlotterInfo &sourceBindInfo) const
@@ -483,16 +458,12 @@ CBindPlotterInfo CCoinsViewCache::GetChangeBindPlotterInfo(const CBindPlotterInf
 
 CBindPlotterInfo CCoinsViewCache::GetLastBindPlotterInfo(const uint64_t &plotterId) const
 {
-    CBindPlotterInfo lastBindInfo;
-    for (const auto& pair : GetBindPlotterEntries(plotterId)) {
-        assert(pair.second.plotterId == plotterId);
-        if (lastBindInfo.outpoint.IsNull() ||
-                (lastBindInfo.nHeight < pair.second.nHeight) ||
-                (lastBindInfo.nHeight == pair.second.nHeight && lastBindInfo.outpoint < pair.first))
-            lastBindInfo = CBindPlotterInfo(pair);
-    }
-    
-    return lastBindInfo;
+    CBindPlotterCoinPair entry;
+    if (!GetLastBindPlotterEntry(plotterId, entry))
+        return CBindPlotterInfo();
+
+    assert(entry.second.plotterId == plotterId);
+    return CBindPlotterInfo(entry);
 }
 
 const Coin& CCoinsViewCache::GetLastBindPlotterCoin(const uint64_t &plotterId, COutPoint *outpoint) const {
@@ -524,10 +495,24 @@ CAmount CCoinsViewCache::GetAccountPointReceivedBalance(const CAccountID &accoun
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
     cacheCoins.clear();
+    cacheBindPlotterOutpoints.clear();
+    cacheStakingOutpoints.clear();
+    cacheAccountOutpoints.clear();
     cachedCoinsUsage = 0;
+    ReallocateCache();
     return fOk;
 }
 
+void CCoinsViewCache::ReallocateCache()
+{
+    // Cache should be empty when we're calling this.
+    assert(cacheCoins.size() == 0);
+    cacheCoins.~CCoinsMap();
+    m_cache_coins_memory_resource.~CCoinsMapMemoryResource();
+    ::new (&m_cache_coins_memory_resource) CCoinsMapMemoryResource();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &m_cache_coins_memory_resource);
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -537,6 +522,21 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
     }
 }
 
+void CCoinsViewCache::AddFetchedCoins(std::vector<std::pair<COutPoint, Coin>>&& coins)
+{
+    for (auto& entry : coins) {
+        assert(!entry.second.IsSpent());
+        CCoinsMap::iterator it;
+        bool inserted;
+        std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(entry.first), std::forward_as_tuple(std::move(entry.second)));
+        if (inserted) {
+            // Counted as the miss it would have been
+            cacheMisses.store(cacheMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+        }
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
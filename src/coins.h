@@ -13,15 +13,18 @@
 #include <memusage.h>
 #include <script/standard.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 /**
  * A UTXO entry.
@@ -42,12 +45,25 @@ public:
     //! at which height this containing transaction was included in the active block chain
     uint32_t nHeight : 30;
 
-    //! memory only. Ref from out
-    CAccountID outAccountID;
+private:
+    //! memory only. Whether outAccountID and payload were decoded from out. Packed with nHeight
+    mutable uint32_t fDecoded : 1;
+
+    //! memory only. Ref from out, decoded on first use
+    mutable CAccountID outAccountID;
+
+    //! memory only. Ref from out, decoded on first use. Null for plain outputs
+    mutable CTxOutPayloadRef payload;
 
-    //! memory only. Ref from out
-    CTxOutPayloadRef payload;
+    void Decode() const {
+        if (!fDecoded) {
+            outAccountID = ExtractAccountID(out.scriptPubKey);
+            payload = ExtractTxoutPayload(out, nHeight);
+            fDecoded = true;
+        }
+    }
 
+public:
     //! construct a Coin from a CTxOut and height/coinbase information.
     Coin(CTxOut&& outIn, int nHeightIn, bool fCoinBaseIn) : out(std::move(outIn)), fCoinBase(fCoinBaseIn), nHeight(nHeightIn) {
         OnUpdated();
@@ -56,19 +72,42 @@ public:
         OnUpdated();
     }
     //! empty constructor
-    Coin() : fCoinBase(false), nHeight(0) {}
+    Coin() : fCoinBase(false), nHeight(0), fDecoded(true) {}
 
     void Clear() {
+        // Spent coins keep the account and payload, which are needed to erase their index entries
+        Decode();
         out.scriptPubKey.clear();
     }
 
     bool IsCoinBase() const {
         return fCoinBase;
     }
-    
+
+    //! Drop the account and payload decoded from out. Call after out or nHeight changed
     void OnUpdated() {
-        outAccountID = ExtractAccountID(out.scriptPubKey);
-        payload = ExtractTxoutPayload(out, nHeight);
+        outAccountID.SetNull();
+        payload = nullptr;
+        fDecoded = false;
+    }
+
+    const CAccountID& GetAccountID() const {
+        Decode();
+        return outAccountID;
+    }
+
+    const CTxOutPayloadRef& GetPayload() const {
+        Decode();
+        return payload;
+    }
+
+    //! Decode out now, without the signature checks of a bind plotter payload that was verified before
+    void DecodeVerified() const {
+        if (!fDecoded) {
+            outAccountID = ExtractAccountID(out.scriptPubKey);
+            payload = ExtractTxoutPayload(out, nHeight, {}, false, nullptr, false);
+            fDecoded = true;
+        }
     }
 
     template<typename Stream>
@@ -99,19 +138,19 @@ public:
     }
 
     bool IsBindPlotter() const {
-        return payload && payload->type == TXOUT_TYPE_BINDPLOTTER;
+        return GetPayload() && payload->type == TXOUT_TYPE_BINDPLOTTER;
     }
 
     bool IsPoint() const {
-        return payload && payload->type == TXOUT_TYPE_POINT;
+        return GetPayload() && payload->type == TXOUT_TYPE_POINT;
     }
 
     bool IsStaking() const {
-        return payload && payload->type == TXOUT_TYPE_STAKING;
+        return GetPayload() && payload->type == TXOUT_TYPE_STAKING;
     }
 
     TxOutType GetExtraDataType() const {
-        return payload ? payload->type : TXOUT_TYPE_UNKNOWN;
+        return GetPayload() ? payload->type : TXOUT_TYPE_UNKNOWN;
     }
 };
 
@@ -161,7 +200,80 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
+ * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
+ * because it is implementation defined. Most implementations have an overhead of 1 or 2 pointers,
+ * so nodes can be connected in a linked list, and in some cases the hash value is stored as well.
+ * Using an additional sizeof(void*)*4 for MAX_BLOCK_SIZE_BYTES should thus be sufficient so that
+ * all implementations can allocate the nodes from the PoolAllocator.
+ */
+typedef std::unordered_map<COutPoint,
+                           CCoinsCacheEntry,
+                           SaltedOutpointHasher,
+                           std::equal_to<COutPoint>,
+                           PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4> >
+    CCoinsMap;
+
+typedef CCoinsMap::allocator_type::ResourceType CCoinsMapMemoryResource;
+
+/**
+ * Modified coins of the caches stacked above a view, linked from the outermost cache to the innermost one.
+ * Each cache references its own dirty entries relevant to a query, and the effective state is merged lazily
+ * without copying coins: an outpoint modified by several caches yields the entry of the innermost one, as
+ * if the caches were flushed with CCoinsViewCache::BatchWrite().
+ */
+class CCoinsModifiedChain
+{
+public:
+    typedef std::vector<CCoinsMap::const_iterator> Entries;
+
+    CCoinsModifiedChain() : coins(nullptr), entries(nullptr), inner(nullptr) {}
+    CCoinsModifiedChain(const CCoinsMap &coinsIn, const Entries &entriesIn, const CCoinsModifiedChain &innerIn) :
+        coins(&coinsIn), entries(&entriesIn), inner(innerIn.empty() ? nullptr : &innerIn) {}
+
+    bool empty() const { return coins == nullptr; }
+
+    /**
+     * Call fn(outpoint, coin, fFresh) once for each modified outpoint with its effective coin. The coin is
+     * FRESH when the outermost cache modifying it is, see CCoinsViewCache::BatchWrite().
+     */
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const CCoinsModifiedChain* layer = this; layer != nullptr && !layer->empty(); layer = layer->inner) {
+            for (const CCoinsMap::const_iterator& it : *layer->entries) {
+                if (!layer->IsShadowed(it->first))
+                    fn(it->first, it->second.coin, IsFresh(it->first, layer, it->second));
+            }
+        }
+    }
+
+private:
+    const CCoinsMap* coins;
+    const Entries* entries;
+    const CCoinsModifiedChain* inner;
+
+    //! Whether an inner cache also modified the outpoint
+    bool IsShadowed(const COutPoint &outpoint) const {
+        for (const CCoinsModifiedChain* layer = inner; layer != nullptr; layer = layer->inner) {
+            CCoinsMap::const_iterator it = layer->coins->find(outpoint);
+            if (it != layer->coins->cend() && (it->second.flags & CCoinsCacheEntry::DIRTY))
+                return true;
+        }
+        return false;
+    }
+
+    //! Whether the outermost cache modifying the outpoint marked it FRESH
+    bool IsFresh(const COutPoint &outpoint, const CCoinsModifiedChain* layerIn, const CCoinsCacheEntry &entryIn) const {
+        for (const CCoinsModifiedChain* layer = this; layer != layerIn; layer = layer->inner) {
+            CCoinsMap::const_iterator it = layer->coins->find(outpoint);
+            if (it != layer->coins->cend() && (it->second.flags & CCoinsCacheEntry::DIRTY))
+                return it->second.flags & CCoinsCacheEntry::FRESH;
+        }
+        return entryIn.flags & CCoinsCacheEntry::FRESH;
+    }
+};
 
 /** Bind plotter coin information */
 struct CBindPlotterCoinInfo
@@ -172,8 +284,8 @@ struct CBindPlotterCoinInfo
 
     CBindPlotterCoinInfo() : nHeight(-1), accountID(), plotterId(0) {}
     explicit CBindPlotterCoinInfo(const Coin& coin) : nHeight((int)coin.nHeight),
-        accountID(coin.outAccountID),
-        plotterId(BindPlotterPayload::As(coin.payload)->GetId()) {}
+        accountID(coin.GetAccountID()),
+        plotterId(BindPlotterPayload::As(coin.GetPayload())->GetId()) {}
 };
 
 typedef std::map<COutPoint, CBindPlotterCoinInfo> CBindPlotterCoinsMap;
@@ -195,8 +307,8 @@ public:
         plotterId(pair.second.plotterId) {}
     CBindPlotterInfo(const COutPoint &o, const Coin &coin) : outpoint(o),
         nHeight((int)coin.nHeight),
-        accountID(coin.outAccountID),
-        plotterId(BindPlotterPayload::As(coin.payload)->GetId()) {}
+        accountID(coin.GetAccountID()),
+        plotterId(BindPlotterPayload::As(coin.GetPayload())->GetId()) {}
 };
 
 /** Cursor template for iterating over CoinsData state */
@@ -269,7 +381,7 @@ public:
     virtual size_t EstimateSize() const { return 0; }
 
     //! Get balance. Return amount of account. [0] is sent, -1 disabled; [1] is received, -1 disabled;
-    virtual CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins = {}) const;
+    virtual CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins = {}) const;
 
     //! Get account bind plotter all coin entries. if plotterId is 0 then return all coin entries for account.
     virtual CBindPlotterCoinsMap GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId = 0) const;
@@ -277,11 +389,15 @@ public:
     //! Get plotter bind all coin entries.
     virtual CBindPlotterCoinsMap GetBindPlotterEntries(const uint64_t &plotterId) const;
 
+    //! Get plotter lastest bind coin entry, skipping excluded outpoints. Return false if not found.
+    virtual bool GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded = {}) const;
+
     //! Get top staking accounts
-    virtual CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins = {}) const;
+    virtual CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins = {}) const;
 
     //! Get Staking pool info
     virtual CStakingPoolList GetStakingPools(const uint256 &epochHash) const;
+    virtual bool GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const;
     virtual CStakingPoolUserList GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const;
 };
 
@@ -307,11 +423,13 @@ public:
     CCoinsViewCursorRef StakingSendCursor(const CAccountID &accountID) const override;
     CCoinsViewCursorRef StakingReceiveCursor(const CAccountID &accountID) const override;
     size_t EstimateSize() const override;
-    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins = {}) const override;
+    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins = {}) const override;
     CBindPlotterCoinsMap GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId = 0) const override;
     CBindPlotterCoinsMap GetBindPlotterEntries(const uint64_t &plotterId) const override;
-    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins = {}) const override;
+    bool GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded = {}) const override;
+    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins = {}) const override;
     CStakingPoolList GetStakingPools(const uint256 &epochHash) const override;
+    bool GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const override;
     CStakingPoolUserList GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const override;
 };
 
@@ -325,11 +443,29 @@ protected:
      * declared as "const".
      */
     mutable uint256 hashBlock;
+    /* Node pool of cacheCoins. Must be declared before cacheCoins */
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource;
     mutable CCoinsMap cacheCoins;
 
+    /* Outpoints of cacheCoins entries modified with bind plotter coin. Apply modified bind plotter without walking cacheCoins */
+    mutable std::set<COutPoint> cacheBindPlotterOutpoints;
+
+    /* Outpoints of cacheCoins entries modified with staking coin. Apply modified staking without walking cacheCoins */
+    mutable std::set<COutPoint> cacheStakingOutpoints;
+
+    /* <account, outpoint> of cacheCoins entries modified with coin owned by or debit to the account. Apply modified account without walking cacheCoins */
+    mutable std::set<std::pair<CAccountID, COutPoint>> cacheAccountOutpoints;
+
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Lookups found in and missing from cacheCoins. Only written by the thread owning the cache, readable from any thread */
+    mutable std::atomic<uint64_t> cacheHits{0};
+    mutable std::atomic<uint64_t> cacheMisses{0};
+
+    /* Record a modified coin in the account, bind plotter and staking indexes */
+    void IndexModifiedCoin(const COutPoint &outpoint, const Coin &coin) const;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -362,10 +498,11 @@ public:
     CCoinsViewCursorRef StakingReceiveCursor(const CAccountID &accountID) const override {
         throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
     }
-    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins = {}) const override;
+    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins = {}) const override;
     CBindPlotterCoinsMap GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId = 0) const override;
     CBindPlotterCoinsMap GetBindPlotterEntries(const uint64_t &plotterId) const override;
-    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins = {}) const override;
+    bool GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded = {}) const override;
+    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins = {}) const override;
 
     /**
      * Check if we have the given utxo already loaded in this cache.
@@ -406,18 +543,38 @@ public:
      */
     bool Flush();
 
+    /**
+     * Force a reallocation of the cache map. This is required when downsizing
+     * the cache because the map's allocator may be hanging onto a lot of
+     * memory despite having called .clear().
+     *
+     * See: https://stackoverflow.com/questions/42114044/how-to-release-unordered-map-memory
+     */
+    void ReallocateCache();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Add unspent coins read from the base view ahead of their use, such as the
+     * inputs of a block about to be connected. Outpoints already in the cache
+     * are left as they are.
+     */
+    void AddFetchedCoins(std::vector<std::pair<COutPoint, Coin>>&& coins);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Lookups served by the cache and lookups passed on to the base view since construction
+    uint64_t GetCacheHits() const { return cacheHits.load(std::memory_order_relaxed); }
+    uint64_t GetCacheMisses() const { return cacheMisses.load(std::memory_order_relaxed); }
+
     /**
      * Amount of bitcoins coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -457,9 +614,11 @@ private:
 //! When check is false, this assumes that overwrites are only possible for coinbase transactions.
 //! When check is true, the underlying view may be queried to determine whether an addition is
 //! an overwrite.
+//! When verified_payloads is true, the payload signatures of the outputs were verified before and
+//! are not checked again.
 // TODO: pass in a boolean to limit these possible overwrites to known
 // (pre-BIP34) cases.
-void AddCoins(CCoinsViewCache& cache, const CTransaction& tx, int nHeight, bool check = false);
+void AddCoins(CCoinsViewCache& cache, const CTransaction& tx, int nHeight, bool check = false, bool verified_payloads = false);
 
 //! Utility function to find any unspent output with a given txid.
 //! This function can be quite expensive because in the event of a transaction
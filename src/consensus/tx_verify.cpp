@@ -157,11 +157,23 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& i
     return nSigOps;
 }
 
-bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CCoinsViewCache& prevInputs,
-    int nSpendHeight, CAmount& txfee,
+Consensus::SpendEra::SpendEra(int nSpendHeightIn, const Consensus::Params& params) :
+    nSpendHeight(nSpendHeightIn),
+    nSaturnActiveHeight(params.nSaturnActiveHeight),
+    fSaturn(nSpendHeightIn >= params.nSaturnActiveHeight),
+    fMercury(nSpendHeightIn >= params.nMercuryActiveHeight)
+{}
+
+namespace {
+
+template <bool fSaturn>
+bool CheckTxInputsEra(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CCoinsViewCache& prevInputs,
+    const Consensus::SpendEra& era, CAmount& txfee,
     const uint256 &epochHash,
     const Consensus::Params& params)
 {
+    const int nSpendHeight = era.nSpendHeight;
+
     // are the actual inputs available?
     if (!inputs.HaveInputs(tx)) {
         return state.Invalid(ValidationInvalidReason::TX_MISSING_INPUTS, false, REJECT_INVALID, "bad-txns-inputs-missingorspent",
@@ -187,11 +199,11 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, c
         }
 
         // Check special coin spend
-        if (nSpendHeight < params.nSaturnActiveHeight) {
-            if (coin.IsBindPlotter() && nSpendHeight < GetUnbindPlotterLimitHeight(CBindPlotterInfo(prevout, coin), prevInputs, params)) {
+        if (!fSaturn) {
+            if (coin.IsBindPlotter() && nSpendHeight < Consensus::GetUnbindPlotterLimitHeight(CBindPlotterInfo(prevout, coin), prevInputs, params)) {
                 return state.Invalid(ValidationInvalidReason::TX_INVALID_BIND, false, REJECT_INVALID, "bad-txns-unbindplotter-limit");
             }
-            if (coin.IsPoint() && coin.nHeight + PointPayload::As(coin.payload)->GetLockBlocks() > (uint32_t) nSpendHeight) {
+            if (coin.IsPoint() && coin.nHeight + PointPayload::As(coin.GetPayload())->GetLockBlocks() > (uint32_t) nSpendHeight) {
                 return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-txns-point-locked");
             }
         } else {
@@ -201,8 +213,8 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, c
             }
         }
         if (coin.IsStaking() &&
-            coin.nHeight + StakingPayload::As(coin.payload)->GetLockBlocks() > (uint32_t) nSpendHeight &&
-            (nSpendHeight < params.nSaturnActiveHeight || coin.nHeight >= params.nSaturnActiveHeight)) {
+            coin.nHeight + StakingPayload::As(coin.GetPayload())->GetLockBlocks() > (uint32_t) nSpendHeight &&
+            (!fSaturn || coin.nHeight >= era.nSaturnActiveHeight)) {
             return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-txns-staking-locked");
         }
     }
@@ -219,20 +231,20 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, c
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-txns-fee-outofrange");
     }
 
-    if (nSpendHeight < params.nSaturnActiveHeight) {
+    if (!fSaturn) {
         // CheckTxOutputs
         for (unsigned int i = 0; i < tx.vout.size(); ++i) {
             const CTxOut &txOut = tx.vout[i];
             auto payload = ExtractTxoutPayload(txOut, nSpendHeight);
             if (payload && payload->type == TXOUT_TYPE_BINDPLOTTER) {
                 // check PoS active
-                if (BindPlotterPayload::As(payload)->eType == BindPlotterPayload::Type::PoS && nSpendHeight < params.nMercuryActiveHeight)
+                if (BindPlotterPayload::As(payload)->eType == BindPlotterPayload::Type::PoS && !era.fMercury)
                     return state.Invalid(ValidationInvalidReason::TX_INVALID_BIND, false, REJECT_INVALID, "bad-bindplotter-PoS");
 
                 const CBindPlotterInfo lastBindInfo = prevInputs.GetLastBindPlotterInfo(BindPlotterPayload::As(payload)->GetId());
-                if (!lastBindInfo.outpoint.IsNull() && nSpendHeight < GetBindPlotterLimitHeight(nSpendHeight, lastBindInfo, params)) {
+                if (!lastBindInfo.outpoint.IsNull() && nSpendHeight < Consensus::GetBindPlotterLimitHeight(nSpendHeight, lastBindInfo, params)) {
                     // Change bind plotter punishment
-                    CAmount diffReward = GetBindPlotterPunishmentAmount(nSpendHeight, params);
+                    CAmount diffReward = Consensus::GetBindPlotterPunishmentAmount(nSpendHeight, params);
                     if (txfee_aux < diffReward)
                         return state.Invalid(ValidationInvalidReason::TX_INVALID_BIND, false, REJECT_INVALID, "bad-bindplotter-lowpunishment");
 
@@ -247,6 +259,26 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, c
     return true;
 }
 
+} // namespace
+
+bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CCoinsViewCache& prevInputs,
+    const SpendEra& era, CAmount& txfee,
+    const uint256 &epochHash,
+    const Consensus::Params& params)
+{
+    if (era.fSaturn)
+        return CheckTxInputsEra<true>(tx, state, inputs, prevInputs, era, txfee, epochHash, params);
+    return CheckTxInputsEra<false>(tx, state, inputs, prevInputs, era, txfee, epochHash, params);
+}
+
+bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CCoinsViewCache& prevInputs,
+    int nSpendHeight, CAmount& txfee,
+    const uint256 &epochHash,
+    const Consensus::Params& params)
+{
+    return CheckTxInputs(tx, state, inputs, prevInputs, SpendEra(nSpendHeight, params), txfee, epochHash, params);
+}
+
 int Consensus::GetBindPlotterLimitHeight(int nBindHeight, const CBindPlotterInfo& lastBindInfo, const Consensus::Params& params)
 {
     assert(!lastBindInfo.outpoint.IsNull() && lastBindInfo.nHeight >= 0);
@@ -269,7 +301,7 @@ int Consensus::GetBindPlotterLimitHeight(int nBindHeight, const CBindPlotterInfo
     const int nBeginMiningHeight = lastBindInfo.nHeight;
     const int nEndMiningHeight = std::min(lastBindInfo.nHeight + params.nCapacityEvalWindow, nEvalEndHeight);
     for (int nHeight = nBeginMiningHeight; nHeight <= nEndMiningHeight; nHeight++) {
-        if (ExtractAccountID(::ChainActive()[nHeight]->minerRewardTxOut.scriptPubKey) == lastBindInfo.accountID)
+        if (::ChainActive()[nHeight]->generatorAccountID == lastBindInfo.accountID)
             return lastBindInfo.nHeight + params.nCapacityEvalWindow;
     }
 
@@ -307,7 +339,7 @@ int Consensus::GetUnbindPlotterLimitHeight(const CBindPlotterInfo& bindInfo, con
     const int nBeginMiningHeight = bindInfo.nHeight;
     const int nEndMiningHeight = (bindInfo.outpoint == changeBindInfo.outpoint) ? nEvalEndHeight : changeBindInfo.nHeight;
     for (int nHeight = nBeginMiningHeight; nHeight <= nEndMiningHeight; nHeight++) {
-        if (ExtractAccountID(::ChainActive()[nHeight]->minerRewardTxOut.scriptPubKey) == bindInfo.accountID)
+        if (::ChainActive()[nHeight]->generatorAccountID == bindInfo.accountID)
             return bindInfo.nHeight + params.nCapacityEvalWindow;
     }
 
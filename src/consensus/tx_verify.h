@@ -33,6 +33,29 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
     const uint256 &epochHash,
     const Params& params);
 
+/**
+ * The height dependent rules of CheckTxInputs at a spend height. Resolved once for all transactions
+ * of a block, which are then checked by the routine of the era instead of comparing the height with
+ * the fork heights for each input and output.
+ */
+struct SpendEra
+{
+    int nSpendHeight;
+    int nSaturnActiveHeight;
+    //! Saturn rules: staking withdraw coins, no bind plotter spend limits and punishments
+    bool fSaturn;
+    //! PoS bind plotters are allowed
+    bool fMercury;
+
+    SpendEra(int nSpendHeightIn, const Params& params);
+};
+
+/** CheckTxInputs for a spend era resolved by the caller. */
+bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoinsViewCache& inputs, const CCoinsViewCache& prevInputs,
+    const SpendEra& era, CAmount& txfee,
+    const uint256 &epochHash,
+    const Params& params);
+
 /** Get bind/unbind plotter transaction lock height. */
 int GetBindPlotterLimitHeight(int nBindHeight, const CBindPlotterInfo& lastBindInfo, const Params& params);
 int GetUnbindPlotterLimitHeight(const CBindPlotterInfo& bindInfo, const CCoinsViewCache& inputs, const Params& params);
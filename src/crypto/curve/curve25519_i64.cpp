@@ -14,8 +14,19 @@ extern "C" {
 
 #include "curve25519_i64.h"
 
-typedef int32_t i25519[10];
-typedef const int32_t *i25519ptr;
+/* Use radix 2^51 field arithmetic where the compiler has 128-bit integers */
+#if defined(__SIZEOF_INT128__)
+#define CURVE25519_RADIX51 1
+#endif
+
+#ifdef CURVE25519_RADIX51
+typedef int64_t limb25519;
+typedef limb25519 i25519[5];
+#else
+typedef int32_t limb25519;
+typedef limb25519 i25519[10];
+#endif
+typedef const limb25519 *i25519ptr;
 typedef const uint8_t *srcptr;
 typedef uint8_t *dstptr;
 
@@ -44,11 +55,19 @@ order_times_8 = { 104, 159, 174, 231, 210, 24, 147, 192, 178, 230, 188, 23,
 	245, 206, 247, 166, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 128 };
 
 /* constants 2Gy and 1/(2Gy) */
+#ifdef CURVE25519_RADIX51
+static const i25519
+base_2y = { 1254246454548539, 110642242745733, 1611289653548436,
+		364075269936008, 1101971768011759 },
+base_r2y = { 547665238562416, 924726394952301, 841626324907422,
+		2016447399016971, 417828685705301 };
+#else
 static const i25519
 base_2y = { 39999547, 18689728, 59995525, 1648697, 57546132,
 		24010086, 19059592, 5425144, 63499247, 16420658 },
 base_r2y = { 5744, 8160848, 4790893, 13779497, 35730846,
 		12541209, 49101323, 30047407, 40071253, 6226132 };
+#endif
 
 
 /********************* radix 2^8 math *********************/
@@ -147,6 +166,8 @@ static dstptr egcd32(dstptr x, dstptr y, dstptr a, dstptr b) {
 }
 
 
+#ifndef CURVE25519_RADIX51
+
 /********************* radix 2^25.5 GF(2^255-19) math *********************/
 
 #define P25 33554431	/* (1 << 25) - 1 */
@@ -416,6 +437,157 @@ static i25519ptr sqr25519(i25519 x2, const i25519 x) {
 	return x2;
 }
 
+#else /* CURVE25519_RADIX51 */
+
+/********************* radix 2^51 GF(2^255-19) math *********************/
+
+/* Same operations as the radix 2^25.5 code, on five signed 51-bit limbs with
+ * the products accumulated in 128-bit integers.  Reduced form here means each
+ * limb is within -2^51 .. 2^51+2^16, which keeps the sums and differences of
+ * two reduced numbers safe as inputs of mul and sqr. */
+
+__extension__ typedef __int128 i128;
+
+#define P51 ((int64_t) 2251799813685247)	/* (1 << 51) - 1 */
+
+/* Convert to internal format from little-endian byte format.  Like the radix
+ * 2^25.5 code, the top bit is kept */
+static void unpack25519(i25519 x, const k25519 m) {
+	uint64_t w[4];
+	int i, j;
+	for (i = 0; i < 4; i++) {
+		w[i] = 0;
+		for (j = 8; j--; )
+			w[i] = w[i] << 8 | m[8*i + j];
+	}
+	x[0] = w[0] & P51;
+	x[1] = (w[0] >> 51 | w[1] << 13) & P51;
+	x[2] = (w[1] >> 38 | w[2] << 26) & P51;
+	x[3] = (w[2] >> 25 | w[3] << 39) & P51;
+	x[4] = w[3] >> 12;
+}
+
+/* Convert from internal format to the canonical little-endian byte format.
+ * The number must be in reduced form, as output by unpack, mul, sqr and set */
+static void pack25519(const i25519 x, k25519 m) {
+	uint64_t t[5], w[4], q;
+	int i, j;
+	/* add 4p so that no limb is negative */
+	t[0] = x[0] + 4 * (P51 - 18);
+	for (i = 1; i < 5; i++)
+		t[i] = x[i] + 4 * P51;
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < 4; i++) {
+			t[i+1] += t[i] >> 51;
+			t[i] &= P51;
+		}
+		t[0] += 19 * (t[4] >> 51);
+		t[4] &= P51;
+	}
+	/* now below 2^255+19, subtract p once if needed */
+	q = (t[0] + 19) >> 51;
+	for (i = 1; i < 5; i++)
+		q = (t[i] + q) >> 51;
+	t[0] += 19 * q;
+	for (i = 0; i < 4; i++) {
+		t[i+1] += t[i] >> 51;
+		t[i] &= P51;
+	}
+	t[4] &= P51;
+	w[0] = t[0] | t[1] << 51;
+	w[1] = t[1] >> 13 | t[2] << 38;
+	w[2] = t[2] >> 26 | t[3] << 25;
+	w[3] = t[3] >> 39 | t[4] << 12;
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < 8; j++)
+			m[8*i + j] = (uint8_t) (w[i] >> 8*j);
+}
+
+/* Copy a number */
+static void cpy25519(i25519 out, const i25519 in) {
+	int i;
+	for (i = 0; i < 5; i++)
+		out[i] = in[i];
+}
+
+/* Set a number to value, which must be in range -185861411 .. 185861411 */
+static void set25519(i25519 out, const int32_t in) {
+	int i;
+	out[0] = in;
+	for (i = 1; i < 5; i++)
+		out[i] = 0;
+}
+
+/* Add/subtract two numbers.  The inputs must be in reduced form, and the
+ * output isn't, so to do another addition or subtraction on the output,
+ * first multiply it by one to reduce it. */
+static void add25519(i25519 xy, const i25519 x, const i25519 y) {
+	xy[0] = x[0] + y[0];	xy[1] = x[1] + y[1];
+	xy[2] = x[2] + y[2];	xy[3] = x[3] + y[3];
+	xy[4] = x[4] + y[4];
+}
+static void sub25519(i25519 xy, const i25519 x, const i25519 y) {
+	xy[0] = x[0] - y[0];	xy[1] = x[1] - y[1];
+	xy[2] = x[2] - y[2];	xy[3] = x[3] - y[3];
+	xy[4] = x[4] - y[4];
+}
+
+/* Carry the 128-bit limb products into reduced form */
+static i25519ptr carry25519(i25519 xy, i128 r0, i128 r1, i128 r2, i128 r3, i128 r4) {
+	i128 c;
+	r1 += r0 >> 51;	r0 &= P51;
+	r2 += r1 >> 51;	r1 &= P51;
+	r3 += r2 >> 51;	r2 &= P51;
+	r4 += r3 >> 51;	r3 &= P51;
+	c = r4 >> 51;	r4 &= P51;
+	r0 += 19 * c;
+	r1 += r0 >> 51;	r0 &= P51;
+	xy[0] = (int64_t) r0;	xy[1] = (int64_t) r1;
+	xy[2] = (int64_t) r2;	xy[3] = (int64_t) r3;
+	xy[4] = (int64_t) r4;
+	return xy;
+}
+
+/* Multiply a number by a small integer in range -185861411 .. 185861411.
+ * The output is in reduced form, the input x need not be.  x and xy may point
+ * to the same buffer. */
+static i25519ptr mul25519small(i25519 xy, const i25519 x, const int32_t y) {
+	return carry25519(xy, (i128) x[0] * y, (i128) x[1] * y, (i128) x[2] * y,
+			(i128) x[3] * y, (i128) x[4] * y);
+}
+
+/* Multiply two numbers.  The output is in reduced form, the inputs need not
+ * be. */
+static i25519ptr mul25519(i25519 xy, const i25519 x, const i25519 y) {
+	const int64_t y1 = 19 * y[1], y2 = 19 * y[2], y3 = 19 * y[3], y4 = 19 * y[4];
+	return carry25519(xy,
+		(i128) x[0] * y[0] + (i128) x[1] * y4 + (i128) x[2] * y3 +
+			(i128) x[3] * y2 + (i128) x[4] * y1,
+		(i128) x[0] * y[1] + (i128) x[1] * y[0] + (i128) x[2] * y4 +
+			(i128) x[3] * y3 + (i128) x[4] * y2,
+		(i128) x[0] * y[2] + (i128) x[1] * y[1] + (i128) x[2] * y[0] +
+			(i128) x[3] * y4 + (i128) x[4] * y3,
+		(i128) x[0] * y[3] + (i128) x[1] * y[2] + (i128) x[2] * y[1] +
+			(i128) x[3] * y[0] + (i128) x[4] * y4,
+		(i128) x[0] * y[4] + (i128) x[1] * y[3] + (i128) x[2] * y[2] +
+			(i128) x[3] * y[1] + (i128) x[4] * y[0]);
+}
+
+/* Square a number.  Optimization of  mul25519(x2, x, x)  */
+static i25519ptr sqr25519(i25519 x2, const i25519 x) {
+	const int64_t x0_2 = 2 * x[0], x1_2 = 2 * x[1];
+	const int64_t x1_38 = 38 * x[1], x2_38 = 38 * x[2], x3_38 = 38 * x[3];
+	const int64_t x3_19 = 19 * x[3], x4_19 = 19 * x[4];
+	return carry25519(x2,
+		(i128) x[0] * x[0] + (i128) x1_38 * x[4] + (i128) x2_38 * x[3],
+		(i128) x0_2 * x[1] + (i128) x2_38 * x[4] + (i128) x3_19 * x[3],
+		(i128) x0_2 * x[2] + (i128) x[1] * x[1] + (i128) x3_38 * x[4],
+		(i128) x0_2 * x[3] + (i128) x1_2 * x[2] + (i128) x4_19 * x[4],
+		(i128) x0_2 * x[4] + (i128) x1_2 * x[3] + (i128) x[2] * x[2]);
+}
+
+#endif /* CURVE25519_RADIX51 */
+
 /* Calculates a reciprocal.  The output is in reduced form, the inputs need not 
  * be.  Simply calculates  y = x^(p-2)  so it's not too fast. */
 /* When sqrtassist is true, it instead calculates y = x^((p-5)/8) */
@@ -489,7 +661,13 @@ static void recip25519(i25519 y, const i25519 x, int sqrtassist) {
 
 /* checks if x is "negative", requires reduced input */
 static inline int is_negative(i25519 x) {
+#ifdef CURVE25519_RADIX51
+	k25519 m;
+	pack25519(x, m);
+	return m[0] & 1;
+#else
 	return (is_overflow(x) | (x[9] < 0)) ^ (x[0] & 1);
+#endif
 }
 
 /* a square root */
@@ -582,10 +760,10 @@ void core25519(k25519 Px, k25519 s, const k25519 k, const k25519 Gx) {
 			/* swap arguments depending on bit */
 			const int bit1 = k[i] >> j & 1;
 			const int bit0 = ~k[i] >> j & 1;
-			int32_t *const ax = x[bit0];
-			int32_t *const az = z[bit0];
-			int32_t *const bx = x[bit1];
-			int32_t *const bz = z[bit1];
+			limb25519 *const ax = x[bit0];
+			limb25519 *const az = z[bit0];
+			limb25519 *const bx = x[bit1];
+			limb25519 *const bz = z[bit1];
 
 			/* a' = a + b	*/
 			/* b' = 2 b	*/
@@ -661,8 +839,73 @@ int sign25519(k25519 v, const k25519 h, const priv25519 x, const spriv25519 s) {
 	return w != 0;
 }
 
-/** Y = v abs(P) + h G  */
-void verify25519(pub25519 Y, const k25519 v, const k25519 h, const pub25519 P) {
+/* Checks if x is zero, requires reduced input */
+static int is_zero25519(const i25519 x) {
+	k25519 m;
+	int i, w = 0;
+	pack25519(x, m);
+	for (i = 0; i < 32; i++)
+		w |= m[i];
+	return w == 0;
+}
+
+/* y[i] = 1/x[i] for n numbers with a single reciprocal, by Montgomery's trick.
+ * Zero stays zero, like with recip25519.  The inputs must be in reduced form
+ * and acc is scratch space of n numbers. */
+static void recip25519_batch(i25519 *y, const i25519 *x, i25519 *acc, size_t n) {
+	i25519 t, inv;
+	size_t i;
+	set25519(t, 1);
+	for (i = 0; i < n; i++) {
+		if (is_zero25519(x[i]))
+			cpy25519(acc[i], t);
+		else
+			mul25519(acc[i], t, x[i]);
+		cpy25519(t, acc[i]);
+	}
+	recip25519(inv, t, 0);
+	for (i = n; i-- != 0; ) {
+		if (is_zero25519(x[i])) {
+			set25519(y[i], 0);
+			continue;
+		}
+		if (i > 0)
+			mul25519(y[i], inv, acc[i-1]);
+		else
+			cpy25519(y[i], inv);
+		mul25519(t, inv, x[i]);
+		cpy25519(inv, t);
+	}
+}
+
+/* First step of verify25519, up to its first reciprocal.
+ *  p1 = P, num[0] / den = X(P+G) + Px + Gx + 486662,
+ *  num[1] / den = X(P-G) + Px + Gx + 486662  */
+static void verify_prep(i25519 p1, i25519 num[2], i25519 den, const pub25519 P) {
+	i25519 t1, t2[2];
+	int j;
+
+	unpack25519(p1, P);
+
+	/* s[0] = (Py^2 + Gy^2 - 2 Py Gy)/(Px - Gx)^2 - Px - Gx - 486662  */
+	/* s[1] = (Py^2 + Gy^2 + 2 Py Gy)/(Px - Gx)^2 - Px - Gx - 486662  */
+
+	x_to_y2(t1, t2[0], p1); /* t2[0] = Py^2  */
+	sqrt25519(t1, t2[0]); /* t1 = Py or -Py  */
+	j = is_negative(t1); /*      ... check which  */
+	t2[0][0] += 39420360; /* t2[0] = Py^2 + Gy^2  */
+	mul25519(t2[1], base_2y, t1);/* t2[1] = 2 Py Gy or -2 Py Gy  */
+	sub25519(num[j], t2[0], t2[1]); /* num[0] = Py^2 + Gy^2 - 2 Py Gy  */
+	add25519(num[1 - j], t2[0], t2[1]);/* num[1] = Py^2 + Gy^2 + 2 Py Gy  */
+	cpy25519(t1, p1); /* t1 = Px  */
+	t1[0] -= 9; /* t1 = Px - Gx  */
+	sqr25519(den, t1); /* den = (Px - Gx)^2  */
+}
+
+/* Second step of verify25519, given rden = 1/den of verify_prep: the chain
+ * for Y = v abs(P) + h G,  with X(Y) = yx/yz  */
+static void verify_chain(i25519 Yx, i25519 Yz, const i25519 p1, const i25519 num[2],
+			const i25519 rden, const k25519 v, const k25519 h) {
 	k25519 d;
 	i25519 p[2], s[2], yx[3], yz[3], t1[3], t2[3];
 
@@ -672,29 +915,15 @@ void verify25519(pub25519 Y, const k25519 v, const k25519 h, const pub25519 P) {
 	/* set p[0] to G and p[1] to P  */
 
 	set25519(p[0], 9);
-	unpack25519(p[1], P);
+	cpy25519(p[1], p1);
 
 	/* set s[0] to P+G and s[1] to P-G  */
 
-	/* s[0] = (Py^2 + Gy^2 - 2 Py Gy)/(Px - Gx)^2 - Px - Gx - 486662  */
-	/* s[1] = (Py^2 + Gy^2 + 2 Py Gy)/(Px - Gx)^2 - Px - Gx - 486662  */
-
-	x_to_y2(t1[0], t2[0], p[1]); /* t2[0] = Py^2  */
-	sqrt25519(t1[0], t2[0]); /* t1[0] = Py or -Py  */
-	j = is_negative(t1[0]); /*      ... check which  */
-	t2[0][0] += 39420360; /* t2[0] = Py^2 + Gy^2  */
-	mul25519(t2[1], base_2y, t1[0]);/* t2[1] = 2 Py Gy or -2 Py Gy  */
-	sub25519(t1[j], t2[0], t2[1]); /* t1[0] = Py^2 + Gy^2 - 2 Py Gy  */
-	add25519(t1[1 - j], t2[0], t2[1]);/* t1[1] = Py^2 + Gy^2 + 2 Py Gy  */
-	cpy25519(t2[0], p[1]); /* t2[0] = Px  */
-	t2[0][0] -= 9; /* t2[0] = Px - Gx  */
-	sqr25519(t2[1], t2[0]); /* t2[1] = (Px - Gx)^2  */
-	recip25519(t2[0], t2[1], 0); /* t2[0] = 1/(Px - Gx)^2  */
-	mul25519(s[0], t1[0], t2[0]); /* s[0] = t1[0]/(Px - Gx)^2  */
-	sub25519(s[0], s[0], p[1]); /* s[0] = t1[0]/(Px - Gx)^2 - Px  */
+	mul25519(s[0], num[0], rden); /* s[0] = num[0]/(Px - Gx)^2  */
+	sub25519(s[0], s[0], p[1]); /* s[0] = num[0]/(Px - Gx)^2 - Px  */
 	s[0][0] -= 9 + 486662; /* s[0] = X(P+G)  */
-	mul25519(s[1], t1[1], t2[0]); /* s[1] = t1[1]/(Px - Gx)^2  */
-	sub25519(s[1], s[1], p[1]); /* s[1] = t1[1]/(Px - Gx)^2 - Px  */
+	mul25519(s[1], num[1], rden); /* s[1] = num[1]/(Px - Gx)^2  */
+	sub25519(s[1], s[1], p[1]); /* s[1] = num[1]/(Px - Gx)^2 - Px  */
 	s[1][0] -= 9 + 486662; /* s[1] = X(P-G)  */
 	mul25519small(s[0], s[0], 1); /* reduce s[0] */
 	mul25519small(s[1], s[1], 1); /* reduce s[1] */
@@ -756,10 +985,46 @@ void verify25519(pub25519 Y, const k25519 v, const k25519 h, const pub25519 P) {
 	}
 
 	k = (vi & 1) + (hi & 1);
-	recip25519(t1[0], yz[k], 0);
-	mul25519(t1[1], yx[k], t1[0]);
+	cpy25519(Yx, yx[k]);
+	cpy25519(Yz, yz[k]);
+}
+
+/** Y = v abs(P) + h G  */
+void verify25519(pub25519 Y, const k25519 v, const k25519 h, const pub25519 P) {
+	i25519 p1, num[2], den, yx, yz, t1, t2;
+
+	verify_prep(p1, num, den, P);
+	recip25519(t1, den, 0); /* t1 = 1/(Px - Gx)^2  */
+	verify_chain(yx, yz, p1, num, t1, v, h);
+	recip25519(t1, yz, 0);
+	mul25519(t2, yx, t1);
+
+	pack25519(t2, Y);
+}
 
-	pack25519(t1[1], Y);
+/* Number of signatures of verify25519_batch sharing the reciprocals */
+#define VERIFY_BATCH_SIZE 32
+
+/** Y[i] = v[i] abs(P[i]) + h[i] G  */
+void verify25519_batch(size_t n, pub25519 *Y, const k25519 *v, const k25519 *h, const pub25519 *P) {
+	i25519 p1[VERIFY_BATCH_SIZE], num[VERIFY_BATCH_SIZE][2], den[VERIFY_BATCH_SIZE],
+		yx[VERIFY_BATCH_SIZE], yz[VERIFY_BATCH_SIZE], r[VERIFY_BATCH_SIZE],
+		acc[VERIFY_BATCH_SIZE], t;
+	size_t i, m;
+
+	for (; n != 0; n -= m, Y += m, v += m, h += m, P += m) {
+		m = n < VERIFY_BATCH_SIZE ? n : VERIFY_BATCH_SIZE;
+		for (i = 0; i < m; i++)
+			verify_prep(p1[i], num[i], den[i], P[i]);
+		recip25519_batch(r, den, acc, m);
+		for (i = 0; i < m; i++)
+			verify_chain(yx[i], yz[i], p1[i], num[i], r[i], v[i], h[i]);
+		recip25519_batch(r, yz, acc, m);
+		for (i = 0; i < m; i++) {
+			mul25519(t, yx[i], r[i]);
+			pack25519(t, Y[i]);
+		}
+	}
 }
 
 } // extern "C"
\ No newline at end of file
@@ -118,6 +118,17 @@ int sign25519(k25519 v, const k25519 h, const priv25519 x, const spriv25519 s);
  */
 void verify25519(pub25519 Y, const k25519 v, const k25519 h, const pub25519 P);
 
+/* Verification of n signatures at once, calculates Y[i] = v[i]P[i] + h[i]G
+ * Same results as verify25519, but the field reciprocals are shared by
+ * Montgomery's trick, which makes each signature cheaper.
+ *   n  [in]  number of signatures
+ *   Y  [out] signature public keys
+ *   v  [in]  signature values
+ *   h  [in]  signature hashes
+ *   P  [in]  public keys
+ */
+void verify25519_batch(size_t n, pub25519 *Y, const k25519 *v, const k25519 *h, const pub25519 *P);
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,4 +39,10 @@ void curve25519_verify(unsigned char verify[32], const unsigned char sign[32], c
     verify25519(verify, sign, data, publicKey);
 }
 
+void curve25519_verify_batch(size_t count, unsigned char* verify, const unsigned char* sign, const unsigned char* data, const unsigned char* publicKey)
+{
+    verify25519_batch(count, reinterpret_cast<pub25519*>(verify), reinterpret_cast<const k25519*>(sign),
+        reinterpret_cast<const k25519*>(data), reinterpret_cast<const pub25519*>(publicKey));
+}
+
 }
\ No newline at end of file
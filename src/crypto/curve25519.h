@@ -13,6 +13,8 @@ namespace crypto {
 void curve25519_kengen(unsigned char publicKey[32], unsigned char signingKey[32], unsigned char privateKey[32]);
 int curve25519_sign(unsigned char sign[32], const unsigned char data[32], const unsigned char privateKey[32], const unsigned char signingKey[32]);
 void curve25519_verify(unsigned char verify[32], const unsigned char sign[32], const unsigned char data[32], const unsigned char publicKey[32]);
+/** curve25519_verify of count signatures at once, cheaper than one by one. Each argument holds count keys of 32 bytes */
+void curve25519_verify_batch(size_t count, unsigned char* verify, const unsigned char* sign, const unsigned char* data, const unsigned char* publicKey);
 
 }
 
@@ -7,7 +7,9 @@
 
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
 #include <atomic>
+#include <vector>
 
 #if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
 #if defined(USE_ASM)
@@ -22,16 +24,20 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformS64_4way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformS64_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
+void TransformS64_2way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256_shani
@@ -416,6 +422,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -456,11 +463,85 @@ void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
     WriteBE32(out + 28, s[7]);
 }
 
+template<TransformType tr>
+void TransformS64Wrapper(unsigned char* out, const unsigned char* in)
+{
+    uint32_t s[8];
+    static const unsigned char padding1[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    sha256::Initialize(s);
+    tr(s, in, 1);
+    tr(s, padding1, 1);
+    WriteBE32(out + 0, s[0]);
+    WriteBE32(out + 4, s[1]);
+    WriteBE32(out + 8, s[2]);
+    WriteBE32(out + 12, s[3]);
+    WriteBE32(out + 16, s[4]);
+    WriteBE32(out + 20, s[5]);
+    WriteBE32(out + 24, s[6]);
+    WriteBE32(out + 28, s[7]);
+}
+
 TransformType Transform = sha256::Transform;
 TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformS64 = TransformS64Wrapper<sha256::Transform>;
+TransformD64Type TransformS64_2way = nullptr;
+TransformD64Type TransformS64_4way = nullptr;
+TransformD64Type TransformS64_8way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+/** Double-SHA256 of 8 messages of any length, one in each lane of the 8-way transform. Lanes
+ *  that finish early keep being transformed until the longest message is done. */
+void TransformDMulti_8way(unsigned char* const* out, const unsigned char* const* in, const size_t* lens)
+{
+    uint32_t init[8], s[64];
+    unsigned char tail[8][128];
+    unsigned char second[8][64];
+    const unsigned char* chunks[8];
+    size_t full[8], blocks[8], max_blocks = 0;
+    sha256::Initialize(init);
+    for (int i = 0; i < 8; ++i) {
+        full[i] = lens[i] / 64;
+        size_t rem = lens[i] % 64;
+        blocks[i] = full[i] + (rem + 9 > 64 ? 2 : 1);
+        max_blocks = std::max(max_blocks, blocks[i]);
+        memset(tail[i], 0, sizeof(tail[i]));
+        memcpy(tail[i], in[i] + 64 * full[i], rem);
+        tail[i][rem] = 0x80;
+        WriteBE64(tail[i] + 64 * (blocks[i] - full[i]) - 8, (uint64_t)lens[i] << 3);
+        for (int j = 0; j < 8; ++j) s[8 * j + i] = init[j];
+    }
+    for (size_t b = 0; b < max_blocks; ++b) {
+        for (int i = 0; i < 8; ++i) {
+            chunks[i] = b < full[i] ? in[i] + 64 * b : b < blocks[i] ? tail[i] + 64 * (b - full[i]) : tail[i];
+        }
+        TransformMulti_8way(s, chunks);
+        for (int i = 0; i < 8; ++i) {
+            if (b + 1 != blocks[i]) continue;
+            for (int j = 0; j < 8; ++j) WriteBE32(second[i] + 4 * j, s[8 * j + i]);
+        }
+    }
+
+    // Second round: a single padded block of the first hashes
+    for (int i = 0; i < 8; ++i) {
+        memset(second[i] + 32, 0, 32);
+        second[i][32] = 0x80;
+        second[i][62] = 1;
+        for (int j = 0; j < 8; ++j) s[8 * j + i] = init[j];
+        chunks[i] = second[i];
+    }
+    TransformMulti_8way(s, chunks);
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) WriteBE32(out[i] + 4 * j, s[8 * j + i]);
+    }
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -508,6 +589,25 @@ bool SelfTest() {
         0x6a, 0x46, 0x30, 0xa6, 0x89, 0x86, 0x23, 0xac, 0xf8, 0xa5, 0x15, 0xe9, 0x0a, 0xaa, 0x1e, 0x9a,
         0xd7, 0x93, 0x6b, 0x28, 0xe4, 0x3b, 0xfd, 0x59, 0xc6, 0xed, 0x7c, 0x5f, 0xa5, 0x41, 0xcb, 0x51
     };
+    // Expected output for each of the individual 8 64-byte messages under single SHA256 (including padding).
+    static const unsigned char result_s64[256] = {
+        0x95, 0xc9, 0x68, 0xb2, 0x6b, 0xaa, 0x56, 0xf8, 0xd3, 0x05, 0xcc, 0x1b, 0xac, 0xe2, 0x30, 0x64,
+        0x56, 0xe9, 0x8e, 0x9d, 0x18, 0x6e, 0xcb, 0x9f, 0x1b, 0x4d, 0xe1, 0x80, 0x8c, 0x6f, 0x13, 0x46,
+        0x7d, 0x68, 0xf4, 0x6a, 0x17, 0xf3, 0x41, 0x41, 0x99, 0x3d, 0xf6, 0x4e, 0xb6, 0x73, 0x51, 0x2d,
+        0xac, 0x93, 0x59, 0x02, 0xce, 0xdc, 0xde, 0xad, 0x5d, 0xbf, 0x2b, 0xf4, 0x03, 0xc2, 0x00, 0x7f,
+        0x72, 0x2d, 0x51, 0x2b, 0xe7, 0xdd, 0x3d, 0xb3, 0x9c, 0xb0, 0x6b, 0x92, 0xac, 0x81, 0x25, 0x86,
+        0x90, 0x75, 0x7d, 0x58, 0xdf, 0x4a, 0x61, 0xd5, 0x82, 0x98, 0x9d, 0x9b, 0x34, 0x09, 0x7c, 0x62,
+        0xbf, 0x0d, 0x3e, 0x61, 0x0b, 0xd1, 0xce, 0xf2, 0x54, 0x71, 0x06, 0xc5, 0x43, 0x0c, 0x6e, 0xd2,
+        0x4c, 0x7d, 0xfc, 0x3d, 0x6b, 0xc5, 0xe6, 0xd7, 0x81, 0x57, 0x42, 0x82, 0xf6, 0x7a, 0x42, 0x7f,
+        0x14, 0x59, 0xa0, 0xc2, 0xac, 0x24, 0xbc, 0x70, 0x24, 0x04, 0x08, 0x2a, 0xee, 0x8c, 0x59, 0x94,
+        0x4d, 0x0e, 0xfd, 0x30, 0x8e, 0x57, 0x0a, 0x62, 0xae, 0x72, 0xc7, 0xd4, 0x1c, 0x6f, 0xe3, 0xd1,
+        0x5b, 0x8f, 0x65, 0xd3, 0x21, 0xa4, 0x03, 0x92, 0xfe, 0x6c, 0x4e, 0x3d, 0x6e, 0xa5, 0x45, 0x05,
+        0xf5, 0x17, 0xd4, 0xed, 0x02, 0xaa, 0xb0, 0x53, 0x46, 0x65, 0x3f, 0x2b, 0xf5, 0x60, 0x20, 0x6b,
+        0xa9, 0x89, 0x74, 0x35, 0x6f, 0x53, 0x19, 0xb3, 0x41, 0x7e, 0xab, 0xac, 0xc0, 0x7d, 0x37, 0x27,
+        0xee, 0x55, 0xfa, 0x18, 0x20, 0x0b, 0x36, 0x8e, 0xcc, 0xbb, 0xfa, 0x13, 0x41, 0x01, 0x8a, 0x00,
+        0xcf, 0xef, 0x7a, 0x66, 0x02, 0xb3, 0x83, 0xff, 0x87, 0xf6, 0x75, 0x5e, 0x45, 0x65, 0x9d, 0x89,
+        0x48, 0xed, 0xa7, 0xf7, 0x47, 0xc4, 0x0e, 0x34, 0x8b, 0x4f, 0x28, 0xfc, 0xbf, 0x8b, 0x92, 0x43
+    };
 
 
     // Test Transform() for 0 through 8 transformations.
@@ -544,6 +644,47 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformS64
+    TransformS64(out, data + 1);
+    if (!std::equal(out, out + 32, result_s64)) return false;
+
+    // Test TransformS64_2way, if available.
+    if (TransformS64_2way) {
+        unsigned char out[64];
+        TransformS64_2way(out, data + 1);
+        if (!std::equal(out, out + 64, result_s64)) return false;
+    }
+
+    // Test TransformS64_4way, if available.
+    if (TransformS64_4way) {
+        unsigned char out[128];
+        TransformS64_4way(out, data + 1);
+        if (!std::equal(out, out + 128, result_s64)) return false;
+    }
+
+    // Test TransformS64_8way, if available.
+    if (TransformS64_8way) {
+        unsigned char out[256];
+        TransformS64_8way(out, data + 1);
+        if (!std::equal(out, out + 256, result_s64)) return false;
+    }
+
+    // Test TransformMulti_8way, if available.
+    if (TransformMulti_8way) {
+        uint32_t state[64];
+        const unsigned char* chunks[8];
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) state[8 * j + i] = init[j];
+            chunks[i] = data + 1;
+        }
+        TransformMulti_8way(state, chunks);
+        for (int i = 0; i < 8; ++i) {
+            for (int j = 0; j < 8; ++j) {
+                if (state[8 * j + i] != result[1][j]) return false;
+            }
+        }
+    }
+
     return true;
 }
 
@@ -608,6 +749,8 @@ std::string SHA256AutoDetect()
         Transform = sha256_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
         TransformD64_2way = sha256d64_shani::Transform_2way;
+        TransformS64 = TransformS64Wrapper<sha256_shani::Transform>;
+        TransformS64_2way = sha256d64_shani::TransformS64_2way;
         ret = "shani(1way,2way)";
         have_sse4 = false; // Disable SSE4/AVX2;
         have_avx2 = false;
@@ -618,10 +761,12 @@ std::string SHA256AutoDetect()
 #if defined(__x86_64__) || defined(__amd64__)
         Transform = sha256_sse4::Transform;
         TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+        TransformS64 = TransformS64Wrapper<sha256_sse4::Transform>;
         ret = "sse4(1way)";
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformS64_4way = sha256d64_sse41::TransformS64_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -629,6 +774,8 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformS64_8way = sha256d64_avx2::TransformS64_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +875,65 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256S64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformS64_8way) {
+        while (blocks >= 8) {
+            TransformS64_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (TransformS64_4way) {
+        while (blocks >= 4) {
+            TransformS64_4way(out, in);
+            out += 128;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    if (TransformS64_2way) {
+        while (blocks >= 2) {
+            TransformS64_2way(out, in);
+            out += 64;
+            in += 128;
+            blocks -= 2;
+        }
+    }
+    while (blocks) {
+        TransformS64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
+
+void SHA256DMulti(unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) order[i] = i;
+    size_t done = 0;
+    if (TransformMulti_8way && count >= 8) {
+        // Lanes of similar length waste less of the transforms on finished messages
+        std::stable_sort(order.begin(), order.end(), [lens](size_t a, size_t b) { return lens[a] < lens[b]; });
+        for (; done + 8 <= count; done += 8) {
+            unsigned char* lane_out[8];
+            const unsigned char* lane_in[8];
+            size_t lane_lens[8];
+            for (int i = 0; i < 8; ++i) {
+                lane_out[i] = out + 32 * order[done + i];
+                lane_in[i] = in[order[done + i]];
+                lane_lens[i] = lens[order[done + i]];
+            }
+            TransformDMulti_8way(lane_out, lane_in, lane_lens);
+        }
+    }
+    for (; done < count; ++done) {
+        unsigned char first[CSHA256::OUTPUT_SIZE];
+        size_t i = order[done];
+        CSHA256().Write(in[i], lens[i]).Finalize(first);
+        CSHA256().Write(first, sizeof(first)).Finalize(out + 32 * i);
+    }
+}
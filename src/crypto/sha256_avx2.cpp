@@ -54,6 +54,26 @@ __m256i inline Read8(const unsigned char* chunk, int offset) {
     return _mm256_shuffle_epi8(ret, _mm256_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL, 0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
 }
 
+/** Word offset/4 of 8 separate chunks, chunk i in lane i. */
+__m256i inline Read8(const unsigned char* const* chunks, int offset) {
+    return _mm256_set_epi32(
+        ReadBE32(chunks[7] + offset),
+        ReadBE32(chunks[6] + offset),
+        ReadBE32(chunks[5] + offset),
+        ReadBE32(chunks[4] + offset),
+        ReadBE32(chunks[3] + offset),
+        ReadBE32(chunks[2] + offset),
+        ReadBE32(chunks[1] + offset),
+        ReadBE32(chunks[0] + offset)
+    );
+}
+
+/** Message schedule word i, computed in place in the 16-word window w. */
+__m256i inline W(__m256i* w, int i) {
+    if (i >= 16) Inc(w[i & 15], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+    return w[i & 15];
+}
+
 void inline Write8(unsigned char* out, int offset, __m256i v) {
     v = _mm256_shuffle_epi8(v, _mm256_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL, 0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
     WriteLE32(out + 0 + offset, _mm256_extract_epi32(v, 7));
@@ -319,6 +339,229 @@ void Transform_8way(unsigned char* out, const unsigned char* in)
     Write8(out, 28, Add(h, K(0x5be0cd19ul)));
 }
 
+/** Single SHA-256 of 64-byte blocks: the first two transforms of Transform_8way. */
+void TransformS64_8way(unsigned char* out, const unsigned char* in)
+{
+    // Transform 1
+    __m256i a = K(0x6a09e667ul);
+    __m256i b = K(0xbb67ae85ul);
+    __m256i c = K(0x3c6ef372ul);
+    __m256i d = K(0xa54ff53aul);
+    __m256i e = K(0x510e527ful);
+    __m256i f = K(0x9b05688cul);
+    __m256i g = K(0x1f83d9abul);
+    __m256i h = K(0x5be0cd19ul);
+
+    __m256i w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
+
+    Round(a, b, c, d, e, f, g, h, Add(K(0x428a2f98ul), w0 = Read8(in, 0)));
+    Round(h, a, b, c, d, e, f, g, Add(K(0x71374491ul), w1 = Read8(in, 4)));
+    Round(g, h, a, b, c, d, e, f, Add(K(0xb5c0fbcful), w2 = Read8(in, 8)));
+    Round(f, g, h, a, b, c, d, e, Add(K(0xe9b5dba5ul), w3 = Read8(in, 12)));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x3956c25bul), w4 = Read8(in, 16)));
+    Round(d, e, f, g, h, a, b, c, Add(K(0x59f111f1ul), w5 = Read8(in, 20)));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x923f82a4ul), w6 = Read8(in, 24)));
+    Round(b, c, d, e, f, g, h, a, Add(K(0xab1c5ed5ul), w7 = Read8(in, 28)));
+    Round(a, b, c, d, e, f, g, h, Add(K(0xd807aa98ul), w8 = Read8(in, 32)));
+    Round(h, a, b, c, d, e, f, g, Add(K(0x12835b01ul), w9 = Read8(in, 36)));
+    Round(g, h, a, b, c, d, e, f, Add(K(0x243185beul), w10 = Read8(in, 40)));
+    Round(f, g, h, a, b, c, d, e, Add(K(0x550c7dc3ul), w11 = Read8(in, 44)));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x72be5d74ul), w12 = Read8(in, 48)));
+    Round(d, e, f, g, h, a, b, c, Add(K(0x80deb1feul), w13 = Read8(in, 52)));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x9bdc06a7ul), w14 = Read8(in, 56)));
+    Round(b, c, d, e, f, g, h, a, Add(K(0xc19bf174ul), w15 = Read8(in, 60)));
+    Round(a, b, c, d, e, f, g, h, Add(K(0xe49b69c1ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0xefbe4786ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0x0fc19dc6ul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0x240ca1ccul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x2de92c6ful), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0x4a7484aaul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x5cb0a9dcul), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0x76f988daul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+    Round(a, b, c, d, e, f, g, h, Add(K(0x983e5152ul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0xa831c66dul), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0xb00327c8ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0xbf597fc7ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0xc6e00bf3ul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0xd5a79147ul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x06ca6351ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0x14292967ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+    Round(a, b, c, d, e, f, g, h, Add(K(0x27b70a85ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0x2e1b2138ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0x4d2c6dfcul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0x53380d13ul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x650a7354ul), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0x766a0abbul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x81c2c92eul), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0x92722c85ul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+    Round(a, b, c, d, e, f, g, h, Add(K(0xa2bfe8a1ul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0xa81a664bul), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0xc24b8b70ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0xc76c51a3ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0xd192e819ul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0xd6990624ul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0xf40e3585ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0x106aa070ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+    Round(a, b, c, d, e, f, g, h, Add(K(0x19a4c116ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0x1e376c08ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0x2748774cul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0x34b0bcb5ul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x391c0cb3ul), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0x4ed8aa4aul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0x5b9cca4ful), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0x682e6ff3ul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+    Round(a, b, c, d, e, f, g, h, Add(K(0x748f82eeul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+    Round(h, a, b, c, d, e, f, g, Add(K(0x78a5636ful), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+    Round(g, h, a, b, c, d, e, f, Add(K(0x84c87814ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+    Round(f, g, h, a, b, c, d, e, Add(K(0x8cc70208ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+    Round(e, f, g, h, a, b, c, d, Add(K(0x90befffaul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+    Round(d, e, f, g, h, a, b, c, Add(K(0xa4506cebul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+    Round(c, d, e, f, g, h, a, b, Add(K(0xbef9a3f7ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+    Round(b, c, d, e, f, g, h, a, Add(K(0xc67178f2ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+
+    a = Add(a, K(0x6a09e667ul));
+    b = Add(b, K(0xbb67ae85ul));
+    c = Add(c, K(0x3c6ef372ul));
+    d = Add(d, K(0xa54ff53aul));
+    e = Add(e, K(0x510e527ful));
+    f = Add(f, K(0x9b05688cul));
+    g = Add(g, K(0x1f83d9abul));
+    h = Add(h, K(0x5be0cd19ul));
+
+    __m256i t0 = a, t1 = b, t2 = c, t3 = d, t4 = e, t5 = f, t6 = g, t7 = h;
+
+    // Transform 2
+    Round(a, b, c, d, e, f, g, h, K(0xc28a2f98ul));
+    Round(h, a, b, c, d, e, f, g, K(0x71374491ul));
+    Round(g, h, a, b, c, d, e, f, K(0xb5c0fbcful));
+    Round(f, g, h, a, b, c, d, e, K(0xe9b5dba5ul));
+    Round(e, f, g, h, a, b, c, d, K(0x3956c25bul));
+    Round(d, e, f, g, h, a, b, c, K(0x59f111f1ul));
+    Round(c, d, e, f, g, h, a, b, K(0x923f82a4ul));
+    Round(b, c, d, e, f, g, h, a, K(0xab1c5ed5ul));
+    Round(a, b, c, d, e, f, g, h, K(0xd807aa98ul));
+    Round(h, a, b, c, d, e, f, g, K(0x12835b01ul));
+    Round(g, h, a, b, c, d, e, f, K(0x243185beul));
+    Round(f, g, h, a, b, c, d, e, K(0x550c7dc3ul));
+    Round(e, f, g, h, a, b, c, d, K(0x72be5d74ul));
+    Round(d, e, f, g, h, a, b, c, K(0x80deb1feul));
+    Round(c, d, e, f, g, h, a, b, K(0x9bdc06a7ul));
+    Round(b, c, d, e, f, g, h, a, K(0xc19bf374ul));
+    Round(a, b, c, d, e, f, g, h, K(0x649b69c1ul));
+    Round(h, a, b, c, d, e, f, g, K(0xf0fe4786ul));
+    Round(g, h, a, b, c, d, e, f, K(0x0fe1edc6ul));
+    Round(f, g, h, a, b, c, d, e, K(0x240cf254ul));
+    Round(e, f, g, h, a, b, c, d, K(0x4fe9346ful));
+    Round(d, e, f, g, h, a, b, c, K(0x6cc984beul));
+    Round(c, d, e, f, g, h, a, b, K(0x61b9411eul));
+    Round(b, c, d, e, f, g, h, a, K(0x16f988faul));
+    Round(a, b, c, d, e, f, g, h, K(0xf2c65152ul));
+    Round(h, a, b, c, d, e, f, g, K(0xa88e5a6dul));
+    Round(g, h, a, b, c, d, e, f, K(0xb019fc65ul));
+    Round(f, g, h, a, b, c, d, e, K(0xb9d99ec7ul));
+    Round(e, f, g, h, a, b, c, d, K(0x9a1231c3ul));
+    Round(d, e, f, g, h, a, b, c, K(0xe70eeaa0ul));
+    Round(c, d, e, f, g, h, a, b, K(0xfdb1232bul));
+    Round(b, c, d, e, f, g, h, a, K(0xc7353eb0ul));
+    Round(a, b, c, d, e, f, g, h, K(0x3069bad5ul));
+    Round(h, a, b, c, d, e, f, g, K(0xcb976d5ful));
+    Round(g, h, a, b, c, d, e, f, K(0x5a0f118ful));
+    Round(f, g, h, a, b, c, d, e, K(0xdc1eeefdul));
+    Round(e, f, g, h, a, b, c, d, K(0x0a35b689ul));
+    Round(d, e, f, g, h, a, b, c, K(0xde0b7a04ul));
+    Round(c, d, e, f, g, h, a, b, K(0x58f4ca9dul));
+    Round(b, c, d, e, f, g, h, a, K(0xe15d5b16ul));
+    Round(a, b, c, d, e, f, g, h, K(0x007f3e86ul));
+    Round(h, a, b, c, d, e, f, g, K(0x37088980ul));
+    Round(g, h, a, b, c, d, e, f, K(0xa507ea32ul));
+    Round(f, g, h, a, b, c, d, e, K(0x6fab9537ul));
+    Round(e, f, g, h, a, b, c, d, K(0x17406110ul));
+    Round(d, e, f, g, h, a, b, c, K(0x0d8cd6f1ul));
+    Round(c, d, e, f, g, h, a, b, K(0xcdaa3b6dul));
+    Round(b, c, d, e, f, g, h, a, K(0xc0bbbe37ul));
+    Round(a, b, c, d, e, f, g, h, K(0x83613bdaul));
+    Round(h, a, b, c, d, e, f, g, K(0xdb48a363ul));
+    Round(g, h, a, b, c, d, e, f, K(0x0b02e931ul));
+    Round(f, g, h, a, b, c, d, e, K(0x6fd15ca7ul));
+    Round(e, f, g, h, a, b, c, d, K(0x521afacaul));
+    Round(d, e, f, g, h, a, b, c, K(0x31338431ul));
+    Round(c, d, e, f, g, h, a, b, K(0x6ed41a95ul));
+    Round(b, c, d, e, f, g, h, a, K(0x6d437890ul));
+    Round(a, b, c, d, e, f, g, h, K(0xc39c91f2ul));
+    Round(h, a, b, c, d, e, f, g, K(0x9eccabbdul));
+    Round(g, h, a, b, c, d, e, f, K(0xb5c9a0e6ul));
+    Round(f, g, h, a, b, c, d, e, K(0x532fb63cul));
+    Round(e, f, g, h, a, b, c, d, K(0xd2c741c6ul));
+    Round(d, e, f, g, h, a, b, c, K(0x07237ea3ul));
+    Round(c, d, e, f, g, h, a, b, K(0xa4954b68ul));
+    Round(b, c, d, e, f, g, h, a, K(0x4c191d76ul));
+
+    w0 = Add(t0, a);
+    w1 = Add(t1, b);
+    w2 = Add(t2, c);
+    w3 = Add(t3, d);
+    w4 = Add(t4, e);
+    w5 = Add(t5, f);
+    w6 = Add(t6, g);
+    w7 = Add(t7, h);
+
+    // Output
+    Write8(out, 0, w0);
+    Write8(out, 4, w1);
+    Write8(out, 8, w2);
+    Write8(out, 12, w3);
+    Write8(out, 16, w4);
+    Write8(out, 20, w5);
+    Write8(out, 24, w6);
+    Write8(out, 28, w7);
+}
+
+/** One SHA-256 block transform of 8 independent states, word j of state i at s[8 * j + i]. */
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+        0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+        0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+        0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+        0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+        0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+        0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+        0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul
+    };
+    __m256i* state = reinterpret_cast<__m256i*>(s);
+    __m256i a = _mm256_loadu_si256(state + 0);
+    __m256i b = _mm256_loadu_si256(state + 1);
+    __m256i c = _mm256_loadu_si256(state + 2);
+    __m256i d = _mm256_loadu_si256(state + 3);
+    __m256i e = _mm256_loadu_si256(state + 4);
+    __m256i f = _mm256_loadu_si256(state + 5);
+    __m256i g = _mm256_loadu_si256(state + 6);
+    __m256i h = _mm256_loadu_si256(state + 7);
+
+    __m256i w[16];
+    for (int i = 0; i < 16; ++i) w[i] = Read8(chunks, 4 * i);
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, Add(K(k[i + 0]), W(w, i + 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(k[i + 1]), W(w, i + 1)));
+        Round(g, h, a, b, c, d, e, f, Add(K(k[i + 2]), W(w, i + 2)));
+        Round(f, g, h, a, b, c, d, e, Add(K(k[i + 3]), W(w, i + 3)));
+        Round(e, f, g, h, a, b, c, d, Add(K(k[i + 4]), W(w, i + 4)));
+        Round(d, e, f, g, h, a, b, c, Add(K(k[i + 5]), W(w, i + 5)));
+        Round(c, d, e, f, g, h, a, b, Add(K(k[i + 6]), W(w, i + 6)));
+        Round(b, c, d, e, f, g, h, a, Add(K(k[i + 7]), W(w, i + 7)));
+    }
+
+    _mm256_storeu_si256(state + 0, Add(_mm256_loadu_si256(state + 0), a));
+    _mm256_storeu_si256(state + 1, Add(_mm256_loadu_si256(state + 1), b));
+    _mm256_storeu_si256(state + 2, Add(_mm256_loadu_si256(state + 2), c));
+    _mm256_storeu_si256(state + 3, Add(_mm256_loadu_si256(state + 3), d));
+    _mm256_storeu_si256(state + 4, Add(_mm256_loadu_si256(state + 4), e));
+    _mm256_storeu_si256(state + 5, Add(_mm256_loadu_si256(state + 5), f));
+    _mm256_storeu_si256(state + 6, Add(_mm256_loadu_si256(state + 6), g));
+    _mm256_storeu_si256(state + 7, Add(_mm256_loadu_si256(state + 7), h));
+}
+
 }
 
 #endif
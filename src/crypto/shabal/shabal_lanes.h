@@ -0,0 +1,157 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_SHABAL_SHABAL_LANES_H
+#define BITCOIN_CRYPTO_SHABAL_SHABAL_LANES_H
+
+//
+// Multi-buffer Shabal-256 shared by the SIMD backends. Each backend supplies a
+// lane type with the 32-bit vector operations of its instruction set and
+// instantiates Hash() in its own translation unit, compiled with its own
+// target flags. All lanes must hash messages of the same length, which is
+// exactly the shape of PoC plot generation.
+//
+
+#include <crypto/common.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace shabal_lanes {
+
+static const uint32_t A_INIT[12] = {
+    0x52F84552ul, 0xE54B7999ul, 0x2D8EE3ECul, 0xB9645191ul,
+    0xE0078B86ul, 0xBB7C44C9ul, 0xD2B5C1CAul, 0xB0D2EB8Cul,
+    0x14CE5A45ul, 0x22AF50DCul, 0xEFFDBC6Bul, 0xEB21B74Aul
+};
+
+static const uint32_t B_INIT[16] = {
+    0xB555C6EEul, 0x3E710596ul, 0xA72A652Ful, 0x9301515Ful,
+    0xDA28C1FAul, 0x696FD868ul, 0x9CB6BF72ul, 0x0AFE4002ul,
+    0xA6E03615ul, 0x5138C1D4ul, 0xBE216306ul, 0xB38B8890ul,
+    0x3EA8B96Bul, 0x3299ACE4ul, 0x30924DD4ul, 0x55CB34A5ul
+};
+
+static const uint32_t C_INIT[16] = {
+    0xB405F031ul, 0xC4233EBAul, 0xB3733979ul, 0xC0DD9D55ul,
+    0xC51C28AEul, 0xA327B8E1ul, 0x56C56167ul, 0xED614433ul,
+    0x88B59D60ul, 0x60E2CEBAul, 0x758B4B8Bul, 0x83E82A7Ful,
+    0xBC968828ul, 0xE6E00BF7ul, 0xBA839E55ul, 0x9B491C60ul
+};
+
+/** Shabal-256 state of L::N independent lanes. */
+template <typename L>
+struct State
+{
+    typedef typename L::V V;
+
+    V A[12], B[16], C[16], M[16];
+    uint32_t Wlow, Whigh;
+
+    State() : Wlow(1), Whigh(0)
+    {
+        for (int i = 0; i < 12; i++) A[i] = L::Set1(A_INIT[i]);
+        for (int i = 0; i < 16; i++) B[i] = L::Set1(B_INIT[i]);
+        for (int i = 0; i < 16; i++) C[i] = L::Set1(C_INIT[i]);
+    }
+
+    static V Rotl(V x, int n) { return L::Or(L::ShL(x, n), L::ShR(x, 32 - n)); }
+
+    void Load(const unsigned char* const* in, size_t offset)
+    {
+        for (int i = 0; i < 16; i++) M[i] = L::Load(in, offset + 4 * i);
+    }
+
+    void XorW()
+    {
+        A[0] = L::Xor(A[0], L::Set1(Wlow));
+        A[1] = L::Xor(A[1], L::Set1(Whigh));
+    }
+
+    void SwapBC()
+    {
+        for (int i = 0; i < 16; i++) {
+            V t = B[i];
+            B[i] = C[i];
+            C[i] = t;
+        }
+    }
+
+    /** The keyed permutation P, see PERM_ELT/APPLY_P in shabal.cpp. */
+    void Permute()
+    {
+        for (int i = 0; i < 16; i++) B[i] = Rotl(B[i], 17);
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 16; i++) {
+                V& a0 = A[(16 * j + i) % 12];
+                const V a1 = A[(16 * j + i + 11) % 12];
+                V t = Rotl(a1, 15);
+                t = L::Add(t, L::ShL(t, 2)); // * 5
+                t = L::Xor(L::Xor(a0, t), C[(24 - i) % 16]);
+                t = L::Add(t, L::ShL(t, 1)); // * 3
+                a0 = L::Xor(L::Xor(t, B[(i + 13) % 16]), L::Xor(L::AndNot(B[(i + 6) % 16], B[(i + 9) % 16]), M[i]));
+                B[i] = L::Not(L::Xor(Rotl(B[i], 1), a0));
+            }
+        }
+        for (int k = 0; k < 36; k++) {
+            V& a = A[(47 - k) % 12];
+            a = L::Add(a, C[(54 - k) % 16]);
+        }
+    }
+
+    void Block()
+    {
+        for (int i = 0; i < 16; i++) B[i] = L::Add(B[i], M[i]);
+        XorW();
+        Permute();
+        for (int i = 0; i < 16; i++) C[i] = L::Sub(C[i], M[i]);
+        SwapBC();
+        if (++Wlow == 0) ++Whigh;
+    }
+
+    void Final()
+    {
+        for (int i = 0; i < 16; i++) B[i] = L::Add(B[i], M[i]);
+        XorW();
+        Permute();
+        for (int i = 0; i < 3; i++) {
+            SwapBC();
+            XorW();
+            Permute();
+        }
+    }
+};
+
+/** Hash L::N messages of len bytes each into L::N 32-byte digests. */
+template <typename L>
+void Hash(unsigned char* const* out, const unsigned char* const* in, size_t len)
+{
+    State<L> state;
+
+    size_t offset = 0;
+    for (; offset + 64 <= len; offset += 64) {
+        state.Load(in, offset);
+        state.Block();
+    }
+
+    // Last block, padded with 0x80 and zeros
+    unsigned char tail[L::N][64];
+    const unsigned char* tails[L::N];
+    const size_t rest = len - offset;
+    for (int n = 0; n < L::N; n++) {
+        memcpy(tail[n], in[n] + offset, rest);
+        tail[n][rest] = 0x80;
+        memset(tail[n] + rest + 1, 0, 64 - rest - 1);
+        tails[n] = tail[n];
+    }
+    state.Load(tails, 0);
+    state.Final();
+
+    for (int i = 0; i < 8; i++) L::Store(out, 4 * i, state.B[8 + i]);
+}
+
+} // namespace shabal_lanes
+
+#endif // BITCOIN_CRYPTO_SHABAL_SHABAL_LANES_H
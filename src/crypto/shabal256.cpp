@@ -3,9 +3,119 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/shabal256.h>
+#include <crypto/common.h>
 
 #include <crypto/shabal/sph_shabal.h>
 
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(USE_ASM)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace shabal256_sse2
+{
+void Hash_4way(unsigned char* const* out, const unsigned char* const* in, size_t len);
+}
+
+namespace shabal256_avx2
+{
+void Hash_8way(unsigned char* const* out, const unsigned char* const* in, size_t len);
+}
+
+namespace shabal256_avx512
+{
+void Hash_16way(unsigned char* const* out, const unsigned char* const* in, size_t len);
+}
+
+namespace
+{
+
+typedef void (*HashLanesFn)(unsigned char* const* out, const unsigned char* const* in, size_t len);
+
+HashLanesFn Hash_4way = nullptr;
+HashLanesFn Hash_8way = nullptr;
+HashLanesFn Hash_16way = nullptr;
+
+void HashScalar(unsigned char* const* out, const unsigned char* const* in, size_t len, size_t count)
+{
+    CShabal256 shabal256;
+    for (size_t i = 0; i < count; i++) {
+        shabal256.Write(in[i], len).Finalize(out[i]);
+    }
+}
+
+bool SelfTest()
+{
+    // Messages of lengths ending in and between blocks, as plot generation does
+    static const size_t LENGTHS[] = {0, 32, 63, 64, 65, 4096, 4112};
+    static const size_t COUNT = 16;
+
+    unsigned char data[COUNT][4112];
+    for (size_t i = 0; i < COUNT; i++) {
+        for (size_t j = 0; j < sizeof(data[i]); j++) {
+            data[i][j] = (unsigned char)(i * 251 + j * 13 + (j >> 8));
+        }
+    }
+
+    for (size_t len : LENGTHS) {
+        unsigned char expected[COUNT][32], result[COUNT][32];
+        const unsigned char* in[COUNT];
+        unsigned char* out[COUNT];
+        unsigned char* outExpected[COUNT];
+        for (size_t i = 0; i < COUNT; i++) {
+            in[i] = data[i];
+            out[i] = result[i];
+            outExpected[i] = expected[i];
+        }
+        HashScalar(outExpected, in, len, COUNT);
+
+        if (Hash_16way) {
+            memset(result, 0, sizeof(result));
+            Hash_16way(out, in, len);
+            if (memcmp(result, expected, sizeof(result)) != 0) return false;
+        }
+        if (Hash_8way) {
+            memset(result, 0, sizeof(result));
+            Hash_8way(out, in, len);
+            Hash_8way(out + 8, in + 8, len);
+            if (memcmp(result, expected, sizeof(result)) != 0) return false;
+        }
+        if (Hash_4way) {
+            memset(result, 0, sizeof(result));
+            for (size_t i = 0; i < COUNT; i += 4) Hash_4way(out + i, in + i, len);
+            if (memcmp(result, expected, sizeof(result)) != 0) return false;
+        }
+    }
+
+    return true;
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+#ifdef __GNUC__
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#else
+  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+#endif
+}
+
+/** Return the OS enabled extended register state (XCR0). */
+uint32_t XCR0()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a;
+}
+#endif
+} // namespace
+
 CShabal256::CShabal256()
 {
     cc = new sph_shabal256_context;
@@ -33,3 +143,91 @@ CShabal256& CShabal256::Reset()
     ::sph_shabal256_init(cc);
     return *this;
 }
+
+std::string Shabal256AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(__SSE2__)
+    Hash_4way = shabal256_sse2::Hash_4way;
+    ret += ",sse2(4way)";
+#endif
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool have_avx512f = false;
+    uint32_t xcr0 = 0;
+
+    (void)XCR0;
+    (void)have_avx2;
+    (void)have_avx512f;
+    (void)xcr0;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        xcr0 = XCR0();
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_avx512f = (ebx >> 16) & 1;
+    }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && (xcr0 & 0x06) == 0x06) {
+        Hash_8way = shabal256_avx2::Hash_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    // Requires the OS to save the opmask and the upper ZMM registers
+    if (have_avx512f && (xcr0 & 0xe6) == 0xe6) {
+        Hash_16way = shabal256_avx512::Hash_16way;
+        ret += ",avx512(16way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+size_t Shabal256MaxLanes()
+{
+    if (Hash_16way) return 16;
+    if (Hash_8way) return 8;
+    if (Hash_4way) return 4;
+    return 1;
+}
+
+void Shabal256Lanes(unsigned char* const* output, const unsigned char* const* input, size_t len, size_t count)
+{
+    if (Hash_16way) {
+        while (count >= 16) {
+            Hash_16way(output, input, len);
+            output += 16;
+            input += 16;
+            count -= 16;
+        }
+    }
+    if (Hash_8way) {
+        while (count >= 8) {
+            Hash_8way(output, input, len);
+            output += 8;
+            input += 8;
+            count -= 8;
+        }
+    }
+    if (Hash_4way) {
+        while (count >= 4) {
+            Hash_4way(output, input, len);
+            output += 4;
+            input += 4;
+            count -= 4;
+        }
+    }
+    HashScalar(output, input, len, count);
+}
@@ -6,6 +6,7 @@
 #define BITCOIN_CRYPTO_SHABAL256_H
 
 #include <cstddef>
+#include <string>
 
 /** A hasher class for SHABAL-256. */
 class CShabal256
@@ -23,4 +24,20 @@ public:
     CShabal256& Reset();
 };
 
-#endif // BITCOIN_CRYPTO_SHABAL256_H
\ No newline at end of file
+/** Autodetect the best available multi-lane SHABAL-256 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string Shabal256AutoDetect();
+
+/** Return the widest lane count of the selected multi-lane implementation. */
+size_t Shabal256MaxLanes();
+
+/** Compute multiple SHABAL-256's of equal length messages in parallel.
+ *  output:  pointer to count pointers of 32 byte output buffers
+ *  input:   pointer to count pointers of len byte input buffers
+ *  len:     the length of each message
+ *  count:   the number of hashes to compute.
+ */
+void Shabal256Lanes(unsigned char* const* output, const unsigned char* const* input, size_t len, size_t count);
+
+#endif // BITCOIN_CRYPTO_SHABAL256_H
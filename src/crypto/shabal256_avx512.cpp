@@ -0,0 +1,56 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX512
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/shabal/shabal_lanes.h>
+
+namespace shabal256_avx512 {
+namespace {
+
+struct Lanes
+{
+    typedef __m512i V;
+    static const int N = 16;
+
+    static V Set1(uint32_t x) { return _mm512_set1_epi32(x); }
+    static V Add(V x, V y) { return _mm512_add_epi32(x, y); }
+    static V Sub(V x, V y) { return _mm512_sub_epi32(x, y); }
+    static V Xor(V x, V y) { return _mm512_xor_si512(x, y); }
+    static V Or(V x, V y) { return _mm512_or_si512(x, y); }
+    static V AndNot(V x, V y) { return _mm512_andnot_si512(x, y); }
+    static V Not(V x) { return _mm512_xor_si512(x, _mm512_set1_epi32(-1)); }
+    static V ShL(V x, int n) { return _mm512_slli_epi32(x, n); }
+    static V ShR(V x, int n) { return _mm512_srli_epi32(x, n); }
+
+    static V Load(const unsigned char* const* in, size_t offset)
+    {
+        alignas(64) uint32_t words[N];
+        for (int n = 0; n < N; n++) words[n] = ReadLE32(in[n] + offset);
+        return _mm512_load_si512((const void*)words);
+    }
+
+    static void Store(unsigned char* const* out, size_t offset, V v)
+    {
+        alignas(64) uint32_t words[N];
+        _mm512_store_si512((void*)words, v);
+        for (int n = 0; n < N; n++) WriteLE32(out[n] + offset, words[n]);
+    }
+};
+
+}
+
+void Hash_16way(unsigned char* const* out, const unsigned char* const* in, size_t len)
+{
+    shabal_lanes::Hash<Lanes>(out, in, len);
+}
+
+}
+
+#endif
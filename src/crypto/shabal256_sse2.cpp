@@ -0,0 +1,54 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__SSE2__)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include <crypto/common.h>
+#include <crypto/shabal/shabal_lanes.h>
+
+namespace shabal256_sse2 {
+namespace {
+
+struct Lanes
+{
+    typedef __m128i V;
+    static const int N = 4;
+
+    static V Set1(uint32_t x) { return _mm_set1_epi32(x); }
+    static V Add(V x, V y) { return _mm_add_epi32(x, y); }
+    static V Sub(V x, V y) { return _mm_sub_epi32(x, y); }
+    static V Xor(V x, V y) { return _mm_xor_si128(x, y); }
+    static V Or(V x, V y) { return _mm_or_si128(x, y); }
+    static V AndNot(V x, V y) { return _mm_andnot_si128(x, y); }
+    static V Not(V x) { return _mm_xor_si128(x, _mm_set1_epi32(-1)); }
+    static V ShL(V x, int n) { return _mm_slli_epi32(x, n); }
+    static V ShR(V x, int n) { return _mm_srli_epi32(x, n); }
+
+    static V Load(const unsigned char* const* in, size_t offset)
+    {
+        return _mm_set_epi32(ReadLE32(in[3] + offset), ReadLE32(in[2] + offset), ReadLE32(in[1] + offset), ReadLE32(in[0] + offset));
+    }
+
+    static void Store(unsigned char* const* out, size_t offset, V v)
+    {
+        alignas(16) uint32_t words[N];
+        _mm_store_si128((__m128i*)words, v);
+        for (int n = 0; n < N; n++) WriteLE32(out[n] + offset, words[n]);
+    }
+};
+
+}
+
+void Hash_4way(unsigned char* const* out, const unsigned char* const* in, size_t len)
+{
+    shabal_lanes::Hash<Lanes>(out, in, len);
+}
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <dbcompaction.h>
+
+#include <chain.h>
+#include <logging.h>
+#include <scheduler.h>
+#include <threadpool.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <exception>
+
+//! Milliseconds between two checks whether the node is idle
+static const int64_t DB_COMPACT_CHECK_INTERVAL = 10 * 1000;
+
+void CDBCompactionScheduler::Register(const void* owner, const std::string& name, std::vector<Range> vRanges)
+{
+    LOCK(m_mutex);
+    Database& database = m_databases[owner];
+    database.name = name;
+    database.vRanges = std::move(vRanges);
+}
+
+void CDBCompactionScheduler::Unregister(const void* owner)
+{
+    LOCK(m_compact_mutex);
+    LOCK(m_mutex);
+    m_databases.erase(owner);
+}
+
+void CDBCompactionScheduler::RequestRound()
+{
+    LOCK(m_mutex);
+    m_round_requested = true;
+}
+
+void CDBCompactionScheduler::Start(CScheduler& scheduler, int64_t nIdleSeconds)
+{
+    {
+        LOCK(m_mutex);
+        if (!m_stopped || nIdleSeconds <= 0)
+            return;
+        m_stopped = false;
+        m_idle_seconds = nIdleSeconds;
+        m_round_start = GetTime();
+    }
+    scheduler.scheduleEvery([this] { Check(); }, DB_COMPACT_CHECK_INTERVAL);
+}
+
+void CDBCompactionScheduler::Stop()
+{
+    {
+        LOCK(m_mutex);
+        m_stopped = true;
+    }
+    LOCK(m_compact_mutex);
+}
+
+void CDBCompactionScheduler::Check()
+{
+    uint256 tip;
+    bool fInitialDownload;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = ::ChainActive().Tip();
+        if (!pindex)
+            return;
+        tip = pindex->GetBlockHash();
+        fInitialDownload = ::ChainstateActive().IsInitialBlockDownload();
+    }
+
+    const int64_t nNow = GetTime();
+    std::pair<const void*, size_t> next;
+    {
+        LOCK(m_mutex);
+        if (m_stopped || !m_running.empty())
+            return;
+        if (tip != m_last_tip) {
+            m_last_tip = tip;
+            m_last_tip_time = nNow;
+        }
+        // A round follows the initial block download
+        if (fInitialDownload) {
+            m_round_requested = true;
+            return;
+        }
+        if (nNow - m_last_tip_time < m_idle_seconds || nNow - m_last_compaction < DB_COMPACT_THROTTLE)
+            return;
+
+        if (m_round.empty()) {
+            if (!m_round_requested && nNow - m_round_start < DB_COMPACT_ROUND_INTERVAL)
+                return;
+            for (const auto& entry : m_databases) {
+                for (size_t i = 0; i < entry.second.vRanges.size(); i++)
+                    m_round.emplace_back(entry.first, i);
+            }
+            m_round_total = m_round.size();
+            m_round_start = nNow;
+            m_round_requested = false;
+            if (m_round.empty())
+                return;
+            LogPrint(BCLog::LEVELDB, "Starting the compaction of %u key ranges\n", m_round_total);
+        }
+
+        next = m_round.front();
+        m_round.pop_front();
+        auto it = m_databases.find(next.first);
+        if (it == m_databases.end() || next.second >= it->second.vRanges.size())
+            return;
+        m_running = it->second.name + "/" + it->second.vRanges[next.second].name;
+    }
+
+    GetThreadPool().Submit(TaskPriority::BACKGROUND, [this, next] { Compact(next.first, next.second); });
+}
+
+void CDBCompactionScheduler::Compact(const void* owner, size_t nRange)
+{
+    LOCK(m_compact_mutex);
+
+    std::function<void()> compact;
+    std::string name;
+    {
+        LOCK(m_mutex);
+        auto it = m_databases.find(owner);
+        if (m_stopped || it == m_databases.end() || nRange >= it->second.vRanges.size()) {
+            m_running.clear();
+            return;
+        }
+        compact = it->second.vRanges[nRange].compact;
+        name = m_running;
+    }
+
+    const int64_t nStart = GetTimeMicros();
+    try {
+        compact();
+    } catch (const std::exception& e) {
+        LogPrintf("%s: compaction of %s failed: %s\n", __func__, name, e.what());
+    }
+    const int64_t nDuration = GetTimeMicros() - nStart;
+    LogPrint(BCLog::LEVELDB, "Compacted %s in %.2fms\n", name, nDuration * 0.001);
+
+    LOCK(m_mutex);
+    auto it = m_databases.find(owner);
+    if (it != m_databases.end()) {
+        it->second.nCompactions++;
+        it->second.nLastTime = GetTime();
+        it->second.nLastDuration = nDuration;
+    }
+    m_running.clear();
+    m_last_compaction = GetTime();
+}
+
+CDBCompactionScheduler::Status CDBCompactionScheduler::GetStatus() const
+{
+    LOCK(m_mutex);
+    Status status;
+    status.nIdleSeconds = m_stopped ? 0 : m_idle_seconds;
+    status.strRunning = m_running;
+    status.nRoundStart = m_round_start;
+    status.nRoundTotal = m_round_total;
+    status.nRoundDone = m_round_total - m_round.size();
+    for (const auto& entry : m_databases) {
+        const Database& database = entry.second;
+        status.vDatabases.push_back({database.name, database.vRanges.size(), database.nCompactions, database.nLastTime, database.nLastDuration});
+    }
+    return status;
+}
+
+CDBCompactionScheduler& GetDBCompactionScheduler()
+{
+    static CDBCompactionScheduler scheduler;
+    return scheduler;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_DBCOMPACTION_H
+#define BITCOIN_DBCOMPACTION_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CScheduler;
+
+/** Default for -dbcompactidle, seconds without a new tip before the databases are compacted, 0 = off */
+static const int64_t DEFAULT_DB_COMPACT_IDLE = 60;
+/** Seconds between the compactions of two key ranges */
+static const int64_t DB_COMPACT_THROTTLE = 30;
+/** Seconds between two rounds over all key ranges, unless a round is requested */
+static const int64_t DB_COMPACT_ROUND_INTERVAL = 24 * 60 * 60;
+
+/**
+ * Compacts the key ranges of the chainstate and Omni databases in the background, one range at a time, while
+ * the node is idle: not in initial block download, and no new tip for -dbcompactidle seconds. This drops the
+ * tombstones left by erasures, such as the rewrites of the staking pool snapshots or the Omni rollbacks.
+ *
+ * A round over all ranges is done after initial block download, when it is requested, and once a day.
+ * The compactions run on the shared thread pool as background tasks.
+ */
+class CDBCompactionScheduler
+{
+public:
+    //! A key range of a database, compacted as a whole
+    struct Range {
+        std::string name;
+        std::function<void()> compact;
+    };
+
+    struct DatabaseStatus {
+        std::string name;
+        size_t nRanges;
+        uint64_t nCompactions;
+        //! Time of the last compaction, and how long it took in microseconds
+        int64_t nLastTime;
+        int64_t nLastDuration;
+    };
+
+    struct Status {
+        int64_t nIdleSeconds;
+        //! The range being compacted, empty if none
+        std::string strRunning;
+        int64_t nRoundStart;
+        size_t nRoundDone;
+        size_t nRoundTotal;
+        std::vector<DatabaseStatus> vDatabases;
+    };
+
+private:
+    struct Database {
+        std::string name;
+        std::vector<Range> vRanges;
+        uint64_t nCompactions = 0;
+        int64_t nLastTime = 0;
+        int64_t nLastDuration = 0;
+    };
+
+    //! Held while a range is compacted, so that a database is not unregistered while it is compacted
+    Mutex m_compact_mutex;
+    mutable Mutex m_mutex;
+    std::map<const void*, Database> m_databases GUARDED_BY(m_mutex);
+    //! The ranges left in this round
+    std::deque<std::pair<const void*, size_t>> m_round GUARDED_BY(m_mutex);
+    size_t m_round_total GUARDED_BY(m_mutex) = 0;
+    int64_t m_round_start GUARDED_BY(m_mutex) = 0;
+    bool m_round_requested GUARDED_BY(m_mutex) = false;
+    std::string m_running GUARDED_BY(m_mutex);
+    int64_t m_last_compaction GUARDED_BY(m_mutex) = 0;
+
+    int64_t m_idle_seconds GUARDED_BY(m_mutex) = 0;
+    bool m_stopped GUARDED_BY(m_mutex) = true;
+    uint256 m_last_tip GUARDED_BY(m_mutex);
+    int64_t m_last_tip_time GUARDED_BY(m_mutex) = 0;
+
+    //! Called by the scheduler, submits the next range once the node is idle
+    void Check();
+    void Compact(const void* owner, size_t nRange);
+
+public:
+    /** Add the key ranges of a database, identified by its owner */
+    void Register(const void* owner, const std::string& name, std::vector<Range> vRanges);
+    /** Remove the ranges of a database, waits for its compaction in progress */
+    void Unregister(const void* owner);
+
+    /** Start a new round at the next idle moment, e.g. after many erasures */
+    void RequestRound();
+
+    /** Start the checks, nothing is compacted if nIdleSeconds is 0 */
+    void Start(CScheduler& scheduler, int64_t nIdleSeconds);
+    /** Stop the checks, waits for the compaction in progress */
+    void Stop();
+
+    Status GetStatus() const;
+};
+
+/** The compaction scheduler of the node */
+CDBCompactionScheduler& GetDBCompactionScheduler();
+
+#endif // BITCOIN_DBCOMPACTION_H
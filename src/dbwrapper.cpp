@@ -6,6 +6,8 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
+#include <util/threadnames.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +15,9 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -97,12 +102,13 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static leveldb::Options GetOptions(size_t nCacheSize, const DBTuning& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    options.block_cache = leveldb::NewLRUCache(nCacheSize / 100 * tuning.block_cache_percent);
+    options.write_buffer_size = nCacheSize / 100 * tuning.write_buffer_percent; // up to two write buffers may be held in memory simultaneously
+    options.block_size = tuning.block_size;
+    options.filter_policy = leveldb::NewBloomFilterPolicy(tuning.bloom_bits_per_key);
     options.compression = leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
@@ -114,15 +120,22 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const DBTuning& tuning)
     : m_name{path.stem().string()}
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
+    readoptions_nocache.verify_checksums = true;
+    readoptions_nocache.fill_cache = false;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
+    iteroptions_cache.verify_checksums = true;
+    for (unsigned char prefix : tuning.uncached_read_prefixes)
+        uncached_read_prefixes.set(prefix);
+    for (unsigned char prefix : tuning.cached_scan_prefixes)
+        cached_scan_prefixes.set(prefix);
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -163,6 +176,7 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
         LogPrintf("Wrote new obfuscate key for %s: %s\n", path.string(), HexStr(obfuscate_key));
     }
 
+    obfuscated = std::any_of(obfuscate_key.begin(), obfuscate_key.end(), [](unsigned char c) { return c != 0; });
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
 }
 
@@ -180,6 +194,25 @@ CDBWrapper::~CDBWrapper()
     options.env = nullptr;
 }
 
+void CDBBatch::Append(const CDBBatch &other)
+{
+    // The bundled leveldb has no public WriteBatch::Append, so replay the operations
+    class CBatchAppender : public leveldb::WriteBatch::Handler
+    {
+    public:
+        explicit CBatchAppender(leveldb::WriteBatch &batchIn) : batch(batchIn) {}
+        void Put(const leveldb::Slice &key, const leveldb::Slice &value) override { batch.Put(key, value); }
+        void Delete(const leveldb::Slice &key) override { batch.Delete(key); }
+    private:
+        leveldb::WriteBatch &batch;
+    };
+
+    CBatchAppender appender(batch);
+    leveldb::Status status = other.batch.Iterate(&appender);
+    dbwrapper_private::HandleError(status);
+    size_estimate += other.size_estimate;
+}
+
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     const bool log_memory = LogAcceptCategory(BCLog::LEVELDB);
@@ -233,10 +266,160 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
-CDBIterator::~CDBIterator() { delete piter; }
-bool CDBIterator::Valid() const { return piter->Valid(); }
-void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
-void CDBIterator::Next() { piter->Next(); }
+//! Entries read ahead at once by the background thread of an iterator
+static const size_t DB_READ_AHEAD_BATCH_ENTRIES = 1024;
+//! Batches of entries a read ahead iterator may hold ahead of its reader
+static const size_t DB_READ_AHEAD_MAX_BATCHES = 4;
+
+/**
+ * Reads the entries of a LevelDB iterator in a background thread, from its current position on.
+ * The iterator is owned by the thread until the ReadAhead is destroyed.
+ */
+class CDBIterator::ReadAhead
+{
+public:
+    typedef std::vector<std::pair<std::string, std::string>> Batch;
+
+private:
+    leveldb::Iterator* const piter;
+    const std::string prefix;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Batch> m_batches GUARDED_BY(m_mutex);
+    bool m_done GUARDED_BY(m_mutex) = false;
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::thread m_thread;
+
+    //! The batch being read, owned by the reader
+    Batch m_current;
+    size_t m_pos = 0;
+
+    void ThreadRead()
+    {
+        while (true) {
+            Batch batch;
+            batch.reserve(DB_READ_AHEAD_BATCH_ENTRIES);
+            for (; batch.size() < DB_READ_AHEAD_BATCH_ENTRIES && piter->Valid() && piter->key().starts_with(prefix); piter->Next()) {
+                batch.emplace_back(piter->key().ToString(), piter->value().ToString());
+            }
+            const bool fDone = batch.size() < DB_READ_AHEAD_BATCH_ENTRIES;
+
+            WAIT_LOCK(m_mutex, lock);
+            if (!batch.empty()) {
+                m_batches.push_back(std::move(batch));
+            }
+            m_done = fDone;
+            m_cond.notify_all();
+            if (fDone) return;
+            m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || m_batches.size() < DB_READ_AHEAD_MAX_BATCHES; });
+            if (m_stop) return;
+        }
+    }
+
+public:
+    ReadAhead(leveldb::Iterator* piterIn, const std::string& prefixIn) : piter(piterIn), prefix(prefixIn)
+    {
+        m_thread = std::thread([this] {
+            util::ThreadRename("dbreadahead");
+            ThreadRead();
+        });
+    }
+
+    ~ReadAhead()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    bool Valid()
+    {
+        if (m_pos < m_current.size())
+            return true;
+
+        WAIT_LOCK(m_mutex, lock);
+        m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_done || !m_batches.empty(); });
+        if (m_batches.empty())
+            return false;
+        m_current = std::move(m_batches.front());
+        m_batches.pop_front();
+        m_pos = 0;
+        m_cond.notify_all();
+        return true;
+    }
+
+    const std::pair<std::string, std::string>& Current() const { return m_current[m_pos]; }
+
+    void Next() { m_pos++; }
+};
+
+CDBIterator::CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
+    parent(_parent), piter(_piter), obfuscate_key(_parent.GetXorKey()) {}
+
+CDBIterator::~CDBIterator()
+{
+    // The read ahead thread has to stop before the iterator is deleted
+    pReadAhead.reset();
+    delete piter;
+}
+
+void CDBIterator::EnableReadAhead() { fReadAhead = true; }
+
+void CDBIterator::StartReadAhead()
+{
+    pReadAhead.reset();
+    if (fReadAhead) {
+        pReadAhead.reset(new ReadAhead(piter, prefix));
+    }
+}
+
+bool CDBIterator::Valid() const
+{
+    if (pReadAhead)
+        return pReadAhead->Valid();
+    return piter->Valid() && piter->key().starts_with(prefix);
+}
+
+void CDBIterator::SeekToFirst()
+{
+    pReadAhead.reset();
+    prefix.clear();
+    piter->SeekToFirst();
+    StartReadAhead();
+}
+
+void CDBIterator::SeekSlice(const leveldb::Slice& slKey)
+{
+    pReadAhead.reset();
+    piter->Seek(slKey);
+    StartReadAhead();
+}
+
+void CDBIterator::Next()
+{
+    if (pReadAhead)
+        pReadAhead->Next();
+    else
+        piter->Next();
+}
+
+leveldb::Slice CDBIterator::GetKey()
+{
+    if (pReadAhead)
+        return pReadAhead->Current().first;
+    return piter->key();
+}
+
+leveldb::Slice CDBIterator::GetValue()
+{
+    if (pReadAhead)
+        return pReadAhead->Current().second;
+    return piter->value();
+}
 
 namespace dbwrapper_private {
 
@@ -16,9 +16,30 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <bitset>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+/**
+ * Tuning of a database for the access patterns of its key spaces, which are told apart by the
+ * first byte of the keys. LevelDB has a single block cache per database, so point reads of values
+ * cached above the database can skip it, while scans of ranges read again and again can fill it.
+ */
+struct DBTuning
+{
+    //! Share of the cache size for the block cache, in percent
+    int block_cache_percent = 50;
+    //! Share of the cache size for each of the up to two write buffers, in percent
+    int write_buffer_percent = 25;
+    int bloom_bits_per_key = 10;
+    size_t block_size = 4 * 1024;
+    //! Key prefixes whose point reads do not fill the block cache
+    std::string uncached_read_prefixes;
+    //! Key prefixes whose iterators fill the block cache. Other iterators do not
+    std::string cached_scan_prefixes;
+};
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -115,14 +136,78 @@ public:
         size_estimate += 2 + (slKey.size() > 127) + slKey.size();
     }
 
+    //! Append the operations of another batch of the same database, after the ones of this batch
+    void Append(const CDBBatch &other);
+
     size_t SizeEstimate() const { return size_estimate; }
 };
 
+/** Stream deserializing a LevelDB slice in place, and undoing the obfuscation of values on the fly */
+class CDBSliceReader
+{
+private:
+    const char* m_data;
+    const size_t m_size;
+    size_t m_pos = 0;
+    //! The obfuscation key, null if not obfuscated
+    const std::vector<unsigned char>* m_xor;
+
+public:
+    CDBSliceReader(const leveldb::Slice& slice, const std::vector<unsigned char>* xor_key = nullptr)
+        : m_data(slice.data()), m_size(slice.size()), m_xor(xor_key) {}
+
+    template<typename T>
+    CDBSliceReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return CLIENT_VERSION; }
+    int GetType() const { return SER_DISK; }
+
+    size_t size() const { return m_size - m_pos; }
+    bool empty() const { return m_size == m_pos; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n > m_size - m_pos) {
+            throw std::ios_base::failure("CDBSliceReader::read(): end of data");
+        }
+        memcpy(dst, m_data + m_pos, n);
+        if (m_xor) {
+            for (size_t i = 0; i < n; i++) {
+                dst[i] ^= (*m_xor)[(m_pos + i) % m_xor->size()];
+            }
+        }
+        m_pos += n;
+    }
+
+    void ignore(size_t n)
+    {
+        if (n > m_size - m_pos) {
+            throw std::ios_base::failure("CDBSliceReader::ignore(): end of data");
+        }
+        m_pos += n;
+    }
+};
+
 class CDBIterator
 {
 private:
+    class ReadAhead;
+
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    //! The obfuscation key of the parent, null if not obfuscated
+    const std::vector<unsigned char>* obfuscate_key;
+    //! The serialized prefix every key has to start with, empty if unbounded
+    std::string prefix;
+    //! Whether the entries are read ahead in a background thread
+    bool fReadAhead = false;
+    std::unique_ptr<ReadAhead> pReadAhead;
+
+    void StartReadAhead();
 
 public:
 
@@ -130,10 +215,15 @@ public:
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
-        parent(_parent), piter(_piter) { };
+    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter);
     ~CDBIterator();
 
+    /**
+     * Read the following entries in a background thread from the next seek on, for bulk scans.
+     * Keys and values stay valid until the next call of Next().
+     */
+    void EnableReadAhead();
+
     bool Valid() const;
 
     void SeekToFirst();
@@ -142,25 +232,31 @@ public:
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
-        leveldb::Slice slKey(ssKey.data(), ssKey.size());
-        piter->Seek(slKey);
+        prefix.clear();
+        SeekSlice(leveldb::Slice(ssKey.data(), ssKey.size()));
     }
 
+    /** Seek to the first key starting with the serialized prefix, and stop iterating after its last one */
+    template<typename K> void SeekPrefix(const K& key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        prefix.assign(ssKey.data(), ssKey.size());
+        SeekSlice(leveldb::Slice(prefix));
+    }
+
+    void SeekSlice(const leveldb::Slice& slKey);
+
     void Next();
 
-    leveldb::Slice GetKey() {
-        return piter->key();
-    }
+    leveldb::Slice GetKey();
 
-    leveldb::Slice GetValue() {
-        return piter->value();
-    }
+    leveldb::Slice GetValue();
 
     template<typename K> bool GetKey(K& key) {
-        leveldb::Slice slKey = piter->key();
         try {
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            ssKey >> key;
+            CDBSliceReader reader(GetKey());
+            reader >> key;
         } catch (const std::exception&) {
             return false;
         }
@@ -168,11 +264,9 @@ public:
     }
 
     template<typename V> bool GetValue(V& value) {
-        leveldb::Slice slValue = piter->value();
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
-            ssValue >> value;
+            CDBSliceReader reader(GetValue(), obfuscate_key);
+            reader >> value;
         } catch (const std::exception&) {
             return false;
         }
@@ -180,7 +274,7 @@ public:
     }
 
     unsigned int GetValueSize() {
-        return piter->value().size();
+        return GetValue().size();
     }
 
 };
@@ -198,9 +292,24 @@ private:
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
+    //! options used when reading keys of the uncached prefixes from the database
+    leveldb::ReadOptions readoptions_nocache;
+
     //! options used when iterating over values of the database
     leveldb::ReadOptions iteroptions;
 
+    //! options used when iterating over the keys of the cached prefixes
+    leveldb::ReadOptions iteroptions_cache;
+
+    //! key prefixes whose point reads and iterators use the other options
+    std::bitset<256> uncached_read_prefixes;
+    std::bitset<256> cached_scan_prefixes;
+
+    const leveldb::ReadOptions& GetReadOptions(const CDataStream& ssKey) const
+    {
+        return !ssKey.empty() && uncached_read_prefixes.test((unsigned char) ssKey[0]) ? readoptions_nocache : readoptions;
+    }
+
     //! options used when writing to the database
     leveldb::WriteOptions writeoptions;
 
@@ -216,6 +325,9 @@ private:
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
+    //! whether obfuscate_key is not all zero
+    bool obfuscated = false;
+
     //! the key under which the obfuscation key is stored
     static const std::string OBFUSCATE_KEY_KEY;
 
@@ -224,6 +336,10 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+public:
+    //! the obfuscation key to undo on reads, null if not obfuscated
+    const std::vector<unsigned char>* GetXorKey() const { return obfuscated ? &obfuscate_key : nullptr; }
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -232,8 +348,10 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] tuning      Cache split, filters and per key space caching of the database.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false,
+               const DBTuning& tuning = DBTuning());
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -248,7 +366,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(ssKey), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -256,9 +374,8 @@ public:
             dbwrapper_private::HandleError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue.Xor(obfuscate_key);
-            ssValue >> value;
+            CDBSliceReader reader(strValue, GetXorKey());
+            reader >> value;
         } catch (const std::exception&) {
             return false;
         }
@@ -282,7 +399,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(ssKey), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -322,6 +439,12 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /** Iterator over the key space of a prefix, which fills the block cache if the tuning says so */
+    CDBIterator *NewIterator(char prefix)
+    {
+        return new CDBIterator(*this, pdb->NewIterator(cached_scan_prefixes.test((unsigned char) prefix) ? iteroptions_cache : iteroptions));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -41,6 +41,8 @@ void DummyWalletInit::AddWalletOptions() const
         "-rescan",
         "-salvagewallet",
         "-spendzeroconfchange",
+        "-walletasyncflush",
+        "-walletnotifythread",
         "-txconfirmtarget=<n>",
         "-upgradewallet",
         "-wallet=<path>",
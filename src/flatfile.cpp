@@ -96,3 +96,18 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     fclose(file);
     return true;
 }
+
+bool FlatFileSeq::Finalize(const FlatFilePos& pos)
+{
+    FILE* file = Open(FlatFilePos(pos.nFile, 0)); // Avoid fseek to nPos
+    if (!file) {
+        return error("%s: failed to open file %d", __func__, pos.nFile);
+    }
+    if (!TruncateFile(file, pos.nPos)) {
+        fclose(file);
+        return error("%s: failed to truncate file %d", __func__, pos.nFile);
+    }
+
+    fclose(file);
+    return true;
+}
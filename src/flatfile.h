@@ -91,6 +91,15 @@ public:
      * @return true on success, false on failure.
      */
     bool Flush(const FlatFilePos& pos, bool finalize = false);
+
+    /**
+     * Truncate off extra pre-allocated bytes of a file no more data will be written to, without committing
+     * it to disk. The commit is left to a later Flush.
+     *
+     * @param[in] pos The first unwritten position in the file.
+     * @return true on success, false on failure.
+     */
+    bool Finalize(const FlatFilePos& pos);
 };
 
 #endif // BITCOIN_FLATFILE_H
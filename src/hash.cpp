@@ -6,12 +6,33 @@
 #include <crypto/common.h>
 #include <crypto/hmac_sha512.h>
 
+#include <assert.h>
+
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
     return (x << r) | (x >> (32 - r));
 }
 
+std::vector<uint256> HashRanges(const std::vector<unsigned char>& data, const std::vector<size_t>& ends)
+{
+    std::vector<const unsigned char*> ptrs(ends.size());
+    std::vector<size_t> lens(ends.size());
+    size_t begin = 0;
+    for (size_t i = 0; i < ends.size(); i++) {
+        assert(begin <= ends[i] && ends[i] <= data.size());
+        ptrs[i] = data.data() + begin;
+        lens[i] = ends[i] - begin;
+        begin = ends[i];
+    }
+    std::vector<uint256> hashes(ends.size());
+    if (!hashes.empty()) {
+        static_assert(sizeof(uint256) == CSHA256::OUTPUT_SIZE, "uint256 hashes are written as one contiguous buffer");
+        SHA256DMulti(hashes[0].begin(), ptrs.data(), lens.data(), ends.size());
+    }
+    return hashes;
+}
+
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash)
 {
     // The following is MurmurHash3 (x86_32), see http://code.google.com/p/smhasher/source/browse/trunk/MurmurHash3.cpp
@@ -191,6 +191,31 @@ public:
     }
 };
 
+/** Writes data to an underlying destination stream, while hashing the written data. */
+template<typename Destination>
+class CHashedWriter : public CHashWriter
+{
+private:
+    Destination* destination;
+
+public:
+    explicit CHashedWriter(Destination* destination_) : CHashWriter(destination_->GetType(), destination_->GetVersion()), destination(destination_) {}
+
+    void write(const char* pch, size_t nSize)
+    {
+        destination->write(pch, nSize);
+        CHashWriter::write(pch, nSize);
+    }
+
+    template<typename T>
+    CHashedWriter<Destination>& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj);
+        return (*this);
+    }
+};
+
 /** Compute the 256-bit hash of an object's serialization. */
 template<typename T>
 uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL_VERSION)
@@ -200,6 +225,11 @@ uint256 SerializeHash(const T& obj, int nType=SER_GETHASH, int nVersion=PROTOCOL
     return ss.GetHash();
 }
 
+/** Compute the 256-bit hashes of consecutive byte ranges of a buffer at once, range i ending at
+ *  ends[i]. Short ranges, such as the serializations of transactions or headers, are hashed in
+ *  parallel lanes where SHA256DMulti supports it. */
+std::vector<uint256> HashRanges(const std::vector<unsigned char>& data, const std::vector<size_t>& ends);
+
 unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char>& vDataToHash);
 
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
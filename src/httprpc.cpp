@@ -278,6 +278,22 @@ static bool HTTPReq_PoCJSONRPC(HTTPRequest* req, const std::string &)
             req->WriteReply(HTTP_BAD_METHOD, "JSONRPC server handles only POST requests");
             return false;
         }
+        // Serve polling miners the published mining info, unless the chain state has to report why mining cannot start
+        if (requestType->second == "getMiningInfo" && parameters.size() == 1) {
+            const std::shared_ptr<const poc::MiningInfo> info = poc::GetMiningInfo();
+            if (info && poc::IsMiningInfoReady(*info)) {
+                const std::string etag = "\"" + info->hashTip.GetHex() + "\"";
+                req->WriteHeader("ETag", etag);
+                const std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+                if (ifNoneMatch.first && ifNoneMatch.second == etag) {
+                    req->WriteReply(HTTP_NOT_MODIFIED);
+                    return true;
+                }
+                req->WriteHeader("Content-Type", "application/json; charset=UTF-8");
+                req->WriteReply(HTTP_OK, info->strReply);
+                return true;
+            }
+        }
         const time_t startTime = ::time(nullptr);
 
         // Set the request
@@ -359,7 +375,8 @@ bool StartHTTPRPC()
     if (g_wallet_init_interface.HasWalletSupport()) {
         RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
     }
-    RegisterHTTPHandler("/burst", false, HTTPReq_PoCJSONRPC);
+    // Mining requests must not wait behind heavy queries
+    RegisterHTTPHandler("/burst", false, HTTPReq_PoCJSONRPC, true);
     struct event_base* eventBase = EventBase();
     assert(eventBase);
     httpRPCTimerInterface = MakeUnique<HTTPRPCTimerInterface>(eventBase);
@@ -9,12 +9,14 @@
 #include <util/threadnames.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <util/time.h>
 #include <netbase.h>
 #include <rpc/protocol.h> // For HTTP status codes
 #include <shutdown.h>
 #include <sync.h>
 #include <ui_interface.h>
 
+#include <algorithm>
 #include <deque>
 #include <memory>
 #include <stdio.h>
@@ -64,19 +66,29 @@ private:
 };
 
 /** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+ * Work items are simply callable objects. Priority items are queued in their own lane, which is served first and
+ * can have workers of its own, so that slow requests do not delay them.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct Lane
+    {
+        //! Items with their enqueue time in microseconds
+        std::deque<std::pair<int64_t, std::unique_ptr<WorkItem>>> queue;
+        HTTPWorkQueueStats stats;
+    };
+
     /** Mutex protects entire object */
     Mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    Lane lanes[2];
     bool running;
     size_t maxDepth;
 
+    Lane& GetLane(bool priority) { return lanes[priority ? 1 : 0]; }
+
 public:
     explicit WorkQueue(size_t _maxDepth) : running(true),
                                  maxDepth(_maxDepth)
@@ -88,29 +100,42 @@ public:
     {
     }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, bool priority)
     {
         LOCK(cs);
-        if (queue.size() >= maxDepth) {
+        Lane& lane = GetLane(priority);
+        if (lane.queue.size() >= maxDepth) {
+            lane.stats.nRejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
+        lane.queue.emplace_back(GetTimeMicros(), std::unique_ptr<WorkItem>(item));
+        // Workers of the priority lane may wait for it
+        if (priority)
+            cond.notify_all();
+        else
+            cond.notify_one();
         return true;
     }
-    /** Thread function */
-    void Run()
+    /** Thread function, priorityOnly workers leave the normal lane to others */
+    void Run(bool priorityOnly)
     {
+        Lane& priorityLane = GetLane(true);
+        Lane& normalLane = GetLane(false);
         while (true) {
             std::unique_ptr<WorkItem> i;
             {
                 WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
+                while (running && priorityLane.queue.empty() && (priorityOnly || normalLane.queue.empty()))
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
+                Lane& lane = priorityLane.queue.empty() ? normalLane : priorityLane;
+                const int64_t wait = GetTimeMicros() - lane.queue.front().first;
+                lane.stats.nRequests++;
+                lane.stats.nTotalWaitMicros += wait;
+                lane.stats.nMaxWaitMicros = std::max(lane.stats.nMaxWaitMicros, wait);
+                i = std::move(lane.queue.front().second);
+                lane.queue.pop_front();
             }
             (*i)();
         }
@@ -122,17 +147,26 @@ public:
         running = false;
         cond.notify_all();
     }
+    /** Get statistics of a lane */
+    HTTPWorkQueueStats GetStats(bool priority)
+    {
+        LOCK(cs);
+        HTTPWorkQueueStats stats = GetLane(priority).stats;
+        stats.nDepth = GetLane(priority).queue.size();
+        return stats;
+    }
 };
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, bool _priority):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), priority(_priority)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    bool priority;
 };
 
 /** HTTP module state */
@@ -265,10 +299,10 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     if (i != iend) {
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), i->priority))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http %swork queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n", i->priority ? "priority " : "");
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -337,10 +371,10 @@ static bool HTTPBindAddresses(struct evhttp* http)
 }
 
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num, bool priority_only)
 {
     util::ThreadRename(strprintf("httpworker.%i", worker_num));
-    queue->Run();
+    queue->Run(priority_only);
 }
 
 /** libevent event log callback */
@@ -431,8 +465,9 @@ void StartHTTPServer()
     LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = std::thread(ThreadHTTP, eventBase);
 
+    // With more than one worker the first one only serves priority requests
     for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, i);
+        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, i, i == 0 && rpcThreads > 1);
     }
 }
 
@@ -610,6 +645,14 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  * Replies must be sent in the main loop in the main http thread,
  * this cannot be done from worker threads.
  */
+void HTTPRequest::WriteReplyBody(const std::string& strChunk)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+}
+
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
     assert(!replySent && req);
@@ -680,10 +723,18 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, bool priority)
 {
-    LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d, priority %d)\n", prefix, exactMatch, priority);
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, priority));
+}
+
+bool GetHTTPWorkQueueStats(bool priority, HTTPWorkQueueStats& stats)
+{
+    if (!workQueue)
+        return false;
+    stats = workQueue->GetStats(priority);
+    return true;
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
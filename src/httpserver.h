@@ -41,12 +41,29 @@ bool UpdateHTTPServerLogging(bool enable);
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests of priority handlers are queued in their own lane, served first and by a worker of its own.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, bool priority = false);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Statistics of a work queue lane */
+struct HTTPWorkQueueStats
+{
+    //! Requests taken by workers
+    uint64_t nRequests{0};
+    //! Requests rejected because the lane was full
+    uint64_t nRejected{0};
+    //! Total and maximum time requests waited in the lane
+    int64_t nTotalWaitMicros{0};
+    int64_t nMaxWaitMicros{0};
+    //! Requests currently waiting
+    size_t nDepth{0};
+};
+
+/** Get statistics of the priority or normal work queue lane. Return false if the HTTP server is not initialized */
+bool GetHTTPWorkQueueStats(bool priority, HTTPWorkQueueStats& stats);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -112,6 +129,14 @@ public:
      */
     void WriteHeader(const std::string& hdr, const std::string& value);
 
+    /**
+     * Append to the reply body sent by WriteReply, so that large replies can be written piecewise instead of
+     * being built as one string first.
+     *
+     * @note call this before calling WriteReply.
+     */
+    void WriteReplyBody(const std::string& strChunk);
+
     /**
      * Write HTTP reply.
      * nStatus is the HTTP status code to send.
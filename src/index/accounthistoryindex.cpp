@@ -0,0 +1,290 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/accounthistoryindex.h>
+
+#include <chainparams.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <limits>
+#include <map>
+
+/* The index database stores one entry for each account of each transaction of the active chain.
+ *
+ * Keys have the type [DB_ACCOUNT_HISTORY, account ID, ~height (BE), ~tx index (BE)]. The height and
+ * the position in the block are inverted, so that the entries of an account are read newest first,
+ * and a seek to a height finds the newest entry at or below it. Each entry holds the balance after
+ * its transaction, so the balance at any height is a single seek. Entries only depend on the block
+ * and its undo data, which makes writing a block again idempotent.
+ */
+constexpr char DB_ACCOUNT_HISTORY = 'h';
+
+std::unique_ptr<AccountHistoryIndex> g_accounthistoryindex;
+
+namespace {
+
+struct DBHistoryKey {
+    CAccountID accountID;
+    int height;
+    uint32_t tx_index;
+
+    DBHistoryKey() : height(0), tx_index(0) {}
+    DBHistoryKey(const CAccountID& accountID_in, int height_in, uint32_t tx_index_in) :
+        accountID(accountID_in), height(height_in), tx_index(tx_index_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ACCOUNT_HISTORY);
+        s << accountID;
+        ser_writedata32be(s, ~static_cast<uint32_t>(height));
+        ser_writedata32be(s, ~tx_index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ACCOUNT_HISTORY) {
+            throw std::ios_base::failure("Invalid format for account history index DB key");
+        }
+        s >> accountID;
+        height = static_cast<int>(~ser_readdata32be(s));
+        tx_index = ~ser_readdata32be(s);
+    }
+};
+
+struct DBHistoryVal {
+    uint256 txid;
+    CAmount delta;
+    CAmount balance;
+    uint32_t payload_type;
+    bool payload_spent;
+
+    DBHistoryVal() : delta(0), balance(0), payload_type(TXOUT_TYPE_UNKNOWN), payload_spent(false) {}
+    explicit DBHistoryVal(const CAccountHistoryEntry& entry) : txid(entry.txid), delta(entry.nDelta),
+        balance(entry.nBalance), payload_type(entry.payloadType), payload_spent(entry.fPayloadSpent) {}
+
+    CAccountHistoryEntry ToEntry(const DBHistoryKey& key) const
+    {
+        CAccountHistoryEntry entry;
+        entry.nHeight = key.height;
+        entry.nTxIndex = key.tx_index;
+        entry.txid = txid;
+        entry.nDelta = delta;
+        entry.nBalance = balance;
+        entry.payloadType = static_cast<TxOutType>(payload_type);
+        entry.fPayloadSpent = payload_spent;
+        return entry;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(delta);
+        READWRITE(balance);
+        READWRITE(payload_type);
+        READWRITE(payload_spent);
+    }
+};
+
+typedef std::vector<std::pair<CAccountID, CAccountHistoryEntry>> AccountHistoryEntries;
+
+/** The entries of the accounts touched by a block, in the order of the transactions. Balances are not set */
+AccountHistoryEntries ReadBlockEntries(const CBlock& block, const CBlockUndo& blockUndo, int nHeight)
+{
+    AccountHistoryEntries vEntries;
+    for (uint32_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        std::map<CAccountID, CAccountHistoryEntry> mapTxEntries;
+        auto getEntry = [&](const CAccountID& accountID) -> CAccountHistoryEntry& {
+            CAccountHistoryEntry& entry = mapTxEntries[accountID];
+            entry.nHeight = nHeight;
+            entry.nTxIndex = i;
+            entry.txid = tx.GetHash();
+            return entry;
+        };
+        auto setPayload = [&](const CAccountID& accountID, TxOutType type, bool fSpent) {
+            if (accountID.IsNull())
+                return;
+            CAccountHistoryEntry& entry = getEntry(accountID);
+            // A created payload is reported over a spent one, e.g. for rebinding a plotter
+            if (entry.payloadType == TXOUT_TYPE_UNKNOWN || (entry.fPayloadSpent && !fSpent)) {
+                entry.payloadType = type;
+                entry.fPayloadSpent = fSpent;
+            }
+        };
+        auto addPayload = [&](const CAccountID& accountID, const CTxOutPayloadRef& payload, bool fSpent) {
+            if (!payload)
+                return;
+            setPayload(accountID, payload->type, fSpent);
+            // The receiver of a point or staking is part of its history too
+            if (payload->type == TXOUT_TYPE_POINT)
+                setPayload(PointPayload::As(payload)->GetReceiverID(), payload->type, fSpent);
+            else if (payload->type == TXOUT_TYPE_STAKING)
+                setPayload(StakingPayload::As(payload)->GetReceiverID(), payload->type, fSpent);
+        };
+
+        if (!tx.IsCoinBase()) {
+            for (const Coin& coin : blockUndo.vtxundo[i - 1].vprevout) {
+                const CAccountID& accountID = coin.GetAccountID();
+                if (accountID.IsNull())
+                    continue;
+                getEntry(accountID).nDelta -= coin.out.nValue;
+                addPayload(accountID, coin.GetPayload(), true);
+            }
+        }
+        for (const CTxOut& txout : tx.vout) {
+            const CAccountID accountID = ExtractAccountID(txout.scriptPubKey);
+            if (accountID.IsNull())
+                continue;
+            getEntry(accountID).nDelta += txout.nValue;
+            addPayload(accountID, ExtractTxoutPayload(txout, nHeight, {TXOUT_TYPE_BINDPLOTTER, TXOUT_TYPE_POINT, TXOUT_TYPE_STAKING}), false);
+        }
+
+        for (auto& pair : mapTxEntries)
+            vEntries.emplace_back(pair.first, std::move(pair.second));
+    }
+    return vEntries;
+}
+
+/** Read a block and its undo data, which are required to know the accounts of the spent coins */
+bool ReadBlockAndUndo(CBlock& block, CBlockUndo& blockUndo, const CBlockIndex* pindex)
+{
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (!UndoReadFromDisk(blockUndo, pindex)) {
+        return error("%s: Failed to read undo data of block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Undo data of block %s does not match its transactions", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+}; // namespace
+
+/**
+ * Access to the account history index database (indexes/accounthistory/)
+ */
+class AccountHistoryIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Read the balance of an account after the block at the height, from its newest entry at or
+    /// below that height.
+    CAmount ReadBalance(const CAccountID& accountID, int nHeight);
+};
+
+AccountHistoryIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "accounthistory", n_cache_size, f_memory, f_wipe)
+{}
+
+CAmount AccountHistoryIndex::DB::ReadBalance(const CAccountID& accountID, int nHeight)
+{
+    if (nHeight <= 0)
+        return 0;
+
+    std::unique_ptr<CDBIterator> cursor(NewIterator());
+    cursor->Seek(DBHistoryKey(accountID, nHeight, std::numeric_limits<uint32_t>::max()));
+    DBHistoryKey key;
+    DBHistoryVal value;
+    if (cursor->Valid() && cursor->GetKey(key) && key.accountID == accountID && cursor->GetValue(value))
+        return value.balance;
+    return 0;
+}
+
+AccountHistoryIndex::AccountHistoryIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AccountHistoryIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AccountHistoryIndex::~AccountHistoryIndex() {}
+
+bool AccountHistoryIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo blockUndo;
+    if (!UndoReadFromDisk(blockUndo, pindex) || blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    // Running balances of the accounts touched by the block
+    std::map<CAccountID, CAmount> mapBalances;
+    CDBBatch batch(*m_db);
+    for (auto& pair : ReadBlockEntries(block, blockUndo, pindex->nHeight)) {
+        auto it = mapBalances.find(pair.first);
+        if (it == mapBalances.end())
+            it = mapBalances.emplace(pair.first, m_db->ReadBalance(pair.first, pindex->nHeight - 1)).first;
+        it->second += pair.second.nDelta;
+        pair.second.nBalance = it->second;
+        batch.Write(DBHistoryKey(pair.first, pindex->nHeight, pair.second.nTxIndex), DBHistoryVal(pair.second));
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AccountHistoryIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockUndo;
+        if (!ReadBlockAndUndo(block, blockUndo, pindex)) {
+            return false;
+        }
+        for (const auto& pair : ReadBlockEntries(block, blockUndo, pindex->nHeight)) {
+            batch.Erase(DBHistoryKey(pair.first, pindex->nHeight, pair.second.nTxIndex));
+        }
+    }
+    if (!m_db->WriteBatch(batch)) {
+        return error("%s: Failed to erase the entries of disconnected blocks", __func__);
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AccountHistoryIndex::GetDB() const { return *m_db; }
+
+bool AccountHistoryIndex::FindHistory(const CAccountID& accountID, int nMinHeight, int nMaxHeight, const std::set<TxOutType>& filters,
+    size_t nSkip, size_t nCount, std::vector<CAccountHistoryEntry>& entries) const
+{
+    entries.clear();
+    if (nMaxHeight < nMinHeight || nMaxHeight <= 0 || nCount == 0)
+        return true;
+
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(DBHistoryKey(accountID, nMaxHeight, std::numeric_limits<uint32_t>::max())); cursor->Valid(); cursor->Next()) {
+        DBHistoryKey key;
+        if (!cursor->GetKey(key) || key.accountID != accountID || key.height < nMinHeight)
+            break;
+        DBHistoryVal value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse account history record", __func__);
+        }
+        if (!filters.empty() && !filters.count(static_cast<TxOutType>(value.payload_type)))
+            continue;
+        if (nSkip > 0) {
+            nSkip--;
+            continue;
+        }
+        entries.push_back(value.ToEntry(key));
+        if (entries.size() >= nCount)
+            break;
+    }
+    return true;
+}
+
+CAmount AccountHistoryIndex::GetBalance(const CAccountID& accountID, int nHeight) const
+{
+    return m_db->ReadBalance(accountID, nHeight);
+}
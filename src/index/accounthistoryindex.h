@@ -0,0 +1,83 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ACCOUNTHISTORYINDEX_H
+#define BITCOIN_INDEX_ACCOUNTHISTORYINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <script/standard.h>
+
+#include <set>
+#include <vector>
+
+/** A transaction of the active chain that changed the balance of an account, or carried its bind plotter, point or staking */
+struct CAccountHistoryEntry
+{
+    int nHeight;
+    //! Position of the transaction in the block
+    uint32_t nTxIndex;
+    uint256 txid;
+    //! Change of the balance by the transaction, the received outputs minus the spent coins
+    CAmount nDelta;
+    //! Balance of the account after the transaction
+    CAmount nBalance;
+    //! Bind plotter, point or staking created or spent by the transaction. TXOUT_TYPE_UNKNOWN for plain transfers
+    TxOutType payloadType;
+    //! Whether the payload coin was spent (unbind, withdraw) rather than created
+    bool fPayloadSpent;
+
+    CAccountHistoryEntry() : nHeight(0), nTxIndex(0), nDelta(0), nBalance(0), payloadType(TXOUT_TYPE_UNKNOWN), fPayloadSpent(false) {}
+};
+
+/**
+ * AccountHistoryIndex is used to look up the transactions of an account and its balance at a height.
+ * The index is written to a LevelDB database and records one entry for each account of each
+ * transaction, ordered by account and then newest first.
+ */
+class AccountHistoryIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    /// Erase the entries of the disconnected blocks before moving the best block back.
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "accounthistoryindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AccountHistoryIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AccountHistoryIndex() override;
+
+    /// Look up the history of an account, newest first.
+    ///
+    /// @param[in]   accountID  The account.
+    /// @param[in]   nMinHeight, nMaxHeight  The range of block heights, both inclusive.
+    /// @param[in]   filters  Only entries with these payload types. All entries if empty.
+    /// @param[in]   nSkip  Number of the newest matching entries to skip.
+    /// @param[in]   nCount  Maximum number of entries to return.
+    /// @param[out]  entries  The entries found.
+    /// @return  false on database errors
+    bool FindHistory(const CAccountID& accountID, int nMinHeight, int nMaxHeight, const std::set<TxOutType>& filters,
+        size_t nSkip, size_t nCount, std::vector<CAccountHistoryEntry>& entries) const;
+
+    /// Balance of an account after the block at the height, confirmed coins only.
+    CAmount GetBalance(const CAccountID& accountID, int nHeight) const;
+};
+
+/// The global account history index. May be null.
+extern std::unique_ptr<AccountHistoryIndex> g_accounthistoryindex;
+
+#endif // BITCOIN_INDEX_ACCOUNTHISTORYINDEX_H
@@ -11,10 +11,17 @@
 #include <validation.h>
 #include <warnings.h>
 
+#include <condition_variable>
+#include <deque>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+//! Number of blocks each sync worker may read ahead of the block written by the sync thread
+constexpr size_t SYNC_READ_AHEAD_BLOCKS = 16;
+
+int g_index_sync_threads = 0;
 
 template<typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
@@ -69,6 +76,155 @@ bool BaseIndex::Init()
     return true;
 }
 
+/**
+ * The blocks following the best block of an index sync. Worker threads read and prepare them in
+ * any order, and the sync thread takes them in height order. Without workers the sync thread
+ * reads and prepares each block when taking it.
+ */
+class BaseIndex::SyncQueue
+{
+public:
+    struct Item
+    {
+        const CBlockIndex* const pindex;
+        CBlock block;
+        bool fRead{false};
+        //! Null if the block could not be read or prepared
+        std::unique_ptr<PreparedBlock> prepared;
+        //! Set, once a worker took the block
+        bool fStarted{false};
+        //! Set, once the block was read and prepared, or that failed
+        bool fDone{false};
+
+        explicit Item(const CBlockIndex* pindex_in) : pindex(pindex_in) {}
+    };
+
+private:
+    const BaseIndex& m_index;
+    const size_t m_nMaxSize;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::shared_ptr<Item>> m_items GUARDED_BY(m_mutex);
+    //! Number of the queued blocks taken by the workers
+    size_t m_nStarted GUARDED_BY(m_mutex){0};
+    bool m_fStop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+
+    void Process(Item& item) const
+    {
+        item.fRead = ReadBlockFromDisk(item.block, item.pindex, Params().GetConsensus());
+        if (item.fRead) {
+            item.prepared = m_index.PrepareBlock(item.block, item.pindex);
+        }
+    }
+
+    void ThreadWork()
+    {
+        for (;;) {
+            std::shared_ptr<Item> item;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_fStop || m_nStarted < m_items.size(); });
+                if (m_fStop) return;
+                item = m_items[m_nStarted++];
+                item->fStarted = true;
+            }
+
+            Process(*item);
+
+            {
+                LOCK(m_mutex);
+                item->fDone = true;
+            }
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    SyncQueue(const BaseIndex& index, int nThreads)
+        : m_index(index), m_nMaxSize(std::max(nThreads, 1) * SYNC_READ_AHEAD_BLOCKS)
+    {
+        for (int i = 0; i < nThreads; ++i) {
+            m_threads.emplace_back([this, i] {
+                util::ThreadRename(strprintf("%s.%i", m_index.GetName(), i));
+                ThreadWork();
+            });
+        }
+    }
+
+    ~SyncQueue()
+    {
+        {
+            LOCK(m_mutex);
+            m_fStop = true;
+        }
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    bool Empty()
+    {
+        LOCK(m_mutex);
+        return m_items.empty();
+    }
+
+    /// The next block to be taken. The queue must not be empty.
+    const CBlockIndex* Front()
+    {
+        LOCK(m_mutex);
+        return m_items.front()->pindex;
+    }
+
+    void Push(const CBlockIndex* pindex)
+    {
+        {
+            LOCK(m_mutex);
+            m_items.push_back(std::make_shared<Item>(pindex));
+        }
+        m_cond.notify_all();
+    }
+
+    /// Queue the successors of the last block on the active chain, up to the read ahead limit.
+    /// Stops at a block that is not on the active chain any more, the sync thread handles
+    /// reorgs once it took the queued blocks.
+    void Fill() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        AssertLockHeld(cs_main);
+        {
+            LOCK(m_mutex);
+            while (!m_items.empty() && m_items.size() < m_nMaxSize) {
+                const CBlockIndex* pindex = ::ChainActive().Next(m_items.back()->pindex);
+                if (!pindex) break;
+                m_items.push_back(std::make_shared<Item>(pindex));
+            }
+        }
+        m_cond.notify_all();
+    }
+
+    /// Wait for the next block to be read and prepared, and remove it from the queue. The queue
+    /// must not be empty.
+    std::shared_ptr<Item> Pop()
+    {
+        std::shared_ptr<Item> item;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            item = m_items.front();
+            if (!m_threads.empty()) {
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return item->fDone; });
+                m_nStarted--;
+            }
+            m_items.pop_front();
+        }
+        if (m_threads.empty()) {
+            Process(*item);
+        }
+        return item;
+    }
+};
+
 static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(cs_main);
@@ -89,7 +245,7 @@ void BaseIndex::ThreadSync()
 {
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
+        SyncQueue queue(*this, g_index_sync_threads);
 
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
@@ -105,20 +261,25 @@ void BaseIndex::ThreadSync()
 
             {
                 LOCK(cs_main);
-                const CBlockIndex* pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
-                    m_best_block_index = pindex;
-                    m_synced = true;
-                    // No need to handle errors in Commit. See rationale above.
-                    Commit();
-                    break;
-                }
-                if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
-                    FatalError("%s: Failed to rewind index %s to a previous chain tip",
-                               __func__, GetName());
-                    return;
+                if (queue.Empty()) {
+                    const CBlockIndex* pindex_next = NextSyncBlock(pindex);
+                    if (!pindex_next) {
+                        m_best_block_index = pindex;
+                        m_synced = true;
+                        // No need to handle errors in Commit. See rationale above.
+                        Commit();
+                        break;
+                    }
+                    if (pindex_next->pprev != pindex && !Rewind(pindex, pindex_next->pprev)) {
+                        FatalError("%s: Failed to rewind index %s to a previous chain tip",
+                                   __func__, GetName());
+                        return;
+                    }
+                    queue.Push(pindex_next);
                 }
-                pindex = pindex_next;
+                queue.Fill();
+                // The queued blocks follow each other, so the next one connects to the index
+                pindex = queue.Front();
             }
 
             int64_t current_time = GetTime();
@@ -135,13 +296,13 @@ void BaseIndex::ThreadSync()
                 Commit();
             }
 
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            std::shared_ptr<SyncQueue::Item> item = queue.Pop();
+            if (!item->fRead) {
                 FatalError("%s: Failed to read block %s from disk",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
             }
-            if (!WriteBlock(block, pindex)) {
+            if (!item->prepared || !WritePreparedBlock(item->block, pindex, *item->prepared)) {
                 FatalError("%s: Failed to write block %s to index database",
                            __func__, pindex->GetBlockHash().ToString());
                 return;
@@ -156,6 +317,16 @@ void BaseIndex::ThreadSync()
     }
 }
 
+std::unique_ptr<BaseIndex::PreparedBlock> BaseIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
+{
+    return MakeUnique<PreparedBlock>();
+}
+
+bool BaseIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared)
+{
+    return WriteBlock(block, pindex);
+}
+
 bool BaseIndex::Commit()
 {
     CDBBatch batch(GetDB());
@@ -222,7 +393,8 @@ void BaseIndex::BlockConnected(const std::shared_ptr<const CBlock>& block, const
         }
     }
 
-    if (WriteBlock(*block, pindex)) {
+    std::unique_ptr<PreparedBlock> prepared = PrepareBlock(*block, pindex);
+    if (prepared && WritePreparedBlock(*block, pindex, *prepared)) {
         m_best_block_index = pindex;
     } else {
         FatalError("%s: Failed to write block %s to index",
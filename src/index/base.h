@@ -12,8 +12,18 @@
 #include <uint256.h>
 #include <validationinterface.h>
 
+#include <memory>
+
 class CBlockIndex;
 
+/** Maximum number of worker threads reading blocks for an index sync */
+static const int MAX_INDEX_SYNC_THREADS = 16;
+/** -indexsyncthreads default (number of worker threads, 0 = auto) */
+static const int DEFAULT_INDEX_SYNC_THREADS = 0;
+
+/** Number of worker threads of each index sync, 0 reads and writes the blocks in the sync thread */
+extern int g_index_sync_threads;
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -47,11 +57,15 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    class SyncQueue;
+
     /// Sync the index with the block index starting from the current best block.
     /// Intended to be run in its own thread, m_thread_sync, and can be
     /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
     /// flag is set and the BlockConnected ValidationInterface callback takes
-    /// over and the sync thread exits.
+    /// over and the sync thread exits. The blocks ahead of the index are read
+    /// and prepared by g_index_sync_threads workers, and written in height order
+    /// by the sync thread.
     void ThreadSync();
 
     /// Write the current index state (eg. chain block locator and subclass-specific items) to disk.
@@ -73,6 +87,22 @@ protected:
     /// Initialize internal state from the database and block index.
     virtual bool Init();
 
+    /// Index data of a block computed ahead of writing it, see PrepareBlock.
+    struct PreparedBlock
+    {
+        virtual ~PreparedBlock() {}
+    };
+
+    /// Compute the index data of a block that does not depend on the earlier blocks, e.g. read its
+    /// undo data or build its filter. Called by the sync workers out of height order, so it must
+    /// neither access the index database nor the state written by WritePreparedBlock.
+    /// @return  null on errors
+    virtual std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const;
+
+    /// Write update index entries for a newly connected block from its prepared data. Called in
+    /// height order. Defaults to WriteBlock.
+    virtual bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared);
+
     /// Write update index entries for a newly connected block.
     virtual bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) { return true; }
 
@@ -0,0 +1,321 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/bindplotterindex.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores each bind plotter coin twice, by plotter and by account, together with
+ * the block that spent it. This keeps the spent binds, which the coins database drops.
+ *
+ * Keys for the plotter index have the type [DB_PLOTTER_BIND, plotter ID (BE), ~height (BE), ~outpoint],
+ * the same order as the bind entries of the coins database, so the newest bind of a plotter comes first.
+ * Keys for the account index have the type [DB_ACCOUNT_BIND, account ID, plotter ID (BE), ~height (BE), ~outpoint].
+ */
+constexpr char DB_PLOTTER_BIND = 'p';
+constexpr char DB_ACCOUNT_BIND = 'a';
+
+std::unique_ptr<BindPlotterIndex> g_bindplotterindex;
+
+namespace {
+
+template<typename Stream>
+void SerializeBind(Stream& s, const uint64_t& plotterId, int height, const COutPoint& outpoint)
+{
+    ser_writedata32be(s, (uint32_t) (plotterId >> 32));
+    ser_writedata32be(s, (uint32_t) plotterId);
+    ser_writedata32be(s, ~static_cast<uint32_t>(height));
+    for (const unsigned char* it = outpoint.hash.begin(); it != outpoint.hash.end(); it++)
+        ser_writedata8(s, (uint8_t) ~*it);
+    ser_writedata32be(s, ~outpoint.n);
+}
+
+template<typename Stream>
+void UnserializeBind(Stream& s, uint64_t& plotterId, int& height, COutPoint& outpoint)
+{
+    plotterId = (uint64_t) ser_readdata32be(s) << 32;
+    plotterId |= ser_readdata32be(s);
+    height = static_cast<int>(~ser_readdata32be(s));
+    for (unsigned char* it = outpoint.hash.begin(); it != outpoint.hash.end(); it++)
+        *it = (unsigned char) ~ser_readdata8(s);
+    outpoint.n = ~ser_readdata32be(s);
+}
+
+//! The outpoint which sorts first for a height, for seeking
+const COutPoint SEEK_OUTPOINT(uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"), 0xffffffff);
+
+struct DBPlotterKey {
+    uint64_t plotterId;
+    int height;
+    COutPoint outpoint;
+
+    DBPlotterKey() : plotterId(0), height(0) {}
+    DBPlotterKey(const uint64_t& plotterId_in, int height_in, const COutPoint& outpoint_in) :
+        plotterId(plotterId_in), height(height_in), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_PLOTTER_BIND);
+        SerializeBind(s, plotterId, height, outpoint);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_PLOTTER_BIND) {
+            throw std::ios_base::failure("Invalid format for bind plotter index DB plotter key");
+        }
+        UnserializeBind(s, plotterId, height, outpoint);
+    }
+};
+
+struct DBAccountKey {
+    CAccountID accountID;
+    uint64_t plotterId;
+    int height;
+    COutPoint outpoint;
+
+    DBAccountKey() : plotterId(0), height(0) {}
+    DBAccountKey(const CAccountID& accountID_in, const uint64_t& plotterId_in, int height_in, const COutPoint& outpoint_in) :
+        accountID(accountID_in), plotterId(plotterId_in), height(height_in), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ACCOUNT_BIND);
+        s << accountID;
+        SerializeBind(s, plotterId, height, outpoint);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ACCOUNT_BIND) {
+            throw std::ios_base::failure("Invalid format for bind plotter index DB account key");
+        }
+        s >> accountID;
+        UnserializeBind(s, plotterId, height, outpoint);
+    }
+};
+
+struct DBBindVal {
+    CAccountID accountID;
+    int32_t spend_height;
+    uint256 spend_txid;
+
+    DBBindVal() : spend_height(-1) {}
+    explicit DBBindVal(const CBindPlotterEvent& event) :
+        accountID(event.accountID), spend_height(event.nSpendHeight), spend_txid(event.spendTxid) {}
+
+    CBindPlotterEvent ToEvent(const uint64_t& plotterId, int height, const COutPoint& outpoint) const
+    {
+        CBindPlotterEvent event;
+        event.plotterId = plotterId;
+        event.accountID = accountID;
+        event.outpoint = outpoint;
+        event.nHeight = height;
+        event.nSpendHeight = spend_height;
+        event.spendTxid = spend_txid;
+        return event;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(accountID);
+        READWRITE(spend_height);
+        READWRITE(spend_txid);
+    }
+};
+
+void WriteEvent(CDBBatch& batch, const CBindPlotterEvent& event)
+{
+    const DBBindVal value(event);
+    batch.Write(DBPlotterKey(event.plotterId, event.nHeight, event.outpoint), value);
+    batch.Write(DBAccountKey(event.accountID, event.plotterId, event.nHeight, event.outpoint), value);
+}
+
+void EraseEvent(CDBBatch& batch, const CBindPlotterEvent& event)
+{
+    batch.Erase(DBPlotterKey(event.plotterId, event.nHeight, event.outpoint));
+    batch.Erase(DBAccountKey(event.accountID, event.plotterId, event.nHeight, event.outpoint));
+}
+
+/** The bind coins spent and created by a block */
+void ReadBlockEvents(const CBlock& block, const CBlockUndo& blockUndo, int nHeight,
+    std::vector<CBindPlotterEvent>& vSpent, std::vector<CBindPlotterEvent>& vCreated)
+{
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& txUndo = blockUndo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txUndo.vprevout[j];
+                if (!coin.IsBindPlotter())
+                    continue;
+                CBindPlotterEvent event;
+                event.plotterId = BindPlotterPayload::As(coin.GetPayload())->GetId();
+                event.accountID = coin.GetAccountID();
+                event.outpoint = tx.vin[j].prevout;
+                event.nHeight = (int) coin.nHeight;
+                event.nSpendHeight = nHeight;
+                event.spendTxid = tx.GetHash();
+                vSpent.push_back(event);
+            }
+        }
+        for (uint32_t n = 0; n < tx.vout.size(); n++) {
+            CTxOutPayloadRef payload = ExtractTxoutPayload(tx.vout[n], nHeight, {TXOUT_TYPE_BINDPLOTTER});
+            if (!payload)
+                continue;
+            CBindPlotterEvent event;
+            event.plotterId = BindPlotterPayload::As(payload)->GetId();
+            event.accountID = ExtractAccountID(tx.vout[n].scriptPubKey);
+            event.outpoint = COutPoint(tx.GetHash(), n);
+            event.nHeight = nHeight;
+            vCreated.push_back(event);
+        }
+    }
+}
+
+}; // namespace
+
+/**
+ * Access to the bind plotter index database (indexes/bindplotter/)
+ */
+class BindPlotterIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+BindPlotterIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "bindplotter", n_cache_size, f_memory, f_wipe)
+{}
+
+BindPlotterIndex::BindPlotterIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BindPlotterIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+BindPlotterIndex::~BindPlotterIndex() {}
+
+bool BindPlotterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    CBlockUndo blockUndo;
+    if (!UndoReadFromDisk(blockUndo, pindex) || blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: Failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    std::vector<CBindPlotterEvent> vSpent, vCreated;
+    ReadBlockEvents(block, blockUndo, pindex->nHeight, vSpent, vCreated);
+    if (vSpent.empty() && vCreated.empty())
+        return true;
+
+    // Binds spent in the same block are written again with their spend
+    CDBBatch batch(*m_db);
+    for (const CBindPlotterEvent& event : vCreated)
+        WriteEvent(batch, event);
+    for (const CBindPlotterEvent& event : vSpent)
+        WriteEvent(batch, event);
+    return m_db->WriteBatch(batch);
+}
+
+bool BindPlotterIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockUndo;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params) || !UndoReadFromDisk(blockUndo, pindex) ||
+                blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        // Blocks are walked newest first, so erasing a bind overrides reverting its spend by a later block
+        std::vector<CBindPlotterEvent> vSpent, vCreated;
+        ReadBlockEvents(block, blockUndo, pindex->nHeight, vSpent, vCreated);
+        for (CBindPlotterEvent& event : vSpent) {
+            event.nSpendHeight = -1;
+            event.spendTxid.SetNull();
+            WriteEvent(batch, event);
+        }
+        for (const CBindPlotterEvent& event : vCreated)
+            EraseEvent(batch, event);
+    }
+    if (!m_db->WriteBatch(batch)) {
+        return error("%s: Failed to revert the binds of disconnected blocks", __func__);
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& BindPlotterIndex::GetDB() const { return *m_db; }
+
+bool BindPlotterIndex::FindPlotterBinds(const uint64_t& plotterId, size_t nCount, std::vector<CBindPlotterEvent>& events) const
+{
+    events.clear();
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(DBPlotterKey(plotterId, -1, SEEK_OUTPOINT)); cursor->Valid() && events.size() < nCount; cursor->Next()) {
+        DBPlotterKey key;
+        if (!cursor->GetKey(key) || key.plotterId != plotterId)
+            break;
+        DBBindVal value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse bind plotter index record", __func__);
+        }
+        events.push_back(value.ToEvent(key.plotterId, key.height, key.outpoint));
+    }
+    return true;
+}
+
+bool BindPlotterIndex::FindAccountBinds(const CAccountID& accountID, const uint64_t& plotterId, size_t nCount, std::vector<CBindPlotterEvent>& events) const
+{
+    events.clear();
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(DBAccountKey(accountID, plotterId, -1, SEEK_OUTPOINT)); cursor->Valid() && events.size() < nCount; cursor->Next()) {
+        DBAccountKey key;
+        if (!cursor->GetKey(key) || key.accountID != accountID || (plotterId != 0 && key.plotterId != plotterId))
+            break;
+        DBBindVal value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse bind plotter index record", __func__);
+        }
+        events.push_back(value.ToEvent(key.plotterId, key.height, key.outpoint));
+    }
+    return true;
+}
+
+bool BindPlotterIndex::FindActiveBind(const uint64_t& plotterId, int nHeight, CBindPlotterEvent& event) const
+{
+    if (nHeight < 0)
+        return false;
+
+    std::unique_ptr<CDBIterator> cursor(m_db->NewIterator());
+    for (cursor->Seek(DBPlotterKey(plotterId, nHeight, SEEK_OUTPOINT)); cursor->Valid(); cursor->Next()) {
+        DBPlotterKey key;
+        if (!cursor->GetKey(key) || key.plotterId != plotterId)
+            break;
+        DBBindVal value;
+        if (!cursor->GetValue(value)) {
+            return error("%s: cannot parse bind plotter index record", __func__);
+        }
+        event = value.ToEvent(key.plotterId, key.height, key.outpoint);
+        if (event.IsUnspentAt(nHeight))
+            return true;
+    }
+    return false;
+}
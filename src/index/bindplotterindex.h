@@ -0,0 +1,77 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BINDPLOTTERINDEX_H
+#define BITCOIN_INDEX_BINDPLOTTERINDEX_H
+
+#include <index/base.h>
+#include <script/standard.h>
+
+#include <vector>
+
+/** A bind plotter coin of the active chain, and where it was spent (unbind or rebind) */
+struct CBindPlotterEvent
+{
+    uint64_t plotterId;
+    CAccountID accountID;
+    COutPoint outpoint;
+    int nHeight;
+    //! Height of the block spending the bind coin, -1 while unspent
+    int nSpendHeight;
+    uint256 spendTxid;
+
+    CBindPlotterEvent() : plotterId(0), nHeight(-1), nSpendHeight(-1) {}
+
+    bool IsSpent() const { return nSpendHeight >= 0; }
+
+    //! Whether the bind coin existed after the block at the height
+    bool IsUnspentAt(int nAtHeight) const { return nHeight <= nAtHeight && (nSpendHeight < 0 || nSpendHeight > nAtHeight); }
+};
+
+/**
+ * BindPlotterIndex is used to look up all binds of a plotter or of an account, including the
+ * spent ones, and which account controlled a plotter at a height. The index is written to a
+ * LevelDB database and records each bind coin by plotter ID and by account.
+ */
+class BindPlotterIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    /// Erase the binds and revert the unbinds of the disconnected blocks before moving the best block back.
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "bindplotterindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BindPlotterIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~BindPlotterIndex() override;
+
+    /// Look up the binds of a plotter, newest first.
+    bool FindPlotterBinds(const uint64_t& plotterId, size_t nCount, std::vector<CBindPlotterEvent>& events) const;
+
+    /// Look up the binds of an account, newest first within each plotter. All plotters if plotterId is 0.
+    bool FindAccountBinds(const CAccountID& accountID, const uint64_t& plotterId, size_t nCount, std::vector<CBindPlotterEvent>& events) const;
+
+    /// Look up the bind that was active for a plotter after the block at the height, the newest unspent
+    /// one, as the coins view selects it at the tip.
+    /// @return  false if the plotter was not bound at the height or on database errors
+    bool FindActiveBind(const uint64_t& plotterId, int nHeight, CBindPlotterEvent& event) const;
+};
+
+/// The global bind plotter index. May be null.
+extern std::unique_ptr<BindPlotterIndex> g_bindplotterindex;
+
+#endif // BITCOIN_INDEX_BINDPLOTTERINDEX_H
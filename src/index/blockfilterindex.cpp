@@ -212,16 +212,29 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+struct BlockFilterIndex::PreparedFilter : public PreparedBlock
+{
+    BlockFilter filter;
+};
+
+std::unique_ptr<BaseIndex::PreparedBlock> BlockFilterIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
 {
     CBlockUndo block_undo;
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return nullptr;
+    }
+
+    auto prepared = MakeUnique<PreparedFilter>();
+    prepared->filter = BlockFilter(m_filter_type, block, block_undo);
+    return std::unique_ptr<PreparedBlock>(std::move(prepared));
+}
+
+bool BlockFilterIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared)
+{
+    const BlockFilter& filter = static_cast<const PreparedFilter&>(prepared).filter;
     uint256 prev_header;
 
     if (pindex->nHeight > 0) {
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
-        }
-
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(pindex->nHeight - 1), read_out)) {
             return false;
@@ -236,8 +249,6 @@ bool BlockFilterIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, block, block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
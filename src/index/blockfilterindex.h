@@ -35,7 +35,12 @@ protected:
 
     bool CommitInternal(CDBBatch& batch) override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    struct PreparedFilter;
+
+    /// Read the undo data of a block and build its filter.
+    std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared) override;
 
     bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
 
@@ -3,7 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <index/txindex.h>
+#include <memusage.h>
 #include <shutdown.h>
+#include <streams.h>
 #include <ui_interface.h>
 #include <util/system.h>
 #include <util/translation.h>
@@ -42,6 +44,14 @@ struct CDiskTxPos : public FlatFilePos
     }
 };
 
+static size_t RawTxUsage(const std::vector<unsigned char>& raw_tx)
+{
+    // The list node, the map node and the serialized transaction
+    return memusage::MallocUsage(2 * sizeof(void*) + 2 * sizeof(uint256) + sizeof(raw_tx)) +
+        memusage::MallocUsage(4 * sizeof(void*) + sizeof(uint256) + sizeof(void*)) +
+        memusage::DynamicUsage(raw_tx);
+}
+
 /**
  * Access to the txindex database (indexes/txindex/)
  *
@@ -224,8 +234,8 @@ bool TxIndex::DB::MigrateData(CBlockTreeDB& block_tree_db, const CBlockLocator&
     return true;
 }
 
-TxIndex::TxIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
-    : m_db(MakeUnique<TxIndex::DB>(n_cache_size, f_memory, f_wipe))
+TxIndex::TxIndex(size_t n_cache_size, bool f_memory, bool f_wipe, size_t n_raw_cache_size)
+    : m_db(MakeUnique<TxIndex::DB>(n_cache_size, f_memory, f_wipe)), m_raw_cache_size(n_raw_cache_size)
 {}
 
 TxIndex::~TxIndex() {}
@@ -244,48 +254,134 @@ bool TxIndex::Init()
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+struct TxIndex::PreparedTxs : public PreparedBlock
+{
+    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
+};
+
+std::unique_ptr<BaseIndex::PreparedBlock> TxIndex::PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const
 {
+    auto prepared = MakeUnique<PreparedTxs>();
     // Exclude genesis block transaction because outputs are not spendable.
-    if (pindex->nHeight == 0) return true;
+    if (pindex->nHeight == 0) return std::unique_ptr<PreparedBlock>(std::move(prepared));
 
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-    std::vector<std::pair<uint256, CDiskTxPos>> vPos;
-    vPos.reserve(block.vtx.size());
+    prepared->vPos.reserve(block.vtx.size());
     for (const auto& tx : block.vtx) {
-        vPos.emplace_back(tx->GetHash(), pos);
+        prepared->vPos.emplace_back(tx->GetHash(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    return std::unique_ptr<PreparedBlock>(std::move(prepared));
+}
+
+bool TxIndex::WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared)
+{
+    const PreparedTxs& txs = static_cast<const PreparedTxs&>(prepared);
+    if (txs.vPos.empty()) return true;
+    {
+        // Transactions mined again after a reorg move to the new block
+        LOCK(m_raw_cache_mutex);
+        for (const auto& tuple : txs.vPos) {
+            auto it = m_raw_cache_map.find(tuple.first);
+            if (it != m_raw_cache_map.end()) {
+                m_raw_cache_usage -= RawTxUsage(it->second->raw);
+                m_raw_cache.erase(it->second);
+                m_raw_cache_map.erase(it);
+            }
+        }
+    }
+    return m_db->WriteTxs(txs.vPos);
 }
 
 BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
 
-bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
+bool TxIndex::FindCachedTx(const uint256& tx_hash, uint256& block_hash, std::vector<unsigned char>& raw_tx) const
+{
+    LOCK(m_raw_cache_mutex);
+    auto it = m_raw_cache_map.find(tx_hash);
+    if (it == m_raw_cache_map.end()) {
+        return false;
+    }
+    m_raw_cache.splice(m_raw_cache.begin(), m_raw_cache, it->second);
+    block_hash = it->second->block_hash;
+    raw_tx = it->second->raw;
+    return true;
+}
+
+void TxIndex::CacheTx(const uint256& tx_hash, const uint256& block_hash, std::vector<unsigned char> raw_tx) const
+{
+    const size_t usage = RawTxUsage(raw_tx);
+    if (usage > m_raw_cache_size) {
+        return;
+    }
+
+    LOCK(m_raw_cache_mutex);
+    if (m_raw_cache_map.count(tx_hash)) {
+        return;
+    }
+    m_raw_cache.push_front(RawTx{tx_hash, block_hash, std::move(raw_tx)});
+    m_raw_cache_map.emplace(tx_hash, m_raw_cache.begin());
+    m_raw_cache_usage += usage;
+    while (m_raw_cache_usage > m_raw_cache_size) {
+        const RawTx& oldest = m_raw_cache.back();
+        m_raw_cache_usage -= RawTxUsage(oldest.raw);
+        m_raw_cache_map.erase(oldest.txid);
+        m_raw_cache.pop_back();
+    }
+}
+
+bool TxIndex::ReadTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
 {
     CDiskTxPos postx;
     if (!m_db->ReadTxPos(tx_hash, postx)) {
         return false;
     }
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-    if (file.IsNull()) {
-        return error("%s: OpenBlockFile failed", __func__);
-    }
-    CBlockHeader header;
-    try {
-        file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
-            return error("%s: fseek(...) failed", __func__);
-        }
-        file >> tx;
-    } catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    if (!ReadTxFromDisk(tx, block_hash, postx, postx.nTxOffset)) {
+        return error("%s: ReadTxFromDisk failed", __func__);
     }
     if (tx->GetHash() != tx_hash) {
         return error("%s: txid mismatch", __func__);
     }
-    block_hash = header.GetHash();
+    return true;
+}
+
+bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
+{
+    std::vector<unsigned char> raw_tx;
+    if (FindCachedTx(tx_hash, block_hash, raw_tx)) {
+        try {
+            CDataStream ss(raw_tx, SER_DISK, CLIENT_VERSION);
+            ss >> tx;
+            return true;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s", __func__, e.what());
+        }
+    }
+
+    if (!ReadTx(tx_hash, block_hash, tx)) {
+        return false;
+    }
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << tx;
+    CacheTx(tx_hash, block_hash, std::vector<unsigned char>(ss.begin(), ss.end()));
+    return true;
+}
+
+bool TxIndex::FindRawTx(const uint256& tx_hash, uint256& block_hash, std::vector<unsigned char>& raw_tx) const
+{
+    if (FindCachedTx(tx_hash, block_hash, raw_tx)) {
+        return true;
+    }
+
+    CTransactionRef tx;
+    if (!ReadTx(tx_hash, block_hash, tx)) {
+        return false;
+    }
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << tx;
+    raw_tx.assign(ss.begin(), ss.end());
+    CacheTx(tx_hash, block_hash, raw_tx);
     return true;
 }
 
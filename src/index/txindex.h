@@ -7,8 +7,16 @@
 
 #include <chain.h>
 #include <index/base.h>
+#include <sync.h>
 #include <txdb.h>
 
+#include <list>
+#include <map>
+#include <vector>
+
+/** Default for -txindexrawcache, MiB of recently looked up serialized transactions */
+static const int64_t DEFAULT_TXINDEX_RAW_CACHE = 32;
+
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
@@ -22,11 +30,37 @@ protected:
 private:
     const std::unique_ptr<DB> m_db;
 
+    //! A recently looked up transaction, serialized as on disk
+    struct RawTx {
+        uint256 txid;
+        uint256 block_hash;
+        std::vector<unsigned char> raw;
+    };
+
+    /**
+     * Least recently used cache of the transactions looked up, so that the lookups of the same transactions by
+     * the RPCs, e.g. the Omni ones, do not read the block files each time. The most recent is in front.
+     */
+    mutable Mutex m_raw_cache_mutex;
+    mutable std::list<RawTx> m_raw_cache GUARDED_BY(m_raw_cache_mutex);
+    mutable std::map<uint256, std::list<RawTx>::iterator> m_raw_cache_map GUARDED_BY(m_raw_cache_mutex);
+    mutable size_t m_raw_cache_usage GUARDED_BY(m_raw_cache_mutex) = 0;
+    const size_t m_raw_cache_size;
+
+    bool FindCachedTx(const uint256& tx_hash, uint256& block_hash, std::vector<unsigned char>& raw_tx) const;
+    void CacheTx(const uint256& tx_hash, const uint256& block_hash, std::vector<unsigned char> raw_tx) const;
+    bool ReadTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
+
 protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    struct PreparedTxs;
+
+    /// Compute the disk positions of the transactions of a block.
+    std::unique_ptr<PreparedBlock> PrepareBlock(const CBlock& block, const CBlockIndex* pindex) const override;
+
+    bool WritePreparedBlock(const CBlock& block, const CBlockIndex* pindex, PreparedBlock& prepared) override;
 
     BaseIndex::DB& GetDB() const override;
 
@@ -34,7 +68,7 @@ protected:
 
 public:
     /// Constructs the index, which becomes available to be queried.
-    explicit TxIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+    explicit TxIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false, size_t n_raw_cache_size = DEFAULT_TXINDEX_RAW_CACHE << 20);
 
     // Destructor is declared because this class contains a unique_ptr to an incomplete type.
     virtual ~TxIndex() override;
@@ -47,6 +81,10 @@ public:
     /// @return  true if transaction is found, false otherwise
     bool FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
 
+    /// Look up a transaction by hash, serialized with its witness as on disk. Skips the deserialization
+    /// when the transaction is cached.
+    bool FindRawTx(const uint256& tx_hash, uint256& block_hash, std::vector<unsigned char>& raw_tx) const;
+
     // For Omni::GetTransactionByteOffset()
     int ReadTxPos(const uint256& txid) const;
 };
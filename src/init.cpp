@@ -17,13 +17,18 @@
 #include <chainparams.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/shabal256.h>
+#include <dbcompaction.h>
 #include <fs.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/accounthistoryindex.h>
+#include <index/bindplotterindex.h>
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
+#include <metrics.h>
 #include <miner.h>
 #include <net.h>
 #include <net_permissions.h>
@@ -34,7 +39,9 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <pos/pos.h>
 #include <rpc/blockchain.h>
+#include <rpc/cache.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -42,10 +49,12 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <threadpool.h>
 #include <timedata.h>
 #include <torcontrol.h>
 #include <txdb.h>
 #include <txmempool.h>
+#include <txreconciliation.h>
 #include <ui_interface.h>
 #include <util/moneystr.h>
 #include <util/system.h>
@@ -63,7 +72,9 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <functional>
 #include <set>
+#include <thread>
 
 #ifndef WIN32
 #include <attributes.h>
@@ -163,6 +174,9 @@ static CScheduler scheduler;
 
 void Interrupt()
 {
+    InterruptPoSHarvester();
+    InterruptPlotScanner();
+    InterruptPoCServer();
     InterruptPOC();
     InterruptHTTPServer();
     InterruptHTTPRPC();
@@ -176,6 +190,15 @@ void Interrupt()
         g_txindex->Interrupt();
     }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
+    if (g_accounthistoryindex) {
+        g_accounthistoryindex->Interrupt();
+    }
+    if (g_bindplotterindex) {
+        g_bindplotterindex->Interrupt();
+    }
+#ifdef ENABLE_OMNICORE
+    omnicore_api::InterruptIndex();
+#endif
 }
 
 void Shutdown(InitInterfaces& interfaces)
@@ -193,9 +216,13 @@ void Shutdown(InitInterfaces& interfaces)
     util::ThreadRename("shutoff");
     mempool.AddTransactionsUpdated(1);
 
+    StopPoSHarvester();
+    StopPlotScanner();
+    StopPoCServer();
     StopPOC();
     StopHTTPRPC();
     StopREST();
+    StopMetrics();
     StopRPC();
     StopHTTPServer();
     for (const auto& client : interfaces.chain_clients) {
@@ -209,6 +236,7 @@ void Shutdown(InitInterfaces& interfaces)
     if (g_connman) g_connman->Stop();
 
     StopTorControl();
+    GetDBCompactionScheduler().Stop();
 
     // After everything has been shut down, but before things get flushed, stop the
     // CScheduler/checkqueue threadGroup
@@ -259,6 +287,17 @@ void Shutdown(InitInterfaces& interfaces)
     }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
+    if (g_accounthistoryindex) {
+        g_accounthistoryindex->Stop();
+        g_accounthistoryindex.reset();
+    }
+    if (g_bindplotterindex) {
+        g_bindplotterindex->Stop();
+        g_bindplotterindex.reset();
+    }
+#ifdef ENABLE_OMNICORE
+    omnicore_api::StopIndex();
+#endif
 
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
@@ -301,9 +340,11 @@ void Shutdown(InitInterfaces& interfaces)
     UnregisterAllValidationInterfaces();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     GetMainSignals().UnregisterWithMempoolSignals(mempool);
+    GetThreadPool().Stop();
     globalVerifyHandle.reset();
     ECC_Stop();
     LogPrintf("%s: done\n", __func__);
+    LogWriter().Stop();
 }
 
 /**
@@ -381,6 +422,8 @@ void SetupServerArgs()
     gArgs.AddArg("-alertnotify=<cmd>", "Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     gArgs.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-backgroundflush", strprintf("Write the coin database on a background thread, while validation continues on the emptied cache. The coins being written are held in memory in addition to -dbcache until the write completes (default: %u)", DEFAULT_BACKGROUND_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockcompression=<n>", strprintf("Compress new block and undo data on disk with zstd at level <n> (0 to store them raw, 1 to %d, default: %d). Compressed data is read with any setting", MAX_BLOCK_COMPRESSION_LEVEL, DEFAULT_BLOCK_COMPRESSION_LEVEL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -390,7 +433,9 @@ void SetupServerArgs()
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-maxprocessmem=<n>", strprintf("Adapt the in-memory UTXO set to keep the resident memory of the process below <n> MiB. It grows past -dbcache during initial block download and shrinks, down to half of its -dbcache share, when the mempool or the Omni state grow (0 = off, default: %d)", DEFAULT_MAX_PROCESS_MEMORY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbcompactidle=<n>", strprintf("Compact the chainstate and Omni databases in the background, one key range every %d seconds, once no new block arrived for <n> seconds (0 = off, default: %d)", DB_COMPACT_THROTTLE, DEFAULT_DB_COMPACT_IDLE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -408,16 +453,26 @@ void SetupServerArgs()
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-reorgundocache=<n>", strprintf("Keep the undo data of the last <n> connected blocks in memory, so that short reorgs disconnect them without reading it from disk (0 to %d, default: %d)", MAX_REORG_UNDO_CACHE_BLOCKS, DEFAULT_REORG_UNDO_CACHE_BLOCKS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-txindexrawcache=<n>", strprintf("Memory of the cache of transactions recently looked up in the transaction index, in MiB (default: %u)", DEFAULT_TXINDEX_RAW_CACHE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-accounthistoryindex", strprintf("Maintain an index of the transactions and balances of all accounts, used by the getaccounthistory and getbalanceofheight rpc calls (default: %u)", DEFAULT_ACCOUNTHISTORYINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-bindplotterindex", strprintf("Maintain an index of all bind plotter transactions, including the unbound ones, used by the listbindplotterhistory, listbindplotterhistoryofaddress and getbindplotterofheight rpc calls (default: %u)", DEFAULT_BINDPLOTTERINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-indexsyncthreads=<n>", strprintf("Set the number of threads reading blocks ahead of each catching up index (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), MAX_INDEX_SYNC_THREADS, DEFAULT_INDEX_SYNC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-schedulerthreads=<n>", strprintf("Set the number of threads serving the background task scheduler (1 to %d, default: %d)",
+        MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-workthreads=<n>", strprintf("Set the number of worker threads shared by the parallel coins flush, block index load, deadline checks and proof of space lookups (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), MAX_WORK_THREADS, DEFAULT_WORK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -449,6 +504,7 @@ void SetupServerArgs()
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torpassword=<pass>", "Tor control port password (default: empty)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-txreconciliation", strprintf("Offer to reconcile the transaction announcements with peers rather than to flood them (default: %u)", DEFAULT_TXRECONCILIATION), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
 #ifdef USE_UPNP
 #if USE_UPNP
     gArgs.AddArg("-upnp", "Use UPnP to map the listening port (default: 1 when listening and no -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -477,19 +533,43 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubminingjob=<address>", "Enable publish mining job of the next block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubaccountdelta=<address>", "Enable publish account balance changes of connected and disconnected blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubbindplotter=<address>", "Enable publish bind plotter changes of connected and disconnected blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubstakingpool=<address>", "Enable publish staking changes of connected and disconnected blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubomnitx=<address>", "Enable publish Omni transactions of processed blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubomnitally=<address>", "Enable publish Omni balance changes of processed blocks in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubminingjobhwm=<n>", strprintf("Set publish mining job outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubaccountdeltahwm=<n>", strprintf("Set publish account balance changes outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubbindplotterhwm=<n>", strprintf("Set publish bind plotter changes outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubstakingpoolhwm=<n>", strprintf("Set publish staking changes outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubomnitxhwm=<n>", strprintf("Set publish Omni transactions outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubomnitallyhwm=<n>", strprintf("Set publish Omni balance changes outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubminingjob=<address>");
+    hidden_args.emplace_back("-zmqpubaccountdelta=<address>");
+    hidden_args.emplace_back("-zmqpubbindplotter=<address>");
+    hidden_args.emplace_back("-zmqpubstakingpool=<address>");
+    hidden_args.emplace_back("-zmqpubomnitx=<address>");
+    hidden_args.emplace_back("-zmqpubomnitally=<address>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubminingjobhwm=<n>");
+    hidden_args.emplace_back("-zmqpubaccountdeltahwm=<n>");
+    hidden_args.emplace_back("-zmqpubbindplotterhwm=<n>");
+    hidden_args.emplace_back("-zmqpubstakingpoolhwm=<n>");
+    hidden_args.emplace_back("-zmqpubomnitxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubomnitallyhwm=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -501,10 +581,12 @@ void SetupServerArgs()
         "and level 4 tries to reconnect the blocks, "
         "each level includes the checks of the previous levels "
         "(0-4, default: %u)", DEFAULT_CHECKLEVEL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-checkaccountindex", strprintf("Verify account balance totals of the chainstate against a scan of its account index for every query (default: %u)", DEFAULT_CHECKACCOUNTINDEX), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkblockindex", strprintf("Do a consistency check for the block tree, chainstate, and other validation data structures occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-lockstats=<n>", strprintf("Time every <n>th lock acquisition of each thread for getlockstats, 0 to disable (default: %u)", DEFAULT_LOCK_STATS_INTERVAL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopatheight", strprintf("Stop running after reaching the given height in the main chain (default: %u)", DEFAULT_STOPATHEIGHT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -516,12 +598,15 @@ void SetupServerArgs()
     gArgs.AddArg("-debug=<category>", "Output debugging information (default: -nodebug, supplying <category> is optional). "
         "If <category> is not supplied or if <category> = 1, output all debugging information. <category> can be: " + ListLogCategories() + ".", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-debugexclude=<category>", strprintf("Exclude debugging information for a category. Can be used in conjunction with -debug=1 to output debug logs for all categories except one or more specified categories."), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logasync", strprintf("Write debug output on a background thread (default: %u)", DEFAULT_LOGASYNC), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logips", strprintf("Include IP addresses in debug output (default: %u)", DEFAULT_LOGIPS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-logratelimit=<n>", strprintf("Log at most <n> messages per second of each -debug category, 0 = unlimited (default: %u)", DEFAULT_LOGRATELIMIT), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logthreadnames", strprintf("Prepend debug output with name of the originating thread (only available on platforms supporting thread_local) (default: %u)", DEFAULT_LOGTHREADNAMES), ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-maxheadersigcachesize=<n>", strprintf("Limit the cache of verified block header signatures to <n> MiB (default: %u)", DEFAULT_MAX_HEADER_SIG_CACHE_SIZE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-printpriority", strprintf("Log transaction fee per kB when mining blocks (default: %u)", DEFAULT_PRINTPRIORITY), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-printtoconsole", "Send trace/debug info to console (default: 1 when no -daemon. To disable logging to file, set -nodebuglogfile)", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -547,9 +632,13 @@ void SetupServerArgs()
     gArgs.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
 
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-metrics", strprintf("Accept public requests for node metrics in the Prometheus text format at /metrics (default: %u)", DEFAULT_METRICS_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchlimit=<n>", strprintf("Reject JSON-RPC batches of more than <n> requests, 0 for no limit (default: %d)", DEFAULT_RPC_BATCH_LIMIT), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcbatchthreads=<n>", strprintf("Run the requests of a JSON-RPC batch in parallel on <n> threads, replies keep the request order. Only use for batches of independent requests (up to %d, 0 = in order, default: %d)", MAX_RPC_BATCH_THREADS, DEFAULT_RPC_BATCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpccachesize=<n>", strprintf("Cache up to <n> MiB of responses of getblock, getblockheader, getrawtransaction and omni_gettransaction about blocks of at least %d confirmations, 0 to disable (default: %d)", RPC_CACHE_MIN_CONFIRMATIONS, DEFAULT_RPC_CACHE_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpccookiefile=<loc>", "Location of the auth cookie. Relative paths will be prefixed by a net-specific datadir location. (default: data dir)", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcpassword=<pw>", "Password for JSON-RPC connections", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
@@ -562,14 +651,27 @@ void SetupServerArgs()
 
     // Qitcoin
     gArgs.AddArg("-forcecheckdeadline", strprintf("Force check every block work (default: %u)", DEFAULT_CHECKWORK_ENABLED), ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-pocthreads=<n>", strprintf("Set the number of parallel deadline checks for submitted nonces on the shared worker threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), poc::MAX_POC_CHECK_THREADS, poc::DEFAULT_POC_CHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-plotternoncelimit=<n>", strprintf("Set the number of nonces calculated for each plotter and block, later nonces of the plotter are rejected (0 = unlimited, default: %u)", poc::DEFAULT_PLOTTER_NONCE_LIMIT), ArgsManager::ALLOW_ANY, OptionsCategory::POC);
     gArgs.AddArg("-signprivkey", "Import private key for block signature", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-pocserver=<ip>:<port>", "Listen for persistent newline delimited JSON-RPC connections of mining pool software on <ip>:<port> (default: disabled). Connections are not authenticated, do not expose it to untrusted networks", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::POC);
+    gArgs.AddArg("-plotdir=<dir>", "Scan the PoC2 plot files in <dir> on every new tip and submit the best nonce of each plotter, requires -server (can be specified multiple times)", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-plotgenerateto=<address>", "Destination address or private key for block signing of the -plotdir nonces (default: primary address of the wallet)", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-posplotdir=<dir>", "Harvest the chiapos plot files in <dir> of the -posfarmerkey farmer on every new tip and scan iteration, and submit the best proof, requires -server (can be specified multiple times)", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-posfarmerkey=<hex>", "Farmer private key of the -posplotdir plots, in hex", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
+    gArgs.AddArg("-posgenerateto=<address>", "Destination address or private key for block signing of the -posplotdir proofs (default: primary address of the wallet)", ArgsManager::ALLOW_ANY, OptionsCategory::POC);
 
 #ifdef ENABLE_OMNICORE
     gArgs.AddArg("-omni", strprintf("Enable omnicore (default: %u)", DEFAULT_OMNICORE), ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omnistartclean", "Clear all persistence files on startup; triggers reparsing of Omni transactions (default: 0)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnistatesnapshot=<dir>", "Initialize the Omni state from the Omni data directory of another, stopped node in <dir>, if there is no Omni state yet. The state of the latest consensus checkpoint it holds is loaded and verified against the hardcoded consensus hash, and the scan continues from there", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omnitxcache", "The maximum number of transactions in the input transaction cache (default: 500000)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omniprogressfrequency", "Time in seconds after which the initial scanning progress is reported (default: 30)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omniseedblockfilter", "Set skipping of blocks without Omni transactions during initial scan (default: 1)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnimarkerindex", "Maintain an index of blocks with Omni transactions, which is used to skip blocks during scans (default: 1)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
+    gArgs.AddArg("-omniasync", strprintf("Apply blocks to the Omni state asynchronously, after they were connected (default: %u)", DEFAULT_OMNI_ASYNC), ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
+    gArgs.AddArg("-omniscanthreads=<n>", "Set the number of threads reading blocks ahead during initial scan (1 to 16, default: 4)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omnilogfile", "The path of the log file (default: omnicore.log)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omnidebug=<category>", "Enable or disable log categories, can be \"all\" or \"none\"", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
     gArgs.AddArg("-omniautocommit", "Enable or disable broadcasting of transactions, when creating transactions (default: 1)", ArgsManager::ALLOW_ANY, OptionsCategory::OMNI);
@@ -583,9 +685,13 @@ void SetupServerArgs()
 #else
     hidden_args.emplace_back("-omni");
     hidden_args.emplace_back("-omnistartclean");
+    hidden_args.emplace_back("-omnistatesnapshot");
     hidden_args.emplace_back("-omnitxcache");
     hidden_args.emplace_back("-omniprogressfrequency");
     hidden_args.emplace_back("-omniseedblockfilter");
+    hidden_args.emplace_back("-omnimarkerindex");
+    hidden_args.emplace_back("-omniasync");
+    hidden_args.emplace_back("-omniscanthreads");
     hidden_args.emplace_back("-omnilogfile");
     hidden_args.emplace_back("-omnidebug");
     hidden_args.emplace_back("-omniautocommit");
@@ -822,6 +928,7 @@ static bool AppInitServers()
     if (!StartHTTPRPC())
         return false;
     if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE)) StartREST();
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) StartMetrics();
     StartHTTPServer();
     return true;
 }
@@ -905,6 +1012,8 @@ void InitLogging()
     LogInstance().m_log_time_micros = gArgs.GetBoolArg("-logtimemicros", DEFAULT_LOGTIMEMICROS);
     LogInstance().m_log_threadnames = gArgs.GetBoolArg("-logthreadnames", DEFAULT_LOGTHREADNAMES);
 
+    LogInstance().m_log_async = gArgs.GetBoolArg("-logasync", DEFAULT_LOGASYNC);
+    LogInstance().m_rate_limit = (unsigned int) std::max<int64_t>(0, gArgs.GetArg("-logratelimit", DEFAULT_LOGRATELIMIT));
     fLogIPs = gArgs.GetBoolArg("-logips", DEFAULT_LOGIPS);
 
     std::string version_string = FormatFullVersion();
@@ -1027,6 +1136,10 @@ bool AppInitParameterInteraction()
         if (!g_enabled_filter_types.empty()) {
             return InitError(_("Prune mode is incompatible with -blockfilterindex.").translated);
         }
+        if (gArgs.GetBoolArg("-accounthistoryindex", DEFAULT_ACCOUNTHISTORYINDEX))
+            return InitError(_("Prune mode is incompatible with -accounthistoryindex.").translated);
+        if (gArgs.GetBoolArg("-bindplotterindex", DEFAULT_BINDPLOTTERINDEX))
+            return InitError(_("Prune mode is incompatible with -bindplotterindex.").translated);
     }
 
 #ifdef ENABLE_OMNICORE
@@ -1091,6 +1204,7 @@ bool AppInitParameterInteraction()
         mempool.setSanityCheck(1.0 / ratio);
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    g_lock_stats_interval = std::max<int64_t>(0, std::min<int64_t>(std::numeric_limits<int>::max(), gArgs.GetArg("-lockstats", DEFAULT_LOCK_STATS_INTERVAL)));
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
     fCheckWork = gArgs.GetBoolArg("-forcecheckdeadline", DEFAULT_CHECKWORK_ENABLED);
 
@@ -1138,6 +1252,15 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -indexsyncthreads=0 means autodetect, but g_index_sync_threads==0 means the sync thread reads the blocks
+    g_index_sync_threads = gArgs.GetArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS);
+    if (g_index_sync_threads <= 0)
+        g_index_sync_threads += GetNumCores();
+    if (g_index_sync_threads <= 1)
+        g_index_sync_threads = 0;
+    else if (g_index_sync_threads > MAX_INDEX_SYNC_THREADS)
+        g_index_sync_threads = MAX_INDEX_SYNC_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1156,6 +1279,22 @@ bool AppInitParameterInteraction()
         fPruneMode = true;
     }
 
+    nBlockCompressionLevel = gArgs.GetArg("-blockcompression", DEFAULT_BLOCK_COMPRESSION_LEVEL);
+    if (nBlockCompressionLevel < 0 || nBlockCompressionLevel > MAX_BLOCK_COMPRESSION_LEVEL) {
+        return InitError(strprintf(_("Block compression level must be between 0 and %d.").translated, MAX_BLOCK_COMPRESSION_LEVEL));
+    }
+    if (nBlockCompressionLevel > 0) {
+        if (!IsBlockCompressionSupported()) {
+            return InitError(_("Block compression requested, but this build was compiled without zstd.").translated);
+        }
+        LogPrintf("Compressing block and undo data at level %d.\n", nBlockCompressionLevel);
+    }
+
+    nReorgUndoCacheBlocks = gArgs.GetArg("-reorgundocache", DEFAULT_REORG_UNDO_CACHE_BLOCKS);
+    if (nReorgUndoCacheBlocks < 0 || nReorgUndoCacheBlocks > MAX_REORG_UNDO_CACHE_BLOCKS) {
+        return InitError(strprintf(_("Reorg undo cache must be between 0 and %d blocks.").translated, MAX_REORG_UNDO_CACHE_BLOCKS));
+    }
+
     nConnectTimeout = gArgs.GetArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1247,6 +1386,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string shabal256_algo = Shabal256AutoDetect();
+    LogPrintf("Using the '%s' Shabal256 implementation\n", shabal256_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1273,6 +1414,40 @@ bool AppInitLockDataDirectory()
     return true;
 }
 
+/**
+ * A startup phase that does not depend on the block chain, run on its own thread while the block
+ * chain loads. The thread is joined by Wait(), or on an early return of AppInitMain.
+ */
+class StartupTask
+{
+private:
+    std::thread m_thread;
+    bool m_result{true};
+
+public:
+    StartupTask() {}
+    StartupTask(const StartupTask&) = delete;
+    StartupTask& operator=(const StartupTask&) = delete;
+    ~StartupTask() { Wait(); }
+
+    void Start(const char* name, std::function<bool()> func)
+    {
+        assert(!m_thread.joinable());
+        m_thread = std::thread([this, name, func] {
+            util::ThreadRename(name);
+            m_result = func();
+        });
+    }
+
+    /** Wait for the phase to finish. @return false if it failed */
+    bool Wait()
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+        return m_result;
+    }
+};
+
 bool AppInitMain(InitInterfaces& interfaces)
 {
     const CChainParams& chainparams = Params();
@@ -1323,16 +1498,33 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitBindPayloadCache();
+    InitHeaderSignatureCache();
+
+    int nWorkThreads = gArgs.GetArg("-workthreads", DEFAULT_WORK_THREADS);
+    if (nWorkThreads <= 0)
+        nWorkThreads += GetNumCores();
+    nWorkThreads = std::max(1, std::min(nWorkThreads, MAX_WORK_THREADS));
+    LogPrintf("Using %u shared worker threads\n", nWorkThreads);
+    GetThreadPool().Start(nWorkThreads);
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread([i]() { return pos::ThreadProofCheck(i); });
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread([i]() { return ThreadHeaderSignatureCheck(i); });
     }
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads. More than one keeps precise tasks from waiting behind slow ones
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    const int nSchedulerThreads = std::max(1, std::min((int) gArgs.GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
+    for (int i = 1; i < nSchedulerThreads; i++) {
+        threadGroup.create_thread([i, serviceLoop] { TraceThread(strprintf("scheduler.%i", i).c_str(), serviceLoop); });
+    }
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
     GetMainSignals().RegisterWithMempoolSignals(mempool);
@@ -1372,10 +1564,22 @@ bool AppInitMain(InitInterfaces& interfaces)
     }
 
     // ********************************************************* Step 5: verify wallet database integrity
-    for (const auto& client : interfaces.chain_clients) {
-        if (!client->verify()) {
-            return false;
+    // Verifying reads the whole wallet databases, which overlaps with loading the block chain. Salvaging
+    // a wallet takes cs_main and runs before.
+    StartupTask verifyWallets;
+    auto verifyClients = [&interfaces] {
+        for (const auto& client : interfaces.chain_clients) {
+            if (!client->verify()) {
+                return false;
+            }
         }
+        return true;
+    };
+    if (gArgs.GetBoolArg("-salvagewallet", false)) {
+        if (!verifyClients())
+            return false;
+    } else {
+        verifyWallets.Start("walletverify", verifyClients);
     }
 
     // ********************************************************* Step 6: network initialization
@@ -1512,10 +1716,15 @@ bool AppInitMain(InitInterfaces& interfaces)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t nAccountHistoryIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-accounthistoryindex", DEFAULT_ACCOUNTHISTORYINDEX) ? nMaxAccountHistoryIndexCache << 20 : 0);
+    nTotalCache -= nAccountHistoryIndexCache;
+    int64_t nBindPlotterIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-bindplotterindex", DEFAULT_BINDPLOTTERINDEX) ? nMaxBindPlotterIndexCache << 20 : 0);
+    nTotalCache -= nBindPlotterIndexCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    nMaxProcessMemory = std::max<int64_t>(gArgs.GetArg("-maxprocessmem", DEFAULT_MAX_PROCESS_MEMORY), 0) << 20;
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1f MiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
@@ -1526,8 +1735,17 @@ bool AppInitMain(InitInterfaces& interfaces)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (gArgs.GetBoolArg("-accounthistoryindex", DEFAULT_ACCOUNTHISTORYINDEX)) {
+        LogPrintf("* Using %.1f MiB for account history index database\n", nAccountHistoryIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-bindplotterindex", DEFAULT_BINDPLOTTERINDEX)) {
+        LogPrintf("* Using %.1f MiB for bind plotter index database\n", nBindPlotterIndexCache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    if (nMaxProcessMemory > 0) {
+        LogPrintf("* Adapting the in-memory UTXO set to %.1f MiB of process memory\n", nMaxProcessMemory * (1.0 / 1024 / 1024));
+    }
 
     bool fLoaded = false;
     while (!fLoaded && !ShutdownRequested()) {
@@ -1799,7 +2017,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     // ********************************************************* Step 8: start indexers
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
-        g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
+        g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex, std::max<int64_t>(0, gArgs.GetArg("-txindexrawcache", DEFAULT_TXINDEX_RAW_CACHE)) << 20);
         g_txindex->Start();
     }
 
@@ -1808,6 +2026,16 @@ bool AppInitMain(InitInterfaces& interfaces)
         GetBlockFilterIndex(filter_type)->Start();
     }
 
+    if (gArgs.GetBoolArg("-accounthistoryindex", DEFAULT_ACCOUNTHISTORYINDEX)) {
+        g_accounthistoryindex = MakeUnique<AccountHistoryIndex>(nAccountHistoryIndexCache, false, fReindex);
+        g_accounthistoryindex->Start();
+    }
+
+    if (gArgs.GetBoolArg("-bindplotterindex", DEFAULT_BINDPLOTTERINDEX)) {
+        g_bindplotterindex = MakeUnique<BindPlotterIndex>(nBindPlotterIndexCache, false, fReindex);
+        g_bindplotterindex->Start();
+    }
+
 #ifdef ENABLE_OMNICORE
     // ********************************************************* Step 8.5: load omni core
     if (gArgs.GetBoolArg("-omni", DEFAULT_OMNICORE)) {
@@ -1824,6 +2052,8 @@ bool AppInitMain(InitInterfaces& interfaces)
 #endif
 
     // ********************************************************* Step 9: load wallet
+    if (!verifyWallets.Wait())
+        return false;
     for (const auto& client : interfaces.chain_clients) {
         if (!client->load()) {
             return false;
@@ -1992,9 +2222,17 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
+    GetDBCompactionScheduler().Start(scheduler, std::max<int64_t>(0, gArgs.GetArg("-dbcompactidle", DEFAULT_DB_COMPACT_IDLE)));
+
     // PoC module dependency wallets
     if (!StartPOC())
         return false;
+    if (!StartPoCServer())
+        return false;
+    if (!StartPlotScanner())
+        return false;
+    if (!StartPoSHarvester())
+        return false;
 
     return true;
 }
@@ -174,17 +174,22 @@ class LockImpl : public Chain::Lock, public UniqueLock<CCriticalSection>
 class NotificationsHandlerImpl : public Handler, CValidationInterface
 {
 public:
-    explicit NotificationsHandlerImpl(Chain& chain, Chain::Notifications& notifications)
+    explicit NotificationsHandlerImpl(Chain& chain, Chain::Notifications& notifications, bool own_thread)
         : m_chain(chain), m_notifications(&notifications)
     {
-        RegisterValidationInterface(this);
+        if (own_thread) {
+            RegisterValidationInterfaceOnOwnThread(this);
+        } else {
+            RegisterValidationInterface(this);
+        }
     }
     ~NotificationsHandlerImpl() override { disconnect(); }
     void disconnect() override
     {
         if (m_notifications) {
-            m_notifications = nullptr;
+            // Unregister first, which waits for a notification being delivered on an own thread
             UnregisterValidationInterface(this);
+            m_notifications = nullptr;
         }
     }
     void TransactionAddedToMempool(const CTransactionRef& tx) override
@@ -359,9 +364,9 @@ public:
     {
         ::uiInterface.ShowProgress(title, progress, resume_possible);
     }
-    std::unique_ptr<Handler> handleNotifications(Notifications& notifications) override
+    std::unique_ptr<Handler> handleNotifications(Notifications& notifications, bool own_thread) override
     {
-        return MakeUnique<NotificationsHandlerImpl>(*this, notifications);
+        return MakeUnique<NotificationsHandlerImpl>(*this, notifications, own_thread);
     }
     void waitForNotificationsIfNewBlocksConnected(const uint256& old_tip) override
     {
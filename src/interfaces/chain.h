@@ -248,8 +248,9 @@ public:
         virtual void ChainStateFlushed(const CBlockLocator& locator) {}
     };
 
-    //! Register handler for notifications.
-    virtual std::unique_ptr<Handler> handleNotifications(Notifications& notifications) = 0;
+    //! Register handler for notifications. With own_thread, the notifications are
+    //! delivered on a thread of the handler's own instead of the shared scheduler thread.
+    virtual std::unique_ptr<Handler> handleNotifications(Notifications& notifications, bool own_thread = false) = 0;
 
     //! Wait for pending notifications to be processed unless block hash points to the current
     //! chain tip, or to a possible descendant of the current chain tip that isn't currently
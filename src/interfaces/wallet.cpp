@@ -396,6 +396,16 @@ public:
         }
         return result;
     }
+    std::vector<WalletTx> getWalletTxsAfter(const uint256& start, size_t max_count) override
+    {
+        auto locked_chain = m_wallet->chain().lock();
+        LOCK(m_wallet->cs_wallet);
+        std::vector<WalletTx> result;
+        for (auto it = m_wallet->mapWallet.upper_bound(start); it != m_wallet->mapWallet.end() && result.size() < max_count; ++it) {
+            result.emplace_back(MakeWalletTx(*locked_chain, *m_wallet, it->second));
+        }
+        return result;
+    }
     std::vector<WalletTx> getWalletTxsDetails(std::map<uint256, WalletTxStatus>& tx_status) override
     {
         auto locked_chain = m_wallet->chain().lock();
@@ -233,6 +233,9 @@ public:
     //! Get list of all wallet transactions.
     virtual std::vector<WalletTx> getWalletTxs() = 0;
 
+    //! Get up to max_count wallet transactions with hashes greater than start, in hash order.
+    virtual std::vector<WalletTx> getWalletTxsAfter(const uint256& start, size_t max_count) = 0;
+
     //! Get list of all wallet transactions and status.
     virtual std::vector<WalletTx> getWalletTxsDetails(std::map<uint256, WalletTxStatus>& tx_status) = 0;
 
@@ -32,6 +32,13 @@ BCLog::Logger& LogInstance()
     return *g_logger;
 }
 
+BCLog::AsyncWriter& LogWriter()
+{
+    // Leaked like the logger instance, see LogInstance()
+    static BCLog::AsyncWriter* g_writer{new BCLog::AsyncWriter()};
+    return *g_writer;
+}
+
 bool fLogIPs = DEFAULT_LOGIPS;
 
 static int FileWriteStr(const std::string &str, FILE *fp)
@@ -72,11 +79,14 @@ bool BCLog::Logger::StartLogging()
     }
     if (m_print_to_console) fflush(stdout);
 
+    if (m_log_async) LogWriter().Start();
+
     return true;
 }
 
 void BCLog::Logger::DisconnectTestLogger()
 {
+    LogWriter().Stop();
     std::lock_guard<std::mutex> scoped_lock(m_cs);
     m_buffering = true;
     if (m_fileout != nullptr) fclose(m_fileout);
@@ -201,6 +211,34 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
     return ret;
 }
 
+bool BCLog::Logger::RateLimitCategory(BCLog::LogFlags category)
+{
+    if (m_rate_limit == 0)
+        return true;
+
+    int i = 0;
+    while (i < 31 && !(category & (1u << i)))
+        i++;
+    const int64_t now = GetTimeMicros() / 1000000;
+    int64_t second = m_rate_second[i].load();
+    if (second != now && m_rate_second[i].compare_exchange_strong(second, now)) {
+        m_rate_count[i] = 0;
+        const uint32_t suppressed = m_rate_suppressed[i].exchange(0);
+        if (suppressed > 0) {
+            std::string str_category = "?";
+            for (const CLogCategoryDesc& category_desc : LogCategories) {
+                if (category_desc.flag == (1u << i))
+                    str_category = category_desc.category;
+            }
+            LogPrintf("Suppressed %u messages of debug category %s over -logratelimit\n", suppressed, str_category);
+        }
+    }
+    if (++m_rate_count[i] <= m_rate_limit)
+        return true;
+    ++m_rate_suppressed[i];
+    return false;
+}
+
 std::string BCLog::Logger::LogTimestampStr(const std::string& str)
 {
     std::string strStamped;
@@ -267,9 +305,24 @@ void BCLog::Logger::LogPrintStr(const std::string& str)
         return;
     }
 
+    // Queued under m_cs, so that messages keep the order of their timestamps
+    if (LogWriter().Write(&WriteLogInstance, std::move(str_prefixed)))
+        return;
+    WriteOutputs(str_prefixed);
+}
+
+void BCLog::Logger::WriteLogInstance(const std::string& str)
+{
+    Logger& logger = LogInstance();
+    std::lock_guard<std::mutex> scoped_lock(logger.m_cs);
+    logger.WriteOutputs(str);
+}
+
+void BCLog::Logger::WriteOutputs(const std::string& str)
+{
     if (m_print_to_console) {
         // print to console
-        fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
+        fwrite(str.data(), 1, str.size(), stdout);
         fflush(stdout);
     }
     if (m_print_to_file) {
@@ -285,7 +338,72 @@ void BCLog::Logger::LogPrintStr(const std::string& str)
                 m_fileout = new_fileout;
             }
         }
-        FileWriteStr(str_prefixed, m_fileout);
+        FileWriteStr(str, m_fileout);
+    }
+}
+
+void BCLog::AsyncWriter::Start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running)
+        return;
+    m_running = true;
+    m_thread = std::thread(&AsyncWriter::ThreadWrite, this);
+}
+
+void BCLog::AsyncWriter::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running)
+            return;
+        m_running = false;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+}
+
+bool BCLog::AsyncWriter::Write(Output output, std::string&& str)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Wait for the writer when the outputs can not keep up, rather than dropping messages
+    while (m_running && m_queued_bytes > MAX_QUEUED_BYTES && std::this_thread::get_id() != m_thread.get_id())
+        m_cond.wait(lock);
+    if (!m_running)
+        return false;
+    m_queued_bytes += str.size();
+    m_queue.emplace_back(output, std::move(str));
+    if (m_queue.size() == 1)
+        m_cond.notify_all();
+    return true;
+}
+
+void BCLog::AsyncWriter::ThreadWrite()
+{
+    util::ThreadRename("logwriter");
+    std::deque<std::pair<Output, std::string>> queue;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_running && m_queue.empty())
+                m_cond.wait(lock);
+            if (m_queue.empty())
+                return;
+            queue.swap(m_queue);
+            m_queued_bytes = 0;
+        }
+        m_cond.notify_all();
+
+        // Consecutive messages of the same output are written at once
+        std::string str;
+        for (auto it = queue.begin(); it != queue.end(); it++) {
+            str += it->second;
+            if (std::next(it) == queue.end() || std::next(it)->first != it->first) {
+                it->first(str);
+                str.clear();
+            }
+        }
+        queue.clear();
     }
 }
 
@@ -10,16 +10,23 @@
 #include <tinyformat.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+static const bool DEFAULT_LOGASYNC = true;
+//! Maximum number of messages per second of each -debug category, 0 = unlimited
+static const unsigned int DEFAULT_LOGRATELIMIT = 1000;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -59,6 +66,43 @@ namespace BCLog {
         ALL         = ~(uint32_t)0,
     };
 
+    /**
+     * Writes the messages of all log systems on one background thread, so that logging callers, which
+     * often hold cs_main, only queue them. Messages are written in the order they were queued, consecutive
+     * messages of the same output at once.
+     */
+    class AsyncWriter
+    {
+    public:
+        /** Writes messages to one output, called on the writer thread */
+        typedef void (*Output)(const std::string& str);
+
+    private:
+        //! Bytes queued before logging callers wait for the writer
+        static constexpr size_t MAX_QUEUED_BYTES = 16 * 1024 * 1024;
+
+        std::mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<std::pair<Output, std::string>> m_queue; // GUARDED_BY(m_mutex)
+        size_t m_queued_bytes{0};                           // GUARDED_BY(m_mutex)
+        bool m_running{false};                              // GUARDED_BY(m_mutex)
+        std::thread m_thread;
+
+        void ThreadWrite();
+
+    public:
+        /** Start the writer thread */
+        void Start();
+        /** Write all queued messages and stop the writer thread */
+        void Stop();
+
+        /**
+         * Queue a message for an output
+         * @return false if the writer is not running, the caller writes the message itself
+         */
+        bool Write(Output output, std::string&& str);
+    };
+
     class Logger
     {
     private:
@@ -77,8 +121,17 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
+        /** Messages of each category in the current second, and the suppressed ones */
+        std::atomic<int64_t> m_rate_second[32]{};
+        std::atomic<uint32_t> m_rate_count[32]{};
+        std::atomic<uint32_t> m_rate_suppressed[32]{};
+
         std::string LogTimestampStr(const std::string& str);
 
+        /** Write a formatted message to the console and the file. Called on the writer thread if logging is asynchronous */
+        void WriteOutputs(const std::string& str);
+        static void WriteLogInstance(const std::string& str);
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -86,6 +139,9 @@ namespace BCLog {
         bool m_log_timestamps = DEFAULT_LOGTIMESTAMPS;
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
         bool m_log_threadnames = DEFAULT_LOGTHREADNAMES;
+        //! Write messages on the background thread of LogWriter() once logging started
+        bool m_log_async = false;
+        unsigned int m_rate_limit = 0;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
@@ -116,6 +172,9 @@ namespace BCLog {
 
         bool WillLogCategory(LogFlags category) const;
 
+        /** Count a message of the category against -logratelimit. @return false if the message is suppressed */
+        bool RateLimitCategory(LogFlags category);
+
         bool DefaultShrinkDebugFile() const;
     };
 
@@ -123,6 +182,9 @@ namespace BCLog {
 
 BCLog::Logger& LogInstance();
 
+/** The writer thread of all log systems */
+BCLog::AsyncWriter& LogWriter();
+
 /** Return true if log accepts specified category */
 static inline bool LogAcceptCategory(BCLog::LogFlags category)
 {
@@ -160,7 +222,7 @@ static inline void LogPrintf(const char* fmt, const Args&... args)
 template <typename... Args>
 static inline void LogPrint(const BCLog::LogFlags& category, const Args&... args)
 {
-    if (LogAcceptCategory((category))) {
+    if (LogAcceptCategory((category)) && LogInstance().RateLimitCategory(category)) {
         LogPrintf(args...);
     }
 }
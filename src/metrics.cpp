@@ -0,0 +1,296 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <metrics.h>
+
+#include <coins.h>
+#include <httpserver.h>
+#include <net.h>
+#include <protocol.h>
+#include <rpc/protocol.h>
+#include <rpc/server.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+const std::array<int64_t, 13> LatencyHistogram::BOUNDS = {{
+    10, 30, 100, 300, 1000, 3000, 10000, 30000, 100000, 300000, 1000000, 3000000, 10000000
+}};
+
+LatencyHistogram::LatencyHistogram()
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::Observe(int64_t micros)
+{
+    auto it = std::lower_bound(BOUNDS.begin(), BOUNDS.end(), micros);
+    if (it != BOUNDS.end())
+        m_buckets[it - BOUNDS.begin()].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Get(std::array<uint64_t, 13>& buckets, uint64_t& count, int64_t& sum) const
+{
+    for (size_t i = 0; i < m_buckets.size(); i++) {
+        buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    count = m_count.load(std::memory_order_relaxed);
+    sum = m_sum.load(std::memory_order_relaxed);
+}
+
+MessageTypeCounters::MessageTypeCounters() : m_types(getAllNetMessageTypes())
+{
+    std::sort(m_types.begin(), m_types.end());
+    m_types.push_back(NET_MESSAGE_COMMAND_OTHER);
+    m_entries.reset(new Entry[m_types.size()]);
+}
+
+void MessageTypeCounters::Add(const std::string& type, uint64_t bytes)
+{
+    auto it = std::lower_bound(m_types.begin(), m_types.end() - 1, type);
+    if (it == m_types.end() - 1 || *it != type)
+        it = m_types.end() - 1;
+    Entry& entry = m_entries[it - m_types.begin()];
+    entry.messages.Add();
+    entry.bytes.Add(bytes);
+}
+
+Counter g_nonces_submitted;
+LatencyHistogram g_mempool_accept_latency;
+LatencyHistogram g_deadline_check_latency;
+
+MessageTypeCounters& ReceivedMessages()
+{
+    static MessageTypeCounters counters;
+    return counters;
+}
+
+MessageTypeCounters& SentMessages()
+{
+    static MessageTypeCounters counters;
+    return counters;
+}
+
+namespace {
+
+void WriteHeader(std::string& out, const std::string& name, const std::string& type, const std::string& help)
+{
+    out += strprintf("# HELP qitcoin_%s %s\n# TYPE qitcoin_%s %s\n", name, help, name, type);
+}
+
+template <typename T>
+void WriteMetric(std::string& out, const std::string& name, const std::string& type, const std::string& help, T value)
+{
+    WriteHeader(out, name, type, help);
+    out += strprintf("qitcoin_%s %s\n", name, value);
+}
+
+std::string FormatSeconds(int64_t micros)
+{
+    return strprintf("%d.%06d", micros / 1000000, micros % 1000000);
+}
+
+void WriteHistogram(std::string& out, const std::string& name, const std::string& help, const LatencyHistogram& histogram)
+{
+    std::array<uint64_t, 13> buckets;
+    uint64_t count;
+    int64_t sum;
+    histogram.Get(buckets, count, sum);
+
+    WriteHeader(out, name, "histogram", help);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        cumulative += buckets[i];
+        out += strprintf("qitcoin_%s_bucket{le=\"%s\"} %d\n", name, FormatSeconds(LatencyHistogram::BOUNDS[i]), cumulative);
+    }
+    out += strprintf("qitcoin_%s_bucket{le=\"+Inf\"} %d\n", name, count);
+    out += strprintf("qitcoin_%s_sum %s\n", name, FormatSeconds(sum));
+    out += strprintf("qitcoin_%s_count %d\n", name, count);
+}
+
+void WriteMessageTypes(std::string& out, const std::string& direction, const MessageTypeCounters& counters)
+{
+    const std::vector<std::string>& types = counters.GetTypes();
+    WriteHeader(out, "net_messages_" + direction + "_total", "counter", "Network messages " + direction + " by message type");
+    for (size_t i = 0; i < types.size(); i++) {
+        out += strprintf("qitcoin_net_messages_%s_total{type=\"%s\"} %d\n", direction, types[i], counters.GetMessages(i));
+    }
+    WriteHeader(out, "net_message_bytes_" + direction + "_total", "counter", "Bytes of network messages " + direction + " by message type");
+    for (size_t i = 0; i < types.size(); i++) {
+        out += strprintf("qitcoin_net_message_bytes_%s_total{type=\"%s\"} %d\n", direction, types[i], counters.GetBytes(i));
+    }
+}
+
+void WriteStageTimings(std::string& out, const BlockConnectTimings& timings)
+{
+    const std::vector<std::pair<const char*, int64_t>> stages = {
+        {"check", timings.nTimeCheck},
+        {"forks", timings.nTimeForks},
+        {"connect", timings.nTimeConnect},
+        {"reward", timings.nTimeReward},
+        {"verify", timings.nTimeVerify},
+        {"index", timings.nTimeIndex},
+        {"callbacks", timings.nTimeCallbacks},
+        {"read_from_disk", timings.nTimeReadFromDisk},
+        {"connect_total", timings.nTimeConnectTotal},
+        {"flush", timings.nTimeFlush},
+        {"chainstate", timings.nTimeChainState},
+        {"post_connect", timings.nTimePostConnect},
+        {"omni", timings.nTimeOmni},
+        {"total", timings.nTimeTotal},
+        {"poc", timings.nTimePoC},
+        {"pos", timings.nTimePoS},
+    };
+    WriteMetric(out, "blocks_connected_total", "counter", "Blocks connected to the active chain since startup", timings.nBlocks);
+    WriteHeader(out, "block_connect_seconds_total", "counter", "Time spent in the stages of connecting blocks, the same stages as logged with -debug=bench");
+    for (const auto& stage : stages) {
+        out += strprintf("qitcoin_block_connect_seconds_total{stage=\"%s\"} %s\n", stage.first, FormatSeconds(stage.second));
+    }
+    WriteMetric(out, "omni_handler_seconds_per_block", "gauge", "Average time of the Omni Layer handlers per connected block",
+        FormatSeconds(timings.nBlocks > 0 ? timings.nTimeOmni / timings.nBlocks : 0));
+}
+
+void WriteWorkQueue(std::string& out)
+{
+    std::vector<std::pair<std::string, HTTPWorkQueueStats>> lanes;
+    for (bool priority : {false, true}) {
+        HTTPWorkQueueStats stats;
+        if (GetHTTPWorkQueueStats(priority, stats))
+            lanes.emplace_back(priority ? "priority" : "normal", stats);
+    }
+    if (lanes.empty())
+        return;
+
+    WriteHeader(out, "http_work_queue_depth", "gauge", "Requests waiting in the lanes of the HTTP work queue");
+    for (const auto& lane : lanes) {
+        out += strprintf("qitcoin_http_work_queue_depth{lane=\"%s\"} %d\n", lane.first, lane.second.nDepth);
+    }
+    WriteHeader(out, "http_work_queue_requests_total", "counter", "Requests taken from the lanes of the HTTP work queue by workers");
+    for (const auto& lane : lanes) {
+        out += strprintf("qitcoin_http_work_queue_requests_total{lane=\"%s\"} %d\n", lane.first, lane.second.nRequests);
+    }
+    WriteHeader(out, "http_work_queue_rejected_total", "counter", "Requests rejected because the lane of the HTTP work queue was full");
+    for (const auto& lane : lanes) {
+        out += strprintf("qitcoin_http_work_queue_rejected_total{lane=\"%s\"} %d\n", lane.first, lane.second.nRejected);
+    }
+    WriteHeader(out, "http_work_queue_wait_seconds_total", "counter", "Time requests waited in the lanes of the HTTP work queue");
+    for (const auto& lane : lanes) {
+        out += strprintf("qitcoin_http_work_queue_wait_seconds_total{lane=\"%s\"} %s\n", lane.first, FormatSeconds(lane.second.nTotalWaitMicros));
+    }
+}
+
+void WriteValidationInterface(std::string& out, const ValidationInterfaceStats& stats)
+{
+    WriteHeader(out, "validation_queue_depth", "gauge", "Validation callbacks pending in the queue of the scheduler thread, or of the listeners on their own thread");
+    out += strprintf("qitcoin_validation_queue_depth{queue=\"scheduler\"} %d\n", stats.nQueueDepth);
+    for (const ValidationListenerStats& listener : stats.listeners) {
+        if (listener.fOwnThread)
+            out += strprintf("qitcoin_validation_queue_depth{queue=\"%s\"} %d\n", listener.name, listener.nQueueDepth);
+    }
+    WriteHeader(out, "validation_queue_wait_seconds_total", "counter", "Time validation callbacks waited in their queue");
+    out += strprintf("qitcoin_validation_queue_wait_seconds_total{queue=\"scheduler\"} %s\n", FormatSeconds(stats.queueWait.nTotalMicros));
+    for (const ValidationListenerStats& listener : stats.listeners) {
+        if (listener.fOwnThread)
+            out += strprintf("qitcoin_validation_queue_wait_seconds_total{queue=\"%s\"} %s\n", listener.name, FormatSeconds(listener.queueWait.nTotalMicros));
+    }
+    WriteHeader(out, "validation_callbacks_total", "counter", "Validation callbacks delivered by listener type and callback");
+    for (const ValidationListenerStats& listener : stats.listeners) {
+        for (size_t i = 0; i < VALIDATION_CALLBACK_COUNT; i++) {
+            if (listener.callbacks[i].nCalls > 0)
+                out += strprintf("qitcoin_validation_callbacks_total{listener=\"%s\",callback=\"%s\"} %d\n",
+                    listener.name, ValidationCallbackName(static_cast<ValidationCallback>(i)), listener.callbacks[i].nCalls);
+        }
+    }
+    WriteHeader(out, "validation_callback_seconds_total", "counter", "Time listeners took for validation callbacks by listener type and callback");
+    for (const ValidationListenerStats& listener : stats.listeners) {
+        for (size_t i = 0; i < VALIDATION_CALLBACK_COUNT; i++) {
+            if (listener.callbacks[i].nCalls > 0)
+                out += strprintf("qitcoin_validation_callback_seconds_total{listener=\"%s\",callback=\"%s\"} %s\n",
+                    listener.name, ValidationCallbackName(static_cast<ValidationCallback>(i)), FormatSeconds(listener.callbacks[i].nTotalMicros));
+        }
+    }
+}
+
+} // namespace
+
+std::string Render()
+{
+    std::string out;
+
+    // Counters updated on the hot paths, read without any lock
+    WriteMetric(out, "poc_nonces_submitted_total", "counter", "Nonces submitted by miners", g_nonces_submitted.Get());
+    WriteHistogram(out, "poc_deadline_check_seconds", "Time of checking the PoC deadline of block headers", g_deadline_check_latency);
+    WriteHistogram(out, "mempool_accept_seconds", "Time of accepting transactions to the mempool, including the rejected ones", g_mempool_accept_latency);
+    WriteMessageTypes(out, "received", ReceivedMessages());
+    WriteMessageTypes(out, "sent", SentMessages());
+    WriteWorkQueue(out);
+    WriteValidationInterface(out, GetMainSignals().GetStats());
+
+    if (g_connman) {
+        WriteMetric(out, "net_connections", "gauge", "Connected peers", g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL));
+        WriteMetric(out, "net_bytes_received_total", "counter", "Bytes received from all peers", g_connman->GetTotalBytesRecv());
+        WriteMetric(out, "net_bytes_sent_total", "counter", "Bytes sent to all peers", g_connman->GetTotalBytesSent());
+    }
+
+    // The chain state and the mempool are not ready before the warmup finished
+    if (RPCIsInWarmup(nullptr))
+        return out;
+
+    WriteMetric(out, "mempool_transactions", "gauge", "Transactions in the mempool", ::mempool.size());
+    WriteMetric(out, "mempool_bytes", "gauge", "Sum of the virtual sizes of the transactions in the mempool", ::mempool.GetTotalTxSize());
+    WriteMetric(out, "mempool_usage_bytes", "gauge", "Memory usage of the mempool", ::mempool.DynamicMemoryUsage());
+
+    BlockConnectTimings timings;
+    size_t nCoinsUsage;
+    uint64_t nCoinsHits, nCoinsMisses;
+    {
+        LOCK(cs_main);
+        timings = GetBlockConnectTimings();
+        const CCoinsViewCache& coinsTip = ::ChainstateActive().CoinsTip();
+        nCoinsUsage = coinsTip.DynamicMemoryUsage();
+        nCoinsHits = coinsTip.GetCacheHits();
+        nCoinsMisses = coinsTip.GetCacheMisses();
+    }
+    WriteMetric(out, "coins_cache_usage_bytes", "gauge", "Memory usage of the UTXO cache of the chain tip", nCoinsUsage);
+    WriteMetric(out, "coins_cache_hits_total", "counter", "Coin lookups served by the UTXO cache of the chain tip", nCoinsHits);
+    WriteMetric(out, "coins_cache_misses_total", "counter", "Coin lookups passed on to the database by the UTXO cache of the chain tip", nCoinsMisses);
+    WriteStageTimings(out, timings);
+
+    return out;
+}
+
+} // namespace metrics
+
+static bool metrics_handler(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\r\n");
+        return false;
+    }
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, metrics::Render());
+    return true;
+}
+
+void StartMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, metrics_handler);
+}
+
+void StopMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_METRICS_H
+#define BITCOIN_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//! Default for -metrics, exposing node metrics at /metrics of the RPC server
+static const bool DEFAULT_METRICS_ENABLE = false;
+
+namespace metrics {
+
+/** A monotonically increasing count, which is cheap enough to be updated on hot paths. */
+class Counter
+{
+private:
+    std::atomic<uint64_t> m_value{0};
+
+public:
+    void Add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Get() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+/** Durations in fixed buckets, which grow by a factor of about 3 from 10 microseconds to 10 seconds. */
+class LatencyHistogram
+{
+public:
+    //! Upper bounds of the buckets, in microseconds. Longer durations are only counted in the total
+    static const std::array<int64_t, 13> BOUNDS;
+
+private:
+    std::array<std::atomic<uint64_t>, 13> m_buckets;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<int64_t> m_sum{0};
+
+public:
+    LatencyHistogram();
+
+    void Observe(int64_t micros);
+
+    //! Not cumulative counts per bucket, and the count and the sum of all durations
+    void Get(std::array<uint64_t, 13>& buckets, uint64_t& count, int64_t& sum) const;
+};
+
+/** Messages and their bytes per message type, the types are fixed when it is constructed. */
+class MessageTypeCounters
+{
+private:
+    struct Entry {
+        Counter messages;
+        Counter bytes;
+    };
+    //! Sorted known types, the last entry takes all the other types
+    std::vector<std::string> m_types;
+    std::unique_ptr<Entry[]> m_entries;
+
+public:
+    MessageTypeCounters();
+
+    void Add(const std::string& type, uint64_t bytes);
+
+    const std::vector<std::string>& GetTypes() const { return m_types; }
+    uint64_t GetMessages(size_t i) const { return m_entries[i].messages.Get(); }
+    uint64_t GetBytes(size_t i) const { return m_entries[i].bytes.Get(); }
+};
+
+//! Nonces submitted by miners
+extern Counter g_nonces_submitted;
+//! Time of accepting transactions to the mempool, including the rejected ones
+extern LatencyHistogram g_mempool_accept_latency;
+//! Time of checking the PoC deadline of a block header
+extern LatencyHistogram g_deadline_check_latency;
+
+//! Network messages received and sent by all peers since startup
+MessageTypeCounters& ReceivedMessages();
+MessageTypeCounters& SentMessages();
+
+/** Render all metrics in the Prometheus text format. */
+std::string Render();
+
+} // namespace metrics
+
+/** Start the /metrics HTTP handler. */
+void StartMetrics();
+
+/** Stop the /metrics HTTP handler. */
+void StopMetrics();
+
+#endif // BITCOIN_METRICS_H
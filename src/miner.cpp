@@ -85,6 +85,16 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     uint64_t plotterId,
     const CChiaProofOfSpace &pos,
     const std::shared_ptr<CKey> privKey)
+{
+    LOCK(cs_main);
+    std::unique_ptr<CBlockTemplate> pblocktemplateNew = PrepareNewBlock();
+    if (!pblocktemplateNew)
+        return nullptr;
+    FinalizeNewBlock(*pblocktemplateNew, scriptPubKeyIn, nonce, deadline, plotterId, pos, privKey);
+    return pblocktemplateNew;
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::PrepareNewBlock()
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -96,9 +106,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         return nullptr;
     pblock = &pblocktemplate->block; // pointer for convenience
 
-    const CAccountID generatorID = ExtractAccountID(scriptPubKeyIn);
-    assert (!generatorID.IsNull());
-
     // Add dummy coinbase tx as first transaction
     pblock->vtx.emplace_back();
     pblocktemplate->vTxFees.push_back(-1); // updated at end
@@ -107,8 +114,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     LOCK2(cs_main, mempool.cs);
     CBlockIndex* pindexPrev = ::ChainActive().Tip();
     assert(pindexPrev != nullptr);
-    nHeight = pindexPrev->nHeight + 1;
-    epochHash = GetEpochHash(pindexPrev, chainparams.GetConsensus());
+    SetBlockContext(pindexPrev);
 
     pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
     // -regtest only: allow overriding block.nVersion with
@@ -116,32 +122,98 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     if (chainparams.MineBlocksOnDemand())
         pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
 
-    pblock->nTime = static_cast<uint32_t>(pindexPrev->GetBlockTime() + static_cast<int64_t>(deadline) + 1);
-    if (nHeight <= 1) {
-        // pre-mining
-        pblock->nTime = pindexPrev->GetBlockTime() + 1;
-        plotterId = 0;
-        nonce = 0;
-    } else if (nHeight == 2) {
-        // begining
-        if (chainparams.GetConsensus().nBeginMiningTime != 0) {
-            pblock->nTime = static_cast<uint32_t>(chainparams.GetConsensus().nBeginMiningTime);
-        }
-        nonce = 0;
-    } else {
-        // reset block time
-        if (chainparams.GetConsensus().fAllowIncontinuityBlockTime) {
-            int64_t now = GetAdjustedTime();
-            if (now > pblock->nTime + chainparams.GetConsensus().nPowTargetSpacing * 10) {
-                pblock->nTime = now;
-            }
+    pblocktemplate->nSelectedTime = GetTime();
+    int nPackagesSelected = 0;
+    int nDescendantsUpdated = 0;
+    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    pblocktemplate->fSelectedAll = nBlockTx == mempool.size();
+
+    m_last_block_num_txs = nBlockTx;
+    m_last_block_weight = nBlockWeight;
+
+    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    pblocktemplate->vTxFees[0] = -nFees;
+
+    LogPrint(BCLog::BENCH, "PrepareNewBlock() packages: %.2fms (%d packages, %d updated descendants)\n", 0.001 * (GetTimeMicros() - nTimeStart), nPackagesSelected, nDescendantsUpdated);
+
+    return std::move(pblocktemplate);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::UpdatePreparedBlock(const CBlockTemplate& prepared)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    LOCK2(cs_main, mempool.cs);
+    CBlockIndex* pindexPrev = ::ChainActive().Tip();
+    assert(pindexPrev != nullptr);
+    if (!prepared.fSelectedAll || prepared.block.hashPrevBlock != pindexPrev->GetBlockHash())
+        return nullptr;
+
+    resetBlock();
+    SetBlockContext(pindexPrev);
+    pblocktemplate.reset(new CBlockTemplate(prepared));
+    pblock = &pblocktemplate->block;
+
+    // Every transaction of the template has to be still in the mempool
+    for (size_t i = 1; i < pblock->vtx.size(); i++) {
+        CTxMemPool::txiter it = mempool.mapTx.find(pblock->vtx[i]->GetHash());
+        if (it == mempool.mapTx.end())
+            return nullptr;
+        inBlock.insert(it);
+        nBlockWeight += it->GetTxWeight();
+        nBlockSigOpsCost += it->GetSigOpCost();
+    }
+    nBlockTx = inBlock.size();
+    nFees = -prepared.vTxFees[0];
+
+    // Transactions enter the mempool after their parents, so appending the ones
+    // added since the template was prepared in entry order keeps it valid
+    const int64_t nSelectedTime = GetTime();
+    const auto& byEntryTime = mempool.mapTx.get<entry_time>();
+    std::vector<CTxMemPool::txiter> vAdded;
+    for (auto it = byEntryTime.rbegin(); it != byEntryTime.rend() && it->GetTime() >= prepared.nSelectedTime; ++it) {
+        CTxMemPool::txiter iter = mempool.mapTx.iterator_to(*it);
+        if (!inBlock.count(iter))
+            vAdded.push_back(iter);
+    }
+    for (auto rit = vAdded.rbegin(); rit != vAdded.rend(); ++rit) {
+        CTxMemPool::txiter iter = *rit;
+        for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(iter)) {
+            if (!inBlock.count(parent))
+                return nullptr;
         }
+        if (iter->GetModifiedFee() < blockMinFeeRate.GetFee(iter->GetTxSize()) ||
+                !TestPackage(iter->GetTxSize(), iter->GetSigOpCost()) ||
+                !TestPackageTransactions(CTxMemPool::setEntries{iter}))
+            return nullptr;
+        AddToBlock(iter);
     }
+    // Anything else not in the template left and came back, and may belong anywhere in it
+    if (nBlockTx != mempool.size())
+        return nullptr;
+
+    pblocktemplate->nSelectedTime = nSelectedTime;
+    pblocktemplate->vTxFees[0] = -nFees;
+
+    m_last_block_num_txs = nBlockTx;
+    m_last_block_weight = nBlockWeight;
+
+    LogPrint(BCLog::BENCH, "UpdatePreparedBlock() transactions: %.2fms (%u added)\n", 0.001 * (GetTimeMicros() - nTimeStart), pblock->vtx.size() - prepared.block.vtx.size());
+
+    return std::move(pblocktemplate);
+}
+
+void BlockAssembler::SetBlockContext(const CBlockIndex* pindexPrev)
+{
+    nHeight = pindexPrev->nHeight + 1;
+    epochHash = GetEpochHash(pindexPrev, chainparams.GetConsensus());
+
+    // The block time is decided by FinalizeNewBlock()
     const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
 
     nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
                        ? nMedianTimePast
-                       : pblock->GetBlockTime();
+                       : std::max(pindexPrev->GetBlockTime() + 1, GetAdjustedTime());
 
     // Decide whether to include witness transactions
     // This is only needed in case the witness softfork activation is reverted
@@ -153,58 +225,165 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     // TODO: replace this with a call to main to assess validity of a mempool
     // transaction (which in most cases can be a no-op).
     fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
+}
 
-    int nPackagesSelected = 0;
-    int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+void BlockAssembler::FinalizeNewBlock(CBlockTemplate& blocktemplate, const CScript& scriptPubKeyIn,
+    uint64_t nonce,
+    uint64_t deadline,
+    uint64_t plotterId,
+    const CChiaProofOfSpace &pos,
+    const std::shared_ptr<CKey> privKey)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexPrev = ::ChainActive().Tip();
+    assert(pindexPrev != nullptr);
+    if (blocktemplate.block.hashPrevBlock != pindexPrev->GetBlockHash())
+        throw std::runtime_error(strprintf("%s: Block template is stale", __func__));
+    FinalizeBlock(blocktemplate, pindexPrev, ::ChainstateActive().CoinsTip(), scriptPubKeyIn, nonce, deadline, plotterId, pos, privKey);
+}
 
-    int64_t nTime1 = GetTimeMicros();
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateCompetingBlock(const CBlock& tipBlock, const CScript& scriptPubKeyIn,
+    uint64_t nonce,
+    uint64_t deadline,
+    uint64_t plotterId,
+    const CChiaProofOfSpace &pos,
+    const std::shared_ptr<CKey> privKey)
+{
+    AssertLockHeld(cs_main);
+    CBlockIndex* pindexTip = ::ChainActive().Tip();
+    assert(pindexTip != nullptr);
+    if (pindexTip->pprev == nullptr || tipBlock.GetHash() != pindexTip->GetBlockHash())
+        throw std::runtime_error(strprintf("%s: Block is not the tip", __func__));
+    CBlockIndex* pindexPrev = pindexTip->pprev;
 
-    m_last_block_num_txs = nBlockTx;
-    m_last_block_weight = nBlockWeight;
+    // Chain state of the previous block, the tip stays connected
+    CCoinsViewCache viewPrev(&::ChainstateActive().CoinsTip());
+    if (::ChainstateActive().DisconnectBlock(tipBlock, pindexTip, viewPrev) != DISCONNECT_OK)
+        throw std::runtime_error(strprintf("%s: Disconnect tip fail", __func__));
+
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate());
+    pblock = &pblocktemplate->block;
+    pblock->vtx.emplace_back();
+    pblocktemplate->vTxFees.push_back(-1); // updated at end
+    pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
+
+    nHeight = pindexPrev->nHeight + 1;
+    epochHash = GetEpochHash(pindexPrev, chainparams.GetConsensus());
+    pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+    fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
+
+    // Transactions of the tip are spent again on the previous block
+    CCoinsViewCache view(&viewPrev);
+    const Consensus::SpendEra spendEra(nHeight, chainparams.GetConsensus());
+    for (size_t i = 1; i < tipBlock.vtx.size(); i++) {
+        const CTransaction& tx = *tipBlock.vtx[i];
+        CValidationState state;
+        CAmount nTxFees;
+        if (!Consensus::CheckTxInputs(tx, state, view, viewPrev, spendEra, nTxFees, epochHash, chainparams.GetConsensus()))
+            throw std::runtime_error(strprintf("%s: CheckTxInputs failed: %s", __func__, FormatStateMessage(state)));
+        const int64_t nTxSigOpsCost = GetTransactionSigOpCost(tx, view, STANDARD_SCRIPT_VERIFY_FLAGS);
+        UpdateCoins(tx, view, nHeight);
+
+        pblock->vtx.push_back(tipBlock.vtx[i]);
+        pblocktemplate->vTxFees.push_back(nTxFees);
+        pblocktemplate->vTxSigOpsCost.push_back(nTxSigOpsCost);
+        nBlockWeight += GetTransactionWeight(tx);
+        nBlockSigOpsCost += nTxSigOpsCost;
+        nFees += nTxFees;
+        ++nBlockTx;
+    }
+
+    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    pblocktemplate->vTxFees[0] = -nFees;
+
+    FinalizeBlock(*pblocktemplate, pindexPrev, viewPrev, scriptPubKeyIn, nonce, deadline, plotterId, pos, privKey);
+    return std::move(pblocktemplate);
+}
+
+void BlockAssembler::FinalizeBlock(CBlockTemplate& blocktemplate, CBlockIndex* pindexPrev, const CCoinsViewCache& view,
+    const CScript& scriptPubKeyIn,
+    uint64_t nonce,
+    uint64_t deadline,
+    uint64_t plotterId,
+    const CChiaProofOfSpace &pos,
+    const std::shared_ptr<CKey> privKey)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    AssertLockHeld(cs_main);
+    CBlock* const pblockFinal = &blocktemplate.block;
+    const int nHeightFinal = pindexPrev->nHeight + 1;
+
+    const CAccountID generatorID = ExtractAccountID(scriptPubKeyIn);
+    assert (!generatorID.IsNull());
+
+    pblockFinal->nTime = static_cast<uint32_t>(pindexPrev->GetBlockTime() + static_cast<int64_t>(deadline) + 1);
+    if (nHeightFinal <= 1) {
+        // pre-mining
+        pblockFinal->nTime = pindexPrev->GetBlockTime() + 1;
+        plotterId = 0;
+        nonce = 0;
+    } else if (nHeightFinal == 2) {
+        // begining
+        if (chainparams.GetConsensus().nBeginMiningTime != 0) {
+            pblockFinal->nTime = static_cast<uint32_t>(chainparams.GetConsensus().nBeginMiningTime);
+        }
+        nonce = 0;
+    } else {
+        // reset block time
+        if (chainparams.GetConsensus().fAllowIncontinuityBlockTime) {
+            int64_t now = GetAdjustedTime();
+            if (now > pblockFinal->nTime + chainparams.GetConsensus().nPowTargetSpacing * 10) {
+                pblockFinal->nTime = now;
+            }
+        }
+    }
 
     // Create coinbase transaction.
+    const CAmount nFeesFinal = -blocktemplate.vTxFees[0];
     CMutableTransaction coinbaseTx;
     coinbaseTx.vin.resize(1);
     coinbaseTx.vin[0].prevout.SetNull();
-    coinbaseTx.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(static_cast<int64_t>(nonce)) << CScriptNum(static_cast<int64_t>(plotterId))) + COINBASE_FLAGS;
+    coinbaseTx.vin[0].scriptSig = (CScript() << nHeightFinal << CScriptNum(static_cast<int64_t>(nonce)) << CScriptNum(static_cast<int64_t>(plotterId))) + COINBASE_FLAGS;
     assert(coinbaseTx.vin[0].scriptSig.size() <= 100);
-    for (const CTxOut &txOut : GetBlockReward(pindexPrev, nFees, generatorID, plotterId, ::ChainstateActive().CoinsTip(), chainparams.GetConsensus())) {
+    for (const CTxOut &txOut : GetBlockReward(pindexPrev, nFeesFinal, generatorID, plotterId, view, chainparams.GetConsensus())) {
         coinbaseTx.vout.push_back(txOut);
     }
-    pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
-    pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus());
-    pblocktemplate->vTxFees[0] = -nFees;
+    pblockFinal->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    blocktemplate.vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblockFinal, pindexPrev, chainparams.GetConsensus());
 
-    LogPrintf("CreateNewBlock(): block weight: %u txs: %u fees: %ld sigops %d\n", GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
+    int64_t nSigOpsCostFinal = 0;
+    for (size_t i = 1; i < blocktemplate.vTxSigOpsCost.size(); i++) {
+        nSigOpsCostFinal += blocktemplate.vTxSigOpsCost[i];
+    }
+    LogPrintf("CreateNewBlock(): block weight: %u txs: %u fees: %ld sigops %d\n", GetBlockWeight(*pblockFinal), pblockFinal->vtx.size() - 1, nFeesFinal, nSigOpsCostFinal + 400);
 
     // Fill in header
-    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-    pblock->nNonce         = nonce;
-    pblock->nPlotterId     = plotterId;
-    pblock->pos            = pos;
-    pblock->nBaseTarget    = poc::CalculateBaseTarget(*pindexPrev, *pblock, chainparams.GetConsensus());
+    pblockFinal->nNonce         = nonce;
+    pblockFinal->nPlotterId     = plotterId;
+    pblockFinal->pos            = pos;
+    pblockFinal->nBaseTarget    = poc::CalculateBaseTarget(*pindexPrev, *pblockFinal, chainparams.GetConsensus());
 
-    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+    pblockFinal->hashMerkleRoot = BlockMerkleRoot(*pblockFinal);
 
-    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
+    blocktemplate.vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblockFinal->vtx[0]);
 
     if (plotterId != 0) {
         // Signature
-        if (nHeight > 1 && (!privKey || !privKey->IsValid() || !sign(*pblock, *privKey))) {
+        if (nHeightFinal > 1 && (!privKey || !privKey->IsValid() || !sign(*pblockFinal, *privKey))) {
             throw std::runtime_error(strprintf("%s: Signature block error", __func__));
         }
 
+        // A competing block is validated when it's connected
         CValidationState state;
-        if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        if (pindexPrev == ::ChainActive().Tip() && !TestBlockValidity(state, chainparams, *pblockFinal, pindexPrev, false, false)) {
             throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
         }
     }
-    int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
-
-    return std::move(pblocktemplate);
+    LogPrint(BCLog::BENCH, "FinalizeNewBlock() validity: %.2fms\n", 0.001 * (GetTimeMicros() - nTimeStart));
 }
 
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
@@ -352,6 +531,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     int64_t nConsecutiveFailed = 0;
 
     CCoinsViewCache view(&::ChainstateActive().CoinsTip());
+    const Consensus::SpendEra spendEra(nHeight, chainparams.GetConsensus());
 
     while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty())
     {
@@ -453,7 +633,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
             // Check transaction inputs and type
             CValidationState state;
             CAmount nFees;
-            if (!Consensus::CheckTxInputs(sortedEntries[i]->GetTx(), state, view, ::ChainstateActive().CoinsTip(), nHeight, nFees, epochHash, chainparams.GetConsensus())) {
+            if (!Consensus::CheckTxInputs(sortedEntries[i]->GetTx(), state, view, ::ChainstateActive().CoinsTip(), spendEra, nFees, epochHash, chainparams.GetConsensus())) {
                 // All descendants move to failed
                 for (size_t j = i; j < sortedEntries.size(); ++j) {
                     failedTx.insert(sortedEntries[j]);
@@ -492,9 +672,11 @@ bool BlockAssembler::sign(CBlock &block, const CKey &privKey)
     block.vchPubKey = std::vector<unsigned char>(pubKey.begin(), pubKey.end());
 
     uint256 unsignaturedBlockHash = block.GetUnsignaturedHash();
-    if (!privKey.Sign(unsignaturedBlockHash, block.vchSignature)) {
+    std::vector<unsigned char> vchSignature;
+    if (!privKey.Sign(unsignaturedBlockHash, vchSignature)) {
         return false;
     }
+    block.vchSignature = vchSignature;
 
     return true;
 }
@@ -32,6 +32,9 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    //! Time the mempool transactions were selected, and whether all of them were, see BlockAssembler::UpdatePreparedBlock()
+    int64_t nSelectedTime = 0;
+    bool fSelectedAll = false;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -169,6 +172,42 @@ public:
                                                    const CChiaProofOfSpace &pos = CChiaProofOfSpace(),
                                                    const std::shared_ptr<CKey> privKey = nullptr);
 
+    /**
+     * Select mempool transactions of a new block template on the current tip. The coinbase, time and
+     * header of returned template are left for FinalizeNewBlock(), so it can be pre-assembled.
+     */
+    std::unique_ptr<CBlockTemplate> PrepareNewBlock();
+
+    /**
+     * Bring a template from PrepareNewBlock() up to date by appending the transactions added to the mempool
+     * since it was prepared. This only works while the template holds every other mempool transaction and
+     * they all fit, otherwise nullptr is returned and the template needs to be prepared anew.
+     */
+    std::unique_ptr<CBlockTemplate> UpdatePreparedBlock(const CBlockTemplate& prepared);
+
+    /**
+     * Finalize a template from PrepareNewBlock() with coinbase to scriptPubKeyIn and sign it.
+     * Throw when the tip is changed since the template prepared or the block is invalid.
+     */
+    void FinalizeNewBlock(CBlockTemplate& blocktemplate, const CScript& scriptPubKeyIn,
+                          uint64_t nonce = 0,
+                          uint64_t deadline = 0,
+                          uint64_t plotterId = 0,
+                          const CChiaProofOfSpace &pos = CChiaProofOfSpace(),
+                          const std::shared_ptr<CKey> privKey = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Construct a block competing with the tip at its height, with coinbase to scriptPubKeyIn. It builds on the
+     * previous block of the tip with the transactions of tipBlock, and leaves the tip connected, so that
+     * ActivateBestChain() picks the block with more chain work. Throw when tipBlock isn't the tip.
+     */
+    std::unique_ptr<CBlockTemplate> CreateCompetingBlock(const CBlock& tipBlock, const CScript& scriptPubKeyIn,
+                                                         uint64_t nonce = 0,
+                                                         uint64_t deadline = 0,
+                                                         uint64_t plotterId = 0,
+                                                         const CChiaProofOfSpace &pos = CChiaProofOfSpace(),
+                                                         const std::shared_ptr<CKey> privKey = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     static Optional<int64_t> m_last_block_num_txs;
     static Optional<int64_t> m_last_block_weight;
 
@@ -176,6 +215,12 @@ private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
+    /** Set the height, epoch and transaction rules of a block on pindexPrev */
+    void SetBlockContext(const CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Fill in coinbase and header of a template on pindexPrev, whose chain state is view, and sign it */
+    void FinalizeBlock(CBlockTemplate& blocktemplate, CBlockIndex* pindexPrev, const CCoinsViewCache& view,
+                       const CScript& scriptPubKeyIn, uint64_t nonce, uint64_t deadline, uint64_t plotterId,
+                       const CChiaProofOfSpace &pos, const std::shared_ptr<CKey> privKey) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
 
@@ -15,12 +15,14 @@
 #include <consensus/consensus.h>
 #include <crypto/common.h>
 #include <crypto/sha256.h>
+#include <metrics.h>
 #include <netbase.h>
 #include <net_permissions.h>
 #include <primitives/transaction.h>
 #include <scheduler.h>
 #include <ui_interface.h>
 #include <util/strencodings.h>
+#include <util/trace.h>
 #include <util/translation.h>
 
 #ifdef WIN32
@@ -33,6 +35,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -604,6 +610,8 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
                 i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
             assert(i != mapRecvBytesPerMsgCmd.end());
             i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+            metrics::ReceivedMessages().Add(i->first, msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE);
+            TRACE3(net, inbound_message, GetId(), msg.hdr.pchCommand, msg.hdr.nMessageSize);
 
             msg.nTime = nTimeMicros;
             complete = true;
@@ -671,14 +679,83 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     return nCopy;
 }
 
+namespace {
+
+/** Buffers larger than this are freed instead of being kept for later messages */
+static const size_t MAX_POOLED_MESSAGE_BUFFER_SIZE = 4 * 1000 * 1000;
+/** Maximum total capacity of the buffers kept for later messages */
+static const size_t MAX_POOLED_MESSAGE_BUFFERS_SIZE = 32 * 1000 * 1000;
+
+/** Receive buffers of processed messages, reused by the messages received next */
+class CNetMessageBufferPool
+{
+private:
+    Mutex cs;
+    std::vector<CSerializeData> vBuffers GUARDED_BY(cs);
+    size_t nTotalCapacity GUARDED_BY(cs) = 0;
+
+public:
+    void Take(CSerializeData& buffer)
+    {
+        LOCK(cs);
+        if (vBuffers.empty())
+            return;
+        // Newest first, its memory is the most likely to still be cached
+        nTotalCapacity -= vBuffers.back().capacity();
+        buffer.swap(vBuffers.back());
+        vBuffers.pop_back();
+    }
+
+    void Give(CSerializeData& buffer)
+    {
+        if (buffer.capacity() == 0 || buffer.capacity() > MAX_POOLED_MESSAGE_BUFFER_SIZE)
+            return;
+        buffer.clear();
+        LOCK(cs);
+        if (nTotalCapacity + buffer.capacity() > MAX_POOLED_MESSAGE_BUFFERS_SIZE)
+            return;
+        nTotalCapacity += buffer.capacity();
+        vBuffers.emplace_back();
+        vBuffers.back().swap(buffer);
+    }
+};
+
+CNetMessageBufferPool& GetMessageBufferPool()
+{
+    // Leaked on purpose: messages may still be destroyed during static destruction
+    static CNetMessageBufferPool* pool = new CNetMessageBufferPool();
+    return *pool;
+}
+
+} // namespace
+
+CNetMessageData::CNetMessageData(int nTypeIn, int nVersionIn) : CDataStream(nTypeIn, nVersionIn)
+{
+    GetMessageBufferPool().Take(vch);
+}
+
+CNetMessageData::CNetMessageData(CNetMessageData&& other) : CDataStream(other.nType, other.nVersion)
+{
+    vch.swap(other.vch);
+    nReadPos = other.nReadPos;
+    other.nReadPos = 0;
+}
+
+CNetMessageData::~CNetMessageData()
+{
+    GetMessageBufferPool().Give(vch);
+}
+
 int CNetMessage::readData(const char *pch, unsigned int nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
     if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        // Allocate up to 256 KiB ahead, or as far as the pooled buffer already reaches,
+        // but never more than the total message size.
+        size_t nAhead = std::max<size_t>(nDataPos + nCopy + 256 * 1024, vRecv.capacity());
+        vRecv.resize(std::min<size_t>(hdr.nMessageSize, nAhead));
     }
 
     hasher.Write((const unsigned char*)pch, nCopy);
@@ -1115,10 +1192,13 @@ void CConnman::InactivityCheck(CNode *pnode)
     }
 }
 
-bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::map<SOCKET, NodeId>* socket_nodes)
 {
     for (const ListenSocket& hListenSocket : vhListenSocket) {
         recv_set.insert(hListenSocket.socket);
+        if (socket_nodes) {
+            (*socket_nodes)[hListenSocket.socket] = -1;
+        }
     }
 
     {
@@ -1148,6 +1228,9 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
                 continue;
 
             error_set.insert(pnode->hSocket);
+            if (socket_nodes) {
+                (*socket_nodes)[pnode->hSocket] = pnode->GetId();
+            }
             if (select_send) {
                 send_set.insert(pnode->hSocket);
                 continue;
@@ -1161,6 +1244,73 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    std::map<SOCKET, NodeId> socket_nodes;
+    if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set, &socket_nodes)) {
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    // Errors and hangups are always reported, the sockets in error_select_set only need to be registered
+    std::map<SOCKET, uint32_t> wanted_events;
+    for (SOCKET socket_id : error_select_set) wanted_events[socket_id] = 0;
+    for (SOCKET socket_id : recv_select_set)  wanted_events[socket_id] |= EPOLLIN;
+    for (SOCKET socket_id : send_select_set)  wanted_events[socket_id] |= EPOLLOUT;
+
+    // Registrations persist across calls: only sockets that went away or whose
+    // events changed cost a system call. Closing a socket removes it from the epoll
+    // set, so errors about sockets no longer there are expected.
+    for (auto it = mapEpollSockets.begin(); it != mapEpollSockets.end();) {
+        if (wanted_events.count(it->first) == 0) {
+            epoll_ctl(epollfd, EPOLL_CTL_DEL, it->first, nullptr);
+            it = mapEpollSockets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto& wanted : wanted_events) {
+        const SOCKET socket_id = wanted.first;
+        const std::pair<NodeId, uint32_t> registration(socket_nodes[socket_id], wanted.second);
+        auto it = mapEpollSockets.find(socket_id);
+        if (it != mapEpollSockets.end() && it->second == registration) continue;
+
+        struct epoll_event event = {};
+        event.events = registration.second;
+        event.data.fd = socket_id;
+        // A descriptor registered for a closed socket may since have been reused by
+        // another node, or a registered one may have been closed, so retry with the
+        // other operation before giving up.
+        int op = it == mapEpollSockets.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(epollfd, op, socket_id, &event) != 0 &&
+            (errno != (op == EPOLL_CTL_ADD ? EEXIST : ENOENT) ||
+             epoll_ctl(epollfd, op == EPOLL_CTL_ADD ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, socket_id, &event) != 0)) {
+            LogPrint(BCLog::NET, "epoll_ctl failed for socket %d: %s\n", socket_id, NetworkErrorString(errno));
+            if (it != mapEpollSockets.end()) mapEpollSockets.erase(it);
+            // Let the receive attempt of the socket handler sort it out
+            error_set.insert(socket_id);
+            continue;
+        }
+        mapEpollSockets[socket_id] = registration;
+    }
+
+    std::vector<struct epoll_event> events(std::max<size_t>(mapEpollSockets.size(), 1));
+    int nEvents = epoll_wait(epollfd, events.data(), events.size(), SELECT_TIMEOUT_MILLISECONDS);
+    if (nEvents < 0) return;
+
+    if (interruptNet) return;
+
+    for (int i = 0; i < nEvents; ++i) {
+        const SOCKET socket_id = events[i].data.fd;
+        if (events[i].events & EPOLLIN)              recv_set.insert(socket_id);
+        if (events[i].events & EPOLLOUT)             send_set.insert(socket_id);
+        if (events[i].events & (EPOLLERR|EPOLLHUP))  error_set.insert(socket_id);
+    }
+}
+#endif
+
 #ifdef USE_POLL
 void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
@@ -1282,7 +1432,15 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        SocketEventsEpoll(recv_set, send_set, error_set);
+    } else {
+        SocketEvents(recv_set, send_set, error_set);
+    }
+#else
     SocketEvents(recv_set, send_set, error_set);
+#endif
 
     if (interruptNet) return;
 
@@ -1618,10 +1776,16 @@ void CConnman::ThreadDNSAddressSeed()
 
 void CConnman::DumpAddresses()
 {
+    const uint64_t nModifications = addrman.GetModifications();
+    if (nModifications == nDumpedAddrModifications) {
+        LogPrint(BCLog::NET, "Skipped flushing %d unchanged addresses to peers.dat\n", addrman.size());
+        return;
+    }
     int64_t nStart = GetTimeMillis();
 
     CAddrDB adb;
-    adb.Write(addrman);
+    if (adb.Write(addrman))
+        nDumpedAddrModifications = nModifications;
 
     LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
@@ -2278,6 +2442,13 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+#ifdef USE_EPOLL
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd == -1) {
+        LogPrintf("epoll_create1 failed: %s, falling back to poll()\n", NetworkErrorString(errno));
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2387,6 +2558,14 @@ void CConnman::Stop()
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
+
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+    mapEpollSockets.clear();
+#endif
 }
 
 void CConnman::DeleteNode(CNode* pnode)
@@ -2711,6 +2890,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        metrics::SentMessages().Add(msg.command, nTotalSize);
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
@@ -23,9 +23,11 @@
 #include <sync.h>
 #include <uint256.h>
 #include <threadinterrupt.h>
+#include <txreconciliation.h>
 
 #include <atomic>
 #include <deque>
+#include <map>
 #include <stdint.h>
 #include <thread>
 #include <memory>
@@ -53,6 +55,10 @@ static const int TIMEOUT_INTERVAL = 20 * 60;
 static const int FEELER_INTERVAL = 120;
 /** The maximum number of entries in an 'inv' protocol message */
 static const unsigned int MAX_INV_SZ = 50000;
+/** Number of the transactions a peer is known to have, which are remembered at least. Up to MAX_INV_SZ for peers announcing more within INVENTORY_KNOWN_RETENTION */
+static const unsigned int INVENTORY_KNOWN_MIN_ELEMENTS = 5000;
+/** Seconds, for which the known transactions of a peer should be remembered (30 minutes) */
+static const int64_t INVENTORY_KNOWN_RETENTION = 30 * 60;
 /** The maximum number of entries in a locator */
 static const unsigned int MAX_LOCATOR_SZ = 101;
 /** The maximum number of new addresses to accumulate before announcing. */
@@ -352,8 +358,11 @@ private:
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
-    bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, std::map<SOCKET, NodeId>* socket_nodes = nullptr);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -406,9 +415,17 @@ private:
     unsigned int nReceiveFloodSize{0};
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+    // epoll instance of the socket handler, or -1 when falling back to poll()
+    int epollfd{-1};
+    // Events each socket is registered for in epollfd, along with the node owning it (-1 for listening sockets)
+    std::map<SOCKET, std::pair<NodeId, uint32_t>> mapEpollSockets;
+#endif
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     CAddrMan addrman;
+    // Modifications of addrman at the last write of peers.dat, the first write is never skipped
+    std::atomic<uint64_t> nDumpedAddrModifications{std::numeric_limits<uint64_t>::max()};
     std::deque<std::string> vOneShots GUARDED_BY(cs_vOneShots);
     CCriticalSection cs_vOneShots;
     std::vector<std::string> vAddedNodes GUARDED_BY(cs_vAddedNodes);
@@ -610,6 +627,26 @@ public:
 
 
 
+/**
+ * Receive buffer of a network message. Its storage is taken from a pool of
+ * buffers of messages already processed and handed back on destruction, so
+ * that the receive path does not allocate, grow and free a buffer for every
+ * message it reads.
+ */
+class CNetMessageData : public CDataStream
+{
+public:
+    CNetMessageData(int nTypeIn, int nVersionIn);
+    CNetMessageData(const CNetMessageData& other) = default;
+    CNetMessageData(CNetMessageData&& other);
+    ~CNetMessageData();
+
+    CNetMessageData& operator=(const CNetMessageData& other) = default;
+
+    //! Number of bytes the buffer holds without reallocating
+    size_type capacity() const { return vch.capacity(); }
+};
+
 class CNetMessage {
 private:
     mutable CHash256 hasher;
@@ -621,7 +658,7 @@ public:
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv;              // received message data
+    CNetMessageData vRecv;          // received message data
     unsigned int nDataPos;
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
@@ -754,7 +791,7 @@ public:
         std::unique_ptr<CBloomFilter> pfilter PT_GUARDED_BY(cs_filter) GUARDED_BY(cs_filter);
 
         mutable CCriticalSection cs_tx_inventory;
-        CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_tx_inventory){50000, 0.000001};
+        CRollingCuckooFilter filterInventoryKnown GUARDED_BY(cs_tx_inventory){INVENTORY_KNOWN_MIN_ELEMENTS, MAX_INV_SZ, INVENTORY_KNOWN_RETENTION};
         // Set of transaction ids we still have to announce.
         // They are sorted by the mempool before relay, so the order is not important.
         std::set<uint256> setInventoryTxToSend;
@@ -763,6 +800,10 @@ public:
         // Last time a "MEMPOOL" request was serviced.
         std::atomic<int64_t> timeLastMempoolReq{0};
         int64_t nNextInvSend{0};
+        // Salt of the "sendrecon" message we sent, 0 if none
+        uint64_t nReconSalt GUARDED_BY(cs_tx_inventory){0};
+        // Set reconciliation of the transaction announcements, if negotiated
+        std::unique_ptr<CTxReconciliationState> m_recon GUARDED_BY(cs_tx_inventory);
 
         CCriticalSection cs_feeFilter;
         // Minimum fee rate with which to filter inv's to this node
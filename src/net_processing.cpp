@@ -23,13 +23,18 @@
 #include <random.h>
 #include <reverse_iterator.h>
 #include <scheduler.h>
+#include <threadpool.h>
 #include <tinyformat.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <util/trace.h>
 #include <util/validation.h>
 
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <thread>
 #include <typeinfo>
 
 #if defined(NDEBUG)
@@ -80,6 +85,12 @@ static_assert(INBOUND_PEER_TX_DELAY >= MAX_GETDATA_RANDOM_DELAY,
 "To preserve security, MAX_GETDATA_RANDOM_DELAY should not exceed INBOUND_PEER_DELAY");
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
+/** Maximum number of blocks in transit from a single fast peer, see GetBlockDownloadWindow() */
+static constexpr int MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER = 128;
+/** Time a peer's blocks in transit should take to arrive at its measured block service time (in microseconds) */
+static constexpr int64_t BLOCK_DOWNLOAD_TARGET_TIME = 2 * 1000000;
+/** Number of threads reading requested blocks from disk and sending them, see CBlockServeQueue */
+static constexpr int BLOCK_SERVE_THREADS = 2;
 
 
 struct COrphanTx {
@@ -112,6 +123,113 @@ static constexpr unsigned int AVG_FEEFILTER_BROADCAST_INTERVAL = 10 * 60;
 /** Maximum feefilter broadcast delay after significant change. */
 static constexpr unsigned int MAX_FEEFILTER_CHANGE_DELAY = 5 * 60;
 
+namespace {
+
+/**
+ * Blocks requested by peers that have to be read from disk are read and sent
+ * here, so that serving old blocks to syncing peers neither holds up the
+ * message handler nor cs_main. Only one block is served to a peer at a time,
+ * and the peer's messages are not processed meanwhile, so that its responses
+ * keep their order.
+ */
+class CBlockServeQueue
+{
+private:
+    struct CBlockServe {
+        CNode* pnode;
+        CConnman* connman;
+        std::function<void()> serve;
+    };
+
+    Mutex cs;
+    std::condition_variable cond;
+    std::deque<CBlockServe> queue GUARDED_BY(cs);
+    std::set<NodeId> setServing GUARDED_BY(cs);
+    bool fStop GUARDED_BY(cs) = false;
+    std::vector<std::thread> threads;
+
+    void Thread()
+    {
+        while (true) {
+            CBlockServe serve;
+            {
+                WAIT_LOCK(cs, lock);
+                while (!fStop && queue.empty())
+                    cond.wait(lock);
+                if (queue.empty())
+                    return;
+                serve = std::move(queue.front());
+                queue.pop_front();
+            }
+            serve.serve();
+            {
+                LOCK(cs);
+                setServing.erase(serve.pnode->GetId());
+            }
+            cond.notify_all();
+            serve.pnode->Release();
+            // Messages of the peer may be waiting for the block to be sent
+            serve.connman->WakeMessageHandler();
+        }
+    }
+
+public:
+    ~CBlockServeQueue() { Stop(); }
+
+    void Start(int nThreads)
+    {
+        if (!threads.empty())
+            return;
+        for (int i = 0; i < nThreads; ++i) {
+            threads.emplace_back(&TraceThread<std::function<void()>>, "blockserve", std::function<void()>(std::bind(&CBlockServeQueue::Thread, this)));
+        }
+    }
+
+    void Stop()
+    {
+        {
+            LOCK(cs);
+            fStop = true;
+        }
+        cond.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+        threads.clear();
+        LOCK(cs);
+        fStop = false;
+    }
+
+    /** Serve a block to a peer, the peer is kept alive until done */
+    void Add(CNode* pnode, CConnman* connman, std::function<void()> serve)
+    {
+        pnode->AddRef();
+        {
+            LOCK(cs);
+            setServing.insert(pnode->GetId());
+            queue.push_back(CBlockServe{pnode, connman, std::move(serve)});
+        }
+        cond.notify_all();
+    }
+
+    bool IsServing(NodeId nodeid)
+    {
+        LOCK(cs);
+        return setServing.count(nodeid) > 0;
+    }
+
+    /** Wait until the block being served to a peer, if any, has been sent */
+    void WaitServed(NodeId nodeid)
+    {
+        WAIT_LOCK(cs, lock);
+        while (setServing.count(nodeid))
+            cond.wait(lock);
+    }
+};
+
+CBlockServeQueue blockServeQueue;
+
+} // namespace
+
 // Internal stuff
 namespace {
     /** Number of nodes with fSyncStarted. */
@@ -165,6 +283,9 @@ namespace {
     /** Number of peers from which we're downloading blocks. */
     int nPeersWithValidatedDownloads GUARDED_BY(cs_main) = 0;
 
+    /** Number of outbound reconciling peers which still get the transactions flooded. */
+    int nReconFloodPeers GUARDED_BY(cs_main) = 0;
+
     /** Number of outbound peers with m_chain_sync.m_protect. */
     int g_outbound_peers_with_protect_from_disconnect GUARDED_BY(cs_main) = 0;
 
@@ -240,12 +361,18 @@ struct CNodeState {
     int64_t nDownloadingSince;
     int nBlocksInFlight;
     int nBlocksInFlightValidHeaders;
+    //! Moving average of the time to receive the first entry in vBlocksInFlight (in microseconds), or 0 before the first one.
+    int64_t nBlockServiceTime;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
     //! Whether this peer wants invs or headers (when possible) for block announcements.
     bool fPreferHeaders;
     //! Whether this peer wants invs or cmpctblocks (when possible) for block announcements.
     bool fPreferHeaderAndIDs;
+    //! Whether this peer wants headers as cheaders messages.
+    bool fPreferCompressedHeaders;
+    //! Whether this outbound reconciling peer still gets the transactions flooded.
+    bool fReconFlood;
     /**
       * Whether this peer will send us cmpctblocks if we request them.
       * This is not used to gate request logic, as we really only care about fSupportsDesiredCmpctVersion,
@@ -379,9 +506,12 @@ struct CNodeState {
         nDownloadingSince = 0;
         nBlocksInFlight = 0;
         nBlocksInFlightValidHeaders = 0;
+        nBlockServiceTime = 0;
         fPreferredDownload = false;
         fPreferHeaders = false;
         fPreferHeaderAndIDs = false;
+        fPreferCompressedHeaders = false;
+        fReconFlood = false;
         fProvidesHeaderAndIDs = false;
         fHaveWitness = false;
         fWantsCmpctWitness = false;
@@ -451,8 +581,12 @@ static bool MarkBlockAsReceived(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs
             nPeersWithValidatedDownloads--;
         }
         if (state->vBlocksInFlight.begin() == itInFlight->second.second) {
-            // First block on the queue was received, update the start download time for the next one
-            state->nDownloadingSince = std::max(state->nDownloadingSince, GetTimeMicros());
+            // First block on the queue was received, measure the service time and update the start download time for the next one.
+            // Requests pipeline, so the service time covers both the bandwidth and the latency of the peer
+            const int64_t nNow = GetTimeMicros();
+            const int64_t nServiceTime = std::max<int64_t>(nNow - state->nDownloadingSince, 1);
+            state->nBlockServiceTime = state->nBlockServiceTime == 0 ? nServiceTime : (state->nBlockServiceTime * 7 + nServiceTime) / 8;
+            state->nDownloadingSince = std::max(state->nDownloadingSince, nNow);
         }
         state->vBlocksInFlight.erase(itInFlight->second.second);
         state->nBlocksInFlight--;
@@ -463,6 +597,19 @@ static bool MarkBlockAsReceived(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs
     return false;
 }
 
+/**
+ * Number of blocks that can be requested from a peer at once: as many as it's measured to serve within
+ * BLOCK_DOWNLOAD_TARGET_TIME, between MAX_BLOCKS_IN_TRANSIT_PER_PEER and MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER.
+ * Fast peers so take larger ranges of the download window.
+ */
+static int GetBlockDownloadWindow(const CNodeState& state)
+{
+    if (state.nBlockServiceTime == 0)
+        return MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+    const int64_t nWindow = BLOCK_DOWNLOAD_TARGET_TIME / state.nBlockServiceTime;
+    return (int) std::max<int64_t>(MAX_BLOCKS_IN_TRANSIT_PER_PEER, std::min<int64_t>(MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER, nWindow));
+}
+
 // returns false, still setting pit, if the block was already in flight from the same peer
 // pit will only be valid as long as the same cs_main lock is being held
 static bool MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const CBlockIndex* pindex = nullptr, std::list<QueuedBlock>::iterator** pit = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
@@ -781,6 +928,8 @@ void PeerLogicValidation::InitializeNode(CNode *pnode) {
 
 void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTime) {
     fUpdateConnectionTime = false;
+    // Peers are normally kept alive while a block is served to them, but not on shutdown
+    blockServeQueue.WaitServed(nodeid);
     LOCK(cs_main);
     CNodeState *state = State(nodeid);
     assert(state != nullptr);
@@ -799,6 +948,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
     nPreferredDownload -= state->fPreferredDownload;
     nPeersWithValidatedDownloads -= (state->nBlocksInFlightValidHeaders != 0);
     assert(nPeersWithValidatedDownloads >= 0);
+    nReconFloodPeers -= state->fReconFlood;
     g_outbound_peers_with_protect_from_disconnect -= state->m_chain_sync.m_protect;
     assert(g_outbound_peers_with_protect_from_disconnect >= 0);
 
@@ -809,6 +959,7 @@ void PeerLogicValidation::FinalizeNode(NodeId nodeid, bool& fUpdateConnectionTim
         assert(mapBlocksInFlight.empty());
         assert(nPreferredDownload == 0);
         assert(nPeersWithValidatedDownloads == 0);
+        assert(nReconFloodPeers == 0);
         assert(g_outbound_peers_with_protect_from_disconnect == 0);
     }
     LogPrint(BCLog::NET, "Cleared nodestate for peer=%d\n", nodeid);
@@ -1116,6 +1267,13 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CS
     // timer.
     static_assert(EXTRA_PEER_CHECK_INTERVAL < STALE_CHECK_INTERVAL, "peer eviction timer should be less than stale tip check timer");
     scheduler.scheduleEvery(std::bind(&PeerLogicValidation::CheckForStaleTipAndEvictPeers, this, consensusParams), EXTRA_PEER_CHECK_INTERVAL * 1000);
+
+    blockServeQueue.Start(BLOCK_SERVE_THREADS);
+}
+
+PeerLogicValidation::~PeerLogicValidation()
+{
+    blockServeQueue.Stop();
 }
 
 /**
@@ -1171,10 +1329,13 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
     LOCK(cs_main);
 
-    static int nHighestFastAnnounce = 0;
-    if (pindex->nHeight <= nHighestFastAnnounce)
+    // Blocks of one height compete on deadline, so a rival with more work than the last
+    // announced block at the same height is announced too
+    static const CBlockIndex* pindexLastFastAnnounce = nullptr;
+    if (pindexLastFastAnnounce != nullptr && (pindex->nHeight < pindexLastFastAnnounce->nHeight ||
+            (pindex->nHeight == pindexLastFastAnnounce->nHeight && pindex->nChainWork <= pindexLastFastAnnounce->nChainWork)))
         return;
-    nHighestFastAnnounce = pindex->nHeight;
+    pindexLastFastAnnounce = pindex;
 
     bool fWitnessEnabled = IsWitnessEnabled(pindex->pprev, Params().GetConsensus());
     uint256 hashBlock(pblock->GetHash());
@@ -1331,6 +1492,24 @@ void RelayTransaction(const uint256& txid, const CConnman& connman)
     });
 }
 
+/** Announce the transactions of a reconciliation set by inv, those still in the mempool */
+static void AnnounceReconciledTransactions(CNode* pto, const std::vector<uint256>& vTxid, CConnman* connman)
+{
+    const CNetMsgMaker msgMaker(pto->GetSendVersion());
+    std::vector<CInv> vInv;
+    for (const uint256& txid : vTxid) {
+        if (!mempool.exists(txid))
+            continue;
+        vInv.push_back(CInv(MSG_TX, txid));
+        if (vInv.size() == MAX_INV_SZ) {
+            connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+            vInv.clear();
+        }
+    }
+    if (!vInv.empty())
+        connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
+}
+
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
 {
     unsigned int nRelayNodes = fReachable ? 2 : 1; // limited relaying of addresses outside our network(s)
@@ -1367,6 +1546,37 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connma
     connman->ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** Read a block from disk and send it to a peer, on a block serve thread */
+static void ServeBlockFromDisk(CNode* pfrom, CConnman* connman, const CInv& inv, const FlatFilePos& pos, const uint256& hashContinueTip, const CChainParams& chainparams)
+{
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    if (inv.type == MSG_WITNESS_BLOCK) {
+        // The network format matches the format on disk, so the block is read
+        // straight into the payload of the message and sent without copying
+        CSerializedNetMsg msg;
+        msg.command = NetMsgType::BLOCK;
+        if (!ReadRawBlockFromDisk(msg.data, pos, chainparams.MessageStart())) {
+            LogPrint(BCLog::NET, "cannot load block %s requested by peer=%d from disk\n", inv.hash.ToString(), pfrom->GetId());
+            return;
+        }
+        connman->PushMessage(pfrom, std::move(msg));
+    } else {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pos, chainparams.GetConsensus()) || block.GetHash() != inv.hash) {
+            LogPrint(BCLog::NET, "cannot load block %s requested by peer=%d from disk\n", inv.hash.ToString(), pfrom->GetId());
+            return;
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
+    }
+
+    if (!hashContinueTip.IsNull()) {
+        // See the hashContinue trigger of ProcessGetBlockData
+        std::vector<CInv> vInv;
+        vInv.push_back(CInv(MSG_BLOCK, hashContinueTip));
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
+    }
+}
+
 void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, const CInv& inv, CConnman* connman)
 {
     bool send = false;
@@ -1440,15 +1650,16 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         std::shared_ptr<const CBlock> pblock;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
-        } else if (inv.type == MSG_WITNESS_BLOCK) {
-            // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
-                assert(!"cannot load block from disk");
+        } else if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) {
+            // Full blocks are read from disk and sent by a block serve thread,
+            // along with the inventory of the hashContinue trigger below
+            uint256 hashContinueTip;
+            if (inv.hash == pfrom->hashContinue) {
+                hashContinueTip = ::ChainActive().Tip()->GetBlockHash();
+                pfrom->hashContinue.SetNull();
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
-            // Don't set pblock as we've sent the block
+            blockServeQueue.Add(pfrom, connman, std::bind(&ServeBlockFromDisk, pfrom, connman, inv, pindex->GetBlockPos(), hashContinueTip, std::cref(chainparams)));
+            return;
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1637,6 +1848,9 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         return true;
     }
 
+    // Hashes of the headers are shared with the header checks
+    const std::vector<CHashedBlockHeader> hashedHeaders = HashBlockHeaders(headers);
+
     bool received_new_header = false;
     const CBlockIndex *pindexLast = nullptr;
     {
@@ -1655,14 +1869,14 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             nodestate->nUnconnectingHeaders++;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, ::ChainActive().GetLocator(pindexBestHeader), uint256()));
             LogPrint(BCLog::NET, "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    hashedHeaders[0].GetHash().ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->GetId(), nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), hashedHeaders.back().GetHash());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -1671,8 +1885,8 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         }
 
         uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+        for (const CHashedBlockHeader& header : hashedHeaders) {
+            if (!hashLastBlock.IsNull() && header.GetHeader().hashPrevBlock != hashLastBlock) {
                 Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
                 return false;
             }
@@ -1688,7 +1902,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+    if (!ProcessNewBlockHeaders(hashedHeaders, state, chainparams, &pindexLast, &first_invalid_header)) {
         if (state.IsInvalid()) {
             MaybePunishNode(pfrom->GetId(), state, via_compact_block, "invalid header received");
             return false;
@@ -1729,7 +1943,8 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             std::vector<const CBlockIndex*> vToFetch;
             const CBlockIndex *pindexWalk = pindexLast;
             // Calculate all the blocks we'd need to switch to pindexLast, up to a limit.
-            while (pindexWalk && !::ChainActive().Contains(pindexWalk) && vToFetch.size() <= MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+            const int nDownloadWindow = GetBlockDownloadWindow(*nodestate);
+            while (pindexWalk && !::ChainActive().Contains(pindexWalk) && vToFetch.size() <= (size_t) nDownloadWindow) {
                 if (!(pindexWalk->nStatus & BLOCK_HAVE_DATA) &&
                         !mapBlocksInFlight.count(pindexWalk->GetBlockHash()) &&
                         (!IsWitnessEnabled(pindexWalk->pprev, chainparams.GetConsensus()) || State(pfrom->GetId())->fHaveWitness)) {
@@ -1750,7 +1965,7 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
                 std::vector<CInv> vGetData;
                 // Download as much as possible, from earliest to latest.
                 for (const CBlockIndex *pindex : reverse_iterate(vToFetch)) {
-                    if (nodestate->nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+                    if (nodestate->nBlocksInFlight >= nDownloadWindow) {
                         // Can't download any more from this peer
                         break;
                     }
@@ -1810,20 +2025,143 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
     return true;
 }
 
+/**
+ * Collect the orphans of the work set and their orphan descendants, at most MAX_ORPHAN_PACKAGE_SIZE of them,
+ * ordered so that every orphan follows its parents in the package.
+ */
+std::vector<CTransactionRef> GetOrphanPackage(const std::set<uint256>& orphan_work_set) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    AssertLockHeld(g_cs_orphans);
+    std::vector<CTransactionRef> vCollected;
+    std::map<uint256, size_t> mapIndex;
+    std::deque<uint256> vQueue(orphan_work_set.begin(), orphan_work_set.end());
+    while (!vQueue.empty() && vCollected.size() < MAX_ORPHAN_PACKAGE_SIZE) {
+        const uint256 hash = vQueue.front();
+        vQueue.pop_front();
+        if (mapIndex.count(hash))
+            continue;
+        auto orphan_it = mapOrphanTransactions.find(hash);
+        if (orphan_it == mapOrphanTransactions.end())
+            continue;
+        mapIndex.emplace(hash, vCollected.size());
+        vCollected.push_back(orphan_it->second.tx);
+        for (unsigned int i = 0; i < orphan_it->second.tx->vout.size(); i++) {
+            auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(hash, i));
+            if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
+                for (const auto& elem : it_by_prev->second) {
+                    vQueue.push_back(elem->first);
+                }
+            }
+        }
+    }
+
+    // Order topologically, an orphan is ready once all its parents in the package are
+    std::vector<size_t> vParentCount(vCollected.size(), 0);
+    std::vector<std::vector<size_t>> vChildren(vCollected.size());
+    for (size_t n = 0; n < vCollected.size(); n++) {
+        std::set<size_t> setParents;
+        for (const CTxIn& txin : vCollected[n]->vin) {
+            auto it = mapIndex.find(txin.prevout.hash);
+            if (it != mapIndex.end() && setParents.insert(it->second).second) {
+                vParentCount[n]++;
+                vChildren[it->second].push_back(n);
+            }
+        }
+    }
+    std::vector<CTransactionRef> vPackage;
+    vPackage.reserve(vCollected.size());
+    std::deque<size_t> vReady;
+    for (size_t n = 0; n < vCollected.size(); n++) {
+        if (vParentCount[n] == 0)
+            vReady.push_back(n);
+    }
+    while (!vReady.empty()) {
+        const size_t n = vReady.front();
+        vReady.pop_front();
+        vPackage.push_back(vCollected[n]);
+        for (size_t nChild : vChildren[n]) {
+            if (--vParentCount[nChild] == 0)
+                vReady.push_back(nChild);
+        }
+    }
+    return vPackage;
+}
+
+/**
+ * Verify the input scripts of an orphan package on the shared thread pool, so that the signatures are found
+ * in the signature cache when the orphans are accepted one by one. The coins spent come from the package, the
+ * mempool or the coins cache, orphans with other inputs are left to the mempool acceptance.
+ */
+static void PreVerifyOrphanPackage(const std::vector<CTransactionRef>& vPackage) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    if (vPackage.size() < 2 || GetThreadPool().GetThreadCount() == 0)
+        return;
+
+    std::map<uint256, CTransactionRef> mapPackage;
+    for (const CTransactionRef& tx : vPackage)
+        mapPackage.emplace(tx->GetHash(), tx);
+
+    struct OrphanScripts {
+        CTransactionRef tx;
+        std::vector<CTxOut> vSpent;
+    };
+    std::vector<OrphanScripts> vScripts;
+    const CCoinsViewCache& view = ::ChainstateActive().CoinsTip();
+    for (const CTransactionRef& tx : vPackage) {
+        OrphanScripts scripts{tx, {}};
+        for (const CTxIn& txin : tx->vin) {
+            auto it = mapPackage.find(txin.prevout.hash);
+            const CTransactionRef parent = it != mapPackage.end() ? it->second : mempool.get(txin.prevout.hash);
+            if (parent) {
+                if (txin.prevout.n >= parent->vout.size())
+                    break;
+                scripts.vSpent.push_back(parent->vout[txin.prevout.n]);
+            } else {
+                // Only coins in the cache, reading others would fill the cache for orphans which may never be accepted
+                if (!view.HaveCoinInCache(txin.prevout))
+                    break;
+                scripts.vSpent.push_back(view.AccessCoin(txin.prevout).out);
+            }
+        }
+        if (scripts.vSpent.size() == tx->vin.size())
+            vScripts.push_back(std::move(scripts));
+    }
+
+    GetThreadPool().RunParallel(TaskPriority::CRITICAL, vScripts.size(), [&vScripts](int n) {
+        const OrphanScripts& scripts = vScripts[n];
+        PrecomputedTransactionData txdata(*scripts.tx);
+        for (unsigned int i = 0; i < scripts.tx->vin.size(); i++) {
+            if (!CScriptCheck(scripts.vSpent[i], *scripts.tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, true, &txdata)())
+                break;
+        }
+    });
+}
+
 void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_set, std::list<CTransactionRef>& removed_txn) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(g_cs_orphans);
+    for (auto it = orphan_work_set.begin(); it != orphan_work_set.end(); ) {
+        if (mapOrphanTransactions.count(*it))
+            it++;
+        else
+            it = orphan_work_set.erase(it);
+    }
+
+    // Resolve the orphans of the work set with their orphan descendants as one package, parents first,
+    // their scripts verified in parallel beforehand
+    const std::vector<CTransactionRef> vPackage = GetOrphanPackage(orphan_work_set);
+    PreVerifyOrphanPackage(vPackage);
+
     std::set<NodeId> setMisbehaving;
-    bool done = false;
-    while (!done && !orphan_work_set.empty()) {
-        const uint256 orphanHash = *orphan_work_set.begin();
-        orphan_work_set.erase(orphan_work_set.begin());
+    for (const CTransactionRef& porphanTx : vPackage) {
+        const uint256 orphanHash = porphanTx->GetHash();
+        orphan_work_set.erase(orphanHash);
 
         auto orphan_it = mapOrphanTransactions.find(orphanHash);
         if (orphan_it == mapOrphanTransactions.end()) continue;
 
-        const CTransactionRef porphanTx = orphan_it->second.tx;
         const CTransaction& orphanTx = *porphanTx;
         NodeId fromPeer = orphan_it->second.fromPeer;
         bool fMissingInputs2 = false;
@@ -1836,6 +2174,7 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
         if (AcceptToMemoryPool(mempool, orphan_state, porphanTx, &fMissingInputs2, &removed_txn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
             LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
             RelayTransaction(orphanHash, *connman);
+            // Children beyond the package are resolved by the next call
             for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
                 auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(orphanHash, i));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
@@ -1845,7 +2184,6 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
                 }
             }
             EraseOrphanTx(orphanHash);
-            done = true;
         } else if (!fMissingInputs2) {
             if (orphan_state.IsInvalid()) {
                 // Punish peer that gave us an invalid orphan tx
@@ -1866,7 +2204,6 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
                 recentRejects->insert(orphanHash);
             }
             EraseOrphanTx(orphanHash);
-            done = true;
         }
         mempool.check(&::ChainstateActive().CoinsTip());
     }
@@ -2133,6 +2470,20 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // nodes)
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDHEADERS));
         }
+        if (pfrom->nVersion >= COMPRESSED_HEADERS_VERSION) {
+            // Tell our peer we prefer to receive headers as cheaders messages
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDCHEADERS));
+        }
+        if (pfrom->nVersion >= TX_RECONCILIATION_VERSION && pfrom->m_tx_relay != nullptr && g_relay_txes &&
+            gArgs.GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION)) {
+            // Offer to reconcile the transaction announcements rather than to flood them
+            const uint64_t nReconSalt = GetRand(std::numeric_limits<uint64_t>::max()) + 1;
+            {
+                LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+                pfrom->m_tx_relay->nReconSalt = nReconSalt;
+            }
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SENDRECON, TXRECONCILIATION_PROTOCOL, nReconSalt));
+        }
         if (pfrom->nVersion >= SHORT_IDS_BLOCKS_VERSION) {
             // Tell our peer we are willing to provide version 1 or 2 cmpctblocks
             // However, we do not request new block announcements using
@@ -2217,6 +2568,140 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return true;
     }
 
+    if (strCommand == NetMsgType::SENDCHEADERS) {
+        LOCK(cs_main);
+        State(pfrom->GetId())->fPreferCompressedHeaders = true;
+        return true;
+    }
+
+    if (strCommand == NetMsgType::SENDRECON) {
+        uint32_t nReconProtocol = 0;
+        uint64_t nRemoteSalt = 0;
+        vRecv >> nReconProtocol >> nRemoteSalt;
+        if (pfrom->m_tx_relay == nullptr || nReconProtocol < TXRECONCILIATION_PROTOCOL)
+            return true;
+
+        LOCK(cs_main);
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        // Only if we offered it too, and only once
+        if (pfrom->m_tx_relay->nReconSalt == 0 || pfrom->m_tx_relay->m_recon)
+            return true;
+        CNodeState* nodestate = State(pfrom->GetId());
+        // We reconcile with our outbound peers and answer our inbound peers, flooding a few outbound peers
+        // keeps the transactions spreading fast
+        if (!pfrom->fInbound && nReconFloodPeers < MAX_RECON_FLOOD_PEERS) {
+            nodestate->fReconFlood = true;
+            nReconFloodPeers++;
+        }
+        pfrom->m_tx_relay->m_recon = MakeUnique<CTxReconciliationState>(!pfrom->fInbound, nodestate->fReconFlood, pfrom->m_tx_relay->nReconSalt, nRemoteSalt);
+        const int64_t nNow = GetTimeMicros();
+        pfrom->m_tx_relay->m_recon->nNextRequest = pfrom->fInbound ? nNow + RECON_RESPONSE_TIMEOUT * 1000000 : PoissonNextSend(nNow, RECON_REQUEST_INTERVAL);
+        LogPrint(BCLog::NET, "reconciling transactions with peer=%d as %s%s\n", pfrom->GetId(),
+            pfrom->fInbound ? "responder" : "initiator", nodestate->fReconFlood ? ", flooding" : "");
+        return true;
+    }
+
+    if (strCommand == NetMsgType::REQRECON) {
+        uint32_t nRemoteSetSize = 0;
+        vRecv >> nRemoteSetSize;
+        if (pfrom->m_tx_relay == nullptr)
+            return true;
+
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        CTxReconciliationState* recon = pfrom->m_tx_relay->m_recon.get();
+        if (!recon || recon->fInitiator) {
+            LogPrint(BCLog::NET, "unexpected reqrecon from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        // The set of a sketch the peer did not answer is announced by inv
+        AnnounceReconciledTransactions(pfrom, CTxReconciliationState::GetTransactions(recon->mapSketchedSet), connman);
+        recon->mapSketchedSet.clear();
+        recon->mapSketchedSet.swap(recon->mapLocalSet);
+        recon->nNextRequest = GetTimeMicros() + RECON_RESPONSE_TIMEOUT * 1000000;
+
+        // A sketch does not pay off if either set is empty or the sets differ too much, then the empty
+        // sketch tells the peer that both sides announce their set by inv
+        uint32_t nCells = 0;
+        if (!recon->mapSketchedSet.empty() && nRemoteSetSize > 0)
+            nCells = CTxReconciliationSketch::CellsForSets(recon->mapSketchedSet.size(), nRemoteSetSize);
+        if (nCells == 0) {
+            AnnounceReconciledTransactions(pfrom, CTxReconciliationState::GetTransactions(recon->mapSketchedSet), connman);
+            recon->mapSketchedSet.clear();
+        }
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SKETCH, CTxReconciliationState::MakeSketch(recon->mapSketchedSet, nCells)));
+        return true;
+    }
+
+    if (strCommand == NetMsgType::SKETCH) {
+        CTxReconciliationSketch sketch;
+        vRecv >> sketch;
+        if (pfrom->m_tx_relay == nullptr)
+            return true;
+
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        CTxReconciliationState* recon = pfrom->m_tx_relay->m_recon.get();
+        if (!recon || !recon->fInitiator || recon->nRequestSent == 0) {
+            LogPrint(BCLog::NET, "unexpected sketch from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        recon->nRequestSent = 0;
+
+        // The sketch of the peer minus ours holds the transactions the peer has and we miss, and those we have
+        // and the peer misses
+        std::vector<uint32_t> vMissing, vLocal;
+        bool fDecoded = false;
+        if (sketch.GetCellCount() > 0) {
+            fDecoded = sketch.IsValid() && sketch.Subtract(CTxReconciliationState::MakeSketch(recon->mapLocalSet, sketch.GetCellCount())) &&
+                sketch.Decode(vMissing, vLocal);
+            if (!fDecoded)
+                vMissing.clear();
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, fDecoded, vMissing));
+        }
+        std::vector<uint256> vTxid;
+        if (fDecoded) {
+            for (uint32_t nShortID : vLocal) {
+                auto it = recon->mapLocalSet.find(nShortID);
+                if (it != recon->mapLocalSet.end())
+                    vTxid.push_back(it->second);
+            }
+        } else {
+            vTxid = CTxReconciliationState::GetTransactions(recon->mapLocalSet);
+        }
+        LogPrint(BCLog::NET, "reconciled %u transactions with peer=%d: %u cells, %s, %u to announce, %u missing\n",
+            recon->mapLocalSet.size(), pfrom->GetId(), sketch.GetCellCount(), fDecoded ? "decoded" : "by inv", vTxid.size(), vMissing.size());
+        AnnounceReconciledTransactions(pfrom, vTxid, connman);
+        recon->mapLocalSet.clear();
+        return true;
+    }
+
+    if (strCommand == NetMsgType::RECONCILDIFF) {
+        bool fDecoded = false;
+        std::vector<uint32_t> vShortID;
+        vRecv >> fDecoded >> vShortID;
+        if (pfrom->m_tx_relay == nullptr)
+            return true;
+
+        LOCK(pfrom->m_tx_relay->cs_tx_inventory);
+        CTxReconciliationState* recon = pfrom->m_tx_relay->m_recon.get();
+        if (!recon || recon->fInitiator) {
+            LogPrint(BCLog::NET, "unexpected reconcildiff from peer=%d\n", pfrom->GetId());
+            return true;
+        }
+        std::vector<uint256> vTxid;
+        if (fDecoded) {
+            for (uint32_t nShortID : vShortID) {
+                auto it = recon->mapSketchedSet.find(nShortID);
+                if (it != recon->mapSketchedSet.end())
+                    vTxid.push_back(it->second);
+            }
+        } else {
+            vTxid = CTxReconciliationState::GetTransactions(recon->mapSketchedSet);
+        }
+        AnnounceReconciledTransactions(pfrom, vTxid, connman);
+        recon->mapSketchedSet.clear();
+        return true;
+    }
+
     if (strCommand == NetMsgType::SENDCMPCT) {
         bool fAnnounceUsingCMPCTBLOCK = false;
         uint64_t nCMPCTBLOCKVersion = 0;
@@ -2503,7 +2988,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // will re-announce the new block via headers (or compact blocks again)
         // in the SendMessages logic.
         nodestate->pindexBestHeaderSent = pindex ? pindex : ::ChainActive().Tip();
-        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+        if (nodestate->fPreferCompressedHeaders)
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CHEADERS, CompressedBlockHeaders(vHeaders)));
+        else
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
         return true;
     }
 
@@ -2986,6 +3474,31 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return ProcessHeadersMessage(pfrom, connman, headers, chainparams, /*via_compact_block=*/false);
     }
 
+    if (strCommand == NetMsgType::CHEADERS)
+    {
+        // Ignore headers received while importing
+        if (fImporting || fReindex) {
+            LogPrint(BCLog::NET, "Unexpected cheaders message received from peer %d\n", pfrom->GetId());
+            return true;
+        }
+
+        std::vector<CBlockHeader> headers;
+
+        unsigned int nCount = ReadCompactSize(vRecv);
+        if (nCount > MAX_HEADERS_RESULTS) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), 20, strprintf("cheaders message size = %u", nCount));
+            return false;
+        }
+        headers.resize(nCount);
+        CompressedHeaderCoder coder;
+        for (unsigned int n = 0; n < nCount; n++) {
+            coder.Decode(vRecv, headers[n]);
+        }
+
+        return ProcessHeadersMessage(pfrom, connman, headers, chainparams, /*via_compact_block=*/false);
+    }
+
     if (strCommand == NetMsgType::BLOCK)
     {
         // Ignore block received while importing
@@ -3306,6 +3819,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     //
     bool fMoreWork = false;
 
+    // This maintains the order of responses while a block is being served
+    // to the peer, which wakes us up again once it has been sent
+    if (blockServeQueue.IsServing(pfrom->GetId()))
+        return false;
+
     if (!pfrom->vRecvGetData.empty())
         ProcessGetData(pfrom, chainparams, connman, interruptMsgProc);
 
@@ -3377,6 +3895,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Process message
     bool fRet = false;
+    TRACE3(net, process_message_entry, pfrom->GetId(), strCommand.c_str(), nMessageSize);
     try
     {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
@@ -3390,6 +3909,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrint(BCLog::NET, "%s(%s, %u bytes): Unknown exception caught\n", __func__, SanitizeString(strCommand), nMessageSize);
     }
 
+    TRACE2(net, process_message_exit, pfrom->GetId(), fRet);
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
@@ -3768,7 +4288,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                         LogPrint(BCLog::NET, "%s: sending header %s to peer=%d\n", __func__,
                                 vHeaders.front().GetHash().ToString(), pto->GetId());
                     }
-                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+                    if (state.fPreferCompressedHeaders)
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::CHEADERS, CompressedBlockHeaders(vHeaders)));
+                    else
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
                     state.pindexBestHeaderSent = pBestIndex;
                 } else
                     fRevertToInv = true;
@@ -3914,9 +4437,11 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                             continue;
                         }
                         if (pto->m_tx_relay->pfilter && !pto->m_tx_relay->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
-                        // Send
-                        vInv.push_back(CInv(MSG_TX, hash));
-                        nRelayedTransactions++;
+                        // Send, or leave it to the next reconciliation
+                        if (!pto->m_tx_relay->m_recon || pto->m_tx_relay->m_recon->fFlood || !pto->m_tx_relay->m_recon->AddTransaction(hash)) {
+                            vInv.push_back(CInv(MSG_TX, hash));
+                            nRelayedTransactions++;
+                        }
                         {
                             // Expire old relay messages
                             while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
@@ -3937,6 +4462,31 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                         pto->m_tx_relay->filterInventoryKnown.insert(hash);
                     }
                 }
+
+                // Reconcile the transaction announcements
+                if (pto->m_tx_relay->m_recon) {
+                    CTxReconciliationState& recon = *pto->m_tx_relay->m_recon;
+                    if (recon.fInitiator) {
+                        if (recon.nRequestSent != 0 && recon.nRequestSent < nNow - RECON_RESPONSE_TIMEOUT * 1000000) {
+                            LogPrint(BCLog::NET, "reconciliation with peer=%d timed out\n", pto->GetId());
+                            AnnounceReconciledTransactions(pto, CTxReconciliationState::GetTransactions(recon.mapLocalSet), connman);
+                            recon.mapLocalSet.clear();
+                            recon.nRequestSent = 0;
+                        }
+                        if (recon.nRequestSent == 0 && recon.nNextRequest < nNow) {
+                            connman->PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, (uint32_t) recon.mapLocalSet.size()));
+                            recon.nRequestSent = nNow;
+                            recon.nNextRequest = PoissonNextSend(nNow, RECON_REQUEST_INTERVAL);
+                        }
+                    } else if (recon.nNextRequest < nNow) {
+                        // The peer stopped asking, announce the sets by inv
+                        AnnounceReconciledTransactions(pto, CTxReconciliationState::GetTransactions(recon.mapSketchedSet), connman);
+                        AnnounceReconciledTransactions(pto, CTxReconciliationState::GetTransactions(recon.mapLocalSet), connman);
+                        recon.mapSketchedSet.clear();
+                        recon.mapLocalSet.clear();
+                        recon.nNextRequest = nNow + RECON_RESPONSE_TIMEOUT * 1000000;
+                    }
+                }
             }
         }
         if (!vInv.empty())
@@ -4010,10 +4560,11 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !::ChainstateActive().IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        const int nDownloadWindow = GetBlockDownloadWindow(state);
+        if (!pto->fClient && ((fFetch && !pto->m_limited_node) || !::ChainstateActive().IsInitialBlockDownload()) && state.nBlocksInFlight < nDownloadWindow) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller, consensusParams);
+            FindNextBlocksToDownload(pto->GetId(), nDownloadWindow - state.nBlocksInFlight, vToDownload, staller, consensusParams);
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = GetFetchFlags(pto);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
@@ -0,0 +1,51 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
+#define BITCOIN_NODE_UTXO_SNAPSHOT_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <cstdint>
+
+//! Version of the UTXO set snapshot format, written by dumptxoutset
+static const int UTXO_SNAPSHOT_VERSION = 1;
+
+/**
+ * Metadata of a UTXO set snapshot. The snapshot file continues with:
+ * - the number of transactions and the miner reward output of each block from height 1 up to the base block, which
+ *   blocks following the base still refer to
+ * - the number of epochs of the base chain with a staking pool snapshot, and for each one its hash, its pools and the
+ *   users of each pool
+ * - the coins, each one after its outpoint, in the order of the coin database
+ * - the hash of all preceding data, committing to the snapshot
+ */
+class SnapshotMetadata
+{
+public:
+    int m_version;
+    //! The block whose chain state the snapshot holds
+    uint256 m_base_blockhash;
+    //! The number of coins in the snapshot
+    uint64_t m_coins_count;
+    //! The number of transactions in the chain up to and including the base block
+    unsigned int m_nchaintx;
+
+    SnapshotMetadata() : m_version(UTXO_SNAPSHOT_VERSION), m_coins_count(0), m_nchaintx(0) {}
+    SnapshotMetadata(const uint256& base_blockhash, uint64_t coins_count, unsigned int nchaintx) :
+        m_version(UTXO_SNAPSHOT_VERSION), m_base_blockhash(base_blockhash), m_coins_count(coins_count), m_nchaintx(nchaintx) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(m_version);
+        READWRITE(m_base_blockhash);
+        READWRITE(m_coins_count);
+        READWRITE(m_nchaintx);
+    }
+};
+
+#endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
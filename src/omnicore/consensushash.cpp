@@ -98,6 +98,33 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
     return strprintf("%d|%s", propertyId, address);
 }
 
+typedef std::unordered_map<std::string, CMPTally>::value_type TallyEntry;
+
+// Orders tally entries by address, without copying the tallies
+static std::vector<TallyEntry*> GetSortedTallies() EXCLUSIVE_LOCKS_REQUIRED(cs_tally)
+{
+    std::vector<TallyEntry*> vecTallies;
+    vecTallies.reserve(mp_tally_map.size());
+    for (std::unordered_map<std::string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
+        vecTallies.push_back(&(*uoit));
+    }
+    std::sort(vecTallies.begin(), vecTallies.end(), [](const TallyEntry* a, const TallyEntry* b) { return a->first < b->first; });
+    return vecTallies;
+}
+
+// Adds the MetaDEx trades of a property to the list of trades to hash
+static void AddMetaDExTrades(const md_PricesMap& prices, std::vector<std::pair<arith_uint256, std::string> >& vecMetaDExTrades)
+{
+    for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
+        const md_Set& indexes = it->second;
+        for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            const CMPMetaDEx& obj = *it;
+            std::string dataStr = GenerateConsensusString(obj);
+            vecMetaDExTrades.push_back(std::make_pair(UintToArith256(obj.getHash()), dataStr));
+        }
+    }
+}
+
 /**
  * Obtains a hash of the active state to use for consensus verification and checkpointing.
  *
@@ -160,13 +187,9 @@ uint256 GetConsensusHash()
     // Balances - loop through the tally map, updating the sha context with the data from each balance and tally type
     // Placeholders:  "address|propertyid|balance|selloffer_reserve|accept_reserve|metadex_reserve"
     // Sort alphabetically first
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<std::string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
-    }
-    for (std::map<std::string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
+    for (TallyEntry* entry : GetSortedTallies()) {
+        const std::string& address = entry->first;
+        CMPTally& tally = entry->second;
         tally.init();
         uint32_t propertyId = 0;
         while (0 != (propertyId = (tally.next()))) {
@@ -185,7 +208,7 @@ uint256 GetConsensusHash()
         const std::string& sellCombo = it->first;
         std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
         std::string dataStr = GenerateConsensusString(selloffer, seller);
-        vecDExOffers.push_back(std::make_pair(arith_uint256(selloffer.getHash().ToString()), dataStr));
+        vecDExOffers.push_back(std::make_pair(UintToArith256(selloffer.getHash()), dataStr));
     }
     std::sort (vecDExOffers.begin(), vecDExOffers.end());
     for (std::vector<std::pair<arith_uint256, std::string> >::iterator it = vecDExOffers.begin(); it != vecDExOffers.end(); ++it) {
@@ -216,15 +239,7 @@ uint256 GetConsensusHash()
     // Placeholders: "txid|address|propertyidforsale|amountforsale|propertyiddesired|amountdesired|amountremaining"
     std::vector<std::pair<arith_uint256, std::string> > vecMetaDExTrades;
     for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        const md_PricesMap& prices = my_it->second;
-        for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
-            const md_Set& indexes = it->second;
-            for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                const CMPMetaDEx& obj = *it;
-                std::string dataStr = GenerateConsensusString(obj);
-                vecMetaDExTrades.push_back(std::make_pair(arith_uint256(obj.getHash().ToString()), dataStr));
-            }
-        }
+        AddMetaDExTrades(my_it->second, vecMetaDExTrades);
     }
     std::sort (vecMetaDExTrades.begin(), vecMetaDExTrades.end());
     for (std::vector<std::pair<arith_uint256, std::string> >::iterator it = vecMetaDExTrades.begin(); it != vecMetaDExTrades.end(); ++it) {
@@ -285,17 +300,14 @@ uint256 GetMetaDExHash(const uint32_t propertyId)
     LOCK(cs_tally);
 
     std::vector<std::pair<arith_uint256, std::string> > vecMetaDExTrades;
-    for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyId == 0 || propertyId == my_it->first) {
-            const md_PricesMap& prices = my_it->second;
-            for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
-                const md_Set& indexes = it->second;
-                for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                    const CMPMetaDEx& obj = *it;
-                    std::string dataStr = GenerateConsensusString(obj);
-                    vecMetaDExTrades.push_back(std::make_pair(arith_uint256(obj.getHash().ToString()), dataStr));
-                }
-            }
+    if (propertyId == 0) {
+        for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
+            AddMetaDExTrades(my_it->second, vecMetaDExTrades);
+        }
+    } else {
+        md_PropertiesMap::const_iterator my_it = metadex.find(propertyId);
+        if (my_it != metadex.end()) {
+            AddMetaDExTrades(my_it->second, vecMetaDExTrades);
         }
     }
     std::sort (vecMetaDExTrades.begin(), vecMetaDExTrades.end());
@@ -318,22 +330,19 @@ uint256 GetBalancesHash(const uint32_t hashPropertyId)
 
     LOCK(cs_tally);
 
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<std::string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
+    // property 0 terminates the iteration over balance records, and is never hashed
+    if (hashPropertyId == 0) {
+        uint256 balancesHash;
+        SHA256_Final((unsigned char*)&balancesHash, &shaCtx);
+        return balancesHash;
     }
-    for (std::map<std::string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
-        tally.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = (tally.next()))) {
-            if (propertyId != hashPropertyId) continue;
-            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
-            if (dataStr.empty()) continue;
-            if (msc_debug_consensus_hash) PrintToLog("Adding data to balances hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-        }
+
+    for (const TallyEntry* entry : GetSortedTallies()) {
+        // the balance record of the property is looked up directly, missing records are empty
+        std::string dataStr = GenerateConsensusString(entry->second, entry->first, hashPropertyId);
+        if (dataStr.empty()) continue;
+        if (msc_debug_consensus_hash) PrintToLog("Adding data to balances hash: %s\n", dataStr);
+        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
     }
 
     uint256 balancesHash;
@@ -2,6 +2,7 @@
 
 #include <omnicore/log.h>
 
+#include <crypto/common.h>
 #include <fs.h>
 #include <util/system.h>
 
@@ -10,6 +11,20 @@
 
 #include <stdint.h>
 
+#include <string>
+#include <vector>
+
+//! Key prefix of the journal: big-endian block and the key written
+static const char DB_JOURNAL = '\0';
+
+static std::string JournalPrefix(uint32_t nBlock)
+{
+    unsigned char buf[5];
+    buf[0] = DB_JOURNAL;
+    WriteBE32(buf + 1, nBlock);
+    return std::string((const char*) buf, sizeof(buf));
+}
+
 /**
  * Opens or creates a LevelDB based database.
  */
@@ -30,6 +45,8 @@ leveldb::Status CDBBase::Open(const fs::path& path, bool fWipe)
  */
 void CDBBase::Clear()
 {
+    DiscardBatch();
+
     int64_t nTimeStart = GetTimeMicros();
     unsigned int n = 0;
     leveldb::WriteBatch batch;
@@ -58,12 +75,155 @@ void CDBBase::Clear()
 void CDBBase::Close()
 {
     if (pdb) {
+        CommitBatch();
         delete pdb;
         pdb = NULL;
     }
 }
 
 
+/**
+ * Writes a value, or adds it to the batch, if writes are batched.
+ */
+leveldb::Status CDBBase::WriteValue(const std::string& key, const std::string& value)
+{
+    assert(pdb != NULL);
+    if (!fBatch) {
+        return pdb->Put(writeoptions, key, value);
+    }
+    batch.Put(key, value);
+    mapBatched[key] = value;
+
+    return leveldb::Status::OK();
+}
+
+/**
+ * Reads a value, including values of the batch, which are not yet committed.
+ */
+leveldb::Status CDBBase::ReadValue(const std::string& key, std::string* value) const
+{
+    assert(pdb != NULL);
+    if (fBatch) {
+        std::map<std::string, std::string>::const_iterator it = mapBatched.find(key);
+        if (it != mapBatched.end()) {
+            *value = it->second;
+            return leveldb::Status::OK();
+        }
+    }
+
+    return pdb->Get(readoptions, key, value);
+}
+
+/**
+ * Writes a value, and records in the journal that the key was written in the block.
+ */
+leveldb::Status CDBBase::WriteJournaled(int nBlock, const std::string& key, const std::string& value)
+{
+    assert(pdb != NULL);
+    assert(nBlock >= 0);
+    const std::string journalKey = JournalPrefix(nBlock) + key;
+    if (fBatch) {
+        batch.Put(key, value);
+        batch.Put(journalKey, "");
+        mapBatched[key] = value;
+        mapBatched[journalKey] = "";
+        return leveldb::Status::OK();
+    }
+
+    leveldb::WriteBatch writeBatch;
+    writeBatch.Put(key, value);
+    writeBatch.Put(journalKey, "");
+
+    return pdb->Write(writeoptions, &writeBatch);
+}
+
+/**
+ * Returns the keys written in a range of blocks, as recorded in the journal.
+ */
+void CDBBase::ReadJournal(int nBlockFirst, int nBlockLast, std::vector<std::string>& vKeys, leveldb::WriteBatch* pbatch) const
+{
+    assert(pdb != NULL);
+    if (nBlockFirst < 0) nBlockFirst = 0;
+    if (nBlockLast < nBlockFirst) return;
+
+    const std::string first = JournalPrefix(nBlockFirst);
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(first); it->Valid() && IsJournalKey(it->key()); it->Next()) {
+        const leveldb::Slice key = it->key();
+        if (ReadBE32((const unsigned char*) key.data() + 1) > (uint32_t) nBlockLast) break;
+        vKeys.push_back(std::string(key.data() + 5, key.size() - 5));
+        if (pbatch) pbatch->Delete(key);
+    }
+    delete it;
+}
+
+/**
+ * Whether the key is one of the journal.
+ */
+bool CDBBase::IsJournalKey(const leveldb::Slice& key)
+{
+    return key.size() > 5 && key[0] == DB_JOURNAL;
+}
+
+/**
+ * Starts to collect writes in a batch, which are committed together.
+ */
+void CDBBase::BeginBatch()
+{
+    CommitBatch();
+    fBatch = true;
+}
+
+/**
+ * Commits the writes of the batch, and stops batching.
+ */
+leveldb::Status CDBBase::CommitBatch()
+{
+    if (!fBatch) return leveldb::Status::OK();
+
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    if (msc_debug_persistence) {
+        PrintToLog("Committed %d batched entries: %s\n", mapBatched.size(), status.ToString());
+    }
+    DiscardBatch();
+
+    return status;
+}
+
+/**
+ * Drops the writes of the batch, and stops batching.
+ */
+void CDBBase::DiscardBatch()
+{
+    batch.Clear();
+    mapBatched.clear();
+    fBatch = false;
+}
+
+/**
+ * Compacts the journal, which is erased as blocks become final.
+ */
+void CDBBase::CompactJournal()
+{
+    if (pdb == NULL) return;
+
+    const char begin = DB_JOURNAL, end = DB_JOURNAL + 1;
+    leveldb::Slice slBegin(&begin, 1), slEnd(&end, 1);
+    pdb->CompactRange(&slBegin, &slEnd);
+}
+
+/**
+ * Compacts the entries of the database other than the journal.
+ */
+void CDBBase::CompactEntries()
+{
+    if (pdb == NULL) return;
+
+    const char begin = DB_JOURNAL + 1;
+    leveldb::Slice slBegin(&begin, 1);
+    pdb->CompactRange(&slBegin, NULL);
+}
+
 /**
 @todo  Move initialization and deinitialization of databases into this file (?)
 @todo  Move file based storage into this file
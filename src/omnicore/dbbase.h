@@ -2,12 +2,17 @@
 #define BITCOIN_OMNICORE_DBBASE_H
 
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 #include <fs.h>
 
 #include <assert.h>
 #include <stddef.h>
 
+#include <map>
+#include <string>
+#include <vector>
+
 /** Base class for LevelDB based storage.
  */
 class CDBBase
@@ -16,6 +21,15 @@ private:
     //! Options used when iterating over values of the database
     leveldb::ReadOptions iteroptions;
 
+    //! Whether writes are collected in the batch
+    bool fBatch;
+
+    //! Writes, which are committed together
+    leveldb::WriteBatch batch;
+
+    //! Values written to the batch, so they can be read before they are committed
+    std::map<std::string, std::string> mapBatched;
+
 protected:
     //! Database options used
     leveldb::Options options;
@@ -38,7 +52,7 @@ protected:
     //! Number of entries written
     unsigned int nWritten;
 
-    CDBBase() : pdb(NULL), nRead(0), nWritten(0)
+    CDBBase() : fBatch(false), pdb(NULL), nRead(0), nWritten(0)
     {
         options.paranoid_checks = true;
         options.create_if_missing = true;
@@ -86,11 +100,89 @@ protected:
      */
     void Close();
 
+    /**
+     * Writes a value, or adds it to the batch, if writes are batched.
+     *
+     * @param key    The key of the value
+     * @param value  The value to write
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status WriteValue(const std::string& key, const std::string& value);
+
+    /**
+     * Reads a value, including values of the batch, which are not yet committed.
+     *
+     * Iterators only see committed values.
+     *
+     * @param key    The key of the value
+     * @param value  The value read
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status ReadValue(const std::string& key, std::string* value) const;
+
+    /**
+     * Writes a value, and records in the journal that the key was written in the block.
+     *
+     * Both are written together, or added to the batch, if writes are batched.
+     *
+     * @param nBlock  The block the value belongs to
+     * @param key     The key of the value
+     * @param value   The value to write
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status WriteJournaled(int nBlock, const std::string& key, const std::string& value);
+
+    /**
+     * Returns the keys written in a range of blocks, as recorded in the journal.
+     *
+     * Only committed journal entries are considered.
+     *
+     * @param nBlockFirst  The first block of the range
+     * @param nBlockLast   The last block of the range, inclusive
+     * @param vKeys[out]   The keys written, ordered by block
+     * @param pbatch[out]  If set, the journal entries are added to the batch for removal
+     */
+    void ReadJournal(int nBlockFirst, int nBlockLast, std::vector<std::string>& vKeys, leveldb::WriteBatch* pbatch = nullptr) const;
+
+    /**
+     * Whether the key is one of the journal.
+     */
+    static bool IsJournalKey(const leveldb::Slice& key);
+
 public:
     /**
      * Deletes all entries of the database, and resets the counters.
      */
     void Clear();
+
+    /**
+     * Starts to collect writes in a batch, which are committed together.
+     *
+     * A batch that is still open is committed first.
+     */
+    void BeginBatch();
+
+    /**
+     * Commits the writes of the batch, and stops batching.
+     *
+     * @return A Status object, indicating success or failure
+     */
+    leveldb::Status CommitBatch();
+
+    /**
+     * Drops the writes of the batch, and stops batching.
+     */
+    void DiscardBatch();
+
+    /**
+     * Compacts the journal, which is erased as blocks become final.
+     */
+    void CompactJournal();
+
+    /**
+     * Compacts the entries of the database other than the journal.
+     */
+    void CompactEntries();
 };
 
 
@@ -220,11 +220,13 @@ void COmniFeeCache::DistributeCache(const uint32_t &propertyId, int block)
         int64_t will_really_receive = it->first;
         sent_so_far += will_really_receive;
         if (msc_debug_fees) PrintToLog("  %s receives %d (running total %d of %d)\n", address, will_really_receive, sent_so_far, cachedAmount);
-        assert(update_tally_map(address, propertyId, will_really_receive, BALANCE));
         feeHistoryItem recipient(address, will_really_receive);
         historyItems.insert(recipient);
     }
 
+    // credit all receivers at once
+    credit_tally_map(receiversSet, propertyId);
+
     PrintToLog("Fee distribution completed, distributed %d out of %d\n", sent_so_far, cachedAmount);
 
     // store the fee distribution
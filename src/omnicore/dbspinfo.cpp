@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 
+#include <memory>
 #include <string>
 
 
@@ -84,7 +85,7 @@ std::string CMPSPInfo::Entry::getIssuer(int block) const
     return _issuer;
 }
 
-CMPSPInfo::CMPSPInfo(const fs::path& path, bool fWipe)
+CMPSPInfo::CMPSPInfo(const fs::path& path, bool fWipe) : nCacheGeneration(0)
 {
     leveldb::Status status = Open(path, fWipe);
     PrintToConsole("Loading smart property database: %s\n", status.ToString());
@@ -122,6 +123,7 @@ void CMPSPInfo::Clear()
 {
     // wipe database via parent class
     CDBBase::Clear();
+    ClearCache();
     // reset "next property identifiers"
     init();
 }
@@ -187,8 +189,13 @@ bool CMPSPInfo::updateSP(uint32_t propertyId, const Entry& info)
 
     if (!status.ok()) {
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
+        {
+            LOCK(cs_cache);
+            cacheEntries.erase(propertyId);
+        }
         return false;
     }
+    cacheSP(propertyId, info);
 
     PrintToLog("%s(): updated entry for SP %d successfully\n", __func__, propertyId);
     return true;
@@ -250,22 +257,17 @@ uint32_t CMPSPInfo::putSP(uint8_t ecosystem, const Entry& info)
 
     if (!status.ok()) {
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
+        LOCK(cs_cache);
+        cacheEntries.erase(propertyId);
+    } else {
+        cacheSP(propertyId, info);
     }
 
     return propertyId;
 }
 
-bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
+std::shared_ptr<const CMPSPInfo::Entry> CMPSPInfo::readSP(uint32_t propertyId) const
 {
-    // special cases for constant SPs MSC and TMSC
-    if (OMNI_PROPERTY_MSC == propertyId) {
-        info = implied_omni;
-        return true;
-    } else if (OMNI_PROPERTY_TMSC == propertyId) {
-        info = implied_tomni;
-        return true;
-    }
-
     // DB key for property entry
     CDataStream ssSpKey(SER_DISK, CLIENT_VERSION);
     ssSpKey << std::make_pair('s', propertyId);
@@ -278,37 +280,71 @@ bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
         if (!status.IsNotFound()) {
             PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
         }
-        return false;
+        return nullptr;
     }
 
+    std::shared_ptr<Entry> info = std::make_shared<Entry>();
     try {
         CDataStream ssSpValue(strSpValue.data(), strSpValue.data() + strSpValue.size(), SER_DISK, CLIENT_VERSION);
-        ssSpValue >> info;
+        ssSpValue >> *info;
     } catch (const std::exception& e) {
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, e.what());
-        return false;
+        return nullptr;
     }
 
-    return true;
+    return info;
 }
 
-bool CMPSPInfo::hasSP(uint32_t propertyId) const
+void CMPSPInfo::ClearCache()
 {
-    // Special cases for constant SPs MSC and TMSC
-    if (OMNI_PROPERTY_MSC == propertyId || OMNI_PROPERTY_TMSC == propertyId) {
-        return true;
+    LOCK(cs_cache);
+    cacheEntries.clear();
+    ++nCacheGeneration;
+}
+
+void CMPSPInfo::cacheSP(uint32_t propertyId, const Entry& info)
+{
+    std::shared_ptr<const Entry> entry = std::make_shared<const Entry>(info);
+    LOCK(cs_cache);
+    cacheEntries[propertyId] = std::move(entry);
+}
+
+std::shared_ptr<const CMPSPInfo::Entry> CMPSPInfo::getSPEntry(uint32_t propertyId) const
+{
+    // special cases for constant SPs MSC and TMSC, which are never freed
+    if (OMNI_PROPERTY_MSC == propertyId) {
+        return std::shared_ptr<const Entry>(std::shared_ptr<const Entry>(), &implied_omni);
+    } else if (OMNI_PROPERTY_TMSC == propertyId) {
+        return std::shared_ptr<const Entry>(std::shared_ptr<const Entry>(), &implied_tomni);
     }
 
-    // DB key for property entry
-    CDataStream ssSpKey(SER_DISK, CLIENT_VERSION);
-    ssSpKey << std::make_pair('s', propertyId);
-    leveldb::Slice slSpKey(&ssSpKey[0], ssSpKey.size());
+    uint64_t nGeneration;
+    {
+        LOCK(cs_cache);
+        auto it = cacheEntries.find(propertyId);
+        if (it != cacheEntries.end()) return it->second;
+        nGeneration = nCacheGeneration;
+    }
 
-    // DB value for property entry
-    std::string strSpValue;
-    leveldb::Status status = pdb->Get(readoptions, slSpKey, &strSpValue);
+    // read outside of the lock, a concurrent write through wins, and a read of a cleared state is not cached
+    std::shared_ptr<const Entry> entry = readSP(propertyId);
+    LOCK(cs_cache);
+    if (nGeneration != nCacheGeneration) return entry;
+    return cacheEntries.emplace(propertyId, entry).first->second;
+}
 
-    return status.ok();
+bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
+{
+    std::shared_ptr<const Entry> entry = getSPEntry(propertyId);
+    if (!entry) return false;
+
+    info = *entry;
+    return true;
+}
+
+bool CMPSPInfo::hasSP(uint32_t propertyId) const
+{
+    return getSPEntry(propertyId) != nullptr;
 }
 
 uint32_t CMPSPInfo::findSPByTX(const uint256& txid) const
@@ -410,6 +446,9 @@ int64_t CMPSPInfo::popBlock(const uint256& block_hash)
 
     leveldb::Status status = pdb->Write(syncoptions, &commitBatch);
 
+    // the rolled back entries are read again on demand
+    ClearCache();
+
     if (!status.ok()) {
         PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
         return -4;
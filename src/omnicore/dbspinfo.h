@@ -7,12 +7,15 @@
 
 #include <fs.h>
 #include <serialize.h>
+#include <sync.h>
 #include <uint256.h>
 
 #include <stdint.h>
 
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 /** LevelDB based storage for currencies, smart properties and tokens.
  *
@@ -41,6 +44,9 @@
  *      uint32_t propertyId
  *  Value:
  *      CMPSPInfo::Entry info
+ *
+ * The current entries are cached in memory. The cache is written through by
+ * putSP() and updateSP(), and cleared when a block is popped.
  */
 class CMPSPInfo : public CDBBase
 {
@@ -138,6 +144,17 @@ private:
     uint32_t next_spid;
     uint32_t next_test_spid;
 
+    //! Current entries by property, nullptr if the property does not exist
+    mutable Mutex cs_cache;
+    mutable std::unordered_map<uint32_t, std::shared_ptr<const Entry> > cacheEntries GUARDED_BY(cs_cache);
+    //! Increased whenever the cache is cleared, so that reads of the previous state are not cached
+    uint64_t nCacheGeneration GUARDED_BY(cs_cache);
+
+    /** Reads an entry from the DB, or returns nullptr, if there is none. */
+    std::shared_ptr<const Entry> readSP(uint32_t propertyId) const;
+    void cacheSP(uint32_t propertyId, const Entry& info);
+    void ClearCache();
+
 public:
     CMPSPInfo(const fs::path& path, bool fWipe);
     virtual ~CMPSPInfo();
@@ -151,6 +168,8 @@ public:
     bool updateSP(uint32_t propertyId, const Entry& info);
     uint32_t putSP(uint8_t ecosystem, const Entry& info);
     bool getSP(uint32_t propertyId, Entry& info) const;
+    /** Returns the shared entry of a property without copying it, or nullptr, if there is none. */
+    std::shared_ptr<const Entry> getSPEntry(uint32_t propertyId) const;
     bool hasSP(uint32_t propertyId) const;
     uint32_t findSPByTX(const uint256& txid) const;
 
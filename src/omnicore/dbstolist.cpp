@@ -15,6 +15,7 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -22,6 +23,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <limits>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -63,6 +66,7 @@ void CMPSTOList::getRecipients(const uint256 txid, std::string filterAddress, Un
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
         skey = it->key();
+        if (IsJournalKey(skey)) continue;
         std::string recipientAddress = skey.ToString();
         svalue = it->value();
         std::string strValue = svalue.ToString();
@@ -123,6 +127,7 @@ std::string CMPSTOList::getMySTOReceipts(std::string filterAddress, interfaces::
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
         skey = it->key();
+        if (IsJournalKey(skey)) continue;
         std::string recipientAddress = skey.ToString();
         if (!IsMyAddress(recipientAddress, &iWallet)) continue; // not ours, not interested
         if ((!filterAddress.empty()) && (filterAddress != recipientAddress)) continue; // not the filtered address
@@ -157,10 +162,17 @@ int CMPSTOList::deleteAboveBlock(int blockNum)
 {
     unsigned int n_found = 0;
     std::vector<std::string> vecSTORecords;
-    leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    leveldb::WriteBatch batch;
+
+    // only addresses, which received tokens in or above the block, are affected
+    std::vector<std::string> vKeys;
+    ReadJournal(blockNum, std::numeric_limits<int>::max(), vKeys, &batch);
+    std::set<std::string> setAddresses(vKeys.begin(), vKeys.end());
+
+    for (const std::string& address : setAddresses) {
+        std::string oldValue;
+        if (!pdb->Get(readoptions, address, &oldValue).ok()) continue;
         std::string newValue;
-        std::string oldValue = it->value().ToString();
         bool needsUpdate = false;
         boost::split(vecSTORecords, oldValue, boost::is_any_of(","), boost::token_compress_on);
         for (uint32_t i = 0; i < vecSTORecords.size(); i++) {
@@ -175,15 +187,16 @@ int CMPSTOList::deleteAboveBlock(int blockNum)
         }
         if (needsUpdate) { // rewrite record with existing key and new value
             ++n_found;
-            leveldb::Status status = pdb->Put(writeoptions, it->key().ToString(), newValue);
+            batch.Put(address, newValue);
             PrintToLog("DEBUG STO - rewriting STO data after reorg\n");
-            PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
         }
     }
 
-    PrintToLog("%s(%d); stodb updated records= %d\n", __FUNCTION__, blockNum, n_found);
+    // rewrite all records at once, so the rollback is atomic
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
 
-    delete it;
+    PrintToLog("%s(%d); stodb updated records= %d\n", __FUNCTION__, blockNum, n_found);
 
     return (n_found);
 }
@@ -214,7 +227,7 @@ bool CMPSTOList::exists(std::string address)
     if (!pdb) return false;
 
     std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, address, &strValue);
+    leveldb::Status status = ReadValue(address, &strValue);
 
     if (!status.ok()) {
         if (status.IsNotFound()) return false;
@@ -232,7 +245,7 @@ void CMPSTOList::recordSTOReceive(std::string address, const uint256 &txid, int
         // retrieve existing record
         std::vector<std::string> vstr;
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, address, &strValue);
+        leveldb::Status status = ReadValue(address, &strValue);
         if (status.ok()) {
             // add details to record
             // see if we are overwriting (check)
@@ -245,7 +258,7 @@ void CMPSTOList::recordSTOReceive(std::string address, const uint256 &txid, int
             // write updated record
             leveldb::Status status;
             if (pdb) {
-                status = pdb->Put(writeoptions, key, strValue);
+                status = WriteJournaled(nBlock, key, strValue);
                 PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
             }
         }
@@ -254,7 +267,7 @@ void CMPSTOList::recordSTOReceive(std::string address, const uint256 &txid, int
         const std::string value = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
         leveldb::Status status;
         if (pdb) {
-            status = pdb->Put(writeoptions, key, value);
+            status = WriteJournaled(nBlock, key, value);
             PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
         }
     }
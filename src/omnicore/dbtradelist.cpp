@@ -5,6 +5,7 @@
 #include <omnicore/sp.h>
 
 #include <amount.h>
+#include <crypto/common.h>
 #include <fs.h>
 #include <uint256.h>
 #include <util/strencodings.h>
@@ -15,6 +16,7 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -22,6 +24,7 @@
 #include <stddef.h>
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 #include <utility>
@@ -29,6 +32,35 @@
 
 using mastercore::isPropertyDivisible;
 
+namespace {
+//! Key prefix of the index of new trades by address: address, '\0', block and position
+const char DB_ADDRESS_INDEX = 'A';
+//! Key prefix of the index of matched trades by pair: property ids, block and txids
+const char DB_PAIR_INDEX = 'P';
+
+std::string EncodeBE32(uint32_t value)
+{
+    unsigned char buf[4];
+    WriteBE32(buf, value);
+    return std::string((const char*) buf, sizeof(buf));
+}
+
+std::string AddressIndexPrefix(const std::string& address)
+{
+    return std::string(1, DB_ADDRESS_INDEX) + address + std::string(1, '\0');
+}
+
+std::string PairIndexPrefix(uint32_t propertyIdSideA, uint32_t propertyIdSideB)
+{
+    return std::string(1, DB_PAIR_INDEX) + EncodeBE32(propertyIdSideA) + EncodeBE32(propertyIdSideB);
+}
+
+bool IsIndexKey(const leveldb::Slice& key)
+{
+    return key.size() > 0 && (key[0] == DB_ADDRESS_INDEX || key[0] == DB_PAIR_INDEX);
+}
+} // namespace
+
 CMPTradeList::CMPTradeList(const fs::path& path, bool fWipe)
 {
     leveldb::Status status = Open(path, fWipe);
@@ -45,7 +77,12 @@ void CMPTradeList::recordMatchedTrade(const uint256& txid1, const uint256& txid2
     if (!pdb) return;
     const std::string key = txid1.ToString() + "+" + txid2.ToString();
     const std::string value = strprintf("%s:%s:%u:%u:%lu:%lu:%d:%d", address1, address2, prop1, prop2, amount1, amount2, blockNum, fee);
-    leveldb::Status status = pdb->Put(writeoptions, key, value);
+    leveldb::Status status = WriteJournaled(blockNum, key, value);
+    if (status.ok()) {
+        const std::string indexKey = PairIndexPrefix(prop1, prop2) + EncodeBE32(blockNum)
+                + std::string((const char*) txid1.begin(), txid1.size()) + std::string((const char*) txid2.begin(), txid2.size());
+        status = WriteJournaled(blockNum, indexKey, key);
+    }
     ++nWritten;
     if (msc_debug_tradedb) PrintToLog("%s: %s\n", __func__, status.ToString());
 }
@@ -54,7 +91,11 @@ void CMPTradeList::recordNewTrade(const uint256& txid, const std::string& addres
 {
     if (!pdb) return;
     std::string strValue = strprintf("%s:%d:%d:%d:%d", address, propertyIdForSale, propertyIdDesired, blockNum, blockIndex);
-    leveldb::Status status = pdb->Put(writeoptions, txid.ToString(), strValue);
+    leveldb::Status status = WriteJournaled(blockNum, txid.ToString(), strValue);
+    if (status.ok()) {
+        const std::string indexKey = AddressIndexPrefix(address) + EncodeBE32(blockNum) + EncodeBE32(blockIndex);
+        status = WriteJournaled(blockNum, indexKey, strprintf("%s:%d:%d", txid.ToString(), propertyIdForSale, propertyIdDesired));
+    }
     ++nWritten;
     if (msc_debug_tradedb) PrintToLog("%s: %s\n", __func__, status.ToString());
 }
@@ -66,30 +107,22 @@ void CMPTradeList::recordNewTrade(const uint256& txid, const std::string& addres
  */
 int CMPTradeList::deleteAboveBlock(int blockNum)
 {
-    leveldb::Slice skey, svalue;
-    unsigned int count = 0;
-    std::vector<std::string> vstr;
-    int block = 0;
+    std::vector<std::string> vKeys;
+    leveldb::WriteBatch batch;
+    ReadJournal(blockNum, std::numeric_limits<int>::max(), vKeys, &batch);
+
     unsigned int n_found = 0;
-    leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-        ++count;
-        std::string strvalue = it->value().ToString();
-        boost::split(vstr, strvalue, boost::is_any_of(":"), boost::token_compress_on);
-        if (7 == vstr.size()) block = atoi(vstr[6]); // trade matches have 7 tokens, key is txid+txid, only care about block
-        if (5 == vstr.size()) block = atoi(vstr[3]); // trades have 5 tokens, key is txid, only care about block
-        if (block >= blockNum) {
-            ++n_found;
-            PrintToLog("%s() DELETING FROM TRADEDB: %s=%s\n", __func__, skey.ToString(), svalue.ToString());
-            pdb->Delete(writeoptions, skey);
-        }
+    for (const std::string& strKey : vKeys) {
+        batch.Delete(strKey);
+        if (IsIndexKey(strKey)) continue;
+        ++n_found;
+        PrintToLog("%s() DELETING FROM TRADEDB: %s\n", __func__, strKey);
     }
-    
-    delete it;
 
-    PrintToLog("%s(%d); tradedb n_found= %d\n", __func__, blockNum, n_found);
+    // remove all records at once, so the rollback is atomic
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+
+    PrintToLog("%s(%d); tradedb n_found= %d: %s\n", __func__, blockNum, n_found, status.ToString());
 
     return n_found;
 }
@@ -206,34 +239,23 @@ void CMPTradeList::getTradesForAddress(const std::string& address, std::vector<u
 {
     if (!pdb) return;
 
-    std::map<std::string, uint256> mapTrades;
+    // the index is ordered by block and position
+    const std::string prefix = AddressIndexPrefix(address);
     leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string strKey = it->key().ToString();
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
         std::string strValue = it->value().ToString();
         std::vector<std::string> vecValues;
-        if (strKey.size() != 64) continue; // only interested in trades
-        uint256 txid = uint256S(strKey);
-        size_t addressMatch = strValue.find(address);
-        if (addressMatch == std::string::npos) continue;
         boost::split(vecValues, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (vecValues.size() != 5) {
-            PrintToLog("TRADEDB error - unexpected number of tokens in value (%s)\n", strValue);
+        if (vecValues.size() != 3) {
+            PrintToLog("TRADEDB error - unexpected number of tokens in index value (%s)\n", strValue);
             continue;
         }
         uint32_t propertyIdForSale = boost::lexical_cast<uint32_t>(vecValues[1]);
         uint32_t propertyIdDesired = boost::lexical_cast<uint32_t>(vecValues[2]);
-        int64_t blockNum = boost::lexical_cast<uint32_t>(vecValues[3]);
-        int64_t txIndex = boost::lexical_cast<uint32_t>(vecValues[4]);
         if (propertyIdFilter != 0 && propertyIdFilter != propertyIdForSale && propertyIdFilter != propertyIdDesired) continue;
-        std::string sortKey = strprintf("%06d%010d", blockNum, txIndex);
-        mapTrades.insert(std::make_pair(sortKey, txid));
+        vecTransactions.push_back(uint256S(vecValues[0]));
     }
     delete it;
-
-    for (std::map<std::string, uint256>::iterator it = mapTrades.begin(); it != mapTrades.end(); it++) {
-        vecTransactions.push_back(it->second);
-    }
 }
 
 static bool CompareTradePair(const std::pair<int64_t, UniValue>& firstJSONObj, const std::pair<int64_t, UniValue>& secondJSONObj)
@@ -249,9 +271,32 @@ void CMPTradeList::getTradesForPair(uint32_t propertyIdSideA, uint32_t propertyI
     std::vector<std::pair<int64_t, UniValue> > vecResponse;
     bool propertyIdSideAIsDivisible = isPropertyDivisible(propertyIdSideA);
     bool propertyIdSideBIsDivisible = isPropertyDivisible(propertyIdSideB);
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string strKey = it->key().ToString();
-        std::string strValue = it->value().ToString();
+
+    // collect the most recent matches of both orientations of the pair from the index
+    std::vector<std::string> vecMatchKeys;
+    const uint64_t nMaxPerSide = std::max<uint64_t>(count, 1);
+    const std::string prefixes[] = {PairIndexPrefix(propertyIdSideA, propertyIdSideB), PairIndexPrefix(propertyIdSideB, propertyIdSideA)};
+    for (const std::string& prefix : prefixes) {
+        // index keys are shorter than the prefix followed by this
+        it->Seek(prefix + std::string(80, '\xff'));
+        if (it->Valid()) {
+            it->Prev();
+        } else {
+            it->SeekToLast();
+        }
+        for (uint64_t n = 0; n < nMaxPerSide && it->Valid() && it->key().starts_with(prefix); it->Prev(), ++n) {
+            vecMatchKeys.push_back(it->value().ToString());
+        }
+        if (propertyIdSideA == propertyIdSideB) break;
+    }
+
+    for (const std::string& strKey : vecMatchKeys) {
+        std::string strValue;
+        if (!pdb->Get(readoptions, strKey, &strValue).ok()) {
+            PrintToLog("TRADEDB error - indexed trade %s not found\n", strKey);
+            continue;
+        }
+        ++nRead;
         std::vector<std::string> vecKeys;
         std::vector<std::string> vecValues;
         uint256 sellerTxid, matchingTxid;
@@ -338,6 +383,7 @@ int CMPTradeList::getMPTradeCountTotal()
     int count = 0;
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        if (IsIndexKey(it->key()) || IsJournalKey(it->key())) continue;
         ++count;
     }
     delete it;
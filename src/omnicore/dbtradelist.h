@@ -15,6 +15,8 @@
 #include <vector>
 
 /** LevelDB based storage for the MetaDEx trade history. Trades are listed with key "txid1+txid2".
+ *
+ * New trades are additionally indexed by address, and matched trades by pair.
  */
 class CMPTradeList : public CDBBase
 {
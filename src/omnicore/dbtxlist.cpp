@@ -11,7 +11,10 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <clientversion.h>
 #include <fs.h>
+#include <serialize.h>
+#include <streams.h>
 #include <validation.h>
 #include <sync.h>
 #include <tinyformat.h>
@@ -22,14 +25,17 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <algorithm>
+#include <ios>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,6 +49,113 @@ using mastercore::GetBlockIndex;
 using mastercore::isNonMainNet;
 using mastercore::pDbTransaction;
 
+namespace {
+//! Leading byte of binary master records, which never starts a legacy "valid:block:type:value" text record
+const unsigned char TXLIST_RECORD_VERSION = 0x01;
+
+/** Stream to deserialize from a LevelDB slice in place, without copying it. */
+class SliceReader
+{
+private:
+    const char* pos;
+    const char* end;
+
+public:
+    explicit SliceReader(const leveldb::Slice& slice) : pos(slice.data()), end(slice.data() + slice.size()) {}
+
+    int GetType() const { return SER_DISK; }
+    int GetVersion() const { return CLIENT_VERSION; }
+
+    void read(char* dst, size_t nSize)
+    {
+        if (nSize > static_cast<size_t>(end - pos)) {
+            throw std::ios_base::failure("SliceReader::read(): end of data");
+        }
+        memcpy(dst, pos, nSize);
+        pos += nSize;
+    }
+
+    template <typename T>
+    SliceReader& operator>>(T& obj)
+    {
+        ::Unserialize(*this, obj);
+        return *this;
+    }
+};
+
+/** The master record of a transaction, or of a MetaDEx cancel ("txid-C"). */
+struct TxListRecord
+{
+    bool fValid;
+    uint32_t nBlock;
+    uint32_t nType;
+    //! Type specific: the amended amount, or the number of sub records
+    uint64_t nValue;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(fValid);
+        READWRITE(VARINT(nBlock));
+        READWRITE(VARINT(nType));
+        READWRITE(VARINT(nValue));
+    }
+};
+
+std::string EncodeRecord(bool fValid, int nBlock, unsigned int type, uint64_t nValue)
+{
+    const TxListRecord record{fValid, static_cast<uint32_t>(nBlock), type, nValue};
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << TXLIST_RECORD_VERSION << record;
+    return std::string(ssValue.begin(), ssValue.end());
+}
+
+/** Decodes a master record, stored in the binary format, or in the legacy text format. */
+bool DecodeRecord(const leveldb::Slice& value, TxListRecord& record)
+{
+    if (value.empty()) return false;
+
+    if (static_cast<unsigned char>(value[0]) == TXLIST_RECORD_VERSION) {
+        try {
+            SliceReader ssValue(value);
+            unsigned char version;
+            ssValue >> version >> record;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    // sub records and other entries have a different number of tokens
+    if (std::count(value.data(), value.data() + value.size(), ':') != 3) return false;
+
+    std::vector<std::string> vstr;
+    std::string strValue = value.ToString();
+    boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
+    if (4 != vstr.size()) return false;
+
+    try {
+        record.fValid = (atoi(vstr[0]) == 1);
+        record.nBlock = atoi(vstr[1]);
+        record.nType = atoi(vstr[2]);
+        record.nValue = boost::lexical_cast<uint64_t>(vstr[3]);
+    } catch (const boost::bad_lexical_cast&) {
+        return false;
+    }
+    return true;
+}
+
+/** Reads and decodes the master record stored under the given key. */
+bool ReadRecord(leveldb::DB* pdb, const leveldb::ReadOptions& readoptions, const std::string& key, TxListRecord& record)
+{
+    std::string strValue;
+    leveldb::Status status = pdb->Get(readoptions, key, &strValue);
+    return status.ok() && DecodeRecord(strValue, record);
+}
+} // anonymous namespace
+
 CMPTxList::CMPTxList(const fs::path& path, bool fWipe)
 {
     leveldb::Status status = Open(path, fWipe);
@@ -63,13 +176,13 @@ void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned
     if (exists(txid)) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
 
     const std::string key = txid.ToString();
-    const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, nValue);
+    const std::string value = EncodeRecord(fValid, nBlock, type, nValue);
     leveldb::Status status;
 
     PrintToLog("%s(%s, valid=%s, block= %d, type= %d, value= %lu)\n",
             __func__, txid.ToString(), fValid ? "YES" : "NO", nBlock, type, nValue);
 
-    status = pdb->Put(writeoptions, key, value);
+    status = WriteJournaled(nBlock, key, value);
     ++nWritten;
 }
 
@@ -84,34 +197,22 @@ void CMPTxList::recordPaymentTX(const uint256& txid, bool fValid, int nBlock, un
     uint64_t existingNumberOfPayments = 0;
 
     // Step 1 - Check TXList to see if this payment TXID exists
-    bool paymentEntryExists = exists(txid);
-
     // Step 2a - If doesn't exist leave number of payments & paymentNumber set to 1
     // Step 2b - If does exist add +1 to existing number of payments and set this paymentNumber as new numberOfPayments
-    if (paymentEntryExists) {
-        //retrieve old numberOfPayments
-        std::vector<std::string> vstr;
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-        if (status.ok()) {
-            // parse the string returned
-            boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-
-            // obtain the existing number of payments
-            if (4 <= vstr.size()) {
-                existingNumberOfPayments = atoi(vstr[3]);
-                paymentNumber = existingNumberOfPayments + 1;
-                numberOfPayments = existingNumberOfPayments + 1;
-            }
-        }
+    TxListRecord record;
+    if (ReadRecord(pdb, readoptions, txid.ToString(), record)) {
+        // obtain the existing number of payments
+        existingNumberOfPayments = record.nValue;
+        paymentNumber = existingNumberOfPayments + 1;
+        numberOfPayments = existingNumberOfPayments + 1;
     }
 
     // Step 3 - Create new/update master record for payment tx in TXList
     const std::string key = txid.ToString();
-    const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, numberOfPayments);
+    const std::string value = EncodeRecord(fValid, nBlock, type, numberOfPayments);
     leveldb::Status status;
     PrintToLog("DEXPAYDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of payments= %lu)\n", __func__, txid.ToString(), fValid ? "YES" : "NO", nBlock, type, numberOfPayments);
-    status = pdb->Put(writeoptions, key, value);
+    status = WriteJournaled(nBlock, key, value);
 
     // Step 4 - Write sub-record with payment details
     const std::string txidStr = txid.ToString();
@@ -119,7 +220,7 @@ void CMPTxList::recordPaymentTX(const uint256& txid, bool fValid, int nBlock, un
     const std::string subValue = strprintf("%d:%s:%s:%d:%lu", vout, buyer, seller, propertyId, nValue);
     leveldb::Status subStatus;
     PrintToLog("DEXPAYDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
-    subStatus = pdb->Put(writeoptions, subKey, subValue);
+    subStatus = WriteJournaled(nBlock, subKey, subValue);
 }
 
 void CMPTxList::recordMetaDExCancelTX(const uint256& txidMaster, const uint256& txidSub, bool fValid, int nBlock, unsigned int propertyId, uint64_t nValue)
@@ -135,32 +236,26 @@ void CMPTxList::recordMetaDExCancelTX(const uint256& txidMaster, const uint256&
     // Step 1 - Check TXList to see if this cancel TXID exists
     // Step 2a - If doesn't exist leave number of affected txs & ref set to 1
     // Step 2b - If does exist add +1 to existing ref and set this ref as new number of affected
-    std::vector<std::string> vstr;
-    std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, txidMasterStr, &strValue);
-    if (status.ok()) {
-        // parse the string returned
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-
+    TxListRecord record;
+    if (ReadRecord(pdb, readoptions, txidMasterStr, record)) {
         // obtain the existing affected tx count
-        if (4 <= vstr.size()) {
-            existingAffectedTXCount = atoi(vstr[3]);
-            refNumber = existingAffectedTXCount + 1;
-        }
+        existingAffectedTXCount = record.nValue;
+        refNumber = existingAffectedTXCount + 1;
     }
 
     // Step 3 - Create new/update master record for cancel tx in TXList
     const std::string key = txidMasterStr;
-    const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, refNumber);
+    const std::string value = EncodeRecord(fValid, nBlock, type, refNumber);
+    leveldb::Status status;
     PrintToLog("METADEXCANCELDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of affected transactions= %d)\n", __func__, txidMaster.ToString(), fValid ? "YES" : "NO", nBlock, type, refNumber);
-    status = pdb->Put(writeoptions, key, value);
+    status = WriteJournaled(nBlock, key, value);
 
     // Step 4 - Write sub-record with cancel details
     const std::string txidStr = txidMaster.ToString() + "-C";
     const std::string subKey = STR_REF_SUBKEY_TXID_REF_COMBO(txidStr, refNumber);
     const std::string subValue = strprintf("%s:%d:%lu", txidSub.ToString(), propertyId, nValue);
     PrintToLog("METADEXCANCELDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
-    status = pdb->Put(writeoptions, subKey, subValue);
+    status = WriteJournaled(nBlock, subKey, subValue);
     if (msc_debug_txdb) PrintToLog("%s(): store: %s=%s, status: %s\n", __func__, subKey, subValue, status.ToString());
 }
 
@@ -168,12 +263,12 @@ void CMPTxList::recordMetaDExCancelTX(const uint256& txidMaster, const uint256&
 /**
  * Records a "send all" sub record.
  */
-void CMPTxList::recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nValue)
+void CMPTxList::recordSendAllSubRecord(const uint256& txid, int nBlock, int subRecordNumber, uint32_t propertyId, int64_t nValue)
 {
     std::string strKey = strprintf("%s-%d", txid.ToString(), subRecordNumber);
     std::string strValue = strprintf("%d:%d", propertyId, nValue);
 
-    leveldb::Status status = pdb->Put(writeoptions, strKey, strValue);
+    leveldb::Status status = WriteJournaled(nBlock, strKey, strValue);
     ++nWritten;
     if (msc_debug_txdb) PrintToLog("%s(): store: %s=%s, status: %s\n", __func__, strKey, strValue, status.ToString());
 }
@@ -193,23 +288,15 @@ std::string CMPTxList::getKeyValue(std::string key)
 
 uint256 CMPTxList::findMetaDExCancel(const uint256 txid)
 {
-    std::vector<std::string> vstr;
-    std::string txidStr = txid.ToString();
-    leveldb::Slice skey, svalue;
+    // cancel sub records have the value "txid:propertyid:amount"
+    const std::string txidPrefix = txid.ToString() + ":";
     uint256 cancelTxid;
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-        std::string svalueStr = svalue.ToString();
-        boost::split(vstr, svalueStr, boost::is_any_of(":"), boost::token_compress_on);
-        // obtain the existing affected tx count
-        if (3 <= vstr.size()) {
-            if (vstr[0] == txidStr) {
-                delete it;
-                cancelTxid.SetHex(skey.ToString());
-                return cancelTxid;
-            }
+        if (it->value().starts_with(txidPrefix)) {
+            cancelTxid.SetHex(it->key().ToString());
+            delete it;
+            return cancelTxid;
         }
     }
 
@@ -224,14 +311,9 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 {
     int numberOfSubRecords = 0;
 
-    std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 <= vstr.size()) {
-            numberOfSubRecords = boost::lexical_cast<int>(vstr[3]);
-        }
+    TxListRecord record;
+    if (ReadRecord(pdb, readoptions, txid.ToString(), record)) {
+        numberOfSubRecords = record.nValue;
     }
 
     return numberOfSubRecords;
@@ -241,16 +323,10 @@ int CMPTxList::getNumberOfMetaDExCancels(const uint256 txid)
 {
     if (!pdb) return 0;
     int numberOfCancels = 0;
-    std::vector<std::string> vstr;
-    std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, txid.ToString() + "-C", &strValue);
-    if (status.ok()) {
-        // parse the string returned
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
+    TxListRecord record;
+    if (ReadRecord(pdb, readoptions, txid.ToString() + "-C", record)) {
         // obtain the number of cancels
-        if (4 <= vstr.size()) {
-            numberOfCancels = atoi(vstr[3]);
-        }
+        numberOfCancels = record.nValue;
     }
     return numberOfCancels;
 }
@@ -315,19 +391,12 @@ int CMPTxList::getMPTransactionCountTotal()
 int CMPTxList::getMPTransactionCountBlock(int block)
 {
     int count = 0;
-    leveldb::Slice skey, svalue;
     leveldb::Iterator* it = NewIterator();
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-        if (skey.ToString().length() == 64) {
-            std::string strValue = svalue.ToString();
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == vstr.size()) {
-                if (atoi(vstr[1]) == block) {
-                    ++count;
-                }
+        TxListRecord record;
+        if (it->key().size() == 64 && DecodeRecord(it->value(), record)) {
+            if (static_cast<int>(record.nBlock) == block) {
+                ++count;
             }
         }
     }
@@ -339,27 +408,17 @@ int CMPTxList::getMPTransactionCountBlock(int block)
 int CMPTxList::GetOmniTxsInBlockRange(int blockFirst, int blockLast, std::set<uint256>& retTxs)
 {
     int count = 0;
-    leveldb::Iterator* it = NewIterator();
-    
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        const leveldb::Slice& sKey = it->key();
-        const leveldb::Slice& sValue = it->value();
-
-        if (sKey.ToString().length() == 64) {
-            const std::string& strValue = sValue.ToString();
-            std::vector<std::string> vStr;
-            boost::split(vStr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == vStr.size()) {
-                int blockCurrent = atoi(vStr[1]);
-                if (blockCurrent >= blockFirst && blockCurrent <= blockLast) {
-                    retTxs.insert(uint256S(sKey.ToString()));                    
-                    ++count;
-                }
-            }
+    std::vector<std::string> vKeys;
+    ReadJournal(blockFirst, blockLast, vKeys);
+
+    for (const std::string& strKey : vKeys) {
+        // extra entries for cancels, purchases and sub records are more than 64 chars long
+        if (strKey.length() == 64) {
+            retTxs.insert(uint256S(strKey));
+            ++count;
         }
     }
 
-    delete it;
     return count;
 }
 
@@ -398,6 +457,56 @@ int CMPTxList::setDBVersion()
     return getDBVersion();
 }
 
+/*
+ * Converts the master records of the previous DB version into the binary format
+ *
+ * Returns true, if the database is at the current version afterwards
+ */
+bool CMPTxList::upgradeDBVersion(int fromVersion)
+{
+    if (!pdb || fromVersion != DB_VERSION - 1) return false;
+
+    PrintToConsole("Upgrading tx meta-info database from version %d to %d\n", fromVersion, DB_VERSION);
+
+    unsigned int nConverted = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = NewIterator();
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const leveldb::Slice value = it->value();
+        if (IsJournalKey(it->key()) || value.empty() || static_cast<unsigned char>(value[0]) == TXLIST_RECORD_VERSION) continue;
+
+        TxListRecord record;
+        if (!DecodeRecord(value, record)) continue; // not a master record
+
+        batch.Put(it->key(), EncodeRecord(record.fValid, record.nBlock, record.nType, record.nValue));
+        ++nConverted;
+
+        // keep the memory footprint of the batch bounded
+        if (nConverted % 10000 == 0) {
+            leveldb::Status status = pdb->Write(syncoptions, &batch);
+            if (!status.ok()) {
+                PrintToLog("%s(): failed to convert records: %s\n", __func__, status.ToString());
+                delete it;
+                return false;
+            }
+            batch.Clear();
+        }
+    }
+
+    delete it;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): failed to convert records: %s\n", __func__, status.ToString());
+        return false;
+    }
+
+    PrintToLog("%s(): converted %d records\n", __func__, nConverted);
+
+    return setDBVersion() == DB_VERSION;
+}
+
 bool CMPTxList::exists(const uint256 &txid)
 {
     if (!pdb) return false;
@@ -434,7 +543,6 @@ bool CMPTxList::getTX(const uint256 &txid, std::string& value)
 bool CMPTxList::getValidMPTX(const uint256& txid, int* block, unsigned int* type, uint64_t* nAmended)
 {
     std::string result;
-    int validity = 0;
 
     if (msc_debug_txdb) PrintToLog("%s()\n", __func__);
 
@@ -442,34 +550,21 @@ bool CMPTxList::getValidMPTX(const uint256& txid, int* block, unsigned int* type
 
     if (!getTX(txid, result)) return false;
 
-    // parse the string returned, find the validity flag/bit & other parameters
-    std::vector<std::string> vstr;
-    boost::split(vstr, result, boost::is_any_of(":"), boost::token_compress_on);
-
-    if (msc_debug_txdb) PrintToLog("%s() size=%lu : %s\n", __func__, vstr.size(), result);
-
-    if (1 <= vstr.size()) validity = atoi(vstr[0]);
-
-    if (block) {
-        if (2 <= vstr.size()) *block = atoi(vstr[1]);
-        else *block = 0;
+    // find the validity flag/bit & other parameters
+    TxListRecord record;
+    if (!DecodeRecord(result, record)) {
+        record = TxListRecord{false, 0, 0, 0};
     }
 
-    if (type) {
-        if (3 <= vstr.size()) *type = atoi(vstr[2]);
-        else *type = 0;
-    }
+    if (msc_debug_txdb) PrintToLog("%s() : valid=%d, block=%d, type=%d, value=%d\n", __func__, record.fValid, record.nBlock, record.nType, record.nValue);
 
-    if (nAmended) {
-        if (4 <= vstr.size()) *nAmended = boost::lexical_cast<boost::uint64_t>(vstr[3]);
-        else nAmended = 0;
-    }
+    if (block) *block = record.nBlock;
+    if (type) *type = record.nType;
+    if (nAmended) *nAmended = record.nValue;
 
     if (msc_debug_txdb) printStats();
 
-    if ((int) 0 == validity) return false;
-
-    return true;
+    return record.fValid;
 }
 
 std::set<int> CMPTxList::GetSeedBlocks(int startHeight, int endHeight)
@@ -481,11 +576,9 @@ std::set<int> CMPTxList::GetSeedBlocks(int startHeight, int endHeight)
     leveldb::Iterator* it = NewIterator();
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        int block = atoi(vstr[1]);
+        TxListRecord record;
+        if (!DecodeRecord(it->value(), record)) continue; // not a master record
+        int block = record.nBlock;
         if (block >= startHeight && block <= endHeight) {
             setSeedBlocks.insert(block);
         }
@@ -505,13 +598,11 @@ void CMPTxList::LoadAlerts(int blockHeight)
     std::vector<std::pair<int64_t, uint256> > loadOrder;
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ALERT || atoi(vstr[0]) != 1) continue; // not a valid alert
+        TxListRecord record;
+        if (!DecodeRecord(it->value(), record)) continue; // not a master record
+        if (record.nType != OMNICORE_MESSAGE_TYPE_ALERT || !record.fValid) continue; // not a valid alert
         uint256 txid = uint256S(it->key().ToString());
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
+        loadOrder.push_back(std::make_pair(record.nBlock, txid));
     }
 
     std::sort(loadOrder.begin(), loadOrder.end());
@@ -580,13 +671,11 @@ void CMPTxList::LoadActivations(int blockHeight)
     std::vector<std::pair<int64_t, uint256> > loadOrder;
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ACTIVATION || atoi(vstr[0]) != 1) continue; // we only care about valid activations
+        TxListRecord record;
+        if (!DecodeRecord(it->value(), record)) continue; // not a master record
+        if (record.nType != OMNICORE_MESSAGE_TYPE_ACTIVATION || !record.fValid) continue; // we only care about valid activations
         uint256 txid = uint256S(it->key().ToString());
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
+        loadOrder.push_back(std::make_pair(record.nBlock, txid));
     }
 
     std::sort(loadOrder.begin(), loadOrder.end());
@@ -653,17 +742,15 @@ bool CMPTxList::LoadFreezeState(int blockHeight)
     PrintToLog("Loading freeze state from levelDB\n");
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue;
-        uint16_t txtype = atoi(vstr[2]);
+        TxListRecord record;
+        if (!DecodeRecord(it->value(), record)) continue;
+        uint16_t txtype = record.nType;
         if (txtype != MSC_TYPE_FREEZE_PROPERTY_TOKENS && txtype != MSC_TYPE_UNFREEZE_PROPERTY_TOKENS &&
                 txtype != MSC_TYPE_ENABLE_FREEZING && txtype != MSC_TYPE_DISABLE_FREEZING) continue;
-        if (atoi(vstr[0]) != 1) continue; // invalid, ignore
+        if (!record.fValid) continue; // invalid, ignore
         uint256 txid = uint256S(it->key().ToString());
         int txPosition = pDbTransaction->FetchTransactionPosition(txid);
-        std::string sortKey = strprintf("%06d%010d", atoi(vstr[1]), txPosition);
+        std::string sortKey = strprintf("%06d%010d", record.nBlock, txPosition);
         loadOrder.push_back(std::make_pair(sortKey, txid));
     }
 
@@ -725,13 +812,11 @@ bool CMPTxList::CheckForFreezeTxs(int blockHeight)
     leveldb::Iterator* it = NewIterator();
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue;
-        int block = atoi(vstr[1]);
+        TxListRecord record;
+        if (!DecodeRecord(it->value(), record)) continue;
+        int block = record.nBlock;
         if (block < blockHeight) continue;
-        uint16_t txtype = atoi(vstr[2]);
+        uint16_t txtype = record.nType;
         if (txtype == MSC_TYPE_FREEZE_PROPERTY_TOKENS || txtype == MSC_TYPE_UNFREEZE_PROPERTY_TOKENS ||
                 txtype == MSC_TYPE_ENABLE_FREEZING || txtype == MSC_TYPE_DISABLE_FREEZING) {
             delete it;
@@ -769,40 +854,21 @@ void CMPTxList::printAll()
 // pass in bDeleteFound = true to erase each entry found within the block range
 bool CMPTxList::isMPinBlockRange(int starting_block, int ending_block, bool bDeleteFound)
 {
-    leveldb::Slice skey, svalue;
-    unsigned int count = 0;
-    std::vector<std::string> vstr;
-    int block;
-    unsigned int n_found = 0;
-
-    leveldb::Iterator* it = NewIterator();
-
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-
-        ++count;
-
-        std::string strvalue = it->value().ToString();
-
-        // parse the string returned, find the validity flag/bit & other parameters
-        boost::split(vstr, strvalue, boost::is_any_of(":"), boost::token_compress_on);
-
-        // only care about the block number/height here
-        if (2 <= vstr.size()) {
-            block = atoi(vstr[1]);
-
-            if ((starting_block <= block) && (block <= ending_block)) {
-                ++n_found;
-                PrintToLog("%s() DELETING: %s=%s\n", __func__, skey.ToString(), svalue.ToString());
-                if (bDeleteFound) pdb->Delete(writeoptions, skey);
-            }
-        }
+    std::vector<std::string> vKeys;
+    leveldb::WriteBatch batch;
+    ReadJournal(starting_block, ending_block, vKeys, bDeleteFound ? &batch : nullptr);
+
+    unsigned int n_found = vKeys.size();
+    if (bDeleteFound) {
+        for (const std::string& strKey : vKeys) {
+            PrintToLog("%s() DELETING: %s\n", __func__, strKey);
+            batch.Delete(strKey);
+        }
+        leveldb::Status status = pdb->Write(writeoptions, &batch);
+        if (!status.ok()) PrintToLog("%s(): failed to delete records: %s\n", __func__, status.ToString());
     }
 
     PrintToLog("%s(%d, %d); n_found= %d\n", __func__, starting_block, ending_block, n_found);
 
-    delete it;
-
     return (n_found);
 }
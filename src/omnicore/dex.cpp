@@ -24,6 +24,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <fstream>
 #include <map>
 #include <set>
@@ -33,6 +34,50 @@
 
 namespace mastercore
 {
+namespace {
+/** Seller, property and buyer of an accept order. */
+struct DExAcceptKey
+{
+    std::string addressSeller;
+    uint32_t propertyId;
+    std::string addressBuyer;
+
+    bool operator==(const DExAcceptKey& other) const
+    {
+        return propertyId == other.propertyId && addressSeller == other.addressSeller && addressBuyer == other.addressBuyer;
+    }
+
+    /** The key of the accept order in my_accepts. */
+    std::string ToString() const
+    {
+        return STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId);
+    }
+};
+
+typedef std::multimap<int, DExAcceptKey> AcceptExpiryIndex;
+
+//! Accept orders by the block, in which the payment window ends
+AcceptExpiryIndex accept_expiries GUARDED_BY(cs_tally);
+
+/** Returns the first block, in which the accept order is expired. */
+int getAcceptExpiryBlock(const CMPAccept& accept)
+{
+    return accept.getAcceptBlock() + static_cast<int>(accept.getBlockTimeLimit());
+}
+
+/** Removes an accept order from the expiry index. */
+void unindexAccept(const DExAcceptKey& key, const CMPAccept& accept) EXCLUSIVE_LOCKS_REQUIRED(cs_tally)
+{
+    std::pair<AcceptExpiryIndex::iterator, AcceptExpiryIndex::iterator> range = accept_expiries.equal_range(getAcceptExpiryBlock(accept));
+    for (AcceptExpiryIndex::iterator it = range.first; it != range.second; ++it) {
+        if (it->second == key) {
+            accept_expiries.erase(it);
+            return;
+        }
+    }
+}
+} // anonymous namespace
+
 /**
  * Checks, if such a sell offer exists.
  */
@@ -48,13 +93,10 @@ bool DEx_offerExists(const std::string& addressSeller, uint32_t propertyId)
  */
 bool DEx_hasOffer(const std::string& addressSeller)
 {
-    for (auto const& offer : my_offers) {
-        if (offer.first.find(addressSeller) == 0) {
-            return true;
-        }
-    }
+    // offers with keys starting with the address are adjacent in the map
+    OfferMap::const_iterator it = my_offers.lower_bound(addressSeller);
 
-    return false;
+    return it != my_offers.end() && it->first.compare(0, addressSeller.size(), addressSeller) == 0;
 }
 
 /**
@@ -69,25 +111,25 @@ bool DEx_hasOffer(const std::string& addressSeller)
  */
 bool DEx_getTokenForSale(const std::string& addressSeller, uint32_t& retTokenId)
 {
-    for (auto const& offer : my_offers) {
-        if (offer.first.find(addressSeller) == 0) {
-
-            // Format is: "address-tokenid"
-            std::vector<std::string> vstr;
-            boost::split(vstr, offer.first, boost::is_any_of("-"), boost::token_compress_on);
-
-            if (vstr.size() != 2) {
-                PrintToLog("ERROR: failed to parse token for sale: %s\n", offer.first);
-                return false;
-            }
-
-            try {
-                retTokenId = boost::lexical_cast<uint32_t>(vstr[1]);
-                return true;
-            }
-            catch (boost::bad_lexical_cast const& e) {
-                PrintToLog("ERROR: failed to parse token for sale: %s (%s)\n", offer.first, e.what());
-            }
+    // offers with keys starting with the address are adjacent in the map
+    for (OfferMap::const_iterator it = my_offers.lower_bound(addressSeller); it != my_offers.end(); ++it) {
+        if (it->first.compare(0, addressSeller.size(), addressSeller) != 0) break;
+
+        // Format is: "address-tokenid"
+        std::vector<std::string> vstr;
+        boost::split(vstr, it->first, boost::is_any_of("-"), boost::token_compress_on);
+
+        if (vstr.size() != 2) {
+            PrintToLog("ERROR: failed to parse token for sale: %s\n", it->first);
+            return false;
+        }
+
+        try {
+            retTokenId = boost::lexical_cast<uint32_t>(vstr[1]);
+            return true;
+        }
+        catch (boost::bad_lexical_cast const& e) {
+            PrintToLog("ERROR: failed to parse token for sale: %s (%s)\n", it->first, e.what());
         }
     }
 
@@ -369,7 +411,7 @@ int DEx_acceptCreate(const std::string& addressBuyer, const std::string& address
         assert(update_tally_map(addressSeller, propertyId, amountReserved, ACCEPT_RESERVE));
 
         CMPAccept acceptOffer(amountReserved, block, offer.getBlockTimeLimit(), offer.getProperty(), offer.getOfferAmountOriginal(), offer.getBTCDesiredOriginal(), offer.getHash());
-        my_accepts.insert(std::make_pair(keyAcceptOrder, acceptOffer));
+        DEx_acceptInsert(addressSeller, propertyId, addressBuyer, acceptOffer);
 
         rc = 0;
     }
@@ -429,10 +471,11 @@ int DEx_acceptDestroy(const std::string& addressBuyer, const std::string& addres
 
     // can only erase when is NOT called from an iterator loop
     if (fForceErase) {
-        std::string key = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyid);
-        AcceptMap::iterator it = my_accepts.find(key);
+        const DExAcceptKey key{addressSeller, propertyid, addressBuyer};
+        AcceptMap::iterator it = my_accepts.find(key.ToString());
 
         if (my_accepts.end() != it) {
+            unindexAccept(key, it->second);
             my_accepts.erase(it);
         }
     }
@@ -612,35 +655,68 @@ int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addre
     return rc;
 }
 
+/**
+ * Inserts an accept order and indexes it by the end of its payment window.
+ *
+ * @return True, if there was no such accept order before
+ */
+bool DEx_acceptInsert(const std::string& addressSeller, uint32_t propertyId, const std::string& addressBuyer, const CMPAccept& accept)
+{
+    const DExAcceptKey key{addressSeller, propertyId, addressBuyer};
+
+    if (!my_accepts.insert(std::make_pair(key.ToString(), accept)).second) {
+        return false;
+    }
+    accept_expiries.insert(std::make_pair(getAcceptExpiryBlock(accept), key));
+
+    return true;
+}
+
+/**
+ * Removes all accept orders.
+ */
+void DEx_acceptsClear()
+{
+    my_accepts.clear();
+    accept_expiries.clear();
+}
+
+/**
+ * Erases the accept orders, whose payment window ended.
+ *
+ * Only the expired orders are visited, but they are processed in the order of the
+ * accept map, as before the expiry index was introduced.
+ */
 unsigned int eraseExpiredAccepts(int blockNow)
 {
     unsigned int how_many_erased = 0;
-    AcceptMap::iterator it = my_accepts.begin();
 
-    while (my_accepts.end() != it) {
-        const CMPAccept& acceptOrder = it->second;
+    std::vector<std::pair<std::string, DExAcceptKey> > vExpired;
+    AcceptExpiryIndex::iterator itEnd = accept_expiries.upper_bound(blockNow);
+    for (AcceptExpiryIndex::iterator it = accept_expiries.begin(); it != itEnd; ++it) {
+        vExpired.push_back(std::make_pair(it->second.ToString(), it->second));
+    }
+    accept_expiries.erase(accept_expiries.begin(), itEnd);
 
-        int blocksSinceAccept = blockNow - acceptOrder.getAcceptBlock();
-        int blocksPaymentWindow = static_cast<int>(acceptOrder.getBlockTimeLimit());
+    std::sort(vExpired.begin(), vExpired.end(),
+            [](const std::pair<std::string, DExAcceptKey>& a, const std::pair<std::string, DExAcceptKey>& b) { return a.first < b.first; });
 
-        if (blocksSinceAccept >= blocksPaymentWindow) {
-            PrintToLog("%s: sell offer: %s\n", __func__, acceptOrder.getHash().GetHex());
-            PrintToLog("%s: erasing at block: %d, order confirmed at block: %d, payment window: %d\n",
-                    __func__, blockNow, acceptOrder.getAcceptBlock(), acceptOrder.getBlockTimeLimit());
+    for (const std::pair<std::string, DExAcceptKey>& expired : vExpired) {
+        AcceptMap::iterator it = my_accepts.find(expired.first);
+        if (it == my_accepts.end()) continue;
+
+        const CMPAccept& acceptOrder = it->second;
+        const DExAcceptKey& key = expired.second;
 
-            // extract the seller, buyer and property from the key
-            std::vector<std::string> vstr;
-            boost::split(vstr, it->first, boost::is_any_of("-+"), boost::token_compress_on);
-            std::string addressSeller = vstr[0];
-            uint32_t propertyId = atoi(vstr[1]);
-            std::string addressBuyer = vstr[2];
+        PrintToLog("%s: sell offer: %s\n", __func__, acceptOrder.getHash().GetHex());
+        PrintToLog("%s: erasing at block: %d, order confirmed at block: %d, payment window: %d\n",
+                __func__, blockNow, acceptOrder.getAcceptBlock(), acceptOrder.getBlockTimeLimit());
 
-            DEx_acceptDestroy(addressBuyer, addressSeller, propertyId);
+        DEx_acceptDestroy(key.addressBuyer, key.addressSeller, key.propertyId);
 
-            my_accepts.erase(it++);
+        my_accepts.erase(it);
 
-            ++how_many_erased;
-        } else it++;
+        ++how_many_erased;
     }
 
     return how_many_erased;
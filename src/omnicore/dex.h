@@ -240,11 +240,16 @@ CMPAccept* DEx_getAccept(const std::string& addressSeller, uint32_t propertyId,
 int DEx_offerCreate(const std::string& addressSeller, uint32_t propertyId, int64_t amountOffered, int block, int64_t amountDesired, int64_t minAcceptFee, uint8_t paymentWindow, const uint256& txid, uint64_t* nAmended = nullptr);
 int DEx_offerDestroy(const std::string& addressSeller, uint32_t propertyId);
 int DEx_offerUpdate(const std::string& addressSeller, uint32_t propertyId, int64_t amountOffered, int block, int64_t amountDesired, int64_t minAcceptFee, uint8_t paymentWindow, const uint256& txid, uint64_t* nAmended = nullptr);
+/** Inserts an accept order and indexes it by the end of its payment window. */
+bool DEx_acceptInsert(const std::string& addressSeller, uint32_t propertyId, const std::string& addressBuyer, const CMPAccept& accept);
+/** Removes all accept orders. */
+void DEx_acceptsClear();
 int DEx_acceptCreate(const std::string& addressBuyer, const std::string& addressSeller, uint32_t propertyId, int64_t amountAccepted, int block, int64_t feePaid, uint64_t* nAmended = nullptr);
 int DEx_acceptDestroy(const std::string& addressBuyer, const std::string& addressSeller, uint32_t propertyid, bool fForceErase = false);
 int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addressSeller, const std::string& addressBuyer, int64_t amountPaid, int block, uint64_t* nAmended = nullptr);
 int64_t calculateDExPurchase(const int64_t amountOffered, const int64_t amountDesired, const int64_t amountPaid);
 
+/** Erases the accept orders, whose payment window ended, visiting only those. */
 unsigned int eraseExpiredAccepts(int block);
 }
 
@@ -126,6 +126,40 @@ static void DebugLogInit()
     mutexDebugLog = new std::mutex();
 }
 
+/**
+ * Writes to the debug log file, reopening it if requested. Requires mutexDebugLog.
+ */
+static void WriteDebugLog(const std::string& str)
+{
+    // Reopen the log file, if requested
+    if (fReopenDebugLog) {
+        fReopenDebugLog = false;
+        fs::path pathDebug = GetLogPath();
+        if (freopen(pathDebug.string().c_str(), "a", fileout) != nullptr) {
+            setbuf(fileout, nullptr); // Unbuffered
+        }
+    }
+    fwrite(str.data(), 1, str.size(), fileout);
+}
+
+/**
+ * Writes to the debug log file on the log writer thread.
+ */
+static void WriteDebugLogLocked(const std::string& str)
+{
+    std::lock_guard<std::mutex> lock(*mutexDebugLog);
+    WriteDebugLog(str);
+}
+
+/**
+ * Writes to the standard output.
+ */
+static void WriteConsole(const std::string& str)
+{
+    fwrite(str.data(), 1, str.size(), stdout);
+    fflush(stdout);
+}
+
 /**
  * @return The current timestamp in the format: 2009-01-03 18:15:05
  */
@@ -162,25 +196,23 @@ int LogFilePrint(const std::string& str)
         }
         std::lock_guard<std::mutex> lock(*mutexDebugLog);
 
-        // Reopen the log file, if requested
-        if (fReopenDebugLog) {
-            fReopenDebugLog = false;
-            fs::path pathDebug = GetLogPath();
-            if (freopen(pathDebug.string().c_str(), "a", fileout) != nullptr) {
-                setbuf(fileout, nullptr); // Unbuffered
-            }
-        }
-
         // Printing log timestamps can be useful for profiling
+        std::string strTimestamped;
         if (LogInstance().m_log_timestamps && fStartedNewLine) {
-            ret += fprintf(fileout, "%s ", GetTimestamp().c_str());
+            strTimestamped = GetTimestamp() + " ";
         }
+        strTimestamped += str;
         if (!str.empty() && str[str.size()-1] == '\n') {
             fStartedNewLine = true;
         } else {
             fStartedNewLine = false;
         }
-        ret += fwrite(str.data(), 1, str.size(), fileout);
+        ret = strTimestamped.size();
+
+        // Queued under the lock, so that messages keep their order
+        if (!LogWriter().Write(&WriteDebugLogLocked, std::move(strTimestamped))) {
+            WriteDebugLog(strTimestamped);
+        }
     }
 
     return ret;
@@ -197,20 +229,23 @@ int LogFilePrint(const std::string& str)
  */
 int ConsolePrint(const std::string& str)
 {
-    int ret = 0; // Number of characters written
     static bool fStartedNewLine = true;
 
+    std::string strTimestamped;
     if (LogInstance().m_log_timestamps && fStartedNewLine) {
-        ret = fprintf(stdout, "%s %s", GetTimestamp().c_str(), str.c_str());
-    } else {
-        ret = fwrite(str.data(), 1, str.size(), stdout);
+        strTimestamped = GetTimestamp() + " ";
     }
+    strTimestamped += str;
     if (!str.empty() && str[str.size()-1] == '\n') {
         fStartedNewLine = true;
     } else {
         fStartedNewLine = false;
     }
-    fflush(stdout);
+    int ret = strTimestamped.size(); // Number of characters written
+
+    if (!LogWriter().Write(&WriteConsole, std::move(strTimestamped))) {
+        WriteConsole(strTimestamped);
+    }
 
     return ret;
 }
@@ -0,0 +1,80 @@
+#include <omnicore/markerindex.h>
+
+#include <omnicore/omnicore.h>
+#include <omnicore/parsing.h>
+
+#include <dbwrapper.h>
+#include <primitives/block.h>
+#include <util/system.h>
+
+/* The index database stores the hash of the block and the number of Omni
+ * candidate transactions for each block of the active chain, indexed by
+ * height. Entries of blocks, which were reorganized out of the active chain,
+ * are overwritten once the new blocks are connected, thus lookups verify the
+ * block hash.
+ *
+ * Keys have the type [DB_BLOCK_HEIGHT, uint32 (BE)], so that sequential reads
+ * of entries by height are fast.
+ */
+constexpr char DB_BLOCK_HEIGHT = 't';
+
+std::unique_ptr<OmniMarkerIndex> g_omni_marker_index;
+
+namespace {
+
+struct DBHeightKey {
+    int height;
+
+    DBHeightKey() : height(0) {}
+    explicit DBHeightKey(int height_in) : height(height_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_BLOCK_HEIGHT);
+        ser_writedata32be(s, height);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_BLOCK_HEIGHT) {
+            throw std::ios_base::failure("Invalid format for Omni marker index DB height key");
+        }
+        height = ser_readdata32be(s);
+    }
+};
+
+} // namespace
+
+OmniMarkerIndex::OmniMarkerIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "omnimarker", n_cache_size, f_memory, f_wipe))
+{
+}
+
+bool OmniMarkerIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Block height 0 skips checks depending on the height and feature activations
+    uint32_t count = 0;
+    for (const auto& tx : block.vtx) {
+        if (mastercore::GetEncodingClass(*tx, 0) != NO_MARKER) ++count;
+    }
+
+    std::pair<uint256, uint32_t> value(pindex->GetBlockHash(), count);
+    return m_db->Write(DBHeightKey(pindex->nHeight), value);
+}
+
+bool OmniMarkerIndex::LookupCandidates(const CBlockIndex* pindex, unsigned int& count) const
+{
+    std::pair<uint256, uint32_t> value;
+    if (!m_db->Read(DBHeightKey(pindex->nHeight), value)) {
+        return false;
+    }
+    if (value.first != pindex->GetBlockHash()) {
+        return false;
+    }
+
+    count = value.second;
+    return true;
+}
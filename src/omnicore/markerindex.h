@@ -0,0 +1,49 @@
+#ifndef BITCOIN_OMNICORE_MARKERINDEX_H
+#define BITCOIN_OMNICORE_MARKERINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+
+#include <memory>
+
+/** The database cache size of the marker index. */
+static const size_t OMNI_MARKER_INDEX_CACHE = 8 << 20;
+
+/**
+ * OmniMarkerIndex records, per block of the active chain, the number of
+ * transactions carrying the Omni marker.
+ *
+ * The marker is checked independent of feature activations, so every
+ * transaction, which may be parsed as Omni transaction, is counted. Blocks
+ * without any candidate can be skipped by scans, without reading them.
+ */
+class OmniMarkerIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "omnimarkerindex"; }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    explicit OmniMarkerIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /**
+     * Looks up the number of Omni candidate transactions of a block.
+     *
+     * @param[in]   pindex  The block, which must be part of the active chain
+     * @param[out]  count   The number of transactions with Omni marker
+     * @return True, if the block was indexed
+     */
+    bool LookupCandidates(const CBlockIndex* pindex, unsigned int& count) const;
+};
+
+/** The global Omni marker index, used by the scans of Omni Core. May be null. */
+extern std::unique_ptr<OmniMarkerIndex> g_omni_marker_index;
+
+#endif // BITCOIN_OMNICORE_MARKERINDEX_H
@@ -5,6 +5,7 @@
 #include <omnicore/dbtxlist.h>
 #include <omnicore/log.h>
 #include <omnicore/rules.h>
+#include <omnicore/snapshot.h>
 #include <omnicore/sp.h>
 #include <omnicore/uint256_extensions.h>
 
@@ -24,11 +25,14 @@
 #include <assert.h>
 #include <stdint.h>
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 typedef boost::multiprecision::cpp_dec_float_100 dec_float;
 typedef boost::multiprecision::checked_int128_t int128_t;
@@ -41,6 +45,84 @@ using namespace mastercore;
 //! Global map for price and order data
 md_PropertiesMap mastercore::metadex;
 
+namespace {
+//! Location of an open order in the MetaDEx maps
+struct MetaDEx_location
+{
+    uint32_t property;
+    uint32_t desProperty;
+    rational_t price;
+    int block;
+    unsigned int idx;
+    std::string addr;
+
+    //! Order in which the MetaDEx maps are traversed
+    bool operator<(const MetaDEx_location& other) const
+    {
+        if (property != other.property) return property < other.property;
+        if (MetaDEx_priceCompare()(price, other.price)) return true;
+        if (MetaDEx_priceCompare()(other.price, price)) return false;
+        if (block != other.block) return block < other.block;
+        return idx < other.idx;
+    }
+};
+} // namespace
+
+//! Index of open orders by txid
+static std::unordered_map<uint256, MetaDEx_location, SaltedTxidHasher> metadex_txids GUARDED_BY(cs_tally);
+//! Index of the txids of open orders by address
+static std::unordered_map<std::string, std::set<uint256> > metadex_addresses GUARDED_BY(cs_tally);
+
+static void MetaDEx_index(const CMPMetaDEx& obj)
+{
+    MetaDEx_location location = {obj.getProperty(), obj.getDesProperty(), obj.unitPrice(), obj.getBlock(), obj.getIdx(), obj.getAddr()};
+    metadex_txids[obj.getHash()] = location;
+    metadex_addresses[obj.getAddr()].insert(obj.getHash());
+    SnapshotNotifyMetaDExChange(obj.getProperty());
+}
+
+static void MetaDEx_unindex(const CMPMetaDEx& obj)
+{
+    metadex_txids.erase(obj.getHash());
+    auto it = metadex_addresses.find(obj.getAddr());
+    if (it != metadex_addresses.end()) {
+        it->second.erase(obj.getHash());
+        if (it->second.empty()) metadex_addresses.erase(it);
+    }
+    SnapshotNotifyMetaDExChange(obj.getProperty());
+}
+
+//! Locates an indexed order in the MetaDEx maps
+static bool MetaDEx_locate(const MetaDEx_location& location, md_Set*& pindexes, md_Set::iterator& it)
+{
+    md_PricesMap* prices = get_Prices(location.property);
+    if (!prices) return false;
+    pindexes = get_Indexes(prices, location.price);
+    if (!pindexes) return false;
+    const CMPMetaDEx probe(location.addr, location.block, location.property, 0, location.desProperty, 0, uint256(), location.idx, 0);
+    it = pindexes->find(probe);
+    return it != pindexes->end();
+}
+
+/**
+ * Returns the locations of the open orders of an address, which pass the
+ * filter, in the order the MetaDEx maps are traversed.
+ */
+template <typename Filter>
+static std::vector<MetaDEx_location> MetaDEx_ordersOf(const std::string& addr, Filter filter)
+{
+    std::vector<MetaDEx_location> locations;
+    auto it = metadex_addresses.find(addr);
+    if (it != metadex_addresses.end()) {
+        for (const uint256& txid : it->second) {
+            const MetaDEx_location& location = metadex_txids.at(txid);
+            if (filter(location)) locations.push_back(location);
+        }
+    }
+    std::sort(locations.begin(), locations.end());
+    return locations;
+}
+
 md_PricesMap* mastercore::get_Prices(uint32_t prop)
 {
     md_PropertiesMap::iterator it = metadex.find(prop);
@@ -105,6 +187,18 @@ static int64_t xToRoundUpInt64(const rational_t& value)
     return result.convert_to<int64_t>();
 }
 
+bool MetaDEx_priceCompare::operator()(const rational_t& lhs, const rational_t& rhs) const
+{
+    // prices of orders are built from 64 bit amounts, so the cross products fit into 128 bit,
+    // and the denominators of normalized rationals are always positive
+    if (rangeInt64(lhs) && rangeInt64(rhs)) {
+        const int128_t left = int128_t(lhs.numerator().convert_to<int64_t>()) * rhs.denominator().convert_to<int64_t>();
+        const int128_t right = int128_t(rhs.numerator().convert_to<int64_t>()) * lhs.denominator().convert_to<int64_t>();
+        return left < right;
+    }
+    return lhs < rhs;
+}
+
 std::string xToString(const dec_float& value)
 {
     return value.str(DISPLAY_PRECISION_LEN, std::ios_base::fixed);
@@ -135,11 +229,13 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 {
     const uint32_t propertyForSale = pnew->getProperty();
     const uint32_t propertyDesired = pnew->getDesProperty();
+    // only the remaining amount of the new order changes while matching
+    const rational_t buyersPrice = pnew->inversePrice();
     MatchReturnType NewReturn = NOTHING;
     bool bBuyerSatisfied = false;
 
     if (msc_debug_metadex1) PrintToLog("%s(%s: prop=%d, desprop=%d, desprice= %s);newo: %s\n",
-        __FUNCTION__, pnew->getAddr(), propertyForSale, propertyDesired, xToString(pnew->inversePrice()), pnew->ToString());
+        __FUNCTION__, pnew->getAddr(), propertyForSale, propertyDesired, xToString(buyersPrice), pnew->ToString());
 
     md_PricesMap* const ppriceMap = get_Prices(propertyDesired);
 
@@ -151,14 +247,15 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
     // within the desired property map (given one property) iterate over the items looking at prices
     for (md_PricesMap::iterator priceIt = ppriceMap->begin(); priceIt != ppriceMap->end(); ++priceIt) { // check all prices
-        const rational_t sellersPrice = priceIt->first;
+        const rational_t& sellersPrice = priceIt->first;
 
         if (msc_debug_metadex2) PrintToLog("comparing prices: desprice %s needs to be GREATER THAN OR EQUAL TO %s\n",
-            xToString(pnew->inversePrice()), xToString(sellersPrice));
+            xToString(buyersPrice), xToString(sellersPrice));
 
         // Is the desired price check satisfied? The buyer's inverse price must be larger than that of the seller.
-        if (pnew->inversePrice() < sellersPrice) {
-            continue;
+        // Prices are ascending, so no further price level can satisfy it.
+        if (MetaDEx_priceCompare()(buyersPrice, sellersPrice)) {
+            break;
         }
 
         md_Set* const pofferSet = &(priceIt->second);
@@ -197,7 +294,7 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             assert(pnew->getProperty() != pnew->getDesProperty());
             assert(pnew->getProperty() == pold->getDesProperty());
             assert(pold->getProperty() == pnew->getDesProperty());
-            assert(pold->unitPrice() <= pnew->inversePrice());
+            assert(pold->unitPrice() <= buyersPrice);
             assert(pnew->unitPrice() <= pold->inversePrice());
 
             ///////////////////////////
@@ -233,7 +330,7 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             // orders shall not execute, and no representable fill is made
             const rational_t xEffectivePrice(nWouldPay, nCouldBuy);
 
-            if (xEffectivePrice > pnew->inversePrice()) {
+            if (MetaDEx_priceCompare()(buyersPrice, xEffectivePrice)) {
                 if (msc_debug_metadex1) PrintToLog(
                         "-- effective price is too expensive: %s\n", xToString(xEffectivePrice));
                 ++offerIt;
@@ -252,7 +349,7 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
             // postconditions
             assert(xEffectivePrice >= pold->unitPrice());
-            assert(xEffectivePrice <= pnew->inversePrice());
+            assert(xEffectivePrice <= buyersPrice);
             assert(0 <= seller_amountLeft);
             assert(0 <= buyer_amountLeft);
             assert(seller_amountForSale == seller_amountLeft + buyer_amountGot);
@@ -314,12 +411,14 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
             if (msc_debug_metadex1) PrintToLog("++ erased old: %s\n", offerIt->ToString());
             // erase the old seller element
+            MetaDEx_unindex(*offerIt);
             pofferSet->erase(offerIt++);
 
             // insert the updated one in place of the old
             if (0 < seller_replacement.getAmountRemaining()) {
-                PrintToLog("++ inserting seller_replacement: %s\n", seller_replacement.ToString());
+                if (msc_debug_metadex1) PrintToLog("++ inserting seller_replacement: %s\n", seller_replacement.ToString());
                 pofferSet->insert(seller_replacement);
+                MetaDEx_index(seller_replacement);
             }
 
             if (bBuyerSatisfied) {
@@ -455,39 +554,25 @@ bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) c
 
 bool mastercore::MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx)
 {
-    // Create an empty price map (to use in case price map for this property does not already exist)
-    md_PricesMap temp_prices;
-    // Attempt to obtain the price map for the property
-    md_PricesMap *p_prices = get_Prices(objMetaDEx.getProperty());
-
-    // Create an empty set of metadex objects (to use in case no set currently exists at this price)
-    md_Set temp_indexes;
-    md_Set *p_indexes = nullptr;
-
-    // Prepare for return code
-    std::pair <md_Set::iterator, bool> ret;
-
-    // Attempt to obtain a set of metadex objects for this price from the price map
-    if (p_prices) p_indexes = get_Indexes(p_prices, objMetaDEx.unitPrice());
-    // See if the set was populated, if not no set exists at this price level, use the empty set that we created earlier
-    if (!p_indexes) p_indexes = &temp_indexes;
+    // Obtain the set of metadex objects for this property and price, which is created as needed
+    md_Set& indexes = metadex[objMetaDEx.getProperty()][objMetaDEx.unitPrice()];
 
     // Attempt to insert the metadex object into the set
-    ret = p_indexes->insert(objMetaDEx);
-    if (false == ret.second) return false;
-
-    // If a prices map did not exist for this property, set p_prices to the temp empty price map
-    if (!p_prices) p_prices = &temp_prices;
+    if (!indexes.insert(objMetaDEx).second) return false;
 
-    // Update the prices map with the new set at this price
-    (*p_prices)[objMetaDEx.unitPrice()] = *p_indexes;
-
-    // Set the metadex map for the property to the updated (or new if it didn't exist) price map
-    metadex[objMetaDEx.getProperty()] = *p_prices;
+    MetaDEx_index(objMetaDEx);
 
     return true;
 }
 
+void mastercore::MetaDEx_CLEAR()
+{
+    metadex.clear();
+    metadex_txids.clear();
+    metadex_addresses.clear();
+    SnapshotInvalidate();
+}
+
 // pretty much directly linked to the ADD TX21 command off the wire
 int mastercore::MetaDEx_ADD(const std::string& sender_addr, uint32_t prop, int64_t amount, int block, uint32_t property_desired, int64_t amount_desired, const uint256& txid, unsigned int idx)
 {
@@ -540,37 +625,31 @@ int mastercore::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block,
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        rational_t sellers_price = my_it->first;
-
-        if (mdex.unitPrice() != sellers_price) continue;
+    // the open orders of the sender for the pair and price, in the order of the price map
+    const rational_t unitPrice = mdex.unitPrice();
+    std::vector<MetaDEx_location> locations = MetaDEx_ordersOf(sender_addr, [&](const MetaDEx_location& location) {
+        return location.property == prop && location.desProperty == property_desired && location.price == unitPrice;
+    });
 
-        md_Set* indexes = &(my_it->second);
+    for (const MetaDEx_location& location : locations) {
+        md_Set* indexes = nullptr;
+        md_Set::iterator iitt;
+        if (!MetaDEx_locate(location, indexes, iitt)) continue;
+        p_mdex = &(*iitt);
 
-        for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
-            p_mdex = &(*iitt);
+        rc = 0;
+        PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
 
-            if (msc_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
+        // move from reserve to main
+        assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
+        assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
 
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
-                ++iitt;
-                continue;
-            }
+        // record the cancellation
+        bool bValid = true;
+        pDbTransactionList->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            rc = 0;
-            PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
-
-            // move from reserve to main
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
-
-            // record the cancellation
-            bool bValid = true;
-            pDbTransactionList->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
-
-            indexes->erase(iitt++);
-        }
+        MetaDEx_unindex(*iitt);
+        indexes->erase(iitt);
     }
 
     if (msc_debug_metadex2) MetaDEx_debug_print();
@@ -593,33 +672,30 @@ int mastercore::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int bl
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        md_Set* indexes = &(my_it->second);
+    // the open orders of the sender for the pair, in the order of the price map
+    std::vector<MetaDEx_location> locations = MetaDEx_ordersOf(sender_addr, [&](const MetaDEx_location& location) {
+        return location.property == prop && location.desProperty == property_desired;
+    });
 
-        for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
-            p_mdex = &(*iitt);
+    for (const MetaDEx_location& location : locations) {
+        md_Set* indexes = nullptr;
+        md_Set::iterator iitt;
+        if (!MetaDEx_locate(location, indexes, iitt)) continue;
+        p_mdex = &(*iitt);
 
-            if (msc_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
+        rc = 0;
+        PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
 
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
-                ++iitt;
-                continue;
-            }
-
-            rc = 0;
-            PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, p_mdex->ToString());
+        // move from reserve to main
+        assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
+        assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
 
-            // move from reserve to main
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), -p_mdex->getAmountRemaining(), METADEX_RESERVE));
-            assert(update_tally_map(p_mdex->getAddr(), p_mdex->getProperty(), p_mdex->getAmountRemaining(), BALANCE));
+        // record the cancellation
+        bool bValid = true;
+        pDbTransactionList->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            // record the cancellation
-            bool bValid = true;
-            pDbTransactionList->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
-
-            indexes->erase(iitt++);
-        }
+        MetaDEx_unindex(*iitt);
+        indexes->erase(iitt);
     }
 
     if (msc_debug_metadex3) MetaDEx_debug_print();
@@ -640,44 +716,32 @@ int mastercore::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int bloc
 
     PrintToLog("<<<<<<\n");
 
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        unsigned int prop = my_it->first;
-
+    // the open orders of the sender in the ecosystem, in the order of the MetaDEx maps
+    std::vector<MetaDEx_location> locations = MetaDEx_ordersOf(sender_addr, [&](const MetaDEx_location& location) {
         // skip property, if it is not in the expected ecosystem
-        if (isMainEcosystemProperty(ecosystem) && !isMainEcosystemProperty(prop)) continue;
-        if (isTestEcosystemProperty(ecosystem) && !isTestEcosystemProperty(prop)) continue;
-
-        PrintToLog(" ## property: %u\n", prop);
-        md_PricesMap& prices = my_it->second;
+        if (isMainEcosystemProperty(ecosystem) && !isMainEcosystemProperty(location.property)) return false;
+        if (isTestEcosystemProperty(ecosystem) && !isTestEcosystemProperty(location.property)) return false;
+        return true;
+    });
 
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            rational_t price = it->first;
-            md_Set& indexes = it->second;
-
-            PrintToLog("  # Price Level: %s\n", xToString(price));
-
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end();) {
-                PrintToLog("%s= %s\n", xToString(price), it->ToString());
-
-                if (it->getAddr() != sender_addr) {
-                    ++it;
-                    continue;
-                }
+    for (const MetaDEx_location& location : locations) {
+        md_Set* indexes = nullptr;
+        md_Set::iterator it;
+        if (!MetaDEx_locate(location, indexes, it)) continue;
 
-                rc = 0;
-                PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
+        rc = 0;
+        PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
 
-                // move from reserve to balance
-                assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
-                assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
+        // move from reserve to balance
+        assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
+        assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
 
-                // record the cancellation
-                bool bValid = true;
-                pDbTransactionList->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
+        // record the cancellation
+        bool bValid = true;
+        pDbTransactionList->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
 
-                indexes.erase(it++);
-            }
-        }
+        MetaDEx_unindex(*it);
+        indexes->erase(it);
     }
     PrintToLog(">>>>>>\n");
 
@@ -703,7 +767,10 @@ int mastercore::MetaDEx_SHUTDOWN_ALLPAIR()
                     // move from reserve to balance
                     assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
                     assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
+                    MetaDEx_unindex(*it);
                     indexes.erase(it++);
+                } else {
+                    ++it;
                 }
             }
         }
@@ -731,6 +798,8 @@ int mastercore::MetaDEx_SHUTDOWN()
             }
         }
     }
+    metadex_txids.clear();
+    metadex_addresses.clear();
     return rc;
 }
 
@@ -738,18 +807,9 @@ int mastercore::MetaDEx_SHUTDOWN()
 // allows search to be optimized if propertyIdForSale is specified
 bool mastercore::MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale)
 {
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyIdForSale != 0 && propertyIdForSale != my_it->first) continue;
-        md_PricesMap & prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            md_Set & indexes = (it->second);
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                CMPMetaDEx obj = *it;
-                if( obj.getHash().GetHex() == txid.GetHex() ) return true;
-            }
-        }
-    }
-    return false;
+    auto it = metadex_txids.find(txid);
+    if (it == metadex_txids.end()) return false;
+    return propertyIdForSale == 0 || propertyIdForSale == it->second.property;
 }
 
 /**
@@ -836,14 +896,11 @@ void mastercore::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
  */
 const CMPMetaDEx* mastercore::MetaDEx_RetrieveTrade(const uint256& txid)
 {
-    for (md_PropertiesMap::iterator propIter = metadex.begin(); propIter != metadex.end(); ++propIter) {
-        md_PricesMap & prices = propIter->second;
-        for (md_PricesMap::iterator pricesIter = prices.begin(); pricesIter != prices.end(); ++pricesIter) {
-            md_Set & indexes = pricesIter->second;
-            for (md_Set::iterator tradesIter = indexes.begin(); tradesIter != indexes.end(); ++tradesIter) {
-                if (txid == (*tradesIter).getHash()) return &(*tradesIter);
-            }
-        }
-    }
-    return static_cast<CMPMetaDEx*>(nullptr);
+    auto locationIt = metadex_txids.find(txid);
+    if (locationIt == metadex_txids.end()) return static_cast<CMPMetaDEx*>(nullptr);
+
+    md_Set* indexes = nullptr;
+    md_Set::iterator it;
+    if (!MetaDEx_locate(locationIt->second, indexes, it)) return static_cast<CMPMetaDEx*>(nullptr);
+    return &(*it);
 }
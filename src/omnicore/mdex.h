@@ -110,18 +110,24 @@ struct MetaDEx_compare
     bool operator()(const CMPMetaDEx& lhs, const CMPMetaDEx& rhs) const;
 };
 
+/** Orders prices, without the arbitrary precision arithmetic when numerators and denominators fit into 64 bit. */
+struct MetaDEx_priceCompare
+{
+    bool operator()(const rational_t& lhs, const rational_t& rhs) const;
+};
+
 // ---------------
 //! Set of objects sorted by block+idx
 typedef std::set<CMPMetaDEx, MetaDEx_compare> md_Set; 
 //! Map of prices; there is a set of sorted objects for each price
-typedef std::map<rational_t, md_Set> md_PricesMap;
+typedef std::map<rational_t, md_Set, MetaDEx_priceCompare> md_PricesMap;
 //! Map of properties; there is a map of prices for each property
 typedef std::map<uint32_t, md_PricesMap> md_PropertiesMap;
 
 //! Global map for price and order data
 extern md_PropertiesMap metadex GUARDED_BY(cs_tally);
 
-// TODO: explore a property-pair, instead of a single property as map's key........
+// Open orders are additionally indexed by txid and by address, see MetaDEx_INSERT()
 md_PricesMap* get_Prices(uint32_t prop);
 md_Set* get_Indexes(md_PricesMap* p, rational_t price);
 // ---------------
@@ -133,6 +139,8 @@ int MetaDEx_CANCEL_EVERYTHING(const uint256& txid, uint32_t block, const std::st
 int MetaDEx_SHUTDOWN();
 int MetaDEx_SHUTDOWN_ALLPAIR();
 bool MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx);
+/** Removes all orders, without touching balances. */
+void MetaDEx_CLEAR();
 void MetaDEx_debug_print(bool bShowPriceLevel = false, bool bDisplay = false);
 bool MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale = 0);
 int MetaDEx_getStatus(const uint256& txid, uint32_t propertyIdForSale, int64_t amountForSale, int64_t totalSold = -1);
@@ -1,6 +1,7 @@
 #include <omnicore/notifications.h>
 
 #include <omnicore/log.h>
+#include <omnicore/omnicore.h>
 #include <omnicore/utilsbitcoin.h>
 #include <omnicore/version.h>
 
@@ -21,6 +22,11 @@ namespace mastercore
 //! Vector of currently active Omni alerts
 std::vector<AlertData> currentOmniAlerts;
 
+//! Handler of the state change feed, the feed is disabled if empty
+static StateChangesHandler stateChangesHandler GUARDED_BY(cs_tally);
+//! Changes of the block being processed
+static std::shared_ptr<StateChanges> pendingStateChanges GUARDED_BY(cs_tally);
+
 /**
  * Deletes previously broadcast alerts from sender from the alerts vector
  *
@@ -186,4 +192,59 @@ bool CheckExpiredAlerts(unsigned int curBlock, uint64_t curTime)
     return true;
 }
 
+void SetStateChangesHandler(StateChangesHandler handler)
+{
+    LOCK(cs_tally);
+    stateChangesHandler = std::move(handler);
+    pendingStateChanges = stateChangesHandler ? std::make_shared<StateChanges>() : nullptr;
+}
+
+void StateChangesNotifyTransaction(const StateChangeTx& tx)
+{
+    LOCK(cs_tally);
+    if (pendingStateChanges) pendingStateChanges->transactions.push_back(tx);
+}
+
+void StateChangesNotifyTally(const std::string& address, uint32_t propertyId, TallyType ttype, int64_t amount)
+{
+    LOCK(cs_tally);
+    if (!pendingStateChanges) return;
+    auto it = pendingStateChanges->tallyDeltas.find(std::make_pair(address, propertyId));
+    if (it == pendingStateChanges->tallyDeltas.end()) {
+        it = pendingStateChanges->tallyDeltas.emplace(std::make_pair(address, propertyId), std::array<int64_t, TALLY_TYPE_COUNT>()).first;
+        it->second.fill(0);
+    }
+    it->second[ttype] += amount;
+}
+
+void PublishStateChanges(int block, const uint256& blockHash)
+{
+    LOCK(cs_tally);
+    if (!pendingStateChanges) return;
+    std::shared_ptr<StateChanges> changes = std::make_shared<StateChanges>();
+    changes.swap(pendingStateChanges);
+    changes->block = block;
+    changes->blockHash = blockHash;
+    changes->rewind = false;
+    // balances that changed back and forth within the block are left out
+    for (auto it = changes->tallyDeltas.begin(); it != changes->tallyDeltas.end(); ) {
+        bool fChanged = false;
+        for (int64_t delta : it->second) fChanged |= (delta != 0);
+        it = fChanged ? std::next(it) : changes->tallyDeltas.erase(it);
+    }
+    stateChangesHandler(changes);
+}
+
+void PublishStateRewind(int block, const uint256& blockHash)
+{
+    LOCK(cs_tally);
+    if (!pendingStateChanges) return;
+    pendingStateChanges = std::make_shared<StateChanges>();
+    std::shared_ptr<StateChanges> changes = std::make_shared<StateChanges>();
+    changes->block = block;
+    changes->blockHash = blockHash;
+    changes->rewind = true;
+    stateChangesHandler(changes);
+}
+
 } // namespace mastercore
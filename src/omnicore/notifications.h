@@ -1,8 +1,17 @@
 #ifndef BITCOIN_OMNICORE_NOTIFICATIONS_H
 #define BITCOIN_OMNICORE_NOTIFICATIONS_H
 
+#include <omnicore/tally.h>
+
+#include <uint256.h>
+
 #include <stdint.h>
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 //! Alert types
@@ -45,6 +54,50 @@ std::vector<std::string> GetOmniCoreAlertMessages();
 
 /** Expires any alerts that need expiring. */
 bool CheckExpiredAlerts(unsigned int curBlock, uint64_t curTime);
+
+/** An Omni transaction processed in a block, for the state change feed.
+ */
+struct StateChangeTx
+{
+    uint256 txid;
+    //! Position of the transaction in the block
+    unsigned int idx;
+    //! Result of interpretPacket(), valid if not negative
+    int result;
+    unsigned int type;
+    uint32_t propertyId;
+    int64_t amount;
+    std::string sender;
+    std::string receiver;
+};
+
+/** The Omni state changes of a processed block, or a rewind of the state.
+ */
+struct StateChanges
+{
+    //! The block processed, or the last block of the state restored by a rewind
+    int block;
+    uint256 blockHash;
+    //! Whether the state was rewound and is reparsed from after the block, consumers must reload balances
+    bool rewind;
+    //! Transactions of the block, in the order of processing
+    std::vector<StateChangeTx> transactions;
+    //! Net change of each tally type, by address and property
+    std::map<std::pair<std::string, uint32_t>, std::array<int64_t, TALLY_TYPE_COUNT> > tallyDeltas;
+};
+
+typedef std::function<void(const std::shared_ptr<const StateChanges>&)> StateChangesHandler;
+
+/** Sets the handler for the state changes of each block, enabling their collection, or clears it. */
+void SetStateChangesHandler(StateChangesHandler handler);
+/** Records a processed transaction of the current block, if the feed is enabled. */
+void StateChangesNotifyTransaction(const StateChangeTx& tx);
+/** Records a tally change of the current block, if the feed is enabled. */
+void StateChangesNotifyTally(const std::string& address, uint32_t propertyId, TallyType ttype, int64_t amount);
+/** Hands the changes of the processed block to the handler, and starts collecting for the next one. */
+void PublishStateChanges(int block, const uint256& blockHash);
+/** Drops the collected changes and hands a rewind to the last block of the restored state to the handler. */
+void PublishStateRewind(int block, const uint256& blockHash);
 }
 
 #endif // BITCOIN_OMNICORE_NOTIFICATIONS_H
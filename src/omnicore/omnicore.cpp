@@ -18,6 +18,7 @@
 #include <omnicore/dbtxlist.h>
 #include <omnicore/dex.h>
 #include <omnicore/log.h>
+#include <omnicore/markerindex.h>
 #include <omnicore/mdex.h>
 #include <omnicore/notifications.h>
 #include <omnicore/parsing.h>
@@ -26,6 +27,7 @@
 #include <omnicore/rules.h>
 #include <omnicore/script.h>
 #include <omnicore/seedblocks.h>
+#include <omnicore/snapshot.h>
 #include <omnicore/sp.h>
 #include <omnicore/tally.h>
 #include <omnicore/tx.h>
@@ -33,12 +35,14 @@
 #include <omnicore/utilsui.h>
 #include <omnicore/version.h>
 #include <omnicore/walletcache.h>
+#include <omnicore/walletfetchtxs.h>
 #include <omnicore/walletutils.h>
 
 #include <base58.h>
 #include <chainparams.h>
 #include <coins.h>
 #include <core_io.h>
+#include <dbcompaction.h>
 #include <fs.h>
 #include <key_io.h>
 #include <init.h>
@@ -54,7 +58,9 @@
 #include <ui_interface.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <util/threadnames.h>
 #include <util/time.h>
+#include <util/trace.h>
 #ifdef ENABLE_WALLET
 #include <wallet/ismine.h>
 #include <wallet/wallet.h>
@@ -67,8 +73,11 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <condition_variable>
+#include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -87,6 +96,9 @@ static std::string exodus_address = exodus_mainnet;
 
 static int nWaterlineBlock = 0;
 
+//! The last block, which was processed, or which the loaded state belongs to
+static const CBlockIndex* pLastProcessedBlock GUARDED_BY(cs_tally) = nullptr;
+
 /**
  * Used to indicate, whether to automatically commit created transactions.
  *
@@ -137,6 +149,8 @@ std::set<std::pair<std::string,uint32_t> > setFrozenAddresses;
 
 //! In-memory collection of all amounts for all addresses for all properties
 std::unordered_map<std::string, CMPTally> mastercore::mp_tally_map;
+//! Index of the holders of all properties
+std::unordered_map<uint32_t, CMPHolders> mastercore::mp_holders_map;
 
 // Only needed for GUI:
 
@@ -315,6 +329,7 @@ void mastercore::ClearFreezeState()
     // Should only ever be called in the event of a reorg
     setFreezingEnabledProperties.clear();
     setFrozenAddresses.clear();
+    SnapshotNotifyFreezeChange();
 }
 
 void mastercore::PrintFreezeState()
@@ -354,6 +369,7 @@ void mastercore::disableFreezing(uint32_t propertyId)
         if ((*it).second == propertyId) {
             PrintToLog("Address %s has been unfrozen for property %d.\n", (*it).first, propertyId);
             it = setFrozenAddresses.erase(it);
+            SnapshotNotifyFreezeChange();
             assert(!isAddressFrozen((*it).first, (*it).second));
         } else {
             it++;
@@ -378,6 +394,7 @@ bool mastercore::isFreezingEnabled(uint32_t propertyId, int block)
 void mastercore::freezeAddress(const std::string& address, uint32_t propertyId)
 {
     setFrozenAddresses.insert(std::make_pair(address, propertyId));
+    SnapshotNotifyFreezeChange();
     assert(isAddressFrozen(address, propertyId));
     PrintToLog("Address %s has been frozen for property %d.\n", address, propertyId);
 }
@@ -385,10 +402,16 @@ void mastercore::freezeAddress(const std::string& address, uint32_t propertyId)
 void mastercore::unfreezeAddress(const std::string& address, uint32_t propertyId)
 {
     setFrozenAddresses.erase(std::make_pair(address, propertyId));
+    SnapshotNotifyFreezeChange();
     assert(!isAddressFrozen(address, propertyId));
     PrintToLog("Address %s has been unfrozen for property %d.\n", address, propertyId);
 }
 
+std::set<std::pair<std::string,uint32_t> > mastercore::getFrozenAddresses()
+{
+    return setFrozenAddresses;
+}
+
 bool mastercore::isAddressFrozen(const std::string& address, uint32_t propertyId)
 {
     if (setFrozenAddresses.find(std::make_pair(address, propertyId)) != setFrozenAddresses.end()) {
@@ -416,7 +439,6 @@ std::string mastercore::getTokenLabel(uint32_t propertyId)
 // optionally counts the number of addresses who own that property: n_owners_total
 int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
 {
-    int64_t prev = 0;
     int64_t owners = 0;
     int64_t totalTokens = 0;
 
@@ -428,18 +450,10 @@ int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
     }
 
     if (!property.fixed || n_owners_total) {
-        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const CMPTally& tally = it->second;
-
-            totalTokens += tally.getMoney(propertyId, BALANCE);
-            totalTokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
-            totalTokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
-            totalTokens += tally.getMoney(propertyId, METADEX_RESERVE);
-
-            if (prev != totalTokens) {
-                prev = totalTokens;
-                owners++;
-            }
+        std::unordered_map<uint32_t, CMPHolders>::const_iterator it = mp_holders_map.find(propertyId);
+        if (it != mp_holders_map.end()) {
+            totalTokens = it->second.total;
+            owners = it->second.owners.size();
         }
         int64_t cachedFee = pDbFeeCache->GetCachedAmount(propertyId);
         totalTokens += cachedFee;
@@ -454,6 +468,43 @@ int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
     return totalTokens;
 }
 
+// the amount of a property owned by an address, including reserved amounts
+static int64_t getOwnedTokens(const CMPTally& tally, uint32_t propertyId)
+{
+    int64_t tokens = 0;
+    tokens += tally.getMoney(propertyId, BALANCE);
+    tokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
+    tokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
+    tokens += tally.getMoney(propertyId, METADEX_RESERVE);
+    return tokens;
+}
+
+// moves an address to its new position in the index of holders
+static void updateHolders(const std::string& who, uint32_t propertyId, int64_t before, int64_t after)
+{
+    CMPHolders& holders = mp_holders_map[propertyId];
+    if (0 < before) holders.owners.erase(std::make_pair(before, who));
+    if (0 < after) holders.owners.insert(std::make_pair(after, who));
+    holders.total += after - before;
+    if (holders.owners.empty() && 0 == holders.total) mp_holders_map.erase(propertyId);
+}
+
+void mastercore::RebuildHolders()
+{
+    LOCK(cs_tally);
+
+    mp_holders_map.clear();
+    for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        CMPTally& tally = it->second;
+        uint32_t propertyId = 0;
+        tally.init();
+        while (0 != (propertyId = tally.next())) {
+            int64_t tokens = getOwnedTokens(tally, propertyId);
+            if (tokens) updateHolders(it->first, propertyId, 0, tokens);
+        }
+    }
+}
+
 // return true if everything is ok
 bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype)
 {
@@ -476,8 +527,6 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
         assert(!isAddressFrozen(who, propertyId)); // for safety, this should never fail if everything else is working properly.
     }
 
-    before = GetTokenBalance(who, propertyId, ttype);
-
     std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(who);
     if (my_it == mp_tally_map.end()) {
         // insert an empty element
@@ -485,13 +534,20 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
     }
 
     CMPTally& tally = my_it->second;
+    const int64_t ownedBefore = getOwnedTokens(tally, propertyId);
+    before = tally.getMoney(propertyId, ttype);
     bRet = tally.updateMoney(propertyId, amount, ttype);
-
-    after = GetTokenBalance(who, propertyId, ttype);
+    after = tally.getMoney(propertyId, ttype);
     if (!bRet) {
         assert(before == after);
         PrintToLog("%s(%s, %u=0x%X, %+d, ttype=%d) ERROR: insufficient balance (=%d)\n", __func__, who, propertyId, propertyId, amount, ttype, before);
     }
+    if (before != after) {
+        updateHolders(who, propertyId, ownedBefore, ownedBefore + (after - before));
+        WalletCacheNotifyChange(who);
+        SnapshotNotifyTallyChange(who);
+        StateChangesNotifyTally(who, propertyId, ttype, after - before);
+    }
     if (msc_debug_tally && (exodus_address != who || msc_debug_exo)) {
         PrintToLog("%s(%s, %u=0x%X, %+d, ttype=%d): before=%d, after=%d\n", __func__, who, propertyId, propertyId, amount, ttype, before, after);
     }
@@ -499,6 +555,45 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
     return bRet;
 }
 
+void mastercore::credit_tally_map(const OwnerAddrType& receivers, uint32_t propertyId)
+{
+    LOCK(cs_tally);
+
+    // The holders of the property are looked up once, instead of once per receiver
+    CMPHolders& holders = mp_holders_map[propertyId];
+
+    for (OwnerAddrType::const_reverse_iterator it = receivers.rbegin(); it != receivers.rend(); ++it) {
+        const std::string& who = it->second;
+        const int64_t amount = it->first;
+        assert(0 < amount);
+
+        std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(who);
+        if (my_it == mp_tally_map.end()) {
+            my_it = (mp_tally_map.insert(std::make_pair(who, CMPTally()))).first;
+        }
+
+        CMPTally& tally = my_it->second;
+        const int64_t ownedBefore = getOwnedTokens(tally, propertyId);
+        const int64_t before = tally.getMoney(propertyId, BALANCE);
+        const bool fUpdated = tally.updateMoney(propertyId, amount, BALANCE);
+        assert(fUpdated);
+
+        if (0 < ownedBefore) holders.owners.erase(std::make_pair(ownedBefore, who));
+        holders.owners.insert(std::make_pair(ownedBefore + amount, who));
+        holders.total += amount;
+
+        WalletCacheNotifyChange(who);
+        SnapshotNotifyTallyChange(who);
+        StateChangesNotifyTally(who, propertyId, BALANCE, amount);
+
+        if (msc_debug_tally && (exodus_address != who || msc_debug_exo)) {
+            PrintToLog("%s(%s, %u=0x%X, %+d, ttype=%d): before=%d, after=%d\n", __func__, who, propertyId, propertyId, amount, BALANCE, before, before + amount);
+        }
+    }
+
+    if (holders.owners.empty() && 0 == holders.total) mp_holders_map.erase(propertyId);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // some old TODOs
@@ -534,13 +629,22 @@ static int64_t calculate_and_update_devmsc(unsigned int nTime, int block)
     int64_t exodus_delta = 0;
     // spec constants:
     const int64_t all_reward = 5631623576222;
-    const double seconds_in_one_year = 31556926;
-    const double seconds_passed = nTime - exodus_bootstrap_deadline;
-    const double years = seconds_passed / seconds_in_one_year;
-    const double part_available = 1 - pow(0.5, years);
-    const double available_reward = all_reward * part_available;
 
-    devmsc = rounduint64(available_reward);
+    // the vested amount only depends on the timestamp, so it's not recalculated for repeated timestamps
+    static unsigned int nTimeCached = 0;
+    static int64_t devmscCached = 0;
+    if (nTime != nTimeCached) {
+        const double seconds_in_one_year = 31556926;
+        const double seconds_passed = nTime - exodus_bootstrap_deadline;
+        const double years = seconds_passed / seconds_in_one_year;
+        const double part_available = 1 - pow(0.5, years);
+        const double available_reward = all_reward * part_available;
+
+        devmscCached = rounduint64(available_reward);
+        nTimeCached = nTime;
+    }
+
+    devmsc = devmscCached;
     exodus_delta = devmsc - exodus_prev;
 
     if (msc_debug_exo) PrintToLog("devmsc=%d, exodus_prev=%d, exodus_delta=%d\n", devmsc, exodus_prev, exodus_delta);
@@ -614,9 +718,11 @@ void CheckWalletUpdate(bool forceUpdate)
     global_balance_reserved.clear();
 
     // populate global balance totals and wallet property list - note global balances do not include additional balances from watch-only addresses
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+    // only the wallet addresses known to the wallet cache are visited, not the whole tally map
+    for (const std::string& address : WalletCacheAddresses()) {
+        std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(address);
+        if (my_it == mp_tally_map.end()) continue;
         // check if the address is a wallet address (including watched addresses)
-        std::string address = my_it->first;
         int addressIsMine = IsMyAddressAllWallets(address, false, ISMINE_SPENDABLE);
         if (!addressIsMine) continue;
         // iterate only those properties in the TokenMap for this address
@@ -696,6 +802,46 @@ bool IsInMarkerCache(const uint256& txHash)
     return (setMarkerCache.find(txHash) != setMarkerCache.end());
 }
 
+//! The "omni" marker, which starts the payload of Class C transactions
+static const unsigned char OMNI_MARKER[] = {0x6f, 0x6d, 0x6e, 0x69};
+
+/**
+ * Checks, whether the first data push of any OP_RETURN output starts with the "omni" marker.
+ *
+ * This is a pre-filter on the raw scripts without allocations: transactions without
+ * a match are never Omni transactions, all others are classified by GetEncodingClass().
+ */
+static bool HasOmMarkerOutput(const CTransaction& tx)
+{
+    for (const CTxOut& out : tx.vout) {
+        const CScript& script = out.scriptPubKey;
+        if (script.size() < 2 || script[0] != OP_RETURN)
+            continue;
+
+        CScript::const_iterator pc = script.begin() + 1;
+        while (pc < script.end()) {
+            CScript::const_iterator pcOp = pc;
+            opcodetype opcode;
+            if (!script.GetOp(pc, opcode)) break;
+            if (opcode > OP_PUSHDATA4) continue; // not a data push
+
+            // skip the opcode and size prefix of the push
+            size_t nPrefix = 1;
+            if (opcode == OP_PUSHDATA1) nPrefix = 2;
+            else if (opcode == OP_PUSHDATA2) nPrefix = 3;
+            else if (opcode == OP_PUSHDATA4) nPrefix = 5;
+            CScript::const_iterator pcData = pcOp + nPrefix;
+
+            if (static_cast<size_t>(pc - pcData) >= sizeof(OMNI_MARKER) && std::equal(OMNI_MARKER, OMNI_MARKER + sizeof(OMNI_MARKER), pcData)) {
+                return true;
+            }
+            break; // only the first push holds the marker
+        }
+    }
+
+    return false;
+}
+
 /**
  * Returns the encoding class, used to embed a payload.
  *
@@ -709,6 +855,9 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
     if (nBlock != 0 && nBlock < ConsensusParams().GENESIS_BLOCK)
         return NO_MARKER;
 
+    if (!HasOmMarkerOutput(tx))
+        return NO_MARKER;
+
     bool hasOpReturn = false;
     for (unsigned int n = 0; n < tx.vout.size(); ++n) {
         const CTxOut& out = tx.vout[n];
@@ -772,6 +921,10 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
         view.Flush();
     }
 
+    // the last previous transaction retrieved, reused for further outputs spent from it
+    CTransactionRef txPrev;
+    uint256 hashBlock;
+
     for (std::vector<CTxIn>::const_iterator it = tx.vin.begin(); it != tx.vin.end(); ++it) {
         const CTxIn& txIn = *it;
         unsigned int nOut = txIn.prevout.n;
@@ -784,12 +937,10 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
             ++nCacheMiss;
         }
 
-        CTransactionRef txPrev;
-        uint256 hashBlock;
         Coin newcoin;
         if (removedCoins && removedCoins->find(txIn.prevout) != removedCoins->end()) {
             newcoin = removedCoins->find(txIn.prevout)->second;
-        } else if (GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock)) {
+        } else if ((txPrev && txPrev->GetHash() == txIn.prevout.hash) || GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock)) {
             newcoin.out.scriptPubKey = txPrev->vout[nOut].scriptPubKey;
             newcoin.out.nValue = txPrev->vout[nOut].nValue;
             newcoin.nHeight = 1;
@@ -805,6 +956,70 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
     return true;
 }
 
+//! An input of a transaction with Omni marker, fetched ahead of parsing
+struct PrefetchedInput
+{
+    COutPoint prevout;
+    CTxOut out;
+    //! The block of the previous transaction, or null, if it was in the mempool
+    uint256 hashBlock;
+};
+
+/**
+ * Fetches the inputs of all transactions with Omni marker of a block.
+ *
+ * Previous transactions are retrieved in the order of their hashes, and only
+ * once, even if several of their outputs are spent. Inputs, which can't be
+ * retrieved, are left to FillTxInputCache().
+ *
+ * Doesn't require cs_main, so it can be run ahead of parsing.
+ *
+ * @param block[in]     The block to fetch the inputs for
+ * @param nBlock[in]    The height of the block
+ * @param vInputs[out]  The fetched inputs
+ */
+static void PrefetchBlockInputs(const CBlock& block, int nBlock, std::vector<PrefetchedInput>& vInputs)
+{
+    std::map<uint256, std::vector<uint32_t> > mapPrevOuts;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        if (GetEncodingClass(*tx, nBlock) == NO_MARKER) continue;
+        for (const CTxIn& txIn : tx->vin) {
+            mapPrevOuts[txIn.prevout.hash].push_back(txIn.prevout.n);
+        }
+    }
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    for (const auto& prevOuts : mapPrevOuts) {
+        CTransactionRef txPrev;
+        uint256 hashBlock;
+        if (!GetTransaction(prevOuts.first, txPrev, consensusParams, hashBlock)) continue;
+        for (uint32_t n : prevOuts.second) {
+            if (n >= txPrev->vout.size()) continue;
+            vInputs.push_back({COutPoint(prevOuts.first, n), txPrev->vout[n], hashBlock});
+        }
+    }
+}
+
+/**
+ * Adds prefetched inputs, which are not yet cached, to the coins view cache.
+ */
+static void AddPrefetchedInputs(const std::vector<PrefetchedInput>& vInputs) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    LOCK(cs_viewcache);
+    for (const PrefetchedInput& input : vInputs) {
+        if (g_viewcache.HaveCoinInCache(input.prevout)) continue;
+
+        Coin newcoin;
+        newcoin.out = input.out;
+        newcoin.nHeight = 1;
+        if (CBlockIndex *pindex = LookupBlockIndex(input.hashBlock))
+            newcoin.nHeight = pindex->nHeight;
+
+        g_viewcache.AddCoin(input.prevout, std::move(newcoin), true);
+    }
+}
+
 // idx is position within the block, 0-based
 // int msc_tx_push(const CTransaction &wtx, int nBlock, unsigned int idx)
 // INPUT: bRPConly -- set to true to avoid moving funds; to be called from various RPC calls like this
@@ -1160,14 +1375,142 @@ public:
     }
 };
 
+/**
+ * Reads blocks of the initial scan ahead of their processing.
+ *
+ * Reader threads pick up the blocks in ascending order, and load, deserialize
+ * and verify them up to SCAN_READ_AHEAD_BLOCKS ahead of the block, which is
+ * currently processed. The block positions are resolved upfront, so the reader
+ * threads never need cs_main, which is held by the scan.
+ *
+ * @see msc_initial_scan()
+ */
+class BlockPrefetcher
+{
+public:
+    struct Entry
+    {
+        const CBlockIndex* pindex;
+        FlatFilePos pos;
+        //! The block is filtered out, and not read at all
+        bool fSkip;
+        //! Set, once the block was read, or reading failed
+        bool fDone;
+        std::shared_ptr<const CBlock> block;
+        //! Inputs of the transactions with Omni marker of the block
+        std::vector<PrefetchedInput> inputs;
+    };
+
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<Entry> m_entries GUARDED_BY(m_mutex);
+    size_t m_nNextRead GUARDED_BY(m_mutex);
+    size_t m_nProcessing GUARDED_BY(m_mutex);
+    bool m_fStop GUARDED_BY(m_mutex);
+    std::vector<std::thread> m_threads;
+
+    void ThreadRead()
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
+        for (;;) {
+            size_t n;
+            Entry entry;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                while (!m_fStop && m_nNextRead < m_entries.size() && m_nNextRead >= m_nProcessing + SCAN_READ_AHEAD_BLOCKS) {
+                    m_cond.wait(lock);
+                }
+                if (m_fStop || m_nNextRead >= m_entries.size()) return;
+                n = m_nNextRead++;
+                entry = m_entries[n];
+            }
+
+            std::shared_ptr<CBlock> pblock;
+            std::vector<PrefetchedInput> vInputs;
+            if (!entry.fSkip) {
+                pblock = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pblock, entry.pos, consensusParams)) {
+                    pblock.reset();
+                } else if (pblock->GetHash() != entry.pindex->GetBlockHash()) {
+                    PrintToLog("%s(): block hash mismatch for block %d at %s\n", __func__, entry.pindex->nHeight, entry.pos.ToString());
+                    pblock.reset();
+                } else {
+                    PrefetchBlockInputs(*pblock, entry.pindex->nHeight, vInputs);
+                }
+            }
+
+            {
+                LOCK(m_mutex);
+                m_entries[n].block = std::move(pblock);
+                m_entries[n].inputs = std::move(vInputs);
+                m_entries[n].fDone = true;
+            }
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    BlockPrefetcher(std::vector<Entry>&& entries, int nThreads)
+    : m_entries(std::move(entries)), m_nNextRead(0), m_nProcessing(0), m_fStop(false)
+    {
+        for (int i = 0; i < nThreads; ++i) {
+            m_threads.emplace_back([this, i] {
+                util::ThreadRename(strprintf("omniscan.%i", i));
+                ThreadRead();
+            });
+        }
+    }
+
+    ~BlockPrefetcher()
+    {
+        {
+            LOCK(m_mutex);
+            m_fStop = true;
+        }
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Waits for the n-th block, and marks it as being processed.
+     *
+     * @param n[in]         The position of the block
+     * @param inputs[out]   The prefetched inputs of the block
+     * @return The block, or nullptr, if the block was skipped or could not be read
+     */
+    std::shared_ptr<const CBlock> Get(size_t n, std::vector<PrefetchedInput>& inputs)
+    {
+        std::shared_ptr<const CBlock> block;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_nProcessing = n;
+            m_cond.notify_all();
+            while (!m_entries[n].fDone) {
+                m_cond.wait(lock);
+            }
+            block = std::move(m_entries[n].block);
+            inputs = std::move(m_entries[n].inputs);
+        }
+        return block;
+    }
+};
+
 /**
  * Scans the blockchain for meta transactions.
  *
- * It scans the blockchain, starting at the given block index, to the current
- * tip, much like as if new block were arriving and being processed on the fly.
+ * It scans the blockchain, starting at the given block index, to the given last
+ * block or the current tip, much like as if new block were arriving and being
+ * processed on the fly.
  *
  * Every 30 seconds the progress of the scan is reported.
  *
+ * Blocks filtered by the seed block list, or known to contain no transaction
+ * with Omni marker by the marker index, are not read at all. The inputs of
+ * transactions with Omni marker are fetched together with the blocks.
+ *
  * In case the current block being processed is not part of the active chain, or
  * if a block could not be retrieved from the disk, then the scan stops early.
  * Likewise, global shutdown requests are honored, and stop the scan progress.
@@ -1177,9 +1520,10 @@ public:
  * @see mastercore_handler_block_end()
  *
  * @param nFirstBlock[in]  The index of the first block to scan
+ * @param nLastBlock[in]   The index of the last block to scan, or -1 for the tip
  * @return An exit code, indicating success or failure
  */
-static int msc_initial_scan(int nFirstBlock)
+static int msc_initial_scan(int nFirstBlock, int nLastBlock = -1)
 {
     AssertLockHeld(cs_main);
 
@@ -1188,7 +1532,7 @@ static int msc_initial_scan(int nFirstBlock)
     unsigned int nTxsTotal = 0;
     unsigned int nTxsFoundTotal = 0;
     int nBlock = 999999;
-    const int nLastBlock = GetHeight();
+    if (nLastBlock < 0 || nLastBlock > GetHeight()) nLastBlock = GetHeight();
 
     // this function is useless if there are not enough blocks in the blockchain yet!
     if (nFirstBlock < 0 || nLastBlock < nFirstBlock) return -1;
@@ -1202,7 +1546,36 @@ static int msc_initial_scan(int nFirstBlock)
     // check if using seed block filter should be disabled
     bool seedBlockFilterEnabled = gArgs.GetBoolArg("-omniseedblockfilter", true);
 
+    // resolve the blocks to scan, while holding cs_main, for the reader threads
+    std::vector<BlockPrefetcher::Entry> vEntries;
+    std::vector<bool> vSkip;
+    vEntries.reserve(nLastBlock - nFirstBlock + 1);
+    vSkip.reserve(nLastBlock - nFirstBlock + 1);
+    unsigned int nBlocksFiltered = 0;
     for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
+    {
+        const CBlockIndex* pblockindex = ::ChainActive()[nBlock];
+        if (nullptr == pblockindex) break;
+        bool fSkip = seedBlockFilterEnabled && SkipBlock(nBlock);
+        // skip blocks, which are known to contain no transaction with Omni marker
+        unsigned int nCandidates;
+        if (!fSkip && g_omni_marker_index && g_omni_marker_index->LookupCandidates(pblockindex, nCandidates) && nCandidates == 0) {
+            fSkip = true;
+            ++nBlocksFiltered;
+        }
+        vEntries.push_back({pblockindex, pblockindex->GetBlockPos(), fSkip, false, nullptr, {}});
+        vSkip.push_back(fSkip);
+    }
+    if (nBlocksFiltered > 0) {
+        PrintToLog("Skipping %d blocks without Omni marker, based on the marker index\n", nBlocksFiltered);
+    }
+    const int nScanLastBlock = nFirstBlock + static_cast<int>(vEntries.size()) - 1;
+
+    int nReadThreads = gArgs.GetArg("-omniscanthreads", DEFAULT_SCAN_THREADS);
+    nReadThreads = std::max(1, std::min(nReadThreads, MAX_SCAN_THREADS));
+    BlockPrefetcher prefetcher(std::move(vEntries), nReadThreads);
+
+    for (nBlock = nFirstBlock; nBlock <= nScanLastBlock; ++nBlock)
     {
         if (ShutdownRequested()) {
             PrintToLog("Shutdown requested, stop scan at block %d of %d\n", nBlock, nLastBlock);
@@ -1210,8 +1583,6 @@ static int msc_initial_scan(int nFirstBlock)
         }
 
         CBlockIndex* pblockindex = ::ChainActive()[nBlock];
-
-        if (nullptr == pblockindex) break;
         std::string strBlockHash = pblockindex->GetBlockHash().GetHex();
 
         if (msc_debug_exo) PrintToLog("%s(%d; max=%d):%s, line %d, file: %s\n",
@@ -1226,11 +1597,13 @@ static int msc_initial_scan(int nFirstBlock)
         unsigned int nTxsFoundInBlock = 0;
         mastercore_handler_block_begin(nBlock, pblockindex);
 
-        if (!seedBlockFilterEnabled || !SkipBlock(nBlock)) {
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) break;
+        if (!vSkip[nBlock - nFirstBlock]) {
+            std::vector<PrefetchedInput> vInputs;
+            std::shared_ptr<const CBlock> pblock = prefetcher.Get(nBlock - nFirstBlock, vInputs);
+            if (!pblock) break;
+            AddPrefetchedInputs(vInputs);
 
-            for(const auto tx : block.vtx) {
+            for(const auto& tx : pblock->vtx) {
                 if (mastercore_handler_tx(*tx, nBlock, nTxNum, pblockindex, nullptr)) ++nTxsFoundInBlock;
                 ++nTxNum;
             }
@@ -1263,10 +1636,13 @@ void clear_all_state()
 
     // Memory based storage
     mp_tally_map.clear();
+    mp_holders_map.clear();
+    WalletCacheInvalidate();
+    SnapshotInvalidate();
     my_offers.clear();
-    my_accepts.clear();
-    my_crowds.clear();
-    metadex.clear();
+    DEx_acceptsClear();
+    clearCrowdsales();
+    MetaDEx_CLEAR();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
@@ -1282,6 +1658,8 @@ void clear_all_state()
     pDbFeeCache->Clear();
     pDbFeeHistory->Clear();
     assert(pDbTransactionList->setDBVersion() == DB_VERSION); // new set of databases, set DB version
+    WalletTxIndexSetHeight(0);
+    pLastProcessedBlock = nullptr;
     exodus_prev = 0;
 }
 
@@ -1291,6 +1669,10 @@ static void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialPars
     bool reorgContainsFreeze;
     {
         LOCK(cs_tally);
+        // Writes of the last block are committed, before records above the height are removed
+        pDbTradeList->CommitBatch();
+        pDbStoList->CommitBatch();
+
         // Check if any freeze related transactions would be rolled back - if so wipe the state and startclean
         reorgContainsFreeze = pDbTransactionList->CheckForFreezeTxs(nHeight);
 
@@ -1300,6 +1682,7 @@ static void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialPars
         pDbStoList->deleteAboveBlock(nHeight);
         pDbFeeCache->RollBackCache(nHeight);
         pDbFeeHistory->RollBackHistory(nHeight);
+        WalletTxIndexSetHeight(nHeight - 1);
         reorgRecoveryMaxHeight = 0;
 
         nWaterlineBlock = ConsensusParams().GENESIS_BLOCK - 1;
@@ -1326,12 +1709,69 @@ static void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialPars
         CheckWalletUpdate(true);
         uiInterface.OmniStateInvalidated();
         nWaterline = nWaterlineBlock;
+        pLastProcessedBlock = ::ChainActive()[nWaterline];
+        PublishStateRewind(nWaterline, pLastProcessedBlock ? pLastProcessedBlock->GetBlockHash() : uint256());
     }
 
     if (nWaterline < nBlockPrev) {
-        // scan from the block after the best active block to catch up to the active chain
-        msc_initial_scan(nWaterline + 1);
+        // scan from the block after the best active block to catch up to the previous block,
+        // which is not necessarily the tip, when blocks are processed asynchronously
+        msc_initial_scan(nWaterline + 1, nBlockPrev);
+    }
+}
+
+//! Folders of the Omni state in the Omni data directory
+static const char* const OMNI_STATE_FOLDERS[] = {
+    "MP_persist", "MP_txlist", "MP_tradelist", "MP_spinfo", "MP_stolist", "Omni_TXDB", "OMNI_feecache", "OMNI_feehistory"
+};
+
+/**
+ * Copies the Omni state folders of another, stopped node into the Omni data directory.
+ *
+ * The copied state is not trusted yet, it is verified against a consensus checkpoint once loaded.
+ */
+static bool ImportStateSnapshot(const fs::path& pathSnapshot)
+{
+    for (const char* folder : OMNI_STATE_FOLDERS) {
+        if (!fs::is_directory(pathSnapshot / folder)) {
+            PrintToConsole("Failed to import Omni state snapshot: %s has no %s folder\n", pathSnapshot.string(), folder);
+            return false;
+        }
+    }
+
+    try {
+        for (const char* folder : OMNI_STATE_FOLDERS) {
+            const fs::path target = GetOmniDataDir() / folder;
+            fs::remove_all(target);
+            fs::create_directories(target);
+            for (fs::directory_iterator it(pathSnapshot / folder), end; it != end; ++it) {
+                if (fs::is_regular_file(it->status()) && it->path().filename() != "LOCK") {
+                    fs::copy_file(it->path(), target / it->path().filename());
+                }
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        PrintToConsole("Failed to import Omni state snapshot: %s\n", e.what());
+        boost::system::error_code ec;
+        for (const char* folder : OMNI_STATE_FOLDERS) {
+            fs::remove_all(GetOmniDataDir() / folder, ec);
+        }
+        return false;
     }
+
+    PrintToConsole("Imported Omni state snapshot from %s\n", pathSnapshot.string());
+    return true;
+}
+
+/**
+ * Adds the journal and the entries of a database to the background compactions.
+ */
+static void RegisterDBCompaction(CDBBase* pdb, const std::string& name)
+{
+    GetDBCompactionScheduler().Register(pdb, name, {
+        {"journal", [pdb] { pdb->CompactJournal(); }},
+        {"entries", [pdb] { pdb->CompactEntries(); }},
+    });
 }
 
 /**
@@ -1343,7 +1783,7 @@ int mastercore_init()
 {
     AssertLockHeld(cs_main);
 
-    bool wrongDBVersion, startClean = false;
+    bool wrongDBVersion, startClean = false, fStateSnapshot = false;
 
     {
         LOCK(cs_tally);
@@ -1376,22 +1816,10 @@ int mastercore_init()
         if (gArgs.GetBoolArg("-omnistartclean", false)) {
             PrintToLog("Process was started with --omnistartclean option, attempting to clear persistence files..\n");
             try {
-                fs::path persistPath = GetOmniDataDir() / "MP_persist";
-                fs::path txlistPath = GetOmniDataDir() / "MP_txlist";
-                fs::path tradePath = GetOmniDataDir() / "MP_tradelist";
-                fs::path spPath = GetOmniDataDir() / "MP_spinfo";
-                fs::path stoPath = GetOmniDataDir() / "MP_stolist";
-                fs::path omniTXDBPath = GetOmniDataDir() / "Omni_TXDB";
-                fs::path feesPath = GetOmniDataDir() / "OMNI_feecache";
-                fs::path feeHistoryPath = GetOmniDataDir() / "OMNI_feehistory";
-                if (fs::exists(persistPath)) fs::remove_all(persistPath);
-                if (fs::exists(txlistPath)) fs::remove_all(txlistPath);
-                if (fs::exists(tradePath)) fs::remove_all(tradePath);
-                if (fs::exists(spPath)) fs::remove_all(spPath);
-                if (fs::exists(stoPath)) fs::remove_all(stoPath);
-                if (fs::exists(omniTXDBPath)) fs::remove_all(omniTXDBPath);
-                if (fs::exists(feesPath)) fs::remove_all(feesPath);
-                if (fs::exists(feeHistoryPath)) fs::remove_all(feeHistoryPath);
+                for (const char* folder : OMNI_STATE_FOLDERS) {
+                    fs::path path = GetOmniDataDir() / folder;
+                    if (fs::exists(path)) fs::remove_all(path);
+                }
                 PrintToLog("Success clearing persistence files in datadir %s\n", GetOmniDataDir().string());
                 startClean = true;
             } catch (const fs::filesystem_error& e) {
@@ -1400,6 +1828,19 @@ int mastercore_init()
             }
         }
 
+        // import the state of another node, if there is none yet
+        const std::string strStateSnapshot = gArgs.GetArg("-omnistatesnapshot", "");
+        if (!strStateSnapshot.empty()) {
+            if (fReindex) {
+                PrintToLog("Ignoring -omnistatesnapshot, the Omni databases are wiped by -reindex\n");
+            } else if (fs::exists(GetOmniDataDir() / "MP_spinfo")) {
+                PrintToLog("Ignoring -omnistatesnapshot, there is an Omni state already (use -omnistartclean to replace it)\n");
+            } else if (ImportStateSnapshot(strStateSnapshot)) {
+                fStateSnapshot = true;
+                startClean = false;
+            }
+        }
+
         pDbTradeList = new CMPTradeList(GetOmniDataDir() / "MP_tradelist", fReindex);
         pDbStoList = new CMPSTOList(GetOmniDataDir() / "MP_stolist", fReindex);
         pDbTransactionList = new CMPTxList(GetOmniDataDir() / "MP_txlist", fReindex);
@@ -1407,21 +1848,46 @@ int mastercore_init()
         pDbTransaction = new COmniTransactionDB(GetOmniDataDir() / "Omni_TXDB", fReindex);
         pDbFeeCache = new COmniFeeCache(GetOmniDataDir() / "OMNI_feecache", fReindex);
         pDbFeeHistory = new COmniFeeHistory(GetOmniDataDir() / "OMNI_feehistory", fReindex);
+        RegisterDBCompaction(pDbTradeList, "MP_tradelist");
+        RegisterDBCompaction(pDbStoList, "MP_stolist");
+        RegisterDBCompaction(pDbTransactionList, "MP_txlist");
+        RegisterDBCompaction(pDbSpInfo, "MP_spinfo");
+        RegisterDBCompaction(pDbTransaction, "Omni_TXDB");
+        RegisterDBCompaction(pDbFeeCache, "OMNI_feecache");
+        RegisterDBCompaction(pDbFeeHistory, "OMNI_feehistory");
 
         pathStateFiles = GetOmniDataDir() / "MP_persist";
         TryCreateDirectories(pathStateFiles);
 
-        wrongDBVersion = (pDbTransactionList->getDBVersion() != DB_VERSION);
+        int nDBVersion = pDbTransactionList->getDBVersion();
+        if (!startClean && nDBVersion != DB_VERSION && pDbTransactionList->upgradeDBVersion(nDBVersion)) {
+            nDBVersion = DB_VERSION;
+        }
+        wrongDBVersion = (nDBVersion != DB_VERSION);
 
         ++mastercoreInitialized;
     }
 
-    int nWaterline = LoadMostRelevantInMemoryState();
+    // an imported state is only trusted as of a consensus checkpoint
+    int nWaterline = LoadMostRelevantInMemoryState(fStateSnapshot);
 
     if (!startClean && nWaterline > 0 && nWaterline < GetHeight()) {
         RewindDBsAndState(nWaterline + 1, 0, true);
     }
 
+    if (fStateSnapshot) {
+        LOCK(cs_tally);
+        const CBlockIndex* pBlockIndex = nWaterline > 0 ? ::ChainActive()[nWaterline] : nullptr;
+        uint256 checkpointHash;
+        if (pBlockIndex == nullptr || !IsConsensusCheckpoint(nWaterline, pBlockIndex->GetBlockHash(), &checkpointHash) ||
+                GetConsensusHash() != checkpointHash) {
+            PrintToConsole("Omni state snapshot rejected: no state at a consensus checkpoint of the active chain, or its consensus hash does not match\n");
+            nWaterline = -1; // force a clear_all_state and parse from start
+        } else {
+            PrintToConsole("Omni state snapshot verified against the consensus checkpoint at block %d\n", nWaterline);
+        }
+    }
+
     {
         LOCK(cs_tally);
         nWaterlineBlock = nWaterline;
@@ -1488,6 +1954,10 @@ int mastercore_init()
 
     {
         LOCK(cs_tally);
+        // the loaded state belongs to the block before the waterline
+        pLastProcessedBlock = ::ChainActive()[nWaterlineBlock - 1];
+        PublishStateRewind(nWaterlineBlock - 1, pLastProcessedBlock ? pLastProcessedBlock->GetBlockHash() : uint256());
+
         // load feature activation messages from txlistdb and process them accordingly
         pDbTransactionList->LoadActivations(nWaterlineBlock);
 
@@ -1515,6 +1985,8 @@ int mastercore_init()
         int64_t exodus_balance = GetTokenBalance(exodus_address, OMNI_PROPERTY_MSC, BALANCE);
 
         PrintToLog("Exodus balance after initialization: %s\n", FormatDivisibleMP(exodus_balance));
+
+        PublishStateSnapshot();
     }
 
     PrintToConsole("Omni Core initialization completed\n");
@@ -1535,6 +2007,10 @@ int mastercore_shutdown()
     AssertLockHeld(cs_main);
     LOCK(cs_tally);
 
+    for (const CDBBase* pdb : std::initializer_list<const CDBBase*>{pDbTransactionList, pDbTradeList, pDbStoList, pDbSpInfo, pDbTransaction, pDbFeeCache, pDbFeeHistory}) {
+        if (pdb) GetDBCompactionScheduler().Unregister(pdb);
+    }
+
     if (pDbTransactionList) {
         delete pDbTransactionList;
         pDbTransactionList = nullptr;
@@ -1606,6 +2082,9 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
         if (nBlock < nWaterlineBlock) return false;
     }
 
+    // fast path for transactions without marker, before anything is parsed
+    if (!HasOmMarkerOutput(tx)) return false;
+
     int64_t nBlockTime = pBlockIndex->GetBlockTime();
     CMPTransaction mp_obj;
     mp_obj.unlockLogic();
@@ -1649,6 +2128,8 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
             bool bValid = (0 <= interp_ret);
             pDbTransactionList->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount());
             pDbTransaction->RecordTransaction(tx.GetHash(), idx, interp_ret);
+            StateChangesNotifyTransaction({tx.GetHash(), idx, interp_ret, mp_obj.getType(), mp_obj.getProperty(),
+                    static_cast<int64_t>(mp_obj.getAmount()), mp_obj.getSender(), mp_obj.getReceiver()});
         }
         fFoundTx |= (interp_ret == 0);
     }
@@ -1659,6 +2140,7 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
         PrintToLog("Consensus hash for transaction %s: %s\n", tx.GetHash().GetHex(), consensusHash.GetHex());
     }
 
+    TRACE3(omni, handler_tx, nBlock, idx, fFoundTx);
     return fFoundTx;
 }
 
@@ -1676,6 +2158,7 @@ bool mastercore::UseEncodingClassC(size_t nDataSize)
 int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
 {
     AssertLockHeld(cs_main);
+    TRACE1(omni, block_begin_entry, pBlockIndex->nHeight);
 
     bool bRecoveryMode{false};
     {
@@ -1698,8 +2181,13 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
         CheckLiveActivations(pBlockIndex->nHeight);
 
         eraseExpiredCrowdsale(pBlockIndex);
+
+        // trades and STO receipts of the block are written together in mastercore_handler_block_end()
+        if (pDbTradeList) pDbTradeList->BeginBatch();
+        if (pDbStoList) pDbStoList->BeginBatch();
     }
 
+    TRACE1(omni, block_begin_exit, pBlockIndex->nHeight);
     return 0;
 }
 
@@ -1709,6 +2197,7 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int countMP)
 {
     AssertLockHeld(cs_main);
+    TRACE2(omni, block_end_entry, nBlockNow, countMP);
 
     int nMastercoreInit;
     {
@@ -1751,8 +2240,23 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         // check that pending transactions are still in the mempool
         PendingCheck();
 
-        // transactions were found in the block, signal the UI accordingly
-        if (countMP > 0) CheckWalletUpdate(true);
+        // write the trades and STO receipts of the block
+        pDbTradeList->CommitBatch();
+        pDbStoList->CommitBatch();
+
+        // wallet transactions of the block can now be indexed
+        WalletTxIndexSetHeight(nBlockNow);
+        pLastProcessedBlock = pBlockIndex;
+
+        // balances and orders as of this block can now be read without cs_tally
+        PublishStateSnapshot();
+
+        // hand the transactions and balance changes of the block to the state change feed
+        PublishStateChanges(nBlockNow, pBlockIndex->GetBlockHash());
+
+        // transactions were found in the block, signal the UI accordingly - balances are only
+        // recalculated, if addresses touched by the block belong to the wallet
+        if (countMP > 0) CheckWalletUpdate();
 
         // calculate and print a consensus hash if required
         if (ShouldConsensusHashBlock(nBlockNow)) {
@@ -1785,9 +2289,24 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         }
     }
 
+    TRACE2(omni, block_end_exit, nBlockNow, checkpointValid);
     return 0;
 }
 
+/**
+ * Returns the last block processed by Omni Core.
+ *
+ * When blocks are processed asynchronously, this block may be behind the tip
+ * of the active chain, or even no longer part of it.
+ *
+ * @return The block index, or nullptr, if no block was processed yet
+ */
+const CBlockIndex* GetLastProcessedBlock()
+{
+    LOCK(cs_tally);
+    return pLastProcessedBlock;
+}
+
 void mastercore_handler_disc_begin(const int nHeight)
 {
     AssertLockHeld(cs_main);
@@ -1840,7 +2359,5 @@ const CTxDestination ExodusCrowdsaleAddress(int nBlock)
  */
 const std::vector<unsigned char> GetOmMarker()
 {
-    static unsigned char pch[] = {0x6f, 0x6d, 0x6e, 0x69}; // Hex-encoded: "omni"
-
-    return std::vector<unsigned char>(pch, pch + sizeof(pch) / sizeof(pch[0]));
+    return std::vector<unsigned char>(OMNI_MARKER, OMNI_MARKER + sizeof(OMNI_MARKER)); // Hex-encoded: "omni"
 }
@@ -8,6 +8,7 @@ class CTransaction;
 class Coin;
 
 #include <omnicore/log.h>
+#include <omnicore/sto.h>
 #include <omnicore/tally.h>
 
 #include <script/standard.h>
@@ -34,11 +35,16 @@ int const STORE_EVERY_N_BLOCK = 5000;
 // Don't store the state every block on mainnet until block 622000
 // was reached
 int const DONT_STORE_MAINNET_STATE_UNTIL = 0;
+// Number of blocks read ahead of the processed block during the initial scan
+int const SCAN_READ_AHEAD_BLOCKS = 64;
+// Default and maximum number of threads reading blocks during the initial scan
+int const DEFAULT_SCAN_THREADS = 4;
+int const MAX_SCAN_THREADS = 16;
 
 #define TEST_ECO_PROPERTY_1 (0x80000003UL)
 
 // increment this value to force a refresh of the state (similar to --omnistartclean)
-#define DB_VERSION 8
+#define DB_VERSION 11
 
 // could probably also use: int64_t maxInt64 = std::numeric_limits<int64_t>::max();
 // maximum numeric values from the spec:
@@ -158,12 +164,18 @@ int mastercore_init();
 /** Global handler to shut down Omni Core. */
 int mastercore_shutdown();
 
+/** Clears the in-memory state and the databases of Omni Core. */
+void clear_all_state();
+
 /** Block and transaction handlers. */
 void mastercore_handler_disc_begin(const int nHeight);
 int mastercore_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
 bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins);
 
+/** Returns the last block processed by Omni Core. */
+const CBlockIndex* GetLastProcessedBlock();
+
 /** Scans for marker and if one is found, add transaction to marker cache. */
 void TryToAddToMarkerCache(const CTransactionRef& tx);
 /** Removes transaction from marker cache. */
@@ -182,6 +194,19 @@ namespace mastercore
 //! In-memory collection of all amounts for all addresses for all properties
 extern std::unordered_map<std::string, CMPTally> mp_tally_map GUARDED_BY(cs_tally);
 
+//! Holders of a property, sorted by the amount they own, and the total amount they own
+struct CMPHolders
+{
+    int64_t total = 0;
+    OwnerAddrType owners;
+};
+
+//! Index of the holders of all properties, maintained by update_tally_map()
+extern std::unordered_map<uint32_t, CMPHolders> mp_holders_map GUARDED_BY(cs_tally);
+
+/** Rebuilds the index of holders from the tally map. */
+void RebuildHolders();
+
 /** Returns the encoding class, used to embed a payload. */
 int GetEncodingClass(const CTransaction& tx, int nBlock);
 
@@ -194,6 +219,8 @@ uint32_t GetNextPropertyId(bool maineco); // maybe move into sp
 
 CMPTally* getTally(const std::string& address);
 bool update_tally_map(const std::string& who, uint32_t propertyId, int64_t amount, TallyType ttype);
+/** Credits the balances of many receivers of a property at once, e.g. all receivers of a fee distribution. */
+void credit_tally_map(const OwnerAddrType& receivers, uint32_t propertyId);
 int64_t getTotalTokens(uint32_t propertyId, int64_t* n_owners_total = nullptr);
 
 std::string strMPProperty(uint32_t propertyId);
@@ -208,6 +235,8 @@ std::string getTokenLabel(uint32_t propertyId);
 void freezeAddress(const std::string& address, uint32_t propertyId);
 /** Removes an address and property from the frozenMap **/
 void unfreezeAddress(const std::string& address, uint32_t propertyId);
+/** Returns all frozen addresses and properties **/
+std::set<std::pair<std::string,uint32_t> > getFrozenAddresses();
 /** Checks whether an address and property are frozen **/
 bool isAddressFrozen(const std::string& address, uint32_t propertyId);
 /** Adds a property to the freezingEnabledMap **/
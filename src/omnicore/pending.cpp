@@ -1,6 +1,7 @@
 #include <omnicore/pending.h>
 
 #include <omnicore/log.h>
+#include <omnicore/snapshot.h>
 #include <omnicore/sp.h>
 
 #include <amount.h>
@@ -47,6 +48,7 @@ void PendingAdd(const uint256& txid, const std::string& sendingAddress, uint16_t
     }
     // after adding a transaction to pending the available balance may now be reduced, refresh wallet totals
     CheckWalletUpdate(true); // force an update since some outbound pending (eg MetaDEx cancel) may not change balances
+    PublishStateSnapshot(); // balances are also served from the snapshot
     uiInterface.OmniPendingChanged(true);
 }
 
@@ -80,18 +82,16 @@ void PendingDelete(const uint256& txid)
  */
 void PendingCheck()
 {
-    //! mempool.queryHashes() require mempool.cs
+    //! The pool has to stay unchanged while it is checked
     AssertLockHeld(mempool.cs);
 
     LOCK(cs_pending);
 
-    std::vector<uint256> vecMemPoolTxids;
     std::vector<uint256> txidsForDeletion;
-    mempool.queryHashes(vecMemPoolTxids);
 
     for (PendingMap::iterator it = my_pending.begin(); it != my_pending.end(); ++it) {
         const uint256& txid = it->first;
-        if (std::find(vecMemPoolTxids.begin(), vecMemPoolTxids.end(), txid) == vecMemPoolTxids.end()) {
+        if (!mempool.exists(txid)) {
             PrintToLog("WARNING: Pending transaction %s is no longer in this nodes mempool and will be discarded\n", txid.GetHex());
             txidsForDeletion.push_back(txid);
         }
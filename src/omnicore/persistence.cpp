@@ -10,12 +10,19 @@
 #include <omnicore/log.h>
 #include <omnicore/mdex.h>
 #include <omnicore/rules.h>
+#include <omnicore/snapshot.h>
 #include <omnicore/sp.h>
 #include <omnicore/tally.h>
 #include <omnicore/utilsbitcoin.h>
+#include <omnicore/walletcache.h>
 
 #include <chain.h>
+#include <clientversion.h>
+#include <crypto/common.h>
 #include <fs.h>
+#include <hash.h>
+#include <serialize.h>
+#include <streams.h>
 #include <validation.h>
 #include <tinyformat.h>
 #include <uint256.h>
@@ -74,48 +81,130 @@ static bool is_state_prefix(std::string const &str)
     return false;
 }
 
-static int write_msc_balances(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    std::unordered_map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
-        bool emptyWallet = true;
+/**
+ * Balances are stored in a binary snapshot, which starts with a magic and a
+ * version, followed by the serialized tallies and a checksum of all bytes
+ * before it:
+ *
+ *   magic | version | count | (address | count | (propertyid | balances)*)* | checksum
+ *
+ * Snapshots in the former text format are still loaded.
+ */
+static const uint32_t BALANCES_SNAPSHOT_MAGIC = 0x4f4d4e42; // "OMNB"
+static const int32_t BALANCES_SNAPSHOT_VERSION = 1;
 
-        std::string lineOut = (*iter).first;
-        lineOut.append("=");
-        CMPTally& curAddr = (*iter).second;
+static int write_msc_balances_snapshot(const std::string& strFile)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << BALANCES_SNAPSHOT_MAGIC << BALANCES_SNAPSHOT_VERSION;
+
+    // entries of empty tallies are not counted upfront, but filtered while writing
+    std::vector<std::pair<const std::unordered_map<std::string, CMPTally>::value_type*, std::vector<uint32_t> > > vecTallies;
+    vecTallies.reserve(mp_tally_map.size());
+    for (std::unordered_map<std::string, CMPTally>::iterator iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
+        CMPTally& curAddr = iter->second;
+        std::vector<uint32_t> vecProperties;
         curAddr.init();
         uint32_t propertyId = 0;
         while (0 != (propertyId = curAddr.next())) {
-            int64_t balance = (*iter).second.getMoney(propertyId, BALANCE);
-            int64_t sellReserved = (*iter).second.getMoney(propertyId, SELLOFFER_RESERVE);
-            int64_t acceptReserved = (*iter).second.getMoney(propertyId, ACCEPT_RESERVE);
-            int64_t metadexReserved = (*iter).second.getMoney(propertyId, METADEX_RESERVE);
-
             // we don't allow 0 balances to read in, so if we don't write them
             // it makes things match up better between persisted state and processed state
-            if (0 == balance && 0 == sellReserved && 0 == acceptReserved && 0 == metadexReserved) {
+            if (0 == curAddr.getMoney(propertyId, BALANCE) && 0 == curAddr.getMoney(propertyId, SELLOFFER_RESERVE) &&
+                    0 == curAddr.getMoney(propertyId, ACCEPT_RESERVE) && 0 == curAddr.getMoney(propertyId, METADEX_RESERVE)) {
                 continue;
             }
+            vecProperties.push_back(propertyId);
+        }
+        if (!vecProperties.empty()) {
+            vecTallies.emplace_back(&(*iter), std::move(vecProperties));
+        }
+    }
+
+    WriteCompactSize(ss, vecTallies.size());
+    for (const auto& entry : vecTallies) {
+        const CMPTally& curAddr = entry.first->second;
+        ss << entry.first->first;
+        WriteCompactSize(ss, entry.second.size());
+        for (uint32_t propertyId : entry.second) {
+            ss << propertyId;
+            ss << curAddr.getMoney(propertyId, BALANCE);
+            ss << curAddr.getMoney(propertyId, SELLOFFER_RESERVE);
+            ss << curAddr.getMoney(propertyId, ACCEPT_RESERVE);
+            ss << curAddr.getMoney(propertyId, METADEX_RESERVE);
+        }
+    }
+
+    ss << Hash(ss.begin(), ss.end());
+
+    CAutoFile file(fsbridge::fopen(strFile, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        PrintToLog("%s(): failed to open %s\n", __func__, strFile);
+        return -1;
+    }
+    file.write(ss.data(), ss.size());
+
+    return 0;
+}
+
+/**
+ * Loads balances from a binary snapshot.
+ *
+ * @return 0 on success, -1 on failure, and 1, if the file is no binary snapshot
+ */
+static int input_msc_balances_snapshot(const std::string& filename, bool verifyHash, int& entries)
+{
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    if (!file.is_open()) return -1;
+    std::vector<char> vch((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
 
-            emptyWallet = false;
+    if (vch.size() < sizeof(BALANCES_SNAPSHOT_MAGIC) + sizeof(BALANCES_SNAPSHOT_VERSION) + sizeof(uint256)) return 1;
+    if (ReadLE32((const unsigned char*)vch.data()) != BALANCES_SNAPSHOT_MAGIC) return 1;
 
-            lineOut.append(strprintf("%d:%d,%d,%d,%d;",
-                    propertyId,
-                    balance,
-                    sellReserved,
-                    acceptReserved,
-                    metadexReserved));
+    if (verifyHash) {
+        const char* pbegin = vch.data();
+        const char* pend = pbegin + vch.size() - sizeof(uint256);
+        if (memcmp(Hash(pbegin, pend).begin(), pend, sizeof(uint256)) != 0) {
+            PrintToLog("File %s loaded, but failed hash validation!\n", filename);
+            return -1;
         }
+    }
 
-        if (false == emptyWallet) {
-            // add the line to the hash
-            SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
+    CDataStream ss(std::move(vch), SER_DISK, CLIENT_VERSION);
+    try {
+        uint32_t magic;
+        int32_t version;
+        ss >> magic >> version;
+        if (version != BALANCES_SNAPSHOT_VERSION) {
+            PrintToLog("%s(): unsupported snapshot version %d of %s\n", __func__, version, filename);
+            return -1;
+        }
 
-            // write the line
-            file << lineOut << std::endl;
+        uint64_t nTallies = ReadCompactSize(ss);
+        mp_tally_map.reserve(nTallies);
+        for (uint64_t n = 0; n < nTallies; ++n) {
+            std::string strAddress;
+            ss >> strAddress;
+            CMPTally& tally = mp_tally_map[strAddress];
+            uint64_t nProperties = ReadCompactSize(ss);
+            for (uint64_t i = 0; i < nProperties; ++i) {
+                uint32_t propertyId;
+                int64_t balance, sellReserved, acceptReserved, metadexReserved;
+                ss >> propertyId >> balance >> sellReserved >> acceptReserved >> metadexReserved;
+                if (balance) tally.updateMoney(propertyId, balance, BALANCE);
+                if (sellReserved) tally.updateMoney(propertyId, sellReserved, SELLOFFER_RESERVE);
+                if (acceptReserved) tally.updateMoney(propertyId, acceptReserved, ACCEPT_RESERVE);
+                if (metadexReserved) tally.updateMoney(propertyId, metadexReserved, METADEX_RESERVE);
+            }
+            ++entries;
         }
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): failed to deserialize %s: %s\n", __func__, filename, e.what());
+        return -1;
     }
 
+    RebuildHolders();
+
     return 0;
 }
 
@@ -296,9 +385,8 @@ static int input_mp_accepts_string(const std::string& s)
     btcDesired = boost::lexical_cast<int64_t>(vstr[i++]);
     txidStr = vstr[i++];
 
-    const std::string combo = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(sellerAddr, buyerAddr, prop);
     CMPAccept newAccept(amountOriginal, amountRemaining, nBlock, blocktimelimit, prop, offerOriginal, btcDesired, uint256S(txidStr));
-    if (my_accepts.insert(std::make_pair(combo, newAccept)).second) {
+    if (DEx_acceptInsert(sellerAddr, prop, buyerAddr, newAccept)) {
         return 0;
     } else {
         return -1;
@@ -364,7 +452,7 @@ static int input_mp_crowdsale_string(const std::string& s)
         newCrowdsale.insertDatabase(txHash, vals);
     }
 
-    if (!my_crowds.insert(std::make_pair(sellerAddr, newCrowdsale)).second) {
+    if (!insertCrowdsale(sellerAddr, newCrowdsale)) {
         return -1;
     }
 
@@ -405,6 +493,10 @@ static int write_state_file(const CBlockIndex* pBlockIndex, int what)
     fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
     const std::string strFile = path.string();
 
+    if (what == FILETYPE_BALANCES) {
+        return write_msc_balances_snapshot(strFile);
+    }
+
     std::ofstream file;
     file.open(strFile.c_str());
 
@@ -414,10 +506,6 @@ static int write_state_file(const CBlockIndex* pBlockIndex, int what)
     int result = 0;
 
     switch (what) {
-        case FILETYPE_BALANCES:
-            result = write_msc_balances(file, &shaCtx);
-            break;
-
         case FILETYPE_OFFERS:
             result = write_mp_offers(file, &shaCtx);
             break;
@@ -575,6 +663,9 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
     switch (what) {
         case FILETYPE_BALANCES:
             mp_tally_map.clear();
+            mp_holders_map.clear();
+            WalletCacheInvalidate();
+            SnapshotInvalidate();
             inputLineFunc = input_msc_balances_string;
             break;
 
@@ -584,7 +675,7 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
             break;
 
         case FILETYPE_ACCEPTS:
-            my_accepts.clear();
+            DEx_acceptsClear();
             inputLineFunc = input_mp_accepts_string;
             break;
 
@@ -593,7 +684,7 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
             break;
 
         case FILETYPE_CROWDSALES:
-            my_crowds.clear();
+            clearCrowdsales();
             inputLineFunc = input_mp_crowdsale_string;
             break;
 
@@ -602,7 +693,7 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
             // memory leak ... gotta unallocate inner layers first....
             // TODO
             // ...
-            metadex.clear();
+            MetaDEx_CLEAR();
             inputLineFunc = input_mp_mdexorder_string;
             break;
 
@@ -622,6 +713,18 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
         return -1;
     }
 
+    if (what == FILETYPE_BALANCES) {
+        file.close();
+        int res = input_msc_balances_snapshot(filename, verifyHash, lines);
+        if (res <= 0) {
+            PrintToLog("%s(%s), loaded entries= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+            LogPrintf("%s(): file: %s , loaded entries= %d, res= %d\n", __FUNCTION__, filename, lines, res);
+            return res;
+        }
+        // no binary snapshot, load the text format
+        file.open(filename.c_str());
+    }
+
     int res = 0;
 
     std::string fileHash;
@@ -676,9 +779,9 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
 }
 
 /**
- * Loads and restores the latest state. Returns -1 if reparse is required.
+ * Loads and restores the latest state, or the latest one at a consensus checkpoint. Returns -1 if reparse is required.
  */
-int LoadMostRelevantInMemoryState()
+int LoadMostRelevantInMemoryState(bool fCheckpointOnly)
 {
     int res = -1;
     uint256 spWatermark;
@@ -741,6 +844,9 @@ int LoadMostRelevantInMemoryState()
                 if (pBlockIndex == nullptr || false == ::ChainActive().Contains(pBlockIndex)) {
                     continue;
                 }
+                if (fCheckpointOnly && !IsConsensusCheckpoint(pBlockIndex->nHeight, blockHash)) {
+                    continue;
+                }
 
                 // this is a valid block in the active chain, store it
                 persistedBlocks.insert(blockHash);
@@ -14,8 +14,8 @@ int PersistInMemoryState(const CBlockIndex* pBlockIndex);
 /** Loads and retrieves state from a file. */
 int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash = false);
 
-/** Loads and restores the latest state. Returns -1 if reparse is required. */
-int LoadMostRelevantInMemoryState();
+/** Loads and restores the latest state, or the latest one at a consensus checkpoint. Returns -1 if reparse is required. */
+int LoadMostRelevantInMemoryState(bool fCheckpointOnly = false);
 
 
 #endif // BITCOIN_OMNICORE_PERSISTENCE_H
@@ -25,6 +25,7 @@
 #include <omnicore/rpctxobject.h>
 #include <omnicore/rpcvalues.h>
 #include <omnicore/rules.h>
+#include <omnicore/snapshot.h>
 #include <omnicore/sp.h>
 #include <omnicore/sto.h>
 #include <omnicore/tally.h>
@@ -166,6 +167,26 @@ bool BalanceToJSON(const std::string& address, uint32_t property, UniValue& bala
     return (nAvailable || nReserved || nFrozen);
 }
 
+/** Like BalanceToJSON(), but the balances are retrieved from a state snapshot. */
+static bool BalanceToJSON(const CMPStateSnapshot& snapshot, const std::string& address, uint32_t property, UniValue& balance_obj, bool divisible)
+{
+    int64_t nAvailable = snapshot.GetAvailableTokenBalance(address, property);
+    int64_t nReserved = snapshot.GetReservedTokenBalance(address, property);
+    int64_t nFrozen = snapshot.GetFrozenTokenBalance(address, property);
+
+    if (divisible) {
+        balance_obj.pushKV("balance", FormatDivisibleMP(nAvailable));
+        balance_obj.pushKV("reserved", FormatDivisibleMP(nReserved));
+        balance_obj.pushKV("frozen", FormatDivisibleMP(nFrozen));
+    } else {
+        balance_obj.pushKV("balance", FormatIndivisibleMP(nAvailable));
+        balance_obj.pushKV("reserved", FormatIndivisibleMP(nReserved));
+        balance_obj.pushKV("frozen", FormatIndivisibleMP(nFrozen));
+    }
+
+    return (nAvailable || nReserved || nFrozen);
+}
+
 // Obtains details of a fee distribution
 static UniValue omni_getfeedistribution(const JSONRPCRequest& request)
 {
@@ -412,32 +433,40 @@ static UniValue omni_getfeeshare(const JSONRPCRequest& request)
     UniValue response(UniValue::VARR);
     bool addObj = false;
 
-    OwnerAddrType receiversSet;
-    if (ecosystem == 1) {
-        receiversSet = STO_GetReceivers("FEEDISTRIBUTION", OMNI_PROPERTY_MSC, COIN);
-    } else {
-        receiversSet = STO_GetReceivers("FEEDISTRIBUTION", OMNI_PROPERTY_TMSC, COIN);
+    const uint32_t propertyId = (ecosystem == 1) ? OMNI_PROPERTY_MSC : OMNI_PROPERTY_TMSC;
+
+    auto pushFeeShare = [&response](const std::string& receiver, int64_t amount) {
+        UniValue feeShareObj(UniValue::VOBJ);
+        // NOTE: using float here as this is a display value only which isn't an exact percentage and
+        //       changes block to block (due to dev Omni) so high precision not required(?)
+        double feeShare = (double(amount) / double(COIN)) * (double)100;
+        std::string strFeeShare = strprintf("%.4f", feeShare);
+        strFeeShare += "%";
+        feeShareObj.pushKV("address", receiver);
+        feeShareObj.pushKV("feeshare", strFeeShare);
+        response.push_back(feeShareObj);
+    };
+
+    // A single address only needs the holders up to its own position
+    if (!address.empty() && address != "*") {
+        int64_t amount = STO_GetReceiverAmount("FEEDISTRIBUTION", propertyId, COIN, address);
+        if (amount > 0) pushFeeShare(address, amount);
+        return response;
     }
 
+    OwnerAddrType receiversSet = STO_GetReceivers("FEEDISTRIBUTION", propertyId, COIN);
+
     for (OwnerAddrType::reverse_iterator it = receiversSet.rbegin(); it != receiversSet.rend(); ++it) {
         addObj = false;
         if (address.empty()) {
             if (IsMyAddress(it->second, pWallet.get())) {
                 addObj = true;
             }
-        } else if (address == it->second || address == "*") {
+        } else if (address == "*") {
             addObj = true;
         }
         if (addObj) {
-            UniValue feeShareObj(UniValue::VOBJ);
-            // NOTE: using float here as this is a display value only which isn't an exact percentage and
-            //       changes block to block (due to dev Omni) so high precision not required(?)
-            double feeShare = (double(it->first) / double(COIN)) * (double)100;
-            std::string strFeeShare = strprintf("%.4f", feeShare);
-            strFeeShare += "%";
-            feeShareObj.pushKV("address", it->second);
-            feeShareObj.pushKV("feeshare", strFeeShare);
-            response.push_back(feeShareObj);
+            pushFeeShare(it->second, it->first);
         }
     }
 
@@ -835,7 +864,12 @@ static UniValue omni_getbalance(const JSONRPCRequest& request)
     RequireExistingProperty(propertyId);
 
     UniValue balanceObj(UniValue::VOBJ);
-    BalanceToJSON(address, propertyId, balanceObj, isPropertyDivisible(propertyId));
+    std::shared_ptr<const CMPStateSnapshot> snapshot = GetStateSnapshot();
+    if (snapshot) {
+        BalanceToJSON(*snapshot, address, propertyId, balanceObj, isPropertyDivisible(propertyId));
+    } else {
+        BalanceToJSON(address, propertyId, balanceObj, isPropertyDivisible(propertyId));
+    }
 
     return balanceObj;
 }
@@ -873,22 +907,36 @@ static UniValue omni_getallbalancesforid(const JSONRPCRequest& request)
     UniValue response(UniValue::VARR);
     bool isDivisible = isPropertyDivisible(propertyId); // we want to check this BEFORE the loop
 
-    LOCK(cs_tally);
-
-    for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-        uint32_t id = 0;
-        bool includeAddress = false;
-        std::string address = it->first;
-        (it->second).init();
-        while (0 != (id = (it->second).next())) {
-            if (id == propertyId) {
-                includeAddress = true;
-                break;
+    std::shared_ptr<const CMPStateSnapshot> snapshot = GetStateSnapshot();
+    if (snapshot) {
+        // collect the holders from the snapshot, in the order of the index of holders
+        OwnerAddrType owners;
+        for (const auto& shard : snapshot->tallies) {
+            for (const auto& entry : *shard) {
+                const CMPTally& tally = *entry.second;
+                int64_t tokens = tally.getMoney(propertyId, BALANCE) + tally.getMoneyReserved(propertyId);
+                if (0 < tokens) owners.insert(std::make_pair(tokens, entry.first));
             }
         }
-        if (!includeAddress) {
-            continue; // ignore this address, has never transacted in this propertyId
+        for (OwnerAddrType::const_iterator it = owners.begin(); it != owners.end(); ++it) {
+            const std::string& address = it->second;
+            UniValue balanceObj(UniValue::VOBJ);
+            balanceObj.pushKV("address", address);
+            if (BalanceToJSON(*snapshot, address, propertyId, balanceObj, isDivisible)) {
+                response.push_back(balanceObj);
+            }
         }
+        return response;
+    }
+
+    LOCK(cs_tally);
+
+    // only addresses, which own tokens of the property, can have a non-empty balance
+    std::unordered_map<uint32_t, CMPHolders>::const_iterator holdersIt = mp_holders_map.find(propertyId);
+    if (holdersIt == mp_holders_map.end()) return response;
+
+    for (OwnerAddrType::const_iterator it = holdersIt->second.owners.begin(); it != holdersIt->second.owners.end(); ++it) {
+        const std::string& address = it->second;
         UniValue balanceObj(UniValue::VOBJ);
         balanceObj.pushKV("address", address);
         bool nonEmptyBalance = BalanceToJSON(address, propertyId, balanceObj, isDivisible);
@@ -1691,7 +1739,19 @@ static UniValue omni_getorderbook(const JSONRPCRequest& request)
     }
 
     std::vector<CMPMetaDEx> vecMetaDexObjects;
-    {
+    std::shared_ptr<const CMPStateSnapshot> snapshot = GetStateSnapshot();
+    if (snapshot) {
+        const md_PricesMap* prices = snapshot->GetPrices(propertyIdForSale);
+        if (prices) {
+            for (md_PricesMap::const_iterator it = prices->begin(); it != prices->end(); ++it) {
+                const md_Set& indexes = it->second;
+                for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+                    const CMPMetaDEx& obj = *it;
+                    if (!filterDesired || obj.getDesProperty() == propertyIdDesired) vecMetaDexObjects.push_back(obj);
+                }
+            }
+        }
+    } else {
         LOCK(cs_tally);
         for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
             const md_PricesMap& prices = my_it->second;
@@ -1711,6 +1771,163 @@ static UniValue omni_getorderbook(const JSONRPCRequest& request)
     return response;
 }
 
+/** Converts a price level of a pair, the unit price is adjusted for display like CMPMetaDEx::displayFullUnitPrice(). */
+static UniValue PriceLevelToJSON(const CMPPriceLevel& level, uint32_t propertyIdForSale, uint32_t propertyIdDesired)
+{
+    bool forSaleIsDivisible = isPropertyDivisible(propertyIdForSale);
+    bool desiredIsDivisible = isPropertyDivisible(propertyIdDesired);
+
+    rational_t unitPrice = level.unitPrice;
+    if (forSaleIsDivisible && !desiredIsDivisible) unitPrice = unitPrice * COIN;
+    if (!forSaleIsDivisible && desiredIsDivisible) unitPrice = unitPrice / COIN;
+
+    UniValue levelObj(UniValue::VOBJ);
+    levelObj.pushKV("unitprice", xToString(unitPrice));
+    levelObj.pushKV("amountremaining", FormatMP(propertyIdForSale, level.amountRemaining));
+    levelObj.pushKV("amounttofill", FormatMP(propertyIdDesired, level.amountToFill));
+    levelObj.pushKV("orders", (uint64_t) level.nOrders);
+    return levelObj;
+}
+
+static UniValue omni_getorderbooklevels(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
+        throw runtime_error(
+            RPCHelpMan{"omni_getorderbooklevels",
+               "\nList the best price levels of the active offers of a pair on the distributed token exchange.\n"
+               "\nThe offers at the same unit price are aggregated. Use omni_getorderbookdeltas with the returned sequence to follow the changes.\n",
+               {
+                   {"propertyid", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the tokens for sale\n"},
+                   {"propertyiddesired", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the tokens desired\n"},
+                   {"depth", RPCArg::Type::NUM, /* default */ "10", "the maximum number of price levels to list, 0 for all\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"block\" : nnnnnn,                          (number) the index of the last processed block\n"
+                   "  \"sequence\" : n,                            (number) the sequence number of the last order book change included\n"
+                   "  \"levels\" : [                               (array of JSON objects) the price levels, lowest unit price first\n"
+                   "    {\n"
+                   "      \"unitprice\" : \"n.nnnnnnnnnnn...\",        (string) the unit price (shown in the property desired)\n"
+                   "      \"amountremaining\" : \"n.nnnnnnnn\",        (string) the amount of tokens still up for sale at this price\n"
+                   "      \"amounttofill\" : \"n.nnnnnnnn\",           (string) the amount of tokens still needed to fill the offers at this price\n"
+                   "      \"orders\" : n                              (number) the number of offers at this price\n"
+                   "    },\n"
+                   "    ...\n"
+                   "  ]\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_getorderbooklevels", "2 1 5")
+                   + HelpExampleRpc("omni_getorderbooklevels", "2, 1, 5")
+               }
+            }.ToString());
+
+    uint32_t propertyIdForSale = ParsePropertyId(request.params[0]);
+    uint32_t propertyIdDesired = ParsePropertyId(request.params[1]);
+    int64_t depth = (request.params.size() > 2) ? request.params[2].get_int64() : 10;
+
+    RequireExistingProperty(propertyIdForSale);
+    RequireExistingProperty(propertyIdDesired);
+    RequireSameEcosystem(propertyIdForSale, propertyIdDesired);
+    RequireDifferentIds(propertyIdForSale, propertyIdDesired);
+    if (depth < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Depth must not be negative");
+    }
+
+    std::shared_ptr<const CMPStateSnapshot> snapshot = GetStateSnapshot();
+    if (!snapshot) {
+        throw JSONRPCError(RPC_IN_WARMUP, "The order book is not available yet");
+    }
+
+    UniValue levelsArr(UniValue::VARR);
+    const std::vector<CMPPriceLevel>* levels = snapshot->GetPriceLevels(propertyIdForSale, propertyIdDesired);
+    if (levels) {
+        size_t nLevels = (depth == 0) ? levels->size() : std::min(levels->size(), (size_t) depth);
+        for (size_t i = 0; i < nLevels; ++i) {
+            levelsArr.push_back(PriceLevelToJSON((*levels)[i], propertyIdForSale, propertyIdDesired));
+        }
+    }
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("block", snapshot->nBlock);
+    response.pushKV("sequence", snapshot->nOrderBookSequence);
+    response.pushKV("levels", levelsArr);
+    return response;
+}
+
+static UniValue omni_getorderbookdeltas(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 3)
+        throw runtime_error(
+            RPCHelpMan{"omni_getorderbookdeltas",
+               "\nList the changes of the price levels of a pair on the distributed token exchange after a sequence number.\n"
+               "\nThe changes are published after each processed block. Each one replaces the price level at its unit price, a level without orders was removed.\n",
+               {
+                   {"propertyid", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the tokens for sale\n"},
+                   {"propertyiddesired", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the tokens desired\n"},
+                   {"sequence", RPCArg::Type::NUM, RPCArg::Optional::NO, "the sequence number of the last change known, as returned by omni_getorderbooklevels or this call\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"block\" : nnnnnn,                          (number) the index of the last processed block\n"
+                   "  \"sequence\" : n,                            (number) the sequence number of the last order book change included\n"
+                   "  \"deltas\" : [                               (array of JSON objects) the changes, oldest first\n"
+                   "    {\n"
+                   "      \"sequence\" : n,                          (number) the sequence number of the change\n"
+                   "      \"block\" : nnnnnn,                        (number) the index of the block, after which the change was published\n"
+                   "      \"unitprice\" : \"n.nnnnnnnnnnn...\",        (string) the unit price (shown in the property desired)\n"
+                   "      \"amountremaining\" : \"n.nnnnnnnn\",        (string) the amount of tokens still up for sale at this price\n"
+                   "      \"amounttofill\" : \"n.nnnnnnnn\",           (string) the amount of tokens still needed to fill the offers at this price\n"
+                   "      \"orders\" : n                              (number) the number of offers at this price, 0 if the level was removed\n"
+                   "    },\n"
+                   "    ...\n"
+                   "  ]\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_getorderbookdeltas", "2 1 1200")
+                   + HelpExampleRpc("omni_getorderbookdeltas", "2, 1, 1200")
+               }
+            }.ToString());
+
+    uint32_t propertyIdForSale = ParsePropertyId(request.params[0]);
+    uint32_t propertyIdDesired = ParsePropertyId(request.params[1]);
+    int64_t sequence = request.params[2].get_int64();
+
+    RequireExistingProperty(propertyIdForSale);
+    RequireExistingProperty(propertyIdDesired);
+    RequireSameEcosystem(propertyIdForSale, propertyIdDesired);
+    RequireDifferentIds(propertyIdForSale, propertyIdDesired);
+    if (sequence < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Sequence must not be negative");
+    }
+
+    std::shared_ptr<const CMPStateSnapshot> snapshot = GetStateSnapshot();
+    if (!snapshot) {
+        throw JSONRPCError(RPC_IN_WARMUP, "The order book is not available yet");
+    }
+
+    std::vector<CMPOrderBookDelta> deltas;
+    if (!GetOrderBookDeltas(propertyIdForSale, propertyIdDesired, sequence, snapshot->nOrderBookSequence, deltas)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "The changes after this sequence are no longer available, load the price levels again");
+    }
+
+    UniValue deltasArr(UniValue::VARR);
+    for (const CMPOrderBookDelta& delta : deltas) {
+        UniValue deltaObj(UniValue::VOBJ);
+        deltaObj.pushKV("sequence", delta.nSequence);
+        deltaObj.pushKV("block", delta.nBlock);
+        deltaObj.pushKVs(PriceLevelToJSON(delta.level, propertyIdForSale, propertyIdDesired));
+        deltasArr.push_back(deltaObj);
+    }
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("block", snapshot->nBlock);
+    response.pushKV("sequence", snapshot->nOrderBookSequence);
+    response.pushKV("deltas", deltasArr);
+    return response;
+}
+
 static UniValue omni_gettradehistoryforaddress(const JSONRPCRequest& request)
 {
 #ifdef ENABLE_WALLET
@@ -2289,6 +2506,7 @@ static UniValue omni_getinfo(const JSONRPCRequest& request)
                    "  \"bitcoincoreversion\" : \"x.x.x\",        (string) Qitcoin Core version\n"
                    "  \"block\" : nnnnnn,                      (number) index of the last processed block\n"
                    "  \"blocktime\" : nnnnnnnnnn,              (number) timestamp of the last processed block\n"
+                   "  \"blocksbehind\" : nnnn,                 (number) blocks of the active chain, which are not yet processed\n"
                    "  \"blocktransactions\" : nnnn,            (number) Omni transactions found in the last processed block\n"
                    "  \"totaltransactions\" : nnnnnnnn,        (number) Omni transactions processed in total\n"
                    "  \"alerts\" : [                           (array of JSON objects) active protocol alert (if any)\n"
@@ -2316,9 +2534,16 @@ static UniValue omni_getinfo(const JSONRPCRequest& request)
     infoResponse.pushKV("mastercoreversion", OmniCoreVersion());
     infoResponse.pushKV("bitcoincoreversion", BitcoinCoreVersion());
 
-    // provide the current block details
-    int block = GetHeight();
-    int64_t blockTime = GetLatestBlockTime();
+    // provide the details of the last processed block, which is behind the tip, when processing asynchronously
+    const CBlockIndex* pLastBlock = GetLastProcessedBlock();
+    int block = pLastBlock ? pLastBlock->nHeight : GetHeight();
+    int64_t blockTime = pLastBlock ? pLastBlock->GetBlockTime() : GetLatestBlockTime();
+    int blocksBehind = 0;
+    if (pLastBlock) {
+        LOCK(cs_main);
+        const CBlockIndex* pFork = ::ChainActive().FindFork(pLastBlock);
+        blocksBehind = ::ChainActive().Height() - (pFork ? pFork->nHeight : -1);
+    }
 
     LOCK(cs_tally);
 
@@ -2327,6 +2552,7 @@ static UniValue omni_getinfo(const JSONRPCRequest& request)
     int totalMPTrades = pDbTradeList->getMPTradeCountTotal();
     infoResponse.pushKV("block", block);
     infoResponse.pushKV("blocktime", blockTime);
+    infoResponse.pushKV("blocksbehind", blocksBehind);
     infoResponse.pushKV("blocktransactions", blockMPTransactions);
 
     // provide the number of trades completed
@@ -2694,6 +2920,8 @@ static const CRPCCommand commands[] =
     { "omni layer (data retrieval)", "omni_getactivedexsells",         &omni_getactivedexsells,          {"address"} },
     { "omni layer (data retrieval)", "omni_getactivecrowdsales",       &omni_getactivecrowdsales,        {} },
     { "omni layer (data retrieval)", "omni_getorderbook",              &omni_getorderbook,               {"propertyid", "propertyid"} },
+    { "omni layer (data retrieval)", "omni_getorderbooklevels",        &omni_getorderbooklevels,         {"propertyid", "propertyiddesired", "depth"} },
+    { "omni layer (data retrieval)", "omni_getorderbookdeltas",        &omni_getorderbookdeltas,         {"propertyid", "propertyiddesired", "sequence"} },
     { "omni layer (data retrieval)", "omni_gettrade",                  &omni_gettrade,                   {"txid"} },
     { "omni layer (data retrieval)", "omni_getsto",                    &omni_getsto,                     {"txid", "recipientfilter"} },
     { "omni layer (data retrieval)", "omni_listblocktransactions",     &omni_listblocktransactions,      {"index"} },
@@ -240,6 +240,112 @@ static UniValue omni_send(const JSONRPCRequest& request)
     }
 }
 
+static UniValue omni_sendmany(const JSONRPCRequest& request)
+{
+    std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
+    std::unique_ptr<interfaces::Wallet> pwallet = interfaces::MakeWallet(wallet);
+
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 4)
+        throw runtime_error(
+            RPCHelpMan{"omni_sendmany",
+               "\nCreate and broadcast a simple send transaction for each of the given receivers.\n"
+               "\nThe transactions are funded from the coins of the sender, which are collected once for all of them.\n",
+               {
+                   {"fromaddress", RPCArg::Type::STR, RPCArg::Optional::NO, "the address to send from\n"},
+                   {"sends", RPCArg::Type::ARR, RPCArg::Optional::NO, "the simple sends to create",
+                       {
+                           {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                               {
+                                   {"toaddress", RPCArg::Type::STR, RPCArg::Optional::NO, "the address of the receiver"},
+                                   {"propertyid", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the tokens to send"},
+                                   {"amount", RPCArg::Type::STR, RPCArg::Optional::NO, "the amount to send"},
+                               },
+                           },
+                       },
+                   },
+                   {"redeemaddress", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "an address that can spend the transaction dust (sender by default)\n"},
+                   {"referenceamount", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "a bitcoin amount that is sent to each receiver (minimal by default)\n"},
+               },
+               RPCResult{
+                   "[                         (array of json objects) one entry per send, in the given order\n"
+                   "  {\n"
+                   "    \"toaddress\" : \"address\", (string) the address of the receiver\n"
+                   "    \"txid\" : \"hash\",         (string) the hex-encoded transaction hash, if the transaction was sent\n"
+                   "    \"error\" : \"message\",     (string) the reason, if the transaction was not sent\n"
+                   "  }\n"
+                   "  ...\n"
+                   "]\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_sendmany", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\" \"[{\\\"toaddress\\\":\\\"37FaKponF7zqoMLUjEiko25pDiuVH5YLEa\\\",\\\"propertyid\\\":1,\\\"amount\\\":\\\"100.0\\\"}]\"")
+                   + HelpExampleRpc("omni_sendmany", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\", [{\"toaddress\":\"37FaKponF7zqoMLUjEiko25pDiuVH5YLEa\",\"propertyid\":1,\"amount\":\"100.0\"}]")
+               }
+            }.ToString());
+
+    // obtain parameters & info
+    std::string fromAddress = ParseAddress(request.params[0]);
+    const UniValue& sends = request.params[1].get_array();
+    std::string redeemAddress = (request.params.size() > 2 && !ParseText(request.params[2]).empty()) ? ParseAddress(request.params[2]): "";
+    int64_t referenceAmount = (request.params.size() > 3) ? ParseAmount(request.params[3], true): 0;
+
+    // perform checks
+    RequireSaneReferenceAmount(referenceAmount);
+
+    WalletTxBuilderSession session(pwallet.get(), fromAddress);
+    UniValue response(UniValue::VARR);
+
+    for (size_t i = 0; i < sends.size(); ++i) {
+        const UniValue& send = sends[i].get_obj();
+        const UniValue& toValue = find_value(send, "toaddress");
+
+        // a bad entry does not abort the sends of the other entries, which may already be broadcast
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("toaddress", toValue.isStr() ? toValue.get_str() : "");
+        try {
+            RPCTypeCheckObj(send,
+                {
+                    {"toaddress", UniValueType(UniValue::VSTR)},
+                    {"propertyid", UniValueType(UniValue::VNUM)},
+                    {"amount", UniValueType(UniValue::VSTR)},
+                });
+            std::string toAddress = ParseAddress(toValue);
+            uint32_t propertyId = ParsePropertyId(find_value(send, "propertyid"));
+            int64_t amount = ParseAmount(find_value(send, "amount"), isPropertyDivisible(propertyId));
+
+            // the balance already accounts for the pending sends of the earlier entries
+            RequireExistingProperty(propertyId);
+            RequireBalance(fromAddress, propertyId, amount);
+
+            // create a payload for the transaction
+            std::vector<unsigned char> payload = CreatePayload_SimpleSend(propertyId, amount);
+
+            // request the wallet build the transaction (and if needed commit it)
+            uint256 txid;
+            std::string rawHex;
+            int result;
+            if (autoCommit) {
+                result = session.Send(toAddress, redeemAddress, referenceAmount, payload, txid);
+            } else {
+                result = WalletTxBuilder(fromAddress, toAddress, redeemAddress, referenceAmount, payload, txid, rawHex, false, pwallet.get());
+            }
+
+            if (result != 0) {
+                throw JSONRPCError(result, error_str(result));
+            } else if (!autoCommit) {
+                entry.pushKV("hex", rawHex);
+            } else {
+                PendingAdd(txid, fromAddress, MSC_TYPE_SIMPLE_SEND, propertyId, amount);
+                entry.pushKV("txid", txid.GetHex());
+            }
+        } catch (const UniValue& objError) {
+            entry.pushKV("error", find_value(objError, "message").get_str());
+        }
+        response.push_back(entry);
+    }
+
+    return response;
+}
+
 static UniValue omni_sendall(const JSONRPCRequest& request)
 {
     std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
@@ -1894,6 +2000,7 @@ static const CRPCCommand commands[] =
   //  ------------------------------------ ------------------------------- ------------------------------ ----------
     { "omni layer (transaction creation)", "omni_sendrawtx",               &omni_sendrawtx,               {"fromaddress", "rawtransaction", "referenceaddress", "redeemaddress", "referenceamount"} },
     { "omni layer (transaction creation)", "omni_send",                    &omni_send,                    {"fromaddress", "toaddress", "propertyid", "amount", "redeemaddress", "referenceamount"} },
+    { "omni layer (transaction creation)", "omni_sendmany",                &omni_sendmany,                {"fromaddress", "sends", "redeemaddress", "referenceamount"} },
     { "omni layer (transaction creation)", "omni_senddexsell",             &omni_senddexsell,             {"fromaddress", "propertyidforsale", "amountforsale", "amountdesired", "paymentwindow", "minacceptfee", "action"} },
     { "omni layer (transaction creation)", "omni_sendnewdexorder",         &omni_sendnewdexorder,         {"fromaddress", "propertyidforsale", "amountforsale", "amountdesired", "paymentwindow", "minacceptfee"} },
     { "omni layer (transaction creation)", "omni_sendupdatedexorder",      &omni_sendupdatedexorder,      {"fromaddress", "propertyidforsale", "amountforsale", "amountdesired", "paymentwindow", "minacceptfee"} },
@@ -25,59 +25,93 @@
 
 #include <stdint.h>
 #include <limits>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace mastercore
 {
+/** A transaction restriction, of which the activation block is read from the consensus parameters. */
+struct RestrictionRule
+{
+    uint16_t txType;
+    uint16_t txVersion;
+    bool allowWildcard;
+    int CConsensusParams::* activationBlock;
+};
+
+/**
+ * The transaction types, and the parameters with the blocks at which they are enabled.
+ *
+ * The activation blocks are read when checked, so that feature activations and
+ * deactivations take effect without rebuilding anything.
+ */
+static const RestrictionRule vRestrictionRules[] =
+{ //  transaction type                    version        allow 0  activation block
+  //  ----------------------------------  -------------  -------  ------------------
+    { OMNICORE_MESSAGE_TYPE_ALERT,        0xFFFF,        true,    &CConsensusParams::MSC_ALERT_BLOCK },
+    { OMNICORE_MESSAGE_TYPE_ACTIVATION,   0xFFFF,        true,    &CConsensusParams::MSC_ALERT_BLOCK },
+    { OMNICORE_MESSAGE_TYPE_DEACTIVATION, 0xFFFF,        true,    &CConsensusParams::MSC_ALERT_BLOCK },
+
+    { MSC_TYPE_SIMPLE_SEND,               MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_SEND_BLOCK },
+
+    { MSC_TYPE_TRADE_OFFER,               MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_DEX_BLOCK },
+    { MSC_TYPE_TRADE_OFFER,               MP_TX_PKT_V1,  false,   &CConsensusParams::MSC_DEX_BLOCK },
+    { MSC_TYPE_ACCEPT_OFFER_BTC,          MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_DEX_BLOCK },
+
+    { MSC_TYPE_CREATE_PROPERTY_FIXED,     MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_SP_BLOCK },
+    { MSC_TYPE_CREATE_PROPERTY_VARIABLE,  MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_SP_BLOCK },
+    { MSC_TYPE_CREATE_PROPERTY_VARIABLE,  MP_TX_PKT_V1,  false,   &CConsensusParams::MSC_SP_BLOCK },
+    { MSC_TYPE_CLOSE_CROWDSALE,           MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_SP_BLOCK },
+
+    { MSC_TYPE_CREATE_PROPERTY_MANUAL,    MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_GRANT_PROPERTY_TOKENS,     MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_REVOKE_PROPERTY_TOKENS,    MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_CHANGE_ISSUER_ADDRESS,     MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_ENABLE_FREEZING,           MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_DISABLE_FREEZING,          MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_FREEZE_PROPERTY_TOKENS,    MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+    { MSC_TYPE_UNFREEZE_PROPERTY_TOKENS,  MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_MANUALSP_BLOCK },
+
+    { MSC_TYPE_SEND_TO_OWNERS,            MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_STO_BLOCK },
+    { MSC_TYPE_SEND_TO_OWNERS,            MP_TX_PKT_V1,  false,   &CConsensusParams::MSC_STOV1_BLOCK },
+
+    { MSC_TYPE_METADEX_TRADE,             MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_METADEX_BLOCK },
+    { MSC_TYPE_METADEX_CANCEL_PRICE,      MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_METADEX_BLOCK },
+    { MSC_TYPE_METADEX_CANCEL_PAIR,       MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_METADEX_BLOCK },
+    { MSC_TYPE_METADEX_CANCEL_ECOSYSTEM,  MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_METADEX_BLOCK },
+
+    { MSC_TYPE_SEND_ALL,                  MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_SEND_ALL_BLOCK },
+
+    { MSC_TYPE_OFFER_ACCEPT_A_BET,        MP_TX_PKT_V0,  false,   &CConsensusParams::MSC_BET_BLOCK },
+};
+
 /**
  * Returns a mapping of transaction types, and the blocks at which they are enabled.
  */
 std::vector<TransactionRestriction> CConsensusParams::GetRestrictions() const
 {
-    const TransactionRestriction vTxRestrictions[] =
-    { //  transaction type                    version        allow 0  activation block
-      //  ----------------------------------  -------------  -------  ------------------
-        { OMNICORE_MESSAGE_TYPE_ALERT,        0xFFFF,        true,    MSC_ALERT_BLOCK    },
-        { OMNICORE_MESSAGE_TYPE_ACTIVATION,   0xFFFF,        true,    MSC_ALERT_BLOCK    },
-        { OMNICORE_MESSAGE_TYPE_DEACTIVATION, 0xFFFF,        true,    MSC_ALERT_BLOCK    },
-
-        { MSC_TYPE_SIMPLE_SEND,               MP_TX_PKT_V0,  false,   MSC_SEND_BLOCK     },
-
-        { MSC_TYPE_TRADE_OFFER,               MP_TX_PKT_V0,  false,   MSC_DEX_BLOCK      },
-        { MSC_TYPE_TRADE_OFFER,               MP_TX_PKT_V1,  false,   MSC_DEX_BLOCK      },
-        { MSC_TYPE_ACCEPT_OFFER_BTC,          MP_TX_PKT_V0,  false,   MSC_DEX_BLOCK      },
-
-        { MSC_TYPE_CREATE_PROPERTY_FIXED,     MP_TX_PKT_V0,  false,   MSC_SP_BLOCK       },
-        { MSC_TYPE_CREATE_PROPERTY_VARIABLE,  MP_TX_PKT_V0,  false,   MSC_SP_BLOCK       },
-        { MSC_TYPE_CREATE_PROPERTY_VARIABLE,  MP_TX_PKT_V1,  false,   MSC_SP_BLOCK       },
-        { MSC_TYPE_CLOSE_CROWDSALE,           MP_TX_PKT_V0,  false,   MSC_SP_BLOCK       },
-
-        { MSC_TYPE_CREATE_PROPERTY_MANUAL,    MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_GRANT_PROPERTY_TOKENS,     MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_REVOKE_PROPERTY_TOKENS,    MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_CHANGE_ISSUER_ADDRESS,     MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_ENABLE_FREEZING,           MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_DISABLE_FREEZING,          MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_FREEZE_PROPERTY_TOKENS,    MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-        { MSC_TYPE_UNFREEZE_PROPERTY_TOKENS,  MP_TX_PKT_V0,  false,   MSC_MANUALSP_BLOCK },
-
-        { MSC_TYPE_SEND_TO_OWNERS,            MP_TX_PKT_V0,  false,   MSC_STO_BLOCK      },
-        { MSC_TYPE_SEND_TO_OWNERS,            MP_TX_PKT_V1,  false,   MSC_STOV1_BLOCK    },
-
-        { MSC_TYPE_METADEX_TRADE,             MP_TX_PKT_V0,  false,   MSC_METADEX_BLOCK  },
-        { MSC_TYPE_METADEX_CANCEL_PRICE,      MP_TX_PKT_V0,  false,   MSC_METADEX_BLOCK  },
-        { MSC_TYPE_METADEX_CANCEL_PAIR,       MP_TX_PKT_V0,  false,   MSC_METADEX_BLOCK  },
-        { MSC_TYPE_METADEX_CANCEL_ECOSYSTEM,  MP_TX_PKT_V0,  false,   MSC_METADEX_BLOCK  },
-
-        { MSC_TYPE_SEND_ALL,                  MP_TX_PKT_V0,  false,   MSC_SEND_ALL_BLOCK },
+    std::vector<TransactionRestriction> vTxRestrictions;
+    for (const RestrictionRule& rule : vRestrictionRules) {
+        vTxRestrictions.push_back({rule.txType, rule.txVersion, rule.allowWildcard, this->*rule.activationBlock});
+    }
 
-        { MSC_TYPE_OFFER_ACCEPT_A_BET,        MP_TX_PKT_V0,  false,   MSC_BET_BLOCK      },
-    };
+    return vTxRestrictions;
+}
 
-    const size_t nSize = sizeof(vTxRestrictions) / sizeof(vTxRestrictions[0]);
+/** Returns the restriction rules by transaction type and version, built once. */
+static const std::map<std::pair<uint16_t, uint16_t>, std::vector<const RestrictionRule*> >& GetRestrictionRules()
+{
+    static const std::map<std::pair<uint16_t, uint16_t>, std::vector<const RestrictionRule*> > mapRules = [] {
+        std::map<std::pair<uint16_t, uint16_t>, std::vector<const RestrictionRule*> > rules;
+        for (const RestrictionRule& rule : vRestrictionRules) {
+            rules[std::make_pair(rule.txType, rule.txVersion)].push_back(&rule);
+        }
+        return rules;
+    }();
 
-    return std::vector<TransactionRestriction>(vTxRestrictions, vTxRestrictions + nSize);
+    return mapRules;
 }
 
 /**
@@ -351,6 +385,29 @@ bool IsAllowedOutputType(int whichType, int nBlock)
     return false;
 }
 
+/**
+ * Returns the consensus parameter with the activation block of a feature, or nullptr, if the feature is unknown.
+ */
+static int CConsensusParams::* GetFeatureActivationBlock(uint16_t featureId)
+{
+    switch (featureId) {
+        case FEATURE_CLASS_C: return &CConsensusParams::NULLDATA_BLOCK;
+        case FEATURE_METADEX: return &CConsensusParams::MSC_METADEX_BLOCK;
+        case FEATURE_BETTING: return &CConsensusParams::MSC_BET_BLOCK;
+        case FEATURE_GRANTEFFECTS: return &CConsensusParams::GRANTEFFECTS_FEATURE_BLOCK;
+        case FEATURE_DEXMATH: return &CConsensusParams::DEXMATH_FEATURE_BLOCK;
+        case FEATURE_SENDALL: return &CConsensusParams::MSC_SEND_ALL_BLOCK;
+        case FEATURE_SPCROWDCROSSOVER: return &CConsensusParams::SPCROWDCROSSOVER_FEATURE_BLOCK;
+        case FEATURE_TRADEALLPAIRS: return &CConsensusParams::TRADEALLPAIRS_FEATURE_BLOCK;
+        case FEATURE_FEES: return &CConsensusParams::FEES_FEATURE_BLOCK;
+        case FEATURE_STOV1: return &CConsensusParams::MSC_STOV1_BLOCK;
+        case FEATURE_FREEZENOTICE: return &CConsensusParams::FREEZENOTICE_FEATURE_BLOCK;
+        case FEATURE_FREEDEX: return &CConsensusParams::FREEDEX_FEATURE_BLOCK;
+
+        default: return nullptr;
+    }
+}
+
 /**
  * Activates a feature at a specific block height, authorization has already been validated.
  *
@@ -381,46 +438,11 @@ bool ActivateFeature(uint16_t featureId, int activationBlock, uint32_t minClient
     // check feature is recognized and activation is successful
     std::string featureName = GetFeatureName(featureId);
     bool supported = OMNICORE_VERSION >= minClientVersion;
-    switch (featureId) {
-        case FEATURE_CLASS_C:
-            MutableConsensusParams().NULLDATA_BLOCK = activationBlock;
-        break;
-        case FEATURE_METADEX:
-            MutableConsensusParams().MSC_METADEX_BLOCK = activationBlock;
-        break;
-        case FEATURE_BETTING:
-            MutableConsensusParams().MSC_BET_BLOCK = activationBlock;
-        break;
-        case FEATURE_GRANTEFFECTS:
-            MutableConsensusParams().GRANTEFFECTS_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_DEXMATH:
-            MutableConsensusParams().DEXMATH_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_SENDALL:
-            MutableConsensusParams().MSC_SEND_ALL_BLOCK = activationBlock;
-        break;
-        case FEATURE_SPCROWDCROSSOVER:
-            MutableConsensusParams().SPCROWDCROSSOVER_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_TRADEALLPAIRS:
-            MutableConsensusParams().TRADEALLPAIRS_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_FEES:
-            MutableConsensusParams().FEES_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_STOV1:
-            MutableConsensusParams().MSC_STOV1_BLOCK = activationBlock;
-        break;
-        case FEATURE_FREEZENOTICE:
-            MutableConsensusParams().FREEZENOTICE_FEATURE_BLOCK = activationBlock;
-        break;
-        case FEATURE_FREEDEX:
-            MutableConsensusParams().FREEDEX_FEATURE_BLOCK = activationBlock;
-        break;
-        default:
-            supported = false;
-        break;
+    int CConsensusParams::* featureBlock = GetFeatureActivationBlock(featureId);
+    if (featureBlock) {
+        MutableConsensusParams().*featureBlock = activationBlock;
+    } else {
+        supported = false;
     }
 
     PrintToLog("Feature activation of ID %d processed. %s will be enabled at block %d.\n", featureId, featureName, activationBlock);
@@ -455,47 +477,11 @@ bool DeactivateFeature(uint16_t featureId, int transactionBlock)
     }
 
     std::string featureName = GetFeatureName(featureId);
-    switch (featureId) {
-        case FEATURE_CLASS_C:
-            MutableConsensusParams().NULLDATA_BLOCK = 999999;
-        break;
-        case FEATURE_METADEX:
-            MutableConsensusParams().MSC_METADEX_BLOCK = 999999;
-        break;
-        case FEATURE_BETTING:
-            MutableConsensusParams().MSC_BET_BLOCK = 999999;
-        break;
-        case FEATURE_GRANTEFFECTS:
-            MutableConsensusParams().GRANTEFFECTS_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_DEXMATH:
-            MutableConsensusParams().DEXMATH_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_SENDALL:
-            MutableConsensusParams().MSC_SEND_ALL_BLOCK = 999999;
-        break;
-        case FEATURE_SPCROWDCROSSOVER:
-            MutableConsensusParams().SPCROWDCROSSOVER_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_TRADEALLPAIRS:
-            MutableConsensusParams().TRADEALLPAIRS_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_FEES:
-            MutableConsensusParams().FEES_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_STOV1:
-            MutableConsensusParams().MSC_STOV1_BLOCK = 999999;
-        break;
-        case FEATURE_FREEZENOTICE:
-            MutableConsensusParams().FREEZENOTICE_FEATURE_BLOCK = 999999;
-        break;
-        case FEATURE_FREEDEX:
-            MutableConsensusParams().FREEDEX_FEATURE_BLOCK = 999999;
-        break;
-        default:
-            return false;
-        break;
+    int CConsensusParams::* featureBlock = GetFeatureActivationBlock(featureId);
+    if (!featureBlock) {
+        return false;
     }
+    MutableConsensusParams().*featureBlock = 999999;
 
     PrintToLog("Feature deactivation of ID %d processed. %s has been disabled.\n", featureId, featureName);
 
@@ -534,51 +520,12 @@ std::string GetFeatureName(uint16_t featureId)
  */
 bool IsFeatureActivated(uint16_t featureId, int transactionBlock)
 {
-    const CConsensusParams& params = ConsensusParams();
-    int activationBlock = std::numeric_limits<int>::max();
-
-    switch (featureId) {
-        case FEATURE_CLASS_C:
-            activationBlock = params.NULLDATA_BLOCK;
-            break;
-        case FEATURE_METADEX:
-            activationBlock = params.MSC_METADEX_BLOCK;
-            break;
-        case FEATURE_BETTING:
-            activationBlock = params.MSC_BET_BLOCK;
-            break;
-        case FEATURE_GRANTEFFECTS:
-            activationBlock = params.GRANTEFFECTS_FEATURE_BLOCK;
-            break;
-        case FEATURE_DEXMATH:
-            activationBlock = params.DEXMATH_FEATURE_BLOCK;
-            break;
-        case FEATURE_SENDALL:
-            activationBlock = params.MSC_SEND_ALL_BLOCK;
-            break;
-        case FEATURE_SPCROWDCROSSOVER:
-            activationBlock = params.SPCROWDCROSSOVER_FEATURE_BLOCK;
-            break;
-        case FEATURE_TRADEALLPAIRS:
-            activationBlock = params.TRADEALLPAIRS_FEATURE_BLOCK;
-            break;
-        case FEATURE_FEES:
-            activationBlock = params.FEES_FEATURE_BLOCK;
-            break;
-        case FEATURE_STOV1:
-            activationBlock = params.MSC_STOV1_BLOCK;
-            break;
-        case FEATURE_FREEZENOTICE:
-            activationBlock = params.FREEZENOTICE_FEATURE_BLOCK;
-        break;
-        case FEATURE_FREEDEX:
-            activationBlock = params.FREEDEX_FEATURE_BLOCK;
-        break;
-        default:
-            return false;
+    int CConsensusParams::* featureBlock = GetFeatureActivationBlock(featureId);
+    if (!featureBlock) {
+        return false;
     }
 
-    return (transactionBlock >= activationBlock);
+    return (transactionBlock >= ConsensusParams().*featureBlock);
 }
 
 /**
@@ -592,23 +539,24 @@ bool IsFeatureActivated(uint16_t featureId, int transactionBlock)
  */
 bool IsTransactionTypeAllowed(int txBlock, uint32_t txProperty, uint16_t txType, uint16_t version)
 {
-    const std::vector<TransactionRestriction>& vTxRestrictions = ConsensusParams().GetRestrictions();
+    const std::map<std::pair<uint16_t, uint16_t>, std::vector<const RestrictionRule*> >& mapRules = GetRestrictionRules();
+    std::map<std::pair<uint16_t, uint16_t>, std::vector<const RestrictionRule*> >::const_iterator it = mapRules.find(std::make_pair(txType, version));
+    if (it == mapRules.end()) {
+        return false;
+    }
 
-    for (std::vector<TransactionRestriction>::const_iterator it = vTxRestrictions.begin(); it != vTxRestrictions.end(); ++it)
-    {
-        const TransactionRestriction& entry = *it;
-        if (entry.txType != txType || entry.txVersion != version) {
-            continue;
-        }
+    const CConsensusParams& params = ConsensusParams();
+
+    for (const RestrictionRule* rule : it->second) {
         // a property identifier of 0 (= BTC) may be used as wildcard
-        if (OMNI_PROPERTY_BTC == txProperty && !entry.allowWildcard) {
+        if (OMNI_PROPERTY_BTC == txProperty && !rule->allowWildcard) {
             continue;
         }
         // transactions are not restricted in the test ecosystem
         if (isTestEcosystemProperty(txProperty)) {
             return true;
         }
-        if (txBlock >= entry.activationBlock) {
+        if (txBlock >= params.*rule->activationBlock) {
             return true;
         }
     }
@@ -651,6 +599,21 @@ bool VerifyCheckpoint(int block, const uint256& blockHash)
     return true;
 }
 
+/**
+ * Checks, whether a block is one of the hardcoded consensus checkpoints.
+ */
+bool IsConsensusCheckpoint(int block, const uint256& blockHash, uint256* consensusHash)
+{
+    for (const ConsensusCheckpoint& checkpoint : ConsensusParams().GetCheckpoints()) {
+        if (block == checkpoint.blockHeight && blockHash == checkpoint.blockHash) {
+            if (consensusHash) *consensusHash = checkpoint.consensusHash;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /**
  * Checks, if a specific transaction exists in the database.
  */
@@ -229,6 +229,8 @@ bool IsTransactionTypeAllowed(int txBlock, uint32_t txProperty, uint16_t txType,
 
 /** Compares a supplied block, block hash and consensus hash against a hardcoded list of checkpoints. */
 bool VerifyCheckpoint(int block, const uint256& blockHash);
+/** Checks, whether a block is one of the hardcoded consensus checkpoints, and returns its consensus hash. */
+bool IsConsensusCheckpoint(int block, const uint256& blockHash, uint256* consensusHash = nullptr);
 /** Checks, if a specific transaction exists in the database. */
 bool VerifyTransactionExistence(int block);
 }
@@ -0,0 +1,361 @@
+/**
+ * @file snapshot.cpp
+ *
+ * Provides immutable snapshots of balances and open MetaDEx orders, which are
+ * published after each processed block and shared with RPC readers.
+ */
+
+#include <omnicore/snapshot.h>
+
+#include <omnicore/mdex.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/tally.h>
+
+#include <chain.h>
+#include <sync.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace mastercore
+{
+//! Guards the pointer to the latest snapshot, but not the snapshot itself
+static Mutex cs_snapshot;
+//! The latest published snapshot
+static std::shared_ptr<const CMPStateSnapshot> pStateSnapshot GUARDED_BY(cs_snapshot);
+
+//! Published changes of the price levels, oldest first
+static std::deque<CMPOrderBookDelta> orderBookDeltas GUARDED_BY(cs_snapshot);
+//! Sequence number of the last change dropped from orderBookDeltas
+static uint64_t nOrderBookDeltasDropped GUARDED_BY(cs_snapshot) = 0;
+//! Sequence number of the last change of the price levels
+static uint64_t nOrderBookSequence GUARDED_BY(cs_tally) = 0;
+
+//! Addresses with balance changes since the last snapshot
+static std::unordered_set<std::string> snapshotChangedAddresses GUARDED_BY(cs_tally);
+//! Properties with changed open orders since the last snapshot
+static std::set<uint32_t> snapshotChangedOrders GUARDED_BY(cs_tally);
+//! Whether the frozen addresses changed since the last snapshot
+static bool fSnapshotFrozenChanged GUARDED_BY(cs_tally) = false;
+//! Whether the whole state must be copied, because the changes are unknown
+static bool fSnapshotInvalid GUARDED_BY(cs_tally) = true;
+
+CMPStateSnapshot::CMPStateSnapshot() : nBlock(-1), nOrderBookSequence(0)
+{
+}
+
+size_t CMPStateSnapshot::ShardOf(const std::string& address)
+{
+    return std::hash<std::string>()(address) % TALLY_SHARDS;
+}
+
+const CMPTally* CMPStateSnapshot::GetTally(const std::string& address) const
+{
+    const TallyShard& shard = *tallies[ShardOf(address)];
+    TallyShard::const_iterator it = shard.find(address);
+    if (it != shard.end()) return it->second.get();
+
+    return nullptr;
+}
+
+int64_t CMPStateSnapshot::GetTokenBalance(const std::string& address, uint32_t propertyId, TallyType ttype) const
+{
+    if (TALLY_TYPE_COUNT <= ttype) {
+        return 0;
+    }
+
+    const CMPTally* tally = GetTally(address);
+    if (tally) return tally->getMoney(propertyId, ttype);
+
+    return 0;
+}
+
+/** The equivalent of ::GetAvailableTokenBalance(). */
+int64_t CMPStateSnapshot::GetAvailableTokenBalance(const std::string& address, uint32_t propertyId) const
+{
+    int64_t money = GetTokenBalance(address, propertyId, BALANCE);
+    int64_t pending = GetTokenBalance(address, propertyId, PENDING);
+
+    if (0 > pending) {
+        return (money + pending); // show the decrease in available money
+    }
+
+    return money;
+}
+
+/** The equivalent of ::GetReservedTokenBalance(). */
+int64_t CMPStateSnapshot::GetReservedTokenBalance(const std::string& address, uint32_t propertyId) const
+{
+    int64_t nReserved = 0;
+    nReserved += GetTokenBalance(address, propertyId, ACCEPT_RESERVE);
+    nReserved += GetTokenBalance(address, propertyId, METADEX_RESERVE);
+    nReserved += GetTokenBalance(address, propertyId, SELLOFFER_RESERVE);
+
+    return nReserved;
+}
+
+/** The equivalent of ::GetFrozenTokenBalance(). */
+int64_t CMPStateSnapshot::GetFrozenTokenBalance(const std::string& address, uint32_t propertyId) const
+{
+    int64_t frozenBalance = 0;
+
+    if (frozen->count(std::make_pair(address, propertyId))) {
+        frozenBalance = GetTokenBalance(address, propertyId, BALANCE);
+    }
+
+    return frozenBalance;
+}
+
+const md_PricesMap* CMPStateSnapshot::GetPrices(uint32_t propertyId) const
+{
+    std::map<uint32_t, std::shared_ptr<const md_PricesMap> >::const_iterator it = metadex.find(propertyId);
+    if (it != metadex.end()) return it->second.get();
+
+    return nullptr;
+}
+
+const std::vector<CMPPriceLevel>* CMPStateSnapshot::GetPriceLevels(uint32_t propertyIdForSale, uint32_t propertyIdDesired) const
+{
+    auto it = levels.find(std::make_pair(propertyIdForSale, propertyIdDesired));
+    if (it != levels.end()) return it->second.get();
+
+    return nullptr;
+}
+
+std::shared_ptr<const CMPStateSnapshot> GetStateSnapshot()
+{
+    LOCK(cs_snapshot);
+    return pStateSnapshot;
+}
+
+/** Adds without overflow, the sums are only informational. */
+static int64_t AddCapped(int64_t a, int64_t b)
+{
+    return (a > std::numeric_limits<int64_t>::max() - b) ? std::numeric_limits<int64_t>::max() : a + b;
+}
+
+/**
+ * Copies the open orders of a property, or removes them from the snapshot, if
+ * there are none, and aggregates them into the price levels of each pair.
+ */
+static void CopyOrders(CMPStateSnapshot& snapshot, uint32_t propertyId) EXCLUSIVE_LOCKS_REQUIRED(cs_tally)
+{
+    snapshot.levels.erase(snapshot.levels.lower_bound(std::make_pair(propertyId, uint32_t(0))),
+                          snapshot.levels.upper_bound(std::make_pair(propertyId, std::numeric_limits<uint32_t>::max())));
+
+    md_PropertiesMap::const_iterator it = metadex.find(propertyId);
+    if (it == metadex.end() || it->second.empty()) {
+        snapshot.metadex.erase(propertyId);
+        return;
+    }
+    snapshot.metadex[propertyId] = std::make_shared<const md_PricesMap>(it->second);
+
+    // the prices are ordered best first, so are the levels of each pair
+    std::map<uint32_t, std::vector<CMPPriceLevel> > pairs;
+    for (const auto& entry : it->second) {
+        for (const CMPMetaDEx& obj : entry.second) {
+            std::vector<CMPPriceLevel>& levels = pairs[obj.getDesProperty()];
+            if (levels.empty() || levels.back().unitPrice != entry.first) {
+                levels.emplace_back();
+                levels.back().unitPrice = entry.first;
+            }
+            CMPPriceLevel& level = levels.back();
+            level.amountRemaining = AddCapped(level.amountRemaining, obj.getAmountRemaining());
+            level.amountToFill = AddCapped(level.amountToFill, obj.getAmountToFill());
+            level.nOrders++;
+        }
+    }
+    for (auto& entry : pairs) {
+        snapshot.levels.emplace(std::make_pair(propertyId, entry.first), std::make_shared<const std::vector<CMPPriceLevel> >(std::move(entry.second)));
+    }
+}
+
+/** Returns the price levels of the pairs of a property for sale, by property desired. */
+static std::map<uint32_t, const std::vector<CMPPriceLevel>*> GetPairLevels(const CMPStateSnapshot& snapshot, uint32_t propertyId)
+{
+    std::map<uint32_t, const std::vector<CMPPriceLevel>*> pairs;
+    auto it = snapshot.levels.lower_bound(std::make_pair(propertyId, uint32_t(0)));
+    for (; it != snapshot.levels.end() && it->first.first == propertyId; ++it) {
+        pairs.emplace(it->first.second, it->second.get());
+    }
+    return pairs;
+}
+
+/** Appends the changes from one state of the price levels of a pair to another. */
+static void DiffPriceLevels(const std::vector<CMPPriceLevel>* before, const std::vector<CMPPriceLevel>* after,
+                            uint32_t propertyIdForSale, uint32_t propertyIdDesired, int nBlock,
+                            std::vector<CMPOrderBookDelta>& deltas) EXCLUSIVE_LOCKS_REQUIRED(cs_tally)
+{
+    static const std::vector<CMPPriceLevel> empty;
+    if (!before) before = &empty;
+    if (!after) after = &empty;
+
+    MetaDEx_priceCompare compare;
+    auto add = [&](const CMPPriceLevel& level) {
+        deltas.push_back(CMPOrderBookDelta{++nOrderBookSequence, nBlock, propertyIdForSale, propertyIdDesired, level});
+    };
+
+    std::vector<CMPPriceLevel>::const_iterator itBefore = before->begin(), itAfter = after->begin();
+    while (itBefore != before->end() || itAfter != after->end()) {
+        if (itAfter == after->end() || (itBefore != before->end() && compare(itBefore->unitPrice, itAfter->unitPrice))) {
+            CMPPriceLevel removed;
+            removed.unitPrice = itBefore->unitPrice;
+            add(removed);
+            ++itBefore;
+        } else if (itBefore == before->end() || compare(itAfter->unitPrice, itBefore->unitPrice)) {
+            add(*itAfter);
+            ++itAfter;
+        } else {
+            if (!(*itBefore == *itAfter)) add(*itAfter);
+            ++itBefore;
+            ++itAfter;
+        }
+    }
+}
+
+/**
+ * Publishes a snapshot of the current state.
+ *
+ * Only the shards of addresses with balance changes, and the orders of
+ * properties with changed orders are copied, everything else is shared with
+ * the previous snapshot. The whole state is copied, after it was invalidated.
+ */
+void PublishStateSnapshot()
+{
+    LOCK(cs_tally);
+
+    std::shared_ptr<const CMPStateSnapshot> pPrevious = GetStateSnapshot();
+    std::shared_ptr<CMPStateSnapshot> pSnapshot = std::make_shared<CMPStateSnapshot>();
+    std::set<uint32_t> changedOrders;
+
+    if (fSnapshotInvalid || !pPrevious) {
+        std::vector<CMPStateSnapshot::TallyShard> shards(CMPStateSnapshot::TALLY_SHARDS);
+        for (const auto& entry : mp_tally_map) {
+            shards[CMPStateSnapshot::ShardOf(entry.first)].emplace(entry.first, std::make_shared<const CMPTally>(entry.second));
+        }
+        pSnapshot->tallies.reserve(CMPStateSnapshot::TALLY_SHARDS);
+        for (CMPStateSnapshot::TallyShard& shard : shards) {
+            pSnapshot->tallies.push_back(std::make_shared<const CMPStateSnapshot::TallyShard>(std::move(shard)));
+        }
+        for (const auto& entry : metadex) {
+            changedOrders.insert(entry.first);
+        }
+        if (pPrevious) {
+            for (const auto& entry : pPrevious->metadex) {
+                changedOrders.insert(entry.first);
+            }
+        }
+        pSnapshot->frozen = std::make_shared<const std::set<std::pair<std::string, uint32_t> > >(getFrozenAddresses());
+    } else {
+        *pSnapshot = *pPrevious;
+
+        // group the changed addresses by shard, so that each shard is copied once
+        std::map<size_t, std::vector<const std::string*> > changedShards;
+        for (const std::string& address : snapshotChangedAddresses) {
+            changedShards[CMPStateSnapshot::ShardOf(address)].push_back(&address);
+        }
+        for (const auto& entry : changedShards) {
+            std::shared_ptr<CMPStateSnapshot::TallyShard> shard = std::make_shared<CMPStateSnapshot::TallyShard>(*pSnapshot->tallies[entry.first]);
+            for (const std::string* address : entry.second) {
+                std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.find(*address);
+                if (it != mp_tally_map.end()) {
+                    (*shard)[*address] = std::make_shared<const CMPTally>(it->second);
+                } else {
+                    shard->erase(*address);
+                }
+            }
+            pSnapshot->tallies[entry.first] = std::move(shard);
+        }
+        changedOrders = snapshotChangedOrders;
+        if (fSnapshotFrozenChanged) {
+            pSnapshot->frozen = std::make_shared<const std::set<std::pair<std::string, uint32_t> > >(getFrozenAddresses());
+        }
+    }
+
+    const CBlockIndex* pLastBlock = GetLastProcessedBlock();
+    pSnapshot->nBlock = pLastBlock ? pLastBlock->nHeight : -1;
+
+    // publish the changes of the price levels, compared to the previous snapshot
+    std::vector<CMPOrderBookDelta> deltas;
+    for (uint32_t propertyId : changedOrders) {
+        CopyOrders(*pSnapshot, propertyId);
+        if (!pPrevious) continue;
+
+        std::map<uint32_t, const std::vector<CMPPriceLevel>*> before = GetPairLevels(*pPrevious, propertyId);
+        std::map<uint32_t, const std::vector<CMPPriceLevel>*> after = GetPairLevels(*pSnapshot, propertyId);
+        for (const auto& entry : before) {
+            auto it = after.find(entry.first);
+            DiffPriceLevels(entry.second, it != after.end() ? it->second : nullptr, propertyId, entry.first, pSnapshot->nBlock, deltas);
+        }
+        for (const auto& entry : after) {
+            if (!before.count(entry.first)) DiffPriceLevels(nullptr, entry.second, propertyId, entry.first, pSnapshot->nBlock, deltas);
+        }
+    }
+    pSnapshot->nOrderBookSequence = nOrderBookSequence;
+
+    snapshotChangedAddresses.clear();
+    snapshotChangedOrders.clear();
+    fSnapshotFrozenChanged = false;
+    fSnapshotInvalid = false;
+
+    LOCK(cs_snapshot);
+    orderBookDeltas.insert(orderBookDeltas.end(), deltas.begin(), deltas.end());
+    while (orderBookDeltas.size() > MAX_ORDERBOOK_DELTAS) {
+        nOrderBookDeltasDropped = orderBookDeltas.front().nSequence;
+        orderBookDeltas.pop_front();
+    }
+    pStateSnapshot = std::move(pSnapshot);
+}
+
+bool GetOrderBookDeltas(uint32_t propertyIdForSale, uint32_t propertyIdDesired, uint64_t nSequence, uint64_t nSequenceLast, std::vector<CMPOrderBookDelta>& deltas)
+{
+    LOCK(cs_snapshot);
+    if (nSequence < nOrderBookDeltasDropped) return false;
+
+    auto it = std::upper_bound(orderBookDeltas.begin(), orderBookDeltas.end(), nSequence,
+            [](uint64_t n, const CMPOrderBookDelta& delta) { return n < delta.nSequence; });
+    for (; it != orderBookDeltas.end() && it->nSequence <= nSequenceLast; ++it) {
+        if (it->propertyIdForSale == propertyIdForSale && it->propertyIdDesired == propertyIdDesired) {
+            deltas.push_back(*it);
+        }
+    }
+    return true;
+}
+
+void SnapshotNotifyTallyChange(const std::string& address)
+{
+    LOCK(cs_tally);
+    if (!fSnapshotInvalid) snapshotChangedAddresses.insert(address);
+}
+
+void SnapshotNotifyMetaDExChange(uint32_t propertyId)
+{
+    LOCK(cs_tally);
+    if (!fSnapshotInvalid) snapshotChangedOrders.insert(propertyId);
+}
+
+void SnapshotNotifyFreezeChange()
+{
+    LOCK(cs_tally);
+    fSnapshotFrozenChanged = true;
+}
+
+void SnapshotInvalidate()
+{
+    LOCK(cs_tally);
+    fSnapshotInvalid = true;
+    snapshotChangedAddresses.clear();
+    snapshotChangedOrders.clear();
+}
+}
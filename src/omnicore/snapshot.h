@@ -0,0 +1,126 @@
+#ifndef BITCOIN_OMNICORE_SNAPSHOT_H
+#define BITCOIN_OMNICORE_SNAPSHOT_H
+
+#include <omnicore/mdex.h>
+#include <omnicore/tally.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mastercore
+{
+/** Open MetaDEx orders of one pair at the same unit price, aggregated. */
+struct CMPPriceLevel
+{
+    //! Unit price, in the property desired per the property for sale
+    rational_t unitPrice;
+    //! Sum of the amounts still up for sale
+    int64_t amountRemaining;
+    //! Sum of the amounts still needed to fill the orders completely
+    int64_t amountToFill;
+    //! Number of orders, a level without orders was removed
+    size_t nOrders;
+
+    CMPPriceLevel() : amountRemaining(0), amountToFill(0), nOrders(0) {}
+
+    bool operator==(const CMPPriceLevel& other) const
+    {
+        return unitPrice == other.unitPrice && amountRemaining == other.amountRemaining &&
+               amountToFill == other.amountToFill && nOrders == other.nOrders;
+    }
+};
+
+/** A changed price level of a pair, as published with a snapshot. */
+struct CMPOrderBookDelta
+{
+    //! Sequence number of the change, increasing by one
+    uint64_t nSequence;
+    //! The block, after which the change was published
+    int nBlock;
+    uint32_t propertyIdForSale;
+    uint32_t propertyIdDesired;
+    //! The new state of the level
+    CMPPriceLevel level;
+};
+
+/** Immutable state of balances and open MetaDEx orders, as of the last processed block.
+ *
+ * Snapshots are published after each block, so that read-only queries can be
+ * answered without cs_tally. Parts unchanged since the previous snapshot are
+ * shared with it.
+ */
+class CMPStateSnapshot
+{
+public:
+    //! Balances of the addresses, of which the hash falls into the same shard
+    typedef std::unordered_map<std::string, std::shared_ptr<const CMPTally> > TallyShard;
+
+    //! Number of shards of the balances, each one is copied only when changed
+    static const size_t TALLY_SHARDS = 256;
+
+    //! The last processed block, when the snapshot was published
+    int nBlock;
+    //! Balances by address, split into shards
+    std::vector<std::shared_ptr<const TallyShard> > tallies;
+    //! Open MetaDEx orders by property for sale
+    std::map<uint32_t, std::shared_ptr<const md_PricesMap> > metadex;
+    //! Open MetaDEx orders by property for sale and property desired, aggregated by unit price, best first
+    std::map<std::pair<uint32_t, uint32_t>, std::shared_ptr<const std::vector<CMPPriceLevel> > > levels;
+    //! Sequence number of the last published order book change included in the snapshot
+    uint64_t nOrderBookSequence;
+    //! Frozen addresses and properties
+    std::shared_ptr<const std::set<std::pair<std::string, uint32_t> > > frozen;
+
+    CMPStateSnapshot();
+
+    /** Returns the shard of the balances of an address. */
+    static size_t ShardOf(const std::string& address);
+
+    /** Returns the balances of an address, or nullptr, if there are none. */
+    const CMPTally* GetTally(const std::string& address) const;
+
+    int64_t GetTokenBalance(const std::string& address, uint32_t propertyId, TallyType ttype) const;
+    int64_t GetAvailableTokenBalance(const std::string& address, uint32_t propertyId) const;
+    int64_t GetReservedTokenBalance(const std::string& address, uint32_t propertyId) const;
+    int64_t GetFrozenTokenBalance(const std::string& address, uint32_t propertyId) const;
+
+    /** Returns the open orders for sale of a property, or nullptr, if there are none. */
+    const md_PricesMap* GetPrices(uint32_t propertyId) const;
+
+    /** Returns the price levels of a pair, or nullptr, if there are no open orders. */
+    const std::vector<CMPPriceLevel>* GetPriceLevels(uint32_t propertyIdForSale, uint32_t propertyIdDesired) const;
+};
+
+//! Number of order book changes kept for GetOrderBookDeltas()
+static const size_t MAX_ORDERBOOK_DELTAS = 100000;
+
+/** Returns the latest published snapshot, or nullptr, if none was published yet. */
+std::shared_ptr<const CMPStateSnapshot> GetStateSnapshot();
+/**
+ * Returns the published changes of the price levels of a pair after a sequence number, up to the
+ * sequence of the latest snapshot. Returns false, if the changes are no longer available, and the
+ * order book must be loaded again.
+ */
+bool GetOrderBookDeltas(uint32_t propertyIdForSale, uint32_t propertyIdDesired, uint64_t nSequence, uint64_t nSequenceLast, std::vector<CMPOrderBookDelta>& deltas);
+/** Publishes a snapshot of the current state, sharing unchanged parts with the previous one. */
+void PublishStateSnapshot();
+/** Records a balance change of an address, to be copied by the next snapshot. */
+void SnapshotNotifyTallyChange(const std::string& address);
+/** Records a change of the open orders for sale of a property, to be copied by the next snapshot. */
+void SnapshotNotifyMetaDExChange(uint32_t propertyId);
+/** Records a change of the frozen addresses, to be copied by the next snapshot. */
+void SnapshotNotifyFreezeChange();
+/** Forces the next snapshot to copy the whole state, after it was cleared or replaced. */
+void SnapshotInvalidate();
+}
+
+#endif // BITCOIN_OMNICORE_SNAPSHOT_H
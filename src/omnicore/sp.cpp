@@ -18,13 +18,19 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 #include <utility>
 
 using namespace mastercore;
 
+//! Deadlines of active crowdsales, with the address of the issuer
+//! Entries of crowdsales closed otherwise are skipped, when their deadline passed
+static std::set<std::pair<int64_t, std::string> > crowdsale_deadlines GUARDED_BY(cs_tally);
+
 CMPCrowd::CMPCrowd()
   : propertyId(0), nValue(0), property_desired(0), deadline(0),
     early_bird(0), percentage(0), u_created(0), i_created(0)
@@ -121,18 +127,16 @@ bool mastercore::IsPropertyIdValid(uint32_t propertyId)
 
 bool mastercore::isPropertyDivisible(uint32_t propertyId)
 {
-    // TODO: is a lock here needed
-    CMPSPInfo::Entry sp;
-
-    if (pDbSpInfo->getSP(propertyId, sp)) return sp.isDivisible();
+    std::shared_ptr<const CMPSPInfo::Entry> sp = pDbSpInfo->getSPEntry(propertyId);
+    if (sp) return sp->isDivisible();
 
     return true;
 }
 
 std::string mastercore::getPropertyName(uint32_t propertyId)
 {
-    CMPSPInfo::Entry sp;
-    if (pDbSpInfo->getSP(propertyId, sp)) return sp.name;
+    std::shared_ptr<const CMPSPInfo::Entry> sp = pDbSpInfo->getSPEntry(propertyId);
+    if (sp) return sp->name;
     return "Property Name Not Found";
 }
 
@@ -361,6 +365,36 @@ void mastercore::eraseMaxedCrowdsale(const std::string& address, int64_t blockTi
     }
 }
 
+/**
+ * Adds a crowdsale and queues it by its deadline.
+ *
+ * @return True, if the address had no active crowdsale
+ */
+bool mastercore::insertCrowdsale(const std::string& address, const CMPCrowd& crowdsale)
+{
+    if (!my_crowds.insert(std::make_pair(address, crowdsale)).second) {
+        return false;
+    }
+    crowdsale_deadlines.insert(std::make_pair(crowdsale.getDeadline(), address));
+
+    return true;
+}
+
+/**
+ * Removes all crowdsales.
+ */
+void mastercore::clearCrowdsales()
+{
+    my_crowds.clear();
+    crowdsale_deadlines.clear();
+}
+
+/**
+ * Closes the crowdsales, whose deadline passed.
+ *
+ * Only the expired crowdsales are visited, but they are processed in the order
+ * of the crowdsale map.
+ */
 unsigned int mastercore::eraseExpiredCrowdsale(const CBlockIndex* pBlockIndex)
 {
     if (pBlockIndex == nullptr) return 0;
@@ -368,46 +402,54 @@ unsigned int mastercore::eraseExpiredCrowdsale(const CBlockIndex* pBlockIndex)
     const int64_t blockTime = pBlockIndex->GetBlockTime();
     const int blockHeight = pBlockIndex->nHeight;
     unsigned int how_many_erased = 0;
-    CrowdMap::iterator my_it = my_crowds.begin();
 
-    while (my_crowds.end() != my_it) {
-        const std::string& address = my_it->first;
-        const CMPCrowd& crowdsale = my_it->second;
+    // pop the deadlines before the block time, and find the crowdsales, which are still active
+    std::vector<std::string> vExpired;
+    std::set<std::pair<int64_t, std::string> >::iterator itEnd = crowdsale_deadlines.lower_bound(std::make_pair(blockTime, std::string()));
+    for (std::set<std::pair<int64_t, std::string> >::iterator it = crowdsale_deadlines.begin(); it != itEnd; ++it) {
+        CrowdMap::const_iterator my_it = my_crowds.find(it->second);
+        if (my_it != my_crowds.end() && my_it->second.getDeadline() == it->first) {
+            vExpired.push_back(it->second);
+        }
+    }
+    crowdsale_deadlines.erase(crowdsale_deadlines.begin(), itEnd);
+    std::sort(vExpired.begin(), vExpired.end());
 
-        if (blockTime > crowdsale.getDeadline()) {
-            PrintToLog("%s(): ERASING EXPIRED CROWDSALE from address=%s, at block %d (timestamp: %d), SP: %d (%s)\n",
-                __func__, address, blockHeight, blockTime, crowdsale.getPropertyId(), strMPProperty(crowdsale.getPropertyId()));
+    for (const std::string& address : vExpired) {
+        CrowdMap::iterator my_it = my_crowds.find(address);
+        const CMPCrowd& crowdsale = my_it->second;
 
-            if (msc_debug_sp) {
-                PrintToLog("%s(): %s\n", __func__, FormatISO8601DateTime(blockTime));
-                PrintToLog("%s(): %s\n", __func__, crowdsale.toString(address));
-            }
+        PrintToLog("%s(): ERASING EXPIRED CROWDSALE from address=%s, at block %d (timestamp: %d), SP: %d (%s)\n",
+            __func__, address, blockHeight, blockTime, crowdsale.getPropertyId(), strMPProperty(crowdsale.getPropertyId()));
 
-            // get sp from data struct
-            CMPSPInfo::Entry sp;
-            assert(pDbSpInfo->getSP(crowdsale.getPropertyId(), sp));
+        if (msc_debug_sp) {
+            PrintToLog("%s(): %s\n", __func__, FormatISO8601DateTime(blockTime));
+            PrintToLog("%s(): %s\n", __func__, crowdsale.toString(address));
+        }
 
-            // find missing tokens
-            int64_t missedTokens = GetMissedIssuerBonus(sp, crowdsale);
+        // get sp from data struct
+        CMPSPInfo::Entry sp;
+        assert(pDbSpInfo->getSP(crowdsale.getPropertyId(), sp));
 
-            // get txdata
-            sp.historicalData = crowdsale.getDatabase();
-            sp.missedTokens = missedTokens;
+        // find missing tokens
+        int64_t missedTokens = GetMissedIssuerBonus(sp, crowdsale);
 
-            // update SP with this data
-            sp.update_block = pBlockIndex->GetBlockHash();
-            assert(pDbSpInfo->updateSP(crowdsale.getPropertyId(), sp));
+        // get txdata
+        sp.historicalData = crowdsale.getDatabase();
+        sp.missedTokens = missedTokens;
 
-            // update values
-            if (missedTokens > 0) {
-                assert(update_tally_map(sp.issuer, crowdsale.getPropertyId(), missedTokens, BALANCE));
-            }
+        // update SP with this data
+        sp.update_block = pBlockIndex->GetBlockHash();
+        assert(pDbSpInfo->updateSP(crowdsale.getPropertyId(), sp));
 
-            my_crowds.erase(my_it++);
+        // update values
+        if (missedTokens > 0) {
+            assert(update_tally_map(sp.issuer, crowdsale.getPropertyId(), missedTokens, BALANCE));
+        }
 
-            ++how_many_erased;
+        my_crowds.erase(my_it);
 
-        } else my_it++;
+        ++how_many_erased;
     }
 
     return how_many_erased;
@@ -97,6 +97,12 @@ void calculateFundraiser(bool inflateAmount, int64_t amtTransfer, uint8_t bonusP
 
 void eraseMaxedCrowdsale(const std::string& address, int64_t blockTime, int block, uint256& blockHash);
 
+/** Adds a crowdsale and queues it by its deadline. */
+bool insertCrowdsale(const std::string& address, const CMPCrowd& crowdsale);
+/** Removes all crowdsales. */
+void clearCrowdsales();
+
+/** Closes the crowdsales, whose deadline passed, visiting only those. */
 unsigned int eraseExpiredCrowdsale(const CBlockIndex* pBlockIndex);
 }
 
@@ -13,6 +13,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 namespace mastercore
@@ -27,6 +28,34 @@ bool SendToOwners_compare::operator()(const std::pair<int64_t, std::string>& p1,
     else return p1.first < p2.first;
 }
 
+/**
+ * Returns the share of an owner, rounded up, but no more than what is left to distribute.
+ */
+static int64_t GetReceiverPiece(int64_t owns, const std::string& address, int64_t amount, int64_t totalTokens, int64_t& sent_so_far)
+{
+    arith_uint256 temp = ConvertTo256(owns) * ConvertTo256(amount);
+    arith_uint256 piece = DivideAndRoundUp(temp, ConvertTo256(totalTokens));
+
+    int64_t will_really_receive = 0;
+    int64_t should_receive = ConvertTo64(piece);
+
+    // Ensure that no more than available is distributed
+    if ((amount - sent_so_far) < should_receive) {
+        will_really_receive = amount - sent_so_far;
+    } else {
+        will_really_receive = should_receive;
+    }
+
+    sent_so_far += will_really_receive;
+
+    if (msc_debug_sto) {
+        PrintToLog("%14d = %s, temp= %38s, should_get= %19d, will_really_get= %14d, sent_so_far= %14d\n",
+            owns, address, temp.ToString(), should_receive, will_really_receive, sent_so_far);
+    }
+
+    return will_really_receive;
+}
+
 /**
  * Determines the receivers and amounts to distribute.
  *
@@ -34,66 +63,36 @@ bool SendToOwners_compare::operator()(const std::pair<int64_t, std::string>& p1,
  */
 OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int64_t amount)
 {
+    LOCK(cs_tally);
+
     int64_t totalTokens = 0;
     int64_t senderTokens = 0;
-    OwnerAddrType ownerAddrSet;
-
-    {
-        LOCK(cs_tally);
-        std::unordered_map<std::string, CMPTally>::iterator it;
-
-        for (it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const std::string& address = it->first;
-            const CMPTally& tally = it->second;
-
-            int64_t tokens = 0;
-            tokens += tally.getMoney(property, BALANCE);
-            tokens += tally.getMoney(property, SELLOFFER_RESERVE);
-            tokens += tally.getMoney(property, ACCEPT_RESERVE);
-            tokens += tally.getMoney(property, METADEX_RESERVE);
-
-            // Do not include the sender
-            if (address == sender) {
-                senderTokens = tokens;
-                continue;
-            }
-
-            totalTokens += tokens;
-
-            // Only holders with balance are relevant
-            if (0 < tokens) {
-                ownerAddrSet.insert(std::make_pair(tokens, address));
-            }
-        }
+    OwnerAddrType receiversSet;
+
+    // Holders are indexed by the amount they own, including the sender
+    static const OwnerAddrType noOwners;
+    std::unordered_map<uint32_t, CMPHolders>::const_iterator holdersIt = mp_holders_map.find(property);
+    const OwnerAddrType& ownerAddrSet = (holdersIt != mp_holders_map.end()) ? holdersIt->second.owners : noOwners;
+    if (holdersIt != mp_holders_map.end()) totalTokens = holdersIt->second.total;
+
+    // Do not include the sender
+    const CMPTally* senderTally = getTally(sender);
+    if (senderTally) {
+        senderTokens += senderTally->getMoney(property, BALANCE);
+        senderTokens += senderTally->getMoney(property, SELLOFFER_RESERVE);
+        senderTokens += senderTally->getMoney(property, ACCEPT_RESERVE);
+        senderTokens += senderTally->getMoney(property, METADEX_RESERVE);
     }
+    totalTokens -= senderTokens;
 
     // Split up what was taken and distribute between all holders
     int64_t sent_so_far = 0;
-    OwnerAddrType receiversSet;
 
-    for (OwnerAddrType::reverse_iterator it = ownerAddrSet.rbegin(); it != ownerAddrSet.rend(); ++it) {
+    for (OwnerAddrType::const_reverse_iterator it = ownerAddrSet.rbegin(); it != ownerAddrSet.rend(); ++it) {
         const std::string& address = it->second;
+        if (address == sender) continue;
 
-        arith_uint256 owns = ConvertTo256(it->first);
-        arith_uint256 temp = owns * ConvertTo256(amount);
-        arith_uint256 piece = DivideAndRoundUp(temp, ConvertTo256(totalTokens));
-
-        int64_t will_really_receive = 0;
-        int64_t should_receive = ConvertTo64(piece);
-
-        // Ensure that no more than available is distributed
-        if ((amount - sent_so_far) < should_receive) {
-            will_really_receive = amount - sent_so_far;
-        } else {
-            will_really_receive = should_receive;
-        }
-
-        sent_so_far += will_really_receive;
-
-        if (msc_debug_sto) {
-            PrintToLog("%14d = %s, temp= %38s, should_get= %19d, will_really_get= %14d, sent_so_far= %14d\n",
-                it->first, address, temp.ToString(), should_receive, will_really_receive, sent_so_far);
-        }
+        int64_t will_really_receive = GetReceiverPiece(it->first, address, amount, totalTokens, sent_so_far);
 
         // Stop, once the whole amount is allocated
         if (will_really_receive > 0) {
@@ -111,5 +110,47 @@ OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int
     return receiversSet;
 }
 
+/**
+ * Determines the amount a single receiver would get, without building the whole receiver set.
+ *
+ * Walks the holders in the order of the distribution, and stops at the receiver.
+ */
+int64_t STO_GetReceiverAmount(const std::string& sender, uint32_t property, int64_t amount, const std::string& receiver)
+{
+    LOCK(cs_tally);
+
+    if (receiver == sender) return 0;
+
+    std::unordered_map<uint32_t, CMPHolders>::const_iterator holdersIt = mp_holders_map.find(property);
+    if (holdersIt == mp_holders_map.end()) return 0;
+    const OwnerAddrType& ownerAddrSet = holdersIt->second.owners;
+    int64_t totalTokens = holdersIt->second.total;
+
+    const CMPTally* receiverTally = getTally(receiver);
+    if (!receiverTally) return 0;
+
+    // Do not include the sender
+    const CMPTally* senderTally = getTally(sender);
+    if (senderTally) {
+        totalTokens -= senderTally->getMoney(property, BALANCE);
+        totalTokens -= senderTally->getMoney(property, SELLOFFER_RESERVE);
+        totalTokens -= senderTally->getMoney(property, ACCEPT_RESERVE);
+        totalTokens -= senderTally->getMoney(property, METADEX_RESERVE);
+    }
+
+    int64_t sent_so_far = 0;
+
+    for (OwnerAddrType::const_reverse_iterator it = ownerAddrSet.rbegin(); it != ownerAddrSet.rend(); ++it) {
+        const std::string& address = it->second;
+        if (address == sender) continue;
+
+        int64_t will_really_receive = GetReceiverPiece(it->first, address, amount, totalTokens, sent_so_far);
+        if (address == receiver) return will_really_receive;
+        if (will_really_receive <= 0) break;
+    }
+
+    return 0;
+}
+
 } // namespace mastercore
 
@@ -23,6 +23,9 @@ typedef std::set<std::pair<int64_t, std::string>, SendToOwners_compare> OwnerAdd
 
 /** Determines the receivers and amounts to distribute. */
 OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int64_t amount);
+
+/** Determines the amount a single receiver would get from a distribution. */
+int64_t STO_GetReceiverAmount(const std::string& sender, uint32_t property, int64_t amount, const std::string& receiver);
 }
 
 
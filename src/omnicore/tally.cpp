@@ -3,15 +3,57 @@
 #include <omnicore/log.h>
 #include <omnicore/omnicore.h>
 
+#include <algorithm>
 #include <stdint.h>
-#include <map>
+
+namespace {
+/** Orders balance records by property identifier. */
+struct TokenLess
+{
+    template <typename Record>
+    bool operator()(const Record& record, uint32_t propertyId) const
+    {
+        return record.first < propertyId;
+    }
+};
+} // namespace
 
 /**
  * Creates an empty tally.
  */
-CMPTally::CMPTally()
+CMPTally::CMPTally() : my_pos(0)
+{
+}
+
+/**
+ * Returns the balance record of a token.
+ *
+ * @param propertyId  The identifier of the token
+ * @return The balance record, or end, if there is none
+ */
+CMPTally::TokenMap::const_iterator CMPTally::find(uint32_t propertyId) const
 {
-    my_it = mp_token.begin();
+    TokenMap::const_iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, TokenLess());
+    if (it != mp_token.end() && it->first == propertyId) {
+        return it;
+    }
+    return mp_token.end();
+}
+
+/**
+ * Returns the balance record of a token, which is inserted, if there is none.
+ *
+ * @param propertyId  The identifier of the token
+ * @return The balance record
+ */
+CMPTally::BalanceRecord& CMPTally::getRecord(uint32_t propertyId)
+{
+    TokenMap::iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, TokenLess());
+    if (it == mp_token.end() || it->first != propertyId) {
+        BalanceRecord record = {};
+        it = mp_token.insert(it, std::make_pair(propertyId, record));
+    }
+    return it->second;
 }
 
 /**
@@ -22,9 +64,9 @@ CMPTally::CMPTally()
 uint32_t CMPTally::init()
 {
     uint32_t propertyId = 0;
-    my_it = mp_token.begin();
-    if (my_it != mp_token.end()) {
-        propertyId = my_it->first;
+    my_pos = 0;
+    if (my_pos < mp_token.size()) {
+        propertyId = mp_token[my_pos].first;
     }
     return propertyId;
 }
@@ -37,9 +79,9 @@ uint32_t CMPTally::init()
 uint32_t CMPTally::next()
 {
     uint32_t ret = 0;
-    if (my_it != mp_token.end()) {
-        ret = my_it->first;
-        ++my_it;
+    if (my_pos < mp_token.size()) {
+        ret = mp_token[my_pos].first;
+        ++my_pos;
     }
     return ret;
 }
@@ -73,7 +115,8 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         return false;
     }
     bool fUpdated = false;
-    int64_t now64 = mp_token[propertyId].balance[ttype];
+    BalanceRecord& record = getRecord(propertyId);
+    int64_t now64 = record.balance[ttype];
 
     if (isOverflow(now64, amount)) {
         PrintToLog("%s(): ERROR: arithmetic overflow [%d + %d]\n", __func__, now64, amount);
@@ -86,7 +129,7 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
     } else {
 
         now64 += amount;
-        mp_token[propertyId].balance[ttype] = now64;
+        record.balance[ttype] = now64;
 
         fUpdated = true;
     }
@@ -107,7 +150,7 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
         return 0;
     }
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    TokenMap::const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -128,7 +171,7 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
  */
 int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 {
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    TokenMap::const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -154,7 +197,7 @@ int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
 {
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    TokenMap::const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
@@ -228,7 +271,7 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
     int64_t pending = 0;
     int64_t metadex_reserve = 0;
 
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    TokenMap::const_iterator it = find(propertyId);
 
     if (it != mp_token.end()) {
         const BalanceRecord& record = it->second;
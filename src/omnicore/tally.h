@@ -1,8 +1,10 @@
 #ifndef BITCOIN_OMNICORE_TALLY_H
 #define BITCOIN_OMNICORE_TALLY_H
 
+#include <stddef.h>
 #include <stdint.h>
-#include <map>
+#include <utility>
+#include <vector>
 
 //! Balance record types
 enum TallyType {
@@ -23,12 +25,18 @@ private:
         int64_t balance[TALLY_TYPE_COUNT];
     } BalanceRecord;
 
-    //! Map of balance records
-    typedef std::map<uint32_t, BalanceRecord> TokenMap;
+    //! Flat map of balance records, ordered by property identifier
+    typedef std::vector<std::pair<uint32_t, BalanceRecord> > TokenMap;
     //! Balance records for different tokens
     TokenMap mp_token;
-    //! Internal iterator pointing to a balance record
-    TokenMap::iterator my_it;
+    //! Internal position of the iterator pointing to a balance record
+    size_t my_pos;
+
+    /** Returns the balance record of a token, or end, if there is none. */
+    TokenMap::const_iterator find(uint32_t propertyId) const;
+
+    /** Returns the balance record of a token, which is inserted, if there is none. */
+    BalanceRecord& getRecord(uint32_t propertyId);
 
 public:
     /** Creates an empty tally. */
@@ -1250,7 +1250,7 @@ int CMPTransaction::logicMath_SendAll()
             ++numberOfPropertiesSent;
             assert(update_tally_map(sender, propertyId, -moneyAvailable, BALANCE));
             assert(update_tally_map(receiver, propertyId, moneyAvailable, BALANCE));
-            pDbTransactionList->recordSendAllSubRecord(txid, numberOfPropertiesSent, propertyId, moneyAvailable);
+            pDbTransactionList->recordSendAllSubRecord(txid, block, numberOfPropertiesSent, propertyId, moneyAvailable);
         }
     }
 
@@ -1745,7 +1745,7 @@ int CMPTransaction::logicMath_CreatePropertyVariable(CBlockIndex* pindex)
 
     const uint32_t propertyId = pDbSpInfo->putSP(ecosystem, newSP);
     assert(propertyId > 0);
-    my_crowds.insert(std::make_pair(sender, CMPCrowd(propertyId, nValue, property, deadline, early_bird, percentage, 0, 0)));
+    insertCrowdsale(sender, CMPCrowd(propertyId, nValue, property, deadline, early_bird, percentage, 0, 0));
 
     PrintToLog("CREATED CROWDSALE id: %d value: %d property: %d\n", propertyId, nValue, property);
 
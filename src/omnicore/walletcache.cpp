@@ -10,6 +10,7 @@
 #include <omnicore/log.h>
 #include <omnicore/omnicore.h>
 #include <omnicore/tally.h>
+#include <omnicore/utilsui.h>
 #include <omnicore/walletutils.h>
 
 #include <init.h>
@@ -32,10 +33,97 @@ namespace mastercore
 {
 //! Map of wallet balances
 static std::map<std::string, CMPTally> walletBalancesCache GUARDED_BY(cs_tally);
+//! Addresses with balance changes since the last update of the cache
+static std::set<std::string> walletChangedAddresses GUARDED_BY(cs_tally);
+//! Whether all balances must be compared, because the changes are unknown
+static bool fWalletCacheInvalid GUARDED_BY(cs_tally) = true;
+
+/**
+ * Records a balance change of an address, as reported by update_tally_map().
+ *
+ * The cache is only used by the UI, so changes are not recorded without it.
+ */
+void WalletCacheNotifyChange(const std::string& address)
+{
+    if (!fQtMode) return;
+
+    LOCK(cs_tally);
+    if (!fWalletCacheInvalid) walletChangedAddresses.insert(address);
+}
+
+/**
+ * Forces the next update to compare the balances of all addresses, for example
+ * after the state was cleared or restored from a snapshot.
+ */
+void WalletCacheInvalidate()
+{
+    LOCK(cs_tally);
+    fWalletCacheInvalid = true;
+    walletChangedAddresses.clear();
+}
+
+/**
+ * Returns the wallet addresses (including watch only), which have or had balances.
+ */
+std::set<std::string> WalletCacheAddresses()
+{
+    std::set<std::string> addresses;
+
+    LOCK(cs_tally);
+    for (const auto& entry : walletBalancesCache) {
+        addresses.insert(entry.first);
+    }
+
+    return addresses;
+}
+
+/**
+ * Compares the balances of an address with the cache, and updates the cache on changes.
+ */
+static bool UpdateAddress(const std::string& address, CMPTally& tally, std::set<std::string>& changedAddresses) EXCLUSIVE_LOCKS_REQUIRED(cs_tally)
+{
+    // determine if this address is in the wallet
+    int addressIsMine = IsMyAddressAllWallets(address, true);
+    if (!addressIsMine) {
+        if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
+        return false; // ignore this address, not in wallet
+    }
+
+    // init the tally
+    tally.init();
+
+    // check cache for miss on address
+    std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
+    if (search_it == walletBalancesCache.end()) { // cache miss, new address
+        changedAddresses.insert(address);
+        walletBalancesCache.insert(std::make_pair(address,tally));
+        if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
+        return true;
+    }
+
+    // check cache for miss on balance
+    CMPTally &cacheTally = search_it->second;
+    uint32_t propertyId;
+    while (0 != (propertyId = (tally.next()))) {
+        if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
+                tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
+                tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
+                tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
+                tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
+            changedAddresses.insert(address);
+            search_it->second = tally;
+            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
+            return true;
+        }
+    }
+
+    return false;
+}
 
 /**
  * Updates the cache with the latest state, returning true if changes were made to wallet addresses (including watch only).
  *
+ * Only addresses with balance changes since the last update are compared, unless the cache was invalidated.
  * Also prepares a list of addresses that were changed (for future usage).
  */
 int WalletCacheUpdate()
@@ -46,48 +134,20 @@ int WalletCacheUpdate()
 
     LOCK(cs_tally);
 
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
-
-        // determine if this address is in the wallet
-        int addressIsMine = IsMyAddressAllWallets(address, true);
-        if (!addressIsMine) {
-            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
-            continue; // ignore this address, not in wallet
+    if (fWalletCacheInvalid) {
+        for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            if (UpdateAddress(my_it->first, my_it->second, changedAddresses)) ++numChanges;
         }
-
-        // obtain & init the tally
-        CMPTally& tally = my_it->second;
-        tally.init();
-
-        // check cache for miss on address
-        std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
-        if (search_it == walletBalancesCache.end()) { // cache miss, new address
-            ++numChanges;
-            changedAddresses.insert(address);
-            walletBalancesCache.insert(std::make_pair(address,tally));
-            if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
-            continue;
-        }
-
-        // check cache for miss on balance - TODO TRY AND OPTIMIZE THIS
-        CMPTally &cacheTally = search_it->second;
-        uint32_t propertyId;
-        while (0 != (propertyId = (tally.next()))) {
-            if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
-                    tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
-                    tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
-                    tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
-                    tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
-                ++numChanges;
-                changedAddresses.insert(address);
-                walletBalancesCache.erase(search_it);
-                walletBalancesCache.insert(std::make_pair(address,tally));
-                if (msc_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
-                break;
-            }
+        fWalletCacheInvalid = false;
+    } else {
+        for (const std::string& address : walletChangedAddresses) {
+            std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(address);
+            if (my_it == mp_tally_map.end()) continue;
+            if (UpdateAddress(address, my_it->second, changedAddresses)) ++numChanges;
         }
     }
+    walletChangedAddresses.clear();
+
     if (msc_debug_walletcache) PrintToLog("WALLETCACHE: Update finished - there were %d changes\n", numChanges);
     return numChanges;
 }
@@ -3,12 +3,20 @@
 
 class uint256;
 
+#include <set>
+#include <string>
 #include <vector>
 
 namespace mastercore
 {
 /** Updates the cache and returns whether any wallet addresses were changed */
 int WalletCacheUpdate();
+/** Records a balance change of an address, to be checked by the next cache update */
+void WalletCacheNotifyChange(const std::string& address);
+/** Forces the next cache update to compare all balances, after the tally map was replaced */
+void WalletCacheInvalidate();
+/** Returns the wallet addresses (including watch only) with cached balances */
+std::set<std::string> WalletCacheAddresses();
 }
 
 #endif // BITCOIN_OMNICORE_WALLETCACHE_H
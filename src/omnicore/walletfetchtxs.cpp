@@ -16,6 +16,7 @@
 
 #include <init.h>
 #include <interfaces/wallet.h>
+#include <txmempool.h>
 #include <validation.h>
 #include <sync.h>
 #include <tinyformat.h>
@@ -27,10 +28,12 @@
 #include <boost/algorithm/string.hpp>
 
 #include <stdint.h>
+#include <algorithm>
 #include <list>
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -50,6 +53,64 @@ static unsigned int GetTransactionByteOffset(const uint256& txid)
     return 0;
 }
 
+/**
+ * Index of the Omni transactions of a wallet.
+ *
+ * Each wallet transaction is looked up in the transaction list once, after its block
+ * was processed by the Omni layer, so repeated queries only look at new transactions.
+ */
+struct WalletTxIndex
+{
+    //! Wallet transactions, which were already checked
+    std::unordered_set<uint256, SaltedTxidHasher> setExamined;
+    //! Omni transactions of the wallet, ordered by block and position in block
+    std::map<std::string, uint256> mapOmniTxs;
+};
+
+//! Indexes of Omni transactions by wallet name
+static std::map<std::string, WalletTxIndex> mapWalletTxIndexes GUARDED_BY(cs_tally);
+//! Height of the last block processed by the Omni layer
+static int nWalletTxIndexHeight GUARDED_BY(cs_tally) = 0;
+
+/**
+ * Sets the height of the last block processed by the Omni layer.
+ *
+ * A height not above the previous one means the state was rolled back or cleared,
+ * so the indexes are dropped and rebuilt on demand.
+ */
+void WalletTxIndexSetHeight(int nHeight)
+{
+    LOCK(cs_tally);
+    if (nHeight <= nWalletTxIndexHeight) {
+        mapWalletTxIndexes.clear();
+    }
+    nWalletTxIndexHeight = nHeight;
+}
+
+#ifdef ENABLE_WALLET
+/**
+ * Adds the wallet transactions, which were not checked before, to the index of the wallet.
+ */
+static void UpdateWalletTxIndex(WalletTxIndex& index, const std::vector<interfaces::WalletTx>& transactions) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_tally)
+{
+    for (const auto& transaction : transactions) {
+        const uint256& txHash = transaction.tx->GetHash();
+        if (index.setExamined.count(txHash)) continue;
+        const uint256& blockHash = transaction.hash_block;
+        if (blockHash.IsNull()) continue; // unconfirmed, check again later
+        const CBlockIndex* pBlockIndex = LookupBlockIndex(blockHash);
+        if (pBlockIndex == nullptr) continue;
+        int blockHeight = pBlockIndex->nHeight;
+        if (blockHeight > nWalletTxIndexHeight) continue; // not yet processed, check again later
+        index.setExamined.insert(txHash);
+        if (!pDbTransactionList->exists(txHash)) continue;
+        int blockPosition = GetTransactionByteOffset(txHash);
+        std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
+        index.mapOmniTxs.insert(std::make_pair(sortKey, txHash));
+    }
+}
+#endif
+
 /**
  * Returns an ordered list of Omni transactions including STO receipts that are relevant to the wallet.
  *
@@ -63,30 +124,24 @@ std::map<std::string, uint256> FetchWalletOmniTransactions(interfaces::Wallet& i
         return mapResponse;
     }
     std::set<uint256> seenHashes;
-    std::multimap<int64_t, const interfaces::WalletTx*> txOrdered;
     const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxs();
-    for (const auto& transaction : transactions)
-        txOrdered.insert(std::make_pair(transaction.order_pos, &transaction));
-
-    // Iterate backwards through wallet transactions until we have count items to return:
-    for (std::multimap<int64_t, const interfaces::WalletTx*>::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
-        const interfaces::WalletTx* pwtx = it->second;
-        const uint256& txHash = pwtx->tx->GetHash();
-        {
-            LOCK(cs_tally);
-            if (!pDbTransactionList->exists(txHash)) continue;
+
+    {
+        LOCK2(cs_main, cs_tally);
+        WalletTxIndex& index = mapWalletTxIndexes[iWallet.getWalletName()];
+        UpdateWalletTxIndex(index, transactions);
+
+        // Iterate backwards through the indexed transactions of the block range until we have count items to return
+        // (the sort keys have six digits for the block height)
+        std::map<std::string, uint256>::const_iterator itFirst = index.mapOmniTxs.lower_bound(strprintf("%06d", std::max(startBlock, 0)));
+        std::map<std::string, uint256>::const_iterator itLast = index.mapOmniTxs.end();
+        if (endBlock < 999999) itLast = index.mapOmniTxs.lower_bound(strprintf("%06d", std::max(endBlock + 1, 0)));
+        if (startBlock > endBlock || startBlock > 999999) itLast = itFirst;
+        while (itLast != itFirst && mapResponse.size() < count) {
+            --itLast;
+            mapResponse.insert(*itLast);
+            seenHashes.insert(itLast->second);
         }
-        const uint256& blockHash = pwtx->hash_block;
-        if (blockHash.IsNull()) continue;
-        const CBlockIndex* pBlockIndex = GetBlockIndex(blockHash);
-        if (pBlockIndex == nullptr) continue;
-        int blockHeight = pBlockIndex->nHeight;
-        if (blockHeight < startBlock || blockHeight > endBlock) continue;
-        int blockPosition = GetTransactionByteOffset(txHash);
-        std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
-        mapResponse.insert(std::make_pair(sortKey, txHash));
-        seenHashes.insert(txHash);
-        if (mapResponse.size() >= count) break;
     }
 
     // Insert STO receipts - receiving an STO has no inbound transaction to the wallet, so we will insert these manually into the response
@@ -118,15 +173,21 @@ std::map<std::string, uint256> FetchWalletOmniTransactions(interfaces::Wallet& i
     // Insert pending transactions (sets block as 999999 and position as wallet position)
     {
         LOCK(cs_pending);
+        // Wallet positions by hash, instead of scanning the wallet for each pending transaction
+        std::map<uint256, int> mapWalletPositions;
+        if (!my_pending.empty()) {
+            for (const auto& transaction : transactions)
+                mapWalletPositions[transaction.tx->GetHash()] = transaction.order_pos;
+        }
         for (PendingMap::const_iterator it = my_pending.begin(); it != my_pending.end(); ++it) {
             const uint256& txHash = it->first;
             int blockHeight = 999999;
             if (blockHeight < startBlock || blockHeight > endBlock) continue;
             int blockPosition = 0;
             {
-                for (const auto& transaction : transactions)
-                    if (transaction.tx->GetHash() == txHash)
-                        blockPosition = transaction.order_pos;
+                std::map<uint256, int>::const_iterator itPosition = mapWalletPositions.find(txHash);
+                if (itPosition != mapWalletPositions.end())
+                    blockPosition = itPosition->second;
             }
             std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
             mapResponse.insert(std::make_pair(sortKey, txHash));
@@ -13,6 +13,8 @@ class Wallet;
 
 namespace mastercore
 {
+/** Sets the height of the last block processed by the Omni layer, invalidating the wallet indexes on rollbacks. */
+void WalletTxIndexSetHeight(int nHeight);
 /** Returns an ordered list of Omni transactions that are relevant to the wallet. */
 std::map<std::string, uint256> FetchWalletOmniTransactions(interfaces::Wallet& iWallet, unsigned int count, int startBlock = 0, int endBlock = 999999);
 }
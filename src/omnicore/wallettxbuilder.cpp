@@ -31,6 +31,7 @@
 #endif
 
 #include <stdint.h>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -38,36 +39,30 @@
 using mastercore::AddressToPubKey;
 using mastercore::UseEncodingClassC;
 
-/** Creates and sends a transaction. */
-int WalletTxBuilder(
+#ifdef ENABLE_WALLET
+/** Encodes the payload, creates a transaction spending the selected coins and sends it, if requested. */
+static int CreateWalletTransaction(
+        interfaces::Wallet* iWallet,
         const std::string& senderAddress,
         const std::string& receiverAddress,
         const std::string& redemptionAddress,
         int64_t referenceAmount,
         const std::vector<unsigned char>& payload,
+        const CCoinControl& coinControl,
         uint256& retTxid,
         std::string& retRawTx,
         bool commit,
-        interfaces::Wallet* iWallet,
-        CAmount minFee)
+        CAmount minFee,
+        CTransactionRef* retTx = nullptr,
+        int* retChangePos = nullptr)
 {
-#ifdef ENABLE_WALLET
-    if (!iWallet) return MP_ERR_WALLET_ACCESS;
-
     // Determine the class to send the transaction via - default is Class C
     int omniTxClass = OMNI_CLASS_C; //! Always
     if (!UseEncodingClassC(payload.size())) omniTxClass = OMNI_CLASS_B;
 
     // Prepare the transaction - first setup some vars
-    CCoinControl coinControl;
     std::vector<std::pair<CScript, int64_t> > vecSend;
 
-    // Next, we set the change address to the sender
-    coinControl.destChange = DecodeDestination(senderAddress);
-
-    // Select the inputs
-    if (0 > mastercore::SelectCoins(*iWallet, senderAddress, coinControl, referenceAmount)) { return MP_INPUTS_INVALID; }
-
     // Encode the data outputs
     switch(omniTxClass) {
         case OMNI_CLASS_B: { // declaring vars in a switch here so use an expicit code block
@@ -121,14 +116,119 @@ int WalletTxBuilder(
         std::string rejectReason;
         if (!iWallet->commitTransaction(wtxNew, {}, {}, rejectReason)) return MP_ERR_COMMIT_TX;
         retTxid = wtxNew->GetHash();
+        if (retTx) *retTx = wtxNew;
+        if (retChangePos) *retChangePos = nChangePosInOut;
         return 0;
     }
+}
+#endif
+
+/** Creates and sends a transaction. */
+int WalletTxBuilder(
+        const std::string& senderAddress,
+        const std::string& receiverAddress,
+        const std::string& redemptionAddress,
+        int64_t referenceAmount,
+        const std::vector<unsigned char>& payload,
+        uint256& retTxid,
+        std::string& retRawTx,
+        bool commit,
+        interfaces::Wallet* iWallet,
+        CAmount minFee)
+{
+#ifdef ENABLE_WALLET
+    if (!iWallet) return MP_ERR_WALLET_ACCESS;
+
+    CCoinControl coinControl;
+
+    // Next, we set the change address to the sender
+    coinControl.destChange = DecodeDestination(senderAddress);
+
+    // Select the inputs
+    if (0 > mastercore::SelectCoins(*iWallet, senderAddress, coinControl, referenceAmount)) { return MP_INPUTS_INVALID; }
+
+    return CreateWalletTransaction(iWallet, senderAddress, receiverAddress, redemptionAddress, referenceAmount, payload, coinControl,
+            retTxid, retRawTx, commit, minFee);
 #else
     return MP_ERR_WALLET_ACCESS;
 #endif
 
 }
 
+#ifdef ENABLE_WALLET
+WalletTxBuilderSession::WalletTxBuilderSession(interfaces::Wallet* iWallet, const std::string& senderAddress)
+    : m_wallet(iWallet), m_sender(senderAddress), m_scanned(false), m_fee_per_kb(0)
+{
+}
+
+void WalletTxBuilderSession::Scan()
+{
+    m_coins.clear();
+    mastercore::CollectCoins(*m_wallet, m_sender, m_coins);
+    m_fee_per_kb = mastercore::GetEstimatedFeePerKb(*m_wallet);
+    m_scanned = true;
+}
+
+int WalletTxBuilderSession::Send(
+        const std::string& receiverAddress,
+        const std::string& redemptionAddress,
+        int64_t referenceAmount,
+        const std::vector<unsigned char>& payload,
+        uint256& retTxid,
+        CAmount minFee)
+{
+    if (!m_wallet) return MP_ERR_WALLET_ACCESS;
+
+    bool fRescanned = false;
+    if (!m_scanned) {
+        Scan();
+        fRescanned = true;
+    }
+
+    while (true) {
+        CCoinControl coinControl;
+        coinControl.destChange = DecodeDestination(m_sender);
+
+        // Select the inputs from the pool, the same amount SelectCoins() would select
+        CAmount nMax = 20 * m_fee_per_kb;
+        if (0 < referenceAmount) nMax += referenceAmount;
+        CAmount nTotal = 0;
+        for (const std::pair<COutPoint, CAmount>& coin : m_coins) {
+            if (nMax <= nTotal) break;
+            coinControl.Select(coin.first);
+            nTotal += coin.second;
+        }
+
+        std::string rawTx;
+        CTransactionRef tx;
+        int nChangePos = -1;
+        int result = CreateWalletTransaction(m_wallet, m_sender, receiverAddress, redemptionAddress, referenceAmount, payload, coinControl,
+                retTxid, rawTx, true, minFee, &tx, &nChangePos);
+
+        if (result == 0) {
+            // Replace the spent coins by the change, which pays to the sender and can fund the next transaction
+            m_coins.erase(std::remove_if(m_coins.begin(), m_coins.end(), [&coinControl](const std::pair<COutPoint, CAmount>& coin) {
+                return coinControl.IsSelected(coin.first);
+            }), m_coins.end());
+            if (nChangePos >= 0 && nChangePos < (int) tx->vout.size()) {
+                const CTxOut& txOut = tx->vout[nChangePos];
+                if (txOut.nValue >= mastercore::GetEconomicThreshold(*m_wallet, txOut)) {
+                    m_coins.emplace_back(COutPoint(tx->GetHash(), nChangePos), txOut.nValue);
+                }
+            }
+            return 0;
+        }
+
+        // The pool may be stale, e.g. if coins were spent or received outside of this session
+        if (fRescanned || (result != MP_ERR_INPUTSELECT_FAIL && result != MP_ERR_CREATE_TX && result != MP_ERR_COMMIT_TX)) {
+            return result;
+        }
+        Scan();
+        fRescanned = true;
+    }
+}
+#endif
+
 #ifdef ENABLE_WALLET
 /** Locks all available coins that are not in the set of destinations. */
 static void LockUnrelatedCoins(
@@ -13,9 +13,11 @@ class Wallet;
 } // namespace interfaces
 
 #include <amount.h>
+#include <primitives/transaction.h>
 
 #include <stdint.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -34,6 +36,37 @@ int WalletTxBuilder(
         CAmount min_fee = 0);
 
 #ifdef ENABLE_WALLET
+/**
+ * Creates and sends many transactions of one sender.
+ *
+ * The spendable coins of the sender are collected once and the transactions are funded from
+ * this pool. The change of each transaction replaces its inputs in the pool, so the wallet
+ * is not scanned again, unless a transaction can not be created from the pool.
+ */
+class WalletTxBuilderSession
+{
+private:
+    interfaces::Wallet* m_wallet;
+    std::string m_sender;
+    std::vector<std::pair<COutPoint, CAmount> > m_coins;
+    bool m_scanned;
+    CAmount m_fee_per_kb;
+
+    void Scan();
+
+public:
+    WalletTxBuilderSession(interfaces::Wallet* iWallet, const std::string& senderAddress);
+
+    /** Creates and sends a transaction, see WalletTxBuilder(). */
+    int Send(
+            const std::string& receiverAddress,
+            const std::string& redemptionAddress,
+            int64_t referenceAmount,
+            const std::vector<unsigned char>& payload,
+            uint256& retTxid,
+            CAmount min_fee = 0);
+};
+
 /**
  * Creates and sends a raw transaction by selecting all coins from the sender
  * and enough coins from a fee source. Change is sent to the fee source!
@@ -331,6 +331,60 @@ int64_t SelectAllCoins(interfaces::Wallet& iWallet, const std::string& fromAddre
 
     return nTotal;
 }
+
+int64_t CollectCoins(interfaces::Wallet& iWallet, const std::string& fromAddress, std::vector<std::pair<COutPoint, CAmount> >& retCoins)
+{
+    // total output funds collected
+    int64_t nTotal = 0;
+    int nHeight = ::ChainActive().Height();
+
+    std::map<uint256, interfaces::WalletTxStatus> tx_status;
+    const std::vector<interfaces::WalletTx>& transactions = iWallet.getWalletTxsDetails(tx_status);
+
+    // iterate over the wallet
+    for (std::vector<interfaces::WalletTx>::const_iterator it = transactions.begin(); it != transactions.end(); ++it) {
+        const CTransactionRef tx = it->tx;
+        const uint256& txid = tx->GetHash();
+
+        auto status = tx_status.find(txid);
+        if (status == tx_status.end() || !status->second.is_trusted) {
+            continue;
+        }
+
+        if (!it->available_credit) {
+            continue;
+        }
+
+        for (unsigned int n = 0; n < tx->vout.size(); n++) {
+            const CTxOut& txOut = tx->vout[n];
+
+            CTxDestination dest;
+            if (!CheckInput(txOut, nHeight, dest)) {
+                continue;
+            }
+            if (!iWallet.isMine(dest)) {
+                continue;
+            }
+            if (iWallet.isSpent(txid, n)) {
+                continue;
+            }
+            if (iWallet.isLockedCoin(COutPoint(txid, n))) {
+                continue;
+            }
+            if (txOut.nValue < GetEconomicThreshold(iWallet, txOut)) {
+                continue;
+            }
+
+            // only use funds from the sender's address
+            if (fromAddress == EncodeDestination(dest)) {
+                retCoins.emplace_back(COutPoint(txid, n), txOut.nValue);
+                nTotal += txOut.nValue;
+            }
+        }
+    }
+
+    return nTotal;
+}
 #endif
 
 } // namespace mastercore
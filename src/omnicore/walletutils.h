@@ -2,6 +2,7 @@
 #define BITCOIN_OMNICORE_WALLETUTILS_H
 
 class CCoinControl;
+class COutPoint;
 class CPubKey;
 class CWallet;
 
@@ -9,11 +10,14 @@ namespace interfaces {
 class Wallet;
 } // namespace interfaces
 
+#include <amount.h>
 #include <script/standard.h>
 #include <wallet/ismine.h>             // For isminefilter, isminetype
 
 #include <stdint.h>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace mastercore
 {
@@ -45,6 +49,9 @@ int64_t SelectCoins(interfaces::Wallet& iWallet, const std::string& fromAddress,
 
 /** Selects all spendable outputs to create a transaction. */
 int64_t SelectAllCoins(interfaces::Wallet& iWallet, const std::string& fromAddress, CCoinControl& coinControl);
+
+/** Collects the outputs SelectCoins() may select, with their values, to select from them repeatedly. */
+int64_t CollectCoins(interfaces::Wallet& iWallet, const std::string& fromAddress, std::vector<std::pair<COutPoint, CAmount> >& retCoins);
 #endif
 }
 
@@ -9,23 +9,167 @@
 #include <omnicore_api.h>
 
 #include <omnicore/log.h>
+#include <omnicore/markerindex.h>
 #include <omnicore/omnicore.h>
 #include <omnicore/utilsui.h>
 
+#include <chainparams.h>
+#include <shutdown.h>
+#include <util/system.h>
+#include <validation.h>
+#include <validationinterface.h>
+
 static bool fInitialed = false;
 
+/**
+ * Applies blocks to the Omni state as a consumer of the validation interface
+ * queue, so that connecting a block doesn't wait for Omni state processing.
+ *
+ * Notifications only trigger to catch up with the active chain. In case the
+ * last processed block is no longer part of the active chain, a disconnect is
+ * signaled first, and the state is rewound when the next block is processed.
+ */
+class OmniBlockConsumer final : public CValidationInterface
+{
+public:
+    void QueueRemovedCoins(const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
+    {
+        LOCK(m_mutex);
+        m_removed_coins[pBlockIndex] = removedCoins;
+    }
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override
+    {
+        SyncWithActiveChain(block, pindex);
+    }
+
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override
+    {
+        SyncWithActiveChain(nullptr, nullptr);
+    }
+
+private:
+    Mutex m_mutex;
+    //! Coins spent by connected blocks, which were not yet processed
+    std::map<const CBlockIndex*, std::shared_ptr<std::map<COutPoint, Coin>>> m_removed_coins GUARDED_BY(m_mutex);
+
+    std::shared_ptr<std::map<COutPoint, Coin>> TakeRemovedCoins(const CBlockIndex* pBlockIndex)
+    {
+        LOCK(m_mutex);
+        std::shared_ptr<std::map<COutPoint, Coin>> removedCoins;
+        auto it = m_removed_coins.find(pBlockIndex);
+        if (it != m_removed_coins.end()) {
+            removedCoins = std::move(it->second);
+            m_removed_coins.erase(it);
+        }
+        return removedCoins;
+    }
+
+    void PruneRemovedCoins() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        LOCK(m_mutex);
+        for (auto it = m_removed_coins.begin(); it != m_removed_coins.end(); ) {
+            if (!::ChainActive().Contains(it->first)) {
+                it = m_removed_coins.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    /** Processes the blocks of the active chain after the last processed one, the notified block is not read again. */
+    void SyncWithActiveChain(const std::shared_ptr<const CBlock>& pblockNotified, const CBlockIndex* pindexNotified)
+    {
+        LOCK2(cs_main, ::mempool.cs);
+
+        const CBlockIndex* pLastBlock = ::GetLastProcessedBlock();
+        int nFirstBlock = 0;
+        if (pLastBlock) {
+            const CBlockIndex* pFork = ::ChainActive().FindFork(pLastBlock);
+            if (pFork != pLastBlock) {
+                LogPrint(BCLog::HANDLER, "Omni Core handler: block disconnect begin [height: %d, reindex: %d]\n", pLastBlock->nHeight, (int)fReindex);
+                ::mastercore_handler_disc_begin(pLastBlock->nHeight);
+            }
+            nFirstBlock = pFork ? pFork->nHeight + 1 : 0;
+        }
+        PruneRemovedCoins();
+
+        for (int nBlock = nFirstBlock; nBlock <= ::ChainActive().Height(); ++nBlock) {
+            if (ShutdownRequested()) break;
+
+            const CBlockIndex* pBlockIndex = ::ChainActive()[nBlock];
+            std::shared_ptr<const CBlock> pblock = pblockNotified;
+            if (pBlockIndex != pindexNotified) {
+                std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+                if (!ReadBlockFromDisk(*pblockRead, pBlockIndex, Params().GetConsensus())) {
+                    LogPrintf("%s: failed to read block %s\n", __func__, pBlockIndex->GetBlockHash().ToString());
+                    break;
+                }
+                pblock = std::move(pblockRead);
+            }
+            const CBlock& block = *pblock;
+            std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = TakeRemovedCoins(pBlockIndex);
+
+            LogPrint(BCLog::HANDLER, "Omni Core handler: block connect begin [height: %d]\n", nBlock - 1);
+            ::mastercore_handler_block_begin(nBlock - 1, pBlockIndex);
+
+            unsigned int nNumMetaTxs = 0;
+            for (unsigned int nTxIdx = 0; nTxIdx < block.vtx.size(); ++nTxIdx) {
+                if (::mastercore_handler_tx(*block.vtx[nTxIdx], nBlock, nTxIdx, pBlockIndex, removedCoins)) ++nNumMetaTxs;
+            }
+
+            LogPrint(BCLog::HANDLER, "Omni Core handler: block connect end [new height: %d, found: %u txs]\n", nBlock, nNumMetaTxs);
+            ::mastercore_handler_block_end(nBlock, pBlockIndex, nNumMetaTxs);
+        }
+    }
+};
+
+static std::unique_ptr<OmniBlockConsumer> g_omni_block_consumer;
+
 void omnicore_api::Init()
 {
+    if (gArgs.GetBoolArg("-omnimarkerindex", true)) {
+        g_omni_marker_index = MakeUnique<OmniMarkerIndex>(OMNI_MARKER_INDEX_CACHE, false, fReindex);
+        g_omni_marker_index->Start();
+    }
+
     LOCK2(cs_main, ::mempool.cs);
     mastercore_init();
 
+    // registered while cs_main is held, so that no connected block is missed
+    if (gArgs.GetBoolArg("-omniasync", DEFAULT_OMNI_ASYNC)) {
+        g_omni_block_consumer = MakeUnique<OmniBlockConsumer>();
+        RegisterValidationInterface(g_omni_block_consumer.get());
+    }
+
     fInitialed = true;
 }
 
+void omnicore_api::InterruptIndex()
+{
+    if (g_omni_marker_index) {
+        g_omni_marker_index->Interrupt();
+    }
+}
+
+void omnicore_api::StopIndex()
+{
+    if (g_omni_marker_index) {
+        g_omni_marker_index->Stop();
+        g_omni_marker_index.reset();
+    }
+}
+
 void omnicore_api::Shutdown()
 {
     if (!fInitialed) return ;
 
+    if (g_omni_block_consumer) {
+        UnregisterValidationInterface(g_omni_block_consumer.get());
+        g_omni_block_consumer.reset();
+    }
+
     LOCK(cs_main);
     ::mastercore_shutdown();
 }
@@ -35,6 +179,18 @@ bool omnicore_api::Enabled()
     return fInitialed;
 }
 
+bool omnicore_api::Asynchronous()
+{
+    return g_omni_block_consumer != nullptr;
+}
+
+void omnicore_api::QueueRemovedCoins(const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
+{
+    assert(g_omni_block_consumer);
+    AssertLockHeld(cs_main);
+    g_omni_block_consumer->QueueRemovedCoins(pBlockIndex, removedCoins);
+}
+
 void omnicore_api::HandlerDiscBegin(int nHeight)
 {
     assert(fInitialed);
@@ -21,6 +21,9 @@ class uint256;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
 
+//! Default for -omniasync, applying blocks to the Omni state asynchronously
+static const bool DEFAULT_OMNI_ASYNC = false;
+
 //! Lock order: cs_main > mempool.cs > cs_tally > cs_pending
 namespace omnicore_api {
 
@@ -30,9 +33,21 @@ void Init() LOCKS_EXCLUDED(cs_main);
 /** Handler to shut down Omni Core. */
 void Shutdown() LOCKS_EXCLUDED(cs_main);
 
+/** Interrupt the sync of the Omni marker index. */
+void InterruptIndex();
+
+/** Stop and delete the Omni marker index. */
+void StopIndex() LOCKS_EXCLUDED(cs_main);
+
 /** Return true if enable omnicore */
 bool Enabled();
 
+/** Return true if blocks are applied to the Omni state by the validation interface queue consumer. */
+bool Asynchronous();
+
+/** Hand the coins spent by a connected block over to the asynchronous consumer. */
+void QueueRemovedCoins(const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins);
+
 /** Block and transaction handlers. */
 void HandlerDiscBegin(int nHeight) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
 int HandlerBlockBegin(int nBlockNow, CBlockIndex const * pBlockIndex) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
@@ -16,14 +16,20 @@
 #include <stdint.h>
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 class CBlockHeader;
 class CBlock;
+class CHashedBlockHeader;
 class CBlockIndex;
 class CCoinsViewCache;
 class CKey;
 class CChiaProofOfSpace;
+class UniValue;
 
 namespace Consensus { struct Params; }
 
@@ -57,6 +63,20 @@ static const int64_t MAX_TARGET_DEADLINE = std::numeric_limits<uint32_t>::max();
 // Invalid deadline
 static const uint64_t INVALID_DEADLINE = std::numeric_limits<uint64_t>::max();
 
+/** Maximum number of parallel deadline check slices allowed */
+static const int MAX_POC_CHECK_THREADS = 16;
+/** -pocthreads default (number of parallel deadline check slices on the shared thread pool, 0 = auto) */
+static const int DEFAULT_POC_CHECK_THREADS = 0;
+/** -plotternoncelimit default (number of nonces calculated for each plotter and block, 0 = unlimited) */
+static const unsigned int DEFAULT_PLOTTER_NONCE_LIMIT = 1000;
+
+/** Plot of a nonce. Each of the 4096 scoops holds two hashes, the PoC2 format swaps the second hash of mirrored scoops */
+static constexpr int HASH_SIZE = 32;
+static constexpr int HASHES_PER_SCOOP = 2;
+static constexpr int SCOOP_SIZE = HASHES_PER_SCOOP * HASH_SIZE; // 2 hashes per scoop
+static constexpr int SCOOPS_PER_PLOT = 4096;
+static constexpr int PLOT_SIZE = SCOOPS_PER_PLOT * SCOOP_SIZE; // 256KB
+
 /**
  * Calculate deadline
  *
@@ -68,6 +88,46 @@ static const uint64_t INVALID_DEADLINE = std::numeric_limits<uint64_t>::max();
  */
 uint64_t CalculateDeadline(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params);
 
+/**
+ * Calculate deadlines of many blocks on the same previous block. PoC nonces are
+ * hashed together by the multi-lane Shabal256 engine.
+ *
+ * @param prevBlockIndex    Previous block
+ * @param blocks            Block headers
+ * @param params            Consensus params
+ *
+ * @return Return deadlines in the order of blocks
+ */
+std::vector<uint64_t> CalculateDeadlines(const CBlockIndex& prevBlockIndex, const std::vector<CBlockHeader>& blocks, const Consensus::Params& params);
+
+/**
+ * Get the scoop of the nonces mined for a block
+ *
+ * @param nHeight               The height of the block
+ * @param generationSignature   Generation signature of the previous block
+ *
+ * @return Return the scoop number, below SCOOPS_PER_PLOT
+ */
+uint32_t GetScoop(int nHeight, const uint256& generationSignature);
+
+/**
+ * Calculate unformatted deadlines of scoops read from PoC2 plot files, hashed by the multi-lane Shabal256 engine.
+ * Divide by the base target for the deadline in seconds
+ *
+ * @param generationSignature   Generation signature of the previous block
+ * @param pScoops               Scoops of nCount nonces, SCOOP_SIZE bytes each
+ * @param nCount                Number of scoops
+ * @param pDeadlines            Output nCount unformatted deadlines
+ */
+void CalculateScoopDeadlines(const uint256& generationSignature, const unsigned char* pScoops, size_t nCount, uint64_t* pDeadlines);
+
+/**
+ * Parse the name of a PoC2 plot file, <plotter ID>_<start nonce>_<nonces>
+ *
+ * @return Return false for other files, including PoC1 plot files with a stagger
+ */
+bool ParsePlotFileName(const std::string& strName, uint64_t& nPlotterId, uint64_t& nStartNonce, uint64_t& nNonces);
+
 /**
  * Calculate base target
  *
@@ -80,12 +140,12 @@ uint64_t CalculateDeadline(const CBlockIndex& prevBlockIndex, const CBlockHeader
 uint64_t CalculateBaseTarget(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params);
 
 /**
- * Add new nonce
+ * Add new nonce. The deadline is checked outside cs_main, do not hold cs_main
  *
  * @param bestDeadline      Output current best deadline
  * @param miningBlockIndex  Mining block
- * @param nPlotterId        Plot Id
  * @param nNonce            Found nonce
+ * @param nPlotterId        Plot Id
  * @param generateTo        Destination address or private key for block signing
  * @param fCheckBind        Check address and plot bind relation
  * @param params            Consensus params
@@ -93,11 +153,30 @@ uint64_t CalculateBaseTarget(const CBlockIndex& prevBlockIndex, const CBlockHead
  * @return Return deadline calc result
  */
 uint64_t AddNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
-    const uint64_t& nPlotterId, const uint64_t& nNonce, const std::string& generateTo,
+    const uint64_t& nNonce, const uint64_t& nPlotterId, const std::string& generateTo,
     bool fCheckBind, const Consensus::Params& params);
 
 /**
- * Add new Proof of Space
+ * Add many new nonces of the same mining block. Deadlines are checked together outside cs_main,
+ * do not hold cs_main
+ *
+ * @param bestDeadline      Output current best deadline
+ * @param miningBlockIndex  Mining block
+ * @param vPlotterNonces    Pairs of plot Id and found nonce
+ * @param vGenerateTo       Destination address or private key for block signing of each nonce
+ * @param fCheckBind        Check address and plot bind relation
+ * @param vErrors           Output JSON-RPC error of each nonce, null for accepted nonce
+ * @param params            Consensus params
+ *
+ * @return Return deadline calc result of each nonce, INVALID_DEADLINE for rejected nonce
+ */
+std::vector<uint64_t> AddNonces(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
+    const std::vector<std::pair<uint64_t, uint64_t>>& vPlotterNonces, const std::vector<std::string>& vGenerateTo,
+    bool fCheckBind, std::vector<UniValue>& vErrors, const Consensus::Params& params);
+
+/**
+ * Add new Proof of Space. The proof is checked outside cs_main, do not hold cs_main. Resubmitted proofs are answered
+ * from the earlier verification, and proofs whose scan iterations can not beat the best deadline of the tip are not verified
  *
  * @param bestDeadline      Output current best deadline
  * @param miningBlockIndex  Mining block
@@ -106,7 +185,7 @@ uint64_t AddNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
  * @param fCheckBind        Check address and plot bind relation
  * @param params            Consensus params
  *
- * @return Return deadline calc result
+ * @return Return deadline calc result, its lower bound for proofs that are not verified
  */
 uint64_t AddProofOfSpace(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
     const CChiaProofOfSpace& pos, const std::string& generateTo,
@@ -126,6 +205,33 @@ typedef std::vector< std::reference_wrapper<const CBlockIndex> > CBlockList;
  */
 CBlockList GetEvalBlocks(int nHeight, bool fAscent, const Consensus::Params& params);
 
+/**
+ * Summary of blocks by eval window
+ */
+struct EvalWindow {
+    int nBlockCount = 0;
+    uint64_t nBaseTargetSum = 0;
+    std::unordered_map<uint64_t, int> mapPlotterMinedCount; // Plotter ID => Mined block count
+
+    /** Return net capacity of TB */
+    int64_t GetNetCapacity() const;
+    /** Return mined block count of plotter */
+    int GetMinedCount(uint64_t nPlotterId) const;
+
+    void Add(const CBlockIndex& block);
+    void Remove(const CBlockIndex& block);
+    void Clear();
+};
+
+/**
+ * Get summary of blocks by eval window. Maintained incrementally on the active chain,
+ * the result is valid until cs_main released
+ *
+ * @param nHeight           The height of net capacity
+ * @param params            Consensus params
+ */
+const EvalWindow& GetEvalWindow(int nHeight, const Consensus::Params& params);
+
 /**
  * Get net capacity
  *
@@ -195,6 +301,21 @@ CAmount GetMiningRequireBalance(const CAccountID& generatorAccountID, const uint
  */
 bool CheckProofOfCapacity(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params);
 
+/** Same as above, for a header whose hash is already computed */
+bool CheckProofOfCapacity(const CBlockIndex& prevBlockIndex, const CHashedBlockHeader& block, const Consensus::Params& params);
+
+/**
+ * Check the work of a run of PoC headers on the deadline check threads. The nonces of all headers share
+ * the lanes of the multi-lane Shabal256 engine. Valid headers are kept for CheckProofOfCapacity(), which
+ * checks the other ones alone
+ *
+ * @param prevBlockIndex    Previous block of the first header
+ * @param itBegin           First header
+ * @param itEnd             End of headers, each one connected to the previous one
+ * @param params            Consensus params
+ */
+void BatchCheckProofOfCapacity(const CBlockIndex& prevBlockIndex, std::vector<CHashedBlockHeader>::const_iterator itBegin, std::vector<CHashedBlockHeader>::const_iterator itEnd, const Consensus::Params& params);
+
 /**
  * Add private key for mining signature
  *
@@ -211,6 +332,98 @@ CTxDestination AddMiningSignaturePrivkey(const CKey& key);
  */
 std::vector<CTxDestination> GetMiningSignatureAddresses();
 
+/** Mining state of the tip, published on every tip change so that miners polling it do not take cs_main */
+struct MiningInfo
+{
+    uint256 hashTip;
+    int nTipHeight;
+    int64_t nTipTime;
+    uint256 nextGenerationSignature;
+    uint64_t nBaseTarget;
+    bool fInitialDownload;
+    //! Best deadline submitted for the next block, std::numeric_limits<uint64_t>::max() until one is found
+    uint64_t nBestDeadline;
+    //! Serialized getMiningInfo reply of the PoC HTTP endpoint
+    std::string strReply;
+};
+
+/** Get the getMiningInfo reply for mining the block following the tip */
+UniValue GetMiningJob(const CBlockIndex& indexTip);
+
+/**
+ * Get mining info of the current tip
+ *
+ * @return nullptr until the PoC module published the first tip
+ */
+std::shared_ptr<const MiningInfo> GetMiningInfo();
+
+/**
+ * Wait until mining info other than the given one is published, on a tip change or a better deadline, or the PoC
+ * module is interrupted
+ *
+ * @param info              Mining info the caller already has, may be nullptr
+ * @param nTimeoutMillis    Time in milliseconds to wait. 0 indicates no timeout
+ *
+ * @return The current mining info
+ */
+std::shared_ptr<const MiningInfo> WaitForMiningInfo(const std::shared_ptr<const MiningInfo>& info, int64_t nTimeoutMillis);
+
+/** Max acceptable deadline of a nonce for the next block, the best deadline found for it once there is one */
+uint64_t GetTargetDeadline(const MiningInfo& info);
+
+/**
+ * Check that mining can start on the tip of the info. Otherwise mining info is reported from the chain state
+ * along with the reason
+ */
+bool IsMiningInfoReady(const MiningInfo& info);
+
+/** Outcome of a mining round */
+enum class MiningRoundResult {
+    PENDING,    //!< No block on the previous block connected yet
+    WON,        //!< Our block is the tip
+    LOST,       //!< Another block with the same or a better deadline than ours won
+    OUT_RACED,  //!< Another block with a worse deadline than ours connected before ours
+    SNATCHED,   //!< Our block was the tip and got replaced by another block
+};
+
+/** Mining rounds kept by GetMiningRounds() */
+static const size_t MAX_MINING_ROUNDS = 64;
+/** Improvements of the best deadline kept per mining round, the last one is always the current best */
+static const size_t MAX_MINING_ROUND_DEADLINES = 32;
+
+/** Statistics of mining the block following one previous block */
+struct MiningRound
+{
+    int nHeight{0};
+    uint256 hashPrevBlock;
+    //! Local time in microseconds the previous block became the tip, or the first nonce on it arrived
+    int64_t nStartMicros{0};
+    int nNoncesSubmitted{0};
+    int nNoncesRejected{0};
+    //! Microseconds after the start the first accepted nonce and the best nonce arrived, -1 until then
+    int64_t nFirstNonceMicros{-1};
+    int64_t nBestNonceMicros{-1};
+    //! Best deadline in seconds, and its improvements with their microseconds after the start
+    uint64_t nBestDeadline{INVALID_DEADLINE};
+    std::vector<std::pair<int64_t, uint64_t>> vBestDeadlines;
+    //! Forge attempt. Block time the deadline matured, adjusted time in microseconds the forge thread fired and the time taken to create the block
+    bool fForged{false};
+    bool fSnatch{false};
+    int64_t nMatureTime{0};
+    int64_t nForgeMicros{0};
+    int64_t nCreateBlockMicros{0};
+    //! Created block, null when creating the block failed
+    uint256 hashForged;
+    bool fForgedWasTip{false};
+    //! Block connected on the previous block and its deadline in seconds
+    uint256 hashWinner;
+    int64_t nWinnerDeadline{0};
+    MiningRoundResult result{MiningRoundResult::PENDING};
+};
+
+/** Get the recent mining rounds of the forge thread, oldest first */
+std::vector<MiningRound> GetMiningRounds();
+
 /** Utility functions for original PoC legacy. See https://qitchain.link/wiki/poc */
 uint64_t GeneratePlotterId(const std::string &passphrase);
 uint64_t ToPlotterId(const unsigned char publicKey[32]);
@@ -218,10 +431,35 @@ uint64_t ToPlotterId(const unsigned char publicKey[32]);
 bool Sign(const std::string &passphrase, const unsigned char data[32], unsigned char signature[64], unsigned char publicKey[32]);
 bool Verify(const unsigned char publicKey[32], const unsigned char data[32], const unsigned char signature[64]);
 
+/** A plotter signature to check with VerifyBatch */
+struct SignatureCheck
+{
+    unsigned char publicKey[32];
+    unsigned char data[32];
+    unsigned char signature[64];
+};
+
+/**
+ * Verify plotter signatures at once, which is cheaper than one by one. The valid signatures are
+ * remembered for a while, so that a following Verify of them is a lookup.
+ * @return  whether each signature is valid
+ */
+std::vector<bool> VerifyBatch(const std::vector<SignatureCheck>& checks);
+
 }
 
 bool StartPOC();
 void InterruptPOC();
 void StopPOC();
 
+/** Persistent connection mining server for pool software, see -pocserver */
+bool StartPoCServer();
+void InterruptPoCServer();
+void StopPoCServer();
+
+/** Scan of local PoC2 plot files on every new tip, see -plotdir */
+bool StartPlotScanner();
+void InterruptPlotScanner();
+void StopPlotScanner();
+
 #endif
@@ -8,9 +8,50 @@
 #include <crypto/curve25519.h>
 #include <crypto/sha256.h>
 #include <crypto/shabal256.h>
+#include <sync.h>
+
+#include <deque>
+#include <set>
 
 namespace poc {
 
+namespace {
+
+/** Number of valid signatures of VerifyBatch to remember */
+const size_t MAX_VERIFIED_SIGNATURES = 4096;
+
+/** Valid signatures of VerifyBatch and Verify, oldest first */
+Mutex csVerifiedSignatures;
+std::deque<uint256> dequeVerifiedSignatures GUARDED_BY(csVerifiedSignatures);
+std::set<uint256> setVerifiedSignatures GUARDED_BY(csVerifiedSignatures);
+
+uint256 GetSignatureHash(const unsigned char publicKey[32], const unsigned char data[32], const unsigned char signature[64])
+{
+    uint256 hash;
+    CSHA256().Write(publicKey, 32).Write(data, 32).Write(signature, 64).Finalize(hash.begin());
+    return hash;
+}
+
+bool IsVerifiedSignature(const uint256& hash)
+{
+    LOCK(csVerifiedSignatures);
+    return setVerifiedSignatures.count(hash) != 0;
+}
+
+void AddVerifiedSignature(const uint256& hash)
+{
+    LOCK(csVerifiedSignatures);
+    if (!setVerifiedSignatures.insert(hash).second)
+        return;
+    dequeVerifiedSignatures.push_back(hash);
+    while (dequeVerifiedSignatures.size() > MAX_VERIFIED_SIGNATURES) {
+        setVerifiedSignatures.erase(dequeVerifiedSignatures.front());
+        dequeVerifiedSignatures.pop_front();
+    }
+}
+
+}
+
 uint64_t GeneratePlotterId(const std::string &passphrase)
 {
     // 1.passphraseHash = sha256(passphrase)
@@ -58,10 +99,56 @@ bool Sign(const std::string &passphrase, const unsigned char data[32], unsigned
 
 bool Verify(const unsigned char publicKey[32], const unsigned char data[32], const unsigned char signature[64])
 {
+    const uint256 hash = GetSignatureHash(publicKey, data, signature);
+    if (IsVerifiedSignature(hash))
+        return true;
+
     unsigned char Y[32], h[32];
     crypto::curve25519_verify(Y, signature, signature + 32, publicKey); // verify25519(Y, signature, signature + 32, P) => Y
     CSHA256().Write(data, 32).Write(Y, 32).Finalize(h); // digest(m + Y) => h
-    return memcmp(h, signature + 32, 32) == 0;
+    if (memcmp(h, signature + 32, 32) != 0)
+        return false;
+    AddVerifiedSignature(hash);
+    return true;
+}
+
+std::vector<bool> VerifyBatch(const std::vector<SignatureCheck>& checks)
+{
+    std::vector<bool> vValid(checks.size(), false);
+
+    // Only the signatures not verified yet
+    std::vector<size_t> vIndexes;
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < checks.size(); i++) {
+        const uint256 hash = GetSignatureHash(checks[i].publicKey, checks[i].data, checks[i].signature);
+        if (IsVerifiedSignature(hash)) {
+            vValid[i] = true;
+        } else {
+            vIndexes.push_back(i);
+            vHashes.push_back(hash);
+        }
+    }
+    if (vIndexes.empty())
+        return vValid;
+
+    std::vector<unsigned char> Y(vIndexes.size() * 32), v(vIndexes.size() * 32), h(vIndexes.size() * 32), P(vIndexes.size() * 32);
+    for (size_t n = 0; n < vIndexes.size(); n++) {
+        const SignatureCheck& check = checks[vIndexes[n]];
+        memcpy(&v[n * 32], check.signature, 32);
+        memcpy(&h[n * 32], check.signature + 32, 32);
+        memcpy(&P[n * 32], check.publicKey, 32);
+    }
+    crypto::curve25519_verify_batch(vIndexes.size(), Y.data(), v.data(), h.data(), P.data());
+    for (size_t n = 0; n < vIndexes.size(); n++) {
+        const SignatureCheck& check = checks[vIndexes[n]];
+        unsigned char hash[32];
+        CSHA256().Write(check.data, 32).Write(&Y[n * 32], 32).Finalize(hash); // digest(m + Y) => h
+        if (memcmp(hash, check.signature + 32, 32) == 0) {
+            vValid[vIndexes[n]] = true;
+            AddVerifiedSignature(vHashes[n]);
+        }
+    }
+    return vValid;
 }
 
 }
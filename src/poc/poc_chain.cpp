@@ -11,30 +11,46 @@
 #include <consensus/validation.h>
 #include <crypto/curve25519.h>
 #include <crypto/shabal256.h>
+#include <cuckoocache.h>
+#include <hash.h>
 #include <key_io.h>
 #include <logging.h>
 #include <miner.h>
 #include <pos/pos.h>
+#include <random.h>
 #include <rpc/protocol.h>
 #include <rpc/request.h>
+#include <script/sigcache.h>
 #include <threadinterrupt.h>
+#include <threadpool.h>
 #include <timedata.h>
 #include <ui_interface.h>
+#include <util/system.h>
+#include <util/threadnames.h>
 #include <util/time.h>
+#include <util/trace.h>
 #include <util/validation.h>
 #include <validation.h>
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #endif
 
+#include <algorithm>
+#include <array>
 #include <cinttypes>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <limits>
+#include <map>
 #include <string>
 #include <tuple>
 #include <unordered_map>
 
+#include <boost/signals2/connection.hpp>
+#include <boost/thread.hpp>
+
 #include <event2/thread.h>
 
 namespace {
@@ -65,16 +81,41 @@ struct GeneratorState {
 typedef std::unordered_map<uint64_t, GeneratorState> Generators; // Generation low 64bits -> GeneratorState
 Generators mapGenerators GUARDED_BY(cs_main);
 
+// Pre-assembled block template on the tip, see PrepareBlockThread()
+std::unique_ptr<CBlockTemplate> pblocktemplatePrepared GUARDED_BY(cs_main);
+unsigned int nPreparedTransactionsUpdated GUARDED_BY(cs_main) = 0;
+int64_t nPreparedTime GUARDED_BY(cs_main) = 0;
+
 std::shared_ptr<CBlock> CreateBlock(const GeneratorState &generateState)
 {
+    AssertLockHeld(cs_main);
+
     std::unique_ptr<CBlockTemplate> pblocktemplate;
     try {
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(GetScriptForDestination(generateState.dest),
-            generateState.nonce,
-            generateState.best / ::ChainActive().Tip()->nBaseTarget,
-            generateState.plotterId,
-            generateState.pos,
-            generateState.privKey);
+        BlockAssembler assembler(Params());
+        if (pblocktemplatePrepared && pblocktemplatePrepared->block.hashPrevBlock == ::ChainActive().Tip()->GetBlockHash()) {
+            // Only finalize the pre-assembled template. Fallback to a new one when mempool transactions changed
+            try {
+                pblocktemplate.reset(new CBlockTemplate(*pblocktemplatePrepared));
+                assembler.FinalizeNewBlock(*pblocktemplate, GetScriptForDestination(generateState.dest),
+                    generateState.nonce,
+                    generateState.best / ::ChainActive().Tip()->nBaseTarget,
+                    generateState.plotterId,
+                    generateState.pos,
+                    generateState.privKey);
+            } catch (std::exception &e) {
+                LogPrint(BCLog::POC, "Finalize prepared block fail: %s\n", e.what());
+                pblocktemplate.reset();
+            }
+        }
+        if (!pblocktemplate) {
+            pblocktemplate = assembler.CreateNewBlock(GetScriptForDestination(generateState.dest),
+                generateState.nonce,
+                generateState.best / ::ChainActive().Tip()->nBaseTarget,
+                generateState.plotterId,
+                generateState.pos,
+                generateState.privKey);
+        }
     } catch (std::exception &e) {
         const char *what = e.what();
         LogPrintf("CreateBlock() fail: %s\n", what ? what : "Catch unknown exception");
@@ -86,18 +127,357 @@ std::shared_ptr<CBlock> CreateBlock(const GeneratorState &generateState)
     return std::make_shared<CBlock>(*pblock);
 }
 
+//! Create a block competing with the tip, see BlockAssembler::CreateCompetingBlock()
+std::shared_ptr<CBlock> CreateCompetingBlock(const GeneratorState &generateState, const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs_main);
+
+    CBlock tipBlock;
+    if (!ReadBlockFromDisk(tipBlock, pindexTip, Params().GetConsensus())) {
+        LogPrintf("CreateCompetingBlock() fail: read %s\n", pindexTip->ToString());
+        return nullptr;
+    }
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    try {
+        pblocktemplate = BlockAssembler(Params()).CreateCompetingBlock(tipBlock, GetScriptForDestination(generateState.dest),
+            generateState.nonce,
+            generateState.best / pindexTip->pprev->nBaseTarget,
+            generateState.plotterId,
+            generateState.pos,
+            generateState.privKey);
+    } catch (std::exception &e) {
+        const char *what = e.what();
+        LogPrintf("CreateCompetingBlock() fail: %s\n", what ? what : "Catch unknown exception");
+    }
+    if (!pblocktemplate.get())
+        return nullptr;
+
+    return std::make_shared<CBlock>(pblocktemplate->block);
+}
+
 // Mining loop
+static constexpr int64_t PREPARE_BLOCK_REFRESH_INTERVAL = 5;
 CThreadInterrupt interruptCheckDeadline;
-std::thread threadCheckDeadline, threadGenearetePoolsDeadline;
+std::thread threadCheckDeadline, threadGenearetePoolsDeadline, threadPrepareBlock;
+
+// Forge scheduler. Threads sleep until the earliest forge time, a new best deadline or a tip change
+Mutex csForgeSchedule;
+std::condition_variable condForgeSchedule;
+int64_t nNextForgeTime GUARDED_BY(csForgeSchedule) = std::numeric_limits<int64_t>::max();
+bool fForgeRescan GUARDED_BY(csForgeSchedule) = true;
+bool fPoolsRescan GUARDED_BY(csForgeSchedule) = true;
+bool fPrepareRescan GUARDED_BY(csForgeSchedule) = true;
+boost::signals2::connection forge_notify_block_tip_connection;
+
+// Mining info of the tip
+Mutex csMiningInfo;
+std::shared_ptr<const poc::MiningInfo> miningInfo GUARDED_BY(csMiningInfo);
+std::condition_variable condMiningInfo;
+boost::signals2::connection mining_info_block_tip_connection;
+boost::signals2::connection mining_info_best_deadline_connection;
+
+//! The getMiningInfo reply of the PoC HTTP endpoint, see poc::GetMiningJob()
+static std::string MiningInfoReply(const poc::MiningInfo& info)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("height", info.nTipHeight + 1);
+    reply.pushKV("generationSignature", HexStr(info.nextGenerationSignature));
+    reply.pushKV("baseTarget", std::to_string(info.nBaseTarget));
+    reply.pushKV("targetDeadline", poc::GetTargetDeadline(info));
+    reply.pushKV("requestProcessingTime", 0);
+    return reply.write();
+}
+
+void PublishMiningInfo(bool fInitialDownload, const CBlockIndex* pindexTip)
+{
+    if (pindexTip == nullptr)
+        return;
+
+    std::shared_ptr<poc::MiningInfo> info = std::make_shared<poc::MiningInfo>();
+    info->hashTip = pindexTip->GetBlockHash();
+    info->nTipHeight = pindexTip->nHeight;
+    info->nTipTime = pindexTip->GetBlockTime();
+    info->nextGenerationSignature = pindexTip->GetNextGenerationSignature();
+    info->nBaseTarget = pindexTip->nBaseTarget;
+    info->fInitialDownload = fInitialDownload;
+    info->nBestDeadline = std::numeric_limits<uint64_t>::max();
+
+    info->strReply = MiningInfoReply(*info);
+
+    {
+        LOCK(csMiningInfo);
+        miningInfo = info;
+    }
+    condMiningInfo.notify_all();
+}
+
+//! Republish the mining info of the tip when a better deadline for its next block is found
+void PublishBestDeadline(int32_t nHeight, uint64_t nPlotterId, uint64_t nNonce, uint64_t nNewDeadline)
+{
+    {
+        LOCK(csMiningInfo);
+        if (!miningInfo || miningInfo->nTipHeight + 1 != nHeight || nNewDeadline >= miningInfo->nBestDeadline)
+            return;
+        std::shared_ptr<poc::MiningInfo> info = std::make_shared<poc::MiningInfo>(*miningInfo);
+        info->nBestDeadline = nNewDeadline;
+        info->strReply = MiningInfoReply(*info);
+        miningInfo = info;
+    }
+    condMiningInfo.notify_all();
+}
+
+void InterruptMiningInfo()
+{
+    // Waiters check interruptCheckDeadline under csMiningInfo
+    {
+        LOCK(csMiningInfo);
+    }
+    condMiningInfo.notify_all();
+}
+
+// Statistics of recent mining rounds, see poc::GetMiningRounds()
+Mutex csMiningRounds;
+std::deque<poc::MiningRound> dequeMiningRounds GUARDED_BY(csMiningRounds);
+
+//! Find the round mining on the block, start a new one when it is not tracked yet
+poc::MiningRound& GetMiningRound(const CBlockIndex& miningBlockIndex) EXCLUSIVE_LOCKS_REQUIRED(csMiningRounds)
+{
+    const uint256 hashPrevBlock = miningBlockIndex.GetBlockHash();
+    for (auto it = dequeMiningRounds.rbegin(); it != dequeMiningRounds.rend(); ++it) {
+        if (it->hashPrevBlock == hashPrevBlock)
+            return *it;
+    }
+    if (dequeMiningRounds.size() >= poc::MAX_MINING_ROUNDS)
+        dequeMiningRounds.pop_front();
+    dequeMiningRounds.emplace_back();
+    poc::MiningRound& round = dequeMiningRounds.back();
+    round.nHeight = miningBlockIndex.nHeight + 1;
+    round.hashPrevBlock = hashPrevBlock;
+    round.nStartMicros = GetTimeMicros();
+    return round;
+}
+
+void RecordNonce(const CBlockIndex& miningBlockIndex, uint64_t nDeadline)
+{
+    const int64_t nTimeMicros = GetTimeMicros();
+    LOCK(csMiningRounds);
+    poc::MiningRound& round = GetMiningRound(miningBlockIndex);
+    round.nNoncesSubmitted++;
+    if (round.nFirstNonceMicros < 0)
+        round.nFirstNonceMicros = nTimeMicros - round.nStartMicros;
+    if (nDeadline < round.nBestDeadline) {
+        round.nBestDeadline = nDeadline;
+        round.nBestNonceMicros = nTimeMicros - round.nStartMicros;
+        if (round.vBestDeadlines.size() >= poc::MAX_MINING_ROUND_DEADLINES)
+            round.vBestDeadlines.pop_back();
+        round.vBestDeadlines.emplace_back(round.nBestNonceMicros, nDeadline);
+    }
+}
+
+void RecordRejectedNonce(const CBlockIndex& miningBlockIndex)
+{
+    LOCK(csMiningRounds);
+    poc::MiningRound& round = GetMiningRound(miningBlockIndex);
+    round.nNoncesSubmitted++;
+    round.nNoncesRejected++;
+}
+
+void RecordForge(const CBlockIndex& miningBlockIndex, int64_t nMatureTime, int64_t nForgeMicros, int64_t nCreateBlockMicros,
+    const CBlock* pblock, bool fSnatch)
+{
+    LOCK(csMiningRounds);
+    poc::MiningRound& round = GetMiningRound(miningBlockIndex);
+    round.fForged = true;
+    round.fSnatch = fSnatch;
+    round.nMatureTime = nMatureTime;
+    round.nForgeMicros = nForgeMicros;
+    round.nCreateBlockMicros = nCreateBlockMicros;
+    round.hashForged = pblock ? pblock->GetHash() : uint256();
+}
+
+//! Settle the round the new tip was mined in, and start the round on the new tip
+void RecordRoundResult(const CBlockIndex& indexTip)
+{
+    LOCK(csMiningRounds);
+    if (indexTip.pprev != nullptr) {
+        const uint256 hashPrevBlock = indexTip.pprev->GetBlockHash();
+        for (auto it = dequeMiningRounds.rbegin(); it != dequeMiningRounds.rend(); ++it) {
+            if (it->hashPrevBlock != hashPrevBlock)
+                continue;
+            it->hashWinner = indexTip.GetBlockHash();
+            it->nWinnerDeadline = indexTip.GetBlockTime() - indexTip.pprev->GetBlockTime();
+            if (!it->hashForged.IsNull() && it->hashForged == it->hashWinner) {
+                it->fForgedWasTip = true;
+                it->result = poc::MiningRoundResult::WON;
+            } else if (it->fForgedWasTip) {
+                it->result = poc::MiningRoundResult::SNATCHED;
+            } else if (it->nBestDeadline != poc::INVALID_DEADLINE && (int64_t)it->nBestDeadline < it->nWinnerDeadline) {
+                it->result = poc::MiningRoundResult::OUT_RACED;
+            } else {
+                it->result = poc::MiningRoundResult::LOST;
+            }
+            break;
+        }
+    }
+    GetMiningRound(indexTip);
+}
+
+//! Wake forge thread at adjusted time nForgeTime - 1, see CheckDeadlineThread()
+void ScheduleForge(int64_t nForgeTime)
+{
+    {
+        LOCK(csForgeSchedule);
+        if (nForgeTime >= nNextForgeTime)
+            return;
+        nNextForgeTime = nForgeTime;
+    }
+    condForgeSchedule.notify_all();
+}
+
+//! Wake forge thread to check all generators
+void RescanForge()
+{
+    {
+        LOCK(csForgeSchedule);
+        fForgeRescan = true;
+    }
+    condForgeSchedule.notify_all();
+}
+
+void ForgeNotifyBlockTip(bool fInitialDownload, const CBlockIndex* pindexNew)
+{
+    if (!fInitialDownload && pindexNew != nullptr)
+        RecordRoundResult(*pindexNew);
+    {
+        LOCK(csForgeSchedule);
+        fForgeRescan = true;
+        fPoolsRescan = true;
+        fPrepareRescan = true;
+    }
+    condForgeSchedule.notify_all();
+}
+
+//! Wake prepare thread to assemble template for a new best deadline
+void RequestPrepareBlock()
+{
+    {
+        LOCK(csForgeSchedule);
+        fPrepareRescan = true;
+    }
+    condForgeSchedule.notify_all();
+}
+
+void InterruptForgeSchedule()
+{
+    // Waiters check interruptCheckDeadline under csForgeSchedule
+    {
+        LOCK(csForgeSchedule);
+    }
+    condForgeSchedule.notify_all();
+}
+
+//! Return false when interrupted
+bool WaitForgeEvent()
+{
+    WAIT_LOCK(csForgeSchedule, lock);
+    while (!interruptCheckDeadline && !fForgeRescan) {
+        if (nNextForgeTime == std::numeric_limits<int64_t>::max()) {
+            condForgeSchedule.wait(lock);
+            continue;
+        }
+        if (GetAdjustedTime() + 1 >= nNextForgeTime)
+            break;
+        // Mock time does not move with the clock, recheck it periodically
+        int64_t nWaitMillis = 500;
+        if (GetMockTime() == 0)
+            nWaitMillis = std::max((nNextForgeTime - 1 - GetTimeOffset()) * 1000 - GetTimeMillis(), (int64_t) 1);
+        condForgeSchedule.wait_for(lock, std::chrono::milliseconds(nWaitMillis));
+    }
+    fForgeRescan = false;
+    nNextForgeTime = std::numeric_limits<int64_t>::max();
+    return !interruptCheckDeadline;
+}
+
+//! Return false when interrupted
+bool WaitPoolsEvent()
+{
+    WAIT_LOCK(csForgeSchedule, lock);
+    while (!interruptCheckDeadline && !fPoolsRescan) {
+        condForgeSchedule.wait(lock);
+    }
+    fPoolsRescan = false;
+    return !interruptCheckDeadline;
+}
+
+//! Return false when interrupted. Timeout to refresh the template on mempool changes
+bool WaitPrepareEvent()
+{
+    WAIT_LOCK(csForgeSchedule, lock);
+    if (!interruptCheckDeadline && !fPrepareRescan)
+        condForgeSchedule.wait_for(lock, std::chrono::seconds(PREPARE_BLOCK_REFRESH_INTERVAL));
+    fPrepareRescan = false;
+    return !interruptCheckDeadline;
+}
+
+void PrepareBlockThread()
+{
+    util::ThreadRename("bitcoin-prepareblock");
+    while (!interruptCheckDeadline) {
+        if (!WaitPrepareEvent())
+            break;
+
+        {
+            LOCK(cs_main);
+            if (::ChainstateActive().IsInitialBlockDownload())
+                continue;
+            // Only for pending generator of current round
+            const CBlockIndex *pindexTip = ::ChainActive().Tip();
+            if (!mapGenerators.count(pindexTip->GetNextGenerationSignature().GetUint64(0))) {
+                pblocktemplatePrepared.reset();
+                continue;
+            }
+            // Same as getblocktemplate, refresh when mempool changed and template older than 5 seconds
+            if (pblocktemplatePrepared && pblocktemplatePrepared->block.hashPrevBlock == pindexTip->GetBlockHash() &&
+                (mempool.GetTransactionsUpdated() == nPreparedTransactionsUpdated || GetTime() - nPreparedTime < PREPARE_BLOCK_REFRESH_INTERVAL))
+                continue;
+        }
+
+        try {
+            const unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+            const int64_t nTime = GetTime();
+            std::unique_ptr<CBlockTemplate> pblocktemplate;
+            {
+                // Appending what entered the mempool is much cheaper than selecting all over again
+                LOCK(cs_main);
+                if (pblocktemplatePrepared)
+                    pblocktemplate = BlockAssembler(Params()).UpdatePreparedBlock(*pblocktemplatePrepared);
+            }
+            if (!pblocktemplate)
+                pblocktemplate = BlockAssembler(Params()).PrepareNewBlock();
+            LOCK(cs_main);
+            if (pblocktemplate && pblocktemplate->block.hashPrevBlock == ::ChainActive().Tip()->GetBlockHash()) {
+                pblocktemplatePrepared = std::move(pblocktemplate);
+                nPreparedTransactionsUpdated = nTransactionsUpdated;
+                nPreparedTime = nTime;
+                LogPrint(BCLog::POC, "Prepared block: height=%d, txs=%u\n", ::ChainActive().Height() + 1, pblocktemplatePrepared->block.vtx.size() - 1);
+            }
+        } catch (std::exception &e) {
+            LogPrintf("PrepareNewBlock() fail: %s\n", e.what());
+        }
+    }
+}
+
 void CheckDeadlineThread()
 {
     util::ThreadRename("bitcoin-checkdeadline");
     while (!interruptCheckDeadline) {
-        if (!interruptCheckDeadline.sleep_for(std::chrono::milliseconds(500)))
+        if (!WaitForgeEvent())
             break;
 
         std::shared_ptr<CBlock> pblock;
         CBlockIndex *pTrySnatchTip = nullptr;
+        int64_t nForgeTime = std::numeric_limits<int64_t>::max();
         {
             LOCK(cs_main);
             if (!mapGenerators.empty()) {
@@ -115,7 +495,10 @@ void CheckDeadlineThread()
                             // Forge
                             LogPrint(BCLog::POC, "Generate block: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 ", deadline=%" PRIu64 "\n",
                                 it->second.height, it->second.nonce, it->second.plotterId, deadline);
+                            int64_t nTimeStart = GetTimeMicros();
                             pblock = CreateBlock(it->second);
+                            RecordForge(*pindexTip, (int64_t)pindexTip->nTime + (int64_t)deadline, nTimeStart + GetTimeOffset() * 1000000,
+                                GetTimeMicros() - nTimeStart, pblock.get(), false);
                             if (!pblock) {
                                 LogPrintf("Generate block fail: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 ", deadline=%" PRIu64 "\n",
                                     it->second.height, it->second.nonce, it->second.plotterId, deadline);
@@ -123,6 +506,7 @@ void CheckDeadlineThread()
                                 LogPrint(BCLog::POC, "Created block: hash=%s, time=%d\n", pblock->GetHash().ToString(), pblock->nTime);
                             }
                         } else {
+                            nForgeTime = std::min(nForgeTime, (int64_t)pindexTip->nTime + (int64_t)deadline);
                             ++it;
                             continue;
                         }
@@ -148,41 +532,33 @@ void CheckDeadlineThread()
                 continue;
             }
         }
+        if (nForgeTime != std::numeric_limits<int64_t>::max())
+            ScheduleForge(nForgeTime);
 
-        //! Try snatch block
+        //! Try snatch block. Build on the previous block of the tip, ActivateBestChain() picks the higher chainwork
         if (pTrySnatchTip != nullptr) {
             assert(pblock == nullptr);
-            CValidationState state;
-            if (!InvalidateBlock(state, Params(), pTrySnatchTip)) {
-                LogPrint(BCLog::POC, "Snatch block fail: invalidate %s got\n\t%s\n", pTrySnatchTip->ToString(), state.GetRejectReason());
-            } else {
-                {
-                    LOCK(cs_main);
-                    ResetBlockFailureFlags(pTrySnatchTip);
-
-                    auto itDummyProof = mapGenerators.find(pTrySnatchTip->GetGenerationSignature().GetUint64(0));
-                    if (itDummyProof != mapGenerators.end()) {
-                        pblock = CreateBlock(itDummyProof->second);
-                        if (!pblock) {
-                            LogPrintf("Snatch block fail: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 "\n",
-                                itDummyProof->second.height, itDummyProof->second.nonce, itDummyProof->second.plotterId);
-                        } else if (GetBlockProof(*pblock, Params().GetConsensus()) <= GetBlockProof(*pTrySnatchTip, Params().GetConsensus())) {
-                            //! Lowest chainwork, give up
-                            LogPrintf("Snatch block give up: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 "\n",
-                                itDummyProof->second.height, itDummyProof->second.nonce, itDummyProof->second.plotterId);
-                            pblock.reset();
-                        } else {
-                            LogPrint(BCLog::POC, "Snatch block success: height=%d, hash=%s\n", itDummyProof->second.height, pblock->GetHash().ToString());
-                        }
+            LOCK(cs_main);
+            auto itDummyProof = mapGenerators.find(pTrySnatchTip->GetGenerationSignature().GetUint64(0));
+            if (itDummyProof != mapGenerators.end()) {
+                if (::ChainActive().Tip() == pTrySnatchTip) {
+                    int64_t nTimeStart = GetTimeMicros();
+                    pblock = CreateCompetingBlock(itDummyProof->second, pTrySnatchTip);
+                    RecordForge(*pTrySnatchTip->pprev, pTrySnatchTip->pprev->GetBlockTime() + (int64_t)(itDummyProof->second.best / pTrySnatchTip->pprev->nBaseTarget),
+                        nTimeStart + GetTimeOffset() * 1000000, GetTimeMicros() - nTimeStart, pblock.get(), true);
+                    if (!pblock) {
+                        LogPrintf("Snatch block fail: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 "\n",
+                            itDummyProof->second.height, itDummyProof->second.nonce, itDummyProof->second.plotterId);
+                    } else if (GetBlockProof(*pblock, Params().GetConsensus()) <= GetBlockProof(*pTrySnatchTip, Params().GetConsensus())) {
+                        //! Lowest chainwork, give up
+                        LogPrintf("Snatch block give up: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 "\n",
+                            itDummyProof->second.height, itDummyProof->second.nonce, itDummyProof->second.plotterId);
+                        pblock.reset();
+                    } else {
+                        LogPrint(BCLog::POC, "Snatch block success: height=%d, hash=%s\n", itDummyProof->second.height, pblock->GetHash().ToString());
                     }
-                    mapGenerators.erase(itDummyProof);
-                }
-
-                //! Reset best
-                if (!ActivateBestChain(state, Params())) {
-                    LogPrintf("Activate best chain fail: %s\n", __func__, FormatStateMessage(state));
-                    assert (false);
                 }
+                mapGenerators.erase(itDummyProof);
             }
         }
 
@@ -197,70 +573,140 @@ void CheckDeadlineThread()
 typedef std::unordered_map< uint64_t, std::shared_ptr<CKey> > CPrivKeyMap;
 CPrivKeyMap mapSignaturePrivKeys;
 
+// Best staking pool nonces by <height, epoch hash, pool, vote power>. Upcoming heights of the epoch are
+// precomputed between blocks, so that a new tip only looks them up. Only used by the pools thread
+static constexpr int POOL_NONCES_LOOKAHEAD = 2;
+typedef std::tuple<int, uint256, CAccountID, uint64_t> PoolNoncesKey;
+std::map<PoolNoncesKey, std::pair<uint64_t, uint64_t>> mapPoolNonces;
+
+std::pair<uint64_t, uint64_t> GetPoolNonces(const uint256 &epochHash, int nHeight, const CAccountID &poolID, uint64_t votePower)
+{
+    const PoolNoncesKey key(nHeight, epochHash, poolID, votePower);
+    auto it = mapPoolNonces.find(key);
+    if (it == mapPoolNonces.end())
+        it = mapPoolNonces.emplace(key, pos::GenerateStakingPoolNonces(epochHash, nHeight, poolID, votePower)).first;
+    return it->second;
+}
+
+//! A new tip is waiting for the pools thread
+bool IsPoolsEventPending()
+{
+    LOCK(csForgeSchedule);
+    return fPoolsRescan;
+}
+
 void GenearetePoolsDeadlineThread()
 {
     util::ThreadRename("bitcoin-generatepoolsdeadline");
 
     uint256 preProcessBlockHash;
     while (!interruptCheckDeadline) {
-        if (!interruptCheckDeadline.sleep_for(std::chrono::milliseconds(500)))
+        if (!WaitPoolsEvent())
             break;
 
-        LOCK(cs_main);
-        if (::ChainstateActive().IsInitialBlockDownload())
-            continue;
-        auto const &params = Params().GetConsensus();
-        CBlockIndex *pindexTip = ::ChainActive().Tip();
-        if (pindexTip->nHeight + 1 < params.nSaturnActiveHeight || pindexTip->GetBlockHash() == preProcessBlockHash)
-            continue;
-        const uint256 epochHash = GetEpochHash(pindexTip, params);
-        bool fSubmittedNewNonce = false;
-        for (const auto &pool : ::ChainstateActive().CoinsTip().GetStakingPools(epochHash)) {
-            CTxDestination poolDest = ExtractDestination(pool.poolID);
-            auto itPrivateKey = mapSignaturePrivKeys.find(boost::get<ScriptHash>(&poolDest)->GetUint64(0));
-            if (itPrivateKey == mapSignaturePrivKeys.end())
+        // Our pools of the next block, collected under cs_main
+        struct PoolTask {
+            CAccountID poolID;
+            CTxDestination dest;
+            std::shared_ptr<CKey> privKey;
+            uint64_t votePower;
+            std::pair<uint64_t, uint64_t> result;
+        };
+        std::vector<PoolTask> vTasks;
+        uint256 epochHash, tipHash;
+        int nTargetHeight, nEpochBlocks;
+        {
+            LOCK(cs_main);
+            if (::ChainstateActive().IsInitialBlockDownload())
                 continue;
-
-            auto result = pos::GenerateStakingPoolNonces(epochHash, pindexTip->nHeight + 1, pool.poolID, (uint64_t)(pool.stakeAmount / COIN));
-            GeneratorState &generatorState = mapGenerators[pindexTip->GetNextGenerationSignature().GetUint64(0)];
-            generatorState.SetNull();
-            generatorState.best      = result.second;
-            generatorState.height    = pindexTip->nHeight + 1;
-            generatorState.nonce     = result.first;
-            generatorState.dest      = poolDest;
-            generatorState.privKey   = itPrivateKey->second;
-            generatorState.plotterId = pool.poolID.GetUint64(0);
-
-            LogPrintf("%s %d: New pool %s deadline %" PRIu64 ".\n", epochHash.ToString(), pindexTip->nHeight + 1,
-                EncodeDestination(poolDest), generatorState.best / pindexTip->nBaseTarget);
-
-            if (params.fAllowMinDifficultyBlocks) {
-                generatorState.best  = static_cast<uint64_t>(params.nPowTargetSpacing) * pindexTip->nBaseTarget;
+            auto const &params = Params().GetConsensus();
+            CBlockIndex *pindexTip = ::ChainActive().Tip();
+            if (pindexTip->nHeight + 1 < params.nSaturnActiveHeight || pindexTip->GetBlockHash() == preProcessBlockHash)
+                continue;
+            epochHash = GetEpochHash(pindexTip, params);
+            tipHash = pindexTip->GetBlockHash();
+            nTargetHeight = pindexTip->nHeight + 1;
+            nEpochBlocks = params.nSaturnEpockBlocks;
+            for (const auto &pool : ::ChainstateActive().CoinsTip().GetStakingPools(epochHash)) {
+                CTxDestination poolDest = ExtractDestination(pool.poolID);
+                auto itPrivateKey = mapSignaturePrivKeys.find(boost::get<ScriptHash>(&poolDest)->GetUint64(0));
+                if (itPrivateKey == mapSignaturePrivKeys.end())
+                    continue;
+                vTasks.push_back(PoolTask{pool.poolID, poolDest, itPrivateKey->second, (uint64_t)(pool.stakeAmount / COIN), {}});
             }
+        }
 
-            fSubmittedNewNonce = true;
+        // The nonces only depend on the epoch hash and the height
+        mapPoolNonces.erase(mapPoolNonces.begin(), mapPoolNonces.lower_bound(PoolNoncesKey(nTargetHeight, uint256(), CAccountID(), 0)));
+        for (auto &task : vTasks) {
+            task.result = GetPoolNonces(epochHash, nTargetHeight, task.poolID, task.votePower);
+            if (interruptCheckDeadline)
+                return;
         }
-        if (!fSubmittedNewNonce && params.fAllowMinDifficultyBlocks) {
-            // for Regtest
-            auto itPrivateKey = mapSignaturePrivKeys.cbegin();
-            CScript scriptPubKey = GetScriptForPubKey(itPrivateKey->second->GetPubKey());
-            CTxDestination poolDest = ExtractDestination(scriptPubKey);
-            CAccountID poolID = ExtractAccountID(scriptPubKey);
 
-            GeneratorState &generatorState = mapGenerators[pindexTip->GetNextGenerationSignature().GetUint64(0)];
-            generatorState.SetNull();
-            generatorState.best      = static_cast<uint64_t>(params.nPowTargetSpacing) * pindexTip->nBaseTarget;
-            generatorState.height    = pindexTip->nHeight + 1;
-            generatorState.nonce     = 1;
-            generatorState.dest      = poolDest;
-            generatorState.privKey   = itPrivateKey->second;
-            generatorState.plotterId = poolID.GetUint64(0);
+        {
+            LOCK(cs_main);
+            auto const &params = Params().GetConsensus();
+            CBlockIndex *pindexTip = ::ChainActive().Tip();
+            if (pindexTip->GetBlockHash() != tipHash) {
+                // Tip moved while generating, the next round picks up the new tip
+                continue;
+            }
+            bool fSubmittedNewNonce = false;
+            for (const auto &task : vTasks) {
+                GeneratorState &generatorState = mapGenerators[pindexTip->GetNextGenerationSignature().GetUint64(0)];
+                generatorState.SetNull();
+                generatorState.best      = task.result.second;
+                generatorState.height    = pindexTip->nHeight + 1;
+                generatorState.nonce     = task.result.first;
+                generatorState.dest      = task.dest;
+                generatorState.privKey   = task.privKey;
+                generatorState.plotterId = task.poolID.GetUint64(0);
+
+                LogPrintf("%s %d: New pool %s deadline %" PRIu64 ".\n", epochHash.ToString(), pindexTip->nHeight + 1,
+                    EncodeDestination(task.dest), generatorState.best / pindexTip->nBaseTarget);
+
+                if (params.fAllowMinDifficultyBlocks) {
+                    generatorState.best  = static_cast<uint64_t>(params.nPowTargetSpacing) * pindexTip->nBaseTarget;
+                }
+
+                fSubmittedNewNonce = true;
+            }
+            if (!fSubmittedNewNonce && params.fAllowMinDifficultyBlocks) {
+                // for Regtest
+                auto itPrivateKey = mapSignaturePrivKeys.cbegin();
+                CScript scriptPubKey = GetScriptForPubKey(itPrivateKey->second->GetPubKey());
+                CTxDestination poolDest = ExtractDestination(scriptPubKey);
+                CAccountID poolID = ExtractAccountID(scriptPubKey);
+
+                GeneratorState &generatorState = mapGenerators[pindexTip->GetNextGenerationSignature().GetUint64(0)];
+                generatorState.SetNull();
+                generatorState.best      = static_cast<uint64_t>(params.nPowTargetSpacing) * pindexTip->nBaseTarget;
+                generatorState.height    = pindexTip->nHeight + 1;
+                generatorState.nonce     = 1;
+                generatorState.dest      = poolDest;
+                generatorState.privKey   = itPrivateKey->second;
+                generatorState.plotterId = poolID.GetUint64(0);
+
+                LogPrintf("%s %d: New Regtest pool %s deadline %" PRIu64 ".\n", epochHash.ToString(), pindexTip->nHeight + 1,
+                    EncodeDestination(poolDest), generatorState.best / pindexTip->nBaseTarget);
+            }
 
-            LogPrintf("%s %d: New Regtest pool %s deadline %" PRIu64 ".\n", epochHash.ToString(), pindexTip->nHeight + 1,
-                EncodeDestination(poolDest), generatorState.best / pindexTip->nBaseTarget);
+            preProcessBlockHash = pindexTip->GetBlockHash();
+            RescanForge();
         }
 
-        preProcessBlockHash = pindexTip->GetBlockHash();
+        // Lookahead the following heights of this epoch until the next tip arrives
+        bool fAbort = false;
+        for (int nHeight = nTargetHeight + 1; !fAbort && nHeight <= nTargetHeight + POOL_NONCES_LOOKAHEAD; nHeight++) {
+            if ((nHeight - 1) / nEpochBlocks != (nTargetHeight - 1) / nEpochBlocks)
+                break;
+            for (const auto &task : vTasks) {
+                if ((fAbort = interruptCheckDeadline || IsPoolsEventPending()))
+                    break;
+                GetPoolNonces(epochHash, nHeight, task.poolID, task.votePower);
+            }
+        }
     }
 }
 
@@ -268,69 +714,148 @@ void GenearetePoolsDeadlineThread()
 
 namespace poc {
 
-static constexpr int HASH_SIZE = 32;
-static constexpr int HASHES_PER_SCOOP = 2;
-static constexpr int SCOOP_SIZE = HASHES_PER_SCOOP * HASH_SIZE; // 2 hashes per scoop
-static constexpr int SCOOPS_PER_PLOT = 4096;
-static constexpr int PLOT_SIZE = SCOOPS_PER_PLOT * SCOOP_SIZE; // 256KB
-static std::unique_ptr<unsigned char> calcDLDataCache(new unsigned char[PLOT_SIZE + 16]); // Global calc cache
+//! Per-thread plot buffer, so that deadlines can be calculated concurrently
+static unsigned char* GetPlotScratch(size_t nLanes)
+{
+    static thread_local std::vector<unsigned char> vScratch;
+    if (vScratch.size() < nLanes * (PLOT_SIZE + 16))
+        vScratch.resize(nLanes * (PLOT_SIZE + 16));
+    return vScratch.data();
+}
+
+/** Generation signature and scoop of the block a nonce is mined for */
+struct CDeadlineTarget
+{
+    uint256 generationSignature;
+    uint32_t nScoop;
+
+    CDeadlineTarget() : nScoop(0) {}
+    CDeadlineTarget(int nHeight, const uint256& generationSignatureIn) : generationSignature(generationSignatureIn)
+    {
+        // Scoop only depends on generation signature and height
+        uint256 temp;
+        const uint64_t height_be = htobe64(static_cast<uint64_t>(nHeight));
+        CShabal256()
+            .Write(generationSignature.begin(), generationSignature.size())
+            .Write((const unsigned char*)&height_be, 8)
+            .Finalize((unsigned char*)temp.begin());
+        nScoop = (uint32_t) (temp.begin()[31] + 256 * temp.begin()[30]) % 4096;
+    }
+};
+
+uint32_t GetScoop(int nHeight, const uint256& generationSignature)
+{
+    return CDeadlineTarget(nHeight, generationSignature).nScoop;
+}
+
+/**
+ * Thread safe. Nonces are hashed in parallel by the multi-lane Shabal256. The plot of a nonce doesn't
+ * depend on the target, so nonces of different blocks share lanes: vTargets holds either one target
+ * for all nonces or one target per nonce.
+ */
+static void CalcDLBatch(const std::vector<CDeadlineTarget>& vTargets,
+    const std::vector<std::pair<uint64_t, uint64_t>>& vPlotterNonces, uint64_t* pDeadlines)
+{
+    assert(vTargets.size() == 1 || vTargets.size() == vPlotterNonces.size());
+    TRACE2(poc, calcdl_entry, vPlotterNonces.size(), vTargets.size());
+    const size_t nLanes = std::min(vPlotterNonces.size(), std::max(Shabal256MaxLanes(), (size_t) 4));
+    unsigned char *const vData = GetPlotScratch(nLanes);
+    std::vector<std::array<unsigned char, HASH_SIZE + SCOOP_SIZE>> vScoops(nLanes);
+    std::vector<uint256> vTemp(nLanes);
+    std::vector<const unsigned char*> vIn(nLanes);
+    std::vector<unsigned char*> vOut(nLanes);
+
+    for (size_t nOffset = 0; nOffset < vPlotterNonces.size(); nOffset += nLanes) {
+        const size_t nCount = std::min(nLanes, vPlotterNonces.size() - nOffset);
+
+        // Row data
+        for (size_t n = 0; n < nCount; n++) {
+            unsigned char *const data = &vData[n * (PLOT_SIZE + 16)];
+            const uint64_t plotterId_be = htobe64(vPlotterNonces[nOffset + n].first);
+            const uint64_t nonce_be = htobe64(vPlotterNonces[nOffset + n].second);
+            memcpy(data + PLOT_SIZE, (const unsigned char*)&plotterId_be, 8);
+            memcpy(data + PLOT_SIZE + 8, (const unsigned char*)&nonce_be, 8);
+        }
+        for (int i = PLOT_SIZE; i > 0; i -= HASH_SIZE) {
+            int len = PLOT_SIZE + 16 - i;
+            if (len > SCOOPS_PER_PLOT) {
+                len = SCOOPS_PER_PLOT;
+            }
+
+            for (size_t n = 0; n < nCount; n++) {
+                vIn[n] = &vData[n * (PLOT_SIZE + 16) + i];
+                vOut[n] = &vData[n * (PLOT_SIZE + 16) + i - HASH_SIZE];
+            }
+            Shabal256Lanes(vOut.data(), vIn.data(), len, nCount);
+        }
+        // Final
+        for (size_t n = 0; n < nCount; n++) {
+            vIn[n] = &vData[n * (PLOT_SIZE + 16)];
+            vOut[n] = vTemp[n].begin();
+        }
+        Shabal256Lanes(vOut.data(), vIn.data(), PLOT_SIZE + 16, nCount);
+
+        // PoC2 Rearrangement. Only the two hashes of the scoop are required
+        for (size_t n = 0; n < nCount; n++) {
+            const unsigned char *const data = &vData[n * (PLOT_SIZE + 16)];
+            const CDeadlineTarget& target = vTargets[vTargets.size() == 1 ? 0 : nOffset + n];
+            const uint32_t scoop = target.nScoop;
+            unsigned char *const result = vScoops[n].data();
+            memcpy(result, target.generationSignature.begin(), HASH_SIZE);
+            memcpy(result + HASH_SIZE, data + scoop * SCOOP_SIZE, HASH_SIZE);
+            memcpy(result + HASH_SIZE * 2, data + (SCOOPS_PER_PLOT - scoop) * SCOOP_SIZE - HASH_SIZE, HASH_SIZE);
+            // Offsets of both hashes are multiples of HASH_SIZE, so the final XOR pattern starts at byte 0
+            for (int i = HASH_SIZE; i < HASH_SIZE + SCOOP_SIZE; i++) {
+                result[i] = (unsigned char) (result[i] ^ vTemp[n].begin()[i % HASH_SIZE]);
+            }
+            vIn[n] = result;
+            vOut[n] = vTemp[n].begin();
+        }
+
+        // Result
+        Shabal256Lanes(vOut.data(), vIn.data(), HASH_SIZE + SCOOP_SIZE, nCount);
+        for (size_t n = 0; n < nCount; n++) {
+            pDeadlines[nOffset + n] = vTemp[n].GetUint64(0);
+        }
+    }
+    TRACE1(poc, calcdl_exit, vPlotterNonces.size());
+}
+
+//! Thread safe
+static uint64_t CalcDL(int nHeight, const uint256& generationSignature, const uint64_t& nPlotterId, const uint64_t& nNonce) {
+    uint64_t deadline = INVALID_DEADLINE;
+    CalcDLBatch({CDeadlineTarget(nHeight, generationSignature)}, {{nPlotterId, nNonce}}, &deadline);
+    return deadline;
+}
+
+static int nDeadlineCheckThreads = 0;
+
+//! Thread safe. Split to groups as wide as the multi-lane Shabal256 and run on the shared thread pool, see CalcDLBatch()
+static void CalcDLParallel(const std::vector<CDeadlineTarget>& vTargets,
+    const std::vector<std::pair<uint64_t, uint64_t>>& vPlotterNonces, uint64_t* pDeadlines)
+{
+    const size_t nLanes = std::max(Shabal256MaxLanes(), (size_t) 4);
+    if (nDeadlineCheckThreads == 0 || vPlotterNonces.size() <= nLanes) {
+        CalcDLBatch(vTargets, vPlotterNonces, pDeadlines);
+        return;
+    }
+
+    const size_t nGroups = (vPlotterNonces.size() + nLanes - 1) / nLanes;
+    const int nSlices = (int) std::min(nGroups, (size_t) nDeadlineCheckThreads);
+    GetThreadPool().RunParallel(TaskPriority::MINING, nSlices, [&](int nSlice) {
+        const size_t nBegin = std::min(nGroups * nSlice / nSlices * nLanes, vPlotterNonces.size());
+        const size_t nEnd = std::min(nGroups * (nSlice + 1) / nSlices * nLanes, vPlotterNonces.size());
+        for (size_t nOffset = nBegin; nOffset < nEnd; nOffset += nLanes) {
+            const size_t nCount = std::min(nLanes, nEnd - nOffset);
+            std::vector<CDeadlineTarget> vGroupTargets = vTargets.size() == 1 ? vTargets :
+                std::vector<CDeadlineTarget>(vTargets.begin() + nOffset, vTargets.begin() + nOffset + nCount);
+            std::vector<std::pair<uint64_t, uint64_t>> vGroup(vPlotterNonces.begin() + nOffset, vPlotterNonces.begin() + nOffset + nCount);
+            CalcDLBatch(vGroupTargets, vGroup, pDeadlines + nOffset);
+        }
+    });
+}
 
 //! Thread safe
-static uint64_t CalcDL(int nHeight, const uint256& generationSignature, const uint64_t& nPlotterId, const uint64_t& nNonce, const Consensus::Params& params) {
-    CShabal256 shabal256;
-    uint256 temp;
-
-    // Row data
-    const uint64_t plotterId_be = htobe64(nPlotterId);
-    const uint64_t nonce_be = htobe64(nNonce);
-    unsigned char *const data = calcDLDataCache.get();
-    memcpy(data + PLOT_SIZE, (const unsigned char*)&plotterId_be, 8);
-    memcpy(data + PLOT_SIZE + 8, (const unsigned char*)&nonce_be, 8);
-    for (int i = PLOT_SIZE; i > 0; i -= HASH_SIZE) {
-        int len = PLOT_SIZE + 16 - i;
-        if (len > SCOOPS_PER_PLOT) {
-            len = SCOOPS_PER_PLOT;
-        }
-
-        shabal256
-            .Write(data + i, len)
-            .Finalize(data + i - HASH_SIZE);
-    }
-    // Final
-    shabal256
-        .Write(data, PLOT_SIZE + 16)
-        .Finalize(temp.begin());
-    for (int i = 0; i < PLOT_SIZE; i++) {
-        data[i] = (unsigned char) (data[i] ^ (temp.begin()[i % HASH_SIZE]));
-    }
-
-    // Scoop
-    const uint64_t height_be = htobe64(static_cast<uint64_t>(nHeight));
-    shabal256
-        .Write(generationSignature.begin(), generationSignature.size())
-        .Write((const unsigned char*)&height_be, 8)
-        .Finalize((unsigned char*)temp.begin());
-    const uint32_t scoop = (uint32_t) (temp.begin()[31] + 256 * temp.begin()[30]) % 4096;
-
-    // PoC2 Rearrangement. Swap high hash
-    //
-    // [0] [1] [2] [3] ... [N-1]
-    // [1] <-> [N-1]
-    // [2] <-> [N-2]
-    // [3] <-> [N-3]
-    //
-    // Only care hash data of scoop index
-    memcpy(data + scoop * SCOOP_SIZE + HASH_SIZE, data + (SCOOPS_PER_PLOT - scoop) * SCOOP_SIZE - HASH_SIZE, HASH_SIZE);
-
-    // Result
-    shabal256
-        .Write(generationSignature.begin(), generationSignature.size())
-        .Write(data + scoop * SCOOP_SIZE, SCOOP_SIZE)
-        .Finalize(temp.begin());
-    return temp.GetUint64(0);
-}
-
-//! Thread unsafe
 static uint64_t CalculateUnformattedDeadline(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params)
 {
     // Pre-mining
@@ -348,7 +873,7 @@ static uint64_t CalculateUnformattedDeadline(const CBlockIndex& prevBlockIndex,
             return static_cast<uint64_t>(params.nPowTargetSpacing) * prevBlockIndex.nBaseTarget;
 
         const CBlockIndex* pEpochInitIndex = GetEpochInitIndex(&prevBlockIndex, params);
-        const CAccountID poolID = ExtractAccountID(CPubKey(block.vchPubKey));
+        const CAccountID poolID = ExtractAccountID(CPubKey(block.vchPubKey.begin(), block.vchPubKey.end()));
         const uint32_t height_be = htobe32(prevBlockIndex.nHeight + 1);
         const uint64_t nonce_be = htobe64(block.nNonce);
 
@@ -383,15 +908,91 @@ static uint64_t CalculateUnformattedDeadline(const CBlockIndex& prevBlockIndex,
     }
 
     // 3.for PoC block
-    return CalcDL(prevBlockIndex.nHeight + 1, prevBlockIndex.GetNextGenerationSignature(), block.nPlotterId, block.nNonce, params);
+    return CalcDL(prevBlockIndex.nHeight + 1, prevBlockIndex.GetNextGenerationSignature(), block.nPlotterId, block.nNonce);
 }
 
-// Require hold cs_main
 uint64_t CalculateDeadline(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params)
 {
     return CalculateUnformattedDeadline(prevBlockIndex, block, params) / prevBlockIndex.nBaseTarget;
 }
 
+//! Thread safe. Same as CalculateUnformattedDeadline for many blocks
+static std::vector<uint64_t> CalculateUnformattedDeadlines(const CBlockIndex& prevBlockIndex, const std::vector<CBlockHeader>& blocks, const Consensus::Params& params)
+{
+    std::vector<uint64_t> vDeadlines(blocks.size());
+
+    // Collect PoC nonces for the batch engine, see CalculateUnformattedDeadline()
+    std::vector<size_t> vBatchIndexes;
+    std::vector<std::pair<uint64_t, uint64_t>> vPlotterNonces;
+    const bool fPoC = prevBlockIndex.nHeight > 1 && !params.fAllowMinDifficultyBlocks && prevBlockIndex.nHeight + 1 < params.nSaturnActiveHeight;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (fPoC && blocks[i].pos.IsNull()) {
+            vBatchIndexes.push_back(i);
+            vPlotterNonces.emplace_back(blocks[i].nPlotterId, blocks[i].nNonce);
+        } else {
+            vDeadlines[i] = CalculateUnformattedDeadline(prevBlockIndex, blocks[i], params);
+        }
+    }
+
+    if (!vPlotterNonces.empty()) {
+        std::vector<uint64_t> vBatchDeadlines(vPlotterNonces.size());
+        CalcDLParallel({CDeadlineTarget(prevBlockIndex.nHeight + 1, prevBlockIndex.GetNextGenerationSignature())}, vPlotterNonces, vBatchDeadlines.data());
+        for (size_t i = 0; i < vBatchIndexes.size(); i++) {
+            vDeadlines[vBatchIndexes[i]] = vBatchDeadlines[i];
+        }
+    }
+
+    return vDeadlines;
+}
+
+std::vector<uint64_t> CalculateDeadlines(const CBlockIndex& prevBlockIndex, const std::vector<CBlockHeader>& blocks, const Consensus::Params& params)
+{
+    std::vector<uint64_t> vDeadlines = CalculateUnformattedDeadlines(prevBlockIndex, blocks, params);
+    for (uint64_t& deadline : vDeadlines) {
+        deadline /= prevBlockIndex.nBaseTarget;
+    }
+    return vDeadlines;
+}
+
+/** Inputs of the base target of the blocks mined on a block, which only depend on the block and its ancestors */
+struct BaseTargetWindow
+{
+    uint256 hashBlock;
+    uint64_t avgBaseTarget;
+    int64_t nStartTime;
+};
+
+//! Windows of the recently used blocks, covering the tip, its competitors and the headers being synced
+static constexpr size_t MAX_BASE_TARGET_WINDOWS = 64;
+static Mutex csBaseTargetWindows;
+static std::deque<BaseTargetWindow> dequeBaseTargetWindows GUARDED_BY(csBaseTargetWindows);
+
+static bool FindBaseTargetWindow(const CBlockIndex& blockIndex, uint64_t& avgBaseTarget, int64_t& nStartTime)
+{
+    if (blockIndex.phashBlock == nullptr)
+        return false;
+    const uint256 hashBlock = blockIndex.GetBlockHash();
+    LOCK(csBaseTargetWindows);
+    for (auto it = dequeBaseTargetWindows.rbegin(); it != dequeBaseTargetWindows.rend(); ++it) {
+        if (it->hashBlock == hashBlock) {
+            avgBaseTarget = it->avgBaseTarget;
+            nStartTime = it->nStartTime;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void AddBaseTargetWindow(const CBlockIndex& blockIndex, uint64_t avgBaseTarget, int64_t nStartTime)
+{
+    if (blockIndex.phashBlock == nullptr)
+        return;
+    LOCK(csBaseTargetWindows);
+    if (dequeBaseTargetWindows.size() >= MAX_BASE_TARGET_WINDOWS)
+        dequeBaseTargetWindows.pop_front();
+    dequeBaseTargetWindows.push_back(BaseTargetWindow{blockIndex.GetBlockHash(), avgBaseTarget, nStartTime});
+}
+
 uint64_t CalculateBaseTarget(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params)
 {
     const int N = 80; // About 4 hours
@@ -416,13 +1017,20 @@ uint64_t CalculateBaseTarget(const CBlockIndex& prevBlockIndex, const CBlockHead
         //   B(0) = prevBlock, B(1) = B(0).prev, ..., B(n) = B(n-1).prev
         //   Y(0) = B(0).nBaseTarget
         //   Y(n) = (Y(n-1) * (n-1) + B(n).nBaseTarget) / (n + 1); n > 0
-        const CBlockIndex *pLastindex = &prevBlockIndex;
-        uint64_t avgBaseTarget = pLastindex->nBaseTarget;
-        for (int n = 1; n < N; n++) {
-            pLastindex = pLastindex->pprev;
-            avgBaseTarget = (avgBaseTarget * n + pLastindex->nBaseTarget) / (n + 1);
+        // The average and the time of B(N-1) are memoized per block, as every deadline of a round needs them
+        uint64_t avgBaseTarget;
+        int64_t nStartTime;
+        if (!FindBaseTargetWindow(prevBlockIndex, avgBaseTarget, nStartTime)) {
+            const CBlockIndex *pLastindex = &prevBlockIndex;
+            avgBaseTarget = pLastindex->nBaseTarget;
+            for (int n = 1; n < N; n++) {
+                pLastindex = pLastindex->pprev;
+                avgBaseTarget = (avgBaseTarget * n + pLastindex->nBaseTarget) / (n + 1);
+            }
+            nStartTime = pLastindex->GetBlockTime();
+            AddBaseTargetWindow(prevBlockIndex, avgBaseTarget, nStartTime);
         }
-        int64_t diffTime = block.GetBlockTime() - pLastindex->GetBlockTime() - static_cast<int64_t>(N) * 1;
+        int64_t diffTime = block.GetBlockTime() - nStartTime - static_cast<int64_t>(N) * 1;
         int64_t targetTimespan = params.nPowTargetSpacing * N;
         if (diffTime < targetTimespan / 2) {
             diffTime = targetTimespan / 2;
@@ -449,19 +1057,13 @@ uint64_t CalculateBaseTarget(const CBlockIndex& prevBlockIndex, const CBlockHead
     }
 }
 
+//! Require hold cs_main. The deadline is calculated by caller outside the lock
 static uint64_t addNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
-    const CBlockHeader& block, const std::string& generateTo,
+    const CBlockHeader& block, const uint64_t calcUnformattedDeadline, const std::string& generateTo,
     bool fCheckBind, const Consensus::Params& params)
 {
     AssertLockHeld(cs_main);
 
-    if (miningBlockIndex.nHeight > params.nSaturnActiveHeight)
-        throw JSONRPCError(RPC_INVALID_REQUEST, "Disabled");
-
-    const uint64_t calcUnformattedDeadline = CalculateUnformattedDeadline(miningBlockIndex, block, params);
-    if (calcUnformattedDeadline == INVALID_DEADLINE)
-        throw JSONRPCError(RPC_INVALID_REQUEST, "Invalid deadline");
-
     const uint64_t calcDeadline = calcUnformattedDeadline / miningBlockIndex.nBaseTarget;
     LogPrint(BCLog::POC, "Add nonce: height=%d, nonce=%" PRIu64 ", plotterId=%" PRIu64 ", deadline=%" PRIu64 "\n",
         miningBlockIndex.nHeight + 1, block.nNonce, block.nPlotterId, calcDeadline);
@@ -481,6 +1083,7 @@ static uint64_t addNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockI
             fNewBest = true;
         }
     }
+    TRACE5(poc, add_nonce, miningBlockIndex.nHeight + 1, block.nPlotterId, block.nNonce, calcDeadline, fNewBest);
 
     if (fNewBest) {
         CTxDestination dest;
@@ -568,45 +1171,243 @@ static uint64_t addNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockI
 
         LogPrint(BCLog::POC, "New best deadline %" PRIu64 ".\n", calcDeadline);
 
+        if (&miningBlockIndex == ::ChainActive().Tip())
+            ScheduleForge((int64_t)miningBlockIndex.nTime + (int64_t)calcDeadline);
+        else
+            RescanForge();
+        RequestPrepareBlock();
+
         uiInterface.NotifyBestDeadlineChanged(generatorState.height, generatorState.plotterId, generatorState.nonce, calcDeadline);
     }
+    RecordNonce(miningBlockIndex, calcDeadline);
 
     return calcDeadline;
 }
 
+/** Outcome of a verified proof of space, so that resubmissions of the proof are answered without verifying it again */
+struct SubmittedProof
+{
+    uint64_t nPlotterId;
+    //! Quality iterations of the proof, the nonce of its block
+    uint64_t nNonce;
+    uint64_t nUnformattedDeadline;
+    //! Reason the proof was rejected, empty if it was valid
+    std::string strError;
+};
+
+/** Nonces and proofs submitted for a mining block, checked before any hashing */
+struct SubmissionRound
+{
+    uint256 hashPrevBlock;
+    //! Deadlines of the calculated nonces by plotter ID and nonce, INVALID_DEADLINE for invalid ones
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> mapNonces;
+    //! Calculated nonces of each plotter, for -plotternoncelimit
+    std::map<uint64_t, unsigned int> mapPlotterNonceCounts;
+    //! Verified proofs of space by hash of the proof
+    std::map<uint256, SubmittedProof> mapProofs;
+};
+
+static Mutex csSubmissionRounds;
+static std::deque<SubmissionRound> dequeSubmissionRounds GUARDED_BY(csSubmissionRounds);
+static const size_t MAX_SUBMISSION_ROUNDS = 4;
+//! Entries kept of each kind in a round, later submissions are checked but not remembered
+static const size_t MAX_SUBMISSIONS_PER_ROUND = 100000;
+static unsigned int nPlotterNonceLimit = DEFAULT_PLOTTER_NONCE_LIMIT;
+
+//! Find the submissions of the mining block, start a new round when it is not tracked yet
+static SubmissionRound& GetSubmissionRound(const CBlockIndex& miningBlockIndex) EXCLUSIVE_LOCKS_REQUIRED(csSubmissionRounds)
+{
+    const uint256 hashPrevBlock = miningBlockIndex.GetBlockHash();
+    for (auto it = dequeSubmissionRounds.rbegin(); it != dequeSubmissionRounds.rend(); ++it) {
+        if (it->hashPrevBlock == hashPrevBlock)
+            return *it;
+    }
+    if (dequeSubmissionRounds.size() >= MAX_SUBMISSION_ROUNDS)
+        dequeSubmissionRounds.pop_front();
+    dequeSubmissionRounds.emplace_back();
+    dequeSubmissionRounds.back().hashPrevBlock = hashPrevBlock;
+    return dequeSubmissionRounds.back();
+}
+
 uint64_t AddNonce(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
     const uint64_t& nNonce, const uint64_t& nPlotterId, const std::string& generateTo,
     bool fCheckBind, const Consensus::Params& params)
 {
-    AssertLockHeld(cs_main);
+    std::vector<UniValue> vErrors;
+    const std::vector<uint64_t> vDeadlines = AddNonces(bestDeadline, miningBlockIndex, {{nPlotterId, nNonce}}, {generateTo}, fCheckBind, vErrors, params);
+    if (!vErrors[0].isNull())
+        throw vErrors[0];
+    return vDeadlines[0];
+}
+
+std::vector<uint64_t> AddNonces(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
+    const std::vector<std::pair<uint64_t, uint64_t>>& vPlotterNonces, const std::vector<std::string>& vGenerateTo,
+    bool fCheckBind, std::vector<UniValue>& vErrors, const Consensus::Params& params)
+{
+    AssertLockNotHeld(cs_main);
+    assert(vPlotterNonces.size() == vGenerateTo.size());
 
     if (interruptCheckDeadline)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Not run in mining mode, restart by -server");
 
-    CBlockHeader block;
-    block.nPlotterId = nPlotterId;
-    block.nNonce     = nNonce;
-    return addNonce(bestDeadline, miningBlockIndex, block, generateTo, fCheckBind, params);
+    if (miningBlockIndex.nHeight > params.nSaturnActiveHeight)
+        throw JSONRPCError(RPC_INVALID_REQUEST, "Disabled");
+
+    std::vector<CBlockHeader> blocks(vPlotterNonces.size());
+    std::vector<uint64_t> vUnformattedDeadlines(blocks.size(), INVALID_DEADLINE);
+    vErrors.assign(blocks.size(), NullUniValue);
+
+    // Answer known nonces and reject plotters over their quota before any hashing
+    std::vector<CBlockHeader> vNewBlocks;
+    std::vector<size_t> vNewIndexes;
+    {
+        LOCK(csSubmissionRounds);
+        SubmissionRound& round = GetSubmissionRound(miningBlockIndex);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            blocks[i].nPlotterId = vPlotterNonces[i].first;
+            blocks[i].nNonce     = vPlotterNonces[i].second;
+            auto it = round.mapNonces.find(vPlotterNonces[i]);
+            if (it != round.mapNonces.end()) {
+                vUnformattedDeadlines[i] = it->second;
+                continue;
+            }
+            unsigned int& nCount = round.mapPlotterNonceCounts[blocks[i].nPlotterId];
+            if (nPlotterNonceLimit > 0 && nCount >= nPlotterNonceLimit) {
+                vErrors[i] = JSONRPCError(RPC_INVALID_REQUEST, strprintf("Too many nonces of plotter %" PRIu64 " for this block", blocks[i].nPlotterId));
+                continue;
+            }
+            nCount++;
+            vNewBlocks.push_back(blocks[i]);
+            vNewIndexes.push_back(i);
+        }
+    }
+
+    if (!vNewBlocks.empty()) {
+        const std::vector<uint64_t> vNewDeadlines = CalculateUnformattedDeadlines(miningBlockIndex, vNewBlocks, params);
+        LOCK(csSubmissionRounds);
+        SubmissionRound& round = GetSubmissionRound(miningBlockIndex);
+        for (size_t n = 0; n < vNewIndexes.size(); n++) {
+            vUnformattedDeadlines[vNewIndexes[n]] = vNewDeadlines[n];
+            if (round.mapNonces.size() < MAX_SUBMISSIONS_PER_ROUND)
+                round.mapNonces.emplace(vPlotterNonces[vNewIndexes[n]], vNewDeadlines[n]);
+        }
+    }
+
+    std::vector<uint64_t> vDeadlines(blocks.size(), INVALID_DEADLINE);
+    LOCK(cs_main);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (!vErrors[i].isNull()) {
+            RecordRejectedNonce(miningBlockIndex);
+            continue;
+        }
+        if (vUnformattedDeadlines[i] == INVALID_DEADLINE) {
+            RecordRejectedNonce(miningBlockIndex);
+            vErrors[i] = JSONRPCError(RPC_INVALID_REQUEST, "Invalid deadline");
+            continue;
+        }
+        try {
+            vDeadlines[i] = addNonce(bestDeadline, miningBlockIndex, blocks[i], vUnformattedDeadlines[i], vGenerateTo[i], fCheckBind, params);
+        } catch (const UniValue& objError) {
+            RecordRejectedNonce(miningBlockIndex);
+            vErrors[i] = objError;
+        }
+    }
+    return vDeadlines;
+}
+
+//! Lower bound of the unformatted deadline of a proof of space, known from its scan iterations before it is verified
+static uint64_t GetProofOfSpaceMinDeadline(const CBlockIndex& miningBlockIndex, const CChiaProofOfSpace& pos, const Consensus::Params& params)
+{
+    // Regtest and nonce based PoS deadlines are not bound by the iterations, see CalculateUnformattedDeadline()
+    if (params.fAllowMinDifficultyBlocks || miningBlockIndex.nHeight + 1 >= params.nSaturnActiveHeight || pos.nScanIterations <= 0)
+        return 0;
+    const uint64_t nMainDeadline = static_cast<uint64_t>(pos.nScanIterations) * params.nPowTargetSpacing;
+    if (nMainDeadline > std::numeric_limits<uint64_t>::max() / miningBlockIndex.nBaseTarget)
+        return INVALID_DEADLINE;
+    return nMainDeadline * miningBlockIndex.nBaseTarget;
 }
 
 uint64_t AddProofOfSpace(uint64_t& bestDeadline, const CBlockIndex& miningBlockIndex,
     const CChiaProofOfSpace& pos, const std::string& generateTo,
     bool fCheckBind, const Consensus::Params& params)
 {
-    AssertLockHeld(cs_main);
+    AssertLockNotHeld(cs_main);
 
     if (interruptCheckDeadline)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Not run in mining mode, restart by -server");
 
+    if (miningBlockIndex.nHeight > params.nSaturnActiveHeight)
+        throw JSONRPCError(RPC_INVALID_REQUEST, "Disabled");
+
     if (pos.IsNull() || !pos.IsValid())
         throw JSONRPCError(RPC_INVALID_REQUEST, "Invalid Proof Of Space");
 
+    // A proof that can not beat the best deadline of the tip is answered before the expensive verification
+    const uint64_t nMinUnformattedDeadline = GetProofOfSpaceMinDeadline(miningBlockIndex, pos, params);
+    if (nMinUnformattedDeadline > 0) {
+        std::shared_ptr<const MiningInfo> info = GetMiningInfo();
+        if (info && info->hashTip == miningBlockIndex.GetBlockHash() && nMinUnformattedDeadline / miningBlockIndex.nBaseTarget >= info->nBestDeadline) {
+            LogPrint(BCLog::POC, "Skip proof of space: height=%d, scan iterations=%d, can not beat deadline %" PRIu64 "\n",
+                miningBlockIndex.nHeight + 1, pos.nScanIterations, info->nBestDeadline);
+            bestDeadline = info->nBestDeadline;
+            return nMinUnformattedDeadline / miningBlockIndex.nBaseTarget;
+        }
+    }
+
     CBlockHeader block;
     block.pos = pos;
-    ::pos::VerifyResult result = ::pos::VerifyAndUpdateBlockHeader(block, miningBlockIndex, params);
-    if (result != ::pos::VerifyResult::Success)
-        throw JSONRPCError(RPC_INVALID_REQUEST, strprintf("Apply Proof Of Space: %s", ::pos::ToString(result)));
-    return addNonce(bestDeadline, miningBlockIndex, block, generateTo, fCheckBind, params);
+    const uint256 hashProof = SerializeHash(pos);
+    uint64_t calcUnformattedDeadline = INVALID_DEADLINE;
+    {
+        LOCK(csSubmissionRounds);
+        const auto& mapProofs = GetSubmissionRound(miningBlockIndex).mapProofs;
+        auto it = mapProofs.find(hashProof);
+        if (it != mapProofs.end()) {
+            if (!it->second.strError.empty()) {
+                RecordRejectedNonce(miningBlockIndex);
+                throw JSONRPCError(RPC_INVALID_REQUEST, it->second.strError);
+            }
+            calcUnformattedDeadline = it->second.nUnformattedDeadline;
+            block.nPlotterId = it->second.nPlotterId;
+            block.nNonce = it->second.nNonce;
+        }
+    }
+
+    if (calcUnformattedDeadline == INVALID_DEADLINE) {
+        std::string strError;
+        ::pos::VerifyResult result = ::pos::VerifyAndUpdateBlockHeader(block, miningBlockIndex, params);
+        if (result != ::pos::VerifyResult::Success) {
+            strError = strprintf("Apply Proof Of Space: %s", ::pos::ToString(result));
+        } else {
+            calcUnformattedDeadline = CalculateUnformattedDeadline(miningBlockIndex, block, params);
+            if (calcUnformattedDeadline == INVALID_DEADLINE)
+                strError = "Invalid deadline";
+        }
+        {
+            LOCK(csSubmissionRounds);
+            auto& mapProofs = GetSubmissionRound(miningBlockIndex).mapProofs;
+            if (mapProofs.size() < MAX_SUBMISSIONS_PER_ROUND)
+                mapProofs.emplace(hashProof, SubmittedProof{block.nPlotterId, block.nNonce, calcUnformattedDeadline, strError});
+        }
+        if (!strError.empty()) {
+            RecordRejectedNonce(miningBlockIndex);
+            throw JSONRPCError(RPC_INVALID_REQUEST, strError);
+        }
+    }
+
+    LOCK(cs_main);
+    try {
+        return addNonce(bestDeadline, miningBlockIndex, block, calcUnformattedDeadline, generateTo, fCheckBind, params);
+    } catch (const UniValue&) {
+        RecordRejectedNonce(miningBlockIndex);
+        throw;
+    }
+}
+
+std::vector<MiningRound> GetMiningRounds()
+{
+    LOCK(csMiningRounds);
+    return std::vector<MiningRound>(dequeMiningRounds.begin(), dequeMiningRounds.end());
 }
 
 CBlockList GetEvalBlocks(int nHeight, bool fAscent, const Consensus::Params& params)
@@ -631,16 +1432,10 @@ CBlockList GetEvalBlocks(int nHeight, bool fAscent, const Consensus::Params& par
     return vBlocks;
 }
 
-int64_t GetNetCapacity(int nHeight, const Consensus::Params& params)
+int64_t EvalWindow::GetNetCapacity() const
 {
-    uint64_t nBaseTarget = 0;
-    int nBlockCount = 0;
-    for (const CBlockIndex& block : GetEvalBlocks(nHeight, true, params)) {
-        nBaseTarget += block.nBaseTarget;
-        nBlockCount++;
-    }
     if (nBlockCount != 0) {
-        nBaseTarget /= nBlockCount;
+        uint64_t nBaseTarget = nBaseTargetSum / nBlockCount;
         if (nBaseTarget != 0) {
             return std::max(static_cast<int64_t>(INITIAL_BASE_TARGET / nBaseTarget), (int64_t) 1);
         }
@@ -649,6 +1444,108 @@ int64_t GetNetCapacity(int nHeight, const Consensus::Params& params)
     return (int64_t) 1;
 }
 
+int EvalWindow::GetMinedCount(uint64_t nPlotterId) const
+{
+    auto it = mapPlotterMinedCount.find(nPlotterId);
+    return it != mapPlotterMinedCount.end() ? it->second : 0;
+}
+
+void EvalWindow::Add(const CBlockIndex& block)
+{
+    nBlockCount++;
+    nBaseTargetSum += block.nBaseTarget;
+    mapPlotterMinedCount[block.nPlotterId]++;
+}
+
+void EvalWindow::Remove(const CBlockIndex& block)
+{
+    assert(nBlockCount > 0);
+    nBlockCount--;
+    nBaseTargetSum -= block.nBaseTarget;
+    auto it = mapPlotterMinedCount.find(block.nPlotterId);
+    assert(it != mapPlotterMinedCount.end());
+    if (--it->second == 0)
+        mapPlotterMinedCount.erase(it);
+}
+
+void EvalWindow::Clear()
+{
+    nBlockCount = 0;
+    nBaseTargetSum = 0;
+    mapPlotterMinedCount.clear();
+}
+
+/**
+ * Eval window of GetEvalBlocks() ending at hashEvalWindowEnd. It slides block by block along the
+ * active chain, across reorgs by the fork point. The end is kept by hash, so never touch a freed index.
+ */
+static EvalWindow evalWindow GUARDED_BY(cs_main);
+static uint256 hashEvalWindowEnd GUARDED_BY(cs_main);
+static int nEvalWindowSize GUARDED_BY(cs_main) = 0;
+
+//! Slide the end block of window to the previous block. The window is [max(h - size + 1, 2), h]
+static const CBlockIndex* PopEvalWindowEnd(const CBlockIndex* pindexEnd, int nWindowSize) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const int h = pindexEnd->nHeight;
+    if (h >= 2)
+        evalWindow.Remove(*pindexEnd);
+    if (h - nWindowSize >= 2)
+        evalWindow.Add(*pindexEnd->GetAncestor(h - nWindowSize));
+    return pindexEnd->pprev;
+}
+
+//! Slide the end block of window to the next block pindexNext
+static void PushEvalWindowEnd(const CBlockIndex* pindexNext, int nWindowSize) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const int h = pindexNext->nHeight;
+    if (h >= 2)
+        evalWindow.Add(*pindexNext);
+    if (h - nWindowSize >= 2)
+        evalWindow.Remove(*pindexNext->GetAncestor(h - nWindowSize));
+}
+
+const EvalWindow& GetEvalWindow(int nHeight, const Consensus::Params& params)
+{
+    AssertLockHeld(cs_main);
+    assert(nHeight >= 0 && nHeight <= ::ChainActive().Height());
+
+    const CBlockIndex* pindexTarget = ::ChainActive()[nHeight];
+    const CBlockIndex* pindexEnd = hashEvalWindowEnd.IsNull() ? nullptr : LookupBlockIndex(hashEvalWindowEnd);
+    if (pindexEnd == pindexTarget && nEvalWindowSize == params.nCapacityEvalWindow)
+        return evalWindow;
+
+    const CBlockIndex* pindexFork = pindexEnd ? LastCommonAncestor(pindexEnd, pindexTarget) : nullptr;
+    if (pindexFork == nullptr || nEvalWindowSize != params.nCapacityEvalWindow ||
+            (pindexEnd->nHeight - pindexFork->nHeight) + (pindexTarget->nHeight - pindexFork->nHeight) > params.nCapacityEvalWindow) {
+        // Rebuild
+        evalWindow.Clear();
+        for (const CBlockIndex& block : GetEvalBlocks(nHeight, true, params)) {
+            evalWindow.Add(block);
+        }
+    } else {
+        // Disconnected blocks
+        while (pindexEnd != pindexFork) {
+            pindexEnd = PopEvalWindowEnd(pindexEnd, params.nCapacityEvalWindow);
+        }
+        // Connected blocks
+        std::vector<const CBlockIndex*> vConnect;
+        for (const CBlockIndex* pindex = pindexTarget; pindex != pindexFork; pindex = pindex->pprev) {
+            vConnect.push_back(pindex);
+        }
+        for (auto it = vConnect.rbegin(); it != vConnect.rend(); ++it) {
+            PushEvalWindowEnd(*it, params.nCapacityEvalWindow);
+        }
+    }
+    hashEvalWindowEnd = pindexTarget->GetBlockHash();
+    nEvalWindowSize = params.nCapacityEvalWindow;
+    return evalWindow;
+}
+
+int64_t GetNetCapacity(int nHeight, const Consensus::Params& params)
+{
+    return GetEvalWindow(nHeight, params).GetNetCapacity();
+}
+
 static int64_t EvalNetCapacity(int nHeight, const Consensus::Params& params, std::function<void(const CBlockIndex&)> associateBlock)
 {
     uint64_t nBaseTarget = 0;
@@ -702,17 +1599,13 @@ CAmount GetMiningRequireBalance(const CAccountID& generatorAccountID, const uint
 
     if (pMinerCapacity != nullptr) *pMinerCapacity = 0;
 
-    int64_t nNetCapacityTB = 0;
-    int nBlockCount = 0, nMinedCount = 0;
-    const std::set<uint64_t> plotters = view.GetAccountBindPlotters(generatorAccountID);
-    nNetCapacityTB = EvalNetCapacity(nMiningHeight - 1, params,
-        [&nBlockCount, &nMinedCount, &plotters] (const CBlockIndex &block) {
-            nBlockCount++;
-
-            if (plotters.count(block.nPlotterId))
-                nMinedCount++;
-        }
-    );
+    const EvalWindow& window = GetEvalWindow(nMiningHeight - 1, params);
+    const int64_t nNetCapacityTB = window.GetNetCapacity();
+    const int nBlockCount = window.nBlockCount;
+    int nMinedCount = 0;
+    for (const uint64_t& plotterId : view.GetAccountBindPlotters(generatorAccountID)) {
+        nMinedCount += window.GetMinedCount(plotterId);
+    }
     // Remove sugar
     if (nMinedCount < nBlockCount) nMinedCount++;
     if (nMinedCount == 0 || nBlockCount == 0)
@@ -723,23 +1616,188 @@ CAmount GetMiningRequireBalance(const CAccountID& generatorAccountID, const uint
     return GetCapacityRequireBalance(nMinerCapacityTB, nMiningHeight, params);
 }
 
-bool CheckProofOfCapacity(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params)
+//! Check the block time against the deadline on the previous block
+static bool CheckDeadlineBlockTime(uint64_t deadline, int64_t nPrevBlockTime, const CBlockHeader& block, const Consensus::Params& params)
 {
-    uint64_t deadline = CalculateDeadline(prevBlockIndex, block, params);
-
     // Maybe overflow on arithmetic operation
     if (deadline > poc::MAX_TARGET_DEADLINE)
         return false;
 
+    int64_t targetBlockTime = nPrevBlockTime + static_cast<int64_t>(deadline) + 1;
+    if (params.fAllowIncontinuityBlockTime) {
+        return block.GetBlockTime() >= targetBlockTime;
+    }
+    return block.GetBlockTime() == targetBlockTime;
+}
+
+/**
+ * Valid PoC header cache, filled by BatchCheckProofOfCapacity() so that CheckProofOfCapacity()
+ * doesn't calculate the deadline of a header twice
+ */
+class CPocHeaderCache
+{
+private:
+    //! Entries are SHA256(nonce || block hash). The block hash commits to the previous block
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_poccache;
+
+public:
+    //! Enough for the headers of a few days, 1 MiB
+    static const size_t MAX_CACHE_BYTES = 1 << 20;
+
+    CPocHeaderCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(MAX_CACHE_BYTES);
+    }
+
+    void
+    ComputeEntry(uint256& entry, const uint256& hash)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool
+    Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_poccache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_poccache);
+        setValid.insert(entry);
+    }
+};
+
+static CPocHeaderCache pocHeaderCache;
+
+bool CheckProofOfCapacity(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params)
+{
+    return CheckProofOfCapacity(prevBlockIndex, CHashedBlockHeader(block), params);
+}
+
+bool CheckProofOfCapacity(const CBlockIndex& prevBlockIndex, const CHashedBlockHeader& hashedBlock, const Consensus::Params& params)
+{
+    const CBlockHeader& block = hashedBlock.GetHeader();
+    uint256 entry;
+    pocHeaderCache.ComputeEntry(entry, hashedBlock.GetHash());
+    if (pocHeaderCache.Get(entry))
+        return true;
+
+    uint64_t deadline = CalculateDeadline(prevBlockIndex, block, params);
+
     if (prevBlockIndex.nHeight == 1) {
+        // Maybe overflow on arithmetic operation
+        if (deadline > poc::MAX_TARGET_DEADLINE)
+            return false;
         return params.nBeginMiningTime == 0 || params.nBeginMiningTime == block.GetBlockTime();
     }
 
-    int64_t targetBlockTime = prevBlockIndex.GetBlockTime() + static_cast<int64_t>(deadline) + 1;
-    if (params.fAllowIncontinuityBlockTime) {
-        return block.GetBlockTime() >= targetBlockTime;
+    return CheckDeadlineBlockTime(deadline, prevBlockIndex.GetBlockTime(), block, params);
+}
+
+void BatchCheckProofOfCapacity(const CBlockIndex& prevBlockIndex, std::vector<CHashedBlockHeader>::const_iterator itBegin, std::vector<CHashedBlockHeader>::const_iterator itEnd, const Consensus::Params& params)
+{
+    if (params.fAllowMinDifficultyBlocks)
+        return;
+
+    // Targets of the PoC headers, see CalculateUnformattedDeadline()
+    std::vector<CDeadlineTarget> vTargets;
+    std::vector<std::pair<uint64_t, uint64_t>> vPlotterNonces;
+    std::vector<std::vector<CHashedBlockHeader>::const_iterator> vHeaders;
+    std::vector<std::pair<uint64_t, int64_t>> vPrevBlocks; // Base target and time of the previous block
+    uint256 hashPrevBlock = prevBlockIndex.GetBlockHash();
+    uint256 generationSignature = prevBlockIndex.GetNextGenerationSignature();
+    int nPrevHeight = prevBlockIndex.nHeight;
+    uint64_t nPrevBaseTarget = prevBlockIndex.nBaseTarget;
+    int64_t nPrevBlockTime = prevBlockIndex.GetBlockTime();
+    for (auto it = itBegin; it != itEnd && nPrevHeight + 1 < params.nSaturnActiveHeight; it++) {
+        const CBlockHeader& block = it->GetHeader();
+        if (block.hashPrevBlock != hashPrevBlock || nPrevBaseTarget == 0)
+            break;
+
+        if (nPrevHeight > 1 && block.pos.IsNull()) {
+            vTargets.emplace_back(nPrevHeight + 1, generationSignature);
+            vPlotterNonces.emplace_back(block.nPlotterId, block.nNonce);
+            vHeaders.push_back(it);
+            vPrevBlocks.emplace_back(nPrevBaseTarget, nPrevBlockTime);
+        }
+
+        // Next generation signature, see CBlockIndex::GetNextGenerationSignature()
+        hashPrevBlock = it->GetHash();
+        if (++nPrevHeight <= 1) {
+            generationSignature.SetNull();
+        } else {
+            uint64_t plotterId = htobe64(block.nPlotterId);
+            CShabal256()
+                .Write(generationSignature.begin(), generationSignature.size())
+                .Write((const unsigned char*)&plotterId, 8)
+                .Finalize(generationSignature.begin());
+        }
+        nPrevBaseTarget = block.nBaseTarget;
+        nPrevBlockTime = block.GetBlockTime();
     }
-    return block.GetBlockTime() == targetBlockTime;
+    if (vPlotterNonces.size() < 2)
+        return;
+
+    std::vector<uint64_t> vDeadlines(vPlotterNonces.size());
+    CalcDLParallel(vTargets, vPlotterNonces, vDeadlines.data());
+    for (size_t i = 0; i < vHeaders.size(); i++) {
+        const CBlockHeader& block = vHeaders[i]->GetHeader();
+        if (CheckDeadlineBlockTime(vDeadlines[i] / vPrevBlocks[i].first, vPrevBlocks[i].second, block, params)) {
+            uint256 entry;
+            pocHeaderCache.ComputeEntry(entry, vHeaders[i]->GetHash());
+            pocHeaderCache.Set(entry);
+        }
+    }
+}
+
+UniValue GetMiningJob(const CBlockIndex& indexTip)
+{
+    UniValue job(UniValue::VOBJ);
+    job.pushKV("height", indexTip.nHeight + 1);
+    job.pushKV("generationSignature", HexStr(indexTip.GetNextGenerationSignature()));
+    job.pushKV("baseTarget", std::to_string(indexTip.nBaseTarget));
+    job.pushKV("targetDeadline", (uint64_t) MAX_TARGET_DEADLINE);
+    return job;
+}
+
+std::shared_ptr<const MiningInfo> GetMiningInfo()
+{
+    LOCK(csMiningInfo);
+    return miningInfo;
+}
+
+std::shared_ptr<const MiningInfo> WaitForMiningInfo(const std::shared_ptr<const MiningInfo>& info, int64_t nTimeoutMillis)
+{
+    WAIT_LOCK(csMiningInfo, lock);
+    auto fChanged = [&info]() { return miningInfo != info || interruptCheckDeadline; };
+    if (nTimeoutMillis > 0)
+        condMiningInfo.wait_for(lock, std::chrono::milliseconds(nTimeoutMillis), fChanged);
+    else
+        condMiningInfo.wait(lock, fChanged);
+    return miningInfo;
+}
+
+uint64_t GetTargetDeadline(const MiningInfo& info)
+{
+    return std::min(info.nBestDeadline, (uint64_t) MAX_TARGET_DEADLINE);
+}
+
+bool IsMiningInfoReady(const MiningInfo& info)
+{
+    // Same conditions as getMiningInfo on the chain state
+    if (info.nTipHeight < 1)
+        return false;
+    if (info.nTipHeight != 1 && info.fInitialDownload)
+        return false;
+    if (info.nTipHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime())
+        return false;
+    return true;
 }
 
 CTxDestination AddMiningSignaturePrivkey(const CKey& key)
@@ -776,10 +1834,39 @@ bool StartPOC()
 {
     LogPrintf("Starting PoC module\n");
     interruptCheckDeadline.reset();
+    {
+        LOCK(csForgeSchedule);
+        fForgeRescan = true;
+        fPoolsRescan = true;
+        fPrepareRescan = true;
+    }
+
+    mining_info_block_tip_connection = uiInterface.NotifyBlockTip_connect(&PublishMiningInfo);
+    mining_info_best_deadline_connection = uiInterface.NotifyBestDeadlineChanged_connect(&PublishBestDeadline);
+    {
+        LOCK(cs_main);
+        PublishMiningInfo(::ChainstateActive().IsInitialBlockDownload(), ::ChainActive().Tip());
+    }
+
+    // -pocthreads
+    poc::nDeadlineCheckThreads = gArgs.GetArg("-pocthreads", poc::DEFAULT_POC_CHECK_THREADS);
+    if (poc::nDeadlineCheckThreads <= 0)
+        poc::nDeadlineCheckThreads += GetNumCores();
+    if (poc::nDeadlineCheckThreads <= 1)
+        poc::nDeadlineCheckThreads = 0;
+    else if (poc::nDeadlineCheckThreads > poc::MAX_POC_CHECK_THREADS)
+        poc::nDeadlineCheckThreads = poc::MAX_POC_CHECK_THREADS;
+    LogPrintf("PoC deadline checks split to %d slices\n", poc::nDeadlineCheckThreads);
+
+    // -plotternoncelimit
+    poc::nPlotterNonceLimit = (unsigned int) std::max<int64_t>(0, gArgs.GetArg("-plotternoncelimit", poc::DEFAULT_PLOTTER_NONCE_LIMIT));
+
     if (gArgs.GetBoolArg("-server", false)) {
         LogPrintf("Starting PoC forge thread\n");
+        forge_notify_block_tip_connection = uiInterface.NotifyBlockTip_connect(&ForgeNotifyBlockTip);
         threadCheckDeadline = std::thread(CheckDeadlineThread);
         threadGenearetePoolsDeadline = std::thread(GenearetePoolsDeadlineThread);
+        threadPrepareBlock = std::thread(PrepareBlockThread);
 
         // import private key
         if (gArgs.IsArgSet("-signprivkey")) {
@@ -823,17 +1910,32 @@ void InterruptPOC()
 {
     LogPrintf("Interrupting PoC module\n");
     interruptCheckDeadline();
+    InterruptForgeSchedule();
+    InterruptMiningInfo();
 }
 
 void StopPOC()
 {
+    forge_notify_block_tip_connection.disconnect();
+    mining_info_block_tip_connection.disconnect();
+    mining_info_best_deadline_connection.disconnect();
     if (threadCheckDeadline.joinable())
         threadCheckDeadline.join();
     if (threadGenearetePoolsDeadline.joinable())
         threadGenearetePoolsDeadline.join();
+    if (threadPrepareBlock.joinable())
+        threadPrepareBlock.join();
 
     mapSignaturePrivKeys.clear();
     mapGenerators.clear();
+    {
+        LOCK(csMiningRounds);
+        dequeMiningRounds.clear();
+    }
+    {
+        LOCK(cs_main);
+        pblocktemplatePrepared.reset();
+    }
 
     LogPrintf("Stopped PoC module\n");
 }
\ No newline at end of file
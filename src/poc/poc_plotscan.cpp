@@ -0,0 +1,310 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <poc/poc.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/shabal256.h>
+#include <fs.h>
+#include <logging.h>
+#include <sync.h>
+#include <ui_interface.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <util/threadnames.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include <univalue.h>
+
+/**
+ * Solo mining from local plot files. On every new tip the scanner reads the scoop of the next block from each
+ * PoC2 plot file of -plotdir and submits the best nonce of each plotter through poc::AddNonce(), without an
+ * external miner.
+ *
+ * A PoC2 plot file stores the scoops scoop-major, so the scoops of all nonces for one block are a single
+ * contiguous region of nonces * SCOOP_SIZE bytes. The region is read sequentially in large chunks and the
+ * deadlines of each chunk are hashed by the multi-lane Shabal256 engine.
+ */
+
+namespace {
+
+/** Nonces read at once, 4 MiB of scoops */
+const size_t PLOT_SCAN_CHUNK_NONCES = 64 * 1024;
+/** Milliseconds between checks of the interrupt while waiting for a new tip */
+const int64_t PLOT_SCAN_WAIT_MILLIS = 1000;
+
+struct PlotFile
+{
+    fs::path path;
+    uint64_t nPlotterId;
+    uint64_t nStartNonce;
+    uint64_t nNonces;
+};
+
+/** Best nonce of a plotter */
+struct PlotterBest
+{
+    uint64_t nUnformattedDeadline = poc::INVALID_DEADLINE;
+    uint64_t nNonce = 0;
+};
+
+std::thread threadPlotScanner;
+std::atomic<bool> fPlotScannerInterrupted(false);
+std::vector<fs::path> vPlotDirs;
+std::string strPlotGenerateTo;
+
+/** List the plot files of -plotdir. Listed on every tip, so that new plots are picked up */
+std::vector<PlotFile> ListPlotFiles()
+{
+    std::vector<PlotFile> vPlotFiles;
+    for (const fs::path& dir : vPlotDirs) {
+        boost::system::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            PlotFile plot;
+            plot.path = it->path();
+            if (!poc::ParsePlotFileName(plot.path.filename().string(), plot.nPlotterId, plot.nStartNonce, plot.nNonces))
+                continue;
+            if (!fs::is_regular_file(plot.path, ec) || fs::file_size(plot.path, ec) != plot.nNonces * poc::PLOT_SIZE) {
+                LogPrint(BCLog::POC, "plotscan: Skip incomplete plot file %s\n", plot.path.string());
+                continue;
+            }
+            vPlotFiles.push_back(std::move(plot));
+        }
+        if (ec)
+            LogPrintf("plotscan: Cannot list %s: %s\n", dir.string(), ec.message());
+    }
+    return vPlotFiles;
+}
+
+/** Read len bytes at offset */
+bool ReadPlotRange(FILE* file, int64_t nOffset, unsigned char* data, size_t len)
+{
+#ifdef WIN32
+    if (_fseeki64(file, nOffset, SEEK_SET) != 0)
+        return false;
+    return fread(data, 1, len, file) == len;
+#else
+    while (len > 0) {
+        const ssize_t nRead = pread(fileno(file), data, len, (off_t)nOffset);
+        if (nRead <= 0)
+            return false;
+        data += nRead;
+        nOffset += nRead;
+        len -= nRead;
+    }
+    return true;
+#endif
+}
+
+bool IsTipChanged(const uint256& hashTip)
+{
+    if (fPlotScannerInterrupted)
+        return true;
+    std::shared_ptr<const poc::MiningInfo> info = poc::GetMiningInfo();
+    return !info || info->hashTip != hashTip;
+}
+
+/**
+ * Scan the scoops of a plot file for the best nonce of its plotter
+ *
+ * @return false if the tip changed during the scan
+ */
+bool ScanPlotFile(const PlotFile& plot, const poc::MiningInfo& info, uint32_t nScoop, std::vector<unsigned char>& vBuffer,
+    std::vector<uint64_t>& vDeadlines, PlotterBest& best)
+{
+    FILE* file = fsbridge::fopen(plot.path, "rb");
+    if (!file) {
+        LogPrintf("plotscan: Cannot open plot file %s\n", plot.path.string());
+        return true;
+    }
+
+    const int64_t nRegionOffset = (int64_t)nScoop * plot.nNonces * poc::SCOOP_SIZE;
+    ReadAheadFileRange(file, nRegionOffset, plot.nNonces * poc::SCOOP_SIZE);
+    bool fCompleted = true;
+    for (uint64_t nOffset = 0; nOffset < plot.nNonces; nOffset += PLOT_SCAN_CHUNK_NONCES) {
+        if (IsTipChanged(info.hashTip)) {
+            fCompleted = false;
+            break;
+        }
+        const size_t nCount = std::min<uint64_t>(PLOT_SCAN_CHUNK_NONCES, plot.nNonces - nOffset);
+        if (!ReadPlotRange(file, nRegionOffset + nOffset * poc::SCOOP_SIZE, vBuffer.data(), nCount * poc::SCOOP_SIZE)) {
+            LogPrintf("plotscan: Cannot read plot file %s\n", plot.path.string());
+            break;
+        }
+        poc::CalculateScoopDeadlines(info.nextGenerationSignature, vBuffer.data(), nCount, vDeadlines.data());
+        const auto itBest = std::min_element(vDeadlines.begin(), vDeadlines.begin() + nCount);
+        if (*itBest < best.nUnformattedDeadline) {
+            best.nUnformattedDeadline = *itBest;
+            best.nNonce = plot.nStartNonce + nOffset + (itBest - vDeadlines.begin());
+        }
+    }
+    fclose(file);
+    return fCompleted;
+}
+
+/** Scan all plot files for the block following the tip and submit the best nonce of each plotter */
+void ScanPlots(const poc::MiningInfo& info)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const uint32_t nScoop = poc::GetScoop(info.nTipHeight + 1, info.nextGenerationSignature);
+    const int64_t nStartMicros = GetTimeMicros();
+
+    std::vector<unsigned char> vBuffer(PLOT_SCAN_CHUNK_NONCES * poc::SCOOP_SIZE);
+    std::vector<uint64_t> vDeadlines(PLOT_SCAN_CHUNK_NONCES);
+    std::map<uint64_t, PlotterBest> mapBest;
+    uint64_t nScannedNonces = 0;
+    for (const PlotFile& plot : ListPlotFiles()) {
+        if (!ScanPlotFile(plot, info, nScoop, vBuffer, vDeadlines, mapBest[plot.nPlotterId])) {
+            LogPrint(BCLog::POC, "plotscan: Abort scan of height %d on new tip\n", info.nTipHeight + 1);
+            return;
+        }
+        nScannedNonces += plot.nNonces;
+    }
+    LogPrint(BCLog::POC, "plotscan: Scanned %u nonces of scoop %u for height %d in %.3fms\n",
+        nScannedNonces, nScoop, info.nTipHeight + 1, (GetTimeMicros() - nStartMicros) * 0.001);
+
+    // Deadline is checked outside cs_main, block index is never freed
+    const CBlockIndex* pindexMining;
+    {
+        LOCK(cs_main);
+        pindexMining = LookupBlockIndex(info.hashTip);
+    }
+    if (pindexMining == nullptr)
+        return;
+    for (const auto& pair : mapBest) {
+        if (pair.second.nUnformattedDeadline == poc::INVALID_DEADLINE)
+            continue;
+        try {
+            uint64_t bestDeadline = 0;
+            const uint64_t deadline = poc::AddNonce(bestDeadline, *pindexMining, pair.second.nNonce, pair.first, strPlotGenerateTo, true, params);
+            LogPrint(BCLog::POC, "plotscan: Submitted nonce %u of plotter %u for height %d, deadline %u\n",
+                pair.second.nNonce, pair.first, info.nTipHeight + 1, deadline);
+        } catch (const UniValue& objError) {
+            LogPrintf("plotscan: Nonce %u of plotter %u rejected: %s\n", pair.second.nNonce, pair.first,
+                objError.isObject() ? objError["message"].getValStr() : objError.getValStr());
+        } catch (const std::exception& e) {
+            LogPrintf("plotscan: Nonce %u of plotter %u rejected: %s\n", pair.second.nNonce, pair.first, e.what());
+        }
+    }
+}
+
+void ThreadPlotScanner()
+{
+    util::ThreadRename("bitcoin-plotscan");
+    const Consensus::Params& params = Params().GetConsensus();
+    uint256 hashScanned;
+    std::shared_ptr<const poc::MiningInfo> info;
+    while (!fPlotScannerInterrupted) {
+        // Also returns on better deadlines, only a new tip starts a scan
+        info = poc::WaitForMiningInfo(info, PLOT_SCAN_WAIT_MILLIS);
+        if (fPlotScannerInterrupted)
+            break;
+        if (!info || info->hashTip == hashScanned || !poc::IsMiningInfoReady(*info))
+            continue;
+        hashScanned = info->hashTip;
+        // Nonces of plot files are not accepted after the Saturn fork
+        if (info->nTipHeight > params.nSaturnActiveHeight)
+            continue;
+        ScanPlots(*info);
+    }
+}
+
+} // namespace
+
+namespace poc {
+
+void CalculateScoopDeadlines(const uint256& generationSignature, const unsigned char* pScoops, size_t nCount, uint64_t* pDeadlines)
+{
+    const size_t nLanes = std::min(nCount, std::max(Shabal256MaxLanes(), (size_t) 4));
+    std::vector<std::array<unsigned char, HASH_SIZE + SCOOP_SIZE>> vMessages(nLanes);
+    std::vector<uint256> vHashes(nLanes);
+    std::vector<const unsigned char*> vIn(nLanes);
+    std::vector<unsigned char*> vOut(nLanes);
+    for (size_t n = 0; n < nLanes; n++) {
+        memcpy(vMessages[n].data(), generationSignature.begin(), HASH_SIZE);
+        vIn[n] = vMessages[n].data();
+        vOut[n] = vHashes[n].begin();
+    }
+
+    for (size_t nOffset = 0; nOffset < nCount; nOffset += nLanes) {
+        const size_t nLaneCount = std::min(nLanes, nCount - nOffset);
+        // The scoops of PoC2 plot files are already rearranged
+        for (size_t n = 0; n < nLaneCount; n++) {
+            memcpy(vMessages[n].data() + HASH_SIZE, pScoops + (nOffset + n) * SCOOP_SIZE, SCOOP_SIZE);
+        }
+        Shabal256Lanes(vOut.data(), vIn.data(), HASH_SIZE + SCOOP_SIZE, nLaneCount);
+        for (size_t n = 0; n < nLaneCount; n++) {
+            pDeadlines[nOffset + n] = vHashes[n].GetUint64(0);
+        }
+    }
+}
+
+bool ParsePlotFileName(const std::string& strName, uint64_t& nPlotterId, uint64_t& nStartNonce, uint64_t& nNonces)
+{
+    std::vector<std::string> vParts;
+    size_t nStart = 0;
+    for (size_t nPos; (nPos = strName.find('_', nStart)) != std::string::npos; nStart = nPos + 1) {
+        vParts.push_back(strName.substr(nStart, nPos - nStart));
+    }
+    vParts.push_back(strName.substr(nStart));
+    if (vParts.size() != 3)
+        return false;
+    if (!ParseUInt64(vParts[0], &nPlotterId) || !ParseUInt64(vParts[1], &nStartNonce) || !ParseUInt64(vParts[2], &nNonces))
+        return false;
+    return nNonces > 0;
+}
+
+}
+
+bool StartPlotScanner()
+{
+    if (!gArgs.IsArgSet("-plotdir"))
+        return true;
+    if (!gArgs.GetBoolArg("-server", false))
+        return InitError(_("-plotdir requires -server").translated);
+
+    vPlotDirs.clear();
+    for (const std::string& strDir : gArgs.GetArgs("-plotdir")) {
+        fs::path dir = fs::system_complete(strDir);
+        if (!fs::is_directory(dir))
+            return InitError(strprintf(_("Specified -plotdir \"%s\" does not exist").translated, strDir));
+        vPlotDirs.push_back(dir);
+    }
+    strPlotGenerateTo = gArgs.GetArg("-plotgenerateto", "");
+
+    LogPrintf("Starting plot scanner on %u plot directories\n", vPlotDirs.size());
+    fPlotScannerInterrupted = false;
+    threadPlotScanner = std::thread(ThreadPlotScanner);
+    return true;
+}
+
+void InterruptPlotScanner()
+{
+    if (!threadPlotScanner.joinable())
+        return;
+    LogPrintf("Interrupting plot scanner\n");
+    fPlotScannerInterrupted = true;
+}
+
+void StopPlotScanner()
+{
+    if (threadPlotScanner.joinable())
+        threadPlotScanner.join();
+    vPlotDirs.clear();
+}
@@ -6,9 +6,11 @@
 #include <chainparams.h>
 #include <consensus/validation.h>
 #include <key_io.h>
+#include <metrics.h>
 #include <net.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <rpc/util.h>
 #include <util/bip39.h>
 #include <util/strencodings.h>
 #include <univalue.h>
@@ -19,22 +21,38 @@
 
 static UniValue poc_getMiningInfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp) {
+    if (request.fHelp || request.params.size() > 1) {
         throw std::runtime_error(
-            "getMiningInfo\n"
+            "getMiningInfo ( timeout )\n"
             "\nGet current mining information.\n"
+            "\nArguments:\n"
+            "1. timeout                    (integer, optional) Wait for a new tip or a better deadline for the next block\n"
+            "                              for up to timeout milliseconds before returning. 0 indicates no timeout\n"
             "\nResult:\n"
             "{\n"
             "  [ height ]                  (integer) Next block height\n"
             "  [ generationSignature ]     (string) Current block generation signature\n"
             "  [ baseTarget ]              (string) Current block base target \n"
-            "  [ targetDeadline ]          (number) Max acceptable deadline \n"
+            "  [ targetDeadline ]          (number) Max acceptable deadline, the best deadline found for the block once there is one\n"
             "}\n"
         );
     }
 
     UniValue result(UniValue::VOBJ);
 
+    std::shared_ptr<const poc::MiningInfo> info = poc::GetMiningInfo();
+    if (!request.params[0].isNull()) {
+        const int64_t nTimeoutMillis = request.params[0].isNum() ? request.params[0].get_int64() : std::stoll(request.params[0].get_str());
+        info = poc::WaitForMiningInfo(info, nTimeoutMillis);
+    }
+    if (info && poc::IsMiningInfoReady(*info)) {
+        result.pushKV("height", info->nTipHeight + 1);
+        result.pushKV("generationSignature", HexStr(info->nextGenerationSignature));
+        result.pushKV("baseTarget", std::to_string(info->nBaseTarget));
+        result.pushKV("targetDeadline", poc::GetTargetDeadline(*info));
+        return result;
+    }
+
     LOCK(cs_main);
     const CBlockIndex *pindexMining = ChainActive().Tip();
     if (pindexMining == nullptr || pindexMining->nHeight < 1) {
@@ -106,29 +124,34 @@ static UniValue poc_submitNonce(const JSONRPCRequest& request)
         fCheckBind = request.params[4].get_bool();
     }
 
-    LOCK(cs_main);
-    const CBlockIndex *pindexMining = ChainActive()[nTargetHeight < 1 ? ChainActive().Height() : (nTargetHeight - 1)];
-    if (pindexMining == nullptr || pindexMining->nHeight < 1) {
-        result.pushKV("result", "error");
-        result.pushKV("errorCode", "400");
-        result.pushKV("errorDescription", "Invalid mining height!");
-        return result;
-    }
-    if (pindexMining->nHeight != 1 && ChainstateActive().IsInitialBlockDownload()) {
-        result.pushKV("result", "error");
-        result.pushKV("errorCode", "400");
-        result.pushKV("errorDescription", "Is initial block downloading!");
-        return result;
-    }
-    if (pindexMining->nHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime()) {
-        result.pushKV("result", "error");
-        result.pushKV("errorCode", "400");
-        result.pushKV("errorDescription", "Waiting for begining!");
-        return result;
+    // Deadline is checked outside cs_main, block index is never freed
+    const CBlockIndex *pindexMining;
+    {
+        LOCK(cs_main);
+        pindexMining = ChainActive()[nTargetHeight < 1 ? ChainActive().Height() : (nTargetHeight - 1)];
+        if (pindexMining == nullptr || pindexMining->nHeight < 1) {
+            result.pushKV("result", "error");
+            result.pushKV("errorCode", "400");
+            result.pushKV("errorDescription", "Invalid mining height!");
+            return result;
+        }
+        if (pindexMining->nHeight != 1 && ChainstateActive().IsInitialBlockDownload()) {
+            result.pushKV("result", "error");
+            result.pushKV("errorCode", "400");
+            result.pushKV("errorDescription", "Is initial block downloading!");
+            return result;
+        }
+        if (pindexMining->nHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime()) {
+            result.pushKV("result", "error");
+            result.pushKV("errorCode", "400");
+            result.pushKV("errorDescription", "Waiting for begining!");
+            return result;
+        }
     }
 
     try {
         uint64_t bestDeadline = 0;
+        metrics::g_nonces_submitted.Add();
         uint64_t deadline = poc::AddNonce(bestDeadline, *pindexMining, nNonce, nPlotterId, generateTo, fCheckBind, Params().GetConsensus());
         result.pushKV("result", "success");
         result.pushKV("deadline", deadline);
@@ -146,6 +169,149 @@ static UniValue poc_submitNonce(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue poc_submitNonces(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
+        throw std::runtime_error(
+            "submitNonces [{\"nonce\":\"nonce\",\"plotterId\":\"plotterId\",\"height\":n,\"address\":\"address\"},...] (checkBind)\n"
+            "\nSubmit many mining nonces at once. Nonces are checked together by the batch deadline engine.\n"
+            "\nArguments:\n"
+            "1. \"nonces\"          (array, required) Nonces, each entry is same as arguments of submitNonce\n"
+            "2. \"checkBind\"       (boolean, optional, true) Check bind for QTCIP006\n"
+            "\nResult:\n"
+            "{\n"
+            "  [ result ]                  (string) Submit result: 'success' or others \n"
+            "  [ nonces ]                  (array) Result of each nonce, same as result of submitNonce without targetDeadline \n"
+            "  [ targetDeadline ]          (number) Current acceptable deadline \n"
+            "}\n"
+        );
+    }
+
+    UniValue result(UniValue::VOBJ);
+
+    const UniValue& vNonces = request.params[0].get_array();
+    bool fCheckBind = true;
+    if (request.params.size() >= 2) {
+        fCheckBind = request.params[1].get_bool();
+    }
+
+    // Parse and resolve mining block of all nonces in one cs_main holding
+    const size_t nCount = vNonces.size();
+    std::vector<const CBlockIndex*> vMiningIndexes(nCount, nullptr);
+    std::vector<std::pair<uint64_t, uint64_t>> vPlotterNonces(nCount);
+    std::vector<std::string> vGenerateTo(nCount);
+    std::vector<UniValue> vResults(nCount, UniValue(UniValue::VOBJ));
+    {
+        LOCK(cs_main);
+        const bool fInitialBlockDownload = ChainstateActive().IsInitialBlockDownload();
+        for (size_t i = 0; i < nCount; i++) {
+            const UniValue& entry = vNonces[i].get_obj();
+            const UniValue& vNonce = find_value(entry, "nonce");
+            const UniValue& vPlotterId = find_value(entry, "plotterId");
+            const UniValue& vHeight = find_value(entry, "height");
+            const UniValue& vAddress = find_value(entry, "address");
+            if (vNonce.isNull() || vPlotterId.isNull()) {
+                vResults[i].pushKV("result", "error");
+                vResults[i].pushKV("errorCode", "400");
+                vResults[i].pushKV("errorDescription", "Incorrect request");
+                continue;
+            }
+            vPlotterNonces[i].first = static_cast<uint64_t>(std::stoull(vPlotterId.getValStr()));
+            vPlotterNonces[i].second = static_cast<uint64_t>(std::stoull(vNonce.getValStr()));
+            if (!vAddress.isNull()) {
+                vGenerateTo[i] = vAddress.get_str();
+            }
+
+            int nTargetHeight = 0;
+            if (!vHeight.isNull()) {
+                nTargetHeight = vHeight.isNum() ? vHeight.get_int() : std::stoi(vHeight.get_str());
+            }
+            const CBlockIndex *pindexMining = ChainActive()[nTargetHeight < 1 ? ChainActive().Height() : (nTargetHeight - 1)];
+            if (pindexMining == nullptr || pindexMining->nHeight < 1) {
+                vResults[i].pushKV("result", "error");
+                vResults[i].pushKV("errorCode", "400");
+                vResults[i].pushKV("errorDescription", "Invalid mining height!");
+                continue;
+            }
+            if (pindexMining->nHeight != 1 && fInitialBlockDownload) {
+                vResults[i].pushKV("result", "error");
+                vResults[i].pushKV("errorCode", "400");
+                vResults[i].pushKV("errorDescription", "Is initial block downloading!");
+                continue;
+            }
+            if (pindexMining->nHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime()) {
+                vResults[i].pushKV("result", "error");
+                vResults[i].pushKV("errorCode", "400");
+                vResults[i].pushKV("errorDescription", "Waiting for begining!");
+                continue;
+            }
+            vMiningIndexes[i] = pindexMining;
+        }
+    }
+
+    // Check nonces of each mining block together
+    uint64_t targetDeadline = 0;
+    std::vector<bool> vDone(nCount, false);
+    for (size_t i = 0; i < nCount; i++) {
+        if (vDone[i] || vMiningIndexes[i] == nullptr)
+            continue;
+        const CBlockIndex *pindexMining = vMiningIndexes[i];
+        std::vector<size_t> vIndexes;
+        std::vector<std::pair<uint64_t, uint64_t>> vGroupPlotterNonces;
+        std::vector<std::string> vGroupGenerateTo;
+        for (size_t j = i; j < nCount; j++) {
+            if (vMiningIndexes[j] == pindexMining) {
+                vDone[j] = true;
+                vIndexes.push_back(j);
+                vGroupPlotterNonces.push_back(vPlotterNonces[j]);
+                vGroupGenerateTo.push_back(vGenerateTo[j]);
+            }
+        }
+
+        try {
+            uint64_t bestDeadline = 0;
+            std::vector<UniValue> vErrors;
+            metrics::g_nonces_submitted.Add(vGroupPlotterNonces.size());
+            std::vector<uint64_t> vDeadlines = poc::AddNonces(bestDeadline, *pindexMining, vGroupPlotterNonces, vGroupGenerateTo, fCheckBind, vErrors, Params().GetConsensus());
+            for (size_t k = 0; k < vIndexes.size(); k++) {
+                UniValue& entryResult = vResults[vIndexes[k]];
+                if (vErrors[k].isNull()) {
+                    entryResult.pushKV("result", "success");
+                    entryResult.pushKV("deadline", vDeadlines[k]);
+                    entryResult.pushKV("height", pindexMining->nHeight + 1);
+                } else {
+                    entryResult.pushKV("result", "error");
+                    entryResult.pushKV("errorCode", vErrors[k].isObject() ? vErrors[k]["code"].getValStr() : "400");
+                    entryResult.pushKV("errorDescription", vErrors[k].isObject() ? vErrors[k]["message"].getValStr() : vErrors[k].getValStr());
+                }
+            }
+            if (bestDeadline != 0 && (targetDeadline == 0 || bestDeadline < targetDeadline))
+                targetDeadline = bestDeadline;
+        } catch (const UniValue& objError) {
+            for (size_t index : vIndexes) {
+                vResults[index].pushKV("result", "error");
+                vResults[index].pushKV("errorCode", objError.isObject() ? objError["code"].getValStr() : "400");
+                vResults[index].pushKV("errorDescription", objError.isObject() ? objError["message"].getValStr() : objError.getValStr());
+            }
+        } catch (const std::exception& e) {
+            for (size_t index : vIndexes) {
+                vResults[index].pushKV("result", "error");
+                vResults[index].pushKV("errorCode", "500");
+                vResults[index].pushKV("errorDescription", e.what());
+            }
+        }
+    }
+
+    UniValue nonces(UniValue::VARR);
+    for (UniValue& entryResult : vResults) {
+        nonces.push_back(entryResult);
+    }
+    result.pushKV("result", "success");
+    result.pushKV("nonces", nonces);
+    result.pushKV("targetDeadline", (targetDeadline == 0 ? poc::MAX_TARGET_DEADLINE : targetDeadline));
+    return result;
+}
+
 static UniValue addSignPrivkey(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1) {
@@ -227,6 +393,110 @@ static UniValue getNewPlotter(const JSONRPCRequest& request)
     return result;
 }
 
+static std::string MiningRoundResultToString(poc::MiningRoundResult result)
+{
+    switch (result) {
+    case poc::MiningRoundResult::PENDING: return "pending";
+    case poc::MiningRoundResult::WON: return "won";
+    case poc::MiningRoundResult::LOST: return "lost";
+    case poc::MiningRoundResult::OUT_RACED: return "out-raced";
+    case poc::MiningRoundResult::SNATCHED: return "snatched";
+    }
+    assert(false);
+}
+
+static UniValue getMiningRoundStats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 1) {
+        throw std::runtime_error(
+            "getminingroundstats ( count )\n"
+            "\nGet statistics of the recent mining rounds of the forge thread, oldest first. A round is mining the block\n"
+            "following one previous block and starts when the previous block became the tip.\n"
+            "\nArguments:\n"
+            "1. count                   (numeric, optional) Return only the most recent rounds\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"height\": n,                (numeric) Height of the mined block\n"
+            "    \"prevblockhash\": \"hash\",    (string) The previous block\n"
+            "    \"result\": \"str\",            (string) One of \"pending\", \"won\", \"lost\" (another block with the same or a better deadline won),\n"
+            "                                \"out-raced\" (another block with a worse deadline connected first) or \"snatched\" (our block was replaced)\n"
+            "    \"nonces_submitted\": n,      (numeric) Nonces submitted, including the rejected ones\n"
+            "    \"nonces_rejected\": n,       (numeric) Nonces rejected\n"
+            "    \"first_nonce_us\": n,        (numeric, optional) Microseconds from the start to the first accepted nonce\n"
+            "    \"best_nonce_us\": n,         (numeric, optional) Microseconds from the start to the best nonce\n"
+            "    \"best_deadline\": n,         (numeric, optional) Best deadline in seconds\n"
+            "    \"best_deadlines\": [        (array) Improvements of the best deadline\n"
+            "      { \"time_us\": n, \"deadline\": n }\n"
+            "    ],\n"
+            "    \"forge\": {                 (object, optional) Forge attempt of the round\n"
+            "      \"snatch\": true|false,     (boolean) Built on the previous block of the tip to replace the tip\n"
+            "      \"mature_time\": n,         (numeric) Block time the deadline matured\n"
+            "      \"forge_delay_us\": n,      (numeric) Microseconds from the deadline matured to the forge thread fired, in adjusted time\n"
+            "      \"createblock_us\": n,      (numeric) Microseconds taken to create the block\n"
+            "      \"blockhash\": \"hash\"       (string, optional) The created block, missing when creating the block failed\n"
+            "    },\n"
+            "    \"winner\": \"hash\",           (string, optional) Block connected on the previous block\n"
+            "    \"winner_deadline\": n        (numeric, optional) Deadline of that block in seconds\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getminingroundstats", "10")
+            + HelpExampleRpc("getminingroundstats", "10")
+        );
+    }
+
+    std::vector<poc::MiningRound> rounds = poc::GetMiningRounds();
+    size_t nSkip = 0;
+    if (!request.params[0].isNull()) {
+        int nCount = request.params[0].get_int();
+        if (nCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+        if ((size_t)nCount < rounds.size())
+            nSkip = rounds.size() - nCount;
+    }
+
+    UniValue result(UniValue::VARR);
+    for (auto it = rounds.cbegin() + nSkip; it != rounds.cend(); ++it) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("height", it->nHeight);
+        entry.pushKV("prevblockhash", it->hashPrevBlock.GetHex());
+        entry.pushKV("result", MiningRoundResultToString(it->result));
+        entry.pushKV("nonces_submitted", it->nNoncesSubmitted);
+        entry.pushKV("nonces_rejected", it->nNoncesRejected);
+        if (it->nFirstNonceMicros >= 0)
+            entry.pushKV("first_nonce_us", it->nFirstNonceMicros);
+        if (it->nBestNonceMicros >= 0)
+            entry.pushKV("best_nonce_us", it->nBestNonceMicros);
+        if (it->nBestDeadline != poc::INVALID_DEADLINE)
+            entry.pushKV("best_deadline", it->nBestDeadline);
+        UniValue deadlines(UniValue::VARR);
+        for (const auto& best : it->vBestDeadlines) {
+            UniValue point(UniValue::VOBJ);
+            point.pushKV("time_us", best.first);
+            point.pushKV("deadline", best.second);
+            deadlines.push_back(point);
+        }
+        entry.pushKV("best_deadlines", deadlines);
+        if (it->fForged) {
+            UniValue forge(UniValue::VOBJ);
+            forge.pushKV("snatch", it->fSnatch);
+            forge.pushKV("mature_time", it->nMatureTime);
+            forge.pushKV("forge_delay_us", it->nForgeMicros - it->nMatureTime * 1000000);
+            forge.pushKV("createblock_us", it->nCreateBlockMicros);
+            if (!it->hashForged.IsNull())
+                forge.pushKV("blockhash", it->hashForged.GetHex());
+            entry.pushKV("forge", forge);
+        }
+        if (!it->hashWinner.IsNull()) {
+            entry.pushKV("winner", it->hashWinner.GetHex());
+            entry.pushKV("winner_deadline", it->nWinnerDeadline);
+        }
+        result.push_back(entry);
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)                  argNames
   //  --------------------- ------------------------  ----------------------  ----------
@@ -234,10 +504,12 @@ static const CRPCCommand commands[] =
     { "poc",                "listsignaddresses",      &listSignAddresses,     { } },
     { "poc",                "getplotterid",           &getPlotterId,          { "passPhrase" } },
     { "poc",                "getnewplotter",          &getNewPlotter,         { } },
+    { "poc",                "getminingroundstats",    &getMiningRoundStats,   { "count" } },
 
     //! Burst mining compatible
-    { "hidden",             "getMiningInfo",          &poc_getMiningInfo,     { } },
+    { "hidden",             "getMiningInfo",          &poc_getMiningInfo,     { "timeout" } },
     { "hidden",             "submitNonce",            &poc_submitNonce,       { "nonce", "plotterId", "height", "address", "checkBind" } },
+    { "hidden",             "submitNonces",           &poc_submitNonces,      { "nonces", "checkBind" } },
 };
 
 void RegisterPoCRPCCommands(CRPCTable &t)
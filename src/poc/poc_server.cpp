@@ -0,0 +1,443 @@
+// Copyright (c) 2017-2020 The BitcoinHD Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <poc/poc.h>
+
+#include <chain.h>
+#include <logging.h>
+#include <rpc/protocol.h>
+#include <rpc/request.h>
+#include <rpc/server.h>
+#include <sync.h>
+#include <ui_interface.h>
+#include <util/system.h>
+#include <util/threadnames.h>
+#include <util/translation.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/signals2/connection.hpp>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+#include <univalue.h>
+
+/**
+ * Mining server for pool software. Each connection sends newline delimited JSON-RPC requests and receives
+ * the replies in request order. Requests read together are handled as one batch, consecutive submitNonce
+ * requests of a batch are checked together like submitNonces. After "mining.subscribe" the connection
+ * also receives "mining.notify" on every new tip and "mining.deadline" on every better deadline.
+ *
+ * Connections are not authenticated, the server must only be reachable by trusted pool software.
+ */
+namespace {
+
+//! Maximum length of a request line, protects against memory exhaustion
+const size_t MAX_POC_SERVER_LINE_LENGTH = 1024 * 1024;
+//! Maximum pending output of a connection, slower clients are disconnected
+const size_t MAX_POC_SERVER_OUTPUT_LENGTH = 16 * 1024 * 1024;
+//! Maximum number of connections
+const size_t MAX_POC_SERVER_CONNECTIONS = 128;
+
+//! Methods of the RPC table served to pool software
+const std::set<std::string> setPoCServerMethods = {
+    "getMiningInfo", "submitNonce", "submitNonces", "pos_getMiningInfo", "pos_submitProof",
+};
+
+struct PoCServerJob
+{
+    int64_t nConnectionId;
+    std::vector<std::string> vLines;
+};
+
+struct event_base* eventBase = nullptr;
+struct evconnlistener* eventListener = nullptr;
+std::thread threadPoCServer, threadPoCServerWorker;
+
+// Connections are only touched by the event thread
+std::map<int64_t, struct bufferevent*> mapConnections;
+std::set<int64_t> setSubscribed;
+int64_t nLastConnectionId = 0;
+
+Mutex csJobs;
+std::condition_variable condJobs;
+std::deque<PoCServerJob> queueJobs GUARDED_BY(csJobs);
+bool fJobsInterrupted GUARDED_BY(csJobs) = false;
+
+boost::signals2::connection pocserver_block_tip_connection;
+boost::signals2::connection pocserver_best_deadline_connection;
+
+//! Run func on the event thread
+void PostToEventThread(std::function<void()> func)
+{
+    std::function<void()>* pfunc = new std::function<void()>(std::move(func));
+    if (event_base_once(eventBase, -1, EV_TIMEOUT, [](evutil_socket_t, short, void* arg) {
+            std::unique_ptr<std::function<void()>> f(static_cast<std::function<void()>*>(arg));
+            (*f)();
+        }, pfunc, nullptr) != 0) {
+        delete pfunc;
+    }
+}
+
+void CloseConnection(int64_t nConnectionId)
+{
+    auto it = mapConnections.find(nConnectionId);
+    if (it == mapConnections.end())
+        return;
+    bufferevent_free(it->second);
+    mapConnections.erase(it);
+    setSubscribed.erase(nConnectionId);
+}
+
+void SendLine(int64_t nConnectionId, const std::string& strLine)
+{
+    auto it = mapConnections.find(nConnectionId);
+    if (it == mapConnections.end())
+        return;
+    struct evbuffer* output = bufferevent_get_output(it->second);
+    if (evbuffer_get_length(output) > MAX_POC_SERVER_OUTPUT_LENGTH) {
+        LogPrint(BCLog::POC, "pocserver: Disconnecting %d because the output is not read\n", nConnectionId);
+        CloseConnection(nConnectionId);
+        return;
+    }
+    evbuffer_add(output, strLine.data(), strLine.size());
+    evbuffer_add(output, "\n", 1);
+}
+
+void Broadcast(const std::string& strMethod, const UniValue& params)
+{
+    UniValue notification(UniValue::VOBJ);
+    notification.pushKV("id", NullUniValue);
+    notification.pushKV("method", strMethod);
+    notification.pushKV("params", params);
+    const std::string strLine = notification.write();
+    PostToEventThread([strLine]() {
+        // SendLine may close and unsubscribe the connection
+        const std::vector<int64_t> vSubscribed(setSubscribed.begin(), setSubscribed.end());
+        for (int64_t nConnectionId : vSubscribed) {
+            SendLine(nConnectionId, strLine);
+        }
+    });
+}
+
+void NotifyBlockTip(bool fInitialDownload, const CBlockIndex* pindexTip)
+{
+    if (fInitialDownload || pindexTip == nullptr)
+        return;
+    UniValue params(UniValue::VARR);
+    params.push_back(poc::GetMiningJob(*pindexTip));
+    Broadcast("mining.notify", params);
+}
+
+void NotifyBestDeadlineChanged(int32_t nHeight, uint64_t nPlotterId, uint64_t nNonce, uint64_t nNewDeadline)
+{
+    UniValue deadline(UniValue::VOBJ);
+    deadline.pushKV("height", nHeight);
+    deadline.pushKV("deadline", nNewDeadline);
+    UniValue params(UniValue::VARR);
+    params.push_back(deadline);
+    Broadcast("mining.deadline", params);
+}
+
+UniValue ExecuteRequest(const JSONRPCRequest& jreq)
+{
+    try {
+        return JSONRPCReplyObj(tableRPC.execute(jreq), NullUniValue, jreq.id);
+    } catch (const UniValue& objError) {
+        return JSONRPCReplyObj(NullUniValue, objError, jreq.id);
+    } catch (const std::exception& e) {
+        return JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, e.what()), jreq.id);
+    }
+}
+
+//! Convert submitNonce arguments to an entry of submitNonces
+bool ToNonceEntry(const UniValue& params, UniValue& entry, bool& fCheckBind)
+{
+    static const std::vector<std::string> vNames = { "nonce", "plotterId", "height", "address", "checkBind" };
+    if (params.isArray() && params.size() > vNames.size())
+        return false;
+    entry = UniValue(UniValue::VOBJ);
+    fCheckBind = true;
+    for (size_t i = 0; i < vNames.size(); i++) {
+        const UniValue& value = params.isArray() ? params[i] : find_value(params, vNames[i]);
+        if (value.isNull())
+            continue;
+        if (vNames[i] == "checkBind") {
+            if (!value.isBool())
+                return false;
+            fCheckBind = value.get_bool();
+        } else {
+            entry.pushKV(vNames[i], value);
+        }
+    }
+    return true;
+}
+
+//! Handle the requests of a batch in order, return the reply of each one
+std::vector<std::string> HandleRequests(const std::vector<std::string>& vLines, bool& fSubscribe)
+{
+    const size_t nCount = vLines.size();
+    std::vector<JSONRPCRequest> vRequests(nCount);
+    std::vector<UniValue> vReplies(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        UniValue valRequest;
+        if (!valRequest.read(vLines[i])) {
+            vReplies[i] = JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_PARSE_ERROR, "Parse error"), NullUniValue);
+            continue;
+        }
+        try {
+            vRequests[i].parse(valRequest);
+        } catch (const UniValue& objError) {
+            vReplies[i] = JSONRPCReplyObj(NullUniValue, objError, vRequests[i].id);
+            continue;
+        }
+        vRequests[i].URI = "/pocserver";
+        if (vRequests[i].strMethod != "mining.subscribe" && !setPoCServerMethods.count(vRequests[i].strMethod))
+            vReplies[i] = JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found"), vRequests[i].id);
+    }
+
+    for (size_t i = 0; i < nCount; ) {
+        if (!vReplies[i].isNull()) {
+            i++;
+            continue;
+        }
+        const JSONRPCRequest& jreq = vRequests[i];
+        UniValue entry;
+        bool fCheckBind;
+        if (jreq.strMethod != "submitNonce" || !ToNonceEntry(jreq.params, entry, fCheckBind)) {
+            if (jreq.strMethod == "mining.subscribe") {
+                fSubscribe = true;
+                JSONRPCRequest jreqMiningInfo(jreq);
+                jreqMiningInfo.strMethod = "getMiningInfo";
+                jreqMiningInfo.params = UniValue(UniValue::VARR);
+                vReplies[i] = ExecuteRequest(jreqMiningInfo);
+            } else {
+                vReplies[i] = ExecuteRequest(jreq);
+            }
+            i++;
+            continue;
+        }
+
+        // Check the run of submitNonce requests with the same checkBind together
+        std::vector<size_t> vIndexes(1, i);
+        UniValue nonces(UniValue::VARR);
+        nonces.push_back(entry);
+        size_t j = i + 1;
+        for (; j < nCount && vReplies[j].isNull() && vRequests[j].strMethod == "submitNonce"; j++) {
+            bool fEntryCheckBind;
+            if (!ToNonceEntry(vRequests[j].params, entry, fEntryCheckBind) || fEntryCheckBind != fCheckBind)
+                break;
+            vIndexes.push_back(j);
+            nonces.push_back(entry);
+        }
+        JSONRPCRequest jreqNonces(jreq);
+        jreqNonces.strMethod = "submitNonces";
+        jreqNonces.params = UniValue(UniValue::VARR);
+        jreqNonces.params.push_back(nonces);
+        jreqNonces.params.push_back(fCheckBind);
+        const UniValue reply = ExecuteRequest(jreqNonces);
+        const UniValue& result = find_value(reply, "result");
+        for (size_t k = 0; k < vIndexes.size(); k++) {
+            const JSONRPCRequest& jreqNonce = vRequests[vIndexes[k]];
+            if (!result.isObject()) {
+                vReplies[vIndexes[k]] = JSONRPCReplyObj(NullUniValue, find_value(reply, "error"), jreqNonce.id);
+                continue;
+            }
+            UniValue nonceResult = find_value(result, "nonces")[k];
+            if (find_value(nonceResult, "result").get_str() == "success")
+                nonceResult.pushKV("targetDeadline", find_value(result, "targetDeadline"));
+            vReplies[vIndexes[k]] = JSONRPCReplyObj(nonceResult, NullUniValue, jreqNonce.id);
+        }
+        i = j;
+    }
+
+    std::vector<std::string> vStrReplies;
+    vStrReplies.reserve(nCount);
+    for (const UniValue& reply : vReplies) {
+        vStrReplies.push_back(reply.write());
+    }
+    return vStrReplies;
+}
+
+void ThreadPoCServerWorker()
+{
+    util::ThreadRename("bitcoin-pocsrv");
+    while (true) {
+        PoCServerJob job;
+        {
+            WAIT_LOCK(csJobs, lock);
+            while (!fJobsInterrupted && queueJobs.empty())
+                condJobs.wait(lock);
+            if (fJobsInterrupted)
+                return;
+            job = std::move(queueJobs.front());
+            queueJobs.pop_front();
+        }
+
+        bool fSubscribe = false;
+        std::shared_ptr<std::vector<std::string>> vReplies = std::make_shared<std::vector<std::string>>(HandleRequests(job.vLines, fSubscribe));
+        const int64_t nConnectionId = job.nConnectionId;
+        PostToEventThread([nConnectionId, fSubscribe, vReplies]() {
+            if (fSubscribe && mapConnections.count(nConnectionId))
+                setSubscribed.insert(nConnectionId);
+            for (const std::string& strReply : *vReplies) {
+                SendLine(nConnectionId, strReply);
+            }
+        });
+    }
+}
+
+void ReadCallback(struct bufferevent* bev, void* ctx)
+{
+    const int64_t nConnectionId = static_cast<int64_t>(reinterpret_cast<intptr_t>(ctx));
+    struct evbuffer* input = bufferevent_get_input(bev);
+    PoCServerJob job;
+    job.nConnectionId = nConnectionId;
+    size_t n_read_out = 0;
+    char* line;
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != nullptr) {
+        if (n_read_out > 0)
+            job.vLines.emplace_back(line, n_read_out);
+        free(line);
+    }
+    if (!job.vLines.empty()) {
+        {
+            LOCK(csJobs);
+            queueJobs.push_back(std::move(job));
+        }
+        condJobs.notify_one();
+    }
+    // Everything left is an incomplete line
+    if (evbuffer_get_length(input) > MAX_POC_SERVER_LINE_LENGTH) {
+        LogPrint(BCLog::POC, "pocserver: Disconnecting %d because MAX_POC_SERVER_LINE_LENGTH exceeded\n", nConnectionId);
+        CloseConnection(nConnectionId);
+    }
+}
+
+void EventCallback(struct bufferevent* bev, short what, void* ctx)
+{
+    const int64_t nConnectionId = static_cast<int64_t>(reinterpret_cast<intptr_t>(ctx));
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        LogPrint(BCLog::POC, "pocserver: Connection %d closed\n", nConnectionId);
+        CloseConnection(nConnectionId);
+    }
+}
+
+void AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* address, int socklen, void* ctx)
+{
+    if (mapConnections.size() >= MAX_POC_SERVER_CONNECTIONS) {
+        LogPrint(BCLog::POC, "pocserver: Refusing connection, MAX_POC_SERVER_CONNECTIONS reached\n");
+        evutil_closesocket(fd);
+        return;
+    }
+    struct bufferevent* bev = bufferevent_socket_new(eventBase, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    const int64_t nConnectionId = ++nLastConnectionId;
+    mapConnections[nConnectionId] = bev;
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, reinterpret_cast<void*>(static_cast<intptr_t>(nConnectionId)));
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint(BCLog::POC, "pocserver: Accepted connection %d\n", nConnectionId);
+}
+
+void ThreadPoCServer()
+{
+    util::ThreadRename("bitcoin-pocsrvevt");
+    event_base_dispatch(eventBase);
+}
+
+} // namespace
+
+bool StartPoCServer()
+{
+    if (!gArgs.IsArgSet("-pocserver"))
+        return true;
+
+    const std::string strBind = gArgs.GetArg("-pocserver", "");
+    struct sockaddr_storage bind_addr;
+    int bind_addrlen = sizeof(bind_addr);
+    if (evutil_parse_sockaddr_port(strBind.c_str(), (struct sockaddr*)&bind_addr, &bind_addrlen) < 0)
+        return InitError(strprintf(_("Invalid -pocserver address: '%s'").translated, strBind));
+
+    assert(!eventBase);
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    eventBase = event_base_new();
+    if (!eventBase)
+        return InitError("pocserver: Unable to create event_base");
+    eventListener = evconnlistener_new_bind(eventBase, AcceptCallback, nullptr, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+        (struct sockaddr*)&bind_addr, bind_addrlen);
+    if (!eventListener) {
+        event_base_free(eventBase);
+        eventBase = nullptr;
+        return InitError(strprintf(_("Unable to bind -pocserver to %s").translated, strBind));
+    }
+
+    LogPrintf("Starting PoC server on %s\n", strBind);
+    {
+        LOCK(csJobs);
+        fJobsInterrupted = false;
+    }
+    pocserver_block_tip_connection = uiInterface.NotifyBlockTip_connect(&NotifyBlockTip);
+    pocserver_best_deadline_connection = uiInterface.NotifyBestDeadlineChanged_connect(&NotifyBestDeadlineChanged);
+    threadPoCServer = std::thread(ThreadPoCServer);
+    threadPoCServerWorker = std::thread(ThreadPoCServerWorker);
+    return true;
+}
+
+void InterruptPoCServer()
+{
+    if (!eventBase)
+        return;
+    LogPrintf("Interrupting PoC server\n");
+    {
+        LOCK(csJobs);
+        fJobsInterrupted = true;
+    }
+    condJobs.notify_all();
+    event_base_once(eventBase, -1, EV_TIMEOUT, [](evutil_socket_t, short, void*) {
+        event_base_loopbreak(eventBase);
+    }, nullptr, nullptr);
+}
+
+void StopPoCServer()
+{
+    if (!eventBase)
+        return;
+    pocserver_block_tip_connection.disconnect();
+    pocserver_best_deadline_connection.disconnect();
+    if (threadPoCServerWorker.joinable())
+        threadPoCServerWorker.join();
+    if (threadPoCServer.joinable())
+        threadPoCServer.join();
+    while (!mapConnections.empty()) {
+        CloseConnection(mapConnections.begin()->first);
+    }
+    {
+        LOCK(csJobs);
+        queueJobs.clear();
+    }
+    evconnlistener_free(eventListener);
+    eventListener = nullptr;
+    event_base_free(eventBase);
+    eventBase = nullptr;
+}
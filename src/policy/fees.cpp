@@ -12,6 +12,8 @@
 #include <util/system.h>
 
 static constexpr double INF_FEERATE = 1e99;
+//! Pending decay at which TxConfirmStats applies it to its averages
+static constexpr double MAX_DECAY_SCALE = 1e8;
 
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
     static const std::map<FeeEstimateHorizon, std::string> horizon_strings = {
@@ -63,6 +65,12 @@ private:
 
     double decay;
 
+    // The averages above are kept scaled by the decay that has yet to be applied to them:
+    // the actual averages are the stored ones divided by decayScale. Decaying just grows
+    // decayScale and new data points are added scaled by it, until it is applied to all
+    // of them at once in Rescale()
+    double decayScale;
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
@@ -75,6 +83,9 @@ private:
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Apply the pending decay to the averages and reset decayScale */
+    void Rescale();
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -143,6 +154,7 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
     : buckets(defaultBuckets), bucketMap(defaultBucketMap)
 {
     decay = _decay;
+    decayScale = 1;
     assert(_scale != 0 && "_scale must be non-zero");
     scale = _scale;
     confAvg.resize(maxPeriods);
@@ -187,22 +199,31 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
     int periodsToConfirm = (blocksToConfirm + scale - 1)/scale;
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += decayScale;
     }
-    txCtAvg[bucketindex]++;
-    avg[bucketindex] += val;
+    txCtAvg[bucketindex] += decayScale;
+    avg[bucketindex] += val * decayScale;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
+{
+    decayScale /= decay;
+    // Keep the scaled averages far from the range of double
+    if (decayScale > MAX_DECAY_SCALE)
+        Rescale();
+}
+
+void TxConfirmStats::Rescale()
 {
     for (unsigned int j = 0; j < buckets.size(); j++) {
         for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay;
+            confAvg[i][j] = confAvg[i][j] / decayScale;
         for (unsigned int i = 0; i < failAvg.size(); i++)
-            failAvg[i][j] = failAvg[i][j] * decay;
-        avg[j] = avg[j] * decay;
-        txCtAvg[j] = txCtAvg[j] * decay;
+            failAvg[i][j] = failAvg[i][j] / decayScale;
+        avg[j] = avg[j] / decayScale;
+        txCtAvg[j] = txCtAvg[j] / decayScale;
     }
+    decayScale = 1;
 }
 
 // returns -1 on error conditions
@@ -250,9 +271,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
+        nConf += confAvg[periodTarget - 1][bucket] / decayScale;
+        totalNum += txCtAvg[bucket] / decayScale;
+        failNum += failAvg[periodTarget - 1][bucket] / decayScale;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -310,13 +331,13 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int minBucket = std::min(bestNearBucket, bestFarBucket);
     unsigned int maxBucket = std::max(bestNearBucket, bestFarBucket);
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
-        txSum += txCtAvg[j];
+        txSum += txCtAvg[j] / decayScale;
     }
     if (foundAnswer && txSum != 0) {
         txSum = txSum / 2;
         for (unsigned int j = minBucket; j <= maxBucket; j++) {
-            if (txCtAvg[j] < txSum)
-                txSum -= txCtAvg[j];
+            if (txCtAvg[j] / decayScale < txSum)
+                txSum -= txCtAvg[j] / decayScale;
             else { // we're in the right bucket
                 median = avg[j] / txCtAvg[j];
                 break;
@@ -360,12 +381,24 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(CAutoFile& fileout) const
 {
+    // The file holds the actual averages
+    const auto unscaled = [this](std::vector<double> v) {
+        for (double& x : v)
+            x /= decayScale;
+        return v;
+    };
+    std::vector<std::vector<double>> confAvgOut, failAvgOut;
+    for (const auto& v : confAvg)
+        confAvgOut.push_back(unscaled(v));
+    for (const auto& v : failAvg)
+        failAvgOut.push_back(unscaled(v));
+
     fileout << decay;
     fileout << scale;
-    fileout << avg;
-    fileout << txCtAvg;
-    fileout << confAvg;
-    fileout << failAvg;
+    fileout << unscaled(avg);
+    fileout << unscaled(txCtAvg);
+    fileout << confAvgOut;
+    fileout << failAvgOut;
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -384,6 +417,7 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     if (scale == 0) {
         throw std::runtime_error("Corrupt estimates file. Scale must be non-zero");
     }
+    decayScale = 1;
 
     filein >> avg;
     if (avg.size() != numBuckets) {
@@ -464,7 +498,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += decayScale;
         }
     }
 }
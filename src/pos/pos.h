@@ -6,15 +6,14 @@
 #define BITCOIN_POS_POS_H
 
 #include <pos/bls.h>
+#include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <uint256.h>
 
 #include <string>
 #include <vector>
 
-class CBlockHeader;
 class CBlockIndex;
-class CChiaProofOfSpace;
 
 namespace Consensus { struct Params; }
 
@@ -59,10 +58,46 @@ bls::G1Element CreatePlotPubKey(const bls::G1Element& localPubKey, const bls::G1
 */
 bls::PrivateKey CreateTaprootPrivateKey(const bls::G1Element& localPubKey, const bls::G1Element& farmerPubKey);
 
+/** Header of a chiapos plot file
+*/
+struct PlotFileHeader {
+    uint256 plotId;
+    int32_t k = 0;
+    //! Pool public key of OG plots, or pool contract puzzle hash of OP plots
+    Bytes poolPubKey;
+    Bytes farmerPubKey;
+    Bytes localMasterPrivateKey;
+};
+
+/** Size of the plot file header read by ParsePlotFileHeader, large enough for any memo
+*/
+const static size_t MAX_PLOT_FILE_HEADER_SIZE = 19 + 32 + 1 + 2 + 256 + 2 + 256;
+
+/** Parse the header of a chiapos plot file, the leading bytes of the file. Return false for other files
+*/
+bool ParsePlotFileHeader(const Bytes& data, PlotFileHeader& header);
+
+/** Sign a proof of space found by a plot of the farmer, see pos_submitProof
+*/
+CChiaProofOfSpace SignProofOfSpace(const bls::PrivateKey& farmerPrivateKey, const Bytes& poolPubKey, const bls::PrivateKey& localPrivateKey,
+    int32_t k, const Bytes& proof, const uint256& challenge, int32_t nScanIterations);
+
 /** Create challenge for iterations
 */
 uint256 CreateChallenge(const uint256& challenge, int32_t scanIterations);
 
+/** Whether a plot takes part in a challenge, passing 1 of 2^filterBits plots
+*/
+bool PassesPlotFilter(const uint256& plotId, const uint256& challenge, int filterBits);
+
+/** Same as PassesPlotFilter for many plots, the filter hashes of all plots are computed by the multi-block SHA-256
+*/
+std::vector<bool> PassesPlotFilters(const std::vector<uint256>& plotIds, const uint256& challenge, int filterBits);
+
+/** Convert the quality of a proof of space to its iterations
+*/
+uint64_t CalculateIterations(const Bytes& quality, const uint256& challenge, int32_t k, uint64_t nBaseTarget);
+
 /** For VerifyBlockHeader and VerifyAndUpdateBlockHeader */
 enum class VerifyResult {
     Success,
@@ -88,6 +123,21 @@ std::string ToString(VerifyResult result);
  */
 VerifyResult VerifyBlockHeader(const CBlockIndex& prevBlockIndex, const CBlockHeader& block, const Consensus::Params& params);
 
+/** Run the proof check queue */
+void ThreadProofCheck(int worker_num);
+
+/**
+ * Verify the PoS signatures of a run of headers with one aggregate check, and validate their
+ * proofs on the proof check threads meanwhile. The results are kept for VerifyBlockHeader(),
+ * which checks each header alone when the aggregate fails
+ *
+ * @param prevBlockIndex    Previous block of the first header
+ * @param itBegin           First header
+ * @param itEnd             End of headers, each one connected to the previous one
+ * @param params            Consensus params
+ */
+void BatchVerifyBlockHeaders(const CBlockIndex& prevBlockIndex, std::vector<CHashedBlockHeader>::const_iterator itBegin, std::vector<CHashedBlockHeader>::const_iterator itEnd, const Consensus::Params& params);
+
 /**
  * Verify and Update PoS to block
  *
@@ -113,4 +163,9 @@ std::pair<uint64_t, uint64_t> GenerateStakingPoolNonces(const uint256 &epochHash
 
 }
 
+/** Harvester of local chiapos plot files, see -posplotdir */
+bool StartPoSHarvester();
+void InterruptPoSHarvester();
+void StopPoSHarvester();
+
 #endif
\ No newline at end of file
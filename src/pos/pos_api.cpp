@@ -5,12 +5,18 @@
 #include <pos/pos.h>
 
 #include <arith_uint256.h>
+#include <crypto/common.h>
 #include <crypto/sha256.h>
 #include <poc/poc.h>
 #include <primitives/block.h>
 #include <util/bip39.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <limits>
+
+#include <string.h>
+
 namespace {
 
 inline uint256 sha256(const std::vector<pos::Bytes>& data) {
@@ -125,6 +131,77 @@ bls::PrivateKey CreateTaprootPrivateKey(const bls::G1Element& localPubKey, const
     return bls::AugSchemeMPL().KeyGen(std::vector<unsigned char>(taprootHash.begin(), taprootHash.end()));
 }
 
+bool ParsePlotFileHeader(const Bytes& data, PlotFileHeader& header)
+{
+    // "Proof of Space Plot", plot id, k, format description and memo, both with a big endian 2 byte length
+    static const std::string strMagic = "Proof of Space Plot";
+    size_t nPos = strMagic.size();
+    if (data.size() < nPos + 32 + 1 + 2 || memcmp(data.data(), strMagic.data(), nPos) != 0)
+        return false;
+    header.plotId = uint256(Bytes(data.begin() + nPos, data.begin() + nPos + 32));
+    nPos += 32;
+    header.k = data[nPos++];
+    const size_t nFormatSize = ((size_t)data[nPos] << 8 | data[nPos + 1]);
+    nPos += 2 + nFormatSize;
+    if (data.size() < nPos + 2)
+        return false;
+    const size_t nMemoSize = ((size_t)data[nPos] << 8 | data[nPos + 1]);
+    nPos += 2;
+    if (data.size() < nPos + nMemoSize)
+        return false;
+
+    // Memo: pool public key (OG) or pool contract puzzle hash (OP), farmer public key and local master private key
+    size_t nPoolSize;
+    if (nMemoSize == bls::G1Element::SIZE * 2 + bls::PrivateKey::PRIVATE_KEY_SIZE)
+        nPoolSize = bls::G1Element::SIZE;
+    else if (nMemoSize == 32 + bls::G1Element::SIZE + bls::PrivateKey::PRIVATE_KEY_SIZE)
+        nPoolSize = 32;
+    else
+        return false;
+    auto itMemo = data.begin() + nPos;
+    header.poolPubKey.assign(itMemo, itMemo + nPoolSize);
+    itMemo += nPoolSize;
+    header.farmerPubKey.assign(itMemo, itMemo + bls::G1Element::SIZE);
+    itMemo += bls::G1Element::SIZE;
+    header.localMasterPrivateKey.assign(itMemo, itMemo + bls::PrivateKey::PRIVATE_KEY_SIZE);
+    return true;
+}
+
+CChiaProofOfSpace SignProofOfSpace(const bls::PrivateKey& farmerPrivateKey, const Bytes& poolPubKey, const bls::PrivateKey& localPrivateKey,
+    int32_t k, const Bytes& proof, const uint256& challenge, int32_t nScanIterations)
+{
+    const std::vector<uint8_t> vchChallenge(challenge.begin(), challenge.end());
+    const bls::G1Element farmerPublicKey = farmerPrivateKey.GetG1Element();
+    const bls::G1Element localPublicKey = localPrivateKey.GetG1Element();
+
+    CChiaProofOfSpace pos;
+    // agg
+    if (poolPubKey.size() == 32) {
+        // OP (with taproot)
+        auto taprootPrivateKey = CreateTaprootPrivateKey(localPublicKey, farmerPublicKey);
+        auto taprootPulicKey = taprootPrivateKey.GetG1Element();
+        auto plotPublicKey = CreatePlotPubKey(localPublicKey, farmerPublicKey, taprootPulicKey);
+        auto farmerSignature = bls::AugSchemeMPL().Sign(farmerPrivateKey, vchChallenge, plotPublicKey);
+        auto localSignature = bls::AugSchemeMPL().Sign(localPrivateKey, vchChallenge, plotPublicKey);
+        auto taprootSignature = bls::AugSchemeMPL().Sign(taprootPrivateKey, vchChallenge, plotPublicKey);
+        pos.vchSignature = bls::AugSchemeMPL().Aggregate({taprootSignature, localSignature, farmerSignature}).Serialize();
+    } else {
+        // OG
+        auto plotPublicKey = CreatePlotPubKey(localPublicKey, farmerPublicKey);
+        auto farmerSignature = bls::AugSchemeMPL().Sign(farmerPrivateKey, vchChallenge, plotPublicKey);
+        auto localSignature = bls::AugSchemeMPL().Sign(localPrivateKey, vchChallenge, plotPublicKey);
+        pos.vchSignature = bls::AugSchemeMPL().Aggregate({localSignature, farmerSignature}).Serialize();
+    }
+
+    pos.nScanIterations = nScanIterations;
+    pos.vchFarmerPubKey = farmerPublicKey.Serialize();
+    pos.vchPoolPubKey = poolPubKey;
+    pos.vchLocalPubKey = localPublicKey.Serialize();
+    pos.nPlotK = k;
+    pos.vchProof = proof;
+    return pos;
+}
+
 uint256 CreateChallenge(const uint256& challenge, int32_t scanIterations)
 {
     uint64_t salt = htobe64(static_cast<uint64_t>(scanIterations));
@@ -139,22 +216,34 @@ uint256 CreateChallenge(const uint256& challenge, int32_t scanIterations)
 
 std::pair<uint64_t, uint64_t> GenerateStakingPoolNonces(const uint256 &epochHash, uint32_t nTargetHeight, const CAccountID &poolID, uint64_t votePower)
 {
-    const uint32_t height_be = htobe32(nTargetHeight);
+    //! Every message is one 64-byte block: epoch hash, pool ID, height and nonce, all big endian
+    static constexpr size_t MESSAGE_SIZE = uint256::WIDTH + CAccountID::WIDTH + sizeof(uint32_t) + sizeof(uint64_t);
+    static constexpr size_t NONCE_OFFSET = MESSAGE_SIZE - sizeof(uint64_t);
+    static constexpr size_t BATCH_SIZE = 256;
+    static_assert(MESSAGE_SIZE == 64, "Staking pool nonce message must be a single SHA-256 block");
+
+    unsigned char message[MESSAGE_SIZE];
+    memcpy(message, epochHash.begin(), uint256::WIDTH);
+    memcpy(message + uint256::WIDTH, poolID.begin(), CAccountID::WIDTH);
+    WriteBE32(message + uint256::WIDTH + CAccountID::WIDTH, nTargetHeight);
+
+    std::vector<unsigned char> vMessages(BATCH_SIZE * MESSAGE_SIZE), vResults(BATCH_SIZE * CSHA256::OUTPUT_SIZE);
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+        memcpy(vMessages.data() + i * MESSAGE_SIZE, message, MESSAGE_SIZE);
+
     uint64_t bestNonce = 0, bestDeadline = std::numeric_limits<uint64_t>::max();
-    for (uint64_t nonce = 1; nonce <= votePower; nonce++) {
-        const uint64_t nonce_be = htobe64(nonce);
-
-        uint256 result;
-        CSHA256().Write(epochHash.begin(), uint256::WIDTH).
-                  Write(poolID.begin(), CAccountID::WIDTH).
-                  Write((const unsigned char*)&height_be, sizeof(height_be)).
-                  Write((const unsigned char*)&nonce_be, sizeof(nonce_be)).
-                  Finalize((unsigned char*)&result);
-
-        uint64_t deadline = result.GetUint64(0);
-        if (deadline < bestDeadline) {
-            bestNonce = nonce;
-            bestDeadline = deadline;
+    for (uint64_t nonceStart = 1; nonceStart <= votePower; nonceStart += BATCH_SIZE) {
+        const size_t count = (size_t) std::min<uint64_t>(BATCH_SIZE, votePower - nonceStart + 1);
+        for (size_t i = 0; i < count; i++)
+            WriteBE64(vMessages.data() + i * MESSAGE_SIZE + NONCE_OFFSET, nonceStart + i);
+        SHA256S64(vResults.data(), vMessages.data(), count);
+
+        for (size_t i = 0; i < count; i++) {
+            uint64_t deadline = ReadLE64(vResults.data() + i * CSHA256::OUTPUT_SIZE);
+            if (deadline < bestDeadline) {
+                bestNonce = nonceStart + i;
+                bestDeadline = deadline;
+            }
         }
     }
     return std::make_pair(bestNonce, bestDeadline);
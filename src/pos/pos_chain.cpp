@@ -5,11 +5,28 @@
 #include <pos/pos.h>
 
 #include <chain.h>
+#include <checkqueue.h>
+#include <compat/endian.h>
+#include <crypto/sha256.h>
+#include <crypto/shabal256.h>
+#include <cuckoocache.h>
 #include <poc/poc.h>
 #include <primitives/block.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <sync.h>
+#include <util/threadnames.h>
 
 #include <chiapos/api.h>
 
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
+
 namespace {
 
 inline uint256 sha256(const std::vector<uint256>& data) {
@@ -35,35 +52,206 @@ inline uint64_t expected_plot_size(int32_t k)
     return ((2ull * k) + 1) * (1ull << (k - 1));
 }
 
-bool passes_plot_filter(const uint256& plotId, const uint256& challenge, int filterBits)
+inline bool check_pos(const CChiaProofOfSpace& pos)
 {
-    assert(filterBits >= 0 && filterBits < 32);
-    if (filterBits == 0)
-        return true;
+    if (pos.IsNull() || !pos.IsValid())
+        return false;
 
-    uint8_t hash[32];
+    if (pos.nPlotK < pos::MIN_PLOT_SIZE || pos.nPlotK > pos::MAX_PLOT_SIZE)
+        return false;
+
+    return true;
+}
+
+struct PlotPubKey {
+    bls::G1Element key;
+    pos::Bytes vchKey;
+};
+
+//! Plot public keys by local and farmer public keys, with taproot it derives a private key every time
+static const size_t MAX_PLOT_PUBKEY_CACHE_SIZE = 4096;
+Mutex csPlotPubKeys;
+std::map<pos::Bytes, PlotPubKey> mapPlotPubKeys GUARDED_BY(csPlotPubKeys);
+
+PlotPubKey GetPlotPubKey(const CChiaProofOfSpace& pos)
+{
+    const bool fTaproot = pos.vchPoolPubKey.size() == 32;
+    pos::Bytes vchCacheKey(pos.vchLocalPubKey.begin(), pos.vchLocalPubKey.end());
+    vchCacheKey.insert(vchCacheKey.end(), pos.vchFarmerPubKey.begin(), pos.vchFarmerPubKey.end());
+    vchCacheKey.push_back(fTaproot ? 1 : 0);
+    {
+        LOCK(csPlotPubKeys);
+        auto it = mapPlotPubKeys.find(vchCacheKey);
+        if (it != mapPlotPubKeys.end())
+            return it->second;
+    }
+
+    PlotPubKey plotPubKey;
+    plotPubKey.key = pos::CreatePlotPubKey(
+        bls::G1Element::FromByteVector(pos.vchLocalPubKey.ToVector()),
+        bls::G1Element::FromByteVector(pos.vchFarmerPubKey.ToVector()),
+        fTaproot);
+    plotPubKey.vchKey = plotPubKey.key.Serialize();
+
+    LOCK(csPlotPubKeys);
+    if (mapPlotPubKeys.size() >= MAX_PLOT_PUBKEY_CACHE_SIZE)
+        mapPlotPubKeys.clear();
+    mapPlotPubKeys.emplace(std::move(vchCacheKey), plotPubKey);
+    return plotPubKey;
+}
+
+//! Signatures already verified, by a batch of headers or by a previous check of the same header
+static const size_t MAX_VERIFIED_SIGNATURES = 8192;
+Mutex csVerifiedSignatures;
+std::set<uint256> setVerifiedSignatures GUARDED_BY(csVerifiedSignatures);
+std::deque<uint256> queueVerifiedSignatures GUARDED_BY(csVerifiedSignatures);
+
+uint256 GetSignatureHash(const PlotPubKey& plotPubKey, const uint256& challenge, const decltype(CChiaProofOfSpace::vchSignature)& vchSignature)
+{
+    uint256 hash;
     CSHA256()
-        .Write(plotId.begin(), plotId.size())
+        .Write(plotPubKey.vchKey.data(), plotPubKey.vchKey.size())
         .Write(challenge.begin(), challenge.size())
-        .Finalize(hash);
+        .Write(vchSignature.data(), vchSignature.size())
+        .Finalize(hash.begin());
+    return hash;
+}
 
-    // filter bits: Diff with chia's BitArray
-    uint32_t data = ((uint32_t)hash[0]) | ((uint32_t)hash[1]) << 8 | ((uint32_t)hash[2]) << 16 | ((uint32_t)hash[3]) << 24;
-    data = data << (32 - filterBits);
-    return data == 0;
+bool IsVerifiedSignature(const uint256& hash)
+{
+    LOCK(csVerifiedSignatures);
+    return setVerifiedSignatures.count(hash) != 0;
 }
 
-inline bool check_pos(const CChiaProofOfSpace& pos)
+void AddVerifiedSignature(const uint256& hash)
 {
-    if (pos.IsNull() || !pos.IsValid())
-        return false;
+    LOCK(csVerifiedSignatures);
+    if (!setVerifiedSignatures.insert(hash).second)
+        return;
+    queueVerifiedSignatures.push_back(hash);
+    if (queueVerifiedSignatures.size() > MAX_VERIFIED_SIGNATURES) {
+        setVerifiedSignatures.erase(queueVerifiedSignatures.front());
+        queueVerifiedSignatures.pop_front();
+    }
+}
 
-    if (pos.nPlotK < pos::MIN_PLOT_SIZE || pos.nPlotK > pos::MAX_PLOT_SIZE)
-        return false;
+//! Qualities of proofs by plot id, k, challenge and proof. Empty for an invalid proof
+static const size_t MAX_PROOF_QUALITY_CACHE_SIZE = 4096;
+Mutex csProofQualities;
+std::map<uint256, pos::Bytes> mapProofQualities GUARDED_BY(csProofQualities);
 
-    return true;
+pos::Bytes GetProofQuality(const uint256& plotId, const CChiaProofOfSpace& pos, const uint256& challenge)
+{
+    uint256 hash;
+    const int32_t k = pos.nPlotK;
+    CSHA256()
+        .Write(plotId.begin(), plotId.size())
+        .Write((const unsigned char*)&k, sizeof(k))
+        .Write(challenge.begin(), challenge.size())
+        .Write(pos.vchProof.data(), pos.vchProof.size())
+        .Finalize(hash.begin());
+    {
+        LOCK(csProofQualities);
+        auto it = mapProofQualities.find(hash);
+        if (it != mapProofQualities.end())
+            return it->second;
+    }
+
+    pos::Bytes quality = chiapos::ValidateProof(
+        std::vector<uint8_t>(plotId.begin(), plotId.end()),
+        static_cast<uint8_t>(pos.nPlotK),
+        std::vector<uint8_t>(challenge.begin(), challenge.end()),
+        pos.vchProof.ToVector());
+
+    LOCK(csProofQualities);
+    if (mapProofQualities.size() >= MAX_PROOF_QUALITY_CACHE_SIZE)
+        mapProofQualities.clear();
+    mapProofQualities.emplace(hash, quality);
+    return quality;
 }
 
+/**
+ * Closure representing the proof of space check of one header, see BatchVerifyBlockHeaders().
+ * It only fills the quality cache, the header check reports the result.
+ */
+class CProofCheck
+{
+private:
+    const CChiaProofOfSpace* pos;
+    uint256 challenge;
+    int nFilterBits;
+
+public:
+    CProofCheck() : pos(nullptr), nFilterBits(0) {}
+    CProofCheck(const CChiaProofOfSpace* posIn, const uint256& challengeIn, int nFilterBitsIn) :
+        pos(posIn), challenge(challengeIn), nFilterBits(nFilterBitsIn) {}
+
+    bool operator()() {
+        try {
+            const uint256 plotId = ::pos::CreatePlotId(pos->vchPoolPubKey.ToVector(), GetPlotPubKey(*pos).vchKey);
+            if (::pos::PassesPlotFilter(plotId, challenge, nFilterBits))
+                GetProofQuality(plotId, *pos, challenge);
+        } catch (...) {
+        }
+        return true;
+    }
+
+    void swap(CProofCheck& check) {
+        std::swap(pos, check.pos);
+        std::swap(challenge, check.challenge);
+        std::swap(nFilterBits, check.nFilterBits);
+    }
+};
+
+static CCheckQueue<CProofCheck> proofcheckqueue(16);
+
+/**
+ * Valid PoS header cache, to avoid verifying the proof of space of a header twice (once as a
+ * header, and again through submitheader, compact block reconstruction or the block checks)
+ */
+class CPosHeaderCache
+{
+private:
+    //! Entries are SHA256(nonce || previous block hash || unsignatured header hash || filter bits)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_poscache;
+
+public:
+    //! Enough for the headers of a few days, 1 MiB
+    static const size_t MAX_CACHE_BYTES = 1 << 20;
+
+    CPosHeaderCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(MAX_CACHE_BYTES);
+    }
+
+    void
+    ComputeEntry(uint256& entry, const CBlockIndex& prevBlockIndex, const CBlockHeader& block, int nFilterBits)
+    {
+        const uint256 prevHash = prevBlockIndex.GetBlockHash();
+        const uint256 hash = block.GetUnsignaturedHash();
+        CSHA256().Write(nonce.begin(), 32).Write(prevHash.begin(), 32).Write(hash.begin(), 32).Write((const unsigned char*)&nFilterBits, sizeof(nFilterBits)).Finalize(entry.begin());
+    }
+
+    bool
+    Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_poscache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_poscache);
+        setValid.insert(entry);
+    }
+};
+
+static CPosHeaderCache posHeaderCache;
+
 ::pos::VerifyResult VerifyAndGetIterations(
     uint64_t& iterations,
     const CBlockIndex& prevBlockIndex,
@@ -72,50 +260,101 @@ inline bool check_pos(const CChiaProofOfSpace& pos)
     const Consensus::Params& params)
 {
     // 1.create plot public key
-    bls::G1Element plotPubKey = pos::CreatePlotPubKey(
-        bls::G1Element::FromByteVector(pos.vchLocalPubKey),
-        bls::G1Element::FromByteVector(pos.vchFarmerPubKey),
-        pos.vchPoolPubKey.size() == 32);
+    const PlotPubKey plotPubKey = GetPlotPubKey(pos);
 
     // 2.create and filter plot id
-    const uint256 plotId = ::pos::CreatePlotId(pos.vchPoolPubKey, plotPubKey.Serialize());
-    if (!passes_plot_filter(plotId, challenge, params.nMercuryPosFilterBits))
+    const uint256 plotId = ::pos::CreatePlotId(pos.vchPoolPubKey.ToVector(), plotPubKey.vchKey);
+    if (!::pos::PassesPlotFilter(plotId, challenge, params.nMercuryPosFilterBits))
         return ::pos::VerifyResult::ErrorPlotFilter;
 
     // 3.verify signature
-    bool fVerified = bls::AugSchemeMPL().Verify(
-        plotPubKey,
-        std::vector<uint8_t>(challenge.begin(), challenge.end()),
-        bls::G2Element::FromByteVector(pos.vchSignature));
-    if (!fVerified)
-        return ::pos::VerifyResult::ErrorBLS;
+    const uint256 signatureHash = GetSignatureHash(plotPubKey, challenge, pos.vchSignature);
+    if (!IsVerifiedSignature(signatureHash)) {
+        bool fVerified = bls::AugSchemeMPL().Verify(
+            plotPubKey.key,
+            std::vector<uint8_t>(challenge.begin(), challenge.end()),
+            bls::G2Element::FromByteVector(pos.vchSignature.ToVector()));
+        if (!fVerified)
+            return ::pos::VerifyResult::ErrorBLS;
+        AddVerifiedSignature(signatureHash);
+    }
 
     // 4.quality AND iterations
-    auto quality = chiapos::ValidateProof(
-        std::vector<uint8_t>(plotId.begin(), plotId.end()),
-        static_cast<uint8_t>(pos.nPlotK),
-        std::vector<uint8_t>(challenge.begin(), challenge.end()),
-        pos.vchProof);
+    auto quality = GetProofQuality(plotId, pos, challenge);
     if (quality.size() != 32)
         return ::pos::VerifyResult::ErrorPoS;
+    iterations = ::pos::CalculateIterations(quality, challenge, pos.nPlotK, prevBlockIndex.nBaseTarget);
+
+    return ::pos::VerifyResult::Success;
+}
+
+}
+
+namespace pos {
+
+//! Whether the filter hash of a plot has filterBits zero bits, see PassesPlotFilter()
+static inline bool IsFilterHashPassed(const uint8_t* hash, int filterBits)
+{
+    // filter bits: Diff with chia's BitArray
+    uint32_t data = ((uint32_t)hash[0]) | ((uint32_t)hash[1]) << 8 | ((uint32_t)hash[2]) << 16 | ((uint32_t)hash[3]) << 24;
+    data = data << (32 - filterBits);
+    return data == 0;
+}
+
+bool PassesPlotFilter(const uint256& plotId, const uint256& challenge, int filterBits)
+{
+    assert(filterBits >= 0 && filterBits < 32);
+    if (filterBits == 0)
+        return true;
+
+    uint8_t hash[32];
+    CSHA256()
+        .Write(plotId.begin(), plotId.size())
+        .Write(challenge.begin(), challenge.size())
+        .Finalize(hash);
+    return IsFilterHashPassed(hash, filterBits);
+}
+
+std::vector<bool> PassesPlotFilters(const std::vector<uint256>& plotIds, const uint256& challenge, int filterBits)
+{
+    assert(filterBits >= 0 && filterBits < 32);
+    if (filterBits == 0)
+        return std::vector<bool>(plotIds.size(), true);
+
+    //! Every message is one 64-byte block: plot id and challenge
+    static constexpr size_t MESSAGE_SIZE = uint256::WIDTH * 2;
+    static constexpr size_t BATCH_SIZE = 256;
+    std::vector<unsigned char> vMessages(BATCH_SIZE * MESSAGE_SIZE), vResults(BATCH_SIZE * CSHA256::OUTPUT_SIZE);
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+        memcpy(vMessages.data() + i * MESSAGE_SIZE + uint256::WIDTH, challenge.begin(), uint256::WIDTH);
+
+    std::vector<bool> vPassed(plotIds.size());
+    for (size_t nOffset = 0; nOffset < plotIds.size(); nOffset += BATCH_SIZE) {
+        const size_t count = std::min(BATCH_SIZE, plotIds.size() - nOffset);
+        for (size_t i = 0; i < count; i++)
+            memcpy(vMessages.data() + i * MESSAGE_SIZE, plotIds[nOffset + i].begin(), uint256::WIDTH);
+        SHA256S64(vResults.data(), vMessages.data(), count);
+        for (size_t i = 0; i < count; i++)
+            vPassed[nOffset + i] = IsFilterHashPassed(vResults.data() + i * CSHA256::OUTPUT_SIZE, filterBits);
+    }
+    return vPassed;
+}
+
+uint64_t CalculateIterations(const Bytes& quality, const uint256& challenge, int32_t k, uint64_t nBaseTarget)
+{
     static const arith_uint1024 bigDifficultyConstantFactor = arith_uint1024_shift(67);
     static const arith_uint1024 bigMax256 = arith_uint1024_shift(256);
-    arith_uint1024 bigDifficulty = arith_uint1024(poc::INITIAL_BASE_TARGET / prevBlockIndex.nBaseTarget);
+    arith_uint1024 bigDifficulty = arith_uint1024(poc::INITIAL_BASE_TARGET / nBaseTarget);
     arith_uint1024 bigQualityHash = UintToArith1024BE(sha256({ uint256(quality), challenge }));
-    arith_uint1024 bigPlotSize = arith_uint1024(expected_plot_size(pos.nPlotK));
+    arith_uint1024 bigPlotSize = arith_uint1024(expected_plot_size(k));
     arith_uint1024 bigIterations = (bigDifficulty * bigDifficultyConstantFactor * bigQualityHash) / (bigMax256 * bigPlotSize);
 
-    iterations = bigIterations.GetLow64();
+    uint64_t iterations = bigIterations.GetLow64();
     if (iterations == 0)
         iterations = 1;
-
-    return ::pos::VerifyResult::Success;
+    return iterations;
 }
 
-}
-
-namespace pos {
-
 std::string ToString(VerifyResult result)
 {
     switch (result) {
@@ -142,9 +381,14 @@ VerifyResult VerifyBlockHeader(const CBlockIndex& prevBlockIndex, const CBlockHe
     // 1.check params
     if (!check_pos(block.pos))
         return VerifyResult::Error;
-    if (block.nPlotterId != ToFarmerId(block.pos.vchFarmerPubKey))
+    if (block.nPlotterId != ToFarmerId(block.pos.vchFarmerPubKey.ToVector()))
         return VerifyResult::Error;
 
+    uint256 entry;
+    posHeaderCache.ComputeEntry(entry, prevBlockIndex, block, params.nMercuryPosFilterBits);
+    if (posHeaderCache.Get(entry))
+        return VerifyResult::Success;
+
     const uint256 challenge = CreateChallenge(prevBlockIndex.GetNextGenerationSignature(), block.pos.nScanIterations);
 
     // 2.verify
@@ -159,9 +403,97 @@ VerifyResult VerifyBlockHeader(const CBlockIndex& prevBlockIndex, const CBlockHe
     if (iterations != block.nNonce)
         return VerifyResult::ErrorIterations;
 
+    posHeaderCache.Set(entry);
     return VerifyResult::Success;
 }
 
+void ThreadProofCheck(int worker_num)
+{
+    util::ThreadRename(strprintf("posch.%i", worker_num));
+    proofcheckqueue.Thread();
+}
+
+void BatchVerifyBlockHeaders(const CBlockIndex& prevBlockIndex, std::vector<CHashedBlockHeader>::const_iterator itBegin, std::vector<CHashedBlockHeader>::const_iterator itEnd, const Consensus::Params& params)
+{
+    // Challenges of the PoS headers
+    std::vector<std::pair<const CChiaProofOfSpace*, uint256>> vChallenges;
+    uint256 hashPrevBlock = prevBlockIndex.GetBlockHash();
+    uint256 generationSignature = prevBlockIndex.GetNextGenerationSignature();
+    int nPrevHeight = prevBlockIndex.nHeight;
+    for (auto it = itBegin; it != itEnd; it++) {
+        const CBlockHeader& block = it->GetHeader();
+        if (block.hashPrevBlock != hashPrevBlock)
+            break;
+
+        if (!block.pos.IsNull() && check_pos(block.pos) &&
+                nPrevHeight >= params.nMercuryActiveHeight && nPrevHeight <= params.nSaturnActiveHeight) {
+            vChallenges.emplace_back(&block.pos, CreateChallenge(generationSignature, block.pos.nScanIterations));
+        }
+
+        // Next generation signature, see CBlockIndex::Update()
+        hashPrevBlock = it->GetHash();
+        if (++nPrevHeight <= 1) {
+            generationSignature.SetNull();
+        } else {
+            uint64_t plotterId = htobe64(block.nPlotterId);
+            CShabal256()
+                .Write(generationSignature.begin(), generationSignature.size())
+                .Write((const unsigned char*)&plotterId, 8)
+                .Finalize(generationSignature.begin());
+        }
+    }
+    if (vChallenges.empty())
+        return;
+
+    // Proofs are validated on the check threads while the signatures are verified here
+    std::vector<CProofCheck> vChecks;
+    vChecks.reserve(vChallenges.size());
+    for (const auto& item : vChallenges)
+        vChecks.emplace_back(item.first, item.second, params.nMercuryPosFilterBits);
+    CCheckQueueControl<CProofCheck> control(&proofcheckqueue);
+    control.Add(vChecks);
+
+    std::vector<bls::G1Element> vPubKeys;
+    std::vector<Bytes> vMessages;
+    std::vector<bls::G2Element> vSignatures;
+    std::vector<uint256> vSignatureHashes;
+    try {
+        for (const auto& item : vChallenges) {
+            const CChiaProofOfSpace& pos = *item.first;
+            const uint256& challenge = item.second;
+            const PlotPubKey plotPubKey = GetPlotPubKey(pos);
+            const uint256 signatureHash = GetSignatureHash(plotPubKey, challenge, pos.vchSignature);
+            if (IsVerifiedSignature(signatureHash))
+                continue;
+
+            // Random non-zero weight, so invalid signatures can not cancel out in the aggregate
+            uint64_t nWeight = htobe64(GetRand(std::numeric_limits<uint64_t>::max() - 1) + 1);
+            bn_t weight;
+            bn_new(weight);
+            bn_read_bin(weight, (const uint8_t*)&nWeight, sizeof(nWeight));
+            vPubKeys.push_back(plotPubKey.key * weight);
+            vSignatures.push_back(bls::G2Element::FromByteVector(pos.vchSignature.ToVector()) * weight);
+            bn_free(weight);
+
+            // The augmented message of AugSchemeMPL, prefixed by the unweighted key
+            Bytes vchMessage(plotPubKey.vchKey);
+            vchMessage.insert(vchMessage.end(), challenge.begin(), challenge.end());
+            vMessages.push_back(std::move(vchMessage));
+            vSignatureHashes.push_back(signatureHash);
+        }
+
+        bls::AugSchemeMPL scheme;
+        if (vSignatureHashes.size() >= 2 && scheme.CoreMPL::AggregateVerify(vPubKeys, vMessages, scheme.Aggregate(vSignatures))) {
+            for (const uint256& signatureHash : vSignatureHashes)
+                AddVerifiedSignature(signatureHash);
+        }
+    } catch (...) {
+        // Bad encodings are reported by the check of the header
+    }
+
+    control.Wait();
+}
+
 VerifyResult VerifyAndUpdateBlockHeader(CBlockHeader& block, const CBlockIndex& prevBlockIndex, const Consensus::Params& params)
 {
     // 1.check params
@@ -180,7 +512,7 @@ VerifyResult VerifyAndUpdateBlockHeader(CBlockHeader& block, const CBlockIndex&
         return VerifyResult::ErrorException;
     }
 
-    block.nPlotterId = ToFarmerId(block.pos.vchFarmerPubKey);
+    block.nPlotterId = ToFarmerId(block.pos.vchFarmerPubKey.ToVector());
     block.nNonce = nIterations;
 
     return VerifyResult::Success;
@@ -0,0 +1,286 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/pos.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <fs.h>
+#include <logging.h>
+#include <poc/poc.h>
+#include <sync.h>
+#include <threadpool.h>
+#include <ui_interface.h>
+#include <util/strencodings.h>
+#include <util/system.h>
+#include <util/threadnames.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <chiapos/api.h>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <univalue.h>
+
+/**
+ * Harvester of local chiapos plot files for the PoS era. On every new tip, and on every scan iteration of it, the
+ * plot filter of all plots of the farmer is evaluated at once. Only the plots passing the filter are read, their
+ * qualities and proofs are looked up concurrently and the best proof is fed to poc::AddProofOfSpace() without an
+ * external harvester.
+ */
+
+namespace {
+
+/** Milliseconds between checks of the interrupt while waiting for a new tip or scan iteration */
+const int64_t HARVESTER_WAIT_MILLIS = 1000;
+
+struct HarvesterPlot
+{
+    const std::string strPath;
+    const pos::PlotFileHeader header;
+    const bls::PrivateKey localPrivateKey;
+
+    HarvesterPlot(const std::string& strPathIn, const pos::PlotFileHeader& headerIn) :
+        strPath(strPathIn),
+        header(headerIn),
+        localPrivateKey(pos::DeriveMasterToLocal(bls::PrivateKey::FromByteVector(headerIn.localMasterPrivateKey))) {}
+};
+
+/** Best proof of a plot for a challenge */
+struct HarvesterProof
+{
+    uint64_t nIterations = std::numeric_limits<uint64_t>::max();
+    pos::Bytes vchProof;
+};
+
+std::thread threadPoSHarvester;
+std::atomic<bool> fPoSHarvesterInterrupted(false);
+std::vector<fs::path> vPoSPlotDirs;
+std::unique_ptr<bls::PrivateKey> farmerPrivateKey;
+std::string strPoSGenerateTo;
+
+//! Plots of the farmer, only used by the harvester thread
+std::vector<std::unique_ptr<HarvesterPlot>> vPlots;
+std::vector<uint256> vPlotIds;
+std::set<std::string> setIndexedPaths;
+
+/** Index the plot files of -posplotdir not indexed yet, so that new plots are picked up on every tip */
+void IndexPlots()
+{
+    const pos::Bytes vchFarmerPubKey = farmerPrivateKey->GetG1Element().Serialize();
+    for (const fs::path& dir : vPoSPlotDirs) {
+        boost::system::error_code ec;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            const std::string strPath = it->path().string();
+            if (it->path().extension() != ".plot" || setIndexedPaths.count(strPath))
+                continue;
+            setIndexedPaths.insert(strPath);
+
+            pos::Bytes data(pos::MAX_PLOT_FILE_HEADER_SIZE);
+            FILE* file = fsbridge::fopen(it->path(), "rb");
+            if (!file)
+                continue;
+            data.resize(fread(data.data(), 1, data.size(), file));
+            fclose(file);
+            pos::PlotFileHeader header;
+            if (!pos::ParsePlotFileHeader(data, header) || header.k < pos::MIN_PLOT_SIZE || header.k > pos::MAX_PLOT_SIZE) {
+                LogPrintf("posharvester: Skip invalid plot file %s\n", strPath);
+                continue;
+            }
+            if (header.farmerPubKey != vchFarmerPubKey) {
+                LogPrint(BCLog::POC, "posharvester: Skip plot file %s of another farmer\n", strPath);
+                continue;
+            }
+            try {
+                std::unique_ptr<HarvesterPlot> plot = MakeUnique<HarvesterPlot>(strPath, header);
+                const bls::G1Element plotPubKey = pos::CreatePlotPubKey(plot->localPrivateKey.GetG1Element(),
+                    farmerPrivateKey->GetG1Element(), header.poolPubKey.size() == 32);
+                if (pos::CreatePlotId(header.poolPubKey, plotPubKey.Serialize()) != header.plotId) {
+                    LogPrintf("posharvester: Skip plot file %s, the plot id does not match its keys\n", strPath);
+                    continue;
+                }
+                vPlotIds.push_back(header.plotId);
+                vPlots.push_back(std::move(plot));
+            } catch (const std::exception& e) {
+                LogPrintf("posharvester: Skip plot file %s: %s\n", strPath, e.what());
+            }
+        }
+        if (ec)
+            LogPrintf("posharvester: Cannot list %s: %s\n", dir.string(), ec.message());
+    }
+}
+
+/** Look up the best proof of a plot passing the filter. Thread safe */
+void LookupProof(const HarvesterPlot& plot, const uint256& challenge, uint64_t nBaseTarget, HarvesterProof& proof)
+{
+    try {
+        const std::vector<uint8_t> vchChallenge(challenge.begin(), challenge.end());
+        const std::vector<pos::Bytes> vQualities = chiapos::GetQualitiesForChallenge(plot.strPath, vchChallenge);
+        uint32_t nBestIndex = 0;
+        for (uint32_t i = 0; i < vQualities.size(); i++) {
+            const uint64_t nIterations = pos::CalculateIterations(vQualities[i], challenge, plot.header.k, nBaseTarget);
+            if (nIterations < proof.nIterations) {
+                proof.nIterations = nIterations;
+                nBestIndex = i;
+            }
+        }
+        // Only the best quality is worth reading its full proof
+        if (!vQualities.empty())
+            proof.vchProof = chiapos::GetFullProof(plot.strPath, vchChallenge, nBestIndex);
+    } catch (const std::exception& e) {
+        LogPrintf("posharvester: Cannot look up plot file %s: %s\n", plot.strPath, e.what());
+        proof = HarvesterProof();
+    }
+}
+
+/** Harvest all plots for a scan iteration of the block following the tip and submit the best proof */
+void Harvest(const poc::MiningInfo& info, int32_t nScanIterations)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const int64_t nStartMicros = GetTimeMicros();
+    const uint256 challenge = pos::CreateChallenge(info.nextGenerationSignature, nScanIterations);
+
+    const std::vector<bool> vPassed = pos::PassesPlotFilters(vPlotIds, challenge, params.nMercuryPosFilterBits);
+    std::vector<size_t> vPassedPlots;
+    for (size_t i = 0; i < vPassed.size(); i++) {
+        if (vPassed[i])
+            vPassedPlots.push_back(i);
+    }
+
+    std::vector<HarvesterProof> vProofs(vPassedPlots.size());
+    // Look up the passed plots on the shared thread pool
+    GetThreadPool().RunParallel(TaskPriority::MINING, vPassedPlots.size(), [&](int n) {
+        LookupProof(*vPlots[vPassedPlots[n]], challenge, info.nBaseTarget, vProofs[n]);
+    });
+
+    size_t nBest = vProofs.size();
+    for (size_t n = 0; n < vProofs.size(); n++) {
+        if (!vProofs[n].vchProof.empty() && (nBest == vProofs.size() || vProofs[n].nIterations < vProofs[nBest].nIterations))
+            nBest = n;
+    }
+    LogPrint(BCLog::POC, "posharvester: %u of %u plots passed the filter of height %d iteration %d, %s in %.3fms\n",
+        vPassedPlots.size(), vPlots.size(), info.nTipHeight + 1, nScanIterations,
+        nBest == vProofs.size() ? "no proof" : "found proof", (GetTimeMicros() - nStartMicros) * 0.001);
+    if (nBest == vProofs.size())
+        return;
+
+    // Proof is checked outside cs_main, block index is never freed
+    const CBlockIndex* pindexMining;
+    {
+        LOCK(cs_main);
+        pindexMining = LookupBlockIndex(info.hashTip);
+    }
+    if (pindexMining == nullptr)
+        return;
+    const HarvesterPlot& plot = *vPlots[vPassedPlots[nBest]];
+    try {
+        const CChiaProofOfSpace pos = pos::SignProofOfSpace(*farmerPrivateKey, plot.header.poolPubKey, plot.localPrivateKey,
+            plot.header.k, vProofs[nBest].vchProof, challenge, nScanIterations);
+        uint64_t bestDeadline = 0;
+        const uint64_t deadline = poc::AddProofOfSpace(bestDeadline, *pindexMining, pos, strPoSGenerateTo, true, params);
+        LogPrint(BCLog::POC, "posharvester: Submitted proof of plot file %s for height %d, deadline %u\n",
+            plot.strPath, info.nTipHeight + 1, deadline);
+    } catch (const UniValue& objError) {
+        LogPrintf("posharvester: Proof of plot file %s rejected: %s\n", plot.strPath,
+            objError.isObject() ? objError["message"].getValStr() : objError.getValStr());
+    } catch (const std::exception& e) {
+        LogPrintf("posharvester: Proof of plot file %s rejected: %s\n", plot.strPath, e.what());
+    }
+}
+
+void ThreadPoSHarvester()
+{
+    util::ThreadRename("bitcoin-posharvest");
+    const Consensus::Params& params = Params().GetConsensus();
+    uint256 hashTip;
+    int32_t nNextIteration = 0;
+    int64_t nWaitMillis = HARVESTER_WAIT_MILLIS;
+    std::shared_ptr<const poc::MiningInfo> info;
+    while (!fPoSHarvesterInterrupted) {
+        info = poc::WaitForMiningInfo(info, nWaitMillis);
+        nWaitMillis = HARVESTER_WAIT_MILLIS;
+        if (fPoSHarvesterInterrupted)
+            break;
+        // Proofs of space are accepted from the Mercury fork until the Saturn fork
+        if (!info || !poc::IsMiningInfoReady(*info) || info->nTipHeight < params.nMercuryActiveHeight || info->nTipHeight > params.nSaturnActiveHeight)
+            continue;
+        if (info->hashTip != hashTip) {
+            hashTip = info->hashTip;
+            nNextIteration = 0;
+            IndexPlots();
+        }
+
+        // Same scan iterations as pos_getMiningInfo
+        const int64_t now = std::max(GetTime(), info->nTipTime);
+        const int32_t nScanIterations = (int32_t) ((now - info->nTipTime) / params.nPowTargetSpacing);
+        if (nScanIterations >= nNextIteration) {
+            nNextIteration = nScanIterations + 1;
+            Harvest(*info, nScanIterations);
+        }
+        const int64_t nNextMillis = (info->nTipTime + (int64_t) nNextIteration * params.nPowTargetSpacing - GetTime()) * 1000;
+        nWaitMillis = std::max<int64_t>(1, std::min(nNextMillis, HARVESTER_WAIT_MILLIS));
+    }
+}
+
+} // namespace
+
+bool StartPoSHarvester()
+{
+    if (!gArgs.IsArgSet("-posplotdir"))
+        return true;
+    if (!gArgs.GetBoolArg("-server", false))
+        return InitError(_("-posplotdir requires -server").translated);
+
+    const pos::Bytes vchFarmerPrivateKey = ParseHex(gArgs.GetArg("-posfarmerkey", ""));
+    if (vchFarmerPrivateKey.size() != bls::PrivateKey::PRIVATE_KEY_SIZE)
+        return InitError(_("-posplotdir requires the farmer private key of the plots in -posfarmerkey").translated);
+    try {
+        farmerPrivateKey = MakeUnique<bls::PrivateKey>(bls::PrivateKey::FromByteVector(vchFarmerPrivateKey));
+    } catch (const std::exception& e) {
+        return InitError(strprintf(_("Invalid -posfarmerkey: %s").translated, e.what()));
+    }
+    gArgs.ForceSetArg("-posfarmerkey", "");
+
+    vPoSPlotDirs.clear();
+    for (const std::string& strDir : gArgs.GetArgs("-posplotdir")) {
+        fs::path dir = fs::system_complete(strDir);
+        if (!fs::is_directory(dir))
+            return InitError(strprintf(_("Specified -posplotdir \"%s\" does not exist").translated, strDir));
+        vPoSPlotDirs.push_back(dir);
+    }
+    strPoSGenerateTo = gArgs.GetArg("-posgenerateto", "");
+
+    IndexPlots();
+    LogPrintf("Starting PoS harvester with %u plots of farmer %u\n", vPlots.size(), pos::ToFarmerId(farmerPrivateKey->GetG1Element().Serialize()));
+    fPoSHarvesterInterrupted = false;
+    threadPoSHarvester = std::thread(ThreadPoSHarvester);
+    return true;
+}
+
+void InterruptPoSHarvester()
+{
+    if (!threadPoSHarvester.joinable())
+        return;
+    LogPrintf("Interrupting PoS harvester\n");
+    fPoSHarvesterInterrupted = true;
+}
+
+void StopPoSHarvester()
+{
+    if (threadPoSHarvester.joinable())
+        threadPoSHarvester.join();
+    vPlots.clear();
+    vPlotIds.clear();
+    setIndexedPaths.clear();
+    vPoSPlotDirs.clear();
+    farmerPrivateKey.reset();
+}
@@ -40,6 +40,20 @@ static UniValue pos_getMiningInfo(const JSONRPCRequest& request)
 
     UniValue result(UniValue::VOBJ);
 
+    const std::shared_ptr<const poc::MiningInfo> info = poc::GetMiningInfo();
+    if (info && poc::IsMiningInfoReady(*info) && info->nTipHeight >= Params().GetConsensus().nMercuryActiveHeight) {
+        const int64_t epoch = info->nTipTime;
+        const int64_t now = std::max(GetTime(), epoch);
+        result.pushKV("height", info->nTipHeight + 1);
+        result.pushKV("challenge", HexStr(info->nextGenerationSignature));
+        result.pushKV("difficulty", poc::INITIAL_BASE_TARGET / info->nBaseTarget);
+        result.pushKV("scan_iterations", (uint64_t) ((now - epoch) / Params().GetConsensus().nPowTargetSpacing));
+        result.pushKV("filter_bits", (uint64_t) Params().GetConsensus().nMercuryPosFilterBits);
+        result.pushKV("epoch", (uint64_t) epoch);
+        result.pushKV("now", (uint64_t) now);
+        return result;
+    }
+
     LOCK(cs_main);
     const CBlockIndex *pindexMining = ChainActive().Tip();
     if (pindexMining == nullptr || pindexMining->nHeight < 1)
@@ -104,37 +118,9 @@ static UniValue pos_submitProof(const JSONRPCRequest& request)
         }
 
         uint256 challenge = pos::CreateChallenge(rawChallenge, nScanIterations);
-        auto vchChallenge = std::vector<uint8_t>(challenge.begin(), challenge.end());
-
         auto farmerPrivateKey = bls::PrivateKey::FromByteVector(farmerPrivateKeyBytes);
-        auto farmerPublicKey = farmerPrivateKey.GetG1Element();
         auto localPrivateKey = pos::DeriveMasterToLocal(bls::PrivateKey::FromByteVector(localMasterPrivateKeyBytes));
-        auto localPublicKey = localPrivateKey.GetG1Element();
-
-        // agg
-        if (poolPublicKeyBytes.size() == 32) {
-            // OP (with taproot)
-            auto taprootPrivateKey = pos::CreateTaprootPrivateKey(localPublicKey, farmerPublicKey);
-            auto taprootPulicKey = taprootPrivateKey.GetG1Element();
-            auto plotPublicKey = pos::CreatePlotPubKey(localPublicKey, farmerPublicKey, taprootPulicKey);
-            auto farmerSignature = bls::AugSchemeMPL().Sign(farmerPrivateKey, vchChallenge, plotPublicKey);
-            auto localSignature = bls::AugSchemeMPL().Sign(localPrivateKey, vchChallenge, plotPublicKey);
-            auto taprootSignature = bls::AugSchemeMPL().Sign(taprootPrivateKey, vchChallenge, plotPublicKey);
-            pos.vchSignature = bls::AugSchemeMPL().Aggregate({taprootSignature, localSignature, farmerSignature}).Serialize();
-        } else {
-            // OG
-            auto plotPublicKey = pos::CreatePlotPubKey(localPublicKey, farmerPublicKey);
-            auto farmerSignature = bls::AugSchemeMPL().Sign(farmerPrivateKey, vchChallenge, plotPublicKey);
-            auto localSignature = bls::AugSchemeMPL().Sign(localPrivateKey, vchChallenge, plotPublicKey);
-            pos.vchSignature = bls::AugSchemeMPL().Aggregate({localSignature, farmerSignature}).Serialize();
-        }
-
-        pos.nScanIterations = nScanIterations;
-        pos.vchFarmerPubKey = farmerPublicKey.Serialize();
-        pos.vchPoolPubKey = poolPublicKeyBytes;
-        pos.vchLocalPubKey = localPublicKey.Serialize();
-        pos.nPlotK = nPlotK;
-        pos.vchProof = proofBytes;
+        pos = pos::SignProofOfSpace(farmerPrivateKey, poolPublicKeyBytes, localPrivateKey, nPlotK, proofBytes, challenge, nScanIterations);
     }
 
     int nTargetHeight = 0;
@@ -156,19 +142,23 @@ static UniValue pos_submitProof(const JSONRPCRequest& request)
     }
 
 
-    LOCK(cs_main);
-    const CBlockIndex *pindexMining = ChainActive()[nTargetHeight < 1 ? ChainActive().Height() : (nTargetHeight - 1)];
-    if (pindexMining == nullptr || pindexMining->nHeight < 1)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block chain tip is empty!");
+    // Proof is checked outside cs_main, block index is never freed
+    const CBlockIndex *pindexMining;
+    {
+        LOCK(cs_main);
+        pindexMining = ChainActive()[nTargetHeight < 1 ? ChainActive().Height() : (nTargetHeight - 1)];
+        if (pindexMining == nullptr || pindexMining->nHeight < 1)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block chain tip is empty!");
 
-    if (pindexMining->nHeight != 1 && ChainstateActive().IsInitialBlockDownload())
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Is initial block downloading!");
+        if (pindexMining->nHeight != 1 && ChainstateActive().IsInitialBlockDownload())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Is initial block downloading!");
 
-    if (pindexMining->nHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime())
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Waiting for begining!");
+        if (pindexMining->nHeight == 1 && Params().GetConsensus().nBeginMiningTime > GetTime())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Waiting for begining!");
 
-    if (pindexMining->nHeight < Params().GetConsensus().nMercuryActiveHeight)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Waiting for begining!");
+        if (pindexMining->nHeight < Params().GetConsensus().nMercuryActiveHeight)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Waiting for begining!");
+    }
 
     UniValue result(UniValue::VOBJ);
     uint64_t bestDeadline = 0;
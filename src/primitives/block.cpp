@@ -6,6 +6,7 @@
 #include <primitives/block.h>
 
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <crypto/common.h>
 
@@ -21,6 +22,24 @@ uint256 CBlockHeader::GetUnsignaturedHash() const
     return SerializeHash(*this, SER_GETHASH | SER_UNSIGNATURED);
 }
 
+std::vector<CHashedBlockHeader> HashBlockHeaders(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    ends.reserve(headers.size());
+    for (const CBlockHeader& header : headers) {
+        CVectorWriter(SER_GETHASH, PROTOCOL_VERSION, data, data.size()) << header;
+        ends.push_back(data.size());
+    }
+    const std::vector<uint256> hashes = HashRanges(data, ends);
+
+    std::vector<CHashedBlockHeader> hashedHeaders;
+    hashedHeaders.reserve(headers.size());
+    for (size_t i = 0; i < headers.size(); i++)
+        hashedHeaders.emplace_back(headers[i], hashes[i]);
+    return hashedHeaders;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -11,18 +11,39 @@
 #include <serialize.h>
 #include <uint256.h>
 
+/** Byte fields of the header extensions, held inline up to their maximum size so that decoding
+ *  a header does not allocate. Larger (invalid) values still decode, on the heap. */
+template <unsigned int N>
+class HeaderBytes : public prevector<N, unsigned char>
+{
+public:
+    HeaderBytes() {}
+    HeaderBytes(const std::vector<unsigned char>& vch) : prevector<N, unsigned char>(vch.begin(), vch.end()) {}
+
+    //! For the APIs taking byte vectors, such as the keys and signatures of the BLS library
+    std::vector<unsigned char> ToVector() const { return std::vector<unsigned char>(this->begin(), this->end()); }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const { ::Serialize(s, static_cast<const prevector<N, unsigned char>&>(*this)); }
+
+    template <typename Stream>
+    void Unserialize(Stream& s) { ::Unserialize(s, static_cast<prevector<N, unsigned char>&>(*this)); }
+};
+typedef HeaderBytes<CPubKey::COMPRESSED_PUBLIC_KEY_SIZE> BlockPubKeyBytes;
+typedef HeaderBytes<CPubKey::SIGNATURE_SIZE> BlockSignatureBytes;
+
 /** For Chia PoS.
  */
 class CChiaProofOfSpace
 {
 public:
-    std::vector<unsigned char> vchFarmerPubKey; // fpk[48]
-    std::vector<unsigned char> vchPoolPubKey;  // ppk[48]/pph[32]
-    std::vector<unsigned char> vchLocalPubKey; // local_pk[48]
-    std::vector<unsigned char> vchProof;
+    HeaderBytes<48> vchFarmerPubKey; // fpk[48]
+    HeaderBytes<48> vchPoolPubKey;  // ppk[48]/pph[32]
+    HeaderBytes<48> vchLocalPubKey; // local_pk[48]
+    HeaderBytes<400> vchProof;      // 8 * k bytes, for k up to pos::MAX_PLOT_SIZE
     int32_t nPlotK;
 
-    std::vector<unsigned char> vchSignature; // fk.sign(make(genSign,iterations), plot_pk)[96]
+    HeaderBytes<96> vchSignature; // fk.sign(make(genSign,iterations), plot_pk)[96]
     int32_t nScanIterations;
 
     CChiaProofOfSpace()
@@ -102,8 +123,8 @@ public:
     CChiaProofOfSpace pos;
 
     // block signature by generator
-    std::vector<unsigned char> vchPubKey;
-    std::vector<unsigned char> vchSignature;
+    BlockPubKeyBytes vchPubKey;
+    BlockSignatureBytes vchSignature;
 
     CBlockHeader()
     {
@@ -174,6 +195,38 @@ public:
     }
 };
 
+/**
+ * A block header with its hashes, each one computed at most once, shared by the checks along the header
+ * processing path. The header must outlive it. Not thread safe
+ */
+class CHashedBlockHeader
+{
+private:
+    const CBlockHeader* pheader;
+    uint256 hash;
+    mutable uint256 unsignaturedHash;
+    mutable bool fUnsignaturedHash;
+
+public:
+    explicit CHashedBlockHeader(const CBlockHeader& header) : pheader(&header), hash(header.GetHash()), fUnsignaturedHash(false) {}
+    CHashedBlockHeader(const CBlockHeader& header, const uint256& hashIn) : pheader(&header), hash(hashIn), fUnsignaturedHash(false) {}
+
+    const CBlockHeader& GetHeader() const { return *pheader; }
+    const uint256& GetHash() const { return hash; }
+
+    const uint256& GetUnsignaturedHash() const
+    {
+        if (!fUnsignaturedHash) {
+            unsignaturedHash = pheader->GetUnsignaturedHash();
+            fUnsignaturedHash = true;
+        }
+        return unsignaturedHash;
+    }
+};
+
+/** Hash a batch of headers, such as those of a headers message, together. The headers must outlive the result. */
+std::vector<CHashedBlockHeader> HashBlockHeaders(const std::vector<CBlockHeader>& headers);
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -194,12 +247,19 @@ public:
         *(static_cast<CBlockHeader*>(this)) = header;
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        s << static_cast<const CBlockHeader&>(*this);
+        s << vtx;
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITEAS(CBlockHeader, *this);
-        READWRITE(vtx);
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        s >> static_cast<CBlockHeader&>(*this);
+        // Hash all transactions together rather than each in its deserializing constructor
+        std::vector<CMutableTransaction> vmtx;
+        s >> vmtx;
+        vtx = MakeTransactionRefs(std::move(vmtx));
     }
 
     void SetNull()
@@ -6,6 +6,7 @@
 #include <primitives/transaction.h>
 
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
@@ -86,6 +87,38 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& hashIn, const uint256& witnessHashIn) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hashIn}, m_witness_hash{witnessHashIn} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& vmtx)
+{
+    // The serializations without witness of all transactions, then those with witness where they have one
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    std::vector<size_t> witnessIndexes;
+    ends.reserve(vmtx.size());
+    for (const CMutableTransaction& mtx : vmtx) {
+        CVectorWriter(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, data.size()) << mtx;
+        ends.push_back(data.size());
+    }
+    for (size_t i = 0; i < vmtx.size(); i++) {
+        if (vmtx[i].HasWitness()) {
+            CVectorWriter(SER_GETHASH, 0, data, data.size()) << vmtx[i];
+            ends.push_back(data.size());
+            witnessIndexes.push_back(i);
+        }
+    }
+    const std::vector<uint256> hashes = HashRanges(data, ends);
+
+    std::vector<uint256> witnessHashes(hashes.begin(), hashes.begin() + vmtx.size());
+    for (size_t j = 0; j < witnessIndexes.size(); j++)
+        witnessHashes[witnessIndexes[j]] = hashes[vmtx.size() + j];
+
+    std::vector<CTransactionRef> vtx;
+    vtx.reserve(vmtx.size());
+    for (size_t i = 0; i < vmtx.size(); i++)
+        vtx.push_back(std::make_shared<const CTransaction>(std::move(vmtx[i]), hashes[i], witnessHashes[i]));
+    return vtx;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -314,6 +314,9 @@ public:
     explicit CTransaction(const CMutableTransaction &tx);
     CTransaction(CMutableTransaction &&tx);
 
+    /** Convert a CMutableTransaction whose hashes were already computed, see MakeTransactionRefs. */
+    CTransaction(CMutableTransaction &&tx, const uint256& hashIn, const uint256& witnessHashIn);
+
     template <typename Stream>
     inline void Serialize(Stream& s) const {
         SerializeTransaction(*this, s);
@@ -418,6 +421,9 @@ typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert many transactions at once, such as those of a block, hashing their serializations together. */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& vmtx);
+
 /** Account ID (CScriptID). */
 typedef uint160 CAccountID;
 
@@ -41,6 +41,12 @@ const char *SENDCMPCT="sendcmpct";
 const char *CMPCTBLOCK="cmpctblock";
 const char *GETBLOCKTXN="getblocktxn";
 const char *BLOCKTXN="blocktxn";
+const char *SENDCHEADERS="sendcheaders";
+const char *CHEADERS="cheaders";
+const char *SENDRECON="sendrecon";
+const char *REQRECON="reqrecon";
+const char *SKETCH="sketch";
+const char *RECONCILDIFF="reconcildiff";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -73,6 +79,12 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::CMPCTBLOCK,
     NetMsgType::GETBLOCKTXN,
     NetMsgType::BLOCKTXN,
+    NetMsgType::SENDCHEADERS,
+    NetMsgType::CHEADERS,
+    NetMsgType::SENDRECON,
+    NetMsgType::REQRECON,
+    NetMsgType::SKETCH,
+    NetMsgType::RECONCILDIFF,
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes+ARRAYLEN(allNetMessageTypes));
 
@@ -238,6 +238,42 @@ extern const char *GETBLOCKTXN;
  * @since protocol version 70014 as described by BIP 152
  */
 extern const char *BLOCKTXN;
+/**
+ * Indicates that a node prefers to receive headers as "cheaders" messages
+ * rather than "headers" messages.
+ * @since protocol version 80022.
+ */
+extern const char *SENDCHEADERS;
+/**
+ * Contains the headers of a "headers" message without the hashes of the
+ * previous blocks and with the repeated keys of the generators coded.
+ * @since protocol version 80022.
+ */
+extern const char *CHEADERS;
+/**
+ * Offers the set reconciliation of transaction announcements, with the
+ * protocol version and a salt for the short transaction ids.
+ * @since protocol version 80023.
+ */
+extern const char *SENDRECON;
+/**
+ * Asks an inbound reconciling peer for the sketch of the transactions it
+ * would announce to us, with the size of our own set.
+ * @since protocol version 80023.
+ */
+extern const char *REQRECON;
+/**
+ * Contains the sketch of the reconciliation set, answering a "reqrecon".
+ * An empty sketch means the set is announced by inv instead.
+ * @since protocol version 80023.
+ */
+extern const char *SKETCH;
+/**
+ * Tells whether the sketch could be decoded, and the short ids of the
+ * transactions in the sketch only, to be announced by inv.
+ * @since protocol version 80023.
+ */
+extern const char *RECONCILDIFF;
 };
 
 /* Get a vector of all valid message types (see above) */
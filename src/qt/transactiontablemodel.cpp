@@ -18,12 +18,20 @@
 #include <uint256.h>
 
 #include <algorithm>
+#include <tuple>
+#include <vector>
 
 #include <QColor>
 #include <QDateTime>
 #include <QDebug>
 #include <QIcon>
 #include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+//! Number of wallet transactions decomposed by the loading thread at once
+static const size_t LOAD_BATCH_SIZE = 1000;
 
 
 // Amount column is right-aligned it contains numbers
@@ -58,7 +66,9 @@ class TransactionTablePriv
 {
 public:
     explicit TransactionTablePriv(TransactionTableModel *_parent) :
-        parent(_parent)
+        parent(_parent),
+        fLoading(true),
+        fLoadedAll(false)
     {
     }
 
@@ -70,18 +80,82 @@ public:
      */
     QList<TransactionRecord> cachedWallet;
 
-    /* Query entire wallet anew from core.
+    /* Whether the wallet is still being loaded into the cache. Only used by the GUI thread.
+     */
+    bool fLoading;
+    /* Changes notified while loading, applied when done.
+     */
+    std::vector<std::tuple<uint256, int, bool> > queuedUpdates;
+
+    /* Records decomposed by the loading thread, not yet in the cache.
      */
-    void refreshWallet(interfaces::Wallet& wallet)
+    QMutex loadedMutex;
+    QList<TransactionRecord> loadedRecords;
+    bool fLoadedAll;
+
+    /* Query entire wallet anew from core, in batches.
+     *
+     * Runs in the loading thread. The wallet is walked in hash order, so each batch of
+     * records is appended to the cache by appendLoaded() in the GUI thread.
+     */
+    void loadWallet(interfaces::Wallet& wallet, const std::atomic<bool>& abort)
     {
-        qDebug() << "TransactionTablePriv::refreshWallet";
-        cachedWallet.clear();
-        {
-            for (const auto& wtx : wallet.getWalletTxs()) {
+        qDebug() << "TransactionTablePriv::loadWallet";
+        uint256 last;
+        while (!abort) {
+            std::vector<interfaces::WalletTx> wtxs = wallet.getWalletTxsAfter(last, LOAD_BATCH_SIZE);
+            QList<TransactionRecord> records;
+            for (const auto& wtx : wtxs) {
                 if (TransactionRecord::showTransaction()) {
-                    cachedWallet.append(TransactionRecord::decomposeTransaction(wtx));
+                    records.append(TransactionRecord::decomposeTransaction(wtx));
                 }
             }
+            if (!wtxs.empty()) {
+                last = wtxs.back().tx->GetHash();
+            }
+            bool fDone = wtxs.size() < LOAD_BATCH_SIZE;
+
+            bool fNotify;
+            {
+                QMutexLocker locker(&loadedMutex);
+                // a pending notification picks up these records too
+                fNotify = loadedRecords.isEmpty() && !fLoadedAll;
+                loadedRecords.append(records);
+                fLoadedAll = fDone;
+            }
+            if (fNotify) {
+                QMetaObject::invokeMethod(parent, "appendLoadedTransactions", Qt::QueuedConnection);
+            }
+            if (fDone) break;
+        }
+    }
+
+    /* Move the records of the loading thread to the cache.
+     */
+    void appendLoaded(interfaces::Wallet& wallet)
+    {
+        QList<TransactionRecord> records;
+        bool fDone;
+        {
+            QMutexLocker locker(&loadedMutex);
+            records.swap(loadedRecords);
+            fDone = fLoadedAll;
+        }
+
+        if (!records.isEmpty()) {
+            parent->beginInsertRows(QModelIndex(), cachedWallet.size(), cachedWallet.size() + records.size() - 1);
+            cachedWallet.append(records);
+            parent->endInsertRows();
+        }
+
+        if (fDone && fLoading) {
+            qDebug() << "TransactionTablePriv::appendLoaded: loaded " + QString::number(cachedWallet.size()) + " records";
+            fLoading = false;
+            std::vector<std::tuple<uint256, int, bool> > updates;
+            updates.swap(queuedUpdates);
+            for (const auto& update : updates) {
+                updateWallet(wallet, std::get<0>(update), std::get<1>(update), std::get<2>(update));
+            }
         }
     }
 
@@ -94,6 +168,12 @@ public:
     {
         qDebug() << "TransactionTablePriv::updateWallet: " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
+        if (fLoading) {
+            // the loading thread may or may not have passed this transaction yet
+            queuedUpdates.emplace_back(hash, status, showTransaction);
+            return;
+        }
+
         // Find bounds of this transaction in model
         QList<TransactionRecord>::iterator lower = std::lower_bound(
             cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
@@ -220,22 +300,39 @@ TransactionTableModel::TransactionTableModel(const PlatformStyle *_platformStyle
         walletModel(parent),
         priv(new TransactionTablePriv(this)),
         fProcessingQueuedTransactions(false),
-        platformStyle(_platformStyle)
+        platformStyle(_platformStyle),
+        m_loader_thread(new QThread(this)),
+        m_loader_abort(false)
 {
     columns << QString() << QString() << tr("Date") << tr("Type") << tr("Label") << BitcoinUnits::getAmountColumnTitle(walletModel->getOptionsModel()->getDisplayUnit());
-    priv->refreshWallet(walletModel->wallet());
 
     connect(walletModel->getOptionsModel(), &OptionsModel::displayUnitChanged, this, &TransactionTableModel::updateDisplayUnit);
 
     subscribeToCoreSignals();
+
+    // load the transactions in the background, so that large wallets do not block the GUI
+    QObject* loader = new QObject;
+    connect(m_loader_thread, &QThread::finished, loader, &QObject::deleteLater);
+    connect(m_loader_thread, &QThread::started, loader, [this] { priv->loadWallet(walletModel->wallet(), m_loader_abort); });
+    loader->moveToThread(m_loader_thread);
+    m_loader_thread->start();
 }
 
 TransactionTableModel::~TransactionTableModel()
 {
     unsubscribeFromCoreSignals();
+
+    m_loader_abort = true;
+    m_loader_thread->quit();
+    m_loader_thread->wait();
     delete priv;
 }
 
+void TransactionTableModel::appendLoadedTransactions()
+{
+    priv->appendLoaded(walletModel->wallet());
+}
+
 /** Updates the column title to "Amount (DisplayUnit)" and emits headerDataChanged() signal for table headers to react. */
 void TransactionTableModel::updateAmountColumnTitle()
 {
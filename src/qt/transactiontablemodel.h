@@ -10,6 +10,7 @@
 #include <QAbstractTableModel>
 #include <QStringList>
 
+#include <atomic>
 #include <memory>
 
 namespace interfaces {
@@ -17,6 +18,7 @@ class Handler;
 }
 
 class PlatformStyle;
+class QThread;
 class TransactionRecord;
 class TransactionTablePriv;
 class WalletModel;
@@ -91,6 +93,8 @@ private:
     TransactionTablePriv *priv;
     bool fProcessingQueuedTransactions;
     const PlatformStyle *platformStyle;
+    QThread* const m_loader_thread;
+    std::atomic<bool> m_loader_abort;
 
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
@@ -116,6 +120,8 @@ public Q_SLOTS:
     void updateAmountColumnTitle();
     /* Needed to update fProcessingQueuedTransactions through a QueuedConnection */
     void setProcessingQueuedTransactions(bool value) { fProcessingQueuedTransactions = value; }
+    /* Append the transactions decomposed by the loading thread */
+    void appendLoadedTransactions();
 
     friend class TransactionTablePriv;
 };
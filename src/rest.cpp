@@ -6,18 +6,23 @@
 #include <attributes.h>
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/validation.h>
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <key_io.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
+#include <script/standard.h>
 #include <streams.h>
 #include <sync.h>
+#include <txdb.h>
 #include <txmempool.h>
 #include <util/strencodings.h>
+#include <util/validation.h>
 #include <validation.h>
 #include <version.h>
 
@@ -26,6 +31,7 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_REST_PLEDGE_COINS = 1000; //allow a max of 1000 pledge coins to be returned at once
 
 enum class RetFormat {
     UNDEF,
@@ -63,6 +69,59 @@ struct CCoin {
     }
 };
 
+/** Bind plotter coin of an account, as returned by /rest/bindplotters */
+struct CRestBindPlotter {
+    COutPoint outpoint;
+    uint32_t nHeight;
+    uint64_t plotterId;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestBindPlotter() : nHeight(0), plotterId(0) {}
+    CRestBindPlotter(const COutPoint& outpointIn, const CBindPlotterCoinInfo& info) : outpoint(outpointIn), nHeight((uint32_t)info.nHeight), plotterId(info.plotterId) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(outpoint);
+        READWRITE(nHeight);
+        READWRITE(plotterId);
+    }
+};
+
+/** Point coin of an account, as returned by /rest/pledge */
+struct CRestPledge {
+    COutPoint outpoint;
+    uint32_t nHeight;
+    CAccountID senderID;
+    CAccountID receiverID;
+    CAmount nLockAmount;
+    CAmount nAmount;
+    uint32_t nLockBlocks;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestPledge() : nHeight(0), nLockAmount(0), nAmount(0), nLockBlocks(0) {}
+    CRestPledge(const COutPoint& outpointIn, const Coin& coin) : outpoint(outpointIn), nHeight(coin.nHeight),
+        senderID(coin.GetAccountID()),
+        receiverID(PointPayload::As(coin.GetPayload())->GetReceiverID()),
+        nLockAmount(coin.out.nValue),
+        nAmount(PointPayload::As(coin.GetPayload())->GetAmount()),
+        nLockBlocks(PointPayload::As(coin.GetPayload())->GetLockBlocks()) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(outpoint);
+        READWRITE(nHeight);
+        READWRITE(senderID);
+        READWRITE(receiverID);
+        READWRITE(nLockAmount);
+        READWRITE(nAmount);
+        READWRITE(nLockBlocks);
+    }
+};
+
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string message)
 {
     req->WriteHeader("Content-Type", "text/plain");
@@ -243,10 +302,9 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RetFormat::JSON: {
-        UniValue objBlock = blockToJSON(block, tip, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
+        blockToJSONStream(block, tip, pblockindex, showTxDetails, [req](const std::string& chunk) { req->WriteReplyBody(chunk); });
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        req->WriteReply(HTTP_OK, "\n");
         return true;
     }
 
@@ -351,8 +409,22 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
         g_txindex->BlockUntilSyncedToCurrentChain();
     }
 
-    CTransactionRef tx;
+    // Confirmed transactions with their witness are returned as read, without deserializing them
+    std::vector<unsigned char> raw_tx;
     uint256 hashBlock = uint256();
+    if ((rf == RetFormat::BINARY || rf == RetFormat::HEX) && g_txindex && RPCSerializationFlags() == 0 && !mempool.exists(hash) &&
+        g_txindex->FindRawTx(hash, hashBlock, raw_tx)) {
+        if (rf == RetFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, std::string(raw_tx.begin(), raw_tx.end()));
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(raw_tx.begin(), raw_tx.end()) + "\n");
+        }
+        return true;
+    }
+
+    CTransactionRef tx;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock))
         return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
@@ -622,6 +694,240 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+static bool ParseAccountID(HTTPRequest* req, const std::string& address, CAccountID& accountID)
+{
+    accountID = ExtractAccountID(DecodeDestination(address));
+    if (accountID.IsNull())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + SanitizeString(address));
+    return true;
+}
+
+/** Reply with a serialized response in the binary or hex format */
+static bool RESTReplyStream(HTTPRequest* req, RetFormat rf, const CDataStream& ss)
+{
+    if (rf == RetFormat::BINARY) {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+    } else {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(ss.begin(), ss.end()) + "\n");
+    }
+    return true;
+}
+
+static bool rest_account(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string address;
+    const RetFormat rf = ParseDataFormat(address, strURIPart);
+    if (rf == RetFormat::UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    CAccountID accountID;
+    if (!ParseAccountID(req, address, accountID))
+        return false;
+
+    int nHeight;
+    uint256 hashTip;
+    CAmount balance, balanceBindPlotter = 0, balancePoint[2] = {0, 0}, balanceStaking[2] = {0, 0};
+    {
+        LOCK(cs_main);
+        balance = ::ChainstateActive().CoinsTip().GetAccountBalance(accountID, &balanceBindPlotter, balancePoint, balanceStaking);
+        nHeight = ::ChainActive().Height();
+        hashTip = ::ChainActive().Tip()->GetBlockHash();
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        CDataStream ssAccount(SER_NETWORK, PROTOCOL_VERSION);
+        ssAccount << nHeight << hashTip << balance << balanceBindPlotter << balancePoint[0] << balancePoint[1] << balanceStaking[0] << balanceStaking[1];
+        return RESTReplyStream(req, rf, ssAccount);
+    }
+    case RetFormat::JSON: {
+        // Same balances as getpledgeofaddress
+        UniValue objAccount(UniValue::VOBJ);
+        objAccount.pushKV("chainHeight", nHeight);
+        objAccount.pushKV("chaintipHash", hashTip.GetHex());
+        objAccount.pushKV("balance", ValueFromAmount(balance));
+        objAccount.pushKV("spendableBalance", ValueFromAmount(balance - balanceBindPlotter - balancePoint[0] - balanceStaking[0]));
+        objAccount.pushKV("lockedBalance", ValueFromAmount(balanceBindPlotter + balancePoint[0] + balanceStaking[0]));
+        objAccount.pushKV("bindPlotterBalance", ValueFromAmount(balanceBindPlotter));
+        objAccount.pushKV("pointSentBalance", ValueFromAmount(balancePoint[0]));
+        objAccount.pushKV("pointReceivedBalance", ValueFromAmount(balancePoint[1]));
+        objAccount.pushKV("stakingSentBalance", ValueFromAmount(balanceStaking[0]));
+        objAccount.pushKV("stakingReceivedBalance", ValueFromAmount(balanceStaking[1]));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, objAccount.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_bindplotters(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string address;
+    const RetFormat rf = ParseDataFormat(address, strURIPart);
+    if (rf == RetFormat::UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    CAccountID accountID;
+    if (!ParseAccountID(req, address, accountID))
+        return false;
+
+    int nHeight;
+    uint256 hashTip;
+    std::vector<CRestBindPlotter> plotters;
+    {
+        LOCK(cs_main);
+        for (const auto& pair : ::ChainstateActive().CoinsTip().GetAccountBindPlotterEntries(accountID))
+            plotters.emplace_back(pair.first, pair.second);
+        nHeight = ::ChainActive().Height();
+        hashTip = ::ChainActive().Tip()->GetBlockHash();
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        CDataStream ssPlotters(SER_NETWORK, PROTOCOL_VERSION);
+        ssPlotters << nHeight << hashTip << plotters;
+        return RESTReplyStream(req, rf, ssPlotters);
+    }
+    case RetFormat::JSON: {
+        UniValue objPlotters(UniValue::VOBJ);
+        objPlotters.pushKV("chainHeight", nHeight);
+        objPlotters.pushKV("chaintipHash", hashTip.GetHex());
+        UniValue arrPlotters(UniValue::VARR);
+        for (const CRestBindPlotter& plotter : plotters) {
+            UniValue item(UniValue::VOBJ);
+            item.pushKV("plotterId", std::to_string(plotter.plotterId));
+            item.pushKV("txid", plotter.outpoint.hash.GetHex());
+            item.pushKV("vout", (int)plotter.outpoint.n);
+            item.pushKV("blockheight", (int)plotter.nHeight);
+            arrPlotters.push_back(item);
+        }
+        objPlotters.pushKV("plotters", arrPlotters);
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, objPlotters.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+/** List the point coins sent (loan) or received (debit) by an address, a page of them from an optional start outpoint */
+static bool rest_pledge(HTTPRequest* req, const std::string& strURIPart, bool fReceive)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    if (rf == RetFormat::UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    // <address>[/<txid>-<n>], where the outpoint is the "next" value of the previous page
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+    if (path.empty() || path.size() > 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/pledge/<loan|debit>/<address>[/<txid>-<n>].<ext>");
+
+    CAccountID accountID;
+    if (!ParseAccountID(req, path[0], accountID))
+        return false;
+
+    CAccountCoinsFilter filter;
+    if (path.size() == 2) {
+        const size_t pos = path[1].find('-');
+        uint32_t n;
+        if (pos != 64 || !IsHex(path[1].substr(0, pos)) || !ParseUInt32(path[1].substr(pos + 1), &n))
+            return RESTERR(req, HTTP_BAD_REQUEST, "Parse error");
+        filter.start = COutPoint(uint256S(path[1].substr(0, pos)), n);
+    }
+
+    int nHeight;
+    uint256 hashTip;
+    std::vector<CRestPledge> pledges;
+    COutPoint next;
+    {
+        LOCK(cs_main);
+
+        // The account cursors only read the coin database
+        CValidationState state;
+        if (!::ChainstateActive().FlushStateToDisk(Params(), state, FlushStateMode::ALWAYS))
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to flush state to disk: " + FormatStateMessage(state));
+        const CCoinsViewDB& coinsdb = ::ChainstateActive().CoinsDB();
+        CCoinsViewCursorRef pcursor = fReceive ? coinsdb.PointReceiveCursor(accountID, filter) : coinsdb.PointSendCursor(accountID, filter);
+        assert(pcursor != nullptr);
+        for (; pcursor->Valid() && pledges.size() < MAX_REST_PLEDGE_COINS; pcursor->Next()) {
+            COutPoint key;
+            Coin coin;
+            if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+                return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Unable to read UTXO set");
+            assert(coin.IsPoint());
+            pledges.emplace_back(key, coin);
+        }
+        if (!(pcursor->Valid() && pcursor->GetKey(next)))
+            next.SetNull();
+        nHeight = ::ChainActive().Height();
+        hashTip = ::ChainActive().Tip()->GetBlockHash();
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        // A null next outpoint ends the list
+        CDataStream ssPledges(SER_NETWORK, PROTOCOL_VERSION);
+        ssPledges << nHeight << hashTip << pledges << next;
+        return RESTReplyStream(req, rf, ssPledges);
+    }
+    case RetFormat::JSON: {
+        UniValue objPledges(UniValue::VOBJ);
+        objPledges.pushKV("chainHeight", nHeight);
+        objPledges.pushKV("chaintipHash", hashTip.GetHex());
+        UniValue arrPledges(UniValue::VARR);
+        for (const CRestPledge& pledge : pledges) {
+            UniValue item(UniValue::VOBJ);
+            item.pushKV("from", EncodeDestination(ScriptHash(pledge.senderID)));
+            item.pushKV("to", EncodeDestination(ScriptHash(pledge.receiverID)));
+            item.pushKV("lock_amount", ValueFromAmount(pledge.nLockAmount));
+            item.pushKV("effective_amount", ValueFromAmount(pledge.nAmount));
+            item.pushKV("lock_blocks", (int)pledge.nLockBlocks);
+            item.pushKV("txid", pledge.outpoint.hash.GetHex());
+            item.pushKV("vout", (int)pledge.outpoint.n);
+            item.pushKV("blockheight", (int)pledge.nHeight);
+            arrPledges.push_back(item);
+        }
+        objPledges.pushKV("coins", arrPledges);
+        if (!next.IsNull())
+            objPledges.pushKV("next", strprintf("%s-%u", next.hash.GetHex(), next.n));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, objPledges.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_pledge_loan(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_pledge(req, strURIPart, false);
+}
+
+static bool rest_pledge_debit(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_pledge(req, strURIPart, true);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -635,6 +941,10 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/account/", rest_account},
+      {"/rest/bindplotters/", rest_bindplotters},
+      {"/rest/pledge/loan/", rest_pledge_loan},
+      {"/rest/pledge/debit/", rest_pledge_debit},
 };
 
 void StartREST()
@@ -11,10 +11,13 @@
 #include <chainparams.h>
 #include <coins.h>
 #include <node/coinstats.h>
+#include <node/utxo_snapshot.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <dbcompaction.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <index/txindex.h>
 #include <key_io.h>
 #include <poc/poc.h>
 #include <policy/feerate.h>
@@ -98,19 +101,20 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     result.pushKV("baseTarget", (uint64_t)blockindex->nBaseTarget);
     result.pushKV("plotterId", (uint64_t)blockindex->nPlotterId);
     result.pushKV("nonce", (uint64_t)blockindex->nNonce);
-    if (!blockindex->pos.IsNull()) {
+    const CChiaProofOfSpace blockPos = blockindex->GetPos();
+    if (!blockPos.IsNull()) {
         UniValue pos(UniValue::VOBJ);
 
-        pos.pushKV("farmer_pubkey", HexStr(blockindex->pos.vchFarmerPubKey));
-        if (blockindex->pos.vchPoolPubKey.size() == 32) {
-            pos.pushKV("pool_puzzle_hash", HexStr(blockindex->pos.vchPoolPubKey));
+        pos.pushKV("farmer_pubkey", HexStr(blockPos.vchFarmerPubKey));
+        if (blockPos.vchPoolPubKey.size() == 32) {
+            pos.pushKV("pool_puzzle_hash", HexStr(blockPos.vchPoolPubKey));
         } else {
-            pos.pushKV("pool_pubkey", HexStr(blockindex->pos.vchPoolPubKey));
+            pos.pushKV("pool_pubkey", HexStr(blockPos.vchPoolPubKey));
         }
-        pos.pushKV("proof", HexStr(blockindex->pos.vchProof));
-        pos.pushKV("k", (uint64_t)blockindex->pos.nPlotK);
-        pos.pushKV("signature", HexStr(blockindex->pos.vchSignature));
-        pos.pushKV("scan_iterations", (uint64_t)blockindex->pos.nScanIterations);
+        pos.pushKV("proof", HexStr(blockPos.vchProof));
+        pos.pushKV("k", (uint64_t)blockPos.nPlotK);
+        pos.pushKV("signature", HexStr(blockPos.vchSignature));
+        pos.pushKV("scan_iterations", (uint64_t)blockPos.nScanIterations);
 
         result.pushKV("pos", pos);
     }
@@ -123,8 +127,8 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     }
     result.pushKV("generator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.scriptPubKey)));
     if (blockindex->nHeight > 1) {
-        result.pushKV("pubkey", HexStr(blockindex->vchPubKey));
-        result.pushKV("signature", HexStr(blockindex->vchSignature));
+        result.pushKV("pubkey", HexStr(blockindex->GetPubKey()));
+        result.pushKV("signature", HexStr(blockindex->GetSignature()));
     }
     if (!blockindex->minerRewardTxOut.payload.empty()) {
         result.pushKV("requireGenerator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.payload)));
@@ -137,83 +141,113 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+/** Fields of blockToJSON before and after the transactions */
+static void blockToJSONFields(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, UniValue& head, UniValue& tail)
 {
-    // Serialize passed information without accessing chain state of the active chain!
-    AssertLockNotHeld(cs_main); // For performance reasons
-
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", blockindex->GetBlockHash().GetHex());
+    head.setObject();
+    head.pushKV("hash", blockindex->GetBlockHash().GetHex());
     const CBlockIndex* pnext;
     int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
-    result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
-    result.pushKV("weight", (int)::GetBlockWeight(block));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("versionHex", strprintf("%08x", block.nVersion));
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    UniValue txs(UniValue::VARR);
-    for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags(), blockindex->nHeight);
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
-    result.pushKV("tx", txs);
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("nTx", (uint64_t)blockindex->nTx);
-    result.pushKV("baseTarget", (uint64_t)blockindex->nBaseTarget);
-    result.pushKV("plotterId", (uint64_t)blockindex->nPlotterId);
-    result.pushKV("nonce", (uint64_t)blockindex->nNonce);
-    if (!blockindex->pos.IsNull()) {
+    head.pushKV("confirmations", confirmations);
+    head.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    head.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
+    head.pushKV("weight", (int)::GetBlockWeight(block));
+    head.pushKV("height", blockindex->nHeight);
+    head.pushKV("version", block.nVersion);
+    head.pushKV("versionHex", strprintf("%08x", block.nVersion));
+    head.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
+
+    tail.setObject();
+    tail.pushKV("time", block.GetBlockTime());
+    tail.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
+    tail.pushKV("difficulty", GetDifficulty(blockindex));
+    tail.pushKV("chainwork", blockindex->nChainWork.GetHex());
+    tail.pushKV("nTx", (uint64_t)blockindex->nTx);
+    tail.pushKV("baseTarget", (uint64_t)blockindex->nBaseTarget);
+    tail.pushKV("plotterId", (uint64_t)blockindex->nPlotterId);
+    tail.pushKV("nonce", (uint64_t)blockindex->nNonce);
+    const CChiaProofOfSpace blockPos = blockindex->GetPos();
+    if (!blockPos.IsNull()) {
         UniValue pos(UniValue::VOBJ);
 
-        pos.pushKV("farmer_pubkey", HexStr(blockindex->pos.vchFarmerPubKey));
-        if (blockindex->pos.vchPoolPubKey.size() == 32) {
-            pos.pushKV("pool_puzzle_hash", HexStr(blockindex->pos.vchPoolPubKey));
+        pos.pushKV("farmer_pubkey", HexStr(blockPos.vchFarmerPubKey));
+        if (blockPos.vchPoolPubKey.size() == 32) {
+            pos.pushKV("pool_puzzle_hash", HexStr(blockPos.vchPoolPubKey));
         } else {
-            pos.pushKV("pool_pubkey", HexStr(blockindex->pos.vchPoolPubKey));
+            pos.pushKV("pool_pubkey", HexStr(blockPos.vchPoolPubKey));
         }
-        pos.pushKV("proof", HexStr(blockindex->pos.vchProof));
-        pos.pushKV("k", (uint64_t)blockindex->pos.nPlotK);
-        pos.pushKV("signature", HexStr(blockindex->pos.vchSignature));
-        pos.pushKV("scan_iterations", (uint64_t)blockindex->pos.nScanIterations);
+        pos.pushKV("proof", HexStr(blockPos.vchProof));
+        pos.pushKV("k", (uint64_t)blockPos.nPlotK);
+        pos.pushKV("signature", HexStr(blockPos.vchSignature));
+        pos.pushKV("scan_iterations", (uint64_t)blockPos.nScanIterations);
 
-        result.pushKV("pos", pos);
+        tail.pushKV("pos", pos);
     }
-    result.pushKV("generationSignature", HexStr(blockindex->GetGenerationSignature()));
+    tail.pushKV("generationSignature", HexStr(blockindex->GetGenerationSignature()));
     if (blockindex->pprev) {
         LOCK(cs_main);
-        result.pushKV("deadline", (uint64_t)poc::CalculateDeadline(*(blockindex->pprev), blockindex->GetBlockHeader(), Params().GetConsensus()));
+        tail.pushKV("deadline", (uint64_t)poc::CalculateDeadline(*(blockindex->pprev), blockindex->GetBlockHeader(), Params().GetConsensus()));
     } else {
-        result.pushKV("deadline", (uint64_t)0);
+        tail.pushKV("deadline", (uint64_t)0);
     }
-    result.pushKV("generator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.scriptPubKey)));
+    tail.pushKV("generator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.scriptPubKey)));
     if (blockindex->nHeight > 1) {
-        result.pushKV("pubkey", HexStr(blockindex->vchPubKey));
-        result.pushKV("signature", HexStr(blockindex->vchSignature));
+        tail.pushKV("pubkey", HexStr(blockindex->GetPubKey()));
+        tail.pushKV("signature", HexStr(blockindex->GetSignature()));
     }
     if (!blockindex->minerRewardTxOut.payload.empty()) {
-        result.pushKV("requireGenerator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.payload)));
+        tail.pushKV("requireGenerator", EncodeDestination(ExtractDestination(blockindex->minerRewardTxOut.payload)));
     }
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+        tail.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+        tail.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+}
+
+static UniValue blockTxToJSON(const CTransaction& tx, const CBlockIndex* blockindex, bool txDetails)
+{
+    if (!txDetails)
+        return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags(), blockindex->nHeight);
+    return objTx;
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    // Serialize passed information without accessing chain state of the active chain!
+    AssertLockNotHeld(cs_main); // For performance reasons
+
+    UniValue result, tail;
+    blockToJSONFields(block, tip, blockindex, result, tail);
+    UniValue txs(UniValue::VARR);
+    for(const auto& tx : block.vtx)
+        txs.push_back(blockTxToJSON(*tx, blockindex, txDetails));
+    result.pushKV("tx", txs);
+    result.pushKVs(tail);
     return result;
 }
 
+void blockToJSONStream(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails, const std::function<void(const std::string&)>& write)
+{
+    AssertLockNotHeld(cs_main);
+
+    UniValue head, tail;
+    blockToJSONFields(block, tip, blockindex, head, tail);
+    // Same text as blockToJSON().write(), with one transaction in memory at a time
+    std::string strHead = head.write();
+    strHead.back() = ',';
+    write(strHead + "\"tx\":[");
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        write((i == 0 ? "" : ",") + blockTxToJSON(*block.vtx[i], blockindex, txDetails).write());
+    }
+    std::string strTail = tail.write();
+    strTail.front() = ',';
+    write("]" + strTail);
+}
+
+
 static UniValue getblockcount(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblockcount",
@@ -402,6 +436,115 @@ static UniValue syncwithvalidationinterfacequeue(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue getblockconnecttimings(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getblockconnecttimings",
+                "\nReturns the time spent in the stages of connecting blocks since startup, in microseconds.\n"
+                "The stages are the ones logged with -debug=bench.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"blocks\": n,            (numeric) The number of connected blocks\n"
+            "  \"check\": n,             (numeric) Sanity checks of ConnectBlock\n"
+            "  \"forks\": n,             (numeric) Fork checks\n"
+            "  \"connect\": n,           (numeric) Connecting the transactions\n"
+            "  \"reward\": n,            (numeric) Generator and reward checks\n"
+            "  \"verify\": n,            (numeric) Connecting and verifying the transactions, including the reward checks\n"
+            "  \"index\": n,             (numeric) Index writing\n"
+            "  \"callbacks\": n,         (numeric) Callbacks\n"
+            "  \"read_from_disk\": n,    (numeric) Loading the blocks from disk\n"
+            "  \"connect_total\": n,     (numeric) ConnectBlock as a whole\n"
+            "  \"flush\": n,             (numeric) Flushing the coins of the blocks\n"
+            "  \"chainstate\": n,        (numeric) Writing the chainstate\n"
+            "  \"post_connect\": n,      (numeric) Connect postprocessing\n"
+            "  \"omni\": n,              (numeric) The Omni Core block and transaction handlers\n"
+            "  \"total\": n,             (numeric) ConnectTip as a whole\n"
+            "  \"poc\": n,               (numeric) Checking the PoC deadlines of headers\n"
+            "  \"pos\": n                (numeric) Verifying the PoS proofs of headers\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getblockconnecttimings", "")
+            + HelpExampleRpc("getblockconnecttimings", "")
+                },
+            }.Check(request);
+
+    LOCK(cs_main);
+    const BlockConnectTimings timings = GetBlockConnectTimings();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("blocks", timings.nBlocks);
+    obj.pushKV("check", timings.nTimeCheck);
+    obj.pushKV("forks", timings.nTimeForks);
+    obj.pushKV("connect", timings.nTimeConnect);
+    obj.pushKV("reward", timings.nTimeReward);
+    obj.pushKV("verify", timings.nTimeVerify);
+    obj.pushKV("index", timings.nTimeIndex);
+    obj.pushKV("callbacks", timings.nTimeCallbacks);
+    obj.pushKV("read_from_disk", timings.nTimeReadFromDisk);
+    obj.pushKV("connect_total", timings.nTimeConnectTotal);
+    obj.pushKV("flush", timings.nTimeFlush);
+    obj.pushKV("chainstate", timings.nTimeChainState);
+    obj.pushKV("post_connect", timings.nTimePostConnect);
+    obj.pushKV("omni", timings.nTimeOmni);
+    obj.pushKV("total", timings.nTimeTotal);
+    obj.pushKV("poc", timings.nTimePoC);
+    obj.pushKV("pos", timings.nTimePoS);
+    return obj;
+}
+
+static UniValue getdbcompactioninfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getdbcompactioninfo",
+                "\nReturns the state of the background compactions of the chainstate and Omni databases (see -dbcompactidle).\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"enabled\": true|false,      (boolean) Whether the databases are compacted while the node is idle\n"
+            "  \"idle_seconds\": n,          (numeric) Seconds without a new tip before a key range is compacted\n"
+            "  \"running\": \"xxxx\",          (string, optional) The key range being compacted\n"
+            "  \"round_start\": ttt,         (numeric) The start time of the last round over all key ranges, in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"round_done\": n,            (numeric) The key ranges compacted in the last round\n"
+            "  \"round_total\": n,           (numeric) The key ranges of the last round\n"
+            "  \"databases\": [\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",         (string) The database\n"
+            "      \"ranges\": n,            (numeric) The number of key ranges\n"
+            "      \"compactions\": n,       (numeric) The key ranges compacted since startup\n"
+            "      \"last_time\": ttt,       (numeric) The time of the last compaction, in seconds since epoch (Jan 1 1970 GMT)\n"
+            "      \"last_duration\": n      (numeric) How long the last compaction took, in microseconds\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbcompactioninfo", "")
+            + HelpExampleRpc("getdbcompactioninfo", "")
+                },
+            }.Check(request);
+
+    const CDBCompactionScheduler::Status status = GetDBCompactionScheduler().GetStatus();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("enabled", status.nIdleSeconds > 0);
+    obj.pushKV("idle_seconds", status.nIdleSeconds);
+    if (!status.strRunning.empty())
+        obj.pushKV("running", status.strRunning);
+    obj.pushKV("round_start", status.nRoundStart);
+    obj.pushKV("round_done", (uint64_t) status.nRoundDone);
+    obj.pushKV("round_total", (uint64_t) status.nRoundTotal);
+    UniValue databases(UniValue::VARR);
+    for (const CDBCompactionScheduler::DatabaseStatus& database : status.vDatabases) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", database.name);
+        entry.pushKV("ranges", (uint64_t) database.nRanges);
+        entry.pushKV("compactions", database.nCompactions);
+        entry.pushKV("last_time", database.nLastTime);
+        entry.pushKV("last_duration", database.nLastDuration);
+        databases.push_back(entry);
+    }
+    obj.pushKV("databases", databases);
+    return obj;
+}
+
 static UniValue getdifficulty(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getdifficulty",
@@ -514,27 +657,68 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("bip125-replaceable", rbfStatus);
 }
 
-UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
+namespace {
+//! The entries of a pool as returned by the verbose mempool RPCs, while the pool is unchanged
+struct MempoolEntriesSnapshot
 {
-    if (verbose) {
+    const CTxMemPool* pool;
+    unsigned int nTransactionsUpdated;
+    std::map<uint256, UniValue> mapEntries;
+};
+
+Mutex cs_mempool_entries_snapshot;
+std::shared_ptr<const MempoolEntriesSnapshot> mempoolEntriesSnapshot GUARDED_BY(cs_mempool_entries_snapshot);
+} // namespace
+
+/**
+ * Get the snapshot of the entries of pool if it is still current. Otherwise take a new one under pool.cs if fTake,
+ * or return nullptr. Queries answered from the snapshot do not contend with transaction acceptance.
+ */
+static std::shared_ptr<const MempoolEntriesSnapshot> GetMempoolEntriesSnapshot(const CTxMemPool& pool, bool fTake)
+{
+    {
+        LOCK(cs_mempool_entries_snapshot);
+        if (mempoolEntriesSnapshot && mempoolEntriesSnapshot->pool == &pool &&
+                mempoolEntriesSnapshot->nTransactionsUpdated == pool.GetTransactionsUpdated())
+            return mempoolEntriesSnapshot;
+    }
+    if (!fTake)
+        return nullptr;
+
+    std::shared_ptr<MempoolEntriesSnapshot> snapshot = std::make_shared<MempoolEntriesSnapshot>();
+    snapshot->pool = &pool;
+    {
         LOCK(pool.cs);
-        UniValue o(UniValue::VOBJ);
+        snapshot->nTransactionsUpdated = pool.GetTransactionsUpdated();
         for (const CTxMemPoolEntry& e : pool.mapTx) {
-            const uint256& hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
+            UniValue& info = snapshot->mapEntries[e.GetTx().GetHash()];
+            info.setObject();
             entryToJSON(pool, info, e);
+        }
+    }
+
+    LOCK(cs_mempool_entries_snapshot);
+    mempoolEntriesSnapshot = snapshot;
+    return snapshot;
+}
+
+UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
+{
+    if (verbose) {
+        const std::shared_ptr<const MempoolEntriesSnapshot> snapshot = GetMempoolEntriesSnapshot(pool, true);
+        UniValue o(UniValue::VOBJ);
+        for (const auto& entry : snapshot->mapEntries) {
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::__pushKV is used instead which currently is O(1).
-            o.__pushKV(hash.ToString(), info);
+            o.__pushKV(entry.first.ToString(), entry.second);
         }
         return o;
     } else {
-        std::vector<uint256> vtxid;
-        pool.queryHashes(vtxid);
+        const std::shared_ptr<const std::vector<uint256>> vtxid = pool.GetHashesSnapshot();
 
         UniValue a(UniValue::VARR);
-        for (const uint256& hash : vtxid)
+        for (const uint256& hash : *vtxid)
             a.push_back(hash.ToString());
 
         return a;
@@ -728,6 +912,15 @@ static UniValue getmempoolentry(const JSONRPCRequest& request)
 
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
+    const std::shared_ptr<const MempoolEntriesSnapshot> snapshot = GetMempoolEntriesSnapshot(::mempool, false);
+    if (snapshot) {
+        auto itEntry = snapshot->mapEntries.find(hash);
+        if (itEntry == snapshot->mapEntries.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
+        return itEntry->second;
+    }
+
     LOCK(mempool.cs);
 
     CTxMemPool::txiter it = mempool.mapTx.find(hash);
@@ -2043,6 +2236,170 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"dumptxoutset",
+                "\nWrites the UTXO set at the chain tip to a snapshot file, which loadtxoutset loads into a new node.\n"
+                "The snapshot includes the staking pools of the chain, and the transaction count and miner reward of each block.\n"
+                "Note this call may take some time.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "The path of the snapshot file, relative to the data directory"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"coins_written\": n,     (numeric) The number of coins written to the snapshot\n"
+            "  \"base_hash\": \"hex\",     (string) The hash of the block at the tip of the chain\n"
+            "  \"base_height\": n,       (numeric) The height of the block at the tip of the chain\n"
+            "  \"path\": \"path\",         (string) The absolute path of the snapshot file\n"
+            "  \"snapshot_hash\": \"hex\", (string) The hash the snapshot commits to, to be checked by loadtxoutset\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dumptxoutset", "utxo.dat")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+                },
+            }.Check(request);
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    // Write to a temporary path and then move into place, so that an interrupted dump is not mistaken for a snapshot
+    fs::path temppath = fs::absolute(request.params[0].get_str() + ".incomplete", GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists. If you are sure this is what you want, move it out of the way first");
+    }
+
+    CAutoFile afile(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (afile.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open " + temppath.string() + " for writing");
+    }
+    CHashedWriter<CAutoFile> writer(&afile);
+
+    CCoinsStats stats;
+    CCoinsViewCursorRef pcursor;
+    const CBlockIndex* tip;
+    {
+        // The block index and the staking pools are written while the coin database matches them
+        LOCK(cs_main);
+        ::ChainstateActive().ForceFlushStateToDisk();
+        CCoinsViewDB& coinsdb = ::ChainstateActive().CoinsDB();
+        if (!GetUTXOStats(&coinsdb, stats)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+        pcursor = coinsdb.Cursor();
+        tip = LookupBlockIndex(stats.hashBlock);
+        assert(tip);
+
+        writer << SnapshotMetadata(tip->GetBlockHash(), stats.nTransactionOutputs, tip->nChainTx);
+        for (int nHeight = 1; nHeight <= tip->nHeight; nHeight++) {
+            const CBlockIndex* pindex = tip->GetAncestor(nHeight);
+            writer << VARINT(pindex->nTx) << pindex->minerRewardTxOut;
+        }
+
+        std::vector<uint256> epochs;
+        for (const uint256& epochHash : coinsdb.GetStakingPoolEpochs()) {
+            const CBlockIndex* pindexEpoch = LookupBlockIndex(epochHash);
+            if (pindexEpoch && tip->GetAncestor(pindexEpoch->nHeight) == pindexEpoch) {
+                epochs.push_back(epochHash);
+            }
+        }
+        WriteCompactSize(writer, epochs.size());
+        for (const uint256& epochHash : epochs) {
+            const CStakingPoolList pools = coinsdb.GetStakingPools(epochHash);
+            writer << epochHash << pools;
+            for (const StakingPool& pool : pools) {
+                writer << coinsdb.GetStakingPoolUsers(epochHash, pool.poolID);
+            }
+        }
+    }
+
+    uint64_t coins_written = 0;
+    COutPoint key;
+    Coin coin;
+    for (; pcursor->Valid(); pcursor->Next()) {
+        if (coins_written % 5000 == 0 && !IsRPCRunning()) {
+            throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Shutting down");
+        }
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+        writer << key << coin;
+        coins_written++;
+    }
+    if (coins_written != stats.nTransactionOutputs) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "UTXO set changed while it was written");
+    }
+    const uint256 snapshot_hash = writer.GetHash();
+    afile << snapshot_hash;
+    afile.fclose();
+    fs::rename(temppath, path);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_written", (int64_t)coins_written);
+    result.pushKV("base_hash", tip->GetBlockHash().GetHex());
+    result.pushKV("base_height", tip->nHeight);
+    result.pushKV("path", path.string());
+    result.pushKV("snapshot_hash", snapshot_hash.GetHex());
+    return result;
+}
+
+static UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"loadtxoutset",
+                "\nLoads a snapshot written by dumptxoutset into a node that synced the headers, but no blocks yet, and makes\n"
+                "the base block of the snapshot the chain tip. The blocks up to it are treated as pruned, which requires -prune,\n"
+                "and neither -txindex, block filter indexes nor -omni can be enabled.\n"
+                "Note this call may take some time.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "The path of the snapshot file, relative to the data directory"},
+                    {"snapshot_hash", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED_NAMED_ARG, "The hash reported by dumptxoutset, which the snapshot must commit to"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"coins_loaded\": n,      (numeric) The number of coins loaded from the snapshot\n"
+            "  \"base_hash\": \"hex\",     (string) The hash of the base block of the snapshot\n"
+            "  \"base_height\": n,       (numeric) The height of the base block of the snapshot\n"
+            "  \"path\": \"path\",         (string) The absolute path of the snapshot file\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("loadtxoutset", "utxo.dat")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+                },
+            }.Check(request);
+
+    if (!fPruneMode) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot requires -prune");
+    }
+    bool fBlockFilterIndex = false;
+    ForEachBlockFilterIndex([&fBlockFilterIndex](BlockFilterIndex&) { fBlockFilterIndex = true; });
+    if (g_txindex || fBlockFilterIndex || gArgs.GetBoolArg("-omni", DEFAULT_OMNICORE)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot is incompatible with -txindex, block filter indexes and -omni, which need all blocks");
+    }
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    uint256 expected_hash;
+    if (!request.params[1].isNull()) {
+        expected_hash = ParseHashV(request.params[1], "snapshot_hash");
+    }
+
+    SnapshotMetadata metadata;
+    std::string error;
+    if (!::ChainstateActive().LoadSnapshot(path, expected_hash, Params(), metadata, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+
+    CValidationState state;
+    if (!ActivateBestChain(state, Params())) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_loaded", (int64_t)metadata.m_coins_count);
+    result.pushKV("base_hash", metadata.m_base_blockhash.GetHex());
+    result.pushKV("base_height", WITH_LOCK(cs_main, return LookupBlockIndex(metadata.m_base_blockhash)->nHeight));
+    result.pushKV("path", path.string());
+    return result;
+}
+
 //! Search for a given set of pubkey scripts
 bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
     scan_progress = 0;
@@ -2567,6 +2924,117 @@ static UniValue getstakingpooluser(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue getstakingpoolpayouts(const JSONRPCRequest& request)
+{
+    RPCHelpMan{"getstakingpoolpayouts",
+                "\nget the amounts due to the users of a staking pool at the tip.\n"
+                "The amount due is the withdrawable amount of the current epoch snapshot, unless it was withdrawn, and the share of the pool\n"
+                "rewards of the current epoch so far, which the next snapshot credits to the users still staking in the pool.\n",
+                {
+                    {"pool_address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address of the pool"},
+                    {"user_address", RPCArg::Type::STR, /* default */ "all users", "The address of the pool user"},
+                },
+                RPCResult{
+                    "{\n"
+                    "  \"epoch_hash\": \"hash\",          (string) The epoch of the snapshot\n"
+                    "  \"epoch_blocks\": n,               (numeric) The blocks of the epoch so far\n"
+                    "  \"pool_address\": \"address\",     (string) The pool\n"
+                    "  \"pool_reward\": x.xxx,            (numeric) The pool rewards of the epoch so far\n"
+                    "  \"stake_amount\": x.xxx,           (numeric) The stake of the pool in the snapshot\n"
+                    "  \"total_stake_amount\": x.xxx,     (numeric) The stake of all pools in the snapshot, the rewards are shared by\n"
+                    "  \"users\": [\n"
+                    "    {\n"
+                    "      \"address\": \"address\",      (string) The user\n"
+                    "      \"stake_amount\": x.xxx,       (numeric) The stake of the user in the snapshot\n"
+                    "      \"withdrawable_amount\": x.xxx, (numeric) The withdrawable amount of the snapshot, 0 if withdrawn\n"
+                    "      \"pending_reward\": x.xxx,     (numeric) The share of the pool rewards of the epoch so far\n"
+                    "      \"amount_due\": x.xxx          (numeric) The sum of both\n"
+                    "    }, ...\n"
+                    "  ]\n"
+                    "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getstakingpoolpayouts", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
+            + HelpExampleRpc("getstakingpoolpayouts", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
+                }
+            }.Check(request);
+
+    LOCK(cs_main);
+
+    auto& consensusParams = Params().GetConsensus();
+
+    // pool address
+    if (!request.params[0].isStr()) {
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid pool address");
+    }
+    const CAccountID poolID = ExtractAccountID(DecodeDestination(request.params[0].get_str()));
+    if (poolID.IsNull()) {
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid pool address, must from Qitcoin wallet (P2SH address)");
+    }
+
+    // user address
+    CAccountID userID;
+    if (!request.params[1].isNull()) {
+        if (!request.params[1].isStr()) {
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid user address");
+        }
+        userID = ExtractAccountID(DecodeDestination(request.params[1].get_str()));
+        if (userID.IsNull()) {
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid user address, must from Qitcoin wallet (P2SH address)");
+        }
+    }
+
+    const CBlockIndex *pindex = ::ChainActive().Tip();
+    const CBlockIndex* pEpochInitIndex = GetEpochInitIndex(pindex, consensusParams);
+    assert(pEpochInitIndex != nullptr);
+    const uint256 epochHash = pEpochInitIndex->GetBlockHash();
+
+    CCoinsViewCache& chain_view = ::ChainstateActive().CoinsTip();
+    CAmount poolStakeAmount = 0, totalStakeAmount = 0;
+    for (const StakingPool& pool : chain_view.GetStakingPools(epochHash)) {
+        totalStakeAmount += pool.stakeAmount;
+        if (pool.poolID == poolID)
+            poolStakeAmount = pool.stakeAmount;
+    }
+    const CAmount poolReward = GetStakingPoolEpochReward(pindex, poolID, consensusParams);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("epoch_hash", epochHash.GetHex());
+    ret.pushKV("epoch_blocks", pindex->nHeight - pEpochInitIndex->nHeight);
+    ret.pushKV("pool_address", EncodeDestination(ExtractDestination(poolID)));
+    ret.pushKV("pool_reward", ValueFromAmount(poolReward));
+    ret.pushKV("stake_amount", ValueFromAmount(poolStakeAmount));
+    ret.pushKV("total_stake_amount", ValueFromAmount(totalStakeAmount));
+
+    UniValue poolUsers(UniValue::VARR);
+    for (auto &poolUser : chain_view.GetStakingPoolUsers(epochHash, poolID)) {
+        if (!userID.IsNull() && poolUser.accountID != userID)
+            continue;
+
+        // A withdrawn amount is dropped by the next snapshot, see TrySnapshotStakingPoolStatus()
+        CAmount withdrawableAmount = poolUser.withdrawableAmount;
+        if (withdrawableAmount >= PROTOCOL_SATURN_STAKING_MIN_WITHDRAWABLE_AMOUNT &&
+                !chain_view.HaveCoin(CreateStakePendingCoinOutPoint(epochHash, poolID, poolUser.accountID))) {
+            withdrawableAmount = 0;
+        }
+        const CAmount pendingReward = CalcStakePoolUserReward(poolReward, poolUser.stakeAmount, totalStakeAmount);
+
+        UniValue userObj(UniValue::VOBJ);
+        userObj.pushKV("address", EncodeDestination(ExtractDestination(poolUser.accountID)));
+        userObj.pushKV("stake_amount", ValueFromAmount(poolUser.stakeAmount));
+        userObj.pushKV("withdrawable_amount", ValueFromAmount(withdrawableAmount));
+        userObj.pushKV("pending_reward", ValueFromAmount(pendingReward));
+        userObj.pushKV("amount_due", ValueFromAmount(withdrawableAmount + pendingReward));
+        poolUsers.push_back(userObj);
+
+        if (!userID.IsNull())
+            break;
+    }
+    ret.pushKV("users", poolUsers);
+
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2594,12 +3062,16 @@ static const CRPCCommand commands[] =
 
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           {"path", "snapshot_hash"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getdbcompactioninfo",    &getdbcompactioninfo,    {} },
 
     { "blockchain",         "getstakingepoch",        &getstakingepoch,         {"hash_or_height"} },
     { "blockchain",         "getstakingpools",        &getstakingpools,         {"epoch_hash"} },
     { "blockchain",         "getstakingpool",         &getstakingpool,          {"epoch_hash","pool_addres"} },
     { "blockchain",         "getstakingpooluser",     &getstakingpooluser,      {"pool_addres","user_address"} },
+    { "blockchain",         "getstakingpoolpayouts",  &getstakingpoolpayouts,   {"pool_address","user_address"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -2608,6 +3080,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitforblock",           &waitforblock,           {"blockhash","timeout"} },
     { "hidden",             "waitforblockheight",     &waitforblockheight,     {"height","timeout"} },
     { "hidden",             "syncwithvalidationinterfacequeue", &syncwithvalidationinterfacequeue, {} },
+    { "hidden",             "getblockconnecttimings", &getblockconnecttimings, {} },
 };
 // clang-format on
 
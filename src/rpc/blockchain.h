@@ -8,7 +8,9 @@
 #include <amount.h>
 #include <sync.h>
 
+#include <functional>
 #include <stdint.h>
+#include <string>
 #include <vector>
 
 extern RecursiveMutex cs_main;
@@ -34,6 +36,9 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
 
+/** Write the text of blockToJSON piecewise, without building the transactions of the block as one object */
+void blockToJSONStream(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails, const std::function<void(const std::string&)>& write) LOCKS_EXCLUDED(cs_main);
+
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
@@ -0,0 +1,188 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/cache.h>
+
+#include <chain.h>
+#include <rpc/request.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/strencodings.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+struct RPCCacheEntry
+{
+    std::string key;
+    //! The block the response belongs to, and its successor, which "nextblockhash" may refer to
+    uint256 hashBlock;
+    uint256 hashNextBlock;
+    int nHeight;
+    std::shared_ptr<const UniValue> result;
+    size_t nUsage;
+};
+
+typedef std::list<RPCCacheEntry> RPCCacheList;
+
+Mutex g_rpc_cache_mutex;
+//! Entries in least recently used order, the most recent at the front
+RPCCacheList g_rpc_cache_list GUARDED_BY(g_rpc_cache_mutex);
+std::unordered_map<std::string, RPCCacheList::iterator> g_rpc_cache_map GUARDED_BY(g_rpc_cache_mutex);
+size_t g_rpc_cache_usage GUARDED_BY(g_rpc_cache_mutex) = 0;
+size_t g_rpc_cache_max_usage GUARDED_BY(g_rpc_cache_mutex) = 0;
+uint64_t g_rpc_cache_hits GUARDED_BY(g_rpc_cache_mutex) = 0;
+uint64_t g_rpc_cache_misses GUARDED_BY(g_rpc_cache_mutex) = 0;
+
+//! Returns whether responses of the method only depend on the block of the data and the parameters
+bool IsCacheableMethod(const std::string& method)
+{
+    return method == "getblock" || method == "getblockheader" || method == "getrawtransaction" || method == "omni_gettransaction";
+}
+
+std::string GetCacheKey(const JSONRPCRequest& request)
+{
+    // The parameters include the verbosity
+    return request.strMethod + "/" + request.params.write();
+}
+
+//! Returns the hash of the block the response belongs to, or null if it can not be determined
+uint256 GetResponseBlockHash(const JSONRPCRequest& request, const UniValue& result)
+{
+    if (request.strMethod == "getblock" || request.strMethod == "getblockheader") {
+        const UniValue& hash = request.params.isObject() ? find_value(request.params, "blockhash") : request.params[0];
+        if (hash.isStr() && hash.get_str().size() == 64 && IsHex(hash.get_str()))
+            return uint256S(hash.get_str());
+        return uint256();
+    }
+    if (result.isObject() && find_value(result, "blockhash").isStr())
+        return uint256S(find_value(result, "blockhash").get_str());
+    // Raw transactions looked up in a given block
+    if (request.strMethod == "getrawtransaction" && request.params.isArray() && request.params.size() >= 3 && request.params[2].isStr())
+        return uint256S(request.params[2].get_str());
+    return uint256();
+}
+
+void EraseEntry(RPCCacheList::iterator it) EXCLUSIVE_LOCKS_REQUIRED(g_rpc_cache_mutex)
+{
+    g_rpc_cache_usage -= it->nUsage;
+    g_rpc_cache_map.erase(it->key);
+    g_rpc_cache_list.erase(it);
+}
+
+} // namespace
+
+void InitRPCCache(size_t nMaxUsage)
+{
+    LOCK(g_rpc_cache_mutex);
+    g_rpc_cache_list.clear();
+    g_rpc_cache_map.clear();
+    g_rpc_cache_usage = 0;
+    g_rpc_cache_max_usage = nMaxUsage;
+}
+
+bool RPCCacheLookup(const JSONRPCRequest& request, UniValue& result)
+{
+    if (request.fHelp || !IsCacheableMethod(request.strMethod))
+        return false;
+
+    const std::string key = GetCacheKey(request);
+    RPCCacheEntry entry;
+    {
+        LOCK(g_rpc_cache_mutex);
+        if (g_rpc_cache_max_usage == 0)
+            return false;
+        auto it = g_rpc_cache_map.find(key);
+        if (it == g_rpc_cache_map.end()) {
+            g_rpc_cache_misses++;
+            return false;
+        }
+        entry = *it->second;
+    }
+
+    // Entries of blocks disconnected by a reorganization are dropped when they are hit
+    int nConfirmations;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = ::ChainActive()[entry.nHeight];
+        const CBlockIndex* pindexNext = ::ChainActive()[entry.nHeight + 1];
+        if (!pindex || pindex->GetBlockHash() != entry.hashBlock || !pindexNext || pindexNext->GetBlockHash() != entry.hashNextBlock) {
+            LOCK(g_rpc_cache_mutex);
+            auto it = g_rpc_cache_map.find(key);
+            if (it != g_rpc_cache_map.end() && it->second->hashBlock == entry.hashBlock)
+                EraseEntry(it->second);
+            g_rpc_cache_misses++;
+            return false;
+        }
+        nConfirmations = ::ChainActive().Height() - entry.nHeight + 1;
+    }
+
+    result = *entry.result;
+    if (result.isObject() && result.exists("confirmations"))
+        result.pushKV("confirmations", nConfirmations);
+
+    LOCK(g_rpc_cache_mutex);
+    auto it = g_rpc_cache_map.find(key);
+    if (it != g_rpc_cache_map.end())
+        g_rpc_cache_list.splice(g_rpc_cache_list.begin(), g_rpc_cache_list, it->second);
+    g_rpc_cache_hits++;
+    return true;
+}
+
+void RPCCacheInsert(const JSONRPCRequest& request, const UniValue& result)
+{
+    if (request.fHelp || !IsCacheableMethod(request.strMethod))
+        return;
+    {
+        LOCK(g_rpc_cache_mutex);
+        if (g_rpc_cache_max_usage == 0)
+            return;
+    }
+
+    RPCCacheEntry entry;
+    entry.hashBlock = GetResponseBlockHash(request, result);
+    if (entry.hashBlock.IsNull())
+        return;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(entry.hashBlock);
+        if (!pindex || !::ChainActive().Contains(pindex) || ::ChainActive().Height() - pindex->nHeight + 1 < RPC_CACHE_MIN_CONFIRMATIONS)
+            return;
+        entry.nHeight = pindex->nHeight;
+        entry.hashNextBlock = ::ChainActive()[pindex->nHeight + 1]->GetBlockHash();
+    }
+
+    // The serialized size approximates the memory of the response
+    entry.key = GetCacheKey(request);
+    entry.result = std::make_shared<const UniValue>(result);
+    entry.nUsage = sizeof(RPCCacheEntry) + 2 * entry.key.size() + entry.result->write().size();
+
+    LOCK(g_rpc_cache_mutex);
+    if (entry.nUsage > g_rpc_cache_max_usage || g_rpc_cache_map.count(entry.key))
+        return;
+    while (g_rpc_cache_usage + entry.nUsage > g_rpc_cache_max_usage)
+        EraseEntry(std::prev(g_rpc_cache_list.end()));
+    g_rpc_cache_usage += entry.nUsage;
+    g_rpc_cache_list.push_front(std::move(entry));
+    g_rpc_cache_map.emplace(g_rpc_cache_list.front().key, g_rpc_cache_list.begin());
+}
+
+RPCCacheStats GetRPCCacheStats()
+{
+    LOCK(g_rpc_cache_mutex);
+    RPCCacheStats stats;
+    stats.nEntries = g_rpc_cache_map.size();
+    stats.nUsage = g_rpc_cache_usage;
+    stats.nMaxUsage = g_rpc_cache_max_usage;
+    stats.nHits = g_rpc_cache_hits;
+    stats.nMisses = g_rpc_cache_misses;
+    return stats;
+}
@@ -0,0 +1,41 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_CACHE_H
+#define BITCOIN_RPC_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class JSONRPCRequest;
+class UniValue;
+
+//! Size of the RPC response cache in MiB, 0 disables it
+static const int64_t DEFAULT_RPC_CACHE_SIZE = 0;
+//! Confirmations of a block before responses about it are cached
+static const int RPC_CACHE_MIN_CONFIRMATIONS = 6;
+
+/** Usage counters of the RPC response cache */
+struct RPCCacheStats
+{
+    size_t nEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+/** Sets the maximum size of the cache of responses about deeply confirmed blocks and transactions, dropping all entries */
+void InitRPCCache(size_t nMaxUsage);
+/**
+ * Looks up the response of a cacheable request. Responses are only returned while the block they
+ * belong to is still in the active chain, with "confirmations" updated to the current tip.
+ */
+bool RPCCacheLookup(const JSONRPCRequest& request, UniValue& result);
+/** Stores the response of a cacheable request, if it belongs to a deeply confirmed block */
+void RPCCacheInsert(const JSONRPCRequest& request, const UniValue& result);
+/** Returns the usage counters of the cache */
+RPCCacheStats GetRPCCacheStats();
+
+#endif // BITCOIN_RPC_CACHE_H
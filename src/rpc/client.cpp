@@ -67,6 +67,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "sendmany", 4, "subtractfeefrom" },
     { "sendmany", 5 , "replaceable" },
     { "sendmany", 6 , "conf_target" },
+    { "sendpayouts", 0, "amounts" },
+    { "sendpayouts", 1, "outputs_per_tx" },
+    { "sendpayouts", 3, "replaceable" },
+    { "sendpayouts", 4, "conf_target" },
     { "deriveaddresses", 1, "range" },
     { "scantxoutset", 1, "scanobjects" },
     { "addmultisigaddress", 0, "nrequired" },
@@ -149,6 +153,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "bumpfee", 1, "options" },
     { "logging", 0, "include" },
     { "logging", 1, "exclude" },
+    { "getlockstats", 0, "reset" },
     { "disconnectnode", 1, "nodeid" },
     // Echo with conversion (For testing only)
     { "echojson", 0, "arg0" },
@@ -172,6 +177,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     /* Qitcoin */
     { "generatetoaddress", 0, "nblocks" },
     { "generatetoprivkey", 0, "nblocks" },
+    { "generateload", 1, "options" },
     { "dumpprivkeys", 0, "from_index"},
     { "dumpprivkeys", 1, "to_index"},
     { "bindplotter", 2, "allow_high_fee" },
@@ -184,6 +190,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "listbindplotters", 2, "include_watchonly" },
     { "listbindplotterofaddress", 2, "count" },
     { "listbindplotterofaddress", 3, "verbose" },
+    { "listbindplotterhistory", 1, "count" },
+    { "listbindplotterhistoryofaddress", 2, "count" },
+    { "getbindplotterofheight", 1, "height" },
+    { "listpledgeloanofaddress", 1, "options" },
+    { "listpledgedebitofaddress", 1, "options" },
+    { "getaccounthistory", 1, "options" },
+    { "getbalanceofheight", 1, "height" },
     { "createbindplotterdata", 2, "lastActiveHeight" },
     { "getpledge", 1, "verbose" },
     { "getpledgeofaddress", 2, "verbose" },
@@ -212,8 +225,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "createinitialstakingpooltx", 1, "commit_transaction" },
 
     /* Qitcoin & Burst mining compatible */
+    { "getMiningInfo", 0, "timeout" },
     { "submitNonce", 2, "height" },
     { "submitNonce", 4, "checkBind" },
+    { "submitNonces", 0, "nonces" },
+    { "submitNonces", 1, "checkBind" },
+    { "getminingroundstats", 0, "count" },
 
 #ifdef ENABLE_OMNICORE
     /* Omni Core - data retrieval calls */
@@ -238,6 +255,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "omni_listblockstransactions", 1, "lastblock" },
     { "omni_getorderbook", 0, "propertyid" },
     { "omni_getorderbook", 1, "propertyid" },
+    { "omni_getorderbooklevels", 0, "propertyid" },
+    { "omni_getorderbooklevels", 1, "propertyiddesired" },
+    { "omni_getorderbooklevels", 2, "depth" },
+    { "omni_getorderbookdeltas", 0, "propertyid" },
+    { "omni_getorderbookdeltas", 1, "propertyiddesired" },
+    { "omni_getorderbookdeltas", 2, "sequence" },
     { "omni_getseedblocks", 0, "startblock" },
     { "omni_getseedblocks", 1, "endblock" },
     { "omni_getmetadexhash", 0, "propertyid" },
@@ -252,6 +275,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
 
     /* Omni Core - transaction calls */
     { "omni_send", 2, "propertyid" },
+    { "omni_sendmany", 1, "sends" },
     { "omni_sendsto", 1, "propertyid" },
     { "omni_sendsto", 4, "distributionproperty" },
     { "omni_sendall", 2, "ecosystem" },
@@ -11,16 +11,23 @@
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <index/accounthistoryindex.h>
+#include <index/bindplotterindex.h>
 #include <key_io.h>
+#include <metrics.h>
 #include <miner.h>
 #include <net.h>
+#include <node/transaction.h>
 #include <poc/poc.h>
 #include <policy/fees.h>
 #include <pos/pos.h>
+#include <random.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/script.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
 #include <shutdown.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -40,8 +47,12 @@
 #include <wallet/wallet.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 
 // generate nGenerate blocks to coinbase_script and signing with private_key
 static UniValue generateBlocks(const CScript& coinbase_script, const std::shared_ptr<CKey> private_key, int nGenerate)
@@ -937,6 +948,238 @@ static UniValue generatetoprivkey(const JSONRPCRequest& request)
     return generateBlocks(coinbase_script, std::make_shared<CKey>(key), nGenerate);
 }
 
+//! Latency percentiles in microseconds of a stream of submissions
+static UniValue LatencyToJSON(std::vector<int64_t> vLatency)
+{
+    UniValue result(UniValue::VOBJ);
+    if (vLatency.empty())
+        return result;
+    std::sort(vLatency.begin(), vLatency.end());
+    auto percentile = [&vLatency](int n) { return vLatency[(vLatency.size() - 1) * n / 100]; };
+    result.pushKV("p50", percentile(50));
+    result.pushKV("p90", percentile(90));
+    result.pushKV("p99", percentile(99));
+    result.pushKV("max", vLatency.back());
+    return result;
+}
+
+//! Waits for the due time of the n-th submission of a stream at nRate submissions per second, 0 = no waiting
+static void WaitForLoadSlot(int64_t nStart, int64_t nRate, int64_t n)
+{
+    if (nRate <= 0)
+        return;
+    const int64_t nDue = nStart + n * 1000000 / nRate;
+    const int64_t nNow = GetTimeMicros();
+    if (nDue > nNow)
+        std::this_thread::sleep_for(std::chrono::microseconds(nDue - nNow));
+}
+
+static UniValue generateload(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"generateload",
+                "\nSubmit synthetic load to the node and report how long the submissions take (-regtest only).\n"
+                "Nonces are submitted for the next block like submitNonce does. Transactions spend the mature coins of\n"
+                "the private key P2WPKH address, see generatetoprivkey, in chains of up to " + std::to_string(DEFAULT_ANCESTOR_LIMIT) + " transactions per coin.\n",
+                {
+                    {"privkey", RPCArg::Type::STR, RPCArg::Optional::NO, "The private key the nonces are submitted for and the transactions are funded by."},
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED_NAMED_ARG, "",
+                        {
+                            {"nonces", RPCArg::Type::NUM, /* default */ "0", "Number of nonces to submit"},
+                            {"nonce_batch", RPCArg::Type::NUM, /* default */ "1", "Nonces per submission, more than 1 submits them together like submitNonces"},
+                            {"transactions", RPCArg::Type::NUM, /* default */ "0", "Number of transactions to submit to the mempool and relay"},
+                            {"rate", RPCArg::Type::NUM, /* default */ "0", "Submissions per second of each stream, 0 = as fast as possible"},
+                        },
+                        "options"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"nonces\" : {              (json object) The nonce submissions, if any\n"
+            "    \"submitted\" : n,        (numeric) Number of nonces submitted\n"
+            "    \"accepted\" : n,         (numeric) Number of nonces accepted\n"
+            "    \"error\" : \"...\"         (string, optional) The first error\n"
+            "    \"latency\" : {           (json object) Microseconds per submission\n"
+            "      \"p50\" : n, \"p90\" : n, \"p99\" : n, \"max\" : n\n"
+            "    }\n"
+            "  },\n"
+            "  \"transactions\" : { ... }   (json object) The transaction submissions, if any, as for nonces\n"
+            "  \"duration\" : n            (numeric) Microseconds of the whole run\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("generateload", "\"myprivatekey\" '{\"nonces\":10000,\"nonce_batch\":100,\"transactions\":500,\"rate\":100}'")
+                },
+            }.Check(request);
+
+    if (!Params().MineBlocksOnDemand())
+        throw std::runtime_error("generateload for regression testing (-regtest mode) only");
+
+    const std::string strPrivKey = request.params[0].get_str();
+    CKey key = DecodeSecret(strPrivKey);
+    if (!key.IsValid()) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Qitcoin private key");
+    }
+    const CScript witnessScript = GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey().GetID()));
+    const CScript script = GetScriptForDestination(ScriptHash(witnessScript));
+    const CAccountID accountID = ExtractAccountID(script);
+
+    int64_t nNonces = 0, nNonceBatch = 1, nTransactions = 0, nRate = 0;
+    if (!request.params[1].isNull()) {
+        const UniValue& options = request.params[1].get_obj();
+        RPCTypeCheckObj(options,
+            {
+                {"nonces", UniValueType(UniValue::VNUM)},
+                {"nonce_batch", UniValueType(UniValue::VNUM)},
+                {"transactions", UniValueType(UniValue::VNUM)},
+                {"rate", UniValueType(UniValue::VNUM)},
+            },
+            true, true);
+        if (!options["nonces"].isNull())
+            nNonces = options["nonces"].get_int64();
+        if (!options["nonce_batch"].isNull())
+            nNonceBatch = options["nonce_batch"].get_int64();
+        if (!options["transactions"].isNull())
+            nTransactions = options["transactions"].get_int64();
+        if (!options["rate"].isNull())
+            nRate = options["rate"].get_int64();
+    }
+    if (nNonces < 0 || nTransactions < 0 || nRate < 0 || nNonceBatch < 1)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid options, expected non-negative counts and a positive nonce batch");
+
+    // Funding coins of the transactions, each the head of a chain of spends
+    std::vector<std::pair<COutPoint, CAmount>> vChains;
+    const CAmount nFee = ::minRelayTxFee.GetFee(1000);
+    if (nTransactions > 0) {
+        LOCK(cs_main);
+        CValidationState state;
+        if (!::ChainstateActive().FlushStateToDisk(Params(), state, FlushStateMode::ALWAYS)) {
+            throw JSONRPCError(RPC_DATABASE_ERROR, strprintf("Unable to flush state to disk (%s)\n", FormatStateMessage(state)));
+        }
+        const int nHeight = ::ChainActive().Height();
+        const int64_t nChainsNeeded = (nTransactions + DEFAULT_ANCESTOR_LIMIT - 1) / DEFAULT_ANCESTOR_LIMIT;
+        CCoinsViewCursorRef pcursor = ::ChainstateActive().CoinsDB().Cursor(accountID);
+        for (; pcursor->Valid() && (int64_t)vChains.size() < nChainsNeeded; pcursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            if (!pcursor->GetKey(outpoint) || !pcursor->GetValue(coin))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+            if (coin.IsSpent() || coin.GetPayload() || coin.out.scriptPubKey != script || mempool.isSpent(outpoint))
+                continue;
+            if (coin.IsCoinBase() && nHeight - (int)coin.nHeight < COINBASE_MATURITY)
+                continue;
+            if (coin.out.nValue <= nFee * DEFAULT_ANCESTOR_LIMIT + ::minRelayTxFee.GetFee(1000) * 10)
+                continue;
+            vChains.emplace_back(outpoint, coin.out.nValue);
+        }
+        if ((int64_t)vChains.size() < nChainsNeeded)
+            throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strprintf("%d transactions need %d mature coins of the address, %d found", nTransactions, nChainsNeeded, vChains.size()));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    const int64_t nStart = GetTimeMicros();
+
+    if (nNonces > 0) {
+        const CBlockIndex* pindexMining;
+        {
+            LOCK(cs_main);
+            pindexMining = ::ChainActive().Tip();
+        }
+        uint64_t nPlotterId = 18378006326320094226ULL; // as generateBlocks
+        if (pindexMining->nHeight + 1 >= Params().GetConsensus().nSaturnActiveHeight)
+            nPlotterId = accountID.GetUint64(0);
+
+        std::vector<int64_t> vLatency;
+        int64_t nAccepted = 0, nSubmitted = 0;
+        std::string strError;
+        const int64_t nStreamStart = GetTimeMicros();
+        for (int64_t nBatch = 0; nSubmitted < nNonces && !ShutdownRequested(); nBatch++) {
+            WaitForLoadSlot(nStreamStart, nRate, nBatch);
+            const int64_t nCount = std::min(nNonceBatch, nNonces - nSubmitted);
+            std::vector<std::pair<uint64_t, uint64_t>> vPlotterNonces;
+            for (int64_t i = 0; i < nCount; i++)
+                vPlotterNonces.emplace_back(nPlotterId, GetRand(std::numeric_limits<uint64_t>::max()));
+
+            const int64_t nSubmitStart = GetTimeMicros();
+            uint64_t bestDeadline = 0;
+            metrics::g_nonces_submitted.Add(nCount);
+            try {
+                if (nCount == 1) {
+                    poc::AddNonce(bestDeadline, *pindexMining, vPlotterNonces[0].second, nPlotterId, strPrivKey, false, Params().GetConsensus());
+                    nAccepted++;
+                } else {
+                    std::vector<UniValue> vErrors;
+                    poc::AddNonces(bestDeadline, *pindexMining, vPlotterNonces, std::vector<std::string>(nCount, strPrivKey), false, vErrors, Params().GetConsensus());
+                    for (const UniValue& error : vErrors) {
+                        if (error.isNull())
+                            nAccepted++;
+                        else if (strError.empty())
+                            strError = error.isObject() ? error["message"].getValStr() : error.getValStr();
+                    }
+                }
+            } catch (const UniValue& objError) {
+                if (strError.empty())
+                    strError = objError.isObject() ? objError["message"].getValStr() : objError.getValStr();
+            } catch (const std::exception& e) {
+                if (strError.empty())
+                    strError = e.what();
+            }
+            vLatency.push_back(GetTimeMicros() - nSubmitStart);
+            nSubmitted += nCount;
+        }
+
+        UniValue stream(UniValue::VOBJ);
+        stream.pushKV("submitted", nSubmitted);
+        stream.pushKV("accepted", nAccepted);
+        if (!strError.empty())
+            stream.pushKV("error", strError);
+        stream.pushKV("latency", LatencyToJSON(std::move(vLatency)));
+        result.pushKV("nonces", stream);
+    }
+
+    if (nTransactions > 0) {
+        FillableSigningProvider keystore;
+        keystore.AddKey(key);
+        keystore.AddCScript(witnessScript);
+
+        std::vector<int64_t> vLatency;
+        int64_t nAccepted = 0, nSubmitted = 0;
+        std::string strError;
+        const int64_t nStreamStart = GetTimeMicros();
+        for (; nSubmitted < nTransactions && !ShutdownRequested(); nSubmitted++) {
+            WaitForLoadSlot(nStreamStart, nRate, nSubmitted);
+            // Round robin over the chains, so that each grows to the ancestor limit at most
+            auto& chain = vChains[nSubmitted % vChains.size()];
+            CMutableTransaction mtx;
+            mtx.vin.emplace_back(chain.first);
+            mtx.vout.emplace_back(chain.second - nFee, script);
+            if (!SignSignature(keystore, script, mtx, 0, chain.second, SIGHASH_ALL))
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to sign a transaction");
+            CTransactionRef tx = MakeTransactionRef(std::move(mtx));
+
+            const int64_t nSubmitStart = GetTimeMicros();
+            std::string err_string;
+            const TransactionError err = BroadcastTransaction(tx, err_string, 0, true, false);
+            vLatency.push_back(GetTimeMicros() - nSubmitStart);
+            if (err == TransactionError::OK) {
+                nAccepted++;
+                chain = std::make_pair(COutPoint(tx->GetHash(), 0), tx->vout[0].nValue);
+            } else if (strError.empty()) {
+                strError = err_string.empty() ? TransactionErrorString(err) : err_string;
+            }
+        }
+
+        UniValue stream(UniValue::VOBJ);
+        stream.pushKV("submitted", nSubmitted);
+        stream.pushKV("accepted", nAccepted);
+        if (!strError.empty())
+            stream.pushKV("error", strError);
+        stream.pushKV("latency", LatencyToJSON(std::move(vLatency)));
+        result.pushKV("transactions", stream);
+    }
+
+    result.pushKV("duration", GetTimeMicros() - nStart);
+    return result;
+}
+
 static UniValue getactivebindplotteraddress(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1101,17 +1344,9 @@ static UniValue listbindplotterofaddress(const JSONRPCRequest& request)
     }
 
     // Capacity
-    uint64_t nNetCapacityTB = 0;
-    int nBlockCount = 0;
-    std::map<uint64_t, int> mapPlotterMiningCount;
-    if (!mapOrderedCoins.empty()) {
-        nNetCapacityTB = poc::GetNetCapacity(::ChainActive().Height(), Params().GetConsensus(),
-            [&mapPlotterMiningCount, &nBlockCount](const CBlockIndex &block) {
-                nBlockCount++;
-                mapPlotterMiningCount[block.nPlotterId]++;
-            }
-        );
-    }
+    const poc::EvalWindow& window = poc::GetEvalWindow(::ChainActive().Height(), Params().GetConsensus());
+    const uint64_t nNetCapacityTB = window.GetNetCapacity();
+    const int nBlockCount = window.nBlockCount;
 
     bool fContinue = true;
     for (CCoinsOrderByHeightMap::const_iterator itMapCoins = mapOrderedCoins.cbegin(); fContinue && itMapCoins != mapOrderedCoins.cend(); ++itMapCoins) {
@@ -1125,7 +1360,7 @@ static UniValue listbindplotterofaddress(const JSONRPCRequest& request)
             item.pushKV("blocktime", ::ChainActive()[static_cast<int>(it->second.nHeight)]->GetBlockTime());
             item.pushKV("blockheight", it->second.nHeight);
             if (nBlockCount > 0) {
-                item.pushKV("capacity", ValueFromCapacity((nNetCapacityTB * mapPlotterMiningCount[it->second.plotterId]) / nBlockCount));
+                item.pushKV("capacity", ValueFromCapacity((nNetCapacityTB * window.GetMinedCount(it->second.plotterId)) / nBlockCount));
             } else {
                 item.pushKV("capacity", ValueFromCapacity(0));
             }
@@ -1144,6 +1379,177 @@ static UniValue listbindplotterofaddress(const JSONRPCRequest& request)
     return ret;
 }
 
+static void EnsureBindPlotterIndex()
+{
+    if (!g_bindplotterindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Requires -bindplotterindex");
+    if (!g_bindplotterindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Bind plotter index is still syncing. Try again later");
+}
+
+static UniValue BindPlotterEventToJSON(const CBindPlotterEvent& event) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    UniValue item(UniValue::VOBJ);
+    item.pushKV("address", EncodeDestination(ScriptHash(event.accountID)));
+    item.pushKV("plotterId", std::to_string(event.plotterId));
+    item.pushKV("txid", event.outpoint.hash.GetHex());
+    item.pushKV("vout", (int) event.outpoint.n);
+    if (const CBlockIndex* pindex = ::ChainActive()[event.nHeight]) {
+        item.pushKV("blockhash", pindex->GetBlockHash().GetHex());
+        item.pushKV("blocktime", pindex->GetBlockTime());
+    }
+    item.pushKV("blockheight", event.nHeight);
+    if (event.IsSpent()) {
+        item.pushKV("unbindtxid", event.spendTxid.GetHex());
+        item.pushKV("unbindheight", event.nSpendHeight);
+    }
+    return item;
+}
+
+static const std::string BIND_PLOTTER_EVENT_HELP =
+            "  {\n"
+            "    \"address\":\"address\",               (string) The Qitcoin address of the binded.\n"
+            "    \"plotterId\": \"plotterId\",          (string) The binded plotter ID.\n"
+            "    \"txid\": \"transactionid\",           (string) The bind transaction id.\n"
+            "    \"vout\": n,                         (numeric) The output of the bind.\n"
+            "    \"blockhash\": \"hashvalue\",          (string) The block hash containing the bind transaction.\n"
+            "    \"blocktime\": xxx,                  (numeric) The block time in seconds since epoch (1 Jan 1970 GMT).\n"
+            "    \"blockheight\": xxx,                (numeric) The block height of the bind transaction.\n"
+            "    \"unbindtxid\": \"transactionid\",     (string) The transaction spending the bind, by unbind or rebind. Only if spent.\n"
+            "    \"unbindheight\": xxx,               (numeric) The block height of the spending transaction. Only if spent.\n"
+            "  }\n";
+
+static UniValue listbindplotterhistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "listbindplotterhistory \"plotterId\" ( count )\n"
+            "\nReturns all binds of plotter, including the unbound ones, newest first. Requires -bindplotterindex.\n"
+            "\nArguments:\n"
+            "1. plotterId           (string, required) The plotter ID\n"
+            "2. count               (numeric, optional) The maximum number of binds to list. If not set then all\n"
+            "\nResult:\n"
+            "[\n"
+            + BIND_PLOTTER_EVENT_HELP +
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("listbindplotterhistory", "\"12345678900000000000\" 10")
+            + HelpExampleRpc("listbindplotterhistory", "\"12345678900000000000\", 10")
+        );
+
+    uint64_t plotterId = 0;
+    if (!request.params[0].isStr() || !IsValidPlotterID(request.params[0].get_str(), &plotterId))
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid plotter ID");
+    size_t count = std::numeric_limits<size_t>::max();
+    if (request.params.size() >= 2 && !request.params[1].isNull()) {
+        if (request.params[1].get_int() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+        count = (size_t) request.params[1].get_int();
+    }
+
+    EnsureBindPlotterIndex();
+    std::vector<CBindPlotterEvent> events;
+    if (!g_bindplotterindex->FindPlotterBinds(plotterId, count, events))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read bind plotter index");
+
+    LOCK(cs_main);
+    UniValue ret(UniValue::VARR);
+    for (const CBindPlotterEvent& event : events)
+        ret.push_back(BindPlotterEventToJSON(event));
+    return ret;
+}
+
+static UniValue listbindplotterhistoryofaddress(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "listbindplotterhistoryofaddress \"address\" ( \"plotterId\" count )\n"
+            "\nReturns all binds of address, including the unbound ones, by plotter and newest first. Requires -bindplotterindex.\n"
+            "\nArguments:\n"
+            "1. address             (string, required) The Qitcoin address\n"
+            "2. plotterId           (string, optional) The filter plotter ID. If 0 or not set then all plotters\n"
+            "3. count               (numeric, optional) The maximum number of binds to list. If not set then all\n"
+            "\nResult:\n"
+            "[\n"
+            + BIND_PLOTTER_EVENT_HELP +
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("listbindplotterhistoryofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" \"0\" 10")
+            + HelpExampleRpc("listbindplotterhistoryofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\", \"0\", 10")
+        );
+
+    if (!request.params[0].isStr())
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
+    const CAccountID accountID = ExtractAccountID(DecodeDestination(request.params[0].get_str()));
+    if (accountID.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid address");
+    uint64_t plotterId = 0;
+    if (request.params.size() >= 2 && !request.params[1].isNull()) {
+        if (!request.params[1].isStr() || (!request.params[1].get_str().empty() && !IsValidPlotterID(request.params[1].get_str(), &plotterId)))
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid plotter ID");
+    }
+    size_t count = std::numeric_limits<size_t>::max();
+    if (request.params.size() >= 3 && !request.params[2].isNull()) {
+        if (request.params[2].get_int() < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+        count = (size_t) request.params[2].get_int();
+    }
+
+    EnsureBindPlotterIndex();
+    std::vector<CBindPlotterEvent> events;
+    if (!g_bindplotterindex->FindAccountBinds(accountID, plotterId, count, events))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read bind plotter index");
+
+    LOCK(cs_main);
+    UniValue ret(UniValue::VARR);
+    for (const CBindPlotterEvent& event : events)
+        ret.push_back(BindPlotterEventToJSON(event));
+    return ret;
+}
+
+static UniValue getbindplotterofheight(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getbindplotterofheight \"plotterId\" ( height )\n"
+            "\nReturns the bind of plotter which was active after the block at height. Requires -bindplotterindex.\n"
+            "\nArguments:\n"
+            "1. plotterId           (string, required) The plotter ID\n"
+            "2. height              (numeric, optional) The block height. If not set then the current height\n"
+            "\nResult (null if the plotter was not binded):\n"
+            + BIND_PLOTTER_EVENT_HELP +
+
+            "\nExamples:\n"
+            + HelpExampleCli("getbindplotterofheight", "\"12345678900000000000\" 1000")
+            + HelpExampleRpc("getbindplotterofheight", "\"12345678900000000000\", 1000")
+        );
+
+    uint64_t plotterId = 0;
+    if (!request.params[0].isStr() || !IsValidPlotterID(request.params[0].get_str(), &plotterId))
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid plotter ID");
+
+    EnsureBindPlotterIndex();
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = ::ChainActive().Height();
+        if (request.params.size() >= 2 && !request.params[1].isNull()) {
+            if (request.params[1].get_int() < 0 || request.params[1].get_int() > nHeight)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            nHeight = request.params[1].get_int();
+        }
+    }
+
+    CBindPlotterEvent event;
+    if (!g_bindplotterindex->FindActiveBind(plotterId, nHeight, event))
+        return NullUniValue;
+
+    LOCK(cs_main);
+    return BindPlotterEventToJSON(event);
+}
+
 static UniValue createbindplotterdata(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1395,21 +1801,28 @@ static UniValue getpledgeofaddress(const std::string &address, uint64_t nPlotter
     int64_t nNetCapacityTB = 0, nCapacityTB = 0;
     std::set<uint64_t> plotters = ::ChainstateActive().CoinsTip().GetAccountBindPlotters(accountID);
     if (!plotters.empty()) {
+        const poc::EvalWindow& window = poc::GetEvalWindow(::ChainActive().Height(), params);
+        nNetCapacityTB = window.GetNetCapacity();
+        nBlockCount = window.nBlockCount;
+        int nLastBlockMissing = 0;
         for (const uint64_t& plotterId : plotters) {
-            mapBindPlotter[plotterId] = PlotterItem{0, nullptr};
+            const int minedCount = window.GetMinedCount(plotterId);
+            mapBindPlotter[plotterId] = PlotterItem{minedCount, nullptr};
+            nMinedBlockCount += minedCount;
+            if (minedCount > 0)
+                nLastBlockMissing++;
         }
-        nNetCapacityTB = poc::GetNetCapacity(::ChainActive().Height(), params,
-            [&nBlockCount, &nMinedBlockCount, &plotters, &mapBindPlotter](const CBlockIndex &block) {
-                nBlockCount++;
-                if (plotters.count(block.nPlotterId)) {
-                    nMinedBlockCount++;
-                    
-                    PlotterItem &item = mapBindPlotter[block.nPlotterId];
-                    item.minedCount++;
-                    item.pindexLast = &block;
+        // Last mined block of each plotter, scan from tip
+        if (fVerbose && nLastBlockMissing > 0) {
+            for (const CBlockIndex& block : poc::GetEvalBlocks(::ChainActive().Height(), false, params)) {
+                auto it = mapBindPlotter.find(block.nPlotterId);
+                if (it != mapBindPlotter.end() && it->second.pindexLast == nullptr) {
+                    it->second.pindexLast = &block;
+                    if (--nLastBlockMissing == 0)
+                        break;
                 }
             }
-        );
+        }
         if (nMinedBlockCount < nBlockCount)
             nMinedBlockCount++;
         if (nBlockCount > 0)
@@ -1507,7 +1920,7 @@ static UniValue getpledgeofaddress(const JSONRPCRequest& request)
             "getpledgeofaddress address (plotterId)\n"
             "Get pledge information of address.\n"
             "\nArguments:\n"
-            "1. address         (string, required) The Qitcoin address.\n"
+            "1. address         (string or array, required) The Qitcoin address, or an array of addresses to get an array of results at one height.\n"
             "2. plotterId       (string, optional) DEPRECTED after QTCIP006. Plotter ID\n"
             "3. verbose         (bool, optional, default=false) If true, return detail pledge\n"
             "\nResult:\n"
@@ -1527,11 +1940,12 @@ static UniValue getpledgeofaddress(const JSONRPCRequest& request)
             "\nExample:\n"
             + HelpExampleCli("getpledgeofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" \"0\" true")
             + HelpExampleRpc("getpledgeofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\", \"0\", true")
+            + HelpExampleRpc("getpledgeofaddress", std::string("[\"") + Params().GetConsensus().FundAddress + "\"]")
             );
 
     LOCK(cs_main);
 
-    if (!request.params[0].isStr())
+    if (!request.params[0].isStr() && !request.params[0].isArray())
         throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
 
     uint64_t plotterId = 0;
@@ -1545,59 +1959,34 @@ static UniValue getpledgeofaddress(const JSONRPCRequest& request)
         fVerbose = request.params[2].isNum() ? (request.params[2].get_int() != 0) : request.params[2].get_bool();
     }
 
+    if (request.params[0].isArray()) {
+        // All addresses are looked up on the same tip, the evaluation window is shared
+        UniValue results(UniValue::VARR);
+        for (const UniValue& address : request.params[0].getValues()) {
+            if (!address.isStr())
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
+            results.push_back(getpledgeofaddress(address.get_str(), plotterId, fVerbose));
+        }
+        return results;
+    }
     return getpledgeofaddress(request.params[0].get_str(), plotterId, fVerbose);
 }
 
-static UniValue getplottermininginfo(const JSONRPCRequest& request)
+static UniValue getplottermininginfo(uint64_t nPlotterId, bool fVerbose)
 {
-    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
-        throw std::runtime_error(
-            "getplottermininginfo plotterId height\n"
-            "Get mining information of plotter.\n"
-            "\nArguments:\n"
-            "1. plotterId       (string, required) Plotter\n"
-            "2. verbose         (bool, optional, default=true) If true, return detail plotter mining information\n"
-            "\nResult:\n"
-            "The mining information of plotter\n"
-            "\n"
-            "\nExample:\n"
-            + HelpExampleCli("getplottermininginfo", "\"1234567890\" true")
-            + HelpExampleRpc("getplottermininginfo", "\"1234567890\", true")
-            );
-
-    uint64_t nPlotterId = 0;
-    if (!request.params[0].isStr() || !IsValidPlotterID(request.params[0].get_str(), &nPlotterId))
-        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid plotter ID");
-
-    bool fVerbose = true;
-    if (!request.params[1].isNull()) {
-        fVerbose = request.params[1].isNum() ? (request.params[1].get_int() != 0) : request.params[1].get_bool();
-    }
-
     LOCK(cs_main);
     const Consensus::Params& params = Params().GetConsensus();
     const int nHeight = ::ChainActive().Height();
-    const poc::CBlockList vBlocks = poc::GetEvalBlocks(::ChainActive().Height(), true, params);
+    const poc::EvalWindow& window = poc::GetEvalWindow(::ChainActive().Height(), params);
 
     int64_t nNetCapacityTB = 0, nCapacityTB = 0;
-    if (!vBlocks.empty()) {
-        uint64_t nBaseTarget = 0;
-        int nBlockCount = 0;
-        int nMinedBlockCount = 0;
-        for (const CBlockIndex& block : vBlocks) {
-            if (block.nPlotterId == nPlotterId)
-                nMinedBlockCount++;
-
-            nBaseTarget += block.nBaseTarget;
-            nBlockCount++;
-        }
-        if (nBlockCount > 0) {
-            nBaseTarget = std::max(nBaseTarget / nBlockCount, uint64_t(1));
-            nNetCapacityTB = std::max(static_cast<int64_t>(poc::INITIAL_BASE_TARGET / nBaseTarget), (int64_t) 1);
-            if (nMinedBlockCount < (int) vBlocks.size())
-                nMinedBlockCount++;
-            nCapacityTB = std::max((int64_t) ((nNetCapacityTB * nMinedBlockCount) / vBlocks.size()), (int64_t) 1);
-        }
+    if (window.nBlockCount > 0) {
+        uint64_t nBaseTarget = std::max(window.nBaseTargetSum / window.nBlockCount, uint64_t(1));
+        int nMinedBlockCount = window.GetMinedCount(nPlotterId);
+        nNetCapacityTB = std::max(static_cast<int64_t>(poc::INITIAL_BASE_TARGET / nBaseTarget), (int64_t) 1);
+        if (nMinedBlockCount < window.nBlockCount)
+            nMinedBlockCount++;
+        nCapacityTB = std::max((int64_t) ((nNetCapacityTB * nMinedBlockCount) / window.nBlockCount), (int64_t) 1);
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1626,18 +2015,19 @@ static UniValue getplottermininginfo(const JSONRPCRequest& request)
     // Mined
     if (fVerbose) {
         UniValue vMinedBlocks(UniValue::VARR);
-        for (auto it = vBlocks.rbegin(); it != vBlocks.rend(); it++) {
-            const CBlockIndex& blockIndex = *it;
+        int nMinedBlockMissing = window.GetMinedCount(nPlotterId);
+        for (const CBlockIndex& blockIndex : poc::GetEvalBlocks(nHeight, false, params)) {
+            if (nMinedBlockMissing == 0)
+                break;
             if (blockIndex.nPlotterId == nPlotterId) {
+                --nMinedBlockMissing;
                 UniValue item(UniValue::VOBJ);
                 item.pushKV("blockhash", blockIndex.GetBlockHash().GetHex());
                 item.pushKV("blocktime", blockIndex.GetBlockTime());
                 item.pushKV("blockheight", blockIndex.nHeight);
-                if (blockIndex.nTx > 0) {
-                    CBlock block;
-                    if (ReadBlockFromDisk(block, &blockIndex, params))
-                        item.pushKV("address", EncodeDestination(ExtractDestination(block.vtx[0]->vout[0].scriptPubKey)));
-                }
+                // The generator is kept in the block index, so that pruned blocks are reported too
+                if (blockIndex.nTx > 0)
+                    item.pushKV("address", EncodeDestination(ExtractDestination(blockIndex.minerRewardTxOut.scriptPubKey)));
                 vMinedBlocks.push_back(item);
             }
         }
@@ -1647,10 +2037,51 @@ static UniValue getplottermininginfo(const JSONRPCRequest& request)
     return result;
 }
 
-static UniValue ListPoint(CCoinsViewCursorRef pcursor) {
+static UniValue getplottermininginfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3)
+        throw std::runtime_error(
+            "getplottermininginfo plotterId height\n"
+            "Get mining information of plotter.\n"
+            "\nArguments:\n"
+            "1. plotterId       (string or array, required) Plotter, or an array of plotters to get an array of results at one height\n"
+            "2. verbose         (bool, optional, default=true) If true, return detail plotter mining information\n"
+            "\nResult:\n"
+            "The mining information of plotter\n"
+            "\n"
+            "\nExample:\n"
+            + HelpExampleCli("getplottermininginfo", "\"1234567890\" true")
+            + HelpExampleRpc("getplottermininginfo", "\"1234567890\", true")
+            + HelpExampleRpc("getplottermininginfo", "[\"1234567890\", \"9876543210\"], false")
+            );
+
+    bool fVerbose = true;
+    if (!request.params[1].isNull()) {
+        fVerbose = request.params[1].isNum() ? (request.params[1].get_int() != 0) : request.params[1].get_bool();
+    }
+
+    auto parsePlotterId = [](const UniValue& value) {
+        uint64_t nPlotterId = 0;
+        if (!value.isStr() || !IsValidPlotterID(value.get_str(), &nPlotterId))
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid plotter ID");
+        return nPlotterId;
+    };
+
+    if (request.params[0].isArray()) {
+        // All plotters are looked up on the same tip, the evaluation window is shared
+        LOCK(cs_main);
+        UniValue results(UniValue::VARR);
+        for (const UniValue& plotterId : request.params[0].getValues())
+            results.push_back(getplottermininginfo(parsePlotterId(plotterId), fVerbose));
+        return results;
+    }
+    return getplottermininginfo(parsePlotterId(request.params[0]), fVerbose);
+}
+
+static UniValue ListPoint(CCoinsViewCursorRef pcursor, size_t count = std::numeric_limits<size_t>::max(), COutPoint *next = nullptr) {
     assert(pcursor != nullptr);
     UniValue ret(UniValue::VARR);
-    for (; pcursor->Valid(); pcursor->Next()) {
+    for (; pcursor->Valid() && ret.size() < count; pcursor->Next()) {
         COutPoint key;
         Coin coin;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
@@ -1659,10 +2090,10 @@ static UniValue ListPoint(CCoinsViewCursorRef pcursor) {
 
             UniValue item(UniValue::VOBJ);
             item.pushKV("from", EncodeDestination(ExtractDestination(coin.out.scriptPubKey)));
-            item.pushKV("to", EncodeDestination(ScriptHash(PointPayload::As(coin.payload)->GetReceiverID())));
+            item.pushKV("to", EncodeDestination(ScriptHash(PointPayload::As(coin.GetPayload())->GetReceiverID())));
             item.pushKV("lock_amount", ValueFromAmount(coin.out.nValue));
-            item.pushKV("effective_amount", ValueFromAmount(PointPayload::As(coin.payload)->GetAmount()));
-            item.pushKV("lock_blocks", (int)PointPayload::As(coin.payload)->GetLockBlocks());
+            item.pushKV("effective_amount", ValueFromAmount(PointPayload::As(coin.GetPayload())->GetAmount()));
+            item.pushKV("lock_blocks", (int)PointPayload::As(coin.GetPayload())->GetLockBlocks());
             item.pushKV("txid", key.hash.GetHex());
             item.pushKV("blockhash", ::ChainActive()[(int)coin.nHeight]->GetBlockHash().GetHex());
             item.pushKV("blocktime", ::ChainActive()[(int)coin.nHeight]->GetBlockTime());
@@ -1672,18 +2103,91 @@ static UniValue ListPoint(CCoinsViewCursorRef pcursor) {
         } else
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
     }
+    if (next != nullptr && !(pcursor->Valid() && pcursor->GetKey(*next)))
+        next->SetNull();
 
     return ret;
 }
 
+/** List the point coins sent or received by the address of the request, a page of them with options */
+static UniValue ListPointOfAddress(const JSONRPCRequest& request, bool fReceive)
+{
+    if (!request.params[0].isStr())
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
+    const CAccountID accountID = ExtractAccountID(DecodeDestination(request.params[0].get_str()));
+    if (accountID.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid address");
+
+    CAccountCoinsFilter filter;
+    size_t count = std::numeric_limits<size_t>::max();
+    const bool fPaged = request.params.size() >= 2 && !request.params[1].isNull();
+    if (fPaged) {
+        const UniValue& options = request.params[1].get_obj();
+        RPCTypeCheckObj(options,
+            {
+                {"count", UniValueType(UniValue::VNUM)},
+                {"start", UniValueType(UniValue::VSTR)},
+                {"min_amount", UniValueType()}, // will be checked below
+                {"min_height", UniValueType(UniValue::VNUM)},
+                {"max_height", UniValueType(UniValue::VNUM)},
+            },
+            true, true);
+        if (!options["count"].isNull()) {
+            if (options["count"].get_int() <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+            count = (size_t) options["count"].get_int();
+        }
+        if (!options["start"].isNull()) {
+            const std::string& start = options["start"].get_str();
+            const size_t pos = start.find(':');
+            uint32_t n;
+            if (pos == std::string::npos || !IsHex(start.substr(0, pos)) || pos != 64 || !ParseUInt32(start.substr(pos + 1), &n))
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid start, expected the next value of a previous page");
+            filter.start = COutPoint(uint256S(start.substr(0, pos)), n);
+        }
+        if (!options["min_amount"].isNull())
+            filter.nMinAmount = AmountFromValue(options["min_amount"]);
+        if (!options["min_height"].isNull())
+            filter.nMinHeight = options["min_height"].get_int();
+        if (!options["max_height"].isNull())
+            filter.nMaxHeight = options["max_height"].get_int();
+    }
+
+    LOCK(cs_main);
+
+    CValidationState state;
+    if (!::ChainstateActive().FlushStateToDisk(Params(), state, FlushStateMode::ALWAYS)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, strprintf("Unable to flush state to disk (%s)\n", FormatStateMessage(state)));
+    }
+    const CCoinsViewDB& coinsdb = ::ChainstateActive().CoinsDB();
+    CCoinsViewCursorRef pcursor = fReceive ? coinsdb.PointReceiveCursor(accountID, filter) : coinsdb.PointSendCursor(accountID, filter);
+    if (!fPaged)
+        return ListPoint(pcursor);
+
+    COutPoint next;
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins", ListPoint(pcursor, count, &next));
+    if (!next.IsNull())
+        result.pushKV("next", strprintf("%s:%u", next.hash.GetHex(), next.n));
+    return result;
+}
+
 static UniValue listpledgeloanofaddress(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-            "listpledgeloanofaddress \"address\"\n"
+            "listpledgeloanofaddress \"address\" ( options )\n"
             "\nReturns up to point sent coins.\n"
             "\nArguments:\n"
             "1. address             (string, required) The Qitcoin address\n"
+            "2. options             (json object, optional) Return a page of the coins, as {\"coins\": [...], \"next\": \"start\"}\n"
+            "    {\n"
+            "      \"count\": n,             (numeric, optional) The maximum number of coins in the page\n"
+            "      \"start\": \"start\",       (string, optional) The \"next\" value of the previous page, to continue from\n"
+            "      \"min_amount\": x.xxx,    (numeric or string, optional) The minimum amount of the coins\n"
+            "      \"min_height\": n,        (numeric, optional) The minimum block height of the coins\n"
+            "      \"max_height\": n,        (numeric, optional) The maximum block height of the coins\n"
+            "    }\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -1701,31 +2205,30 @@ static UniValue listpledgeloanofaddress(const JSONRPCRequest& request)
             "\nList the point sent coins from UTXOs\n"
             + HelpExampleCli("listpledgeloanofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
             + HelpExampleRpc("listpledgeloanofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
+            + "\nList the first 100 of them, and then the next 100\n"
+            + HelpExampleCli("listpledgeloanofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"count\": 100}'")
+            + HelpExampleCli("listpledgeloanofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"count\": 100, \"start\": \"<next>\"}'")
         );
 
-    if (!request.params[0].isStr())
-        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
-    const CAccountID accountID = ExtractAccountID(DecodeDestination(request.params[0].get_str()));
-    if (accountID.IsNull())
-        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid address");
-
-    LOCK(cs_main);
-
-    CValidationState state;
-    if (!::ChainstateActive().FlushStateToDisk(Params(), state, FlushStateMode::ALWAYS)) {
-        throw JSONRPCError(RPC_DATABASE_ERROR, strprintf("Unable to flush state to disk (%s)\n", FormatStateMessage(state)));
-    }
-    return ListPoint(::ChainstateActive().CoinsDB().PointSendCursor(accountID));
+    return ListPointOfAddress(request, false);
 }
 
 static UniValue listpledgedebitofaddress(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1)
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
         throw std::runtime_error(
-            "listpledgedebitofaddress \"address\"\n"
+            "listpledgedebitofaddress \"address\" ( options )\n"
             "\nReturns up to point receive coins.\n"
             "\nArguments:\n"
             "1. address             (string, required) The Qitcoin address\n"
+            "2. options             (json object, optional) Return a page of the coins, as {\"coins\": [...], \"next\": \"start\"}\n"
+            "    {\n"
+            "      \"count\": n,             (numeric, optional) The maximum number of coins in the page\n"
+            "      \"start\": \"start\",       (string, optional) The \"next\" value of the previous page, to continue from\n"
+            "      \"min_amount\": x.xxx,    (numeric or string, optional) The minimum amount of the coins\n"
+            "      \"min_height\": n,        (numeric, optional) The minimum block height of the coins\n"
+            "      \"max_height\": n,        (numeric, optional) The maximum block height of the coins\n"
+            "    }\n"
             "\nResult:\n"
             "[\n"
             "  {\n"
@@ -1743,6 +2246,73 @@ static UniValue listpledgedebitofaddress(const JSONRPCRequest& request)
             "\nList the point receive coins from UTXOs\n"
             + HelpExampleCli("listpledgedebitofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
             + HelpExampleRpc("listpledgedebitofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
+            + "\nList the first 100 of them, and then the next 100\n"
+            + HelpExampleCli("listpledgedebitofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"count\": 100}'")
+            + HelpExampleCli("listpledgedebitofaddress", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"count\": 100, \"start\": \"<next>\"}'")
+        );
+
+    return ListPointOfAddress(request, true);
+}
+
+static std::string PayloadTypeName(TxOutType type)
+{
+    switch (type) {
+    case TxOutType::TXOUT_TYPE_BINDPLOTTER:
+        return "bindplotter";
+    case TxOutType::TXOUT_TYPE_POINT:
+        return "point";
+    case TxOutType::TXOUT_TYPE_STAKING:
+        return "staking";
+    default:
+        break;
+    }
+
+    return "";
+}
+
+static void EnsureAccountHistoryIndex()
+{
+    if (!g_accounthistoryindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Requires -accounthistoryindex");
+    if (!g_accounthistoryindex->BlockUntilSyncedToCurrentChain())
+        throw JSONRPCError(RPC_MISC_ERROR, "Account history index is still syncing. Try again later");
+}
+
+static UniValue getaccounthistory(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getaccounthistory \"address\" ( options )\n"
+            "\nReturns the confirmed transactions of address, newest first. Requires -accounthistoryindex.\n"
+            "\nArguments:\n"
+            "1. address             (string, required) The Qitcoin address\n"
+            "2. options             (json object, optional)\n"
+            "    {\n"
+            "      \"count\": n,             (numeric, optional) The maximum number of transactions to return\n"
+            "      \"skip\": n,              (numeric, optional, default=0) The number of the newest transactions to skip\n"
+            "      \"min_height\": n,        (numeric, optional) The minimum block height of the transactions\n"
+            "      \"max_height\": n,        (numeric, optional) The maximum block height of the transactions\n"
+            "      \"type\": \"type\",         (string, optional) Only transactions of \"bindplotter\", \"point\" or \"staking\"\n"
+            "    }\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\": \"transactionid\",           (string) The transaction id.\n"
+            "    \"blockhash\": \"hashvalue\",          (string) The block hash containing the transaction.\n"
+            "    \"blocktime\": xxx,                  (numeric) The block time in seconds since epoch (1 Jan 1970 GMT).\n"
+            "    \"blockheight\": xxx,                (numeric) The block height.\n"
+            "    \"amount\": x.xxx,                   (numeric) The change of the balance in " + CURRENCY_UNIT + ", negative for spending.\n"
+            "    \"balance\": x.xxx,                  (numeric) The balance after the transaction in " + CURRENCY_UNIT + ".\n"
+            "    \"type\": \"type\",                    (string) The \"bindplotter\", \"point\" or \"staking\" of the transaction. Only for these.\n"
+            "    \"spent\": true|false,             (boolean) Whether the bind plotter, point or staking is spent by the transaction. Only for these.\n"
+            "  }\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getaccounthistory", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
+            + HelpExampleCli("getaccounthistory", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"count\": 100, \"skip\": 100}'")
+            + HelpExampleCli("getaccounthistory", std::string("\"") + Params().GetConsensus().FundAddress + "\" '{\"type\": \"bindplotter\"}'")
+            + HelpExampleRpc("getaccounthistory", std::string("\"") + Params().GetConsensus().FundAddress + "\"")
         );
 
     if (!request.params[0].isStr())
@@ -1751,13 +2321,109 @@ static UniValue listpledgedebitofaddress(const JSONRPCRequest& request)
     if (accountID.IsNull())
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid address");
 
+    size_t count = std::numeric_limits<size_t>::max();
+    size_t skip = 0;
+    int nMinHeight = 0, nMaxHeight = std::numeric_limits<int>::max();
+    std::set<TxOutType> filters;
+    if (request.params.size() >= 2 && !request.params[1].isNull()) {
+        const UniValue& options = request.params[1].get_obj();
+        RPCTypeCheckObj(options,
+            {
+                {"count", UniValueType(UniValue::VNUM)},
+                {"skip", UniValueType(UniValue::VNUM)},
+                {"min_height", UniValueType(UniValue::VNUM)},
+                {"max_height", UniValueType(UniValue::VNUM)},
+                {"type", UniValueType(UniValue::VSTR)},
+            },
+            true, true);
+        if (!options["count"].isNull()) {
+            if (options["count"].get_int() <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count");
+            count = (size_t) options["count"].get_int();
+        }
+        if (!options["skip"].isNull()) {
+            if (options["skip"].get_int() < 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid skip");
+            skip = (size_t) options["skip"].get_int();
+        }
+        if (!options["min_height"].isNull())
+            nMinHeight = options["min_height"].get_int();
+        if (!options["max_height"].isNull())
+            nMaxHeight = options["max_height"].get_int();
+        if (!options["type"].isNull()) {
+            const std::string& type = options["type"].get_str();
+            for (TxOutType payloadType : {TXOUT_TYPE_BINDPLOTTER, TXOUT_TYPE_POINT, TXOUT_TYPE_STAKING}) {
+                if (type == PayloadTypeName(payloadType))
+                    filters.insert(payloadType);
+            }
+            if (filters.empty())
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid type, expected bindplotter, point or staking");
+        }
+    }
+
+    EnsureAccountHistoryIndex();
+    std::vector<CAccountHistoryEntry> entries;
+    if (!g_accounthistoryindex->FindHistory(accountID, nMinHeight, nMaxHeight, filters, skip, count, entries))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read account history index");
+
     LOCK(cs_main);
+    UniValue ret(UniValue::VARR);
+    for (const CAccountHistoryEntry& entry : entries) {
+        UniValue item(UniValue::VOBJ);
+        item.pushKV("txid", entry.txid.GetHex());
+        if (const CBlockIndex* pindex = ::ChainActive()[entry.nHeight]) {
+            item.pushKV("blockhash", pindex->GetBlockHash().GetHex());
+            item.pushKV("blocktime", pindex->GetBlockTime());
+        }
+        item.pushKV("blockheight", entry.nHeight);
+        item.pushKV("amount", ValueFromAmount(entry.nDelta));
+        item.pushKV("balance", ValueFromAmount(entry.nBalance));
+        if (entry.payloadType != TXOUT_TYPE_UNKNOWN) {
+            item.pushKV("type", PayloadTypeName(entry.payloadType));
+            item.pushKV("spent", entry.fPayloadSpent);
+        }
+        ret.push_back(item);
+    }
 
-    CValidationState state;
-    if (!::ChainstateActive().FlushStateToDisk(Params(), state, FlushStateMode::ALWAYS)) {
-        throw JSONRPCError(RPC_DATABASE_ERROR, strprintf("Unable to flush state to disk (%s)\n", FormatStateMessage(state)));
+    return ret;
+}
+
+static UniValue getbalanceofheight(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getbalanceofheight \"address\" ( height )\n"
+            "\nReturns the confirmed balance of address after the block at height. Requires -accounthistoryindex.\n"
+            "\nArguments:\n"
+            "1. address             (string, required) The Qitcoin address\n"
+            "2. height              (numeric, optional) The block height. If not set then the current height\n"
+            "\nResult:\n"
+            "x.xxx                  (numeric) The balance in " + CURRENCY_UNIT + ".\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getbalanceofheight", std::string("\"") + Params().GetConsensus().FundAddress + "\" 1000")
+            + HelpExampleRpc("getbalanceofheight", std::string("\"") + Params().GetConsensus().FundAddress + "\", 1000")
+        );
+
+    if (!request.params[0].isStr())
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid address");
+    const CAccountID accountID = ExtractAccountID(DecodeDestination(request.params[0].get_str()));
+    if (accountID.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid address");
+
+    EnsureAccountHistoryIndex();
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = ::ChainActive().Height();
+        if (request.params.size() >= 2 && !request.params[1].isNull()) {
+            if (request.params[1].get_int() < 0 || request.params[1].get_int() > nHeight)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+            nHeight = request.params[1].get_int();
+        }
     }
-    return ListPoint(::ChainstateActive().CoinsDB().PointReceiveCursor(accountID));
+
+    return ValueFromAmount(g_accounthistoryindex->GetBalance(accountID, nHeight));
 }
 // clang-format off
 static const CRPCCommand commands[] =
@@ -1779,9 +2445,13 @@ static const CRPCCommand commands[] =
     { "wallet",             "generatetoaddress",            &generatetoaddress,             {"nblocks","address"} },
 #endif
     { "generating",         "generatetoprivkey",            &generatetoprivkey,             {"nblocks","privatekey"} },
+    { "generating",         "generateload",                 &generateload,                  {"privkey","options"} },
     { "mining",             "getactivebindplotteraddress",  &getactivebindplotteraddress,   {"plotterId"} },
     { "mining",             "getactivebindplotter",         &getactivebindplotter,          {"plotterId"} },
     { "mining",             "listbindplotterofaddress",     &listbindplotterofaddress,      {"address", "plotterId", "count", "verbose"} },
+    { "mining",             "listbindplotterhistory",       &listbindplotterhistory,        {"plotterId", "count"} },
+    { "mining",             "listbindplotterhistoryofaddress", &listbindplotterhistoryofaddress, {"address", "plotterId", "count"} },
+    { "mining",             "getbindplotterofheight",       &getbindplotterofheight,        {"plotterId", "height"} },
     { "mining",             "createbindplotterdata",        &createbindplotterdata,         {"address", "passphrase", "lastActiveHeight"} },
     { "mining",             "decodebindplotterdata",        &decodebindplotterdata,         { "hexdata"} },
     { "mining",             "verifybindplotterdata",        &verifybindplotterdata,         {"address", "hexdata"} },
@@ -1793,8 +2463,10 @@ static const CRPCCommand commands[] =
 #endif
     { "mining",             "getpledgeofaddress",           &getpledgeofaddress,            {"address", "plotterId", "verbose"} },
     { "mining",             "getplottermininginfo",         &getplottermininginfo,          {"plotterId", "verbose"} },
-    { "mining",             "listpledgeloanofaddress",      &listpledgeloanofaddress,       {"address"} },
-    { "mining",             "listpledgedebitofaddress",     &listpledgedebitofaddress,      {"address"} },
+    { "mining",             "listpledgeloanofaddress",      &listpledgeloanofaddress,       {"address","options"} },
+    { "mining",             "listpledgedebitofaddress",     &listpledgedebitofaddress,      {"address","options"} },
+    { "mining",             "getaccounthistory",            &getaccounthistory,             {"address","options"} },
+    { "mining",             "getbalanceofheight",           &getbalanceofheight,            {"address","height"} },
 };
 // clang-format on
 
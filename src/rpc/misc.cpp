@@ -11,10 +11,14 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/standard.h>
+#include <sync.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <util/validation.h>
+#include <validationinterface.h>
 
+#include <algorithm>
 #include <stdint.h>
 #include <tuple>
 #ifdef HAVE_MALLOC_INFO
@@ -398,6 +402,17 @@ static std::string RPCMallocInfo()
 }
 #endif
 
+static UniValue RPCPayloadMemoryInfo()
+{
+    const TxOutPayloadInternStats stats = GetTxOutPayloadInternStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("entries", uint64_t(stats.nEntries));
+    obj.pushKV("hits", stats.nHits);
+    obj.pushKV("misses", stats.nMisses);
+    obj.pushKV("usage", uint64_t(stats.nDynamicUsage));
+    return obj;
+}
+
 static UniValue getmemoryinfo(const JSONRPCRequest& request)
 {
     /* Please, avoid using the word "pool" here in the RPC interface or help,
@@ -420,6 +435,12 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"payloads\": {             (json object) Information about the decoded output payloads shared by equal outputs\n"
+            "    \"entries\": xxxxx,       (numeric) Number of distinct payloads tracked\n"
+            "    \"hits\": xxxxx,          (numeric) Number of decodes which shared a payload\n"
+            "    \"misses\": xxxxx,        (numeric) Number of decodes which made a new payload\n"
+            "    \"usage\": xxxxx,         (numeric) Estimated bytes of the tracked payloads\n"
             "  }\n"
             "}\n"
                     },
@@ -437,6 +458,7 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("payloads", RPCPayloadMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -535,6 +557,138 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue getlockstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getlockstats",
+                "\nReturns the time waited for and held locks per lock site, sampled by the lock contention profiler.\n"
+                "Every nth lock acquisition of each thread is timed, see -lockstats. Hold times include waiting on a condition\n"
+                "variable with the lock. Sites are sorted by the total wait time, highest first.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, /* default */ "false", "Clear the statistics after returning them"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"interval\": n,                (numeric) Every nth lock acquisition of a thread is timed, 0 when the profiler is disabled\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"name\": \"str\",            (string) The lock as written at the site, e.g. cs_main\n"
+            "      \"file\": \"str\",            (string) Source file of the site\n"
+            "      \"line\": n,                (numeric) Source line of the site\n"
+            "      \"samples\": n,             (numeric) Timed acquisitions\n"
+            "      \"contended\": n,           (numeric) Timed acquisitions that had to wait for the lock\n"
+            "      \"wait_us\": n,             (numeric) Total time waited for the lock in microseconds\n"
+            "      \"max_wait_us\": n,         (numeric) Longest wait for the lock in microseconds\n"
+            "      \"hold_us\": n,             (numeric) Total time the lock was held in microseconds\n"
+            "      \"max_hold_us\": n          (numeric) Longest time the lock was held in microseconds\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "true")
+            + HelpExampleRpc("getlockstats", "")
+                },
+            }.Check(request);
+
+    std::vector<LockSiteSummary> sites = GetLockStats();
+    if (!request.params[0].isNull() && request.params[0].get_bool())
+        ResetLockStats();
+    std::sort(sites.begin(), sites.end(), [](const LockSiteSummary& a, const LockSiteSummary& b) {
+        return a.nWaitMicros > b.nWaitMicros;
+    });
+
+    UniValue entries(UniValue::VARR);
+    for (const LockSiteSummary& site : sites) {
+        if (site.nSamples == 0)
+            continue;
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", site.name);
+        entry.pushKV("file", site.file);
+        entry.pushKV("line", site.line);
+        entry.pushKV("samples", site.nSamples);
+        entry.pushKV("contended", site.nContended);
+        entry.pushKV("wait_us", site.nWaitMicros);
+        entry.pushKV("max_wait_us", site.nMaxWaitMicros);
+        entry.pushKV("hold_us", site.nHoldMicros);
+        entry.pushKV("max_hold_us", site.nMaxHoldMicros);
+        entries.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("interval", g_lock_stats_interval.load());
+    result.pushKV("sites", entries);
+    return result;
+}
+
+static UniValue CallbackTimingsToJSON(const ValidationCallbackTimings& timings)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("calls", timings.nCalls);
+    obj.pushKV("total_us", timings.nTotalMicros);
+    obj.pushKV("max_us", timings.nMaxMicros);
+    return obj;
+}
+
+static UniValue getvalidationinterfacestats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getvalidationinterfacestats",
+                "\nReturns the time validation callbacks waited in their queues and the time the listeners took for them.\n"
+                "Listeners of the same type, e.g. all wallets, are added up. Listeners registered on their own thread have a queue of their own.\n",
+                {},
+                RPCResult{
+            "{\n"
+            "  \"queue_depth\": n,             (numeric) Callbacks pending in the queue of the scheduler thread\n"
+            "  \"queue_wait\": {               (json object) Time callbacks waited in that queue\n"
+            "    \"calls\": n,                 (numeric) Callbacks\n"
+            "    \"total_us\": n,              (numeric) Total time in microseconds\n"
+            "    \"max_us\": n                 (numeric) Longest time in microseconds\n"
+            "  },\n"
+            "  \"listeners\": [\n"
+            "    {\n"
+            "      \"name\": \"str\",            (string) Type of the listeners\n"
+            "      \"own_thread\": true|false,  (boolean) Whether the listeners are registered on their own thread\n"
+            "      \"queue_depth\": n,         (numeric, own thread only) Callbacks pending in the queues of the listeners\n"
+            "      \"queue_wait\": {...},      (json object, own thread only) Time callbacks waited in the queues of the listeners\n"
+            "      \"callbacks\": {            (json object) Time taken by the listeners for the callbacks by callback, e.g. \"block_connected\"\n"
+            "        \"name\": {...}, ...\n"
+            "      }\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getvalidationinterfacestats", "")
+            + HelpExampleRpc("getvalidationinterfacestats", "")
+                },
+            }.Check(request);
+
+    const ValidationInterfaceStats stats = GetMainSignals().GetStats();
+    UniValue listeners(UniValue::VARR);
+    for (const ValidationListenerStats& listener : stats.listeners) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", listener.name);
+        entry.pushKV("own_thread", listener.fOwnThread);
+        if (listener.fOwnThread) {
+            entry.pushKV("queue_depth", listener.nQueueDepth);
+            entry.pushKV("queue_wait", CallbackTimingsToJSON(listener.queueWait));
+        }
+        UniValue callbacks(UniValue::VOBJ);
+        for (size_t i = 0; i < VALIDATION_CALLBACK_COUNT; i++) {
+            if (listener.callbacks[i].nCalls > 0)
+                callbacks.pushKV(ValidationCallbackName(static_cast<ValidationCallback>(i)), CallbackTimingsToJSON(listener.callbacks[i]));
+        }
+        entry.pushKV("callbacks", callbacks);
+        listeners.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("queue_depth", stats.nQueueDepth);
+    result.pushKV("queue_wait", CallbackTimingsToJSON(stats.queueWait));
+    result.pushKV("listeners", listeners);
+    return result;
+}
+
 static UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -558,6 +712,8 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getlockstats",           &getlockstats,           {"reset"} },
+    { "control",            "getvalidationinterfacestats", &getvalidationinterfacestats, {} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
     { "util",               "deriveaddresses",        &deriveaddresses,        {"descriptor", "range"} },
@@ -194,6 +194,15 @@ static UniValue getrawtransaction(const JSONRPCRequest& request)
         f_txindex_ready = g_txindex->BlockUntilSyncedToCurrentChain();
     }
 
+    // Confirmed transactions with their witness are returned as read, without deserializing them
+    if (!fVerbose && f_txindex_ready && RPCSerializationFlags() == 0 && !mempool.exists(hash)) {
+        uint256 hash_block;
+        std::vector<unsigned char> raw_tx;
+        if (g_txindex->FindRawTx(hash, hash_block, raw_tx)) {
+            return HexStr(raw_tx.begin(), raw_tx.end());
+        }
+    }
+
     CTransactionRef tx;
     uint256 hash_block;
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hash_block, blockindex)) {
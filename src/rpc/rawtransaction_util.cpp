@@ -290,7 +290,23 @@ UniValue SignTransaction(CMutableTransaction& mtx, const SigningProvider* keysto
     // Use CTransaction for the constant parts of the
     // transaction to avoid rehashing.
     const CTransaction txConst(mtx);
-    // Sign what we can:
+    // Sign what we can, all inputs at once:
+    std::vector<SigningInput> inputs;
+    std::vector<SignatureData> sigdata;
+    for (unsigned int i = 0; i < mtx.vin.size(); i++) {
+        auto coin = coins.find(mtx.vin[i].prevout);
+        if (coin == coins.end() || coin->second.IsSpent()) {
+            continue;
+        }
+        // Only sign SIGHASH_SINGLE if there's a corresponding output:
+        if (!fHashSingle || (i < mtx.vout.size())) {
+            inputs.push_back({i, coin->second.out.scriptPubKey, coin->second.out.nValue, nHashType});
+            sigdata.push_back(DataFromTransaction(mtx, i, coin->second.out));
+        }
+    }
+    ProduceSignatures(*keystore, mtx, inputs, sigdata);
+
+    size_t nSigned = 0;
     for (unsigned int i = 0; i < mtx.vin.size(); i++) {
         CTxIn& txin = mtx.vin[i];
         auto coin = coins.find(txin.prevout);
@@ -301,14 +317,12 @@ UniValue SignTransaction(CMutableTransaction& mtx, const SigningProvider* keysto
         const CScript& prevPubKey = coin->second.out.scriptPubKey;
         const CAmount& amount = coin->second.out.nValue;
 
-        SignatureData sigdata = DataFromTransaction(mtx, i, coin->second.out);
-        // Only sign SIGHASH_SINGLE if there's a corresponding output:
-        if (!fHashSingle || (i < mtx.vout.size())) {
-            ProduceSignature(*keystore, MutableTransactionSignatureCreator(&mtx, i, amount, nHashType), prevPubKey, sigdata);
+        if (nSigned < inputs.size() && inputs[nSigned].nIn == i) {
+            UpdateInput(txin, sigdata[nSigned++]);
+        } else {
+            UpdateInput(txin, DataFromTransaction(mtx, i, coin->second.out));
         }
 
-        UpdateInput(txin, sigdata);
-
         // amount must be specified for valid segwit signature
         if (amount == MAX_MONEY && !txin.scriptWitness.IsNull()) {
             throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Missing amount for %s", coin->second.out.ToString()));
@@ -5,15 +5,20 @@
 
 #include <rpc/server.h>
 
+#include <checkqueue.h>
 #include <fs.h>
+#include <httpserver.h>
 #include <key_io.h>
+#include <rpc/cache.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 
 #include <boost/signals2/signal.hpp>
+#include <boost/thread.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
@@ -207,6 +212,24 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
             "    \"duration\"     (numeric)  The running time in microseconds\n"
             "   },...\n"
             "  ],\n"
+            " \"work_queues\"    (object) HTTP work queue lanes, \"priority\" for mining requests and \"normal\"\n"
+            "  {\n"
+            "   \"priority|normal\": {\n"
+            "    \"requests\"     (numeric) Requests taken by workers\n"
+            "    \"rejected\"     (numeric) Requests rejected because the work queue depth was exceeded\n"
+            "    \"depth\"        (numeric) Requests currently waiting\n"
+            "    \"avg_wait\"     (numeric) Average time requests waited in microseconds\n"
+            "    \"max_wait\"     (numeric) Maximum time a request waited in microseconds\n"
+            "   }\n"
+            "  },\n"
+            " \"response_cache\"  (object) Cache of responses about deeply confirmed blocks and transactions, see -rpccachesize\n"
+            "  {\n"
+            "   \"entries\"        (numeric) Cached responses\n"
+            "   \"usage\"          (numeric) Approximate memory of the cached responses in bytes\n"
+            "   \"max_usage\"      (numeric) Maximum memory of the cached responses in bytes, 0 if disabled\n"
+            "   \"hits\"           (numeric) Requests answered from the cache\n"
+            "   \"misses\"         (numeric) Cacheable requests not found in the cache\n"
+            "  },\n"
             " \"logpath\": \"xxx\" (string) The complete file path to the debug log\n"
             "}\n"
                 },
@@ -227,6 +250,30 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
     UniValue result(UniValue::VOBJ);
     result.pushKV("active_commands", active_commands);
 
+    UniValue work_queues(UniValue::VOBJ);
+    for (bool priority : {true, false}) {
+        HTTPWorkQueueStats stats;
+        if (!GetHTTPWorkQueueStats(priority, stats))
+            continue;
+        UniValue lane(UniValue::VOBJ);
+        lane.pushKV("requests", stats.nRequests);
+        lane.pushKV("rejected", stats.nRejected);
+        lane.pushKV("depth", (uint64_t) stats.nDepth);
+        lane.pushKV("avg_wait", stats.nRequests == 0 ? 0 : stats.nTotalWaitMicros / (int64_t) stats.nRequests);
+        lane.pushKV("max_wait", stats.nMaxWaitMicros);
+        work_queues.pushKV(priority ? "priority" : "normal", lane);
+    }
+    result.pushKV("work_queues", work_queues);
+
+    const RPCCacheStats cache_stats = GetRPCCacheStats();
+    UniValue response_cache(UniValue::VOBJ);
+    response_cache.pushKV("entries", (uint64_t) cache_stats.nEntries);
+    response_cache.pushKV("usage", (uint64_t) cache_stats.nUsage);
+    response_cache.pushKV("max_usage", (uint64_t) cache_stats.nMaxUsage);
+    response_cache.pushKV("hits", cache_stats.nHits);
+    response_cache.pushKV("misses", cache_stats.nMisses);
+    result.pushKV("response_cache", response_cache);
+
     const std::string path = LogInstance().m_file_path.string();
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
@@ -280,9 +327,57 @@ bool CRPCTable::removeCommand(const std::string& name, const CRPCCommand* pcmd)
     return false;
 }
 
+/** One entry of a JSON-RPC batch, run on the batch threads */
+class CRPCBatchCheck
+{
+private:
+    const JSONRPCRequest* jreq;
+    const UniValue* req;
+    UniValue* result;
+
+public:
+    CRPCBatchCheck() : jreq(nullptr), req(nullptr), result(nullptr) {}
+    CRPCBatchCheck(const JSONRPCRequest* jreqIn, const UniValue* reqIn, UniValue* resultIn) :
+        jreq(jreqIn), req(reqIn), result(resultIn) {}
+
+    bool operator()();
+
+    void swap(CRPCBatchCheck& check) {
+        std::swap(jreq, check.jreq);
+        std::swap(req, check.req);
+        std::swap(result, check.result);
+    }
+};
+
+static CCheckQueue<CRPCBatchCheck> rpcbatchqueue(1);
+static boost::thread_group threadGroupRPCBatch;
+static int nRPCBatchThreads = 0;
+static int nRPCBatchLimit = DEFAULT_RPC_BATCH_LIMIT;
+
+static void ThreadRPCBatch(int worker_num)
+{
+    util::ThreadRename(strprintf("rpcbatch.%i", worker_num));
+    rpcbatchqueue.Thread();
+}
+
 void StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
+    nRPCBatchLimit = gArgs.GetArg("-rpcbatchlimit", DEFAULT_RPC_BATCH_LIMIT);
+    nRPCBatchThreads = std::min((int) gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), MAX_RPC_BATCH_THREADS);
+    if (nRPCBatchThreads <= 1)
+        nRPCBatchThreads = 0;
+    const int64_t nRPCCacheSize = std::max<int64_t>(gArgs.GetArg("-rpccachesize", DEFAULT_RPC_CACHE_SIZE), 0);
+    if (nRPCCacheSize > 0)
+        LogPrintf("RPC response cache of %d MiB\n", nRPCCacheSize);
+    InitRPCCache((size_t) nRPCCacheSize << 20);
+    if (nRPCBatchThreads > 0) {
+        LogPrintf("RPC batch thread pool with %d threads\n", nRPCBatchThreads);
+        // The thread serving the batch runs entries too
+        for (int i = 0; i < nRPCBatchThreads - 1; i++) {
+            threadGroupRPCBatch.create_thread(std::bind(&ThreadRPCBatch, i));
+        }
+    }
     g_rpc_running = true;
     g_rpcSignals.Started();
 }
@@ -297,6 +392,10 @@ void InterruptRPC()
 void StopRPC()
 {
     LogPrint(BCLog::RPC, "Stopping RPC\n");
+    threadGroupRPCBatch.interrupt_all();
+    threadGroupRPCBatch.join_all();
+    nRPCBatchThreads = 0;
+    InitRPCCache(0);
     deadlineTimers.clear();
     DeleteAuthCookie();
     g_rpcSignals.Stopped();
@@ -358,11 +457,35 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
+bool CRPCBatchCheck::operator()()
+{
+    *result = JSONRPCExecOne(*jreq, *req);
+    return true;
+}
+
 std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
 {
+    if (nRPCBatchLimit > 0 && vReq.size() > (size_t) nRPCBatchLimit)
+        throw JSONRPCError(RPC_INVALID_REQUEST, strprintf("Batch of %u requests exceeds -rpcbatchlimit=%d", vReq.size(), nRPCBatchLimit));
+
+    // Replies are kept in request order whether entries run in parallel or not
+    std::vector<UniValue> vResults(vReq.size());
+    if (nRPCBatchThreads > 0 && vReq.size() > 1) {
+        std::vector<CRPCBatchCheck> vChecks;
+        vChecks.reserve(vReq.size());
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            vChecks.emplace_back(&jreq, &vReq[reqIdx], &vResults[reqIdx]);
+        CCheckQueueControl<CRPCBatchCheck> control(&rpcbatchqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            vResults[reqIdx] = JSONRPCExecOne(jreq, vReq[reqIdx]);
+    }
+
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    for (UniValue& result : vResults)
+        ret.push_back(std::move(result));
 
     return ret.write() + "\n";
 }
@@ -433,8 +556,11 @@ UniValue CRPCTable::execute(const JSONRPCRequest &request) const
     auto it = mapCommands.find(request.strMethod);
     if (it != mapCommands.end()) {
         UniValue result;
+        if (RPCCacheLookup(request, result))
+            return result;
         for (const auto& command : it->second) {
             if (ExecuteCommand(*command, request, result, &command == &it->second.back())) {
+                RPCCacheInsert(request, result);
                 return result;
             }
         }
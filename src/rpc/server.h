@@ -19,6 +19,11 @@
 #include <univalue.h>
 
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
+//! Threads running the entries of a JSON-RPC batch in parallel, 0 runs them in order on the calling thread
+static const int DEFAULT_RPC_BATCH_THREADS = 0;
+static const int MAX_RPC_BATCH_THREADS = 64;
+//! Maximum number of entries of a JSON-RPC batch, 0 for no limit
+static const int DEFAULT_RPC_BATCH_LIMIT = 0;
 
 class CRPCCommand;
 
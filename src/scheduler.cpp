@@ -10,7 +10,7 @@
 #include <assert.h>
 #include <utility>
 
-CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
+CScheduler::CScheduler() : nNextTaskId(1), nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
 {
 }
 
@@ -72,15 +72,24 @@ void CScheduler::serviceQueue()
             if (shouldStop() || taskQueue.empty())
                 continue;
 
-            Function f = taskQueue.begin()->second;
+            const TaskId id = taskQueue.begin()->second.first;
+            Function f = std::move(taskQueue.begin()->second.second);
             taskQueue.erase(taskQueue.begin());
+            mapTaskIds.erase(id);
+            setRunningIds.insert(id);
 
-            {
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
                 f();
+            } catch (...) {
+                setRunningIds.erase(setRunningIds.find(id));
+                throw;
             }
+            setRunningIds.erase(setRunningIds.find(id));
+            if (!setRunningIds.count(id))
+                setCancelledIds.erase(id);
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -102,29 +111,70 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::scheduleLocked(TaskId id, CScheduler::Function f, boost::chrono::system_clock::time_point t)
 {
+    mapTaskIds[id] = taskQueue.insert(std::make_pair(t, std::make_pair(id, std::move(f))));
+}
+
+CScheduler::TaskId CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+{
+    TaskId id;
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        id = nNextTaskId++;
+        scheduleLocked(id, std::move(f), t);
     }
     newTaskScheduled.notify_one();
+    return id;
+}
+
+CScheduler::TaskId CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+{
+    return schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::reschedule(TaskId id, CScheduler::Function f, int64_t deltaMilliSeconds)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    {
+        boost::unique_lock<boost::mutex> lock(newTaskMutex);
+        if (setCancelledIds.count(id))
+            return;
+        scheduleLocked(id, std::move(f), boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    }
+    newTaskScheduled.notify_one();
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::Repeat(CScheduler* s, TaskId id, CScheduler::Function f, int64_t deltaMilliSeconds)
 {
     f();
-    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->reschedule(id, std::bind(&CScheduler::Repeat, s, id, f, deltaMilliSeconds), deltaMilliSeconds);
+}
+
+CScheduler::TaskId CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+{
+    TaskId id;
+    {
+        boost::unique_lock<boost::mutex> lock(newTaskMutex);
+        id = nNextTaskId++;
+        scheduleLocked(id, std::bind(&CScheduler::Repeat, this, id, f, deltaMilliSeconds),
+            boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    }
+    newTaskScheduled.notify_one();
+    return id;
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+bool CScheduler::unschedule(TaskId id)
 {
-    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    boost::unique_lock<boost::mutex> lock(newTaskMutex);
+    auto it = mapTaskIds.find(id);
+    if (it != mapTaskIds.end()) {
+        taskQueue.erase(it->second);
+        mapTaskIds.erase(it);
+        return true;
+    }
+    if (setRunningIds.count(id))
+        return setCancelledIds.insert(id).second;
+    return false;
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
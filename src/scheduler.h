@@ -13,9 +13,16 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <set>
+#include <unordered_map>
 
 #include <sync.h>
 
+/** Default for -schedulerthreads */
+static const int DEFAULT_SCHEDULER_THREADS = 1;
+/** Maximum number of scheduler service threads */
+static const int MAX_SCHEDULER_THREADS = 8;
+
 //
 // Simple class for background tasks that should be run
 // periodically or once "after a while"
@@ -41,21 +48,26 @@ public:
     ~CScheduler();
 
     typedef std::function<void()> Function;
+    // Identifies a scheduled task, and all runs of a repeating one, for unschedule
+    typedef uint64_t TaskId;
 
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now());
+    TaskId schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now());
 
     // Convenience method: call f once deltaMilliSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    TaskId scheduleFromNow(Function f, int64_t deltaMilliSeconds);
 
     // Another convenience method: call f approximately
     // every deltaMilliSeconds forever, starting deltaMilliSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaMilliSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    TaskId scheduleEvery(Function f, int64_t deltaMilliSeconds);
 
-    // To keep things as simple as possible, there is no unschedule.
+    // Remove a task from the queue. A repeating task that is running
+    // at the time finishes that run, and is not rescheduled.
+    // Returns false if the task already finished or was unscheduled.
+    bool unschedule(TaskId id);
 
     // Services the queue 'forever'. Should be run in a thread,
     // and interrupted using boost::interrupt_thread
@@ -75,13 +87,26 @@ public:
     bool AreThreadsServicingQueue() const;
 
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    typedef std::multimap<boost::chrono::system_clock::time_point, std::pair<TaskId, Function>> TaskQueue;
+    TaskQueue taskQueue;
+    // Queued tasks by id, so that they are unscheduled without a search of the queue
+    std::unordered_map<TaskId, TaskQueue::iterator> mapTaskIds;
+    // Ids of the repeating tasks being run, and of those among them unscheduled meanwhile
+    std::multiset<TaskId> setRunningIds;
+    std::set<TaskId> setCancelledIds;
+    TaskId nNextTaskId;
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
     bool shouldStop() const { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+
+    // Queue a task under an id, requires newTaskMutex
+    void scheduleLocked(TaskId id, Function f, boost::chrono::system_clock::time_point t);
+    // Queue the next run of a repeating task, unless it was unscheduled while running
+    void reschedule(TaskId id, Function f, int64_t deltaMilliSeconds);
+    static void Repeat(CScheduler* s, TaskId id, Function f, int64_t deltaMilliSeconds);
 };
 
 /**
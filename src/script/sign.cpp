@@ -11,9 +11,18 @@
 #include <script/signingprovider.h>
 #include <script/standard.h>
 #include <uint256.h>
+#include <util/system.h>
+
+#include <atomic>
+#include <thread>
 
 typedef std::vector<unsigned char> valtype;
 
+//! Fewest inputs each thread signing a transaction gets
+static const size_t MIN_INPUTS_PER_SIGNING_THREAD = 16;
+//! Most threads signing one transaction
+static const int MAX_SIGNING_THREADS = 8;
+
 MutableTransactionSignatureCreator::MutableTransactionSignatureCreator(const CMutableTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, int nHashTypeIn) : txTo(txToIn), nIn(nInIn), nHashType(nHashTypeIn), amount(amountIn), checker(txTo, nIn, amountIn) {}
 
 bool MutableTransactionSignatureCreator::CreateSig(const SigningProvider& provider, std::vector<unsigned char>& vchSig, const CKeyID& address, const CScript& scriptCode, SigVersion sigversion) const
@@ -343,6 +352,31 @@ SignatureData DataFromTransaction(const CMutableTransaction& tx, unsigned int nI
     return data;
 }
 
+void ProduceSignatures(const SigningProvider& provider, const CMutableTransaction& tx, const std::vector<SigningInput>& inputs, std::vector<SignatureData>& sigdata)
+{
+    assert(sigdata.size() == inputs.size());
+
+    // Key origins only matter to PSBTs, and wallets look them up under locks the caller may hold
+    const HidingSigningProvider signing_provider(&provider, false, true);
+    std::atomic<size_t> next{0};
+    auto sign = [&]() {
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            const SigningInput& input = inputs[i];
+            ProduceSignature(signing_provider, MutableTransactionSignatureCreator(&tx, input.nIn, input.amount, input.nHashType), input.scriptPubKey, sigdata[i]);
+        }
+    };
+
+    const int threads = std::min({MAX_SIGNING_THREADS, GetNumCores(), (int) (inputs.size() / MIN_INPUTS_PER_SIGNING_THREAD)});
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back(sign);
+    }
+    sign();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
 void UpdateInput(CTxIn& input, const SignatureData& data)
 {
     input.scriptSig = data.scriptSig;
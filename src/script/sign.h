@@ -152,6 +152,23 @@ void SerializeHDKeypaths(Stream& s, const std::map<CPubKey, KeyOriginInfo>& hd_k
 /** Produce a script signature using a generic signature creator. */
 bool ProduceSignature(const SigningProvider& provider, const BaseSignatureCreator& creator, const CScript& scriptPubKey, SignatureData& sigdata);
 
+/** An input of a transaction to sign with ProduceSignatures */
+struct SigningInput
+{
+    unsigned int nIn;
+    CScript scriptPubKey;
+    CAmount amount;
+    int nHashType;
+};
+
+/**
+ * Produce the script signatures of several inputs of a transaction into the matching entries of sigdata, which may
+ * come prefilled. Transactions with many inputs are signed on several threads, so the provider must be usable from
+ * other threads while the caller waits. Key origins are never looked up, which keeps the results the same however
+ * the inputs are spread.
+ */
+void ProduceSignatures(const SigningProvider& provider, const CMutableTransaction& tx, const std::vector<SigningInput>& inputs, std::vector<SignatureData>& sigdata);
+
 /** Produce a script signature for a transaction. */
 bool SignSignature(const SigningProvider &provider, const CScript& fromPubKey, CMutableTransaction& txTo, unsigned int nIn, const CAmount& amount, int nHashType);
 bool SignSignature(const SigningProvider &provider, const CTransaction& txFrom, CMutableTransaction& txTo, unsigned int nIn, int nHashType);
@@ -7,12 +7,17 @@
 
 #include <key_io.h>
 #include <crypto/sha256.h>
+#include <memusage.h>
 #include <poc/poc.h>
 #include <pos/pos.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <sync.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <tuple>
+
 typedef std::vector<unsigned char> valtype;
 
 bool fAcceptDatacarrier = DEFAULT_ACCEPT_DATACARRIER;
@@ -734,7 +739,139 @@ CScript CreateStakePendingCoinPayload(const uint256 &epochHash)
     return script;
 }
 
-CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std::set<TxOutType> &filters, bool for_test, std::map<std::string,std::string> *pinfo)
+/** Read the PoC plotter signature of a bind plotter output, without verifying it. */
+static bool ReadBindPlotterSignature(const CTxOut& txout, poc::SignatureCheck& check)
+{
+    if (txout.payload.size() <= PROTOCOL_BINDPLOTTER_POC_SCRIPTSIZE || txout.payload[0] != 0x04 || txout.nValue < PROTOCOL_BINDPLOTTER_LOCKAMOUNT)
+        return false;
+
+    CScript::const_iterator pc = txout.payload.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> vData;
+    if (!txout.payload.GetOp(pc, opcode, vData) || opcode != 0x04)
+        return false;
+    unsigned int type = (vData[0] << 0) | (vData[1] << 8) | (vData[2] << 16) | (vData[3] << 24);
+    if (type != TXOUT_TYPE_BINDPLOTTER)
+        return false;
+
+    CTxDestination dest;
+    if (!ExtractDestination(txout.scriptPubKey, dest))
+        return false;
+    const ScriptHash *scriptID = boost::get<ScriptHash>(&dest);
+    if (scriptID == nullptr)
+        return false;
+
+    if (!txout.payload.GetOp(pc, opcode, vData) || opcode != sizeof(uint32_t))
+        return false;
+    uint32_t lastActiveHeight = (((uint32_t)vData[0]) >> 0) | (((uint32_t)vData[1]) << 8) | (((uint32_t)vData[2]) << 16) | (((uint32_t)vData[3]) << 24);
+
+    std::vector<unsigned char> vPlotterPublicKey, vPlotterSignature;
+    if (!txout.payload.GetOp(pc, opcode, vPlotterPublicKey) || vPlotterPublicKey.size() != 0x20)
+        return false;
+    if (!txout.payload.GetOp(pc, opcode, vPlotterSignature) || vPlotterSignature.size() != 0x40)
+        return false;
+
+    CSHA256().
+        Write(ToByteVector((uint32_t) lastActiveHeight).data(), 4).
+        Write(scriptID->begin(), CScriptID::WIDTH).
+        Write(bindPlotterSalt, sizeof(bindPlotterSalt)).
+        Finalize(check.data);
+    memcpy(check.publicKey, vPlotterPublicKey.data(), 32);
+    memcpy(check.signature, vPlotterSignature.data(), 64);
+    return true;
+}
+
+void PreverifyBindPlotterSignatures(const std::vector<CTransactionRef>& vtx)
+{
+    std::vector<poc::SignatureCheck> checks;
+    for (const CTransactionRef& tx : vtx) {
+        for (const CTxOut& txout : tx->vout) {
+            poc::SignatureCheck check;
+            if (ReadBindPlotterSignature(txout, check))
+                checks.push_back(check);
+        }
+    }
+    // A single signature is not cheaper in a batch
+    if (checks.size() > 1)
+        poc::VerifyBatch(checks);
+}
+
+namespace {
+/** The decoded payloads alive, by value. Expired entries are swept once the map doubled since the last sweep */
+class CTxOutPayloadInterner
+{
+public:
+    //! Type, plotter id and type, receiver, lock blocks and amount
+    typedef std::tuple<unsigned int, uint64_t, CAccountID, uint32_t, CAmount> Key;
+
+private:
+    mutable Mutex m_mutex;
+    std::map<Key, std::weak_ptr<TxOutPayload>> m_payloads GUARDED_BY(m_mutex);
+    size_t m_sweep_at GUARDED_BY(m_mutex) = 1024;
+    uint64_t m_hits GUARDED_BY(m_mutex) = 0;
+    uint64_t m_misses GUARDED_BY(m_mutex) = 0;
+
+public:
+    //! The payload of the key, made by init if none is alive
+    template <typename T, typename Init>
+    CTxOutPayloadRef Get(const Key& key, Init init)
+    {
+        LOCK(m_mutex);
+        auto it = m_payloads.find(key);
+        if (it != m_payloads.end()) {
+            if (CTxOutPayloadRef payload = it->second.lock()) {
+                m_hits++;
+                return payload;
+            }
+        }
+        m_misses++;
+
+        std::shared_ptr<T> payload = std::make_shared<T>();
+        init(*payload);
+        if (it != m_payloads.end()) {
+            it->second = payload;
+        } else {
+            if (m_payloads.size() >= m_sweep_at) {
+                for (auto itSweep = m_payloads.begin(); itSweep != m_payloads.end(); ) {
+                    if (itSweep->second.expired())
+                        itSweep = m_payloads.erase(itSweep);
+                    else
+                        itSweep++;
+                }
+                m_sweep_at = std::max<size_t>(1024, m_payloads.size() * 2);
+            }
+            m_payloads.emplace(key, payload);
+        }
+        return payload;
+    }
+
+    TxOutPayloadInternStats GetStats() const
+    {
+        LOCK(m_mutex);
+        TxOutPayloadInternStats stats;
+        stats.nEntries = m_payloads.size();
+        stats.nHits = m_hits;
+        stats.nMisses = m_misses;
+        // The entries, and the payloads held by them with their control blocks
+        stats.nDynamicUsage = memusage::DynamicUsage(m_payloads) +
+            m_payloads.size() * memusage::MallocUsage(sizeof(StakingPayload) + 2 * sizeof(long));
+        return stats;
+    }
+};
+
+CTxOutPayloadInterner& GetTxOutPayloadInterner()
+{
+    static CTxOutPayloadInterner interner;
+    return interner;
+}
+} // namespace
+
+TxOutPayloadInternStats GetTxOutPayloadInternStats()
+{
+    return GetTxOutPayloadInterner().GetStats();
+}
+
+CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std::set<TxOutType> &filters, bool for_test, std::map<std::string,std::string> *pinfo, bool fVerifySignatures)
 {
     // 0x04 <Protocol> <...>
     if (txout.payload.size() < 6 || txout.payload[0] != 0x04)
@@ -799,7 +936,7 @@ CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std
                 if (!txout.payload.GetOp(pc, opcode, vPlotterSignature) || vPlotterSignature.size() != 0x40)
                     return nullptr;
 
-                if (!poc::Verify(&vPlotterPublicKey[0], unsignDataHash.begin(), &vPlotterSignature[0]))
+                if (fVerifySignatures && !poc::Verify(&vPlotterPublicKey[0], unsignDataHash.begin(), &vPlotterSignature[0]))
                     return nullptr;
 
                 plotterId = poc::ToPlotterId(&vPlotterPublicKey[0]);
@@ -812,7 +949,7 @@ CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std
                 if (!txout.payload.GetOp(pc, opcode, vPlotterSignature)  || vPlotterSignature.size() != bls::G2Element::SIZE)
                     return nullptr;
 
-                bool fVerified = bls::AugSchemeMPL().Verify(
+                bool fVerified = !fVerifySignatures || bls::AugSchemeMPL().Verify(
                     bls::G1Element::FromByteVector(vPlotterPublicKey),
                     std::vector<uint8_t>(unsignDataHash.begin(), unsignDataHash.end()),
                     bls::G2Element::FromByteVector(vPlotterSignature));
@@ -840,16 +977,19 @@ CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std
                 return nullptr;
             if (ExtractAccountID(pubkey) != *scriptID)
                 return nullptr;
-            if (!pubkey.Verify(unsignDataHash, vSignature))
+            if (fVerifySignatures && !pubkey.Verify(unsignDataHash, vSignature))
                 return nullptr;
         }
 
-        std::shared_ptr<BindPlotterPayload> payload = std::make_shared<BindPlotterPayload>();
-        payload->id = plotterId;
-        payload->eType = eType;
+        CTxOutPayloadRef payload = GetTxOutPayloadInterner().Get<BindPlotterPayload>(
+            CTxOutPayloadInterner::Key(type, plotterId, CAccountID(), (uint32_t) eType, 0),
+            [&](BindPlotterPayload& bindPayload) {
+                bindPayload.id = plotterId;
+                bindPayload.eType = eType;
+            });
 
         if (pinfo != nullptr) {
-            pinfo->insert(std::make_pair("type", payload->GetTypeName()));
+            pinfo->insert(std::make_pair("type", BindPlotterPayload::As(payload)->GetTypeName()));
             pinfo->insert(std::make_pair("pubkey", HexStr(vPlotterPublicKey)));
         }
 
@@ -870,13 +1010,17 @@ CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std
             return nullptr;
         lockBlocks = (((uint32_t)vData[0]) >> 0) | (((uint32_t)vData[1]) << 8) | (((uint32_t)vData[2]) << 16) | (((uint32_t)vData[3]) << 24);
 
-        std::shared_ptr<PointPayload> payload = std::make_shared<PointPayload>();
-        payload->receiverID = CAccountID(receiverID);
-        payload->lockBlocks = lockBlocks;
-        payload->amount = GetPointAmount(txout.nValue, (int) lockBlocks);
-        if (payload->GetReceiverID().IsNull() || payload->amount == 0)
+        const CAccountID receiverAccountID(receiverID);
+        const CAmount amount = GetPointAmount(txout.nValue, (int) lockBlocks);
+        if (receiverAccountID.IsNull() || amount == 0)
             return nullptr;
-        return payload;
+        return GetTxOutPayloadInterner().Get<PointPayload>(
+            CTxOutPayloadInterner::Key(type, 0, receiverAccountID, lockBlocks, amount),
+            [&](PointPayload& payload) {
+                payload.receiverID = receiverAccountID;
+                payload.lockBlocks = lockBlocks;
+                payload.amount = amount;
+            });
     } else if (type == TXOUT_TYPE_STAKING) {
         // Staking
         if (txout.nValue < PROTOCOL_STAKING_AMOUNT_MIN || txout.payload.size() != PROTOCOL_STAKING_SCRIPTSIZE)
@@ -893,13 +1037,17 @@ CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight, const std
             return nullptr;
         lockBlocks = (((uint32_t)vData[0]) >> 0) | (((uint32_t)vData[1]) << 8) | (((uint32_t)vData[2]) << 16) | (((uint32_t)vData[3]) << 24);
 
-        std::shared_ptr<StakingPayload> payload = std::make_shared<StakingPayload>();
-        payload->receiverID = CAccountID(receiverID);
-        payload->lockBlocks = lockBlocks;
-        payload->amount = GetStakingAmount(txout.nValue, (int) lockBlocks);
-        if (payload->GetReceiverID().IsNull() || payload->amount == 0)
+        const CAccountID receiverAccountID(receiverID);
+        const CAmount amount = GetStakingAmount(txout.nValue, (int) lockBlocks);
+        if (receiverAccountID.IsNull() || amount == 0)
             return nullptr;
-        return payload;
+        return GetTxOutPayloadInterner().Get<StakingPayload>(
+            CTxOutPayloadInterner::Key(type, 0, receiverAccountID, lockBlocks, amount),
+            [&](StakingPayload& payload) {
+                payload.receiverID = receiverAccountID;
+                payload.lockBlocks = lockBlocks;
+                payload.amount = amount;
+            });
     }
 
     return nullptr;
@@ -418,7 +418,25 @@ COutPoint CreateStakePendingCoinOutPoint(const uint256 &epochHash, const CAccoun
 
 CScript CreateStakePendingCoinPayload(const uint256 &epochHash);
 
-/** Parse transaction output payload. */
-CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight = 0, const std::set<TxOutType>& filters = {}, bool for_test = false, std::map<std::string,std::string> *pinfo = nullptr);
+/**
+ * Parse transaction output payload. Skips the signature checks of a bind plotter payload if fVerifySignatures is false, for outputs verified
+ * before. Decoded payloads are immutable and interned: outputs with equal payloads, e.g. the points to a pool for the same lock and amount,
+ * share one object in the coins cache, the mempool and the wallet.
+ */
+CTxOutPayloadRef ExtractTxoutPayload(const CTxOut& txout, int nHeight = 0, const std::set<TxOutType>& filters = {}, bool for_test = false, std::map<std::string,std::string> *pinfo = nullptr,
+    bool fVerifySignatures = true);
+
+/** Statistics of the decoded payloads shared by the outputs with equal payloads, see ExtractTxoutPayload() */
+struct TxOutPayloadInternStats
+{
+    size_t nEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+    size_t nDynamicUsage;
+};
+TxOutPayloadInternStats GetTxOutPayloadInternStats();
+
+/** Verify the PoC plotter signatures of the bind plotter outputs of transactions at once, so that parsing their payloads afterwards does not verify them one by one. */
+void PreverifyBindPlotterSignatures(const std::vector<CTransactionRef>& vtx);
 
 #endif // BITCOIN_SCRIPT_STANDARD_H
@@ -643,6 +643,33 @@ template <typename Stream>
 template<size_t N, typename T, typename A>
 LimitedVector<T, A, N> WrapLimitedVector(std::vector<T, A>& v) { return LimitedVector<T, A, N>(v); }
 
+/**
+ * size limit prevector, serialized like LimitedVector
+ */
+template<typename T, unsigned int M, size_t N>
+class LimitedPrevector
+{
+protected:
+    prevector<M, T>& v;
+public:
+    explicit LimitedPrevector(prevector<M, T>& _v) : v(_v) {}
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        ::Unserialize(s, v);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ::Serialize(s, v);
+    }
+};
+
+template<size_t N, typename T, unsigned int M>
+LimitedPrevector<T, M, N> WrapLimitedVector(prevector<M, T>& v) { return LimitedPrevector<T, M, N>(v); }
+
 
 
 /**
@@ -14,10 +14,13 @@
 #include <util/threadnames.h>
 
 #include <stdio.h>
+#include <string.h>
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
+#include <tuple>
 
 #ifdef DEBUG_LOCKCONTENTION
 #if !defined(HAVE_THREAD_LOCAL)
@@ -30,6 +33,107 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<int> g_lock_stats_interval{DEFAULT_LOCK_STATS_INTERVAL};
+
+static void UpdateMax(std::atomic<int64_t>& nMax, int64_t nValue)
+{
+    int64_t nPrev = nMax.load(std::memory_order_relaxed);
+    while (nValue > nPrev && !nMax.compare_exchange_weak(nPrev, nValue, std::memory_order_relaxed)) {}
+}
+
+void LockSiteStats::AddWait(int64_t nMicros, bool fContended)
+{
+    nSamples.fetch_add(1, std::memory_order_relaxed);
+    if (fContended)
+        nContended.fetch_add(1, std::memory_order_relaxed);
+    nWaitMicros.fetch_add(nMicros, std::memory_order_relaxed);
+    UpdateMax(nMaxWaitMicros, nMicros);
+}
+
+void LockSiteStats::AddHold(int64_t nMicros)
+{
+    nHoldMicros.fetch_add(nMicros, std::memory_order_relaxed);
+    UpdateMax(nMaxHoldMicros, nMicros);
+}
+
+namespace {
+
+//! Orders lock sites by file name and line, the same file may be compiled into several string literals
+struct LockSiteLess {
+    bool operator()(const std::pair<const char*, int>& a, const std::pair<const char*, int>& b) const
+    {
+        int nCmp = strcmp(a.first, b.first);
+        return nCmp < 0 || (nCmp == 0 && a.second < b.second);
+    }
+};
+
+struct LockStatsData {
+    //! Only taken by timed acquisitions. Entries are never removed, locks in flight keep pointers to them
+    std::mutex mutex;
+    std::map<std::pair<const char*, int>, LockSiteStats, LockSiteLess> sites;
+};
+
+LockStatsData& GetLockStatsData()
+{
+    // Leaked on purpose, locks may still be taken by global destructors
+    static LockStatsData& data = *new LockStatsData();
+    return data;
+}
+
+thread_local unsigned int g_lock_stats_counter = 0;
+
+} // namespace
+
+LockSiteStats* SampleLockSite(const char* pszName, const char* pszFile, int nLine)
+{
+    const int nInterval = g_lock_stats_interval.load(std::memory_order_relaxed);
+    if (nInterval <= 0 || ++g_lock_stats_counter % nInterval != 0)
+        return nullptr;
+
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    auto it = data.sites.find(std::make_pair(pszFile, nLine));
+    if (it == data.sites.end())
+        it = data.sites.emplace(std::piecewise_construct, std::forward_as_tuple(pszFile, nLine), std::forward_as_tuple(pszName)).first;
+    return &it->second;
+}
+
+int64_t LockStatsMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<LockSiteSummary> GetLockStats()
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    std::vector<LockSiteSummary> result;
+    result.reserve(data.sites.size());
+    for (const auto& site : data.sites) {
+        const LockSiteStats& stats = site.second;
+        result.push_back(LockSiteSummary{stats.pszName, site.first.first, site.first.second,
+            stats.nSamples.load(std::memory_order_relaxed), stats.nContended.load(std::memory_order_relaxed),
+            stats.nWaitMicros.load(std::memory_order_relaxed), stats.nMaxWaitMicros.load(std::memory_order_relaxed),
+            stats.nHoldMicros.load(std::memory_order_relaxed), stats.nMaxHoldMicros.load(std::memory_order_relaxed)});
+    }
+    return result;
+}
+
+void ResetLockStats()
+{
+    LockStatsData& data = GetLockStatsData();
+    std::lock_guard<std::mutex> lock(data.mutex);
+    for (auto& site : data.sites) {
+        LockSiteStats& stats = site.second;
+        stats.nSamples = 0;
+        stats.nContended = 0;
+        stats.nWaitMicros = 0;
+        stats.nMaxWaitMicros = 0;
+        stats.nHoldMicros = 0;
+        stats.nMaxHoldMicros = 0;
+    }
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
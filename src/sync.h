@@ -8,9 +8,13 @@
 
 #include <threadsafety.h>
 
+#include <atomic>
 #include <condition_variable>
+#include <stdint.h>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 
 ////////////////////////////////////////////////
@@ -114,14 +118,80 @@ typedef AnnotatedMixin<std::mutex> Mutex;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+//! -lockstats default, time every 1000th lock acquisition of each thread
+static const int DEFAULT_LOCK_STATS_INTERVAL = 1000;
+
+/**
+ * Lock contention profiler. Every nth LOCK() of each thread is timed, and the time waited for the lock
+ * and the time it was held are added up per lock site. 0 disables the profiler.
+ */
+extern std::atomic<int> g_lock_stats_interval;
+
+/** Timed acquisitions of the lock at one site */
+struct LockSiteStats
+{
+    const char* const pszName;
+    std::atomic<uint64_t> nSamples{0};
+    //! Samples that did not get the lock at once
+    std::atomic<uint64_t> nContended{0};
+    std::atomic<int64_t> nWaitMicros{0};
+    std::atomic<int64_t> nMaxWaitMicros{0};
+    std::atomic<int64_t> nHoldMicros{0};
+    std::atomic<int64_t> nMaxHoldMicros{0};
+
+    explicit LockSiteStats(const char* pszNameIn) : pszName(pszNameIn) {}
+
+    void AddWait(int64_t nMicros, bool fContended);
+    void AddHold(int64_t nMicros);
+};
+
+/** Get the statistics of the lock site when this acquisition is to be timed, nullptr otherwise */
+LockSiteStats* SampleLockSite(const char* pszName, const char* pszFile, int nLine);
+
+/** Monotonic clock of the lock contention profiler */
+int64_t LockStatsMicros();
+
+/** Copy of the statistics of a lock site */
+struct LockSiteSummary
+{
+    std::string name;
+    std::string file;
+    int line;
+    uint64_t nSamples;
+    uint64_t nContended;
+    int64_t nWaitMicros;
+    int64_t nMaxWaitMicros;
+    int64_t nHoldMicros;
+    int64_t nMaxHoldMicros;
+};
+
+/** Get the statistics of all lock sites timed so far */
+std::vector<LockSiteSummary> GetLockStats();
+
+/** Clear the statistics of all lock sites */
+void ResetLockStats();
+
 /** Wrapper around std::unique_lock style lock for Mutex. */
 template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
 {
 private:
+    //! Statistics of the lock site and the time the lock was taken, when this acquisition is timed
+    LockSiteStats* m_lock_stats{nullptr};
+    int64_t m_lock_time{0};
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(Base::mutex()));
+        if (g_lock_stats_interval.load(std::memory_order_relaxed) > 0 && (m_lock_stats = SampleLockSite(pszName, pszFile, nLine)) != nullptr) {
+            const int64_t nTimeStart = LockStatsMicros();
+            const bool fContended = !Base::try_lock();
+            if (fContended)
+                Base::lock();
+            m_lock_time = LockStatsMicros();
+            m_lock_stats->AddWait(m_lock_time - nTimeStart, fContended);
+            return;
+        }
 #ifdef DEBUG_LOCKCONTENTION
         if (!Base::try_lock()) {
             PrintLockContention(pszName, pszFile, nLine);
@@ -163,8 +233,11 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            if (m_lock_stats)
+                m_lock_stats->AddHold(LockStatsMicros() - m_lock_time);
             LeaveCritical();
+        }
     }
 
     operator bool()
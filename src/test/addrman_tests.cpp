@@ -6,8 +6,10 @@
 #include <string>
 #include <boost/test/unit_test.hpp>
 
+#include <clientversion.h>
 #include <hash.h>
 #include <netbase.h>
+#include <streams.h>
 #include <random.h>
 
 class CAddrManTest : public CAddrMan
@@ -671,5 +673,37 @@ BOOST_AUTO_TEST_CASE(addrman_evictionworks)
     BOOST_CHECK(addrman.SelectTriedCollision().ToString() == "[::]:0");
 }
 
+BOOST_AUTO_TEST_CASE(addrman_serialize_modifications)
+{
+    CAddrManTest addrman;
+    const uint64_t nInitial = addrman.GetModifications();
+
+    CNetAddr source = ResolveIP("252.2.2.2");
+    for (unsigned int i = 1; i < 50; i++) {
+        CService addr = ResolveService("250." + std::to_string(i) + ".1.1");
+        BOOST_CHECK(addrman.Add(CAddress(addr, NODE_NONE), source));
+        if (i % 3 == 0)
+            addrman.Good(addr);
+    }
+    const uint64_t nModifications = addrman.GetModifications();
+    BOOST_CHECK(nModifications > nInitial);
+
+    // Writing and reading the tables change nothing
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+    ssPeers << addrman;
+    BOOST_CHECK_EQUAL(addrman.GetModifications(), nModifications);
+
+    CAddrManTest addrman2;
+    CDataStream ssCopy(ssPeers);
+    ssCopy >> addrman2;
+    BOOST_CHECK_EQUAL(addrman2.size(), addrman.size());
+    CDataStream ssPeers2(SER_DISK, CLIENT_VERSION);
+    ssPeers2 << addrman2;
+    BOOST_CHECK(ssPeers2.str() == ssPeers.str());
+
+    addrman.Attempt(ResolveService("250.1.1.1"), true);
+    BOOST_CHECK(addrman.GetModifications() > nModifications);
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
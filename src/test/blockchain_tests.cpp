@@ -3,9 +3,12 @@
 #include <stdlib.h>
 
 #include <chain.h>
+#include <primitives/block.h>
 #include <rpc/blockchain.h>
 #include <test/setup_common.h>
 
+#include <univalue.h>
+
 /* Equality between doubles is imprecise. Comparison should be done
  * with a small threshold of tolerance, rather than exact equality.
  */
@@ -69,4 +72,26 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_AUTO_TEST_CASE(block_to_json_stream_matches)
+{
+    CBlock block;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = i;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    CBlockIndex blockindex;
+    const uint256 blockHash = block.GetHash();
+    blockindex.phashBlock = &blockHash;
+
+    for (bool txDetails : {false, true}) {
+        std::string strStream;
+        blockToJSONStream(block, &blockindex, &blockindex, txDetails, [&strStream](const std::string& chunk) { strStream += chunk; });
+        BOOST_CHECK_EQUAL(strStream, blockToJSON(block, &blockindex, &blockindex, txDetails).write());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -390,4 +390,67 @@ BOOST_AUTO_TEST_CASE(TransactionsRequestDeserializationOverflowTest) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(CompressedHeadersRoundTripTest) {
+    // A chain of headers of two generators, one of them with a proof of space
+    std::vector<unsigned char> vchPubKeyA(33, 0x02), vchPubKeyB(33, 0x03);
+    std::vector<unsigned char> vchFarmerKey(48, 0xaa), vchPoolKey(32, 0xbb);
+    std::vector<CBlock> vHeaders(20);
+    for (size_t i = 0; i < vHeaders.size(); i++) {
+        CBlockHeader& header = vHeaders[i];
+        header.nVersion = i < 10 ? 0x20000000 : 0x20000001;
+        header.hashPrevBlock = i == 0 ? InsecureRand256() : vHeaders[i - 1].GetHash();
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = 1600000000 + i * 180;
+        header.nBaseTarget = 18325193796 + i;
+        header.nNonce = InsecureRand64();
+        header.nPlotterId = InsecureRand64();
+        if (i % 2 == 0) {
+            header.pos.vchFarmerPubKey = vchFarmerKey;
+            header.pos.vchPoolPubKey = vchPoolKey;
+            header.pos.vchLocalPubKey = std::vector<unsigned char>(48, i);
+            header.pos.vchProof = std::vector<unsigned char>(256, i);
+            header.pos.nPlotK = 32;
+            header.pos.vchSignature = std::vector<unsigned char>(96, i);
+            header.pos.nScanIterations = i;
+        }
+        header.vchPubKey = i % 2 == 0 ? vchPubKeyA : vchPubKeyB;
+        header.vchSignature = std::vector<unsigned char>(65, i);
+    }
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CompressedBlockHeaders(vHeaders);
+    BOOST_CHECK(stream.size() < GetSerializeSize(vHeaders, PROTOCOL_VERSION));
+
+    unsigned int nCount = ReadCompactSize(stream);
+    BOOST_CHECK_EQUAL(nCount, vHeaders.size());
+    CompressedHeaderCoder coder;
+    for (unsigned int n = 0; n < nCount; n++) {
+        CBlockHeader header;
+        coder.Decode(stream, header);
+        BOOST_CHECK_EQUAL(header.GetHash().ToString(), vHeaders[n].GetHash().ToString());
+        BOOST_CHECK(header.vchSignature == vHeaders[n].vchSignature);
+        BOOST_CHECK_EQUAL(header.hashPrevBlock.ToString(), vHeaders[n].hashPrevBlock.ToString());
+    }
+    BOOST_CHECK(stream.empty());
+}
+
+BOOST_AUTO_TEST_CASE(CompressedHeadersBadKeyTest) {
+    // A key can only refer back to a key already sent
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nBaseTarget = 1;
+    header.vchPubKey = std::vector<unsigned char>(33, 0x02);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CompressedBlockHeaders(std::vector<CBlock>(1, CBlock(header)));
+    std::vector<unsigned char> vch(stream.begin(), stream.end());
+    // The code 0 and the key of 1 + 33 bytes are followed by the empty signature of 1 byte
+    vch[vch.size() - 36] = 1;
+
+    CDataStream badStream(vch, SER_NETWORK, PROTOCOL_VERSION);
+    ReadCompactSize(badStream);
+    CompressedHeaderCoder coder;
+    CBlockHeader decoded;
+    BOOST_CHECK_THROW(coder.Decode(badStream, decoded), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
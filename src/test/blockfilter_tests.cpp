@@ -7,6 +7,7 @@
 
 #include <blockfilter.h>
 #include <core_io.h>
+#include <script/standard.h>
 #include <serialize.h>
 #include <streams.h>
 #include <univalue.h>
@@ -125,6 +126,56 @@ BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
     BOOST_CHECK(default_ctor_block_filter_1.GetEncodedFilter() == default_ctor_block_filter_2.GetEncodedFilter());
 }
 
+BOOST_AUTO_TEST_CASE(blockfilter_extended_test)
+{
+    const CAccountID owner = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x01));
+    const CAccountID point_receiver = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x02));
+    const CAccountID staking_receiver = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x03));
+    const CAccountID withdrawn_receiver = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x04));
+    const CAccountID unrelated = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x05));
+
+    CMutableTransaction tx_1;
+    tx_1.vout.emplace_back(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(owner),
+        GetPointScriptForDestination(ScriptHash(point_receiver), PROTOCOL_POINT_LOCK_BLOCKS_FULL_AMOUNT));
+    tx_1.vout.emplace_back(PROTOCOL_STAKING_AMOUNT_MIN, GetScriptForAccountID(owner),
+        GetStakingScriptForDestination(ScriptHash(staking_receiver), PROTOCOL_STAKING_LOCK_BLOCKS_FULL_AMOUNT));
+
+    CMutableTransaction tx_2;
+    tx_2.vout.emplace_back(0, CScript() << OP_RETURN << ParseHex("6f6d6e6900000000"));
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx_1));
+    block.vtx.push_back(MakeTransactionRef(tx_2));
+
+    // A withdrawn point is part of the spent coins
+    CBlockUndo block_undo;
+    block_undo.vtxundo.emplace_back();
+    block_undo.vtxundo.back().vprevout.emplace_back(CTxOut(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(owner),
+        GetPointScriptForDestination(ScriptHash(withdrawn_receiver), PROTOCOL_POINT_LOCK_BLOCKS_FULL_AMOUNT)), 100, false);
+
+    const BlockFilter basic_filter(BlockFilterType::BASIC, block, block_undo);
+    const BlockFilter extended_filter(BlockFilterType::EXTENDED, block, block_undo);
+    const GCSFilter& filter = extended_filter.GetFilter();
+
+    const CScript owner_script = GetScriptForAccountID(owner);
+    BOOST_CHECK(filter.Match(GCSFilter::Element(owner_script.begin(), owner_script.end())));
+    for (const CAccountID& receiver : {point_receiver, staking_receiver, withdrawn_receiver}) {
+        BOOST_CHECK(filter.Match(ExtendedFilterReceiverElement(receiver)));
+        BOOST_CHECK(!basic_filter.GetFilter().Match(ExtendedFilterReceiverElement(receiver)));
+    }
+    BOOST_CHECK(filter.Match(ExtendedFilterOmniMarkerElement()));
+    BOOST_CHECK(!filter.Match(ExtendedFilterReceiverElement(unrelated)));
+    BOOST_CHECK(!filter.Match(ExtendedFilterPlotterElement(12345)));
+
+    // The filter type is serialized with the filter
+    BlockFilter extended_filter2;
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << extended_filter;
+    stream >> extended_filter2;
+    BOOST_CHECK(extended_filter2.GetFilterType() == BlockFilterType::EXTENDED);
+    BOOST_CHECK(extended_filter2.GetEncodedFilter() == extended_filter.GetEncodedFilter());
+}
+
 BOOST_AUTO_TEST_CASE(blockfilters_json_test)
 {
     UniValue json;
@@ -182,11 +233,14 @@ BOOST_AUTO_TEST_CASE(blockfilters_json_test)
 BOOST_AUTO_TEST_CASE(blockfilter_type_names)
 {
     BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::BASIC), "basic");
+    BOOST_CHECK_EQUAL(BlockFilterTypeName(BlockFilterType::EXTENDED), "extended");
     BOOST_CHECK_EQUAL(BlockFilterTypeName(static_cast<BlockFilterType>(255)), "");
 
     BlockFilterType filter_type;
     BOOST_CHECK(BlockFilterTypeByName("basic", filter_type));
     BOOST_CHECK_EQUAL(filter_type, BlockFilterType::BASIC);
+    BOOST_CHECK(BlockFilterTypeByName("extended", filter_type));
+    BOOST_CHECK_EQUAL(filter_type, BlockFilterType::EXTENDED);
 
     BOOST_CHECK(!BlockFilterTypeByName("unknown", filter_type));
 }
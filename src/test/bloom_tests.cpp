@@ -531,4 +531,57 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(rolling_cuckoo)
+{
+    SeedInsecureRand(/* deterministic */ true);
+    SetMockTime(1000);
+
+    // last-100-entry, growing up to 400 when more than 50 are inserted within 60 seconds:
+    CRollingCuckooFilter rc(100, 400, 60);
+
+    static const int DATASIZE=399;
+    std::vector<uint256> data(DATASIZE);
+    for (int i = 0; i < DATASIZE; i++) {
+        data[i] = InsecureRand256();
+    }
+
+    // Rolling through slowly, the last 100 entries are always remembered:
+    for (int i = 0; i < DATASIZE; i++) {
+        if (i >= 100)
+            BOOST_CHECK(rc.contains(data[i-100]));
+        rc.insert(data[i]);
+        BOOST_CHECK(rc.contains(data[i]));
+        SetMockTime(1000 + 60 * (i + 1));
+    }
+    BOOST_CHECK_EQUAL(rc.GetElements(), 100U);
+    BOOST_CHECK(!rc.contains(data[0]));
+
+    // Few false positives if testing 100,000 random keys:
+    unsigned int nHits = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (rc.contains(InsecureRand256()))
+            ++nHits;
+    }
+    BOOST_CHECK(nHits <= 1);
+
+    rc.reset();
+    BOOST_CHECK(!rc.contains(data[DATASIZE-1]));
+
+    // Inserted all at once, the filter grows and remembers the last 200 of them:
+    for (int i = 0; i < DATASIZE; i++) {
+        rc.insert(data[i]);
+        BOOST_CHECK(rc.contains(data[i]));
+        if (i >= 100)
+            BOOST_CHECK(rc.contains(data[i-100]));
+    }
+    BOOST_CHECK_EQUAL(rc.GetElements(), 400U);
+    for (int i = DATASIZE - 200; i < DATASIZE; i++) {
+        BOOST_CHECK(rc.contains(data[i]));
+    }
+
+    rc.reset();
+    BOOST_CHECK_EQUAL(rc.GetElements(), 100U);
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,13 +5,17 @@
 #include <attributes.h>
 #include <clientversion.h>
 #include <coins.h>
+#include <key.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <map>
 #include <vector>
 
@@ -861,4 +865,91 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_account_cursor_filter)
+{
+    LOCK(cs_main);
+    CCoinsViewDB db("account_cursor", 1 << 20, true, true);
+    const CAccountID accountID = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    const CAccountID otherID = uint160(ParseHex("1112131415161718191a1b1c1d1e1f2021222324"));
+
+    // Coins of 1 to 10 COIN at heights 100 to 109, and one of another account
+    CCoinsMap map;
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i <= 10; i++) {
+        const COutPoint outpoint(InsecureRand256(), i);
+        CCoinsCacheEntry entry;
+        entry.coin = Coin(CTxOut((i + 1) * COIN, GetScriptForAccountID(i < 10 ? accountID : otherID)), 100 + i, false);
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        map.emplace(outpoint, std::move(entry));
+        if (i < 10) outpoints.push_back(outpoint);
+    }
+    BOOST_CHECK(db.BatchWrite(map, InsecureRand256()));
+    std::sort(outpoints.begin(), outpoints.end());
+
+    auto list = [&db, &accountID](const CAccountCoinsFilter& filter) {
+        std::vector<COutPoint> result;
+        for (CCoinsViewCursorRef pcursor = db.Cursor(accountID, filter); pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            BOOST_CHECK(pcursor->GetKey(outpoint));
+            result.push_back(outpoint);
+        }
+        return result;
+    };
+
+    CAccountCoinsFilter filter;
+    BOOST_CHECK(list(filter) == outpoints);
+
+    // Resume in the middle
+    filter.start = outpoints[4];
+    BOOST_CHECK(list(filter) == std::vector<COutPoint>(outpoints.begin() + 4, outpoints.end()));
+
+    // Amount and height filters
+    filter = CAccountCoinsFilter();
+    filter.nMinAmount = 6 * COIN;
+    std::vector<COutPoint> result = list(filter);
+    BOOST_CHECK_EQUAL(result.size(), 5U);
+    for (const COutPoint& outpoint : result) {
+        BOOST_CHECK(outpoint.n >= 5);
+    }
+    filter = CAccountCoinsFilter();
+    filter.nMinHeight = 102;
+    filter.nMaxHeight = 104;
+    result = list(filter);
+    BOOST_CHECK_EQUAL(result.size(), 3U);
+    for (const COutPoint& outpoint : result) {
+        BOOST_CHECK(outpoint.n >= 2 && outpoint.n <= 4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_verified_payloads)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CTxDestination dest;
+    BOOST_CHECK(ExtractDestination(GetScriptForPubKey(key.GetPubKey()), dest));
+    const bls::PrivateKey farmerKey = bls::AugSchemeMPL().KeyGen(std::vector<uint8_t>(32, 0x5a));
+
+    // A bind whose account signature does not verify
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    tx.vout.emplace_back(PROTOCOL_BINDPLOTTER_LOCKAMOUNT, GetScriptForDestination(dest),
+        SignBindPlotterScript(GetBindPlotterScriptForDestination(dest, farmerKey, 1000), key));
+    tx.vout[0].payload.back() ^= 0x01;
+    const COutPoint outpoint(tx.GetHash(), 0);
+
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    AddCoins(cache, CTransaction(tx), 1000);
+    BOOST_CHECK(!cache.AccessCoin(outpoint).GetPayload());
+
+    // Trusted as verified before, only the checks other than signatures apply
+    CCoinsViewCache verifiedCache(&base);
+    AddCoins(verifiedCache, CTransaction(tx), 1000, false, true);
+    BOOST_CHECK(verifiedCache.AccessCoin(outpoint).IsBindPlotter());
+    CCoinsViewCache expiredCache(&base);
+    AddCoins(expiredCache, CTransaction(tx), 1001, false, true);
+    BOOST_CHECK(!expiredCache.AccessCoin(outpoint).GetPayload());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
+#include <crypto/shabal256.h>
 #include <random.h>
 #include <util/strencodings.h>
 #include <test/setup_common.h>
@@ -749,4 +750,66 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256dmulti)
+{
+    for (int i = 0; i <= 32; ++i) {
+        std::vector<std::vector<unsigned char>> in(i);
+        std::vector<const unsigned char*> ptrs(i);
+        std::vector<size_t> lens(i);
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < i; ++j) {
+            // Lengths around the padding boundaries, and empty messages
+            in[j].resize(InsecureRandBool() ? InsecureRandRange(300) : 55 + InsecureRandRange(3) + 64 * InsecureRandRange(3));
+            for (unsigned char& c : in[j]) c = InsecureRandBits(8);
+            ptrs[j] = in[j].data();
+            lens[j] = in[j].size();
+            CHash256().Write(ptrs[j], lens[j]).Finalize(out1 + 32 * j);
+        }
+        SHA256DMulti(out2, ptrs.data(), lens.data(), i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sha256s64)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            CSHA256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256S64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(shabal256_lanes)
+{
+    unsigned char hash[32];
+    CShabal256().Write(nullptr, 0).Finalize(hash);
+    BOOST_CHECK_EQUAL(HexStr(hash, hash + 32), "aec750d11feee9f16271922fbaf5a9be142f62019ef8d720f858940070889014");
+
+    // Lengths of plot generation, count covers all lane widths and the scalar remainder
+    for (size_t len : {0, 1, 63, 64, 65, 96, 4096, 4112}) {
+        for (size_t count = 0; count <= 35; ++count) {
+            std::vector<unsigned char> in(len * count), out1(32 * count), out2(32 * count);
+            std::vector<const unsigned char*> inputs(count);
+            std::vector<unsigned char*> outputs(count);
+            for (size_t j = 0; j < in.size(); ++j) {
+                in[j] = InsecureRandBits(8);
+            }
+            for (size_t j = 0; j < count; ++j) {
+                CShabal256().Write(in.data() + len * j, len).Finalize(out1.data() + 32 * j);
+                inputs[j] = in.data() + len * j;
+                outputs[j] = out2.data() + 32 * j;
+            }
+            Shabal256Lanes(outputs.data(), inputs.data(), len, count);
+            BOOST_CHECK(out1 == out2);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
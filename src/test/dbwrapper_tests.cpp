@@ -79,6 +79,46 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_batch_append)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (const bool obfuscate : {false, true}) {
+        fs::path ph = GetDataDir() / (obfuscate ? "dbwrapper_batch_append_obfuscate_true" : "dbwrapper_batch_append_obfuscate_false");
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        char key = 'i';
+        uint256 in = InsecureRand256();
+        char key2 = 'j';
+        uint256 in2 = InsecureRand256();
+        char key3 = 'k';
+        uint256 in3 = InsecureRand256();
+
+        BOOST_CHECK(dbw.Write(key3, in3));
+
+        uint256 res;
+        CDBBatch batch(dbw);
+        CDBBatch other(dbw);
+
+        batch.Write(key, InsecureRand256());
+        other.Write(key, in);
+        other.Write(key2, in2);
+        other.Erase(key3);
+
+        // The appended operations apply after the ones of the batch
+        const size_t size_estimate = batch.SizeEstimate() + other.SizeEstimate();
+        batch.Append(other);
+        BOOST_CHECK_EQUAL(batch.SizeEstimate(), size_estimate);
+
+        BOOST_CHECK(dbw.WriteBatch(batch));
+
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        BOOST_CHECK(dbw.Read(key2, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+        BOOST_CHECK(dbw.Read(key3, res) == false);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
@@ -119,6 +159,95 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+// Test reads and iterators of the key spaces of a tuned database
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning)
+{
+    DBTuning tuning;
+    tuning.uncached_read_prefixes = "c";
+    tuning.cached_scan_prefixes = "s";
+    tuning.block_cache_percent = 70;
+    tuning.write_buffer_percent = 15;
+    tuning.bloom_bits_per_key = 14;
+    fs::path ph = GetDataDir() / "dbwrapper_tuning";
+    CDBWrapper dbw(ph, (1 << 20), true, false, true, tuning);
+
+    for (const char prefix : {'c', 's', 'x'}) {
+        for (uint32_t i = 0; i < 10; i++) {
+            BOOST_CHECK(dbw.Write(std::make_pair(prefix, i), i * 2));
+        }
+    }
+
+    uint32_t value;
+    BOOST_CHECK(dbw.Read(std::make_pair('c', (uint32_t) 3), value));
+    BOOST_CHECK_EQUAL(value, 6U);
+    BOOST_CHECK(dbw.Exists(std::make_pair('c', (uint32_t) 4)));
+    BOOST_CHECK(!dbw.Exists(std::make_pair('c', (uint32_t) 10)));
+
+    for (const char prefix : {'c', 's', 'x'}) {
+        std::unique_ptr<CDBIterator> it(dbw.NewIterator(prefix));
+        uint32_t count = 0;
+        for (it->Seek(std::make_pair(prefix, (uint32_t) 0)); it->Valid(); it->Next()) {
+            std::pair<char, uint32_t> key;
+            if (!it->GetKey(key) || key.first != prefix)
+                break;
+            BOOST_CHECK(it->GetValue(value));
+            BOOST_CHECK_EQUAL(key.second, count);
+            BOOST_CHECK_EQUAL(value, count * 2);
+            count++;
+        }
+        BOOST_CHECK_EQUAL(count, 10U);
+    }
+}
+
+// Test iterators bounded to a key prefix, with and without reading ahead
+BOOST_AUTO_TEST_CASE(dbwrapper_prefix_read_ahead)
+{
+    for (const bool obfuscate : {false, true}) {
+        fs::path ph = GetDataDir() / (obfuscate ? "dbwrapper_prefix_obfuscate_true" : "dbwrapper_prefix_obfuscate_false");
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        // More entries than a few read ahead batches, surrounded by other key spaces
+        const uint32_t num_entries = 5000;
+        for (const char prefix : {'a', 'b', 'c'}) {
+            CDBBatch batch(dbw);
+            for (uint32_t i = 0; i < num_entries; i++) {
+                batch.Write(std::make_pair(prefix, i), std::make_pair(i, prefix));
+            }
+            BOOST_CHECK(dbw.WriteBatch(batch));
+        }
+
+        for (const bool read_ahead : {false, true}) {
+            std::unique_ptr<CDBIterator> it(dbw.NewIterator());
+            if (read_ahead)
+                it->EnableReadAhead();
+            uint32_t count = 0;
+            for (it->SeekPrefix('b'); it->Valid(); it->Next()) {
+                std::pair<char, uint32_t> key;
+                std::pair<uint32_t, char> value;
+                BOOST_REQUIRE(it->GetKey(key));
+                BOOST_REQUIRE(it->GetValue(value));
+                BOOST_CHECK_EQUAL(key.first, 'b');
+                BOOST_CHECK_EQUAL(key.second, count);
+                BOOST_CHECK_EQUAL(value.first, count);
+                BOOST_CHECK_EQUAL(value.second, 'b');
+                count++;
+            }
+            BOOST_CHECK_EQUAL(count, num_entries);
+
+            // Seeking again restarts the iteration, a plain seek is not bounded
+            it->Seek(std::make_pair('c', num_entries - 2));
+            count = 0;
+            for (; it->Valid(); it->Next())
+                count++;
+            BOOST_CHECK_EQUAL(count, 2U);
+
+            // Destroying an iterator that did not read all its entries stops the read ahead
+            it->SeekPrefix('a');
+            BOOST_CHECK(it->Valid());
+        }
+    }
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
@@ -44,6 +44,7 @@ struct CConnmanTest : public CConnman {
 extern bool AddOrphanTx(const CTransactionRef& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
 extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern std::vector<CTransactionRef> GetOrphanPackage(const std::set<uint256>& orphan_work_set);
 extern void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="");
 
 struct COrphanTx {
@@ -447,4 +448,81 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactions.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_orphanPackage)
+{
+    LOCK2(cs_main, g_cs_orphans);
+    LimitOrphanTxSize(0);
+
+    // A parent with a missing input, two children of which the second also spends the first, and a grandchild
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    parent.vout.resize(2);
+    parent.vout[0].nValue = parent.vout[1].nValue = 1*CENT;
+    const CTransactionRef ptxParent = MakeTransactionRef(parent);
+
+    CMutableTransaction child1;
+    child1.vin.resize(1);
+    child1.vin[0].prevout = COutPoint(ptxParent->GetHash(), 0);
+    child1.vout.resize(1);
+    child1.vout[0].nValue = 1*CENT;
+    const CTransactionRef ptxChild1 = MakeTransactionRef(child1);
+
+    CMutableTransaction child2;
+    child2.vin.resize(2);
+    child2.vin[0].prevout = COutPoint(ptxParent->GetHash(), 1);
+    child2.vin[1].prevout = COutPoint(ptxChild1->GetHash(), 0);
+    child2.vout.resize(1);
+    child2.vout[0].nValue = 1*CENT;
+    const CTransactionRef ptxChild2 = MakeTransactionRef(child2);
+
+    CMutableTransaction grandchild;
+    grandchild.vin.resize(1);
+    grandchild.vin[0].prevout = COutPoint(ptxChild2->GetHash(), 0);
+    grandchild.vout.resize(1);
+    grandchild.vout[0].nValue = 1*CENT;
+    const CTransactionRef ptxGrandchild = MakeTransactionRef(grandchild);
+
+    BOOST_CHECK(AddOrphanTx(ptxGrandchild, 0));
+    BOOST_CHECK(AddOrphanTx(ptxChild2, 0));
+    BOOST_CHECK(AddOrphanTx(ptxChild1, 1));
+    BOOST_CHECK(AddOrphanTx(ptxParent, 1));
+
+    // The package holds the whole tree, every orphan after its parents
+    std::vector<CTransactionRef> vPackage = GetOrphanPackage({ptxParent->GetHash()});
+    BOOST_CHECK_EQUAL(vPackage.size(), 4U);
+    std::map<uint256, size_t> mapPosition;
+    for (size_t n = 0; n < vPackage.size(); n++)
+        mapPosition[vPackage[n]->GetHash()] = n;
+    BOOST_CHECK_EQUAL(mapPosition.size(), 4U);
+    BOOST_CHECK_EQUAL(mapPosition[ptxParent->GetHash()], 0U);
+    BOOST_CHECK(mapPosition[ptxChild1->GetHash()] < mapPosition[ptxChild2->GetHash()]);
+    BOOST_CHECK(mapPosition[ptxChild2->GetHash()] < mapPosition[ptxGrandchild->GetHash()]);
+
+    // Starting lower in the tree leaves out the ancestors, unknown hashes are ignored
+    vPackage = GetOrphanPackage({ptxChild2->GetHash(), InsecureRand256()});
+    BOOST_CHECK_EQUAL(vPackage.size(), 2U);
+    BOOST_CHECK(vPackage[0] == ptxChild2 && vPackage[1] == ptxGrandchild);
+
+    // A long chain is cut at the package limit
+    LimitOrphanTxSize(0);
+    CTransactionRef ptxPrev = ptxParent;
+    BOOST_CHECK(AddOrphanTx(ptxParent, 0));
+    for (unsigned int i = 0; i < MAX_ORPHAN_PACKAGE_SIZE + 5; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(ptxPrev->GetHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 1*CENT;
+        ptxPrev = MakeTransactionRef(tx);
+        BOOST_CHECK(AddOrphanTx(ptxPrev, 0));
+    }
+    vPackage = GetOrphanPackage({ptxParent->GetHash()});
+    BOOST_CHECK_EQUAL(vPackage.size(), MAX_ORPHAN_PACKAGE_SIZE);
+    BOOST_CHECK(vPackage[0] == ptxParent);
+    for (size_t n = 1; n < vPackage.size(); n++)
+        BOOST_CHECK(vPackage[n]->vin[0].prevout.hash == vPackage[n - 1]->GetHash());
+    LimitOrphanTxSize(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -123,4 +123,20 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_finalize)
+{
+    const auto data_dir = GetDataDir();
+    FlatFileSeq seq(data_dir, "a", 100);
+
+    bool out_of_space;
+    seq.Allocate(FlatFilePos(1, 0), 10, out_of_space);
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(1, 0))), 100);
+
+    // Finalize truncates the file, and the later commit keeps the size
+    BOOST_CHECK(seq.Finalize(FlatFilePos(1, 10)));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(1, 0))), 10);
+    BOOST_CHECK(seq.Flush(FlatFilePos(1, 10)));
+    BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(1, 0))), 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
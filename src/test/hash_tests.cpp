@@ -5,6 +5,7 @@
 #include <clientversion.h>
 #include <crypto/siphash.h>
 #include <hash.h>
+#include <streams.h>
 #include <util/strencodings.h>
 #include <test/setup_common.h>
 
@@ -147,4 +148,29 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(hashed_writer)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    CHashedWriter<CDataStream> writer(&ss);
+    const uint256 x = InsecureRand256();
+    writer << x << std::string("abc") << VARINT(300u);
+    const uint256 hash = writer.GetHash();
+
+    CDataStream expected(SER_DISK, CLIENT_VERSION);
+    expected << x << std::string("abc") << VARINT(300u);
+    BOOST_CHECK(ss.str() == expected.str());
+    BOOST_CHECK_EQUAL(hash, Hash(expected.begin(), expected.end()));
+
+    // The verifier hashes what it reads the same way
+    CHashVerifier<CDataStream> verifier(&ss);
+    uint256 y;
+    std::string str;
+    unsigned int n;
+    verifier >> y >> str >> VARINT(n);
+    BOOST_CHECK_EQUAL(y, x);
+    BOOST_CHECK_EQUAL(str, "abc");
+    BOOST_CHECK_EQUAL(n, 300u);
+    BOOST_CHECK_EQUAL(verifier.GetHash(), hash);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
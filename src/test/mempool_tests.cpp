@@ -2,7 +2,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <key.h>
 #include <policy/policy.h>
+#include <script/standard.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -421,6 +423,91 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
 }
 
 
+BOOST_AUTO_TEST_CASE(MempoolBindPlotterIndexTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CKey key;
+    key.MakeNewKey(true);
+    CTxDestination dest;
+    BOOST_CHECK(ExtractDestination(GetScriptForPubKey(key.GetPubKey()), dest));
+    const bls::PrivateKey farmerKey = bls::AugSchemeMPL().KeyGen(std::vector<uint8_t>(32, 0x5a));
+
+    // Two binds of the same plotter and a plain spend
+    CMutableTransaction txBind[2];
+    for (int i = 0; i < 2; i++) {
+        txBind[i].vin.resize(1);
+        txBind[i].vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        txBind[i].vout.emplace_back(PROTOCOL_BINDPLOTTER_LOCKAMOUNT, GetScriptForDestination(dest),
+            SignBindPlotterScript(GetBindPlotterScriptForDestination(dest, farmerKey, 1000 + i), key));
+    }
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    txSpend.vout.emplace_back(COIN, GetScriptForDestination(dest));
+
+    const CTxMemPoolEntry bindEntry = entry.FromTx(txBind[0]);
+    const uint64_t plotterId = bindEntry.GetBindPlotterId();
+    BOOST_CHECK(plotterId != 0);
+    BOOST_CHECK_EQUAL(entry.FromTx(txSpend).GetBindPlotterId(), 0);
+
+    pool.addUnchecked(bindEntry);
+    pool.addUnchecked(entry.FromTx(txSpend));
+    BOOST_CHECK_EQUAL(pool.GetBindPlotterTxs(plotterId).size(), 1);
+    BOOST_CHECK(pool.GetBindPlotterTxs(plotterId + 1).empty());
+
+    // A block binding the plotter evicts the other bind, but not the plain spend
+    pool.removeForBlock({MakeTransactionRef(txBind[1])}, 1);
+    BOOST_CHECK(pool.GetBindPlotterTxs(plotterId).empty());
+    BOOST_CHECK(!pool.exists(txBind[0].GetHash()));
+    BOOST_CHECK(pool.exists(txSpend.GetHash()));
+
+    pool.addUnchecked(entry.FromTx(txBind[0]));
+    pool.removeRecursive(CTransaction(txBind[0]), REMOVAL_REASON_DUMMY);
+    BOOST_CHECK(pool.GetBindPlotterTxs(plotterId).empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolHashesSnapshotTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx[2];
+    for (int i = 0; i < 2; i++) {
+        tx[i].vin.resize(1);
+        tx[i].vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx[i].vout.resize(1);
+        tx[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx[i].vout[0].nValue = 10 * COIN;
+    }
+
+    const std::shared_ptr<const std::vector<uint256>> empty = pool.GetHashesSnapshot();
+    BOOST_CHECK(empty->empty());
+    BOOST_CHECK(pool.GetHashesSnapshot() == empty);
+
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.FromTx(tx[0]));
+    }
+    // The pool changed, so the snapshot is taken anew and then shared
+    const std::shared_ptr<const std::vector<uint256>> one = pool.GetHashesSnapshot();
+    BOOST_CHECK(one != empty);
+    BOOST_CHECK(*one == std::vector<uint256>{tx[0].GetHash()});
+    BOOST_CHECK(pool.GetHashesSnapshot() == one);
+
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.FromTx(tx[1]));
+        pool.removeRecursive(CTransaction(tx[0]), REMOVAL_REASON_DUMMY);
+    }
+    std::vector<uint256> vtxid;
+    pool.queryHashes(vtxid);
+    BOOST_CHECK(vtxid == std::vector<uint256>{tx[1].GetHash()});
+    BOOST_CHECK(*one == std::vector<uint256>{tx[0].GetHash()});
+}
+
 BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
 {
     CTxMemPool pool;
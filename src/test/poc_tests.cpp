@@ -0,0 +1,292 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/curve25519.h>
+#include <crypto/shabal256.h>
+#include <poc/poc.h>
+#include <pos/pos.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <streams.h>
+#include <test/setup_common.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(poc_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(calculate_deadlines_batch)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    CBlockIndex prevBlockIndex;
+    prevBlockIndex.nHeight = 1000;
+    prevBlockIndex.nBaseTarget = poc::INITIAL_BASE_TARGET;
+    prevBlockIndex.SetNextGenerationSignature(InsecureRand256());
+
+    // Covers all lane widths and the scalar remainder
+    std::vector<CBlockHeader> blocks(37);
+    for (CBlockHeader& block : blocks) {
+        block.nPlotterId = InsecureRandBits(64);
+        block.nNonce = InsecureRandBits(64);
+    }
+
+    std::vector<uint64_t> deadlines = poc::CalculateDeadlines(prevBlockIndex, blocks, params);
+    BOOST_CHECK_EQUAL(deadlines.size(), blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BOOST_CHECK_EQUAL(deadlines[i], poc::CalculateDeadline(prevBlockIndex, blocks[i], params));
+    }
+
+    BOOST_CHECK(poc::CalculateDeadlines(prevBlockIndex, {}, params).empty());
+}
+
+BOOST_AUTO_TEST_CASE(batch_check_proof_of_capacity)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // Chain of headers following prevBlockIndex, each one with the block time its deadline requires
+    const size_t nCount = 21;
+    std::vector<CBlockHeader> headers(nCount);
+    std::vector<CBlockIndex> vIndexes(nCount + 1);
+    std::vector<uint256> vHashes(nCount + 1);
+    vHashes[0] = InsecureRand256();
+    vIndexes[0].phashBlock = &vHashes[0];
+    vIndexes[0].nHeight = 1000;
+    vIndexes[0].nTime = params.nBeginMiningTime;
+    vIndexes[0].nBaseTarget = 1ULL << 40;
+    vIndexes[0].SetNextGenerationSignature(InsecureRand256());
+    for (size_t i = 0; i < nCount; i++) {
+        CBlockHeader& header = headers[i];
+        header.hashPrevBlock = vHashes[i];
+        header.nBaseTarget = 1ULL << 40;
+        header.nPlotterId = InsecureRandBits(64);
+        header.nNonce = InsecureRandBits(64);
+        header.nTime = vIndexes[i].nTime + poc::CalculateDeadline(vIndexes[i], header, params) + 1;
+        if (i == nCount / 2)
+            header.nTime++;
+
+        vHashes[i + 1] = header.GetHash();
+        vIndexes[i + 1] = CBlockIndex(header);
+        vIndexes[i + 1].phashBlock = &vHashes[i + 1];
+        vIndexes[i + 1].pprev = &vIndexes[i];
+        vIndexes[i + 1].nHeight = vIndexes[i].nHeight + 1;
+    }
+
+    // Same results as the checks of single headers
+    std::vector<CHashedBlockHeader> hashedHeaders(headers.begin(), headers.end());
+    poc::BatchCheckProofOfCapacity(vIndexes[0], hashedHeaders.begin(), hashedHeaders.end(), params);
+    for (size_t i = 0; i < nCount; i++) {
+        BOOST_CHECK_EQUAL(poc::CheckProofOfCapacity(vIndexes[i], headers[i], params), i != nCount / 2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(calculate_base_target_memoized)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+
+    // Two chains of the same heights, only the second one has hashes and is memoized
+    const size_t nCount = 200;
+    std::vector<uint256> vHashes(nCount);
+    std::vector<CBlockIndex> vPlain(nCount), vHashed(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        vHashes[i] = InsecureRand256();
+        for (std::vector<CBlockIndex>* pvIndexes : {&vPlain, &vHashed}) {
+            CBlockIndex& index = (*pvIndexes)[i];
+            index.pprev = i > 0 ? &(*pvIndexes)[i - 1] : nullptr;
+            index.nHeight = 1000 + i;
+            index.nTime = params.nBeginMiningTime + i * params.nPowTargetSpacing + InsecureRandRange(params.nPowTargetSpacing);
+            index.nBaseTarget = poc::INITIAL_BASE_TARGET / (1 + InsecureRandRange(7));
+        }
+        vHashed[i].nTime = vPlain[i].nTime;
+        vHashed[i].nBaseTarget = vPlain[i].nBaseTarget;
+        vHashed[i].phashBlock = &vHashes[i];
+    }
+
+    // Repeated calls for the same parent, with different block times, match the uncached results
+    for (size_t i = 100; i < nCount; i++) {
+        for (int nDelay : {1, 60, 600, 6000}) {
+            CBlockHeader block;
+            block.nTime = vPlain[i].nTime + nDelay;
+            BOOST_CHECK_EQUAL(poc::CalculateBaseTarget(vHashed[i], block, params), poc::CalculateBaseTarget(vPlain[i], block, params));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(verify_batch)
+{
+    // Valid signatures of different plotters, and corrupted ones in between
+    const size_t nCount = 40;
+    std::vector<poc::SignatureCheck> checks(nCount);
+    std::vector<bool> vExpected(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        poc::SignatureCheck& check = checks[i];
+        const uint256 data = InsecureRand256();
+        memcpy(check.data, data.begin(), 32);
+        BOOST_CHECK(poc::Sign("plotter passphrase " + std::to_string(i % 7), check.data, check.signature, check.publicKey));
+        vExpected[i] = i % 5 != 3;
+        if (!vExpected[i])
+            check.signature[i % 64] ^= 0x01;
+    }
+    BOOST_CHECK(poc::VerifyBatch(checks) == vExpected);
+    for (size_t i = 0; i < nCount; i++) {
+        BOOST_CHECK_EQUAL(poc::Verify(checks[i].publicKey, checks[i].data, checks[i].signature), vExpected[i]);
+    }
+    BOOST_CHECK(poc::VerifyBatch({}).empty());
+
+    // The batch computes the same keys as one by one, also for keys off the curve and of the base point
+    const size_t nKeys = 70;
+    std::vector<unsigned char> Y(nKeys * 32), v(nKeys * 32), h(nKeys * 32), P(nKeys * 32);
+    for (size_t i = 0; i < nKeys * 32; i++) {
+        v[i] = InsecureRandBits(8);
+        h[i] = InsecureRandBits(8);
+        P[i] = InsecureRandBits(8);
+    }
+    memset(&P[0], 0, 32);
+    P[32] = 9;
+    memset(&P[33], 0, 31);
+    crypto::curve25519_verify_batch(nKeys, Y.data(), v.data(), h.data(), P.data());
+    for (size_t n = 0; n < nKeys; n++) {
+        unsigned char verify[32];
+        crypto::curve25519_verify(verify, &v[n * 32], &h[n * 32], &P[n * 32]);
+        BOOST_CHECK(memcmp(verify, &Y[n * 32], 32) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(header_extensions_inline)
+{
+    CBlockHeader header;
+    header.nBaseTarget = 1;
+    header.pos.vchFarmerPubKey = std::vector<unsigned char>(48, 0x01);
+    header.pos.vchPoolPubKey = std::vector<unsigned char>(32, 0x02);
+    header.pos.vchLocalPubKey = std::vector<unsigned char>(48, 0x03);
+    header.pos.vchProof = std::vector<unsigned char>(8 * 32, 0x04);
+    header.pos.nPlotK = 32;
+    header.pos.vchSignature = std::vector<unsigned char>(96, 0x05);
+    header.vchPubKey = std::vector<unsigned char>(33, 0x06);
+    header.vchSignature = std::vector<unsigned char>(71, 0x07);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << header;
+    const std::string strHeader = ss.str();
+    CBlockHeader header2;
+    ss >> header2;
+    BOOST_CHECK(header2.GetHash() == header.GetHash());
+    BOOST_CHECK(header2.pos.vchProof == header.pos.vchProof);
+    BOOST_CHECK(header2.vchSignature == header.vchSignature);
+
+    // Valid extensions decode without heap allocations
+    BOOST_CHECK_EQUAL(header2.pos.vchFarmerPubKey.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.pos.vchPoolPubKey.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.pos.vchLocalPubKey.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.pos.vchProof.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.pos.vchSignature.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.vchPubKey.allocated_memory(), 0U);
+    BOOST_CHECK_EQUAL(header2.vchSignature.allocated_memory(), 0U);
+
+    // Re-encoding gives the same bytes
+    CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
+    ss2 << header2;
+    BOOST_CHECK(ss2.str() == strHeader);
+}
+
+BOOST_AUTO_TEST_CASE(calculate_scoop_deadlines)
+{
+    const uint256 generationSignature = InsecureRand256();
+    // Covers all lane widths and the scalar remainder
+    const size_t nCount = 37;
+    std::vector<unsigned char> scoops(nCount * poc::SCOOP_SIZE);
+    for (unsigned char& c : scoops) {
+        c = InsecureRandBits(8);
+    }
+
+    std::vector<uint64_t> deadlines(nCount);
+    poc::CalculateScoopDeadlines(generationSignature, scoops.data(), nCount, deadlines.data());
+    for (size_t n = 0; n < nCount; n++) {
+        uint256 hash;
+        CShabal256()
+            .Write(generationSignature.begin(), generationSignature.size())
+            .Write(&scoops[n * poc::SCOOP_SIZE], poc::SCOOP_SIZE)
+            .Finalize(hash.begin());
+        BOOST_CHECK_EQUAL(deadlines[n], hash.GetUint64(0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parse_plot_file_name)
+{
+    uint64_t nPlotterId, nStartNonce, nNonces;
+    BOOST_CHECK(poc::ParsePlotFileName("12345678901234567890_1000_4096", nPlotterId, nStartNonce, nNonces));
+    BOOST_CHECK_EQUAL(nPlotterId, 12345678901234567890ULL);
+    BOOST_CHECK_EQUAL(nStartNonce, 1000U);
+    BOOST_CHECK_EQUAL(nNonces, 4096U);
+
+    // PoC1 plot files have a stagger
+    BOOST_CHECK(!poc::ParsePlotFileName("123_1000_4096_4096", nPlotterId, nStartNonce, nNonces));
+    BOOST_CHECK(!poc::ParsePlotFileName("123_1000_0", nPlotterId, nStartNonce, nNonces));
+    BOOST_CHECK(!poc::ParsePlotFileName("123_1000_4096.plotting", nPlotterId, nStartNonce, nNonces));
+    BOOST_CHECK(!poc::ParsePlotFileName("123_1000", nPlotterId, nStartNonce, nNonces));
+}
+
+BOOST_AUTO_TEST_CASE(passes_plot_filters)
+{
+    const uint256 challenge = InsecureRand256();
+    // More than one batch of filter hashes
+    std::vector<uint256> plotIds(300);
+    for (uint256& plotId : plotIds) {
+        plotId = InsecureRand256();
+    }
+
+    for (int filterBits : {0, 1, 6, 9}) {
+        const std::vector<bool> passed = pos::PassesPlotFilters(plotIds, challenge, filterBits);
+        BOOST_CHECK_EQUAL(passed.size(), plotIds.size());
+        for (size_t i = 0; i < plotIds.size(); i++) {
+            BOOST_CHECK_EQUAL(passed[i], pos::PassesPlotFilter(plotIds[i], challenge, filterBits));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parse_plot_file_header)
+{
+    const uint256 plotId = InsecureRand256();
+    const std::string strMagic = "Proof of Space Plot";
+    const std::string strFormat = "v1.0";
+    for (size_t nPoolSize : {(size_t) 48, (size_t) 32}) {
+        pos::Bytes data(strMagic.begin(), strMagic.end());
+        data.insert(data.end(), plotId.begin(), plotId.end());
+        data.push_back(32);
+        data.push_back(0);
+        data.push_back(strFormat.size());
+        data.insert(data.end(), strFormat.begin(), strFormat.end());
+        data.push_back(0);
+        data.push_back(nPoolSize + 48 + 32);
+        data.insert(data.end(), nPoolSize, 0x01);
+        data.insert(data.end(), 48, 0x02);
+        data.insert(data.end(), 32, 0x03);
+        // Table pointers follow the memo
+        data.insert(data.end(), 80, 0x00);
+
+        pos::PlotFileHeader header;
+        BOOST_CHECK(pos::ParsePlotFileHeader(data, header));
+        BOOST_CHECK(header.plotId == plotId);
+        BOOST_CHECK_EQUAL(header.k, 32);
+        BOOST_CHECK(header.poolPubKey == pos::Bytes(nPoolSize, 0x01));
+        BOOST_CHECK(header.farmerPubKey == pos::Bytes(48, 0x02));
+        BOOST_CHECK(header.localMasterPrivateKey == pos::Bytes(32, 0x03));
+
+        // Truncated memo
+        data.resize(strMagic.size() + 32 + 1 + 2 + strFormat.size() + 2 + 100);
+        BOOST_CHECK(!pos::ParsePlotFileHeader(data, header));
+    }
+
+    const std::string strOther = "Not a plot file";
+    pos::PlotFileHeader header;
+    BOOST_CHECK(!pos::ParsePlotFileHeader(pos::Bytes(strOther.begin(), strOther.end()), header));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,8 @@
 #include <boost/thread.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+
 BOOST_AUTO_TEST_SUITE(scheduler_tests)
 
 static void microTask(CScheduler& s, boost::mutex& mutex, int& counter, int delta, boost::chrono::system_clock::time_point rescheduleTime)
@@ -155,4 +157,38 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(unschedule)
+{
+    CScheduler scheduler;
+    std::atomic<int> nOnce(0), nRepeated(0);
+
+    // Unscheduled before the service thread starts
+    CScheduler::TaskId idOnce = scheduler.scheduleFromNow([&nOnce] { nOnce++; }, 1);
+    BOOST_CHECK(scheduler.unschedule(idOnce));
+    BOOST_CHECK(!scheduler.unschedule(idOnce));
+    scheduler.scheduleFromNow([&nOnce] { nOnce += 10; }, 1);
+
+    // A repeating task keeps its id over its runs
+    CScheduler::TaskId idEvery = scheduler.scheduleEvery([&nRepeated] { nRepeated++; }, 1);
+    BOOST_CHECK(idEvery != idOnce);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 2; ++i) {
+        threads.create_thread(std::bind(&CScheduler::serviceQueue, &scheduler));
+    }
+    while (nRepeated < 3) {
+        MicroSleep(1000);
+    }
+    BOOST_CHECK(scheduler.unschedule(idEvery));
+    MicroSleep(10000);
+    const int nStopped = nRepeated;
+    MicroSleep(10000);
+    BOOST_CHECK_EQUAL(nRepeated, nStopped);
+    BOOST_CHECK(!scheduler.unschedule(idEvery));
+
+    scheduler.stop(true);
+    threads.join_all();
+    BOOST_CHECK_EQUAL(nOnce, 10);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -370,4 +370,35 @@ BOOST_AUTO_TEST_CASE(script_standard_GetScriptFor_)
     BOOST_CHECK(result == expected);
 }
 
+BOOST_AUTO_TEST_CASE(script_standard_ExtractTxoutPayload_interned)
+{
+    const CAccountID owner = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x01));
+    const CAccountID receiver = CAccountID(std::vector<unsigned char>(CAccountID::WIDTH, 0x02));
+    const CScript pointScript = GetPointScriptForDestination(ScriptHash(receiver), PROTOCOL_POINT_LOCK_BLOCKS_FULL_AMOUNT);
+
+    // Equal points share one payload
+    const TxOutPayloadInternStats before = GetTxOutPayloadInternStats();
+    CTxOutPayloadRef first = ExtractTxoutPayload(CTxOut(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(owner), pointScript));
+    CTxOutPayloadRef second = ExtractTxoutPayload(CTxOut(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(receiver), pointScript));
+    BOOST_REQUIRE(first && second);
+    BOOST_CHECK(first == second);
+    BOOST_CHECK(PointPayload::As(first)->GetReceiverID() == receiver);
+    const TxOutPayloadInternStats after = GetTxOutPayloadInternStats();
+    BOOST_CHECK_EQUAL(after.nHits, before.nHits + 1);
+    BOOST_CHECK_EQUAL(after.nMisses, before.nMisses + 1);
+
+    // The amount is part of the payload
+    CTxOutPayloadRef other = ExtractTxoutPayload(CTxOut(2 * PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(owner), pointScript));
+    BOOST_REQUIRE(other);
+    BOOST_CHECK(other != first);
+    BOOST_CHECK_EQUAL(PointPayload::As(other)->GetAmount(), 2 * PointPayload::As(first)->GetAmount());
+
+    // A payload nothing holds any more is made again
+    first.reset();
+    second.reset();
+    const uint64_t nMisses = GetTxOutPayloadInternStats().nMisses;
+    BOOST_CHECK(ExtractTxoutPayload(CTxOut(PROTOCOL_POINT_AMOUNT_MIN, GetScriptForAccountID(owner), pointScript)));
+    BOOST_CHECK_EQUAL(GetTxOutPayloadInternStats().nMisses, nMisses + 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <crypto/shabal256.h>
 #include <init.h>
 #include <miner.h>
 #include <net.h>
@@ -51,11 +52,14 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     InitLogging();
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    Shabal256AutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitBindPayloadCache();
+    InitHeaderSignatureCache();
     fCheckBlockIndex = true;
     static bool noui_connected = false;
     if (!noui_connected) {
@@ -43,6 +43,65 @@ BOOST_AUTO_TEST_CASE(skiplist_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(arena_skiplist_test)
+{
+    CBlockIndexArena arena;
+    CBlockHeader header;
+    header.vchPubKey = std::vector<unsigned char>(33, 0x02);
+    header.vchSignature = std::vector<unsigned char>(65, 0x01);
+
+    std::vector<CBlockIndex*> vIndex;
+    for (int i = 0; i < 10000; i++) {
+        CBlockIndex* pindex = i % 2 ? arena.Create(header) : arena.Create();
+        pindex->nHeight = i;
+        pindex->pprev = vIndex.empty() ? nullptr : vIndex.back();
+        pindex->BuildSkip();
+        vIndex.push_back(pindex);
+    }
+
+    // Entries never move while the arena grows
+    for (int i = 0; i < 10000; i++) {
+        BOOST_CHECK_EQUAL(vIndex[i]->nHeight, i);
+        BOOST_CHECK(vIndex[i]->pprev == (i == 0 ? nullptr : vIndex[i - 1]));
+        BOOST_CHECK_EQUAL(vIndex[i]->GetSignature().size(), i % 2 ? 65U : 0U);
+        BOOST_CHECK(vIndex[i]->GetBlockHeader().vchPubKey == (i % 2 ? header.vchPubKey : BlockPubKeyBytes()));
+    }
+    for (int i = 0; i < 1000; i++) {
+        int from = InsecureRandRange(vIndex.size());
+        int to = InsecureRandRange(from + 1);
+        BOOST_CHECK(vIndex[from]->GetAncestor(to) == vIndex[to]);
+    }
+    BOOST_CHECK(arena.DynamicMemoryUsage() >= vIndex.size() * sizeof(CBlockIndex));
+    arena.Clear();
+}
+
+BOOST_AUTO_TEST_CASE(epoch_test)
+{
+    const int nEpochBlocks = 2016;
+    std::vector<CBlockIndex> vIndex(10000);
+    for (int i = 0; i < (int)vIndex.size(); i++) {
+        vIndex[i].nHeight = i;
+        vIndex[i].pprev = (i == 0) ? nullptr : &vIndex[i - 1];
+        vIndex[i].BuildSkip();
+        vIndex[i].BuildEpoch(nEpochBlocks);
+    }
+    for (int i = 0; i < (int)vIndex.size(); i++) {
+        BOOST_CHECK(vIndex[i].pepoch == &vIndex[i / nEpochBlocks * nEpochBlocks]);
+    }
+
+    // A fork keeps the epoch of its fork point until it starts a new epoch
+    std::vector<CBlockIndex> vFork(3000);
+    for (int i = 0; i < (int)vFork.size(); i++) {
+        vFork[i].nHeight = 3000 + i;
+        vFork[i].pprev = (i == 0) ? &vIndex[2999] : &vFork[i - 1];
+        vFork[i].BuildEpoch(nEpochBlocks);
+    }
+    BOOST_CHECK(vFork[0].pepoch == &vIndex[2016]);
+    BOOST_CHECK(vFork[4031 - 3000].pepoch == &vIndex[2016]);
+    BOOST_CHECK(vFork[4032 - 3000].pepoch == &vFork[4032 - 3000]);
+    BOOST_CHECK(vFork[5999 - 3000].pepoch == &vFork[4032 - 3000]);
+}
+
 BOOST_AUTO_TEST_CASE(getlocator_test)
 {
     // Build a main chain 100000 blocks long.
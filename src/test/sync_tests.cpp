@@ -7,6 +7,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 namespace {
 template <typename MutexType>
 void TestPotentialDeadLockDetected(MutexType& mutex1, MutexType& mutex2)
@@ -49,4 +53,46 @@ BOOST_AUTO_TEST_CASE(potential_deadlock_detected)
     #endif
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    const int prev = g_lock_stats_interval;
+    g_lock_stats_interval = 1;
+    ResetLockStats();
+
+    Mutex lock_stats_mutex;
+    for (int i = 0; i < 3; i++) {
+        LOCK(lock_stats_mutex);
+    }
+    std::atomic<bool> started{false};
+    std::thread waiter;
+    {
+        // Contend with another thread, which waits until the lock is released
+        LOCK(lock_stats_mutex);
+        waiter = std::thread([&] {
+            started = true;
+            LOCK(lock_stats_mutex);
+        });
+        while (!started) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    waiter.join();
+    g_lock_stats_interval = prev;
+
+    uint64_t nSamples = 0, nContended = 0;
+    for (const LockSiteSummary& site : GetLockStats()) {
+        if (site.name != "lock_stats_mutex")
+            continue;
+        BOOST_CHECK(site.file.find("sync_tests.cpp") != std::string::npos);
+        BOOST_CHECK(site.nMaxWaitMicros <= site.nWaitMicros);
+        BOOST_CHECK(site.nMaxHoldMicros <= site.nHoldMicros);
+        nSamples += site.nSamples;
+        nContended += site.nContended;
+    }
+    BOOST_CHECK_EQUAL(nSamples, 5U);
+    BOOST_CHECK_EQUAL(nContended, 1U);
+    ResetLockStats();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
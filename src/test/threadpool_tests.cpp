@@ -0,0 +1,58 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <threadpool.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(threadpool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(run_parallel)
+{
+    CThreadPool pool;
+
+    // Not started, runs on the calling thread
+    std::vector<int> vSlices(100, 0);
+    pool.RunParallel(TaskPriority::MINING, vSlices.size(), [&](int n) { vSlices[n]++; });
+    for (int count : vSlices)
+        BOOST_CHECK_EQUAL(count, 1);
+
+    pool.Start(4);
+    BOOST_CHECK_EQUAL(pool.GetThreadCount(), 4);
+    for (int i = 0; i < 100; i++) {
+        pool.RunParallel(TaskPriority::CRITICAL, vSlices.size(), [&](int n) { vSlices[n]++; });
+    }
+    for (int count : vSlices)
+        BOOST_CHECK_EQUAL(count, 101);
+
+    // Nested calls from the workers take slices themselves
+    std::atomic<int> nInner{0};
+    pool.RunParallel(TaskPriority::BACKGROUND, 16, [&](int) {
+        pool.RunParallel(TaskPriority::RPC, 16, [&](int) { nInner++; });
+    });
+    BOOST_CHECK_EQUAL(nInner, 16 * 16);
+
+    pool.Stop();
+    BOOST_CHECK_EQUAL(pool.GetThreadCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(submit)
+{
+    CThreadPool pool;
+    pool.Start(3);
+    std::atomic<int> nRun{0};
+    for (int i = 0; i < 1000; i++) {
+        pool.Submit(i % 2 ? TaskPriority::MINING : TaskPriority::BACKGROUND, [&] { nRun++; });
+    }
+    // Stop runs the tasks left
+    pool.Stop();
+    BOOST_CHECK_EQUAL(nRun, 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -496,6 +496,41 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     threadGroup.join_all();
 }
 
+BOOST_AUTO_TEST_CASE(test_produce_signatures)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    BOOST_CHECK(keystore.AddKeyPubKey(key, key.GetPubKey()));
+    CKeyID hash = key.GetPubKey().GetID();
+    const CScript scriptWitness = CScript() << OP_0 << std::vector<unsigned char>(hash.begin(), hash.end());
+    const CScript scriptLegacy = GetScriptForDestination(PKHash(key.GetPubKey()));
+
+    // Enough inputs to be spread over several threads
+    CMutableTransaction mtx;
+    std::vector<SigningInput> inputs;
+    uint256 prevId;
+    prevId.SetHex("0000000000000000000000000000000000000000000000000000000000000100");
+    for (unsigned int i = 0; i < 200; i++) {
+        mtx.vin.emplace_back(COutPoint(prevId, i));
+        mtx.vout.emplace_back(1000, CScript() << OP_1);
+        inputs.push_back({i, i % 2 ? scriptWitness : scriptLegacy, 1000, i % 3 ? SIGHASH_ALL : SIGHASH_SINGLE});
+    }
+
+    CMutableTransaction mtxSerial = mtx;
+    for (const SigningInput& input : inputs) {
+        BOOST_CHECK(SignSignature(keystore, input.scriptPubKey, mtxSerial, input.nIn, input.amount, input.nHashType));
+    }
+
+    std::vector<SignatureData> sigdata(inputs.size());
+    ProduceSignatures(keystore, mtx, inputs, sigdata);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BOOST_CHECK(sigdata[i].complete);
+        UpdateInput(mtx.vin[i], sigdata[i]);
+    }
+    BOOST_CHECK(CTransaction(mtx).GetWitnessHash() == CTransaction(mtxSerial).GetWitnessHash());
+}
+
 SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutableTransaction& input2, const CTransactionRef tx)
 {
     SignatureData sigdata;
@@ -770,4 +805,40 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     BOOST_CHECK(!IsStandardTx(CTransaction(t), reason));
 }
 
+BOOST_AUTO_TEST_CASE(make_transaction_refs)
+{
+    std::vector<CMutableTransaction> vmtx(20);
+    for (size_t i = 0; i < vmtx.size(); i++) {
+        vmtx[i].vin.resize(1 + i % 3);
+        vmtx[i].vin[0].prevout = COutPoint(InsecureRand256(), i);
+        vmtx[i].vout.resize(1);
+        vmtx[i].vout[0].nValue = i;
+        vmtx[i].vout[0].scriptPubKey = CScript() << OP_TRUE;
+        if (i % 2)
+            vmtx[i].vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(i * 10, 1));
+    }
+
+    std::vector<CMutableTransaction> vmtxCopy = vmtx;
+    std::vector<CTransactionRef> vtx = MakeTransactionRefs(std::move(vmtxCopy));
+    BOOST_REQUIRE_EQUAL(vtx.size(), vmtx.size());
+    for (size_t i = 0; i < vmtx.size(); i++) {
+        const CTransaction tx(vmtx[i]);
+        BOOST_CHECK(vtx[i]->GetHash() == tx.GetHash());
+        BOOST_CHECK(vtx[i]->GetWitnessHash() == tx.GetWitnessHash());
+    }
+
+    // Deserialized blocks get their transaction hashes the same way
+    CBlock block;
+    block.vtx = vtx;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+    CBlock block2;
+    ss >> block2;
+    BOOST_REQUIRE_EQUAL(block2.vtx.size(), vtx.size());
+    for (size_t i = 0; i < vtx.size(); i++) {
+        BOOST_CHECK(block2.vtx[i]->GetHash() == vtx[i]->GetHash());
+        BOOST_CHECK(block2.vtx[i]->GetWitnessHash() == vtx[i]->GetWitnessHash());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
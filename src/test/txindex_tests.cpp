@@ -5,9 +5,11 @@
 #include <chainparams.h>
 #include <index/txindex.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <test/setup_common.h>
 #include <util/system.h>
 #include <util/time.h>
+#include <validation.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -77,4 +79,86 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_parallel_sync, TestChain100Setup)
+{
+    // Sync with worker threads reading the blocks ahead, and make sure the writes stay complete
+    g_index_sync_threads = 4;
+    TxIndex txindex(1 << 20, true);
+    txindex.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+    g_index_sync_threads = 0;
+
+    CTransactionRef tx_disk;
+    uint256 block_hash;
+    for (const auto& txn : m_coinbase_txns) {
+        if (!txindex.FindTx(txn->GetHash(), block_hash, tx_disk)) {
+            BOOST_ERROR("FindTx failed");
+        } else if (tx_disk->GetHash() != txn->GetHash()) {
+            BOOST_ERROR("Read incorrect tx");
+        }
+    }
+
+    txindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_FIXTURE_TEST_CASE(txindex_raw_cache, TestChain100Setup)
+{
+    // A cache with room for a few transactions only
+    TxIndex txindex(1 << 20, true, false, 2048);
+    txindex.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!txindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Raw lookups return the disk serialization, whether cached or not
+    for (int pass = 0; pass < 2; pass++) {
+        for (const auto& txn : m_coinbase_txns) {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            ss << txn;
+            std::vector<unsigned char> raw_tx;
+            CTransactionRef tx_disk;
+            uint256 block_hash, raw_block_hash;
+            BOOST_CHECK(txindex.FindRawTx(txn->GetHash(), raw_block_hash, raw_tx));
+            BOOST_CHECK(raw_tx == std::vector<unsigned char>(ss.begin(), ss.end()));
+            BOOST_CHECK(txindex.FindTx(txn->GetHash(), block_hash, tx_disk));
+            BOOST_CHECK(tx_disk->GetHash() == txn->GetHash());
+            BOOST_CHECK(block_hash == raw_block_hash);
+        }
+    }
+    std::vector<unsigned char> raw_tx;
+    uint256 block_hash;
+    BOOST_CHECK(!txindex.FindRawTx(InsecureRand256(), block_hash, raw_tx));
+
+    // Transactions of compressed blocks are found too
+    if (IsBlockCompressionSupported()) {
+        nBlockCompressionLevel = 3;
+        CScript coinbase_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+        const CBlock block = CreateAndProcessBlock({}, coinbase_script_pub_key);
+        nBlockCompressionLevel = DEFAULT_BLOCK_COMPRESSION_LEVEL;
+
+        CTransactionRef tx_disk;
+        BOOST_CHECK(txindex.BlockUntilSyncedToCurrentChain());
+        BOOST_CHECK(txindex.FindTx(block.vtx[0]->GetHash(), block_hash, tx_disk));
+        BOOST_CHECK(block_hash == block.GetHash());
+    }
+
+    txindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txreconciliation.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <test/setup_common.h>
+
+#include <algorithm>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sketch_decode)
+{
+    // Two sets with 1000 common ids, 20 ids only in the first and 10 only in the second
+    std::vector<uint32_t> vCommon, vFirst, vSecond;
+    std::set<uint32_t> setUsed;
+    auto newID = [&setUsed] {
+        uint32_t nShortID;
+        do {
+            nShortID = InsecureRand32();
+        } while (!setUsed.insert(nShortID).second);
+        return nShortID;
+    };
+    for (int i = 0; i < 1000; i++)
+        vCommon.push_back(newID());
+    for (int i = 0; i < 20; i++)
+        vFirst.push_back(newID());
+    for (int i = 0; i < 10; i++)
+        vSecond.push_back(newID());
+
+    const uint32_t nCells = CTxReconciliationSketch::CellsForSets(1020, 1010);
+    BOOST_CHECK(nCells > 45 && nCells % 3 == 0);
+    CTxReconciliationSketch first(nCells), second(nCells);
+    for (uint32_t nShortID : vCommon) {
+        first.Add(nShortID);
+        second.Add(nShortID);
+    }
+    for (uint32_t nShortID : vFirst)
+        first.Add(nShortID);
+    for (uint32_t nShortID : vSecond)
+        second.Add(nShortID);
+
+    // The sketch travels over the wire
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << first;
+    BOOST_CHECK_EQUAL(stream.size(), 3 + nCells * 12);
+    CTxReconciliationSketch received;
+    stream >> received;
+    BOOST_CHECK(received.IsValid());
+
+    BOOST_CHECK(received.Subtract(second));
+    std::vector<uint32_t> vAdded, vSubtracted;
+    BOOST_CHECK(received.Decode(vAdded, vSubtracted));
+    std::sort(vAdded.begin(), vAdded.end());
+    std::sort(vSubtracted.begin(), vSubtracted.end());
+    std::sort(vFirst.begin(), vFirst.end());
+    std::sort(vSecond.begin(), vSecond.end());
+    BOOST_CHECK(vAdded == vFirst);
+    BOOST_CHECK(vSubtracted == vSecond);
+
+    // Sketches of other sizes can not be subtracted
+    BOOST_CHECK(!received.Subtract(CTxReconciliationSketch(nCells + 3)));
+
+    // A difference far beyond the cells does not decode
+    CTxReconciliationSketch small(30);
+    for (int i = 0; i < 200; i++)
+        small.Add(newID());
+    BOOST_CHECK(!small.Decode(vAdded, vSubtracted));
+    BOOST_CHECK(vAdded.empty() && vSubtracted.empty());
+
+    // Identical sets leave nothing
+    CTxReconciliationSketch same(first);
+    BOOST_CHECK(same.Subtract(first));
+    BOOST_CHECK(same.Decode(vAdded, vSubtracted));
+    BOOST_CHECK(vAdded.empty() && vSubtracted.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sketch_cells)
+{
+    BOOST_CHECK_EQUAL(CTxReconciliationSketch(1).GetCellCount(), 3U);
+    BOOST_CHECK_EQUAL(CTxReconciliationSketch::CellsForSets(0, 0), RECON_SPARE_CELLS);
+    BOOST_CHECK(CTxReconciliationSketch::CellsForSets(100, 10) >= 90 * RECON_CELLS_PER_DIFF);
+    BOOST_CHECK_EQUAL(CTxReconciliationSketch::CellsForSets(100, 10), CTxReconciliationSketch::CellsForSets(10, 100));
+    // Too big a difference is announced by inv
+    BOOST_CHECK_EQUAL(CTxReconciliationSketch::CellsForSets(MAX_RECON_SET, 0), 0U);
+    BOOST_CHECK(!CTxReconciliationSketch(MAX_RECON_SKETCH_CELLS + 3).IsValid());
+}
+
+BOOST_AUTO_TEST_CASE(reconciliation_state)
+{
+    // Both sides of a connection derive the same short ids
+    CTxReconciliationState initiator(true, false, 1234, 5678), responder(false, false, 5678, 1234), other(true, false, 1234, 5679);
+    const uint256 txid = InsecureRand256();
+    BOOST_CHECK_EQUAL(initiator.GetShortID(txid), responder.GetShortID(txid));
+    BOOST_CHECK(initiator.GetShortID(txid) != other.GetShortID(txid));
+
+    BOOST_CHECK(initiator.AddTransaction(txid));
+    BOOST_CHECK(initiator.AddTransaction(txid));
+    BOOST_CHECK_EQUAL(initiator.mapLocalSet.size(), 1U);
+    while (initiator.mapLocalSet.size() < MAX_RECON_SET)
+        initiator.AddTransaction(InsecureRand256());
+    BOOST_CHECK(!initiator.AddTransaction(InsecureRand256()));
+    BOOST_CHECK_EQUAL(CTxReconciliationState::GetTransactions(initiator.mapLocalSet).size(), MAX_RECON_SET);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,13 +4,18 @@
 
 #include <chainparams.h>
 #include <net.h>
+#include <script/standard.h>
+#include <undo.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <test/setup_common.h>
 
 #include <boost/signals2/signal.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <thread>
+
 BOOST_FIXTURE_TEST_SUITE(validation_tests, TestingSetup)
 
 static void TestBlockSubsidyHalvings(const Consensus::Params& consensusParams)
@@ -74,4 +79,71 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+struct OwnThreadSubscriber : public CValidationInterface {
+    std::vector<uint256> m_txids;
+    std::thread::id m_thread_id;
+
+    void TransactionAddedToMempool(const CTransactionRef& ptx) override
+    {
+        m_txids.push_back(ptx->GetHash());
+        m_thread_id = std::this_thread::get_id();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(own_thread_signals_ordering)
+{
+    OwnThreadSubscriber sub;
+    RegisterValidationInterfaceOnOwnThread(&sub);
+
+    std::vector<uint256> txids;
+    for (int i = 0; i < 100; i++) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        CTransactionRef tx = MakeTransactionRef(std::move(mtx));
+        txids.push_back(tx->GetHash());
+        GetMainSignals().TransactionAddedToMempool(tx);
+    }
+
+    // Syncing also waits for the subscriber's own thread
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK(sub.m_txids == txids);
+    BOOST_CHECK(sub.m_thread_id != std::this_thread::get_id());
+
+    // Nothing is delivered after unregistering
+    UnregisterValidationInterface(&sub);
+    GetMainSignals().TransactionAddedToMempool(MakeTransactionRef(CMutableTransaction()));
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(sub.m_txids.size(), txids.size());
+}
+BOOST_FIXTURE_TEST_CASE(compressed_block_storage, TestChain100Setup)
+{
+    if (!IsBlockCompressionSupported()) return;
+
+    nBlockCompressionLevel = 3;
+    const CBlock block = CreateAndProcessBlock({}, GetScriptForDestination(PKHash(coinbaseKey.GetPubKey())));
+    nBlockCompressionLevel = DEFAULT_BLOCK_COMPRESSION_LEVEL;
+
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block.GetHash()));
+    BOOST_REQUIRE(pindex);
+
+    // Both the block and the raw block are read back decompressed
+    CBlock block_disk;
+    BOOST_CHECK(ReadBlockFromDisk(block_disk, pindex, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(block_disk.GetHash().ToString(), block.GetHash().ToString());
+    std::vector<uint8_t> raw_block;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw_block, pindex, Params().MessageStart()));
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    BOOST_CHECK(raw_block == std::vector<uint8_t>(ss.begin(), ss.end()));
+
+    CBlockUndo undo;
+    BOOST_CHECK(UndoReadFromDisk(undo, pindex));
+    BOOST_CHECK_EQUAL(undo.vtxundo.size() + 1, block.vtx.size());
+
+    // Raw blocks of the same files are still read
+    BOOST_CHECK(ReadBlockFromDisk(block_disk, pindex->pprev, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(block_disk.GetHash().ToString(), pindex->pprev->GetBlockHash().ToString());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
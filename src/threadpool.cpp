@@ -0,0 +1,162 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <threadpool.h>
+
+#include <tinyformat.h>
+#include <util/threadnames.h>
+
+#include <algorithm>
+
+//! The pool and queue of the worker running on this thread
+static thread_local CThreadPool* g_worker_pool = nullptr;
+static thread_local size_t g_worker_index = 0;
+
+void CThreadPool::Start(int nThreads)
+{
+    if (!m_threads.empty() || nThreads <= 0)
+        return;
+
+    for (int i = 0; i < nThreads; i++)
+        m_workers.emplace_back(new Worker());
+    for (int i = 0; i < nThreads; i++) {
+        m_threads.emplace_back([this, i] {
+            util::ThreadRename(strprintf("worker.%i", i));
+            ThreadWork(i);
+        });
+    }
+}
+
+void CThreadPool::Stop()
+{
+    if (m_threads.empty())
+        return;
+
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+    m_threads.clear();
+    m_workers.clear();
+    LOCK(m_mutex);
+    m_stop = false;
+}
+
+bool CThreadPool::TakeTask(size_t nWorker, Task& task)
+{
+    for (int priority = 0; priority < TASK_PRIORITY_COUNT; priority++) {
+        {
+            Worker& worker = *m_workers[nWorker];
+            LOCK(worker.cs);
+            std::deque<Task>& queue = worker.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                return true;
+            }
+        }
+        for (size_t n = 1; n < m_workers.size(); n++) {
+            Worker& victim = *m_workers[(nWorker + n) % m_workers.size()];
+            LOCK(victim.cs);
+            std::deque<Task>& queue = victim.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CThreadPool::ThreadWork(size_t nWorker)
+{
+    g_worker_pool = this;
+    g_worker_index = nWorker;
+    while (true) {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            while (!m_stop && m_pending == 0)
+                m_cond.wait(lock);
+            if (m_pending == 0)
+                return;
+            // Each taken count is backed by a queued task
+            m_pending--;
+        }
+        Task task;
+        while (!TakeTask(nWorker, task))
+            std::this_thread::yield();
+        task();
+    }
+}
+
+void CThreadPool::Submit(TaskPriority priority, Task task)
+{
+    if (m_threads.empty()) {
+        task();
+        return;
+    }
+
+    const size_t nWorker = g_worker_pool == this ? g_worker_index : m_next_worker++ % m_workers.size();
+    {
+        Worker& worker = *m_workers[nWorker];
+        LOCK(worker.cs);
+        worker.queues[static_cast<int>(priority)].push_back(std::move(task));
+    }
+    {
+        LOCK(m_mutex);
+        m_pending++;
+    }
+    m_cond.notify_one();
+}
+
+void CThreadPool::RunParallel(TaskPriority priority, int nCount, const std::function<void(int)>& func)
+{
+    if (nCount <= 1 || m_threads.empty()) {
+        for (int n = 0; n < nCount; n++)
+            func(n);
+        return;
+    }
+
+    // Slices are claimed by counter, so that helpers which start late find nothing left and never touch func
+    struct State {
+        const std::function<void(int)>& func;
+        const int nCount;
+        std::atomic<int> nNext{0};
+        std::atomic<int> nDone{0};
+        Mutex cs;
+        std::condition_variable cond;
+
+        State(const std::function<void(int)>& funcIn, int nCountIn) : func(funcIn), nCount(nCountIn) {}
+    };
+    auto state = std::make_shared<State>(func, nCount);
+    auto runSlices = [state] {
+        int n;
+        while ((n = state->nNext++) < state->nCount) {
+            state->func(n);
+            if (++state->nDone == state->nCount) {
+                LOCK(state->cs);
+                state->cond.notify_all();
+            }
+        }
+    };
+
+    const int nHelpers = std::min(nCount - 1, GetThreadCount());
+    for (int i = 0; i < nHelpers; i++)
+        Submit(priority, runSlices);
+    runSlices();
+
+    WAIT_LOCK(state->cs, lock);
+    while (state->nDone < nCount)
+        state->cond.wait(lock);
+}
+
+CThreadPool& GetThreadPool()
+{
+    static CThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_THREADPOOL_H
+#define BITCOIN_THREADPOOL_H
+
+#include <sync.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/** Default for -workthreads, 0 = one per core */
+static const int DEFAULT_WORK_THREADS = 0;
+/** Maximum number of shared worker threads */
+static const int MAX_WORK_THREADS = 64;
+
+/** Priority classes of the shared thread pool. Workers always run the highest class first */
+enum class TaskPriority {
+    CRITICAL = 0,   //!< Consensus critical work, e.g. flushing the coins or loading the block index
+    MINING,         //!< Deadline and proof of space lookups of the forging and harvesting threads
+    RPC,            //!< Work of RPC calls
+    BACKGROUND,     //!< Indexing and other work nobody waits for
+};
+static const int TASK_PRIORITY_COUNT = 4;
+
+/**
+ * A work-stealing pool of worker threads shared by the subsystems that split work into parallel
+ * slices, so that they do not oversubscribe the cores with threads of their own.
+ *
+ * Each worker has a queue per priority class. Tasks submitted by a worker go to its own queue
+ * and are run newest first, tasks of other threads are spread round-robin. An idle worker takes
+ * the oldest task of the highest priority class from the other workers.
+ *
+ * Usage:
+ *
+ * CThreadPool pool;
+ * pool.Start(4);
+ * pool.RunParallel(TaskPriority::MINING, 16, [&](int n) { DoSlice(n); }); // Returns when all slices are done
+ * pool.Stop();
+ */
+class CThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Worker {
+        Mutex cs;
+        std::deque<Task> queues[TASK_PRIORITY_COUNT] GUARDED_BY(cs);
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    //! Tasks submitted and not taken, for the idle workers to wait on
+    size_t m_pending GUARDED_BY(m_mutex) = 0;
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::atomic<size_t> m_next_worker{0};
+
+    void ThreadWork(size_t nWorker);
+    //! Take the task with the highest priority, own tasks newest first, other tasks oldest first
+    bool TakeTask(size_t nWorker, Task& task);
+
+public:
+    CThreadPool() {}
+    ~CThreadPool() { Stop(); }
+
+    /** Start the worker threads. Not thread safe */
+    void Start(int nThreads);
+    /** Run the submitted tasks and stop the worker threads. Not thread safe */
+    void Stop();
+
+    /** Number of worker threads, 0 if not started */
+    int GetThreadCount() const { return (int) m_threads.size(); }
+
+    /** Queue a task. Runs it on the calling thread if the pool is not started */
+    void Submit(TaskPriority priority, Task task);
+
+    /**
+     * Run func(0) .. func(nCount - 1) on the workers and the calling thread, and wait for all of them.
+     * The calling thread takes slices too, so nested calls from worker threads can not deadlock.
+     */
+    void RunParallel(TaskPriority priority, int nCount, const std::function<void(int)>& func);
+};
+
+/** The shared thread pool, started by init */
+CThreadPool& GetThreadPool();
+
+#endif // BITCOIN_THREADPOOL_H
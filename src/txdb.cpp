@@ -6,20 +6,27 @@
 #include <txdb.h>
 
 #include <chainparams.h>
+#include <dbcompaction.h>
 #include <hash.h>
 #include <key_io.h>
 #include <random.h>
 #include <shutdown.h>
+#include <threadpool.h>
 #include <ui_interface.h>
 #include <uint256.h>
+#include <util/memory.h>
 #include <util/system.h>
+#include <util/threadnames.h>
+#include <util/trace.h>
 #include <util/translation.h>
 #include <validation.h>
 
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <map>
 #include <set>
+#include <thread>
 #include <unordered_map>
 
 #include <stdint.h>
@@ -29,7 +36,7 @@
 
 /** UTXO version flag */
 static const char DB_COIN_VERSION = 'V';
-static const uint32_t DB_VERSION = 0x01;
+static const uint32_t DB_VERSION = 0x04;
 
 /** UTXO version flag */
 static const char DB_COIN = 'C';
@@ -44,14 +51,20 @@ static const char DB_LAST_BLOCK = 'l';
 
 static const char DB_COIN_INDEX = 'c';
 static const char DB_COIN_BINDPLOTTER = 'r';
+static const char DB_PLOTTER_BIND = 'q';
 static const char DB_COIN_POINT_SEND = 'P';
 static const char DB_COIN_POINT_RECEIVE = 'p';
 static const char DB_COIN_STAKING_SEND = 'S';
 static const char DB_COIN_STAKING_RECEIVE = 's';
+static const char DB_ACCOUNT_BALANCE = 'a';
+static const char DB_STAKING_RANK = 'k';
 
 static const char DB_STAKING_POOL_EPOCH_POOL = 'T';
 static const char DB_STAKING_POOL_EPOCH_USERS = 't';
 
+//! Number of key ranges a prefix is compacted in
+static const int DB_COMPACT_PREFIX_SPLIT = 16;
+
 namespace {
 
 struct CoinEntry {
@@ -146,6 +159,44 @@ struct BindPlotterValue {
     }
 };
 
+/**
+ * Bind plotter coins ordered index by plotter. The height and outpoint are stored inverted and big-endian,
+ * so that iterating forward from a plotter yields its lastest bind first.
+ */
+struct PlotterBindEntry {
+    uint64_t* plotterId;
+    uint32_t* nHeight;
+    COutPoint* outpoint;
+    char key;
+    PlotterBindEntry(const uint64_t* plotterIdIn, const uint32_t* nHeightIn, const COutPoint* outpointIn) :
+        plotterId(const_cast<uint64_t*>(plotterIdIn)),
+        nHeight(const_cast<uint32_t*>(nHeightIn)),
+        outpoint(const_cast<COutPoint*>(outpointIn)),
+        key(DB_PLOTTER_BIND) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << key;
+        ser_writedata32be(s, (uint32_t) (*plotterId >> 32));
+        ser_writedata32be(s, (uint32_t) *plotterId);
+        ser_writedata32be(s, ~*nHeight);
+        for (const unsigned char* it = outpoint->hash.begin(); it != outpoint->hash.end(); it++)
+            ser_writedata8(s, (uint8_t) ~*it);
+        ser_writedata32be(s, ~outpoint->n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        *plotterId = (uint64_t) ser_readdata32be(s) << 32;
+        *plotterId |= ser_readdata32be(s);
+        *nHeight = ~ser_readdata32be(s);
+        for (unsigned char* it = outpoint->hash.begin(); it != outpoint->hash.end(); it++)
+            *it = (unsigned char) ~ser_readdata8(s);
+        outpoint->n = ~ser_readdata32be(s);
+    }
+};
+
 struct PointSendEntry {
     COutPoint* outpoint;
     CAccountID* accountID;
@@ -320,12 +371,126 @@ struct StakingPoolUsersEntry {
     }
 };
 
+/** Running totals of an account, the sums of its index entries */
+struct AccountBalanceEntry {
+    CAccountID* accountID;
+    char key;
+    explicit AccountBalanceEntry(const CAccountID* accountIDIn) :
+        accountID(const_cast<CAccountID*>(accountIDIn)),
+        key(DB_ACCOUNT_BALANCE) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << key;
+        s << *accountID;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        s >> *accountID;
+    }
+};
+
+struct AccountBalanceValue {
+    CAmount available;
+    CAmount bindPlotter;
+    CAmount pointSend;
+    CAmount pointReceive;
+    CAmount stakingSend;
+    CAmount stakingReceive;
+    AccountBalanceValue() : available(0), bindPlotter(0), pointSend(0), pointReceive(0), stakingSend(0), stakingReceive(0) {}
+
+    bool IsNull() const {
+        return available == 0 && bindPlotter == 0 && pointSend == 0 && pointReceive == 0 && stakingSend == 0 && stakingReceive == 0;
+    }
+
+    bool IsValid() const {
+        return available >= 0 && bindPlotter >= 0 && pointSend >= 0 && pointReceive >= 0 && stakingSend >= 0 && stakingReceive >= 0;
+    }
+
+    AccountBalanceValue& operator+=(const AccountBalanceValue& delta) {
+        available += delta.available;
+        bindPlotter += delta.bindPlotter;
+        pointSend += delta.pointSend;
+        pointReceive += delta.pointReceive;
+        stakingSend += delta.stakingSend;
+        stakingReceive += delta.stakingReceive;
+        return *this;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << VARINT(available, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT(bindPlotter, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT(pointSend, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT(pointReceive, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT(stakingSend, VarIntMode::NONNEGATIVE_SIGNED);
+        s << VARINT(stakingReceive, VarIntMode::NONNEGATIVE_SIGNED);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> VARINT(available, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT(bindPlotter, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT(pointSend, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT(pointReceive, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT(stakingSend, VarIntMode::NONNEGATIVE_SIGNED);
+        s >> VARINT(stakingReceive, VarIntMode::NONNEGATIVE_SIGNED);
+    }
+};
+
+/**
+ * Staking receive balance ordered index. The balance is stored inverted and big-endian, so that iterating
+ * forward yields balance descending and then account ID ascending.
+ */
+struct StakingRankEntry {
+    CAmount* amount;
+    CAccountID* accountID;
+    char key;
+    StakingRankEntry(const CAmount* amountIn, const CAccountID* accountIDIn) :
+        amount(const_cast<CAmount*>(amountIn)),
+        accountID(const_cast<CAccountID*>(accountIDIn)),
+        key(DB_STAKING_RANK) {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        const uint64_t inverted = ~(uint64_t) *amount;
+        s << key;
+        ser_writedata32be(s, (uint32_t) (inverted >> 32));
+        ser_writedata32be(s, (uint32_t) inverted);
+        s << *accountID;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        uint64_t inverted = (uint64_t) ser_readdata32be(s) << 32;
+        inverted |= ser_readdata32be(s);
+        *amount = (CAmount) ~inverted;
+        s >> *accountID;
+    }
+};
+
+/** Leading part of an encoded coin, which holds its height */
+struct CoinHeight {
+    uint32_t nHeight;
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        uint32_t code = 0;
+        ::Unserialize(s, VARINT(code));
+        nHeight = code >> 1;
+    }
+};
+
 template <char DBPrefix>
 class CAccountCoinsViewDBCursor : public CCoinsViewCursor
 {
 public:
-    CAccountCoinsViewDBCursor(const CAccountID& accountIDIn, const CCoinsViewDB* pcoinviewdbIn, CDBIterator* pcursorIn, const uint256& hashBlockIn)
-            : CCoinsViewCursor(hashBlockIn), accountID(accountIDIn), pcoinviewdb(pcoinviewdbIn), pcursor(pcursorIn), outpoint(uint256(), 0) {
+    CAccountCoinsViewDBCursor(const CAccountID& accountIDIn, const CCoinsViewDB* pcoinviewdbIn, const CDBWrapper& dbIn, CDBIterator* pcursorIn, const uint256& hashBlockIn,
+            const CAccountCoinsFilter& filterIn = CAccountCoinsFilter())
+            : CCoinsViewCursor(hashBlockIn), accountID(accountIDIn), pcoinviewdb(pcoinviewdbIn), db(dbIn), pcursor(pcursorIn), filter(filterIn), outpoint(filter.start) {
         // Seek cursor
         pcursor->Seek(AccountEntry(DBPrefix, &outpoint, &accountID));
         TestKey();
@@ -350,17 +515,38 @@ public:
     }
 
 private:
+    //! Move to the first entry of the account from the current one that passes the filter
     void TestKey() {
-        CAccountID tempAccountID;
-        AccountEntry entry(DBPrefix, &outpoint, &tempAccountID);
-        if (!pcursor->Valid() || !pcursor->GetKey(entry) || entry.key != DBPrefix || tempAccountID != accountID) {
-            outpoint.SetNull();
+        for (; pcursor->Valid(); pcursor->Next()) {
+            CAccountID tempAccountID;
+            AccountEntry entry(DBPrefix, &outpoint, &tempAccountID);
+            if (!pcursor->GetKey(entry) || entry.key != DBPrefix || tempAccountID != accountID)
+                break;
+            if (Matches())
+                return;
         }
+        outpoint.SetNull();
+    }
+
+    bool Matches() {
+        if (filter.nMinAmount > 0) {
+            CAmount amount = 0;
+            if (!pcursor->GetValue(REF(VARINT(amount, VarIntMode::NONNEGATIVE_SIGNED))) || amount < filter.nMinAmount)
+                return false;
+        }
+        if (filter.nMinHeight > 0 || filter.nMaxHeight < std::numeric_limits<int>::max()) {
+            CoinHeight height;
+            if (!db.Read(CoinEntry(&outpoint), height) || (int64_t) height.nHeight < filter.nMinHeight || (int64_t) height.nHeight > filter.nMaxHeight)
+                return false;
+        }
+        return true;
     }
 
     const CAccountID accountID;
     const CCoinsViewDB* pcoinviewdb;
+    const CDBWrapper& db;
     std::unique_ptr<CDBIterator> pcursor;
+    const CAccountCoinsFilter filter;
     COutPoint outpoint;
 };
 
@@ -391,10 +577,187 @@ public:
     }
 };
 
+typedef std::unordered_map<CAccountID, AccountBalanceValue, CAccountIDHasher> CAccountBalanceMap;
+
+//! Dirty coins encoded by each thread per chunk, when writing coins
+static const size_t COINS_WRITE_CHUNK_PER_THREAD = 4096;
+//! Fewer dirty coins per thread are not worth another thread
+static const size_t COINS_WRITE_MIN_PER_THREAD = 1024;
+
+/** Add sign times the index entries of coin to the account totals. The coin must have an account */
+void AddCoinToAccountBalances(CAccountBalanceMap &balances, const Coin &coin, int sign) {
+    AccountBalanceValue &owner = balances[coin.GetAccountID()];
+    owner.available += sign * coin.out.nValue;
+    if (coin.IsBindPlotter()) {
+        owner.bindPlotter += sign * PROTOCOL_BINDPLOTTER_LOCKAMOUNT;
+    } else if (coin.IsPoint()) {
+        auto payload = PointPayload::As(coin.GetPayload());
+        owner.pointSend += sign * coin.out.nValue;
+        balances[payload->GetReceiverID()].pointReceive += sign * payload->GetAmount();
+    } else if (coin.IsStaking()) {
+        auto payload = StakingPayload::As(coin.GetPayload());
+        owner.stakingSend += sign * coin.out.nValue;
+        balances[payload->GetReceiverID()].stakingReceive += sign * payload->GetAmount();
+    }
+}
+
+/**
+ * Sign of the change a dirty coin makes to the index entries in database: +1 adds, -1 removes, 0 keeps.
+ * A coin that is not FRESH has to be looked up, because the database may have it or not.
+ */
+int GetCoinIndexChange(const CDBWrapper &db, const COutPoint &outpoint, const Coin &coin, bool fFresh) {
+    const bool fInDatabase = !fFresh && db.Exists(CoinIndexEntry(&outpoint, &coin.GetAccountID()));
+    if (coin.IsSpent())
+        return fInDatabase ? -1 : 0;
+    return fInDatabase ? 0 : 1;
+}
+
+AccountBalanceValue ReadAccountBalance(const CDBWrapper &db, const CAccountID &accountID) {
+    AccountBalanceValue value;
+    if (!db.Read(AccountBalanceEntry(&accountID), value))
+        return AccountBalanceValue();
+    return value;
+}
+
+//! Whether a key belongs to the coins, their index entries or the staking pool snapshots
+bool IsCoinsDataKey(const leveldb::Slice &key) {
+    if (key.empty())
+        return false;
+    switch (key[0]) {
+    case DB_COIN:
+    case DB_COIN_INDEX:
+    case DB_COIN_BINDPLOTTER:
+    case DB_PLOTTER_BIND:
+    case DB_COIN_POINT_SEND:
+    case DB_COIN_POINT_RECEIVE:
+    case DB_COIN_STAKING_SEND:
+    case DB_COIN_STAKING_RECEIVE:
+    case DB_ACCOUNT_BALANCE:
+    case DB_STAKING_RANK:
+    case DB_STAKING_POOL_EPOCH_POOL:
+    case DB_STAKING_POOL_EPOCH_USERS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** Write the database entries of a dirty coin, and add the change of its index entries to the account totals deltas */
+void WriteCoinEntries(const CDBWrapper &db, CDBBatch &batch, CAccountBalanceMap &balanceDeltas, const COutPoint &outpoint, const Coin &coin, bool fFresh) {
+    CoinEntry entry(&outpoint);
+    if (coin.IsSpent()) {
+        batch.Erase(entry);
+
+        // erase payload
+        if (!coin.GetAccountID().IsNull()) {
+            if (int sign = GetCoinIndexChange(db, outpoint, coin, fFresh))
+                AddCoinToAccountBalances(balanceDeltas, coin, sign);
+            batch.Erase(CoinIndexEntry(&outpoint, &coin.GetAccountID()));
+            if (coin.IsBindPlotter()) {
+                auto payload = BindPlotterPayload::As(coin.GetPayload());
+                uint32_t nHeight = coin.nHeight;
+                batch.Erase(BindPlotterEntry(&outpoint, &coin.GetAccountID()));
+                batch.Erase(PlotterBindEntry(&payload->GetId(), &nHeight, &outpoint));
+            } else if (coin.IsPoint()) {
+                auto payload = PointPayload::As(coin.GetPayload());
+                batch.Erase(PointSendEntry(&outpoint, &coin.GetAccountID()));
+                batch.Erase(PointReceiveEntry(&outpoint, &payload->GetReceiverID()));
+            } else if (coin.IsStaking()) {
+                auto payload = StakingPayload::As(coin.GetPayload());
+                batch.Erase(StakingSendEntry(&outpoint, &coin.GetAccountID()));
+                batch.Erase(StakingReceiveEntry(&outpoint, &payload->GetReceiverID()));
+            }
+        }
+    } else {
+        batch.Write(entry, coin);
+
+        // write payload
+        if (!coin.GetAccountID().IsNull()) {
+            if (int sign = GetCoinIndexChange(db, outpoint, coin, fFresh))
+                AddCoinToAccountBalances(balanceDeltas, coin, sign);
+            batch.Write(CoinIndexEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+            if (coin.IsBindPlotter()) {
+                auto payload = BindPlotterPayload::As(coin.GetPayload());
+                uint32_t nHeight = coin.nHeight;
+                batch.Write(BindPlotterEntry(&outpoint, &coin.GetAccountID()), BindPlotterValue(&payload->GetId(), &nHeight));
+                batch.Write(PlotterBindEntry(&payload->GetId(), &nHeight, &outpoint), coin.GetAccountID());
+            } else if (coin.IsPoint()) {
+                auto payload = PointPayload::As(coin.GetPayload());
+                batch.Write(PointSendEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                batch.Write(PointReceiveEntry(&outpoint, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
+            } else if (coin.IsStaking()) {
+                auto payload = StakingPayload::As(coin.GetPayload());
+                batch.Write(StakingSendEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                batch.Write(StakingReceiveEntry(&outpoint, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
+            }
+        }
+    }
+}
+
+/** Move the account totals in database by deltas. Must be written in the same batch as the index entries it accounts. */
+void WriteAccountBalanceDeltas(const CDBWrapper &db, CDBBatch &batch, CAccountBalanceMap &deltas) {
+    for (const auto& delta : deltas) {
+        if (delta.second.IsNull())
+            continue;
+        const AccountBalanceValue oldValue = ReadAccountBalance(db, delta.first);
+        AccountBalanceValue newValue = oldValue;
+        newValue += delta.second;
+        assert(newValue.IsValid());
+        if (newValue.IsNull())
+            batch.Erase(AccountBalanceEntry(&delta.first));
+        else
+            batch.Write(AccountBalanceEntry(&delta.first), newValue);
+        if (oldValue.stakingReceive != newValue.stakingReceive) {
+            if (oldValue.stakingReceive != 0)
+                batch.Erase(StakingRankEntry(&oldValue.stakingReceive, &delta.first));
+            if (newValue.stakingReceive != 0)
+                batch.Write(StakingRankEntry(&newValue.stakingReceive, &delta.first), '1');
+        }
+    }
+    deltas.clear();
+}
+
+}
+
+/**
+ * The chainstate holds the coins and the account indexes over them. Coins are read at random and
+ * kept by the coins cache above the database, so their reads skip the block cache. The account,
+ * bind plotter, point and staking index ranges are scanned again and again for the same accounts
+ * and plotters while mining and validating, so their scans fill it.
+ */
+static DBTuning GetCoinsDBTuning()
+{
+    DBTuning tuning;
+    tuning.uncached_read_prefixes = std::string(1, DB_COIN);
+    tuning.cached_scan_prefixes = std::string({DB_COIN_INDEX, DB_COIN_BINDPLOTTER, DB_PLOTTER_BIND,
+        DB_COIN_POINT_SEND, DB_COIN_POINT_RECEIVE, DB_COIN_STAKING_SEND, DB_COIN_STAKING_RECEIVE,
+        DB_STAKING_RANK, DB_STAKING_POOL_EPOCH_POOL, DB_STAKING_POOL_EPOCH_USERS});
+    return tuning;
+}
+
+CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true, GetCoinsDBTuning()),
+    fCheckAccountIndex(gArgs.GetBoolArg("-checkaccountindex", DEFAULT_CHECKACCOUNTINDEX))
+{
+    // The coins and index prefixes are split, so that a single compaction does not stall the disk for long
+    const char prefixes[] = {DB_COIN, DB_COIN_INDEX, DB_ACCOUNT_BALANCE, DB_PLOTTER_BIND, DB_COIN_BINDPLOTTER,
+        DB_COIN_POINT_SEND, DB_COIN_POINT_RECEIVE, DB_COIN_STAKING_SEND, DB_COIN_STAKING_RECEIVE, DB_STAKING_RANK,
+        DB_STAKING_POOL_EPOCH_POOL, DB_STAKING_POOL_EPOCH_USERS};
+    std::vector<CDBCompactionScheduler::Range> vRanges;
+    for (const char prefix : prefixes) {
+        for (int i = 0; i < DB_COMPACT_PREFIX_SPLIT; i++) {
+            const auto key_begin = std::make_pair(prefix, (unsigned char) (i * 256 / DB_COMPACT_PREFIX_SPLIT));
+            const auto key_end = i + 1 < DB_COMPACT_PREFIX_SPLIT ?
+                std::make_pair(prefix, (unsigned char) ((i + 1) * 256 / DB_COMPACT_PREFIX_SPLIT)) :
+                std::make_pair((char) (prefix + 1), (unsigned char) 0);
+            vRanges.push_back({strprintf("%c%x", prefix, i), [this, key_begin, key_end] { db.CompactRange(key_begin, key_end); }});
+        }
+    }
+    GetDBCompactionScheduler().Register(this, "chainstate", std::move(vRanges));
 }
 
-CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
+CCoinsViewDB::~CCoinsViewDB()
 {
+    GetDBCompactionScheduler().Unregister(this);
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
@@ -421,6 +784,15 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    TRACE1(coins, batch_write_entry, mapCoins.size());
+    const CBlockIndex *pindexBest = LookupBlockIndex(hashBlock);
+    bool ret = WriteCoins(mapCoins, hashBlock, pindexBest, true);
+    UncacheStakingPools(pindexBest);
+    TRACE1(coins, batch_write_exit, ret);
+    return ret;
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, const CBlockIndex *pindexBest, bool fErase, bool fComplete) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -445,57 +817,77 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
 
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            CoinEntry entry(&it->first);
-            if (it->second.coin.IsSpent()) {
-                batch.Erase(entry);
-
-                // erase payload
-                if (!it->second.coin.outAccountID.IsNull()) {
-                    batch.Erase(CoinIndexEntry(&it->first, &it->second.coin.outAccountID));
-                    if (it->second.coin.IsBindPlotter()) {
-                        batch.Erase(BindPlotterEntry(&it->first, &it->second.coin.outAccountID));
-                    } else if (it->second.coin.IsPoint()) {
-                        auto payload = PointPayload::As(it->second.coin.payload);
-                        batch.Erase(PointSendEntry(&it->first, &it->second.coin.outAccountID));
-                        batch.Erase(PointReceiveEntry(&it->first, &payload->GetReceiverID()));
-                    } else if (it->second.coin.IsStaking()) {
-                        auto payload = StakingPayload::As(it->second.coin.payload);
-                        batch.Erase(StakingSendEntry(&it->first, &it->second.coin.outAccountID));
-                        batch.Erase(StakingReceiveEntry(&it->first, &payload->GetReceiverID()));
-                    }
-                }
-            } else {
-                batch.Write(entry, it->second.coin);
-
-                // write payload
-                if (!it->second.coin.outAccountID.IsNull()) {
-                    batch.Write(CoinIndexEntry(&it->first, &it->second.coin.outAccountID), VARINT(it->second.coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
-                    if (it->second.coin.IsBindPlotter()) {
-                        auto payload = BindPlotterPayload::As(it->second.coin.payload);
-                        uint32_t nHeight = it->second.coin.nHeight;
-                        batch.Write(BindPlotterEntry(&it->first, &it->second.coin.outAccountID), BindPlotterValue(&payload->GetId(), &nHeight));
-                    } else if (it->second.coin.IsPoint()) {
-                        auto payload = PointPayload::As(it->second.coin.payload);
-                        batch.Write(PointSendEntry(&it->first, &it->second.coin.outAccountID), VARINT(it->second.coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
-                        batch.Write(PointReceiveEntry(&it->first, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
-                    } else if (it->second.coin.IsStaking()) {
-                        auto payload = StakingPayload::As(it->second.coin.payload);
-                        batch.Write(StakingSendEntry(&it->first, &it->second.coin.outAccountID), VARINT(it->second.coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
-                        batch.Write(StakingReceiveEntry(&it->first, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
-                    }
-                }
+    // Account totals deltas of the current batch, measured against the index entries already in database
+    CAccountBalanceMap balanceDeltas;
+
+    // Kept entries of the current batch that are FRESH, these exist in database once it is committed
+    std::vector<CCoinsMap::iterator> vFreshWritten;
+    auto commitBatch = [&]() {
+        LOCK(cs_write);
+        bool ret = db.WriteBatch(batch);
+        for (const CCoinsMap::iterator &itFresh : vFreshWritten)
+            itFresh->second.flags &= ~CCoinsCacheEntry::FRESH;
+        vFreshWritten.clear();
+        return ret;
+    };
+
+    // Each chunk of dirty coins is encoded into sub-batches on the shared thread pool, which are appended in order
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_COINS_WRITE_THREADS));
+    std::vector<CCoinsMap::iterator> vChunk;
+    vChunk.reserve(nThreads * COINS_WRITE_CHUNK_PER_THREAD);
+    auto writeChunk = [&]() {
+        const int nSlices = std::max(1, std::min(nThreads, (int) (vChunk.size() / COINS_WRITE_MIN_PER_THREAD)));
+        auto writeSlice = [&](CDBBatch &sliceBatch, CAccountBalanceMap &sliceDeltas, int nSlice) {
+            const size_t nBegin = vChunk.size() * nSlice / nSlices, nEnd = vChunk.size() * (nSlice + 1) / nSlices;
+            for (size_t i = nBegin; i < nEnd; i++)
+                WriteCoinEntries(db, sliceBatch, sliceDeltas, vChunk[i]->first, vChunk[i]->second.coin, vChunk[i]->second.flags & CCoinsCacheEntry::FRESH);
+        };
+        if (nSlices == 1) {
+            writeSlice(batch, balanceDeltas, 0);
+        } else {
+            std::vector<CDBBatch> vBatches;
+            vBatches.reserve(nSlices - 1);
+            for (int i = 1; i < nSlices; i++)
+                vBatches.emplace_back(db);
+            std::vector<CAccountBalanceMap> vDeltas(nSlices - 1);
+            GetThreadPool().RunParallel(TaskPriority::CRITICAL, nSlices, [&](int i) {
+                if (i == 0)
+                    writeSlice(batch, balanceDeltas, 0);
+                else
+                    writeSlice(vBatches[i - 1], vDeltas[i - 1], i);
+            });
+            for (int i = 0; i < nSlices - 1; i++) {
+                batch.Append(vBatches[i]);
+                for (const auto& delta : vDeltas[i])
+                    balanceDeltas[delta.first] += delta.second;
             }
-            changed++;
         }
 
+        for (const CCoinsMap::iterator &itWritten : vChunk) {
+            if (fErase)
+                mapCoins.erase(itWritten);
+            else if (itWritten->second.flags & CCoinsCacheEntry::FRESH)
+                vFreshWritten.push_back(itWritten);
+        }
+        changed += vChunk.size();
+        vChunk.clear();
+    };
+
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         count++;
         CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (itOld->second.flags & CCoinsCacheEntry::DIRTY)
+            vChunk.push_back(itOld);
+        else if (fErase)
+            mapCoins.erase(itOld);
+        if (vChunk.size() < (size_t) nThreads * COINS_WRITE_CHUNK_PER_THREAD && it != mapCoins.end())
+            continue;
+
+        writeChunk();
         if (batch.SizeEstimate() > batch_size) {
+            WriteAccountBalanceDeltas(db, batch, balanceDeltas);
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-            db.WriteBatch(batch);
+            commitBatch();
             batch.Clear();
             if (crash_simulate) {
                 static FastRandomContext rng;
@@ -508,20 +900,27 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     }
 
     // first commit the last batch
+    WriteAccountBalanceDeltas(db, batch, balanceDeltas);
     if (batch.SizeEstimate() > 0) {
-        db.WriteBatch(batch);
+        commitBatch();
         batch.Clear();
     }
 
     // Try write staking pool status
-    TrySnapshotStakingPoolStatus(LookupBlockIndex(hashBlock), Params().GetConsensus());
+    if (pindexBest != nullptr)
+        TrySnapshotStakingPoolStatus(pindexBest, Params().GetConsensus());
+
+    if (!fComplete) {
+        LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database in transition...\n", (unsigned int)changed, (unsigned int)count);
+        return true;
+    }
 
     // In the last batch, mark the database as consistent with hashBlock again.
     batch.Erase(DB_HEAD_BLOCKS);
     batch.Write(DB_BEST_BLOCK, hashBlock);
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-    bool ret = db.WriteBatch(batch);
+    bool ret = commitBatch();
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
 
     return ret;
@@ -536,7 +935,9 @@ CCoinsViewCursorRef CCoinsViewDB::Cursor() const {
             /* It seems that there are no "const iterators" for LevelDB.  Since we
                only need read operations on it, use a const-cast to get around
                that restriction.  */
-            pcursor->Seek(DB_COIN);
+            // The whole coin set is scanned, so read it ahead in the background
+            pcursor->EnableReadAhead();
+            pcursor->SeekPrefix(DB_COIN);
             // Cache key of first record
             if (pcursor->Valid()) {
                 CoinEntry entry(&keyTmp.second);
@@ -581,23 +982,43 @@ CCoinsViewCursorRef CCoinsViewDB::Cursor() const {
 }
 
 CCoinsViewCursorRef CCoinsViewDB::Cursor(const CAccountID &accountID) const {
-    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_INDEX> >(accountID, this, db.NewIterator(), GetBestBlock());
+    return Cursor(accountID, CAccountCoinsFilter());
+}
+
+CCoinsViewCursorRef CCoinsViewDB::Cursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const {
+    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_INDEX> >(accountID, this, db, db.NewIterator(DB_COIN_INDEX), GetBestBlock(), filter);
 }
 
 CCoinsViewCursorRef CCoinsViewDB::PointSendCursor(const CAccountID &accountID) const {
-    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_POINT_SEND> >(accountID, this, db.NewIterator(), GetBestBlock());
+    return PointSendCursor(accountID, CAccountCoinsFilter());
+}
+
+CCoinsViewCursorRef CCoinsViewDB::PointSendCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const {
+    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_POINT_SEND> >(accountID, this, db, db.NewIterator(DB_COIN_POINT_SEND), GetBestBlock(), filter);
 }
 
 CCoinsViewCursorRef CCoinsViewDB::PointReceiveCursor(const CAccountID &accountID) const {
-    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_POINT_RECEIVE> >(accountID, this, db.NewIterator(), GetBestBlock());
+    return PointReceiveCursor(accountID, CAccountCoinsFilter());
+}
+
+CCoinsViewCursorRef CCoinsViewDB::PointReceiveCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const {
+    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_POINT_RECEIVE> >(accountID, this, db, db.NewIterator(DB_COIN_POINT_RECEIVE), GetBestBlock(), filter);
 }
 
 CCoinsViewCursorRef CCoinsViewDB::StakingSendCursor(const CAccountID &accountID) const {
-    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_STAKING_SEND> >(accountID, this, db.NewIterator(), GetBestBlock());
+    return StakingSendCursor(accountID, CAccountCoinsFilter());
+}
+
+CCoinsViewCursorRef CCoinsViewDB::StakingSendCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const {
+    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_STAKING_SEND> >(accountID, this, db, db.NewIterator(DB_COIN_STAKING_SEND), GetBestBlock(), filter);
 }
 
 CCoinsViewCursorRef CCoinsViewDB::StakingReceiveCursor(const CAccountID &accountID) const {
-    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_STAKING_RECEIVE> >(accountID, this, db.NewIterator(), GetBestBlock());
+    return StakingReceiveCursor(accountID, CAccountCoinsFilter());
+}
+
+CCoinsViewCursorRef CCoinsViewDB::StakingReceiveCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const {
+    return std::make_shared< CAccountCoinsViewDBCursor<DB_COIN_STAKING_RECEIVE> >(accountID, this, db, db.NewIterator(DB_COIN_STAKING_RECEIVE), GetBestBlock(), filter);
 }
 
 size_t CCoinsViewDB::EstimateSize() const
@@ -605,8 +1026,59 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins) const {
-    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const {
+    LOCK(cs_write);
+    // Read totals from database
+    AccountBalanceValue value = ReadAccountBalance(db, accountID);
+
+    // Apply modified coin
+    {
+        CAccountBalanceMap deltas;
+        modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+            if (coin.GetAccountID().IsNull())
+                return;
+            if (coin.GetAccountID() != accountID &&
+                (!coin.IsPoint() || PointPayload::As(coin.GetPayload())->GetReceiverID() != accountID) &&
+                (!coin.IsStaking() || StakingPayload::As(coin.GetPayload())->GetReceiverID() != accountID)) {
+                // NOT mine and NOT debit to me
+                return;
+            }
+
+            if (int sign = GetCoinIndexChange(db, outpoint, coin, fFresh))
+                AddCoinToAccountBalances(deltas, coin, sign);
+        });
+        auto itDelta = deltas.find(accountID);
+        if (itDelta != deltas.end())
+            value += itDelta->second;
+        assert(value.IsValid());
+    }
+
+    if (balanceBindPlotter != nullptr) {
+        *balanceBindPlotter = value.bindPlotter;
+    }
+    if (balancePoint != nullptr) {
+        if (balancePoint[0] != -1) balancePoint[0] = value.pointSend;
+        if (balancePoint[1] != -1) balancePoint[1] = value.pointReceive;
+    }
+    if (balanceStaking != nullptr) {
+        if (balanceStaking[0] != -1) balanceStaking[0] = value.stakingSend;
+        if (balanceStaking[1] != -1) balanceStaking[1] = value.stakingReceive;
+    }
+
+    if (fCheckAccountIndex) {
+        CAmount scanBindPlotter = 0, scanPoint[2] = {0, 0}, scanStaking[2] = {0, 0};
+        CAmount scanAvailable = ScanAccountBalance(accountID, &scanBindPlotter, scanPoint, scanStaking, modifiedCoins);
+        assert(scanAvailable == value.available);
+        assert(scanBindPlotter == value.bindPlotter);
+        assert(scanPoint[0] == value.pointSend && scanPoint[1] == value.pointReceive);
+        assert(scanStaking[0] == value.stakingSend && scanStaking[1] == value.stakingReceive);
+    }
+
+    return value.available;
+}
+
+CAmount CCoinsViewDB::ScanAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_COIN_INDEX));
 
     // Balance
     CAmount availableBalance = 0;
@@ -627,20 +1099,17 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
         }
 
         // Apply modified coin
-        for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-            if (!(it->second.flags & CCoinsCacheEntry::DIRTY))
-                continue;
-
-            if (it->second.coin.outAccountID == accountID) {
-                if (it->second.coin.IsSpent()) {
-                    if (db.Exists(CoinIndexEntry(&it->first, &it->second.coin.outAccountID)))
-                        availableBalance -= it->second.coin.out.nValue;
+        modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+            if (coin.GetAccountID() == accountID) {
+                if (coin.IsSpent()) {
+                    if (db.Exists(CoinIndexEntry(&outpoint, &coin.GetAccountID())))
+                        availableBalance -= coin.out.nValue;
                 } else {
-                    if (!db.Exists(CoinIndexEntry(&it->first, &it->second.coin.outAccountID)))
-                        availableBalance += it->second.coin.out.nValue;
+                    if (!db.Exists(CoinIndexEntry(&outpoint, &coin.GetAccountID())))
+                        availableBalance += coin.out.nValue;
                 }
             }
-        }
+        });
         assert(availableBalance >= 0);
     }
 
@@ -668,18 +1137,18 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
         }
 
         // Apply modified coin
-        for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-            if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsBindPlotter())
-                continue;
+        modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+            if (!coin.IsBindPlotter())
+                return;
 
-            if (selected.count(it->first)) {
-                if (it->second.coin.IsSpent()) {
+            if (selected.count(outpoint)) {
+                if (coin.IsSpent()) {
                     *balanceBindPlotter -= PROTOCOL_BINDPLOTTER_LOCKAMOUNT;
                 }
-            } else if (it->second.coin.outAccountID == accountID && !it->second.coin.IsSpent()) {
+            } else if (coin.GetAccountID() == accountID && !coin.IsSpent()) {
                 *balanceBindPlotter += PROTOCOL_BINDPLOTTER_LOCKAMOUNT;
             }
-        }
+        });
 
         assert(*balanceBindPlotter >= 0);
     }
@@ -708,19 +1177,19 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
             }
 
             // Apply modified coin
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsPoint())
-                    continue;
+            modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+                if (!coin.IsPoint())
+                    return;
 
-                auto itSelected = selected.find(it->first);
+                auto itSelected = selected.find(outpoint);
                 if (itSelected != selected.cend()) {
-                    if (it->second.coin.IsSpent()) {
+                    if (coin.IsSpent()) {
                         balancePoint[0] -= itSelected->second;
                     }
-                } else if (it->second.coin.outAccountID == accountID && !it->second.coin.IsSpent()) {
-                    balancePoint[0] += it->second.coin.out.nValue;
+                } else if (coin.GetAccountID() == accountID && !coin.IsSpent()) {
+                    balancePoint[0] += coin.out.nValue;
                 }
-            }
+            });
 
             assert(balancePoint[0] >= 0);
         }
@@ -747,20 +1216,20 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
             }
 
             // Apply modified coin
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsPoint())
-                    continue;
+            modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+                if (!coin.IsPoint())
+                    return;
 
-                auto payload = PointPayload::As(it->second.coin.payload);
-                auto itSelected = selected.find(it->first);
+                auto payload = PointPayload::As(coin.GetPayload());
+                auto itSelected = selected.find(outpoint);
                 if (itSelected != selected.cend()) {
-                    if (it->second.coin.IsSpent()) {
+                    if (coin.IsSpent()) {
                         balancePoint[1] -= itSelected->second;
                     }
-                } else if (payload->GetReceiverID() == accountID && !it->second.coin.IsSpent()) {
+                } else if (payload->GetReceiverID() == accountID && !coin.IsSpent()) {
                     balancePoint[1] += payload->GetAmount();
                 }
-            }
+            });
 
             assert(balancePoint[1] >= 0);
         }
@@ -790,19 +1259,19 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
             }
 
             // Apply modified coin
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsStaking())
-                    continue;
+            modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+                if (!coin.IsStaking())
+                    return;
 
-                auto itSelected = selected.find(it->first);
+                auto itSelected = selected.find(outpoint);
                 if (itSelected != selected.cend()) {
-                    if (it->second.coin.IsSpent()) {
+                    if (coin.IsSpent()) {
                         balanceStaking[0] -= itSelected->second;
                     }
-                } else if (it->second.coin.outAccountID == accountID && !it->second.coin.IsSpent()) {
-                    balanceStaking[0] += it->second.coin.out.nValue;
+                } else if (coin.GetAccountID() == accountID && !coin.IsSpent()) {
+                    balanceStaking[0] += coin.out.nValue;
                 }
-            }
+            });
 
             assert(balanceStaking[0] >= 0);
         }
@@ -829,20 +1298,20 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
             }
 
             // Apply modified coin
-            for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-                if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsStaking())
-                    continue;
+            modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+                if (!coin.IsStaking())
+                    return;
 
-                auto payload = StakingPayload::As(it->second.coin.payload);
-                auto itSelected = selected.find(it->first);
+                auto payload = StakingPayload::As(coin.GetPayload());
+                auto itSelected = selected.find(outpoint);
                 if (itSelected != selected.cend()) {
-                    if (it->second.coin.IsSpent()) {
+                    if (coin.IsSpent()) {
                         balanceStaking[1] -= itSelected->second;
                     }
-                } else if (payload->GetReceiverID() == accountID && !it->second.coin.IsSpent()) {
+                } else if (payload->GetReceiverID() == accountID && !coin.IsSpent()) {
                     balanceStaking[1] += payload->GetAmount();
                 }
-            }
+            });
 
             assert(balanceStaking[1] >= 0);
         }
@@ -855,7 +1324,7 @@ CAmount CCoinsViewDB::GetAccountBalance(const CAccountID &accountID, CAmount *ba
 CBindPlotterCoinsMap CCoinsViewDB::GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId) const {
     CBindPlotterCoinsMap outpoints;
 
-    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_COIN_BINDPLOTTER));
     COutPoint tempOutpoint(uint256(), 0);
     CAccountID tempAccountID = accountID;
     uint64_t tempPlotterId = 0;
@@ -883,23 +1352,20 @@ CBindPlotterCoinsMap CCoinsViewDB::GetAccountBindPlotterEntries(const CAccountID
 CBindPlotterCoinsMap CCoinsViewDB::GetBindPlotterEntries(const uint64_t &plotterId) const {
     CBindPlotterCoinsMap outpoints;
 
-    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
-    COutPoint tempOutpoint(uint256(), 0);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_PLOTTER_BIND));
+    COutPoint tempOutpoint(uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"), 0xffffffff);
+    uint64_t tempPlotterId = plotterId;
+    uint32_t tempHeight = 0xffffffff;
     CAccountID tempAccountID;
-    uint64_t tempPlotterId = 0;
-    uint32_t tempHeight = 0;
-    BindPlotterEntry entry(&tempOutpoint, &tempAccountID);
-    BindPlotterValue value(&tempPlotterId, &tempHeight);
+    PlotterBindEntry entry(&tempPlotterId, &tempHeight, &tempOutpoint);
     for (pcursor->Seek(entry); pcursor->Valid(); pcursor->Next()) {
-        if (pcursor->GetKey(entry) && entry.key == DB_COIN_BINDPLOTTER) {
-            if (!pcursor->GetValue(value))
+        if (pcursor->GetKey(entry) && entry.key == DB_PLOTTER_BIND && tempPlotterId == plotterId) {
+            if (!pcursor->GetValue(tempAccountID))
                 throw std::runtime_error("Database read error");
-            if (tempPlotterId == plotterId) {
-                CBindPlotterCoinInfo &info = outpoints[tempOutpoint];
-                info.nHeight = static_cast<int>(tempHeight);
-                info.accountID = tempAccountID;
-                info.plotterId = tempPlotterId;
-            }
+            CBindPlotterCoinInfo &info = outpoints[tempOutpoint];
+            info.nHeight = static_cast<int>(tempHeight);
+            info.accountID = tempAccountID;
+            info.plotterId = tempPlotterId;
         } else {
             break;
         }
@@ -908,55 +1374,81 @@ CBindPlotterCoinsMap CCoinsViewDB::GetBindPlotterEntries(const uint64_t &plotter
     return outpoints;
 }
 
-CAccountBalanceList CCoinsViewDB::GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins) const {
+bool CCoinsViewDB::GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded) const {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_PLOTTER_BIND));
+    COutPoint tempOutpoint(uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"), 0xffffffff);
+    uint64_t tempPlotterId = plotterId;
+    uint32_t tempHeight = 0xffffffff;
+    CAccountID tempAccountID;
+    PlotterBindEntry key(&tempPlotterId, &tempHeight, &tempOutpoint);
+    for (pcursor->Seek(key); pcursor->Valid(); pcursor->Next()) {
+        if (pcursor->GetKey(key) && key.key == DB_PLOTTER_BIND && tempPlotterId == plotterId) {
+            if (excluded.count(tempOutpoint))
+                continue;
+            if (!pcursor->GetValue(tempAccountID))
+                throw std::runtime_error("Database read error");
+            entry.first = tempOutpoint;
+            entry.second.nHeight = static_cast<int>(tempHeight);
+            entry.second.accountID = tempAccountID;
+            entry.second.plotterId = tempPlotterId;
+            return true;
+        } else {
+            break;
+        }
+    }
+
+    return false;
+}
+
+CAccountBalanceList CCoinsViewDB::GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins) const {
+    LOCK(cs_write);
     assert(n > 0);
-    std::unordered_map<CAccountID, CAmount, CAccountIDHasher> allStakings;
-    
-    // all
+
+    // Receivers moved by the dirty coins
+    CAccountBalanceMap deltas;
+    modifiedCoins.ForEach([&](const COutPoint& outpoint, const Coin& coin, bool fFresh) {
+        if (!coin.IsStaking())
+            return;
+
+        if (int sign = GetCoinIndexChange(db, outpoint, coin, fFresh))
+            AddCoinToAccountBalances(deltas, coin, sign);
+    });
+
+    std::unordered_set<CAccountID, CAccountIDHasher> modified;
+    CAccountBalanceList candidates;
+    candidates.reserve(deltas.size() + n);
+    for (const auto& item : deltas) {
+        if (item.second.stakingReceive == 0)
+            continue;
+        const CAmount balance = ReadAccountBalance(db, item.first).stakingReceive + item.second.stakingReceive;
+        assert(balance >= 0);
+        modified.insert(item.first);
+        if (balance != 0)
+            candidates.push_back({item.first, balance});
+    }
+
+    // Top unmodified accounts from the ordered index
     {
-        // Read from database
-        std::unordered_map<COutPoint,CAmount,COutPointHasher> selected;
+        int nUnmodified = 0;
+        CAmount tempAmount = 0;
         CAccountID tempAccountID;
-        COutPoint tempOutpoint(uint256(), 0);
-        StakingReceiveEntry entry(&tempOutpoint, &tempAccountID);
-        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
-        for (pcursor->Seek(entry); pcursor->Valid();  pcursor->Next()) {
-            if (pcursor->GetKey(entry) && entry.key == DB_COIN_STAKING_RECEIVE) {
-                CAmount value = 0;
-                if (!pcursor->GetValue(REF(VARINT(value, VarIntMode::NONNEGATIVE_SIGNED))))
-                    throw std::runtime_error("Database read error");
-                allStakings[tempAccountID] += value;
-                selected[tempOutpoint] = value;
+        StakingRankEntry entry(&tempAmount, &tempAccountID);
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_STAKING_RANK));
+        for (pcursor->Seek(DB_STAKING_RANK); pcursor->Valid() && nUnmodified < n; pcursor->Next()) {
+            if (pcursor->GetKey(entry) && entry.key == DB_STAKING_RANK) {
+                if (modified.count(tempAccountID))
+                    continue;
+                candidates.push_back({tempAccountID, tempAmount});
+                nUnmodified++;
             } else {
                 break;
             }
         }
-
-        // Apply modified coin
-        for (CCoinsMap::const_iterator it = mapModifiedCoins.cbegin(); it != mapModifiedCoins.cend(); it++) {
-            if (!(it->second.flags & CCoinsCacheEntry::DIRTY) || !it->second.coin.IsStaking())
-                continue;
-
-            auto payload = StakingPayload::As(it->second.coin.payload);
-            auto itSelected = selected.find(it->first);
-            if (itSelected != selected.cend()) {
-                if (it->second.coin.IsSpent()) {
-                    auto it2 = allStakings.find(payload->GetReceiverID());
-                    assert(it2 != allStakings.end());
-                    it2->second -= itSelected->second;
-                    assert(it2->second >= 0);
-                    if (it2->second == 0)
-                        allStakings.erase(it2);
-                }
-            } else if (!it->second.coin.IsSpent()) {
-                allStakings[payload->GetReceiverID()] += payload->GetAmount();
-            }
-        }
     }
 
     // sort
-    CAccountBalanceList topN(std::min((size_t) n, allStakings.size()));
-    std::partial_sort_copy(allStakings.begin(), allStakings.end(), topN.begin(), topN.end(),
+    CAccountBalanceList topN(std::min((size_t) n, candidates.size()));
+    std::partial_sort_copy(candidates.begin(), candidates.end(), topN.begin(), topN.end(),
         [](const CAccountBalance &l, const CAccountBalance &r) {
             if (l.second == r.second)
                 return l.first < r.first;
@@ -984,134 +1476,82 @@ void CCoinsViewDB::TrySnapshotStakingPoolStatus(const CBlockIndex *pEpochInitInd
         CPoolStatus() : stakeAmount(0), rewardAmount(0) {}
     };
     typedef std::unordered_map<CAccountID, CUserStatus, CAccountIDHasher> CUserStatusMap;
-    typedef std::unordered_map<CAccountID, CUserStatusMap, CAccountIDHasher> CPoolUserStatusMap; // <pool, user> => state
     typedef std::unordered_map<CAccountID, CPoolStatus, CAccountIDHasher> CPoolStatusMap;
 
-    CPoolUserStatusMap epochPoolUsers(1024);
-    std::unordered_map<CAccountID, COutPoint, CAccountIDHasher> enabledPools(1024);
-
-    // load staking pool and user from db
-    {
-        CAccountID tempAccountID;
-        COutPoint tempOutpoint(uint256(), 0);
-        StakingReceiveEntry entry(&tempOutpoint, &tempAccountID);
-        std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
-        for (pcursor->Seek(entry); pcursor->Valid(); pcursor->Next()) {
-            if (pcursor->GetKey(entry) && entry.key == DB_COIN_STAKING_RECEIVE) {
-                Coin coin;
-                if (!db.Read(CoinEntry(entry.outpoint), coin) || !coin.IsStaking())
-                    throw std::runtime_error("Database read invalid staking coin");
-
-                const auto payload = StakingPayload::As(coin.payload);
-                LogPrint(BCLog::COINDB, "  New staking coin: from=%s to=%s amount=%d\n", coin.outAccountID.ToString(), EncodeDestination(ExtractDestination(payload->GetReceiverID())), payload->GetAmount() / COIN);
-                if (coin.outAccountID == consensusParams.SaturnStakingGenesisID) {
-                    // initial pool
-                    if (coin.out.nValue < GetInitialStakingPoolAmount((int) coin.nHeight, consensusParams)) {
-                        continue;
-                    }
-                    enabledPools[payload->GetReceiverID()] = *(entry.outpoint);
-                } else {
-                    // staking
-                    if (coin.nHeight + payload->lockBlocks < (uint32_t) pEpochInitIndex->nHeight) {
-                        // unlocked
-                        continue;
-                    }
-
-                    auto &poolUsers = epochPoolUsers[payload->GetReceiverID()];
-                    poolUsers[coin.outAccountID].stakeAmount += payload->GetAmount();
-                }
-            } else {
-                break;
-            }
-        }
-
-        // filter staking pools
-        for (auto it = epochPoolUsers.begin(); it != epochPoolUsers.end();) {
-            if (enabledPools.count(it->first) == 0) {
-                it = epochPoolUsers.erase(it);
-            } else {
-                it++;
-            }
-        }
-    }
-
     // previous epoch status
+    bool fPrevEpochPools = false;
+    uint256 prevEpochHash;
+    CPoolStatusMap prevEpochPoolStatus;
+    CAmount prevEpochPoolstakeAmount = 0;
     if (pEpochInitIndex->nHeight >= consensusParams.nSaturnActiveHeight + consensusParams.nSaturnEpockBlocks) {
-        CPoolStatusMap prevEpochPoolStatus(epochPoolUsers.size());
-
         const CBlockIndex *pPrevEpochInitIndex = pEpochInitIndex; // pEpochInitIndex is previous epoch end block
         for (int i = 0; i < consensusParams.nSaturnEpockBlocks; i++) {
             CAmount nAmount = GetBlockStakingPoolSubsidy(pPrevEpochInitIndex->nHeight, consensusParams);
-            CAccountID poolID = ExtractAccountID(pPrevEpochInitIndex->minerRewardTxOut.scriptPubKey);
+            const CAccountID& poolID = pPrevEpochInitIndex->generatorAccountID;
             LogPrint(BCLog::COINDB, "  PreEpoch=%d pool=%s amount=%d\n", pPrevEpochInitIndex->nHeight, EncodeDestination(ExtractDestination(poolID)), nAmount);
 
             prevEpochPoolStatus[poolID].rewardAmount += nAmount;
             pPrevEpochInitIndex = pPrevEpochInitIndex->pprev;
         }
         assert(pPrevEpochInitIndex->nHeight % consensusParams.nSaturnEpockBlocks == 0);
-        const uint256 prevEpochHash = pPrevEpochInitIndex->GetBlockHash();
+        prevEpochHash = pPrevEpochInitIndex->GetBlockHash();
 
         CStakingPoolList prevEpochPools;
         if (db.Read(StakingPoolEntry(&prevEpochHash), prevEpochPools) && !prevEpochPools.empty()) {
-            CAmount prevEpochPoolstakeAmount = 0;
+            fPrevEpochPools = true;
             for (auto &pool : prevEpochPools) {
                 prevEpochPoolstakeAmount += pool.stakeAmount;
                 prevEpochPoolStatus[pool.poolID].stakeAmount = pool.stakeAmount;
             }
+        }
+    }
+
+    const uint256 epochHash = pEpochInitIndex->GetBlockHash();
+    CDBBatch batch(db);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    size_t userCount = 0;
+    CStakingPoolList pools;
+
+    // Write the users of a pool, merged with the pending amounts of the previous epoch snapshot
+    auto writePool = [&](const CAccountID &poolID, const COutPoint &poolPos, CUserStatusMap &poolUsers) {
+        if (fPrevEpochPools && !poolUsers.empty()) {
+            auto itPoolState = prevEpochPoolStatus.find(poolID);
+            const CPoolStatus poolState = itPoolState != prevEpochPoolStatus.end() ? itPoolState->second : CPoolStatus();
 
             // load previous epoch user pending
-            for (auto itPool = epochPoolUsers.begin(); itPool != epochPoolUsers.end(); itPool++) {
-                const CAccountID &poolID = itPool->first;
-                CUserStatusMap &poolUsers = itPool->second;
-
-                CPoolStatus &poolState = prevEpochPoolStatus[poolID];
-
-                // pool users
-                CStakingPoolUserList preEpochPoolUsers;
-                if (db.Read(StakingPoolUsersEntry(&prevEpochHash, &poolID), preEpochPoolUsers)) {
-                    for (auto const &preEpochPoolUser : preEpochPoolUsers) {
-                        auto itPoolUser = poolUsers.find(preEpochPoolUser.accountID);
-                        if (itPoolUser != poolUsers.end()) {
-                            const CAccountID &userID = itPoolUser->first;
-                            CUserStatus &userStatus = itPoolUser->second;
-
-                            // check withdrawn
-                            if (preEpochPoolUser.withdrawableAmount >= PROTOCOL_SATURN_STAKING_MIN_WITHDRAWABLE_AMOUNT) {
-                                // check if the withdraw coin is still in db
-                                COutPoint withdrawOutpoint = CreateStakePendingCoinOutPoint(prevEpochHash, poolID, userID);
-                                if (db.Exists(CoinEntry(&withdrawOutpoint))) {
-                                    userStatus.withdrawableAmount = preEpochPoolUser.withdrawableAmount;
-                                }
-                            } else {
+            CStakingPoolUserList preEpochPoolUsers;
+            if (db.Read(StakingPoolUsersEntry(&prevEpochHash, &poolID), preEpochPoolUsers)) {
+                for (auto const &preEpochPoolUser : preEpochPoolUsers) {
+                    auto itPoolUser = poolUsers.find(preEpochPoolUser.accountID);
+                    if (itPoolUser != poolUsers.end()) {
+                        const CAccountID &userID = itPoolUser->first;
+                        CUserStatus &userStatus = itPoolUser->second;
+
+                        // check withdrawn
+                        if (preEpochPoolUser.withdrawableAmount >= PROTOCOL_SATURN_STAKING_MIN_WITHDRAWABLE_AMOUNT) {
+                            // check if the withdraw coin is still in db
+                            COutPoint withdrawOutpoint = CreateStakePendingCoinOutPoint(prevEpochHash, poolID, userID);
+                            if (db.Exists(CoinEntry(&withdrawOutpoint))) {
                                 userStatus.withdrawableAmount = preEpochPoolUser.withdrawableAmount;
                             }
+                        } else {
+                            userStatus.withdrawableAmount = preEpochPoolUser.withdrawableAmount;
+                        }
 
-                            // add pre epoch reward
-                            if (poolState.rewardAmount > 0 && prevEpochPoolstakeAmount > 0) {
-                                userStatus.withdrawableAmount += CalcStakePoolUserReward(poolState.rewardAmount, preEpochPoolUser.stakeAmount, prevEpochPoolstakeAmount);
-                            }
+                        // add pre epoch reward
+                        if (poolState.rewardAmount > 0 && prevEpochPoolstakeAmount > 0) {
+                            userStatus.withdrawableAmount += CalcStakePoolUserReward(poolState.rewardAmount, preEpochPoolUser.stakeAmount, prevEpochPoolstakeAmount);
                         }
                     }
                 }
             }
         }
-    }
-
-    // write to db
-    const uint256 epochHash = pEpochInitIndex->GetBlockHash();
-    CDBBatch batch(db);
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    size_t userCount = 0;
-    CStakingPoolList pools;
-    pools.reserve(epochPoolUsers.size());
-    for (auto itPool = enabledPools.cbegin(); itPool != enabledPools.cend(); itPool++) {
-        const CAccountID &poolID = itPool->first;
-        const CUserStatusMap &poolUsers = epochPoolUsers[poolID];
 
         CAmount totalPoolStakeAmount = 0;
 
         // pool users
         CStakingPoolUserList users;
+        users.reserve(poolUsers.size());
         for (auto itPoolUser = poolUsers.cbegin(); itPoolUser != poolUsers.cend(); itPoolUser++) {
             const CAccountID &userID = itPoolUser->first;
             const CUserStatus &userStatus = itPoolUser->second;
@@ -1142,9 +1582,63 @@ void CCoinsViewDB::TrySnapshotStakingPoolStatus(const CBlockIndex *pEpochInitInd
         }
         userCount += users.size();
 
-        pools.push_back(StakingPool(poolID, itPool->second, totalPoolStakeAmount));
+        pools.push_back(StakingPool(poolID, poolPos, totalPoolStakeAmount));
         LogPrint(BCLog::COINDB, "  New Staking pool %s: amount=%d users=%u\n", EncodeDestination(ExtractDestination(poolID)), totalPoolStakeAmount / COIN, (unsigned int)users.size());
+    };
+
+    // The staking receive index is ordered by pool, so only the users of one pool are held at a time
+    {
+        bool fPool = false, fPoolEnabled = false;
+        CAccountID poolID;
+        COutPoint poolPos;
+        CUserStatusMap poolUsers;
+
+        CAccountID tempAccountID;
+        COutPoint tempOutpoint(uint256(), 0);
+        StakingReceiveEntry entry(&tempOutpoint, &tempAccountID);
+        std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_COIN_STAKING_RECEIVE));
+        for (pcursor->Seek(entry); ; pcursor->Next()) {
+            const bool fValid = pcursor->Valid() && pcursor->GetKey(entry) && entry.key == DB_COIN_STAKING_RECEIVE;
+            if (fPool && (!fValid || tempAccountID != poolID)) {
+                if (fPoolEnabled)
+                    writePool(poolID, poolPos, poolUsers);
+                fPool = false;
+            }
+            if (!fValid)
+                break;
+            if (!fPool) {
+                fPool = true;
+                fPoolEnabled = false;
+                poolID = tempAccountID;
+                poolUsers.clear();
+            }
+
+            Coin coin;
+            if (!db.Read(CoinEntry(entry.outpoint), coin) || !coin.IsStaking())
+                throw std::runtime_error("Database read invalid staking coin");
+
+            const auto payload = StakingPayload::As(coin.GetPayload());
+            LogPrint(BCLog::COINDB, "  New staking coin: from=%s to=%s amount=%d\n", coin.GetAccountID().ToString(), EncodeDestination(ExtractDestination(payload->GetReceiverID())), payload->GetAmount() / COIN);
+            if (coin.GetAccountID() == consensusParams.SaturnStakingGenesisID) {
+                // initial pool
+                if (coin.out.nValue < GetInitialStakingPoolAmount((int) coin.nHeight, consensusParams)) {
+                    continue;
+                }
+                fPoolEnabled = true;
+                poolPos = *(entry.outpoint);
+            } else {
+                // staking
+                if (coin.nHeight + payload->lockBlocks < (uint32_t) pEpochInitIndex->nHeight) {
+                    // unlocked
+                    continue;
+                }
+
+                poolUsers[coin.GetAccountID()].stakeAmount += payload->GetAmount();
+            }
+        }
     }
+
+    // write to db
     std::sort(pools.begin(), pools.end(),
         [](const StakingPool &a, const StakingPool &b) {
             if (a.stakeAmount == b.stakeAmount)
@@ -1158,21 +1652,360 @@ void CCoinsViewDB::TrySnapshotStakingPoolStatus(const CBlockIndex *pEpochInitInd
     LogPrint(BCLog::COINDB, "Committed %u pools, %u users to coin database...\n", (unsigned int)pools.size(), (unsigned int)userCount);
 
     LogPrint(BCLog::COINDB, "End SnapshotStakingPoolStatus for epoch %d\n", pEpochInitIndex->nHeight);
+
+    // Drop the tombstones of the epoch rewrites at the next idle moment
+    GetDBCompactionScheduler().RequestRound();
 }
 
-CStakingPoolList CCoinsViewDB::GetStakingPools(const uint256 &epochHash) const {
+struct CCoinsViewDB::EpochStakingPools {
     CStakingPoolList pools;
-    if (!db.Read(StakingPoolEntry(&epochHash), pools)) {
+    std::unordered_map<CAccountID, size_t, CAccountIDHasher> mapPoolIndex;
+    std::unordered_map<CAccountID, CStakingPoolUserList, CAccountIDHasher> mapPoolUsers;
+};
+
+CCoinsViewDB::EpochStakingPoolsRef CCoinsViewDB::GetEpochStakingPools(const uint256 &epochHash) const {
+    AssertLockHeld(cs_stakingPools);
+    for (auto it = listStakingPools.begin(); it != listStakingPools.end(); it++) {
+        if (it->first == epochHash) {
+            listStakingPools.splice(listStakingPools.begin(), listStakingPools, it);
+            return it->second;
+        }
+    }
+
+    // Misses are not cached, the snapshot of the epoch may not be written yet
+    EpochStakingPoolsRef entry = std::make_shared<EpochStakingPools>();
+    if (!db.Read(StakingPoolEntry(&epochHash), entry->pools)) {
+        return nullptr;
+    }
+    entry->mapPoolIndex.reserve(entry->pools.size());
+    for (size_t i = 0; i < entry->pools.size(); i++) {
+        entry->mapPoolIndex.emplace(entry->pools[i].poolID, i);
+    }
+    listStakingPools.emplace_front(epochHash, entry);
+    if (listStakingPools.size() > MAX_STAKING_POOL_CACHE_EPOCHS) {
+        listStakingPools.pop_back();
+    }
+    return entry;
+}
+
+void CCoinsViewDB::UncacheStakingPools(const CBlockIndex *pindexBest) {
+    LOCK(cs_stakingPools);
+    for (auto it = listStakingPools.begin(); it != listStakingPools.end();) {
+        const CBlockIndex *pEpochInitIndex = LookupBlockIndex(it->first);
+        if (pindexBest == nullptr || pEpochInitIndex == nullptr || pindexBest->GetAncestor(pEpochInitIndex->nHeight) != pEpochInitIndex) {
+            it = listStakingPools.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+CStakingPoolList CCoinsViewDB::GetStakingPools(const uint256 &epochHash) const {
+    LOCK(cs_stakingPools);
+    EpochStakingPoolsRef entry = GetEpochStakingPools(epochHash);
+    if (!entry) {
         return {};
     }
-    return pools;
+    return entry->pools;
+}
+
+bool CCoinsViewDB::GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const {
+    LOCK(cs_stakingPools);
+    EpochStakingPoolsRef entry = GetEpochStakingPools(epochHash);
+    if (!entry) {
+        return false;
+    }
+    auto it = entry->mapPoolIndex.find(poolID);
+    if (it == entry->mapPoolIndex.end()) {
+        return false;
+    }
+    pool = entry->pools[it->second];
+    return true;
 }
 
 CStakingPoolUserList CCoinsViewDB::GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const {
-    CStakingPoolUserList users;
-    if (!db.Read(StakingPoolUsersEntry(&epochHash, &poolID), users)) {
+    LOCK(cs_stakingPools);
+    EpochStakingPoolsRef entry = GetEpochStakingPools(epochHash);
+    if (!entry || !entry->mapPoolIndex.count(poolID)) {
+        // Users are only written for the pools of the epoch
         return {};
     }
+    auto it = entry->mapPoolUsers.find(poolID);
+    if (it == entry->mapPoolUsers.end()) {
+        CStakingPoolUserList users;
+        if (!db.Read(StakingPoolUsersEntry(&epochHash, &poolID), users)) {
+            return {};
+        }
+        it = entry->mapPoolUsers.emplace(poolID, std::move(users)).first;
+    }
+    return it->second;
+}
+
+std::vector<uint256> CCoinsViewDB::GetStakingPoolEpochs() const {
+    std::vector<uint256> epochs;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator(DB_STAKING_POOL_EPOCH_POOL));
+    pcursor->Seek(std::make_pair(DB_STAKING_POOL_EPOCH_POOL, uint256()));
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_STAKING_POOL_EPOCH_POOL)
+            break;
+        epochs.push_back(key.second);
+    }
+    return epochs;
+}
+
+bool CCoinsViewDB::WriteStakingPools(const uint256 &epochHash, const CStakingPoolList &pools, const std::vector<CStakingPoolUserList> &users) {
+    assert(pools.size() == users.size());
+    CDBBatch batch(db);
+    batch.Write(StakingPoolEntry(&epochHash), pools);
+    for (size_t i = 0; i < pools.size(); i++) {
+        batch.Write(StakingPoolUsersEntry(&epochHash, &pools[i].poolID), users[i]);
+    }
+    LOCK(cs_write);
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::WriteSnapshotCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fComplete) {
+    // Staking withdraw coins have no index entries, see TrySnapshotStakingPoolStatus()
+    CDBBatch batch(db);
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->first.n == COutPoint::STAKING_WITHDRAW_COIN_INDEX) {
+            batch.Write(CoinEntry(&it->first), it->second.coin);
+            it = mapCoins.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    // The first call marks the transition, before which nothing else may be written
+    if (!WriteCoins(mapCoins, hashBlock, nullptr, true, false))
+        return false;
+    if (batch.SizeEstimate() > 0) {
+        LOCK(cs_write);
+        if (!db.WriteBatch(batch))
+            return false;
+    }
+    if (fComplete) {
+        CCoinsMap mapEmpty;
+        return WriteCoins(mapEmpty, hashBlock, nullptr, true, true);
+    }
+    return true;
+}
+
+bool CCoinsViewDB::IsEmpty() const {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        if (IsCoinsDataKey(pcursor->GetKey()))
+            return false;
+    }
+    return true;
+}
+
+bool CCoinsViewDB::EraseSnapshot(const uint256 &hashOld) {
+    size_t batch_size = (size_t) gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(db);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+        const leveldb::Slice key = pcursor->GetKey();
+        if (IsCoinsDataKey(key)) {
+            batch.EraseSlice(key);
+            if (batch.SizeEstimate() > batch_size) {
+                LOCK(cs_write);
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+    }
+
+    batch.Erase(DB_HEAD_BLOCKS);
+    if (hashOld.IsNull())
+        batch.Erase(DB_BEST_BLOCK);
+    else
+        batch.Write(DB_BEST_BLOCK, hashOld);
+    UncacheStakingPools(nullptr);
+    LOCK(cs_write);
+    return db.WriteBatch(batch);
+}
+
+class CCoinsViewBackgroundWriter::PendingCoins : public CCoinsViewCache
+{
+public:
+    explicit PendingCoins(CCoinsView *baseIn) : CCoinsViewCache(baseIn) {}
+
+    CCoinsMap &Coins() { return cacheCoins; }
+    const CCoinsMap &Coins() const { return cacheCoins; }
+};
+
+CCoinsViewBackgroundWriter::CCoinsViewBackgroundWriter(CCoinsView *viewIn, CCoinsViewDB &dbIn) : CCoinsViewBacked(viewIn), dbview(dbIn),
+    fBackground(gArgs.GetBoolArg("-backgroundflush", DEFAULT_BACKGROUND_FLUSH)),
+    fWriteFailed(false)
+{
+}
+
+CCoinsViewBackgroundWriter::~CCoinsViewBackgroundWriter() {
+    Wait();
+}
+
+bool CCoinsViewBackgroundWriter::Wait() const {
+    if (pending) {
+        writerThread.join();
+        pending.reset();
+    }
+    return !fWriteFailed;
+}
+
+bool CCoinsViewBackgroundWriter::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (pending) {
+        // Do not fill the pending cache, the writer thread walks it
+        CCoinsMap::const_iterator it = pending->Coins().find(outpoint);
+        if (it != pending->Coins().end()) {
+            coin = it->second.coin;
+            return !coin.IsSpent();
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundWriter::HaveCoin(const COutPoint &outpoint) const {
+    if (pending) {
+        CCoinsMap::const_iterator it = pending->Coins().find(outpoint);
+        if (it != pending->Coins().end())
+            return !it->second.coin.IsSpent();
+    }
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundWriter::GetBestBlock() const {
+    if (pending)
+        return pending->GetBestBlock();
+    return base->GetBestBlock();
+}
+
+std::vector<uint256> CCoinsViewBackgroundWriter::GetHeadBlocks() const {
+    Wait();
+    return base->GetHeadBlocks();
+}
+
+bool CCoinsViewBackgroundWriter::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    if (!Wait())
+        return error("%s: background write of the coin database failed", __func__);
+    if (!fBackground)
+        return base->BatchWrite(mapCoins, hashBlock);
+
+    // Take over the dirty coins, the emptied cache of the caller keeps going on top of them
+    pending = MakeUnique<PendingCoins>(base);
+    pending->BatchWrite(mapCoins, hashBlock);
+
+    // The block index is only looked up with cs_main held, so do it here
+    const CBlockIndex *pindexBest = LookupBlockIndex(hashBlock);
+    dbview.UncacheStakingPools(pindexBest);
+
+    LogPrint(BCLog::COINDB, "Writing %u coins to coin database in background\n", (unsigned int)pending->Coins().size());
+    PendingCoins *pendingCoins = pending.get();
+    writerThread = std::thread([this, pendingCoins, hashBlock, pindexBest]() {
+        util::ThreadRename("coinsflush");
+        try {
+            if (!dbview.WriteCoins(pendingCoins->Coins(), hashBlock, pindexBest, false))
+                fWriteFailed = true;
+        } catch (const std::exception &e) {
+            LogPrintf("Error writing coin database in background: %s\n", e.what());
+            fWriteFailed = true;
+        }
+    });
+    return true;
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::Cursor() const {
+    Wait();
+    return base->Cursor();
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::Cursor(const CAccountID &accountID) const {
+    Wait();
+    return base->Cursor(accountID);
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::PointSendCursor(const CAccountID &accountID) const {
+    Wait();
+    return base->PointSendCursor(accountID);
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::PointReceiveCursor(const CAccountID &accountID) const {
+    Wait();
+    return base->PointReceiveCursor(accountID);
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::StakingSendCursor(const CAccountID &accountID) const {
+    Wait();
+    return base->StakingSendCursor(accountID);
+}
+
+CCoinsViewCursorRef CCoinsViewBackgroundWriter::StakingReceiveCursor(const CAccountID &accountID) const {
+    Wait();
+    return base->StakingReceiveCursor(accountID);
+}
+
+CAmount CCoinsViewBackgroundWriter::GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const {
+    if (!pending)
+        return base->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, modifiedCoins);
+    // The pending coins apply over the database whichever of them are written yet
+    LOCK(dbview.cs_write);
+    return pending->GetAccountBalance(accountID, balanceBindPlotter, balancePoint, balanceStaking, modifiedCoins);
+}
+
+CBindPlotterCoinsMap CCoinsViewBackgroundWriter::GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId) const {
+    if (!pending)
+        return base->GetAccountBindPlotterEntries(accountID, plotterId);
+    LOCK(dbview.cs_write);
+    return pending->GetAccountBindPlotterEntries(accountID, plotterId);
+}
+
+CBindPlotterCoinsMap CCoinsViewBackgroundWriter::GetBindPlotterEntries(const uint64_t &plotterId) const {
+    if (!pending)
+        return base->GetBindPlotterEntries(plotterId);
+    LOCK(dbview.cs_write);
+    return pending->GetBindPlotterEntries(plotterId);
+}
+
+bool CCoinsViewBackgroundWriter::GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded) const {
+    if (!pending)
+        return base->GetLastBindPlotterEntry(plotterId, entry, excluded);
+    LOCK(dbview.cs_write);
+    return pending->GetLastBindPlotterEntry(plotterId, entry, excluded);
+}
+
+CAccountBalanceList CCoinsViewBackgroundWriter::GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins) const {
+    if (!pending)
+        return base->GetTopStakingAccounts(n, modifiedCoins);
+    LOCK(dbview.cs_write);
+    return pending->GetTopStakingAccounts(n, modifiedCoins);
+}
+
+CStakingPoolList CCoinsViewBackgroundWriter::GetStakingPools(const uint256 &epochHash) const {
+    // The snapshot of the epoch may be part of the write in flight
+    CStakingPoolList pools = base->GetStakingPools(epochHash);
+    if (pools.empty() && pending) {
+        Wait();
+        pools = base->GetStakingPools(epochHash);
+    }
+    return pools;
+}
+
+bool CCoinsViewBackgroundWriter::GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const {
+    if (base->GetStakingPool(epochHash, poolID, pool))
+        return true;
+    if (!pending)
+        return false;
+    Wait();
+    return base->GetStakingPool(epochHash, poolID, pool);
+}
+
+CStakingPoolUserList CCoinsViewBackgroundWriter::GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const {
+    CStakingPoolUserList users = base->GetStakingPoolUsers(epochHash, poolID);
+    if (users.empty() && pending) {
+        Wait();
+        users = base->GetStakingPoolUsers(epochHash, poolID);
+    }
     return users;
 }
 
@@ -1210,6 +2043,14 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadBlockIndexPos(const uint256 &hash, CChiaProofOfSpace &pos) {
+    CDiskBlockIndex diskindex;
+    if (!Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex))
+        return false;
+    pos = diskindex.pos;
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -1227,45 +2068,81 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
     size_t batch_size = (size_t) gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     CDBBatch batch(*this);
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    // Read and hash the entries on the shared thread pool, each slice over a range of the first byte of the block hash.
+    // The single threaded pass below links the entries in height order, so that the block index arena
+    // allocates each entry after its ancestors
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+    std::vector<std::vector<std::pair<uint256, CDiskBlockIndex>>> vRanges(nThreads);
+    std::atomic<bool> fFailed(false);
+    std::atomic<bool> fInterrupted(false);
+    auto loadRange = [&](int nRange) {
+        const unsigned int nBegin = 256 * nRange / nThreads, nEnd = 256 * (nRange + 1) / nThreads;
+        uint256 hashBegin;
+        *hashBegin.begin() = (unsigned char) nBegin;
+
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        for (pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashBegin)); pcursor->Valid(); pcursor->Next()) {
+            if (fFailed || fInterrupted)
+                return;
+            if (ShutdownRequested()) {
+                fInterrupted = true;
+                return;
+            }
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd)
+                break;
+            CDiskBlockIndex diskindex;
+            if (!pcursor->GetValue(diskindex)) {
+                fFailed = true;
+                return;
+            }
+            const uint256 hash = diskindex.GetBlockHash();
+            // The PoS data is read back on demand, see CBlockIndex::GetPos()
+            diskindex.pos.SetNull();
+            vRanges[nRange].emplace_back(hash, std::move(diskindex));
+        }
+    };
+    GetThreadPool().RunParallel(TaskPriority::CRITICAL, nThreads, loadRange);
+    if (fInterrupted)
+        return false;
+    if (fFailed)
+        return error("%s: failed to read value", __func__);
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    std::vector<std::pair<uint256, CDiskBlockIndex>*> vSorted;
+    for (auto &vEntries : vRanges) {
+        for (auto &entry : vEntries)
+            vSorted.push_back(&entry);
+    }
+    std::stable_sort(vSorted.begin(), vSorted.end(), [](const std::pair<uint256, CDiskBlockIndex>* a, const std::pair<uint256, CDiskBlockIndex>* b) {
+        return a->second.nHeight < b->second.nHeight;
+    });
 
     // Load m_block_index
-    while (pcursor->Valid()) {
+    for (auto *pentry : vSorted) {
+        auto &entry = *pentry;
         boost::this_thread::interruption_point();
-        if (ShutdownRequested()) return false;
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev              = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight            = diskindex.nHeight;
-                pindexNew->nFile              = diskindex.nFile;
-                pindexNew->nDataPos           = diskindex.nDataPos;
-                pindexNew->nUndoPos           = diskindex.nUndoPos;
-                pindexNew->nVersion           = diskindex.nVersion;
-                pindexNew->hashMerkleRoot     = diskindex.hashMerkleRoot;
-                pindexNew->nTime              = diskindex.nTime;
-                pindexNew->nBaseTarget        = diskindex.nBaseTarget;
-                pindexNew->nNonce             = diskindex.nNonce;
-                pindexNew->nPlotterId         = diskindex.nPlotterId;
-                pindexNew->nStatus            = diskindex.nStatus;
-                pindexNew->nTx                = diskindex.nTx;
-                pindexNew->minerRewardTxOut   = diskindex.minerRewardTxOut;
-                pindexNew->pos                = diskindex.pos;
-                pindexNew->vchPubKey          = diskindex.vchPubKey;
-                pindexNew->vchSignature       = diskindex.vchSignature;
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
-        } else {
-            break;
-        }
+        CDiskBlockIndex &diskindex = entry.second;
+
+        // Construct block index object
+        CBlockIndex* pindexNew = insertBlockIndex(entry.first);
+        pindexNew->pprev              = insertBlockIndex(diskindex.hashPrev);
+        pindexNew->nHeight            = diskindex.nHeight;
+        pindexNew->nFile              = diskindex.nFile;
+        pindexNew->nDataPos           = diskindex.nDataPos;
+        pindexNew->nUndoPos           = diskindex.nUndoPos;
+        pindexNew->nVersion           = diskindex.nVersion;
+        pindexNew->hashMerkleRoot     = diskindex.hashMerkleRoot;
+        pindexNew->nTime              = diskindex.nTime;
+        pindexNew->nBaseTarget        = diskindex.nBaseTarget;
+        pindexNew->nNonce             = diskindex.nNonce;
+        pindexNew->nPlotterId         = diskindex.nPlotterId;
+        pindexNew->nStatus            = diskindex.nStatus;
+        pindexNew->nTx                = diskindex.nTx;
+        pindexNew->SetMinerRewardTxOut(std::move(diskindex.minerRewardTxOut));
+        pindexNew->SetSignature(diskindex.vchPubKey, diskindex.vchSignature);
     }
+    std::vector<std::pair<uint256, CDiskBlockIndex>*>().swap(vSorted);
+    std::vector<std::vector<std::pair<uint256, CDiskBlockIndex>>>().swap(vRanges);
 
     return WriteBatch(batch);
 }
@@ -1294,9 +2171,10 @@ bool CCoinsViewDB::Upgrade(bool &fUpgraded) {
         CDBBatch batch(db);
         for (; pcursor->Valid(); pcursor->Next()) {
             const leveldb::Slice key = pcursor->GetKey();
-            if (key.size() > 32 && (key[0] == DB_COIN_INDEX || key[0] == DB_COIN_BINDPLOTTER
+            if ((key.size() > 32 && (key[0] == DB_COIN_INDEX || key[0] == DB_COIN_BINDPLOTTER || key[0] == DB_PLOTTER_BIND
                 || key[0] == DB_COIN_POINT_SEND || key[0] == DB_COIN_POINT_RECEIVE
-                || key[0] == DB_COIN_STAKING_SEND || key[0] == DB_COIN_STAKING_RECEIVE)) {
+                || key[0] == DB_COIN_STAKING_SEND || key[0] == DB_COIN_STAKING_RECEIVE))
+                || (key.size() > 20 && (key[0] == DB_ACCOUNT_BALANCE || key[0] == DB_STAKING_RANK))) {
                 batch.EraseSlice(key);
                 remove++;
 
@@ -1315,6 +2193,7 @@ bool CCoinsViewDB::Upgrade(bool &fUpgraded) {
         int utxo_bucket = 145000 / 100;
         int indexProgress = -1;
         CDBBatch batch(db);
+        CAccountBalanceMap accountBalances;
         COutPoint outpoint;
         CoinEntry entry(&outpoint);
         for (; pcursor->Valid(); pcursor->Next()) {
@@ -1323,24 +2202,26 @@ bool CCoinsViewDB::Upgrade(bool &fUpgraded) {
                 if (!pcursor->GetValue(coin))
                     return error("%s: cannot parse coin record", __func__);
 
-                if (!coin.outAccountID.IsNull()) {
-                    batch.Write(CoinIndexEntry(&outpoint, &coin.outAccountID), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                if (!coin.GetAccountID().IsNull()) {
+                    batch.Write(CoinIndexEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                    AddCoinToAccountBalances(accountBalances, coin, 1);
                     add++;
 
                     // payload
                     if (coin.IsBindPlotter()) {
-                        auto payload = BindPlotterPayload::As(coin.payload);
+                        auto payload = BindPlotterPayload::As(coin.GetPayload());
                         uint32_t nHeight = coin.nHeight;
-                        batch.Write(BindPlotterEntry(&outpoint, &coin.outAccountID), BindPlotterValue(&payload->GetId(), &nHeight));
-                        add++;
+                        batch.Write(BindPlotterEntry(&outpoint, &coin.GetAccountID()), BindPlotterValue(&payload->GetId(), &nHeight));
+                        batch.Write(PlotterBindEntry(&payload->GetId(), &nHeight, &outpoint), coin.GetAccountID());
+                        add+=2;
                     } else if (coin.IsPoint()) {
-                        auto payload = PointPayload::As(coin.payload);
-                        batch.Write(PointSendEntry(&outpoint, &coin.outAccountID), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                        auto payload = PointPayload::As(coin.GetPayload());
+                        batch.Write(PointSendEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
                         batch.Write(PointReceiveEntry(&outpoint, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
                         add+=2;
                     } else if (coin.IsStaking()) {
-                        auto payload = StakingPayload::As(coin.payload);
-                        batch.Write(StakingSendEntry(&outpoint, &coin.outAccountID), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
+                        auto payload = StakingPayload::As(coin.GetPayload());
+                        batch.Write(StakingSendEntry(&outpoint, &coin.GetAccountID()), VARINT(coin.out.nValue, VarIntMode::NONNEGATIVE_SIGNED));
                         batch.Write(StakingReceiveEntry(&outpoint, &payload->GetReceiverID()), VARINT(payload->GetAmount(), VarIntMode::NONNEGATIVE_SIGNED));
                         add+=2;
                     }
@@ -1363,6 +2244,21 @@ bool CCoinsViewDB::Upgrade(bool &fUpgraded) {
                 break;
             }
         }
+
+        // Account totals and staking ordered index
+        for (const auto& item : accountBalances) {
+            batch.Write(AccountBalanceEntry(&item.first), item.second);
+            add++;
+            if (item.second.stakingReceive != 0) {
+                batch.Write(StakingRankEntry(&item.second.stakingReceive, &item.first), '1');
+                add++;
+            }
+
+            if (batch.SizeEstimate() > batch_size) {
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
         db.WriteBatch(batch);
     }
 
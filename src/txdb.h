@@ -10,10 +10,14 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <limits>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -38,19 +42,64 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the account history index DB specific cache (MiB)
+static const int64_t nMaxAccountHistoryIndexCache = 1024;
+//! Max memory allocated to the bind plotter index DB specific cache (MiB)
+static const int64_t nMaxBindPlotterIndexCache = 64;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -checkaccountindex default
+static const bool DEFAULT_CHECKACCOUNTINDEX = false;
+//! Max threads reading the block index at startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
+//! Max threads encoding the entries of dirty coins when writing the coin database
+static const int MAX_COINS_WRITE_THREADS = 8;
+//! Number of epochs of decoded staking pools kept in memory
+static constexpr size_t MAX_STAKING_POOL_CACHE_EPOCHS = 4;
+//! -backgroundflush default
+static const bool DEFAULT_BACKGROUND_FLUSH = false;
+
+/**
+ * Restricts the coins visited by an account cursor of the coin database. The amount and height are checked on the
+ * encoded entries, before a coin is decoded.
+ */
+struct CAccountCoinsFilter
+{
+    //! Resume at this coin in the order of the cursor, which is the order of outpoints. Null to start at the first coin
+    COutPoint start;
+    //! Minimum amount of the index entry, the effective amount for the point and staking receive cursors
+    CAmount nMinAmount;
+    //! Inclusive height range of the coins
+    int nMinHeight;
+    int nMaxHeight;
+
+    CAccountCoinsFilter() : start(uint256(), 0), nMinAmount(0), nMinHeight(0), nMaxHeight(std::numeric_limits<int>::max()) {}
+};
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
     mutable CDBWrapper db;
+    //! Verify the account totals against a scan of the index entries
+    const bool fCheckAccountIndex;
+
+    //! Decoded staking pools of an epoch, with pool users loaded on demand
+    struct EpochStakingPools;
+    typedef std::shared_ptr<EpochStakingPools> EpochStakingPoolsRef;
+    mutable Mutex cs_stakingPools;
+    //! Most recently used epoch first. The pool set of an epoch never changes, entries only go away on reorg
+    mutable std::list<std::pair<uint256, EpochStakingPoolsRef>> listStakingPools GUARDED_BY(cs_stakingPools);
+    //! Held while a batch of coins is committed. Queries combining several reads hold it, so that they see the database between batches
+    mutable RecursiveMutex cs_write;
+
+    friend class CCoinsViewBackgroundWriter;
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
      */
     explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -64,22 +113,112 @@ public:
     CCoinsViewCursorRef StakingSendCursor(const CAccountID &accountID) const override;
     CCoinsViewCursorRef StakingReceiveCursor(const CAccountID &accountID) const override;
 
+    //! Account cursors visiting only the coins that pass filter
+    CCoinsViewCursorRef Cursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const;
+    CCoinsViewCursorRef PointSendCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const;
+    CCoinsViewCursorRef PointReceiveCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const;
+    CCoinsViewCursorRef StakingSendCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const;
+    CCoinsViewCursorRef StakingReceiveCursor(const CAccountID &accountID, const CAccountCoinsFilter &filter) const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade(bool &fUpgraded);
     size_t EstimateSize() const override;
 
-    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsMap &mapModifiedCoins = {}) const override;
+    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins = {}) const override;
     CBindPlotterCoinsMap GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId = 0) const override;
     CBindPlotterCoinsMap GetBindPlotterEntries(const uint64_t &plotterId) const override;
-    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsMap &mapModifiedCoins = {}) const override;
+    bool GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded = {}) const override;
+    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins = {}) const override;
 
     CStakingPoolList GetStakingPools(const uint256 &epochHash) const override;
+    bool GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const override;
     CStakingPoolUserList GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const override;
 
+    //! The epochs that have a staking pool snapshot, on any chain
+    std::vector<uint256> GetStakingPoolEpochs() const;
+    //! Write the staking pool snapshot of an epoch, users holding the users of each pool in the same order
+    bool WriteStakingPools(const uint256 &epochHash, const CStakingPoolList &pools, const std::vector<CStakingPoolUserList> &users);
+    /**
+     * Write coins of a UTXO set snapshot taken at hashBlock, erasing them from mapCoins. The database stays marked as
+     * in transition to hashBlock until called with fComplete. Staking withdraw coins are written without index entries,
+     * like the staking pool snapshot writes them.
+     */
+    bool WriteSnapshotCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fComplete);
+    //! Whether the database holds no coins, index entries or staking pool snapshots
+    bool IsEmpty() const;
+    /**
+     * Erase the coins, index entries and staking pool snapshots of a snapshot that failed to load into an empty
+     * database, marking the database as consistent with hashOld again.
+     */
+    bool EraseSnapshot(const uint256 &hashOld);
+
 private:
+    /**
+     * Write the dirty coins of mapCoins and their index entries in batches, with DB_HEAD_BLOCKS marking the transition
+     * until the last batch is committed. With fErase the written entries are removed from mapCoins, otherwise they are
+     * kept unchanged except that they lose FRESH once in database. Without fComplete the transition stays marked.
+     * The staking pool snapshot of pindexBest is taken when it begins an epoch.
+     */
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, const CBlockIndex *pindexBest, bool fErase, bool fComplete = true);
+    //! Load the staking pools of an epoch through the cache. Return nullptr when the epoch has no snapshot
+    EpochStakingPoolsRef GetEpochStakingPools(const uint256 &epochHash) const EXCLUSIVE_LOCKS_REQUIRED(cs_stakingPools);
+    //! Drop cached epochs that are no longer on the chain of pindexBest
+    void UncacheStakingPools(const CBlockIndex *pindexBest);
+    //! Sum the index entries of an account, the way the account totals are verified
+    CAmount ScanAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins) const;
     void TrySnapshotStakingPoolStatus(const CBlockIndex *pEpochInitIndex, const Consensus::Params &consensusParams);
 };
 
+/**
+ * Passes flushes to the coin database, or with -backgroundflush hands the flushed coins to a thread writing them, so
+ * that validation continues on the emptied cache meanwhile. At most one write is in flight. Until it completes, the
+ * coins being written are served from memory, and queries which can not be answered from them wait for it.
+ * Like the rest of the view hierarchy, it is used with cs_main held.
+ */
+class CCoinsViewBackgroundWriter final : public CCoinsViewBacked
+{
+public:
+    CCoinsViewBackgroundWriter(CCoinsView *viewIn, CCoinsViewDB &dbIn);
+    ~CCoinsViewBackgroundWriter();
+
+    //! Wait for the write in flight. Returns false once any background write failed
+    bool Wait() const;
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    std::vector<uint256> GetHeadBlocks() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursorRef Cursor() const override;
+    CCoinsViewCursorRef Cursor(const CAccountID &accountID) const override;
+    CCoinsViewCursorRef PointSendCursor(const CAccountID &accountID) const override;
+    CCoinsViewCursorRef PointReceiveCursor(const CAccountID &accountID) const override;
+    CCoinsViewCursorRef StakingSendCursor(const CAccountID &accountID) const override;
+    CCoinsViewCursorRef StakingReceiveCursor(const CAccountID &accountID) const override;
+
+    CAmount GetAccountBalance(const CAccountID &accountID, CAmount *balanceBindPlotter, CAmount balancePoint[2], CAmount balanceStaking[2], const CCoinsModifiedChain &modifiedCoins = {}) const override;
+    CBindPlotterCoinsMap GetAccountBindPlotterEntries(const CAccountID &accountID, const uint64_t &plotterId = 0) const override;
+    CBindPlotterCoinsMap GetBindPlotterEntries(const uint64_t &plotterId) const override;
+    bool GetLastBindPlotterEntry(const uint64_t &plotterId, CBindPlotterCoinPair &entry, const std::set<COutPoint> &excluded = {}) const override;
+    CAccountBalanceList GetTopStakingAccounts(int n, const CCoinsModifiedChain &modifiedCoins = {}) const override;
+
+    CStakingPoolList GetStakingPools(const uint256 &epochHash) const override;
+    bool GetStakingPool(const uint256 &epochHash, const CAccountID &poolID, StakingPool &pool) const override;
+    CStakingPoolUserList GetStakingPoolUsers(const uint256 &epochHash, const CAccountID &poolID) const override;
+
+private:
+    //! Read-only cache over the base view, holding the coins being written
+    class PendingCoins;
+
+    CCoinsViewDB &dbview;
+    const bool fBackground;
+    //! The coins of the write in flight, nullptr when there is none
+    mutable std::unique_ptr<PendingCoins> pending;
+    mutable std::thread writerThread;
+    //! Set by the writer thread, read after joining it
+    mutable bool fWriteFailed;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -93,6 +232,8 @@ public:
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! Read the PoS data of a block index entry, which is not kept in memory
+    bool ReadBlockIndexPos(const uint256 &hash, CChiaProofOfSpace &pos);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
@@ -14,16 +14,28 @@
 #include <policy/fees.h>
 #include <policy/settings.h>
 #include <reverse_iterator.h>
+#include <script/standard.h>
 #include <util/system.h>
 #include <util/moneystr.h>
 #include <util/time.h>
 #include <util/validation.h>
 
+/** Get the plotter a transaction binds, 0 if it binds none */
+static uint64_t GetTxBindPlotterId(const CTransaction& tx)
+{
+    for (const CTxOut& txout : tx.vout) {
+        auto payload = ExtractTxoutPayload(txout, 0, {TXOUT_TYPE_BINDPLOTTER});
+        if (payload && payload->type == TXOUT_TYPE_BINDPLOTTER)
+            return BindPlotterPayload::As(payload)->GetId();
+    }
+    return 0;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp)
     : tx(_tx), nFee(_nFee), nTxWeight(GetTransactionWeight(*tx)), nUsageSize(RecursiveDynamicUsage(tx)), nTime(_nTime), entryHeight(_entryHeight),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp), nBindPlotterId(GetTxBindPlotterId(*tx))
 {
     nCountWithDescendants = 1;
     nSizeWithDescendants = GetTxSize();
@@ -35,6 +47,8 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nSizeWithAncestors = GetTxSize();
     nModFeesWithAncestors = nFee;
     nSigOpCostWithAncestors = sigOpCost;
+
+    m_epoch = 0;
 }
 
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
@@ -59,13 +73,18 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    const EpochGuard epoch(*this);
+    std::vector<txiter> stageEntries;
+    setEntries setAllDescendants;
+    for (txiter childEntry : GetMemPoolChildren(updateIt)) {
+        visited(childEntry);
+        stageEntries.push_back(childEntry);
+    }
 
     while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
+        const txiter cit = stageEntries.back();
         setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
+        stageEntries.pop_back();
         const setEntries &setChildren = GetMemPoolChildren(cit);
         for (txiter childEntry : setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
@@ -73,11 +92,12 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
                 // We've already calculated this one, just add the entries for this set
                 // but don't traverse again.
                 for (txiter cacheEntry : cacheIt->second) {
+                    visited(cacheEntry);
                     setAllDescendants.insert(cacheEntry);
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
+            } else if (!visited(childEntry)) {
                 // Schedule for later processing
-                stageEntries.insert(childEntry);
+                stageEntries.push_back(childEntry);
             }
         }
     }
@@ -149,7 +169,8 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
-    setEntries parentHashes;
+    const EpochGuard epoch(*this);
+    std::vector<txiter> parentHashes;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -158,8 +179,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             boost::optional<txiter> piter = GetIter(tx.vin[i].prevout.hash);
-            if (piter) {
-                parentHashes.insert(*piter);
+            if (piter && !visited(*piter)) {
+                parentHashes.push_back(*piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -170,16 +191,19 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (txiter piter : GetMemPoolParents(it)) {
+            visited(piter);
+            parentHashes.push_back(piter);
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -196,8 +220,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (txiter phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -380,6 +404,8 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
         mapNextTx.insert(std::make_pair(&tx.vin[i].prevout, &tx));
         setParentTransactions.insert(tx.vin[i].prevout.hash);
     }
+    if (newit->GetBindPlotterId() != 0)
+        mapBindPlotterTxs[newit->GetBindPlotterId()].insert(newit);
     // Don't bother worrying about child transactions of this one.
     // Normal case of a new transaction arriving is that there can't be any
     // children, because such children would be orphans.
@@ -408,6 +434,12 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     const uint256 hash = it->GetTx().GetHash();
     for (const CTxIn& txin : it->GetTx().vin)
         mapNextTx.erase(txin.prevout);
+    if (it->GetBindPlotterId() != 0) {
+        auto itBind = mapBindPlotterTxs.find(it->GetBindPlotterId());
+        itBind->second.erase(it);
+        if (itBind->second.empty())
+            mapBindPlotterTxs.erase(itBind);
+    }
 
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
@@ -435,27 +467,42 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants) const
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
+    const EpochGuard epoch(*this);
+    std::vector<txiter> stage;
+    if (!visited(entryit) && setDescendants.count(entryit) == 0) {
+        stage.push_back(entryit);
     }
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
+        txiter it = stage.back();
         setDescendants.insert(it);
-        stage.erase(it);
+        stage.pop_back();
 
         const setEntries &setChildren = GetMemPoolChildren(it);
         for (txiter childiter : setChildren) {
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (!visited(childiter) && !setDescendants.count(childiter)) {
+                stage.push_back(childiter);
             }
         }
     }
 }
 
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& in) : pool(in)
+{
+    assert(!pool.m_has_epoch_guard);
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    // Entries visited by this walk stay behind the epoch of the next one
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = false;
+}
+
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
@@ -557,6 +604,7 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
+    std::set<uint64_t> setBoundPlotters;
     for (const auto& tx : vtx)
     {
         txiter it = mapTx.find(tx->GetHash());
@@ -567,6 +615,22 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
         }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
+        if (!mapBindPlotterTxs.empty()) {
+            const uint64_t plotterId = GetTxBindPlotterId(*tx);
+            if (plotterId != 0)
+                setBoundPlotters.insert(plotterId);
+        }
+    }
+    // Binds of the plotters the block binds were accepted against the previous
+    // bind, and may now owe the bind plotter punishment
+    for (const uint64_t plotterId : setBoundPlotters) {
+        auto itBind = mapBindPlotterTxs.find(plotterId);
+        if (itBind == mapBindPlotterTxs.end())
+            continue;
+        setEntries stage;
+        for (txiter it : itBind->second)
+            CalculateDescendants(it, stage);
+        RemoveStaged(stage, false, MemPoolRemovalReason::CONFLICT);
     }
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
@@ -577,6 +641,7 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapBindPlotterTxs.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -617,10 +682,12 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
     uint64_t innerUsage = 0;
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(pcoins));
-    const int64_t spendheight = GetSpendHeight(mempoolDuplicate);
-    const uint256 epochHash = GetSpendEpochHash(mempoolDuplicate, Params().GetConsensus());
+    const CSpendContext spendContext = GetSpendContext(mempoolDuplicate, Params().GetConsensus());
+    const int64_t spendheight = spendContext.nSpendHeight;
+    const uint256& epochHash = spendContext.epochHash;
 
     std::list<const CTxMemPoolEntry*> waitingOnDependants;
+    size_t nBindPlotterTxsCheck = 0;
     for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
         unsigned int i = 0;
         checkTotal += it->GetTxSize();
@@ -684,6 +751,12 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             }
         }
         assert(setChildrenCheck == GetMemPoolChildren(it));
+        // Check that binds are indexed by their plotter
+        if (it->GetBindPlotterId() != 0) {
+            auto itBind = mapBindPlotterTxs.find(it->GetBindPlotterId());
+            assert(itBind != mapBindPlotterTxs.end() && itBind->second.count(it));
+            nBindPlotterTxsCheck++;
+        }
         // Also check to make sure size is greater than sum with immediate children.
         // just a sanity check, not definitive that this calc is correct...
         assert(it->GetSizeWithDescendants() >= child_sizes + it->GetTxSize());
@@ -715,6 +788,12 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         assert(&tx == it->second);
     }
 
+    for (const auto& bind : mapBindPlotterTxs) {
+        assert(!bind.second.empty());
+        nBindPlotterTxsCheck -= bind.second.size();
+    }
+    assert(nBindPlotterTxsCheck == 0);
+
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
 }
@@ -766,15 +845,33 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
 
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
 {
+    vtxid = *GetHashesSnapshot();
+}
+
+std::shared_ptr<const std::vector<uint256>> CTxMemPool::GetHashesSnapshot() const
+{
+    {
+        // Every change of the pool bumps nTransactionsUpdated under cs, so a snapshot taken
+        // at the current value is what a reader holding cs would see now
+        LOCK(cs_hashes_snapshot);
+        if (m_hashes_snapshot && m_hashes_snapshot_updated == nTransactionsUpdated)
+            return m_hashes_snapshot;
+    }
+
     LOCK(cs);
     auto iters = GetSortedDepthAndScore();
 
-    vtxid.clear();
-    vtxid.reserve(mapTx.size());
+    std::shared_ptr<std::vector<uint256>> vtxid = std::make_shared<std::vector<uint256>>();
+    vtxid->reserve(mapTx.size());
 
     for (auto it : iters) {
-        vtxid.push_back(it->GetTx().GetHash());
+        vtxid->push_back(it->GetTx().GetHash());
     }
+
+    LOCK(cs_hashes_snapshot);
+    m_hashes_snapshot = vtxid;
+    m_hashes_snapshot_updated = nTransactionsUpdated;
+    return m_hashes_snapshot;
 }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
@@ -859,6 +956,13 @@ void CTxMemPool::ClearPrioritisation(const uint256 hash)
     mapDeltas.erase(hash);
 }
 
+CTxMemPool::setEntries CTxMemPool::GetBindPlotterTxs(uint64_t plotterId) const
+{
+    AssertLockHeld(cs);
+    auto itBind = mapBindPlotterTxs.find(plotterId);
+    return itBind == mapBindPlotterTxs.end() ? setEntries() : itBind->second;
+}
+
 const CTransaction* CTxMemPool::GetConflictTx(const COutPoint& prevout) const
 {
     const auto it = mapNextTx.find(prevout);
@@ -911,7 +1015,10 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    size_t nBindPlotterUsage = memusage::DynamicUsage(mapBindPlotterTxs);
+    for (const auto& bind : mapBindPlotterTxs)
+        nBindPlotterUsage += memusage::DynamicUsage(bind.second);
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + nBindPlotterUsage + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -77,6 +77,7 @@ private:
     const int64_t sigOpCost;        //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
+    const uint64_t nBindPlotterId; //!< Plotter the transaction binds, 0 if it binds none
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -108,6 +109,7 @@ public:
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    uint64_t GetBindPlotterId() const { return nBindPlotterId; }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -131,6 +133,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t m_epoch; //!< Epoch of the last graph walk that visited this entry, see CTxMemPool::EpochGuard
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -457,6 +460,9 @@ private:
 
     bool m_is_loaded GUARDED_BY(cs){false};
 
+    mutable uint64_t m_epoch{0};
+    mutable bool m_has_epoch_guard{false};
+
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
@@ -546,6 +552,35 @@ private:
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /**
+     * Starts a graph walk of the entries. Entries stamped with the epoch of the walk by visited() count as
+     * visited, which replaces a set of the visited entries. Walks do not nest.
+     */
+    class EpochGuard {
+        const CTxMemPool& pool;
+    public:
+        explicit EpochGuard(const CTxMemPool& in);
+        ~EpochGuard();
+    };
+
+    /** Mark it as visited by the current walk, returning whether it already was */
+    bool visited(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        assert(m_has_epoch_guard);
+        const bool ret = it->m_epoch >= m_epoch;
+        it->m_epoch = std::max(it->m_epoch, m_epoch);
+        return ret;
+    }
+
+    typedef std::map<uint64_t, setEntries> bindPlotterMap;
+    //! Bind plotter transactions of the pool, by the plotter they bind
+    bindPlotterMap mapBindPlotterTxs GUARDED_BY(cs);
+
+    //! The last result of queryHashes() and the nTransactionsUpdated it was taken at
+    mutable Mutex cs_hashes_snapshot;
+    mutable std::shared_ptr<const std::vector<uint256>> m_hashes_snapshot GUARDED_BY(cs_hashes_snapshot);
+    mutable unsigned int m_hashes_snapshot_updated GUARDED_BY(cs_hashes_snapshot){0};
+
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
@@ -582,6 +617,11 @@ public:
     void _clear() EXCLUSIVE_LOCKS_REQUIRED(cs); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
     void queryHashes(std::vector<uint256>& vtxid) const;
+    /**
+     * The txids of the pool sorted as by queryHashes(). The snapshot is shared until the pool changes,
+     * so that polling readers do not take cs and contend with transaction acceptance meanwhile.
+     */
+    std::shared_ptr<const std::vector<uint256>> GetHashesSnapshot() const;
     bool isSpent(const COutPoint& outpoint) const;
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
@@ -599,6 +639,9 @@ public:
     /** Get the transaction in the pool that spends the same prevout */
     const CTransaction* GetConflictTx(const COutPoint& prevout) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Get the transactions in the pool that bind a plotter */
+    setEntries GetBindPlotterTxs(uint64_t plotterId) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Returns an iterator to the given hash, if found */
     boost::optional<txiter> GetIter(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
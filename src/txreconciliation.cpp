@@ -0,0 +1,147 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txreconciliation.h>
+
+#include <crypto/siphash.h>
+#include <hash.h>
+
+#include <algorithm>
+#include <cmath>
+
+//! Spreads the bits of a 64-bit value, the short ids are salted already
+static inline uint64_t MixBits(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint32_t GetCheckSum(uint32_t nShortID)
+{
+    return (uint32_t) (MixBits(nShortID | 0x5100000000ULL) >> 32);
+}
+
+CTxReconciliationSketch::CTxReconciliationSketch(uint32_t nCells) : vCells((nCells + 2) / 3 * 3)
+{
+}
+
+uint32_t CTxReconciliationSketch::CellsForSets(size_t nLocal, size_t nRemote)
+{
+    const size_t nDiff = std::max(nLocal, nRemote) - std::min(nLocal, nRemote);
+    const double nExpected = nDiff + RECON_DIFF_RATIO * std::min(nLocal, nRemote);
+    const double nCells = std::ceil(nExpected * RECON_CELLS_PER_DIFF) + RECON_SPARE_CELLS;
+    if (nCells > MAX_RECON_SKETCH_CELLS)
+        return 0;
+    return ((uint32_t) nCells + 2) / 3 * 3;
+}
+
+void CTxReconciliationSketch::Toggle(uint32_t nShortID, int32_t nCount)
+{
+    const size_t nSubCells = vCells.size() / 3;
+    if (nSubCells == 0)
+        return;
+    const uint32_t nCheckSum = GetCheckSum(nShortID);
+    for (uint64_t n = 0; n < 3; n++) {
+        Cell& cell = vCells[n * nSubCells + MixBits(nShortID | (n << 32)) % nSubCells];
+        cell.nCount += nCount;
+        cell.nIDSum ^= nShortID;
+        cell.nCheckSum ^= nCheckSum;
+    }
+}
+
+bool CTxReconciliationSketch::Subtract(const CTxReconciliationSketch& other)
+{
+    if (other.vCells.size() != vCells.size())
+        return false;
+    for (size_t i = 0; i < vCells.size(); i++) {
+        vCells[i].nCount -= other.vCells[i].nCount;
+        vCells[i].nIDSum ^= other.vCells[i].nIDSum;
+        vCells[i].nCheckSum ^= other.vCells[i].nCheckSum;
+    }
+    return true;
+}
+
+bool CTxReconciliationSketch::Decode(std::vector<uint32_t>& vAdded, std::vector<uint32_t>& vSubtracted) const
+{
+    vAdded.clear();
+    vSubtracted.clear();
+    if (!IsValid())
+        return false;
+
+    // Peel the cells holding a single id until none is left
+    CTxReconciliationSketch sketch(*this);
+    std::vector<size_t> vPure;
+    for (size_t i = 0; i < sketch.vCells.size(); i++)
+        vPure.push_back(i);
+    while (!vPure.empty()) {
+        const Cell cell = sketch.vCells[vPure.back()];
+        vPure.pop_back();
+        if ((cell.nCount != 1 && cell.nCount != -1) || cell.nCheckSum != GetCheckSum(cell.nIDSum))
+            continue;
+        // Each peeled id empties a cell, more ids than cells means the checksums were fooled
+        if (vAdded.size() + vSubtracted.size() >= sketch.vCells.size())
+            break;
+        (cell.nCount == 1 ? vAdded : vSubtracted).push_back(cell.nIDSum);
+
+        sketch.Toggle(cell.nIDSum, -cell.nCount);
+        const size_t nSubCells = sketch.vCells.size() / 3;
+        for (uint64_t n = 0; n < 3; n++)
+            vPure.push_back(n * nSubCells + MixBits(cell.nIDSum | (n << 32)) % nSubCells);
+    }
+
+    for (const Cell& cell : sketch.vCells) {
+        if (!cell.IsEmpty()) {
+            vAdded.clear();
+            vSubtracted.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+CTxReconciliationState::CTxReconciliationState(bool fInitiatorIn, bool fFloodIn, uint64_t nLocalSalt, uint64_t nRemoteSalt)
+    : fInitiator(fInitiatorIn), fFlood(fFloodIn)
+{
+    // Both sides derive the same keys from the two salts
+    CHashWriter hasher(SER_GETHASH, 0);
+    hasher << std::string("Qitcoin tx reconciliation") << std::min(nLocalSalt, nRemoteSalt) << std::max(nLocalSalt, nRemoteSalt);
+    const uint256 hash = hasher.GetHash();
+    k0 = hash.GetUint64(0);
+    k1 = hash.GetUint64(1);
+}
+
+uint32_t CTxReconciliationState::GetShortID(const uint256& txid) const
+{
+    return (uint32_t) SipHashUint256(k0, k1, txid);
+}
+
+bool CTxReconciliationState::AddTransaction(const uint256& txid)
+{
+    if (mapLocalSet.size() >= MAX_RECON_SET)
+        return false;
+    auto ret = mapLocalSet.emplace(GetShortID(txid), txid);
+    // A short id taken by another transaction can not be reconciled
+    return ret.second || ret.first->second == txid;
+}
+
+CTxReconciliationSketch CTxReconciliationState::MakeSketch(const std::map<uint32_t, uint256>& mapSet, uint32_t nCells)
+{
+    CTxReconciliationSketch sketch(nCells);
+    for (const auto& entry : mapSet)
+        sketch.Add(entry.first);
+    return sketch;
+}
+
+std::vector<uint256> CTxReconciliationState::GetTransactions(const std::map<uint32_t, uint256>& mapSet)
+{
+    std::vector<uint256> vTxid;
+    vTxid.reserve(mapSet.size());
+    for (const auto& entry : mapSet)
+        vTxid.push_back(entry.second);
+    return vTxid;
+}
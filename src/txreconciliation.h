@@ -0,0 +1,133 @@
+// Copyright (c) 2021-2022 The Qitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXRECONCILIATION_H
+#define BITCOIN_TXRECONCILIATION_H
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Version of the reconciliation protocol sent in "sendrecon" messages */
+static const uint32_t TXRECONCILIATION_PROTOCOL = 1;
+/** Outbound reconciling peers which still get the transactions flooded */
+static const int MAX_RECON_FLOOD_PEERS = 2;
+/** Average delay between two reconciliations with an outbound peer, in seconds */
+static const unsigned int RECON_REQUEST_INTERVAL = 8;
+/** Seconds to wait for the answer of a reconciliation before announcing the set by inv */
+static const int64_t RECON_RESPONSE_TIMEOUT = 60;
+/** Maximum transactions in a reconciliation set, more are flooded */
+static const size_t MAX_RECON_SET = 4000;
+/** Maximum cells of a reconciliation sketch */
+static const uint32_t MAX_RECON_SKETCH_CELLS = 6000;
+/** Cells of a sketch per expected difference, and the spare cells for small differences */
+static const double RECON_CELLS_PER_DIFF = 1.7;
+static const uint32_t RECON_SPARE_CELLS = 24;
+/** Expected share of the smaller set which is not in the other set */
+static const double RECON_DIFF_RATIO = 0.25;
+
+/**
+ * An invertible bloom lookup table of 32-bit short transaction ids. Each id is added to one cell of each of
+ * three subtables. The sketch of one set minus the sketch of another set can be decoded to the ids in one
+ * set only, as long as the sets differ in less than about RECON_CELLS_PER_DIFF cells per id.
+ *
+ * Used by the set reconciliation of transaction announcements: instead of announcing every transaction by
+ * inv on every link, two peers exchange a sketch of the transactions each would announce to the other, and
+ * only announce the difference.
+ */
+class CTxReconciliationSketch
+{
+public:
+    struct Cell {
+        int32_t nCount = 0;
+        uint32_t nIDSum = 0;
+        uint32_t nCheckSum = 0;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(nCount);
+            READWRITE(nIDSum);
+            READWRITE(nCheckSum);
+        }
+
+        bool IsEmpty() const { return nCount == 0 && nIDSum == 0 && nCheckSum == 0; }
+    };
+
+private:
+    std::vector<Cell> vCells;
+
+    void Toggle(uint32_t nShortID, int32_t nCount);
+
+public:
+    CTxReconciliationSketch() {}
+    /** An empty sketch, nCells is rounded up to a multiple of 3 */
+    explicit CTxReconciliationSketch(uint32_t nCells);
+
+    /** Cells of a sketch for sets of these sizes, 0 if the difference is expected to be too big */
+    static uint32_t CellsForSets(size_t nLocal, size_t nRemote);
+
+    size_t GetCellCount() const { return vCells.size(); }
+    /** Whether the sketch can be decoded at all: a multiple of 3 and at most MAX_RECON_SKETCH_CELLS cells */
+    bool IsValid() const { return vCells.size() % 3 == 0 && vCells.size() <= MAX_RECON_SKETCH_CELLS; }
+
+    void Add(uint32_t nShortID) { Toggle(nShortID, 1); }
+    /** Subtract the sketch of another set of the same size: what is left is the sketch of the difference */
+    bool Subtract(const CTxReconciliationSketch& other);
+
+    /**
+     * Decode the difference: the ids added only to this sketch, and those added only to the subtracted one.
+     * Fails if the difference is too big for the cells.
+     */
+    bool Decode(std::vector<uint32_t>& vAdded, std::vector<uint32_t>& vSubtracted) const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(vCells);
+    }
+};
+
+/**
+ * Reconciliation state of a peer which negotiated it with "sendrecon". The outbound side of a connection
+ * initiates the reconciliations with "reqrecon" messages, the inbound side responds with the sketch of its set.
+ */
+class CTxReconciliationState
+{
+public:
+    //! Whether we initiate the reconciliations, i.e. the peer is outbound
+    const bool fInitiator;
+    //! Whether the transactions are still flooded to the peer
+    const bool fFlood;
+
+private:
+    uint64_t k0, k1;
+
+public:
+    //! Transactions to announce to the peer by reconciliation, by short id
+    std::map<uint32_t, uint256> mapLocalSet;
+    //! The set the last sketch sent was made of, until the peer tells us the difference
+    std::map<uint32_t, uint256> mapSketchedSet;
+    //! Time of the next reconciliation request, and of the request we wait for, 0 if none, in microseconds
+    int64_t nNextRequest = 0;
+    int64_t nRequestSent = 0;
+
+    CTxReconciliationState(bool fInitiatorIn, bool fFloodIn, uint64_t nLocalSalt, uint64_t nRemoteSalt);
+
+    uint32_t GetShortID(const uint256& txid) const;
+    /** Add a transaction to the set, false if the set is full */
+    bool AddTransaction(const uint256& txid);
+
+    static CTxReconciliationSketch MakeSketch(const std::map<uint32_t, uint256>& mapSet, uint32_t nCells);
+    static std::vector<uint256> GetTransactions(const std::map<uint32_t, uint256>& mapSet);
+};
+
+#endif // BITCOIN_TXRECONCILIATION_H
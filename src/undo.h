@@ -58,8 +58,7 @@ public:
         }
         ::Unserialize(s, CTxOutCompressor(REF(txout->out)));
 
-        txout->outAccountID = ExtractAccountID(txout->out.scriptPubKey);
-        txout->payload = ExtractTxoutPayload(txout->out, txout->nHeight);
+        txout->OnUpdated();
     }
 
     explicit TxInUndoDeserializer(Coin* coin) : txout(coin) {}
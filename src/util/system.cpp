@@ -33,6 +33,7 @@
 #include <sched.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #else
 
@@ -63,6 +64,7 @@
 #include <malloc.h>
 #endif
 
+#include <limits>
 #include <thread>
 #include <typeinfo>
 
@@ -1138,6 +1140,25 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
 #endif
 }
 
+/**
+ * this function tells the OS that a particular range of a file is about to be read, so that it gets read ahead
+ * it is advisory, and does nothing where not supported
+ */
+void ReadAheadFileRange(FILE *file, int64_t offset, int64_t length) {
+#if defined(__linux__)
+    posix_fadvise(fileno(file), (off_t)offset, (off_t)length, POSIX_FADV_WILLNEED);
+#elif defined(MAC_OSX)
+    struct radvisory advice;
+    advice.ra_offset = (off_t)offset;
+    advice.ra_count = (int)std::min<int64_t>(length, std::numeric_limits<int>::max());
+    fcntl(fileno(file), F_RDADVISE, &advice);
+#else
+    (void)file;
+    (void)offset;
+    (void)length;
+#endif
+}
+
 #ifdef WIN32
 fs::path GetSpecialFolderPath(int nFolder, bool fCreate)
 {
@@ -1221,6 +1242,23 @@ int GetNumCores()
     return std::thread::hardware_concurrency();
 }
 
+int64_t GetProcessResidentMemory()
+{
+#ifdef __linux__
+    FILE* file = fsbridge::fopen("/proc/self/statm", "r");
+    if (!file)
+        return 0;
+    long nPages = 0;
+    const int nRead = fscanf(file, "%*s %ld", &nPages);
+    fclose(file);
+    if (nRead != 1 || nPages <= 0)
+        return 0;
+    return (int64_t) nPages * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
 std::string CopyrightHolders(const std::string& strTemplate)
 {
     std::string strCopyrightHolders;
@@ -55,6 +55,7 @@ bool FileCommit(FILE *file);
 bool TruncateFile(FILE *file, unsigned int length);
 int RaiseFileDescriptorLimit(int nMinFD);
 void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
+void ReadAheadFileRange(FILE *file, int64_t offset, int64_t length);
 bool RenameOver(fs::path src, fs::path dest);
 bool LockDirectory(const fs::path& directory, const std::string lockfile_name, bool probe_only=false);
 void UnlockDirectory(const fs::path& directory, const std::string& lockfile_name);
@@ -341,6 +342,11 @@ std::string HelpMessageOpt(const std::string& option, const std::string& message
  */
 int GetNumCores();
 
+/**
+ * Return the resident memory of the process in bytes, or 0 where it is not known.
+ */
+int64_t GetProcessResidentMemory();
+
 /**
  * .. and a wrapper that just calls func once
  */
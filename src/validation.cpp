@@ -14,11 +14,14 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
 #include <key_io.h>
+#include <metrics.h>
+#include <node/utxo_snapshot.h>
 #include <poc/poc.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -32,6 +35,7 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <threadpool.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
@@ -43,6 +47,8 @@
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/threadnames.h>
+#include <util/trace.h>
 #include <util/translation.h>
 #include <util/validation.h>
 #include <validationinterface.h>
@@ -52,10 +58,17 @@
 #include <omnicore_api.h>
 #endif
 
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <cinttypes>
+#include <condition_variable>
+#include <deque>
 #include <future>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -127,7 +140,10 @@ bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 bool fCheckWork = DEFAULT_CHECKWORK_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+int64_t nMaxProcessMemory = DEFAULT_MAX_PROCESS_MEMORY;
 uint64_t nPruneTarget = 0;
+int nBlockCompressionLevel = DEFAULT_BLOCK_COMPRESSION_LEVEL;
+int nReorgUndoCacheBlocks = DEFAULT_REORG_UNDO_CACHE_BLOCKS;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
 uint256 hashAssumeValid;
@@ -197,6 +213,8 @@ static FILE* OpenUndoFile(const FlatFilePos &pos, bool fReadOnly = false);
 static FlatFileSeq BlockFileSeq();
 static FlatFileSeq UndoFileSeq();
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
 bool CheckFinalTx(const CTransaction &tx, int flags)
 {
     AssertLockHeld(cs_main);
@@ -365,6 +383,11 @@ static void UpdateMempoolForReorg(DisconnectedBlockTransactions& disconnectpool,
 {
     AssertLockHeld(cs_main);
     std::vector<uint256> vHashUpdate;
+    if (fAddToMempool) {
+        // The bind plotter transactions of the disconnected blocks verify their plotter signatures together
+        std::vector<CTransactionRef> vtx(disconnectpool.queuedTx.get<insertion_order>().begin(), disconnectpool.queuedTx.get<insertion_order>().end());
+        PreverifyBindPlotterSignatures(vtx);
+    }
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
     // latest mined block that was disconnected.
@@ -436,6 +459,46 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
     return CheckInputs(tx, state, view, flags, cacheSigStore, true, txdata);
 }
 
+/**
+ * Bind plotter outputs of mempool transactions, whose payload signatures were verified. The height
+ * checks of their payloads are not cached, as they depend on the block that includes them.
+ */
+static CuckooCache::cache<uint256, SignatureCacheHasher> bindPayloadCache;
+static uint256 bindPayloadCacheNonce(GetRandHash());
+
+void InitBindPayloadCache() {
+    // A bind plotter output takes one element, so a small share of the signature cache size is plenty
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 32), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = bindPayloadCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu/32 requested for bind payload cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*32)>>20, nElems);
+}
+
+static uint256 GetBindPayloadCacheEntry(const uint256& txid, uint32_t n)
+{
+    // We only use the first 19 bytes of nonce to avoid a second SHA
+    // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
+    static_assert(55 - sizeof(n) - 32 >= 128/8, "Want at least 128 bits of nonce for bind payload cache");
+    uint256 hashCacheEntry;
+    CSHA256().Write(bindPayloadCacheNonce.begin(), 55 - sizeof(n) - 32).Write(txid.begin(), 32).Write((unsigned char*)&n, sizeof(n)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
+}
+
+/** The output of a transaction with a bind plotter payload, -1 if none or several */
+static int GetBindPlotterOutput(const CTransaction& tx)
+{
+    int nBindOut = -1;
+    for (unsigned int i = 0; i < tx.vout.size(); i++) {
+        const CScript& payload = tx.vout[i].payload;
+        if (payload.size() < 6 || payload[0] != 0x04 || ReadLE32(&payload[1]) != TXOUT_TYPE_BINDPLOTTER)
+            continue;
+        if (nBindOut >= 0)
+            return -1;
+        nBindOut = i;
+    }
+    return nBindOut;
+}
+
 namespace {
 
 class MemPoolAccept
@@ -682,8 +745,8 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
         return state.Invalid(ValidationInvalidReason::TX_PREMATURE_SPEND, false, REJECT_NONSTANDARD, "non-BIP68-final");
 
     CAmount nFees = 0;
-    const uint256 spendEpochHash = GetSpendEpochHash(m_view, chainparams.GetConsensus());
-    if (!Consensus::CheckTxInputs(tx, state, m_view, coins_cache, GetSpendHeight(m_view), nFees, spendEpochHash, chainparams.GetConsensus())) {
+    const CSpendContext spendContext = GetSpendContext(m_view, chainparams.GetConsensus());
+    if (!Consensus::CheckTxInputs(tx, state, m_view, coins_cache, spendContext.nSpendHeight, nFees, spendContext.epochHash, chainparams.GetConsensus())) {
         return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
     }
 
@@ -729,6 +792,15 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
                 REJECT_HIGHFEE, "absurdly-high-fee",
                 strprintf("%d > %d", nFees, nAbsurdFee));
 
+    // A plotter can have only one bind in the mempool, as a second one would owe
+    // the bind plotter punishment once the first was mined. Replacing it is fine.
+    if (entry->GetBindPlotterId() != 0) {
+        for (CTxMemPool::txiter it : m_pool.GetBindPlotterTxs(entry->GetBindPlotterId())) {
+            if (!setConflicts.count(it->GetTx().GetHash()))
+                return state.Invalid(ValidationInvalidReason::TX_MEMPOOL_POLICY, false, REJECT_DUPLICATE, "txn-mempool-bindplotter-conflict");
+        }
+    }
+
     const CTxMemPool::setEntries setIterConflicting = m_pool.GetIterSet(setConflicts);
     // Calculate in-mempool ancestors, up to a limit.
     if (setConflicts.size() == 1) {
@@ -929,6 +1001,20 @@ bool MemPoolAccept::PolicyScriptChecks(ATMPArgs& args, Workspace& ws, Precompute
 
     constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
 
+    // Verify the input scripts of larger transactions on the script check
+    // threads first. A failure is left to the serial check below to report,
+    // which then only finds the inputs that passed in the signature cache.
+    if (nScriptCheckThreads && tx.vin.size() > 1) {
+        std::vector<CScriptCheck> vChecks;
+        CValidationState stateDummy;
+        if (CheckInputs(tx, stateDummy, m_view, scriptVerifyFlags, true, false, txdata, &vChecks)) {
+            CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+            control.Add(vChecks);
+            if (control.Wait())
+                return true;
+        }
+    }
+
     // Check against previous transactions
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
     if (!CheckInputs(tx, state, m_view, scriptVerifyFlags, true, false, txdata)) {
@@ -1016,6 +1102,13 @@ bool MemPoolAccept::Finalize(ATMPArgs& args, Workspace& ws)
     // - the transaction is not dependent on any other transactions in the mempool
     bool validForFeeEstimation = !fReplacementTransaction && !bypass_limits && IsCurrentForFeeEstimation() && m_pool.HasNoInputsOf(tx);
 
+    // The entry found a valid bind plotter payload, which connecting the block need not verify again
+    if (entry->GetBindPlotterId() != 0) {
+        const int nBindOut = GetBindPlotterOutput(tx);
+        if (nBindOut >= 0)
+            bindPayloadCache.insert(GetBindPayloadCacheEntry(hash, nBindOut));
+    }
+
     // Store transaction in memory
     m_pool.addUnchecked(*entry, setAncestors, validForFeeEstimation);
 
@@ -1093,7 +1186,12 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool bypass_limits, const CAmount nAbsurdFee, bool test_accept)
 {
     const CChainParams& chainparams = Params();
-    return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
+    int64_t nTimeStart = GetTimeMicros();
+    bool fAccepted = AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee, test_accept);
+    const int64_t nTimeAccept = GetTimeMicros() - nTimeStart;
+    metrics::g_mempool_accept_latency.Observe(nTimeAccept);
+    TRACE3(mempool, accept, tx->GetHash().begin(), fAccepted, nTimeAccept);
+    return fAccepted;
 }
 
 /**
@@ -1140,7 +1238,90 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/*
+ * Block and undo data are optionally stored compressed. The header of a compressed record has the
+ * inverted message start bytes, followed by the size of the record like for raw data. The record
+ * holds the size of the raw data and its zstd frame. Positions point behind the header for both
+ * kinds, so readers look at the header to tell them apart, and files may mix both.
+ */
+
+bool IsBlockCompressionSupported()
+{
+#ifdef USE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void GetCompressedMessageStart(const CMessageHeader::MessageStartChars& messageStart, CMessageHeader::MessageStartChars& compressedStart)
+{
+    for (unsigned int i = 0; i < CMessageHeader::MESSAGE_START_SIZE; i++) {
+        compressedStart[i] = ~messageStart[i];
+    }
+}
+
+/** Serialize and compress block or undo data for writing to disk. False if disabled or if it saves no space */
+template <typename T>
+static bool CompressForDisk(const T& obj, std::vector<unsigned char>& record)
+{
+#ifdef USE_ZSTD
+    if (nBlockCompressionLevel <= 0)
+        return false;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << obj;
+    record.resize(sizeof(uint32_t) + ZSTD_compressBound(ss.size()));
+    WriteLE32(record.data(), ss.size());
+    const size_t nCompressed = ZSTD_compress(record.data() + sizeof(uint32_t), record.size() - sizeof(uint32_t), ss.data(), ss.size(), nBlockCompressionLevel);
+    if (ZSTD_isError(nCompressed) || sizeof(uint32_t) + nCompressed >= ss.size())
+        return false;
+    record.resize(sizeof(uint32_t) + nCompressed);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** Decompress a compressed record read from disk */
+static bool DecompressFromDisk(const unsigned char* record, size_t nRecordSize, CDataStream& ss)
+{
+#ifdef USE_ZSTD
+    if (nRecordSize < sizeof(uint32_t))
+        return error("%s: Compressed record too short", __func__);
+    const uint32_t nSize = ReadLE32(record);
+    if (nSize > MAX_SIZE)
+        return error("%s: Compressed record is larger than maximum deserialization size (%u)", __func__, nSize);
+
+    ss.clear();
+    ss.resize(nSize);
+    const size_t nDecompressed = ZSTD_decompress(ss.data(), nSize, record + sizeof(uint32_t), nRecordSize - sizeof(uint32_t));
+    if (ZSTD_isError(nDecompressed) || nDecompressed != nSize)
+        return error("%s: Decompression failed", __func__);
+    return true;
+#else
+    return error("%s: Compressed block storage is not supported by this build", __func__);
+#endif
+}
+
+/** Read the header ahead of block or undo data, and the record of compressed data. False on unknown headers */
+static bool ReadDiskHeader(CAutoFile& filein, const CMessageHeader::MessageStartChars& messageStart, unsigned int& nSize,
+    std::vector<unsigned char>& record, bool& fCompressed)
+{
+    CMessageHeader::MessageStartChars start, compressedStart;
+    GetCompressedMessageStart(messageStart, compressedStart);
+    filein >> start >> nSize;
+    fCompressed = memcmp(start, compressedStart, CMessageHeader::MESSAGE_START_SIZE) == 0;
+    if (!fCompressed)
+        return memcmp(start, messageStart, CMessageHeader::MESSAGE_START_SIZE) == 0;
+    if (nSize > MAX_SIZE)
+        return false;
+    record.resize(nSize);
+    filein.read((char*)record.data(), nSize);
+    return true;
+}
+
+static bool WriteBlockToDisk(const CBlock& block, const std::vector<unsigned char>& record, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1148,15 +1329,24 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
-    fileout << messageStart << nSize;
+    if (record.empty()) {
+        unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
+        fileout << messageStart << nSize;
+    } else {
+        CMessageHeader::MessageStartChars compressedStart;
+        GetCompressedMessageStart(messageStart, compressedStart);
+        fileout << compressedStart << (unsigned int)record.size();
+    }
 
     // Write block
     long fileOutPos = ftell(fileout.Get());
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    if (record.empty())
+        fileout << block;
+    else
+        fileout.write((const char*)record.data(), record.size());
 
     return true;
 }
@@ -1165,14 +1355,28 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, at the header ahead of the block
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
     // Read block
     try {
-        filein >> block;
+        unsigned int nSize;
+        std::vector<unsigned char> record;
+        bool fCompressed;
+        if (!ReadDiskHeader(filein, Params().MessageStart(), nSize, record, fCompressed))
+            return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+        if (!fCompressed) {
+            filein >> block;
+        } else {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            if (!DecompressFromDisk(record.data(), record.size(), ss))
+                return error("%s: Failed to decompress block at %s", __func__, pos.ToString());
+            ss >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1207,15 +1411,20 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
     }
 
     try {
-        CMessageHeader::MessageStartChars blk_start;
         unsigned int blk_size;
+        std::vector<unsigned char> record;
+        bool compressed;
+        if (!ReadDiskHeader(filein, message_start, blk_size, record, compressed)) {
+            return error("%s: Block magic mismatch for %s", __func__, pos.ToString());
+        }
 
-        filein >> blk_start >> blk_size;
-
-        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
-            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
-                    HexStr(blk_start, blk_start + CMessageHeader::MESSAGE_START_SIZE),
-                    HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
+        if (compressed) {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            if (!DecompressFromDisk(record.data(), record.size(), ss)) {
+                return error("%s: Failed to decompress block for %s", __func__, pos.ToString());
+            }
+            block.assign(ss.begin(), ss.end());
+            return true;
         }
 
         if (blk_size > MAX_SIZE) {
@@ -1243,6 +1452,44 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+bool ReadTxFromDisk(CTransactionRef& tx, uint256& hashBlock, const FlatFilePos& pos, unsigned int nTxOffset)
+{
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    CBlockHeader header;
+    try {
+        unsigned int nSize;
+        std::vector<unsigned char> record;
+        bool fCompressed;
+        if (!ReadDiskHeader(filein, Params().MessageStart(), nSize, record, fCompressed))
+            return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+        if (!fCompressed) {
+            filein >> header;
+            if (fseek(filein.Get(), nTxOffset, SEEK_CUR))
+                return error("%s: fseek(...) failed", __func__);
+            filein >> tx;
+        } else {
+            // The offset is into the raw block
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            if (!DecompressFromDisk(record.data(), record.size(), ss))
+                return error("%s: Failed to decompress block at %s", __func__, pos.ToString());
+            ss >> header;
+            if (nTxOffset > ss.size())
+                return error("%s: Transaction offset beyond the block at %s", __func__, pos.ToString());
+            ss.ignore(nTxOffset);
+            ss >> tx;
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    hashBlock = header.GetHash();
+    return true;
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     if (nHeight == 1) {
@@ -1266,6 +1513,63 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
     return nSubsidy;
 }
 
+namespace {
+/**
+ * The fee independent part of the PoC block reward, which scans the staking accounts and the net capacity window.
+ * It only depends on the coins of the previous block, so the one of the last previous block is kept for templates
+ * and the verification of the same block.
+ */
+struct CBlockRewardSplitCache
+{
+    uint256 hashBestBlock;
+    int nTopStakingAccounts{0};
+    CAccountBalanceList vTopStakingAccounts;
+    std::map<std::pair<CAccountID, uint64_t>, bool> mapFullPledge;
+};
+
+Mutex cs_block_reward_split;
+CBlockRewardSplitCache blockRewardSplitCache GUARDED_BY(cs_block_reward_split);
+} // namespace
+
+//! Whether the generator pledged enough for the full reward, and the top N staking accounts
+static void GetBlockRewardSplit(const CAccountID& generatorID, uint64_t nPlotterId, int nHeight, int N, const CCoinsViewCache& view,
+    const Consensus::Params& consensusParams, bool& fFullPledge, CAccountBalanceList& vSortedTopAccount) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint256 hashBestBlock = view.GetBestBlock();
+    const std::pair<CAccountID, uint64_t> key(generatorID, nPlotterId);
+    {
+        LOCK(cs_block_reward_split);
+        CBlockRewardSplitCache& cache = blockRewardSplitCache;
+        if (!hashBestBlock.IsNull() && cache.hashBestBlock == hashBestBlock && cache.nTopStakingAccounts == N) {
+            auto it = cache.mapFullPledge.find(key);
+            if (it != cache.mapFullPledge.end()) {
+                fFullPledge = it->second;
+                vSortedTopAccount = cache.vTopStakingAccounts;
+                return;
+            }
+        }
+    }
+
+    const CAmount balancePointReceived = view.GetAccountPointReceivedBalance(generatorID);
+    const CAmount miningRequireBalance = poc::GetMiningRequireBalance(generatorID, nPlotterId, nHeight, view, nullptr, consensusParams);
+    fFullPledge = balancePointReceived >= miningRequireBalance;
+
+    LOCK(cs_block_reward_split);
+    CBlockRewardSplitCache& cache = blockRewardSplitCache;
+    if (hashBestBlock.IsNull() || cache.hashBestBlock != hashBestBlock || cache.nTopStakingAccounts != N) {
+        vSortedTopAccount = view.GetTopStakingAccounts(N);
+        if (hashBestBlock.IsNull())
+            return;
+        cache.hashBestBlock = hashBestBlock;
+        cache.nTopStakingAccounts = N;
+        cache.vTopStakingAccounts = vSortedTopAccount;
+        cache.mapFullPledge.clear();
+    } else {
+        vSortedTopAccount = cache.vTopStakingAccounts;
+    }
+    cache.mapFullPledge[key] = fFullPledge;
+}
+
 std::vector<CTxOut> GetBlockReward(const CBlockIndex* pindexPrev, const CAmount& nFees, const CAccountID& generatorID, uint64_t nPlotterId, const CCoinsViewCache& view, const Consensus::Params& consensusParams)
 {
     const int nHeight = pindexPrev ? (pindexPrev->nHeight + 1) : 0;
@@ -1297,18 +1601,19 @@ std::vector<CTxOut> GetBlockReward(const CBlockIndex* pindexPrev, const CAmount&
         }
         else
         {
+            const int N = (nHeight >= consensusParams.nMercuryActiveHeight) ? 20 : 10;
+            bool fFullPledge;
+            CAccountBalanceList vSortedTopAccount;
+            GetBlockRewardSplit(generatorID, nPlotterId, nHeight, N, view, consensusParams, fFullPledge, vSortedTopAccount);
+
             // reward to miner
-            const CAmount balancePointReceived = view.GetAccountPointReceivedBalance(generatorID);
-            const CAmount miningRequireBalance = poc::GetMiningRequireBalance(generatorID, nPlotterId, nHeight, view, nullptr, consensusParams);
-            if (balancePointReceived >= miningRequireBalance) {
+            if (fFullPledge) {
                 vTxOut.push_back(CTxOut((nSubsidy * consensusParams.nPledgeFullRewardRatio) / 1000, GetScriptForAccountID(generatorID)));
             } else {
                 vTxOut.push_back(CTxOut((nSubsidy * consensusParams.nPledgeLowRewardRatio) / 1000, GetScriptForAccountID(generatorID)));
             }
 
             // staking to top N
-            const int N = (nHeight >= consensusParams.nMercuryActiveHeight) ? 20 : 10;
-            const CAccountBalanceList vSortedTopAccount = view.GetTopStakingAccounts(N);
             if (!vSortedTopAccount.empty()) {
                 CAmount totalBalance = 0;
                 for (auto &acc : vSortedTopAccount) {
@@ -1378,6 +1683,9 @@ const CBlockIndex* GetEpochInitIndex(const CBlockIndex* pindex, const Consensus:
         return nullptr;
 
     const int targetHeight = pindex->nHeight / consensusParams.nSaturnEpockBlocks * consensusParams.nSaturnEpockBlocks;
+    // Entries of the block index know their epoch, others are walked
+    if (pindex->pepoch && pindex->pepoch->nHeight == targetHeight)
+        return pindex->pepoch;
     return pindex->GetAncestor(targetHeight);
 }
 
@@ -1387,6 +1695,18 @@ uint256 GetEpochHash(const CBlockIndex* pindex, const Consensus::Params& consens
     return epochInit ? epochInit->GetBlockHash() : uint256();
 }
 
+CAmount GetStakingPoolEpochReward(const CBlockIndex* pindex, const CAccountID& poolID, const Consensus::Params& consensusParams)
+{
+    const CBlockIndex* pEpochInitIndex = GetEpochInitIndex(pindex, consensusParams);
+    CAmount nReward = 0;
+    // The epoch init block is rewarded by the snapshot written at it, see TrySnapshotStakingPoolStatus()
+    for (; pindex != pEpochInitIndex; pindex = pindex->pprev) {
+        if (pindex->generatorAccountID == poolID)
+            nReward += GetBlockStakingPoolSubsidy(pindex->nHeight, consensusParams);
+    }
+    return nReward;
+}
+
 uint256 GetCurrentEpochHash(const Consensus::Params& consensusParams)
 {
     return GetEpochHash(::ChainActive().Tip(), consensusParams);
@@ -1394,8 +1714,7 @@ uint256 GetCurrentEpochHash(const Consensus::Params& consensusParams)
 
 uint256 GetSpendEpochHash(const CCoinsViewCache& inputs, const Consensus::Params& params)
 {
-    LOCK(cs_main);
-    return GetEpochHash(LookupBlockIndex(inputs.GetBestBlock()), params);
+    return GetSpendContext(inputs, params).epochHash;
 }
 
 CoinsViews::CoinsViews(
@@ -1404,11 +1723,12 @@ CoinsViews::CoinsViews(
     bool in_memory,
     bool should_wipe) : m_dbview(
                             GetDataDir() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                        m_catcherview(&m_dbview),
+                        m_writerview(&m_catcherview, m_dbview) {}
 
 void CoinsViews::InitCache()
 {
-    m_cacheview = MakeUnique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = MakeUnique<CCoinsViewCache>(&m_writerview);
 }
 
 // NOTE: for now m_blockman is set to a global, but this will be changed
@@ -1599,8 +1919,10 @@ static void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo
             assert(is_spent);
         }
     }
-    // add outputs
-    AddCoins(inputs, tx, nHeight);
+    // add outputs, without verifying again a bind plotter payload accepted by the mempool
+    const int nBindOut = GetBindPlotterOutput(tx);
+    const bool fVerifiedPayloads = nBindOut >= 0 && bindPayloadCache.contains(GetBindPayloadCacheEntry(tx.GetHash(), nBindOut), false);
+    AddCoins(inputs, tx, nHeight, false, fVerifiedPayloads);
 }
 
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
@@ -1622,6 +1944,35 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
     return pindexPrev->nHeight + 1;
 }
 
+namespace {
+// A block's height and epoch never change, so the cached context needs no invalidation
+Mutex cs_spend_context;
+CSpendContext lastSpendContext GUARDED_BY(cs_spend_context);
+} // namespace
+
+CSpendContext GetSpendContext(const CCoinsViewCache& inputs, const Consensus::Params& params)
+{
+    const uint256& hashBestBlock = inputs.GetBestBlock();
+    {
+        LOCK(cs_spend_context);
+        if (!hashBestBlock.IsNull() && lastSpendContext.hashBestBlock == hashBestBlock)
+            return lastSpendContext;
+    }
+
+    CSpendContext context;
+    context.hashBestBlock = hashBestBlock;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexPrev = LookupBlockIndex(hashBestBlock);
+        context.nSpendHeight = pindexPrev->nHeight + 1;
+        context.epochHash = GetEpochHash(pindexPrev, params);
+    }
+
+    LOCK(cs_spend_context);
+    lastSpendContext = context;
+    return context;
+}
+
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
@@ -1728,7 +2079,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     return true;
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+static bool UndoWriteToDisk(const CBlockUndo& blockundo, const std::vector<unsigned char>& record, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1736,15 +2087,24 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
         return error("%s: OpenUndoFile failed", __func__);
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
-    fileout << messageStart << nSize;
+    if (record.empty()) {
+        unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
+        fileout << messageStart << nSize;
+    } else {
+        CMessageHeader::MessageStartChars compressedStart;
+        GetCompressedMessageStart(messageStart, compressedStart);
+        fileout << compressedStart << (unsigned int)record.size();
+    }
 
     // Write undo data
     long fileOutPos = ftell(fileout.Get());
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    if (record.empty())
+        fileout << blockundo;
+    else
+        fileout.write((const char*)record.data(), record.size());
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
@@ -1762,17 +2122,36 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
         return error("%s: no undo data available", __func__);
     }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, at the header ahead of the undo data
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8;
+    CAutoFile filein(OpenUndoFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
     // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    uint256 hashData;
     try {
-        verifier << pindex->pprev->GetBlockHash();
-        verifier >> blockundo;
+        unsigned int nSize;
+        std::vector<unsigned char> record;
+        bool fCompressed;
+        if (!ReadDiskHeader(filein, Params().MessageStart(), nSize, record, fCompressed))
+            return error("%s: Undo data magic mismatch", __func__);
+        if (!fCompressed) {
+            CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+            verifier << pindex->pprev->GetBlockHash();
+            verifier >> blockundo;
+            hashData = verifier.GetHash();
+        } else {
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            if (!DecompressFromDisk(record.data(), record.size(), ss))
+                return error("%s: Failed to decompress undo data", __func__);
+            CHashVerifier<CDataStream> verifier(&ss);
+            verifier << pindex->pprev->GetBlockHash();
+            verifier >> blockundo;
+            hashData = verifier.GetHash();
+        }
         filein >> hashChecksum;
     }
     catch (const std::exception& e) {
@@ -1780,7 +2159,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    if (hashChecksum != hashData)
         return error("%s: Checksum mismatch", __func__);
 
     return true;
@@ -1845,14 +2224,52 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
+/**
+ * Undo data of the most recently connected blocks, oldest first. The spent coins keep the accounts
+ * and payloads decoded while connecting, so disconnecting one of these blocks neither reads its
+ * rev?????.dat record nor parses the payloads of the restored coins again.
+ */
+static std::deque<std::pair<uint256, CBlockUndo>> g_recent_block_undos GUARDED_BY(cs_main);
+
+static void AddRecentBlockUndo(const CBlockIndex* pindex, CBlockUndo&& blockundo) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (nReorgUndoCacheBlocks <= 0)
+        return;
+    const uint256 hash = pindex->GetBlockHash();
+    for (auto it = g_recent_block_undos.begin(); it != g_recent_block_undos.end(); ++it) {
+        if (it->first == hash) {
+            g_recent_block_undos.erase(it);
+            break;
+        }
+    }
+    g_recent_block_undos.emplace_back(hash, std::move(blockundo));
+    while (g_recent_block_undos.size() > (size_t) nReorgUndoCacheBlocks)
+        g_recent_block_undos.pop_front();
+}
+
+/** Copy the undo data of a recently connected block. False if it is not kept in memory */
+static bool GetRecentBlockUndo(const CBlockIndex* pindex, CBlockUndo& blockundo) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint256 hash = pindex->GetBlockHash();
+    // Reorgs disconnect the newest blocks first
+    for (auto it = g_recent_block_undos.rbegin(); it != g_recent_block_undos.rend(); ++it) {
+        if (it->first == hash) {
+            blockundo = it->second;
+            return true;
+        }
+    }
+    return false;
+}
+
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
 DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
 {
+    AssertLockHeld(cs_main);
     bool fClean = true;
 
     CBlockUndo blockUndo;
-    if (!UndoReadFromDisk(blockUndo, pindex)) {
+    if (!GetRecentBlockUndo(pindex, blockUndo) && !UndoReadFromDisk(blockUndo, pindex)) {
         error("DisconnectBlock(): failure reading undo data");
         return DISCONNECT_FAILED;
     }
@@ -1904,7 +2321,11 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
-void static FlushBlockFile(bool fFinalize = false)
+/**
+ * Truncate the pre-allocated space of the last block and undo files, once new blocks go to the next file.
+ * The files are committed to disk at the next write of the block index, with the other files written to.
+ */
+void static FinalizeBlockFile()
 {
     LOCK(cs_LastBlockFile);
 
@@ -1912,8 +2333,41 @@ void static FlushBlockFile(bool fFinalize = false)
     FlatFilePos undo_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
     bool status = true;
-    status &= BlockFileSeq().Flush(block_pos_old, fFinalize);
-    status &= UndoFileSeq().Flush(undo_pos_old, fFinalize);
+    status &= BlockFileSeq().Finalize(block_pos_old);
+    status &= UndoFileSeq().Finalize(undo_pos_old);
+    if (!status) {
+        AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
+    }
+}
+
+/**
+ * Commit the block and undo data written since the last write of the block index to disk, in the last block
+ * file and in the files of the dirty file info, e.g. the undo data of blocks stored out of order. The files
+ * are committed in parallel, so the wait is for one commit rather than one per file.
+ */
+void static FlushBlockFiles() EXCLUSIVE_LOCKS_REQUIRED(cs_LastBlockFile)
+{
+    AssertLockHeld(cs_LastBlockFile);
+
+    std::set<int> setFiles(setDirtyFileInfo);
+    setFiles.insert(nLastBlockFile);
+    std::vector<std::pair<FlatFileSeq, FlatFilePos>> vCommits;
+    for (int nFile : setFiles) {
+        // Pruned files are gone and not committed
+        if (nFile < 0 || (size_t)nFile >= vinfoBlockFile.size())
+            continue;
+        const CBlockFileInfo& info = vinfoBlockFile[nFile];
+        if (info.nSize > 0)
+            vCommits.emplace_back(BlockFileSeq(), FlatFilePos(nFile, info.nSize));
+        if (info.nUndoSize > 0)
+            vCommits.emplace_back(UndoFileSeq(), FlatFilePos(nFile, info.nUndoSize));
+    }
+
+    std::atomic<bool> status{true};
+    GetThreadPool().RunParallel(TaskPriority::CRITICAL, vCommits.size(), [&vCommits, &status](int n) {
+        if (!vCommits[n].first.Flush(vCommits[n].second))
+            status = false;
+    });
     if (!status) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
     }
@@ -1926,9 +2380,11 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40))
+        std::vector<unsigned char> record;
+        const unsigned int nSize = CompressForDisk(blockundo, record) ? record.size() : ::GetSerializeSize(blockundo, CLIENT_VERSION);
+        if (!FindUndoPos(state, pindex->nFile, _pos, nSize + 40))
             return error("ConnectBlock(): FindUndoPos failed");
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+        if (!UndoWriteToDisk(blockundo, record, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
             return AbortNode(state, "Failed to write undo data");
 
         // update nUndoPos in block index
@@ -1940,8 +2396,6 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck(int worker_num) {
     util::ThreadRename(strprintf("scriptch.%i", worker_num));
     scriptcheckqueue.Thread();
@@ -2043,6 +2497,10 @@ static int64_t nTimeVerify = 0;
 static int64_t nTimeConnect = 0;
 static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
+static int64_t nTimeReward = 0;
+//! Header checks do not always run under cs_main
+static std::atomic<int64_t> nTimePoC{0};
+static std::atomic<int64_t> nTimePoS{0};
 static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
@@ -2128,6 +2586,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "sanity", nTime1 - nTimeStart);
 
     // Start enforcing BIP68 (sequence locks)
     int nLockTimeFlags = 0;
@@ -2140,6 +2599,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "forks", nTime2 - nTime1);
 
     CBlockUndo blockundo;
 
@@ -2155,6 +2615,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
     CCoinsViewCache mutableView(&view);
+    // Blocks with many bind plotter transactions verify their plotter signatures together
+    PreverifyBindPlotterSignatures(block.vtx);
+    const Consensus::SpendEra spendEra(pindex->nHeight, chainparams.GetConsensus());
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -2164,7 +2627,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (!tx.IsCoinBase())
         {
             CAmount txfee = 0;
-            if (!Consensus::CheckTxInputs(tx, state, mutableView, view, pindex->nHeight, txfee, epochHash, chainparams.GetConsensus())) {
+            if (!Consensus::CheckTxInputs(tx, state, mutableView, view, spendEra, txfee, epochHash, chainparams.GetConsensus())) {
                 if (!IsBlockReason(state.GetReason())) {
                     // CheckTxInputs may return MISSING_INPUTS or
                     // PREMATURE_SPEND but we can't return that, as it's not
@@ -2234,9 +2697,10 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "connect", nTime3 - nTime2);
 
     // Check generator
-    const CAccountID generatorID = ExtractAccountID(pindex->minerRewardTxOut.scriptPubKey);
+    const CAccountID generatorID = pindex->generatorAccountID;
     if (generatorID.IsNull()) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS,
                         error("ConnectBlock(): Invalidate miner address"),
@@ -2273,13 +2737,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             }
         }
         if (!fValidPool && pindex->nNonce != 0) {
-            for (auto const &pool : view.GetStakingPools(epochHash)) {
-                if (pool.poolID == generatorID) {
-                    if (pindex->nNonce <= (uint64_t) (pool.stakeAmount / COIN)) {
-                        fValidPool = true;
-                    }
-                    break;
-                }
+            StakingPool pool;
+            if (view.GetStakingPool(epochHash, generatorID, pool) && pindex->nNonce <= (uint64_t) (pool.stakeAmount / COIN)) {
+                fValidPool = true;
             }
         }
         if (!fValidPool && chainparams.GetConsensus().fAllowMinDifficultyBlocks) {
@@ -2326,16 +2786,22 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                         REJECT_INVALID, "bad-cb-payload");
     }
 
+    int64_t nTimeRewardEnd = GetTimeMicros(); nTimeReward += nTimeRewardEnd - nTime3;
+    LogPrint(BCLog::BENCH, "      - Generator and reward checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTimeRewardEnd - nTime3), nTimeReward * MICRO, nTimeReward * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "reward", nTimeRewardEnd - nTime3);
+
     if (!control.Wait())
         return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "verify", nTime4 - nTime2);
 
     if (fJustCheck)
         return true;
 
     if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
         return false;
+    AddRecentBlockUndo(pindex, std::move(blockundo));
 
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
@@ -2350,19 +2816,58 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5 - nTime4), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "index", nTime5 - nTime4);
 
     int64_t nTime6 = GetTimeMicros(); nTimeCallbacks += nTime6 - nTime5;
     LogPrint(BCLog::BENCH, "    - Callbacks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeCallbacks * MICRO, nTimeCallbacks * MILLI / nBlocksTotal);
+    TRACE3(validation, connect_block_stage, pindex->nHeight, "callbacks", nTime6 - nTime5);
 
     return true;
 }
 
+/**
+ * The memory the coins tip may use before it has to be flushed: the share of -dbcache and the unused mempool space.
+ *
+ * With -maxprocessmem, the budget is the room the rest of the process, such as the mempool and the Omni state,
+ * leaves below that limit. It grows past the share of -dbcache during initial block download only, and shrinks down
+ * to half of it under pressure. It shrinks by at most a tenth per call, so that the periodic flush, at 90% of the
+ * budget, usually writes the cache before a flush in the middle of block processing is needed.
+ */
+static int64_t GetCoinsCacheBudget(int64_t cacheSize, int64_t nMempoolUsage, int64_t nMempoolSizeMax, bool fInitialDownload) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    static int64_t nBudget = 0;
+
+    const int64_t nStaticSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+    const int64_t nResident = nMaxProcessMemory > 0 ? GetProcessResidentMemory() : 0;
+    if (nResident <= 0) {
+        nBudget = 0;
+        return nStaticSpace;
+    }
+
+    int64_t nTarget = nMaxProcessMemory - std::max<int64_t>(nResident - cacheSize, 0);
+    if (!fInitialDownload)
+        nTarget = std::min(nTarget, nStaticSpace);
+    nTarget = std::max(nTarget, nStaticSpace / 2);
+
+    if (nBudget == 0)
+        nBudget = nStaticSpace;
+    if (nTarget < nBudget) {
+        nBudget = std::max(nTarget, nBudget - std::max<int64_t>(nBudget / 10, 1 << 20));
+    } else if (nTarget > nBudget) {
+        if (nBudget <= nStaticSpace && nTarget > nStaticSpace)
+            LogPrint(BCLog::COINDB, "Growing the coins cache past %.1f MiB, up to %.1f MiB\n", nStaticSpace * (1.0 / 1024 / 1024), nTarget * (1.0 / 1024 / 1024));
+        nBudget = nTarget;
+    }
+    return nBudget;
+}
+
 bool CChainState::FlushStateToDisk(
     const CChainParams& chainparams,
     CValidationState &state,
     FlushStateMode mode,
     int nManualPruneHeight)
 {
+    TRACE2(validation, flush_state_entry, (int)mode, nManualPruneHeight);
     int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
     LOCK(cs_main);
     assert(this->CanFlushToDisk());
@@ -2400,7 +2905,7 @@ bool CChainState::FlushStateToDisk(
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
         int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
-        int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+        int64_t nTotalSpace = GetCoinsCacheBudget(cacheSize, nMempoolUsage, nMempoolSizeMax, IsInitialBlockDownload());
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
         // The cache is over the limit, we have to write now.
@@ -2418,7 +2923,7 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // First make sure all block and undo data is flushed to disk.
-            FlushBlockFile();
+            FlushBlockFiles();
             // Then update all block file information (which may refer to block and undo files).
             {
                 std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
@@ -2436,6 +2941,9 @@ bool CChainState::FlushStateToDisk(
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                for (const CBlockIndex* pindex : vBlocks) {
+                    pindex->UncachePos();
+                }
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -2466,6 +2974,7 @@ bool CChainState::FlushStateToDisk(
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error while flushing: ") + e.what());
     }
+    TRACE2(validation, flush_state_exit, (int)mode, full_flush_completed);
     return true;
 }
 
@@ -2475,6 +2984,10 @@ void CChainState::ForceFlushStateToDisk() {
     if (!this->FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
         LogPrintf("%s: failed to flush state (%s)\n", __func__, FormatStateMessage(state));
     }
+    LOCK(cs_main);
+    if (!m_coins_views->m_writerview.Wait()) {
+        LogPrintf("%s: failed to write coin database\n", __func__);
+    }
 }
 
 void CChainState::PruneAndFlush() {
@@ -2607,7 +3120,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 
 #ifdef ENABLE_OMNICORE
     //! Omni Core: begin block disconnect notification
-    if (omnicore_api::Enabled()) {
+    if (omnicore_api::Enabled() && !omnicore_api::Asynchronous()) {
         LogPrint(BCLog::HANDLER, "Omni Core handler: block disconnect begin [height: %d, reindex: %d]\n", m_chain.Height(), (int)fReindex);
         omnicore_api::HandlerDiscBegin(pindexDelete->nHeight);
     }
@@ -2636,6 +3149,7 @@ static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
+static int64_t nTimeOmni = 0;
 
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
@@ -2699,26 +3213,185 @@ public:
     }
 };
 
+static bool CheckBlockHeader(const CHashedBlockHeader& hashedBlock, CValidationState& state, const CChainParams& chainparams, bool fCheckWork = true);
+static bool CheckBlockContents(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot);
+
+/**
+ * Reads the next block to connect from disk in the background while the current block connects,
+ * and runs the checks of CheckBlock on it that do not need cs_main, including the plotter
+ * signatures of its bind transactions. Nothing of the chain state is touched there, so a failure
+ * of the current block simply leaves the prefetched one unused.
+ */
+class CBlockPrefetcher
+{
+private:
+    std::thread m_thread;
+    uint256 m_hash;
+    //! Written by the prefetch thread, read after joining it
+    std::shared_ptr<CBlock> m_block;
+    bool m_contents_valid{false};
+
+public:
+    ~CBlockPrefetcher() { Reset(); }
+
+    /** Wait for the prefetch thread and drop its block */
+    void Reset()
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+        m_hash.SetNull();
+        m_block.reset();
+        m_contents_valid = false;
+    }
+
+    /** Start reading the block of the index */
+    void Start(const CBlockIndex* pindex, const Consensus::Params& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        Reset();
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            return;
+        m_hash = pindex->GetBlockHash();
+        m_block = std::make_shared<CBlock>();
+        const FlatFilePos pos = pindex->GetBlockPos();
+        // A short lived thread for each block, without the log lines of TraceThread
+        m_thread = std::thread([this, pos, &params] {
+            util::ThreadRename("blkprefetch");
+            if (!ReadBlockFromDisk(*m_block, pos, params) || m_block->GetHash() != m_hash) {
+                m_block.reset();
+                return;
+            }
+            CValidationState state;
+            m_contents_valid = CheckBlockContents(*m_block, state, true);
+            if (m_contents_valid)
+                PreverifyBindPlotterSignatures(m_block->vtx);
+        });
+    }
+
+    /**
+     * The prefetched block of the index, nullptr if another block was prefetched or reading failed.
+     * @param[out] contents_valid  whether the checks of CheckBlock after the header passed
+     */
+    std::shared_ptr<CBlock> Take(const CBlockIndex* pindex, bool& contents_valid)
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+        std::shared_ptr<CBlock> pblock;
+        if (m_hash == pindex->GetBlockHash())
+            pblock = std::move(m_block);
+        contents_valid = pblock && m_contents_valid;
+        Reset();
+        return pblock;
+    }
+};
+
+static CBlockPrefetcher g_block_prefetcher GUARDED_BY(cs_main);
+
+//! Minimum number of coins read by each thread when prefetching the inputs of a block
+static const size_t PREFETCH_MIN_COINS_PER_THREAD = 16;
+
+/**
+ * Reads the inputs of a block about to be connected, which are not in the coins tip, from the coins database on
+ * the shared thread pool, and adds them to the coins tip. The entries of the generator, which the bind, pool and
+ * reward checks of ConnectBlock() read, are read at the same time, so that they are in the database caches.
+ * Coins which fail to read are left to ConnectBlock(), which reads them again.
+ */
+static void PrefetchBlockCoins(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& tip, const CCoinsViewDB& db,
+    const Consensus::Params& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CThreadPool& pool = GetThreadPool();
+    if (pool.GetThreadCount() == 0 || block.vtx.size() <= 1)
+        return;
+
+    // Inputs created by the block itself are not in the database
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx)
+        setBlockTxids.insert(tx->GetHash());
+    std::vector<std::pair<COutPoint, Coin>> vCoins;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !tip.HaveCoinInCache(txin.prevout))
+                vCoins.emplace_back(txin.prevout, Coin());
+        }
+    }
+
+    std::vector<std::function<void()>> vTasks;
+    const int nSlices = std::min(pool.GetThreadCount() + 1, (int) ((vCoins.size() + PREFETCH_MIN_COINS_PER_THREAD - 1) / PREFETCH_MIN_COINS_PER_THREAD));
+    for (int nSlice = 0; nSlice < nSlices; nSlice++) {
+        vTasks.push_back([&vCoins, &db, nSlice, nSlices] {
+            const size_t nBegin = vCoins.size() * nSlice / nSlices, nEnd = vCoins.size() * (nSlice + 1) / nSlices;
+            for (size_t i = nBegin; i < nEnd; i++) {
+                try {
+                    if (!db.GetCoin(vCoins[i].first, vCoins[i].second))
+                        vCoins[i].second.Clear();
+                } catch (const std::exception&) {
+                    vCoins[i].second.Clear();
+                }
+            }
+        });
+    }
+
+    const CAccountID generatorID = pindex->generatorAccountID;
+    if (!generatorID.IsNull()) {
+        const uint64_t nPlotterId = pindex->nPlotterId;
+        const bool fSaturn = pindex->nHeight >= params.nSaturnActiveHeight;
+        const uint256 epochHash = fSaturn ? GetEpochHash(pindex->pprev, params) : uint256();
+        vTasks.push_back([&db, generatorID, nPlotterId, fSaturn, epochHash] {
+            try {
+                if (fSaturn) {
+                    StakingPool stakingPool;
+                    db.GetStakingPool(epochHash, generatorID, stakingPool);
+                } else {
+                    CBindPlotterCoinPair entry;
+                    db.GetLastBindPlotterEntry(nPlotterId, entry);
+                }
+                db.GetAccountBalance(generatorID, nullptr, nullptr, nullptr);
+            } catch (const std::exception&) {
+            }
+        });
+    }
+
+    pool.RunParallel(TaskPriority::CRITICAL, vTasks.size(), [&vTasks](int n) { vTasks[n](); });
+
+    vCoins.erase(std::remove_if(vCoins.begin(), vCoins.end(), [](const std::pair<COutPoint, Coin>& entry) { return entry.second.IsSpent(); }), vCoins.end());
+    tip.AddFetchedCoins(std::move(vCoins));
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
- * corresponding to pindexNew, to bypass loading it again from disk.
+ * corresponding to pindexNew, to bypass loading it again from disk. pindexNext is the block
+ * to connect after this one, if any, which is read while this one connects.
  *
  * The block is added to connectTrace if connection succeeds.
  */
-bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool)
+bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool, const CBlockIndex* pindexNext)
 {
     assert(pindexNew->pprev == m_chain.Tip());
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
-            return AbortNode(state, "Failed to read block");
+        bool fContentsValid;
+        std::shared_ptr<CBlock> pblockNew = g_block_prefetcher.Take(pindexNew, fContentsValid);
+        if (pblockNew) {
+            // Only the header is left to check, which needs cs_main
+            CValidationState stateDummy;
+            if (fContentsValid && CheckBlockHeader(CHashedBlockHeader(*pblockNew), stateDummy, chainparams))
+                pblockNew->fChecked = true;
+        } else {
+            pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+        }
         pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
     }
+    if (pindexNext) {
+        assert(pindexNext->pprev == pindexNew);
+        g_block_prefetcher.Start(pindexNext, chainparams.GetConsensus());
+    }
     const CBlock& blockConnecting = *pthisBlock;
     // Map used by Omni to track removals from the UTXO DB for this block.
     std::shared_ptr<std::map<COutPoint, Coin>> removedCoins;
@@ -2732,6 +3405,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
+        PrefetchBlockCoins(blockConnecting, pindexNew, CoinsTip(), CoinsDB(), chainparams.GetConsensus());
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, removedCoins);
         GetMainSignals().BlockChecked(blockConnecting, state);
@@ -2755,7 +3429,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
 
 #ifdef ENABLE_OMNICORE
     //! Omni Core: begin block connect notification
-    if (omnicore_api::Enabled()) {
+    if (omnicore_api::Enabled() && !omnicore_api::Asynchronous()) {
         LogPrint(BCLog::HANDLER, "Omni Core handler: block connect begin [height: %d]\n", m_chain.Height());
         omnicore_api::HandlerBlockBegin(m_chain.Height(), pindexNew);
     }
@@ -2771,14 +3445,20 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
+    TRACE6(validation, block_connected, pindexNew->phashBlock->begin(), pindexNew->nHeight, blockConnecting.vtx.size(),
+        nTime3 - nTime2, nTime5 - nTime3, nTime6 - nTime1);
 
 #ifdef ENABLE_OMNICORE
-    if (omnicore_api::Enabled()) {
+    if (omnicore_api::Enabled() && omnicore_api::Asynchronous()) {
+        //! Omni Core: the block is applied by the consumer of the validation interface queue
+        omnicore_api::QueueRemovedCoins(pindexNew, removedCoins);
+    } else if (omnicore_api::Enabled()) {
         //! Omni Core: transaction position within the block
         unsigned int nTxIdx = 0;
 
         //! Omni Core: number of meta transactions found
         unsigned int nNumMetaTxs = 0;
+        int64_t nTimeOmniStart = GetTimeMicros();
 
         for (size_t i = 0; i < blockConnecting.vtx.size(); i++) {
             //! Omni Core: new confirmed transaction notification
@@ -2789,6 +3469,9 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
         //! Omni Core: end of block connect notification
         LogPrint(BCLog::HANDLER, "Omni Core handler: block connect end [new height: %d, found: %u txs]\n", pindexNew->nHeight, nNumMetaTxs);
         omnicore_api::HandlerBlockEnd(pindexNew->nHeight, pindexNew, nNumMetaTxs);
+
+        int64_t nTimeOmniEnd = GetTimeMicros(); nTimeOmni += nTimeOmniEnd - nTimeOmniStart;
+        LogPrint(BCLog::BENCH, "  - Omni Core handlers: %.2fms [%.2fs (%.2fms/blk)]\n", (nTimeOmniEnd - nTimeOmniStart) * MILLI, nTimeOmni * MICRO, nTimeOmni * MILLI / nBlocksTotal);
     }
 #endif
 
@@ -2796,6 +3479,30 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     return true;
 }
 
+BlockConnectTimings GetBlockConnectTimings()
+{
+    AssertLockHeld(cs_main);
+    BlockConnectTimings timings;
+    timings.nBlocks = nBlocksTotal;
+    timings.nTimeCheck = nTimeCheck;
+    timings.nTimeForks = nTimeForks;
+    timings.nTimeConnect = nTimeConnect;
+    timings.nTimeReward = nTimeReward;
+    timings.nTimeVerify = nTimeVerify;
+    timings.nTimeIndex = nTimeIndex;
+    timings.nTimeCallbacks = nTimeCallbacks;
+    timings.nTimeReadFromDisk = nTimeReadFromDisk;
+    timings.nTimeConnectTotal = nTimeConnectTotal;
+    timings.nTimeFlush = nTimeFlush;
+    timings.nTimeChainState = nTimeChainState;
+    timings.nTimePostConnect = nTimePostConnect;
+    timings.nTimeOmni = nTimeOmni;
+    timings.nTimeTotal = nTimeTotal;
+    timings.nTimePoC = nTimePoC;
+    timings.nTimePoS = nTimePoS;
+    return timings;
+}
+
 /**
  * Return the tip of the chain with the most work in it, that isn't
  * known to be invalid (it's however far from certain to be valid).
@@ -2917,7 +3624,8 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
 
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            const CBlockIndex* pindexNext = pindexConnect == pindexMostWork ? nullptr : pindexMostWork->GetAncestor(pindexConnect->nHeight + 1);
+            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool, pindexNext)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetReason() != ValidationInvalidReason::BLOCK_MUTATED) {
@@ -3315,18 +4023,19 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
     return ::ChainstateActive().ResetBlockFailureFlags(pindex);
 }
 
-CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
+CBlockIndex* BlockManager::AddToBlockIndex(const CHashedBlockHeader& hashedBlock)
 {
     AssertLockHeld(cs_main);
+    const CBlockHeader& block = hashedBlock.GetHeader();
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    const uint256& hash = hashedBlock.GetHash();
     BlockMap::iterator it = m_block_index.find(hash);
     if (it != m_block_index.end())
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = m_block_index_arena.Create(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3340,14 +4049,14 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
     }
+    pindexNew->BuildEpoch(Params().GetConsensus().nSaturnEpockBlocks);
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew, Params().GetConsensus());
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
         pindexBestHeader = pindexNew;
-    if (!pindexNew->pos.IsNull())
+    if (pindexNew->ppos)
         pindexNew->nStatus |= BLOCK_HAVE_POS;
-    pindexNew->Update(Params().GetConsensus());
 
     setDirtyBlockIndex.insert(pindexNew);
 
@@ -3366,35 +4075,13 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     if (IsWitnessEnabled(pindexNew->pprev, consensusParams)) {
         pindexNew->nStatus |= BLOCK_OPT_WITNESS;
     }
-    pindexNew->minerRewardTxOut = block.vtx[0]->vout[0];
+    pindexNew->SetMinerRewardTxOut(block.vtx[0]->vout[0]);
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
     setDirtyBlockIndex.insert(pindexNew);
 
     if (pindexNew->pprev == nullptr || pindexNew->pprev->HaveTxsDownloaded()) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
-        std::deque<CBlockIndex*> queue;
-        queue.push_back(pindexNew);
-
-        // Recursively process any descendant blocks that now may be eligible to be connected.
-        while (!queue.empty()) {
-            CBlockIndex *pindex = queue.front();
-            queue.pop_front();
-            pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
-            {
-                LOCK(cs_nBlockSequenceId);
-                pindex->nSequenceId = nBlockSequenceId++;
-            }
-            if (m_chain.Tip() == nullptr || !setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) {
-                setBlockIndexCandidates.insert(pindex);
-            }
-            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = m_blockman.m_blocks_unlinked.equal_range(pindex);
-            while (range.first != range.second) {
-                std::multimap<CBlockIndex*, CBlockIndex*>::iterator it = range.first;
-                queue.push_back(it->second);
-                range.first++;
-                m_blockman.m_blocks_unlinked.erase(it);
-            }
-        }
+        LinkBlockTransactions(pindexNew);
     } else {
         if (pindexNew->pprev && pindexNew->pprev->IsValid(BLOCK_VALID_TREE)) {
             m_blockman.m_blocks_unlinked.insert(std::make_pair(pindexNew->pprev, pindexNew));
@@ -3402,6 +4089,33 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
     }
 }
 
+void CChainState::LinkBlockTransactions(CBlockIndex* pindexNew)
+{
+    std::deque<CBlockIndex*> queue;
+    queue.push_back(pindexNew);
+
+    // Recursively process any descendant blocks that now may be eligible to be connected.
+    while (!queue.empty()) {
+        CBlockIndex *pindex = queue.front();
+        queue.pop_front();
+        pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
+        {
+            LOCK(cs_nBlockSequenceId);
+            pindex->nSequenceId = nBlockSequenceId++;
+        }
+        if (m_chain.Tip() == nullptr || !setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) {
+            setBlockIndexCandidates.insert(pindex);
+        }
+        std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = m_blockman.m_blocks_unlinked.equal_range(pindex);
+        while (range.first != range.second) {
+            std::multimap<CBlockIndex*, CBlockIndex*>::iterator it = range.first;
+            queue.push_back(it->second);
+            range.first++;
+            m_blockman.m_blocks_unlinked.erase(it);
+        }
+    }
+}
+
 static bool FindBlockPos(FlatFilePos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false)
 {
     LOCK(cs_LastBlockFile);
@@ -3426,7 +4140,9 @@ static bool FindBlockPos(FlatFilePos &pos, unsigned int nAddSize, unsigned int n
         if (!fKnown) {
             LogPrintf("Leaving block file %i: %s\n", nLastBlockFile, vinfoBlockFile[nLastBlockFile].ToString());
         }
-        FlushBlockFile(!fKnown);
+        if (!fKnown) {
+            FinalizeBlockFile();
+        }
         nLastBlockFile = nFile;
     }
 
@@ -3473,14 +4189,130 @@ static bool FindUndoPos(CValidationState &state, int nFile, FlatFilePos &pos, un
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, bool fCheckWork = true)
+namespace {
+
+/**
+ * Valid block signature cache, filled by BatchVerifyHeaderSignatures() and CheckBlockHeader() so that
+ * a header seen again (submitheader, compact blocks, the block itself) isn't verified again. It is
+ * separate from the script signature cache, headers don't evict script signatures.
+ */
+class CHeaderSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || block hash). The block hash commits to the public key and the signature
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CHeaderSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(DEFAULT_MAX_HEADER_SIG_CACHE_SIZE << 20);
+    }
+
+    size_t Setup(size_t nBytes)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.setup_bytes(nBytes);
+    }
+
+    void
+    ComputeEntry(uint256& entry, const uint256& hash)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool
+    Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+};
+
+CHeaderSignatureCache headerSignatureCache;
+
+/**
+ * Closure representing the signature check of one block header, see BatchVerifyHeaderSignatures().
+ * It only fills the header signature cache, the header check reports the result.
+ */
+class CHeaderSignatureCheck
+{
+private:
+    const CHashedBlockHeader* pblock;
+
+public:
+    CHeaderSignatureCheck() : pblock(nullptr) {}
+    explicit CHeaderSignatureCheck(const CHashedBlockHeader* pblockIn) : pblock(pblockIn) {}
+
+    bool operator()() {
+        const CBlockHeader& block = pblock->GetHeader();
+        if (CPubKey(block.vchPubKey.begin(), block.vchPubKey.end()).Verify(pblock->GetUnsignaturedHash(), block.vchSignature.ToVector())) {
+            uint256 entry;
+            headerSignatureCache.ComputeEntry(entry, pblock->GetHash());
+            headerSignatureCache.Set(entry);
+        }
+        return true;
+    }
+
+    void swap(CHeaderSignatureCheck& check) {
+        std::swap(pblock, check.pblock);
+    }
+};
+
+CCheckQueue<CHeaderSignatureCheck> headersigcheckqueue(128);
+
+/**
+ * Queue the signature checks of a run of headers on the header signature check threads. The caller
+ * waits on the control, the results are kept for CheckBlockHeader()
+ */
+void BatchVerifyHeaderSignatures(CCheckQueueControl<CHeaderSignatureCheck>& control,
+    std::vector<CHashedBlockHeader>::const_iterator itBegin, std::vector<CHashedBlockHeader>::const_iterator itEnd)
+{
+    std::vector<CHeaderSignatureCheck> vChecks;
+    vChecks.reserve(itEnd - itBegin);
+    for (auto it = itBegin; it != itEnd; it++) {
+        const CBlockHeader& block = it->GetHeader();
+        if (block.vchPubKey.size() != CPubKey::COMPRESSED_PUBLIC_KEY_SIZE || block.vchSignature.empty() || block.vchSignature.size() > CPubKey::SIGNATURE_SIZE)
+            continue;
+        // The unsignatured hash is computed here, the wrappers aren't thread safe
+        it->GetUnsignaturedHash();
+        vChecks.emplace_back(&*it);
+    }
+    control.Add(vChecks);
+}
+
+} // namespace
+
+void InitHeaderSignatureCache() {
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxheadersigcachesize", DEFAULT_MAX_HEADER_SIG_CACHE_SIZE)), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = headerSignatureCache.Setup(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for header signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+void ThreadHeaderSignatureCheck(int worker_num) {
+    util::ThreadRename(strprintf("headsigch.%i", worker_num));
+    headersigcheckqueue.Thread();
+}
+
+static bool CheckBlockHeader(const CHashedBlockHeader& hashedBlock, CValidationState& state, const CChainParams& chainparams, bool fCheckWork)
 {
     AssertLockHeld(cs_main);
 
     if (!fCheckWork)
         return true;
 
-    const uint256 hashBlock = block.GetHash();
+    const CBlockHeader& block = hashedBlock.GetHeader();
+    const uint256& hashBlock = hashedBlock.GetHash();
 
     // Genesis
     if (block.hashPrevBlock.IsNull()) {
@@ -3508,7 +4340,9 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     if (!block.pos.IsNull()) {
         if (pindexPrev->nHeight >= chainparams.GetConsensus().nMercuryActiveHeight &&
             pindexPrev->nHeight <= chainparams.GetConsensus().nSaturnActiveHeight) {
+            int64_t nTimeStart = GetTimeMicros();
             pos::VerifyResult result = pos::VerifyBlockHeader(*pindexPrev, block, chainparams.GetConsensus());
+            nTimePoS += GetTimeMicros() - nTimeStart;
             if (result != pos::VerifyResult::Success) {
                 return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-blk-chiapos", pos::ToString(result));
             }
@@ -3522,9 +4356,14 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
         if (block.vchPubKey.size() != CPubKey::COMPRESSED_PUBLIC_KEY_SIZE || block.vchSignature.size() > CPubKey::SIGNATURE_SIZE)
             return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-blk-sign", "require block signature");
 
-        CPubKey pubkey(block.vchPubKey);
-        if (!pubkey.Verify(block.GetUnsignaturedHash(), block.vchSignature))
-            return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-blk-sign", "incorrect block signature");
+        uint256 entry;
+        headerSignatureCache.ComputeEntry(entry, hashBlock);
+        if (!headerSignatureCache.Get(entry)) {
+            CPubKey pubkey(block.vchPubKey.begin(), block.vchPubKey.end());
+            if (!pubkey.Verify(hashedBlock.GetUnsignaturedHash(), block.vchSignature.ToVector()))
+                return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-blk-sign", "incorrect block signature");
+            headerSignatureCache.Set(entry);
+        }
     } else {
         if (!block.vchPubKey.empty() || !block.vchSignature.empty())
             return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-blk-sign", "not allow block signature");
@@ -3554,24 +4393,20 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     LogPrint(BCLog::POC, "%s: hash=%s height=%d version=0x%08x date='%s'\n", __func__,
         hashBlock.ToString(), pindexPrev->nHeight + 1, block.nVersion,
         FormatISO8601DateTime(block.GetBlockTime()));
-    if (!poc::CheckProofOfCapacity(*pindexPrev, block, chainparams.GetConsensus()))
+    int64_t nTimeStart = GetTimeMicros();
+    bool fValidWork = poc::CheckProofOfCapacity(*pindexPrev, hashedBlock, chainparams.GetConsensus());
+    int64_t nTimeCheck = GetTimeMicros() - nTimeStart;
+    nTimePoC += nTimeCheck;
+    metrics::g_deadline_check_latency.Observe(nTimeCheck);
+    if (!fValidWork)
         return state.Invalid(ValidationInvalidReason::BLOCK_INVALID_HEADER, false, REJECT_INVALID, "bad-work", "check work failed");
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, const CChainParams& chainparams, bool fCheckWork, bool fCheckMerkleRoot)
+/** The checks of CheckBlock after the header, which do not need cs_main */
+static bool CheckBlockContents(const CBlock& block, CValidationState& state, bool fCheckMerkleRoot)
 {
-    // These are checks that are independent of context.
-
-    if (block.fChecked)
-        return true;
-
-    // Check that the header is valid (particularly PoW).  This is mostly
-    // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, chainparams, fCheckWork))
-        return false;
-
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -3619,10 +4454,28 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const CChainParams
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-blk-sigops", "out-of-bounds SigOpCount");
 
     // Verify block signature
-    if (!block.vchPubKey.empty() && GetScriptForPubKey(CPubKey(block.vchPubKey)) != block.vtx[0]->vout[0].scriptPubKey) {
+    if (!block.vchPubKey.empty() && GetScriptForPubKey(CPubKey(block.vchPubKey.begin(), block.vchPubKey.end())) != block.vtx[0]->vout[0].scriptPubKey) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-blk-sign", "incorrect signatory");
     }
 
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, CValidationState& state, const CChainParams& chainparams, bool fCheckWork, bool fCheckMerkleRoot)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    // Check that the header is valid (particularly PoW).  This is mostly
+    // redundant with the call in AcceptBlockHeader.
+    if (!CheckBlockHeader(CHashedBlockHeader(block), state, chainparams, fCheckWork))
+        return false;
+
+    if (!CheckBlockContents(block, state, fCheckMerkleRoot))
+        return false;
+
     if (fCheckWork && fCheckMerkleRoot)
         block.fChecked = true;
 
@@ -3845,11 +4698,12 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckWork)
+bool BlockManager::AcceptBlockHeader(const CHashedBlockHeader& hashedBlock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckWork)
 {
     AssertLockHeld(cs_main);
+    const CBlockHeader& block = hashedBlock.GetHeader();
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    const uint256& hash = hashedBlock.GetHash();
     BlockMap::iterator miSelf = m_block_index.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -3863,7 +4717,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams, fCheckWork))
+        if (!CheckBlockHeader(hashedBlock, state, chainparams, fCheckWork))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3916,7 +4770,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(hashedBlock);
 
     if (ppindex)
         *ppindex = pindex;
@@ -3926,16 +4780,28 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
 
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+{
+    return ProcessNewBlockHeaders(HashBlockHeaders(headers), state, chainparams, ppindex, first_invalid);
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CHashedBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
 
+    // Count of leading headers connected to the previous one
+    std::size_t nConnected = 1;
+    while (nConnected < headers.size() && headers[nConnected].GetHeader().hashPrevBlock == headers[nConnected - 1].GetHash())
+        nConnected++;
+
     // DoS check
+    int nPrevHeight = -1;
     {
         LOCK(cs_main);
-        const CBlockIndex* pindexPrev = LookupBlockIndex(headers[0].hashPrevBlock);
+        const CBlockIndex* pindexPrev = LookupBlockIndex(headers[0].GetHeader().hashPrevBlock);
         if (pindexPrev != nullptr) {
+            nPrevHeight = pindexPrev->nHeight;
             const CBlockIndex* pindexLast = pindexPrev;
-            for (const CBlockHeader& header : headers) {
+            for (const CHashedBlockHeader& header : headers) {
                 const CBlockIndex* pindex = LookupBlockIndex(header.GetHash());
                 if (pindex == nullptr)
                     break;
@@ -3948,7 +4814,7 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
                         //! Long fork
                         arith_uint256 nChainWork = pindexLast->nChainWork;
                         for (std::size_t index = (std::size_t) (pindexLast->nHeight - pindexPrev->nHeight); index < headers.size(); index++) {
-                            nChainWork += GetBlockProof(headers[index], chainparams.GetConsensus());
+                            nChainWork += GetBlockProof(headers[index].GetHeader(), chainparams.GetConsensus());
                         }
                         //! Long fork chain work less then 24 blocks, we reject
                         if (nChainWork < ::ChainActive().Tip()->nChainWork + GetBlockProof(*(::ChainActive().Tip()), chainparams.GetConsensus()) * 24)
@@ -3957,7 +4823,7 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
                         //! Short fork
                         arith_uint256 nChainWork = pindexLast->nChainWork;
                         for (std::size_t index = (std::size_t) (pindexLast->nHeight - pindexPrev->nHeight); index < headers.size(); index++) {
-                            nChainWork += GetBlockProof(headers[index], chainparams.GetConsensus());
+                            nChainWork += GetBlockProof(headers[index].GetHeader(), chainparams.GetConsensus());
                             if (nChainWork > ::ChainActive().Tip()->nChainWork)
                                 break;
                         }
@@ -3972,22 +4838,47 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
         }
     }
 
-    // Skip hit checkpoint before blocks for verify deadline performance
+    // Skip hit checkpoint or assumed valid block before blocks for verify deadline performance. Checkpoints are
+    // looked up by the heights of the connected headers
     int nLastKnownBlockIndex = -1;
-    if (!fCheckWork && headers.size() >= MAX_BLOCKS_TO_ANNOUNCE && !chainparams.Checkpoints().mapCheckpoints.empty()) {
+    if (!fCheckWork && headers.size() >= MAX_BLOCKS_TO_ANNOUNCE && nPrevHeight >= 0) {
         const MapCheckpoints &mapCheckpoints = chainparams.Checkpoints().mapCheckpoints;
-        bool fFoundCheckpoint = false;
-        for (nLastKnownBlockIndex = headers.size() - 1; nLastKnownBlockIndex >= 0 && !fFoundCheckpoint; nLastKnownBlockIndex--) {
-            uint256 hash = headers[nLastKnownBlockIndex].GetHash();
-            for (auto it = mapCheckpoints.rbegin(); it != mapCheckpoints.rend(); it++) {
-                if (it->second == hash) {
-                    fFoundCheckpoint = true;
+        auto it = mapCheckpoints.upper_bound(nPrevHeight + (int) nConnected);
+        while (it != mapCheckpoints.begin() && (--it)->first > nPrevHeight) {
+            if (headers[it->first - nPrevHeight - 1].GetHash() == it->second) {
+                nLastKnownBlockIndex = it->first - nPrevHeight - 1;
+                break;
+            }
+        }
+        if (!hashAssumeValid.IsNull()) {
+            for (int index = (int) nConnected - 1; index > nLastKnownBlockIndex; index--) {
+                if (headers[index].GetHash() == hashAssumeValid) {
+                    nLastKnownBlockIndex = index;
                     break;
                 }
             }
         }
-        if (fFoundCheckpoint) nLastKnownBlockIndex++;
-        LogPrint(BCLog::POC, "%s: %s-%s, Verify work [%d,%d)\n", __func__, headers.begin()->GetHash().ToString(), headers.rbegin()->GetHash().ToString(), nLastKnownBlockIndex + 1, (int) headers.size());
+        LogPrint(BCLog::POC, "%s: %s-%s, Verify work [%d,%d)\n", __func__, headers.front().GetHash().ToString(), headers.back().GetHash().ToString(), nLastKnownBlockIndex + 1, (int) headers.size());
+    }
+
+    // Verify block signatures, PoC deadlines and PoS signatures of the headers in batches, the checks in AcceptBlockHeader
+    // reuse the results. Block signatures are verified on their check threads meanwhile
+    if (headers.size() > (std::size_t) (nLastKnownBlockIndex + 2)) {
+        const CBlockIndex* pindexPrev = nullptr;
+        {
+            LOCK(cs_main);
+            pindexPrev = LookupBlockIndex(headers[nLastKnownBlockIndex + 1].GetHeader().hashPrevBlock);
+        }
+        if (pindexPrev != nullptr) {
+            CCheckQueueControl<CHeaderSignatureCheck> control(&headersigcheckqueue);
+            BatchVerifyHeaderSignatures(control, headers.begin() + (nLastKnownBlockIndex + 1), headers.end());
+            int64_t nTime1 = GetTimeMicros();
+            poc::BatchCheckProofOfCapacity(*pindexPrev, headers.begin() + (nLastKnownBlockIndex + 1), headers.end(), chainparams.GetConsensus());
+            int64_t nTime2 = GetTimeMicros(); nTimePoC += nTime2 - nTime1;
+            pos::BatchVerifyBlockHeaders(*pindexPrev, headers.begin() + (nLastKnownBlockIndex + 1), headers.end(), chainparams.GetConsensus());
+            nTimePoS += GetTimeMicros() - nTime2;
+            control.Wait();
+        }
     }
 
     // Connect block
@@ -4005,13 +4896,13 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
             { // Hold cs_main
                 LOCK(cs_main);
                 for (int processed = 0; index < headers.size(); index++, processed++) {
-                    const CBlockHeader& header = headers[index];
+                    const CHashedBlockHeader& header = headers[index];
                     CBlockIndex *pindex = nullptr;
                     bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex, (index >= beginCheckWorkIndex));
                     ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
 
                     if (!accepted) {
-                        if (first_invalid) *first_invalid = header;
+                        if (first_invalid) *first_invalid = header.GetHeader();
                         return false;
                     }
                     if (ppindex) {
@@ -4034,7 +4925,9 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChainParams& chainparams, const FlatFilePos* dbp) {
-    unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
+    // Known blocks are accounted with their raw size, which may overestimate a compressed one on disk.
+    std::vector<unsigned char> record;
+    const unsigned int nBlockSize = (dbp == nullptr && CompressForDisk(block, record)) ? record.size() : ::GetSerializeSize(block, CLIENT_VERSION);
     FlatFilePos blockPos;
     if (dbp != nullptr)
         blockPos = *dbp;
@@ -4043,7 +4936,7 @@ static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChai
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!WriteBlockToDisk(block, record, blockPos, chainparams.MessageStart())) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
@@ -4062,7 +4955,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    bool accepted_header = m_blockman.AcceptBlockHeader(block, state, chainparams, &pindex);
+    bool accepted_header = m_blockman.AcceptBlockHeader(CHashedBlockHeader(block), state, chainparams, &pindex);
     CheckBlockIndex(chainparams.GetConsensus());
 
     if (!accepted_header)
@@ -4111,8 +5004,9 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     }
 
     // Header is valid/has work, merkle tree and segwit merkle tree are good...RELAY NOW
-    // (but if it does not build on our best tip, let the SendMessages loop relay it)
-    if (!IsInitialBlockDownload() && m_chain.Tip() == pindex->pprev)
+    // (but if it does not build on our best tip or replace it with a better deadline, let the SendMessages loop relay it)
+    if (!IsInitialBlockDownload() && (m_chain.Tip() == pindex->pprev ||
+            (m_chain.Tip()->pprev == pindex->pprev && pindex->nChainWork > m_chain.Tip()->nChainWork)))
         GetMainSignals().NewPoWValidBlock(pindex, pblock);
 
     // Write block to history file
@@ -4180,7 +5074,7 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     indexDummy.pprev = pindexPrev;
     indexDummy.nHeight = pindexPrev->nHeight + 1;
     indexDummy.phashBlock = &block_hash;
-    indexDummy.minerRewardTxOut = block.vtx[0]->vout[0];
+    indexDummy.SetMinerRewardTxOut(block.vtx[0]->vout[0]);
 
     // NOTE: CheckBlockHeader is called by CheckBlock
     if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, GetAdjustedTime()))
@@ -4398,7 +5292,7 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
+    CBlockIndex* pindexNew = m_block_index_arena.Create();
     mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -4453,11 +5347,9 @@ bool BlockManager::LoadBlockIndex(
             pindexBestInvalid = pindex;
         if (pindex->pprev)
             pindex->BuildSkip();
+        pindex->BuildEpoch(consensus_params.nSaturnEpockBlocks);
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
-
-        // Update by height ascent
-        pindex->Update(consensus_params);
     }
 
     return true;
@@ -4467,11 +5359,8 @@ void BlockManager::Unload() {
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
 
-    for (const BlockMap::value_type& entry : m_block_index) {
-        delete entry.second;
-    }
-
     m_block_index.clear();
+    m_block_index_arena.Clear();
 }
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -4556,6 +5445,192 @@ bool CChainState::LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+//! Number of coins of a UTXO set snapshot written to the coin database at once
+static const size_t SNAPSHOT_COINS_BATCH = 100000;
+
+/**
+ * Read a UTXO set snapshot, writing its coins and staking pools to coinsdb, and return the transaction count and
+ * miner reward output of each of its blocks. fWritten tells whether coinsdb was written to, even on failure.
+ */
+static bool ReadSnapshot(CAutoFile& file, CCoinsViewDB& coinsdb, const CChain& chain, const uint256& expected_hash, const Consensus::Params& consensusParams,
+    SnapshotMetadata& metadata, std::vector<std::pair<unsigned int, CTxOut>>& vBlocks, bool& fWritten, std::string& error) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CHashVerifier<CAutoFile> verifier(&file);
+    verifier >> metadata;
+    if (metadata.m_version != UTXO_SNAPSHOT_VERSION) {
+        error = strprintf("Unknown snapshot version %d", metadata.m_version);
+        return false;
+    }
+    const CBlockIndex* pindexBase = LookupBlockIndex(metadata.m_base_blockhash);
+    if (pindexBase == nullptr) {
+        error = strprintf("The base block %s of the snapshot is not in the block index, the headers must be synced first", metadata.m_base_blockhash.ToString());
+        return false;
+    }
+    if (pindexBase->nHeight == 0 || !pindexBase->IsValid(BLOCK_VALID_TREE)) {
+        error = strprintf("The base block %s of the snapshot is not valid", metadata.m_base_blockhash.ToString());
+        return false;
+    }
+
+    // Blocks, which must agree with the ones already downloaded
+    vBlocks.reserve(pindexBase->nHeight);
+    unsigned int nChainTx = chain.Genesis()->nChainTx;
+    for (int nHeight = 1; nHeight <= pindexBase->nHeight; nHeight++) {
+        const CBlockIndex* pindex = pindexBase->GetAncestor(nHeight);
+        unsigned int nTx;
+        CTxOut minerRewardTxOut;
+        verifier >> VARINT(nTx) >> minerRewardTxOut;
+        if (nTx == 0 || (pindex->nStatus & BLOCK_FAILED_MASK) ||
+                (pindex->nTx != 0 && (pindex->nTx != nTx || !(pindex->minerRewardTxOut == minerRewardTxOut)))) {
+            error = strprintf("The snapshot does not match block %s at height %d", pindex->GetBlockHash().ToString(), nHeight);
+            return false;
+        }
+        nChainTx += nTx;
+        vBlocks.emplace_back(nTx, minerRewardTxOut);
+    }
+    if (nChainTx != metadata.m_nchaintx) {
+        error = strprintf("The snapshot has %u transactions in its blocks, but %u in its metadata", nChainTx, metadata.m_nchaintx);
+        return false;
+    }
+
+    // Everything else goes to the coin database, marked as in transition to the base block
+    CCoinsMap mapEmpty;
+    fWritten = true;
+    if (!coinsdb.WriteSnapshotCoins(mapEmpty, metadata.m_base_blockhash, false)) {
+        error = "Failed to write to coin database";
+        return false;
+    }
+
+    // Staking pools
+    uint64_t nEpochs = ReadCompactSize(verifier);
+    for (uint64_t i = 0; i < nEpochs; i++) {
+        uint256 epochHash;
+        CStakingPoolList pools;
+        verifier >> epochHash >> pools;
+        std::vector<CStakingPoolUserList> users(pools.size());
+        for (CStakingPoolUserList& poolUsers : users) {
+            verifier >> poolUsers;
+        }
+        const CBlockIndex* pindexEpoch = LookupBlockIndex(epochHash);
+        if (pindexEpoch == nullptr || pindexBase->GetAncestor(pindexEpoch->nHeight) != pindexEpoch || pindexEpoch->nHeight % consensusParams.nSaturnEpockBlocks != 0) {
+            error = strprintf("The snapshot has staking pools of %s, which does not begin an epoch of the base chain", epochHash.ToString());
+            return false;
+        }
+        if (!coinsdb.WriteStakingPools(epochHash, pools, users)) {
+            error = "Failed to write to coin database";
+            return false;
+        }
+    }
+
+    // Coins, in the order of the coin database, which rules out duplicates
+    CCoinsMapMemoryResource resource;
+    CCoinsMap coins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+    COutPoint outpointPrev;
+    for (uint64_t i = 0; i < metadata.m_coins_count; i++) {
+        COutPoint outpoint;
+        Coin coin;
+        verifier >> outpoint >> coin;
+        if (coin.IsSpent() || coin.nHeight > (uint32_t) pindexBase->nHeight || (i > 0 && !(outpointPrev < outpoint))) {
+            error = strprintf("The snapshot has an invalid coin %s", outpoint.ToString());
+            return false;
+        }
+        outpointPrev = outpoint;
+        CCoinsCacheEntry& entry = coins[outpoint];
+        entry.coin = std::move(coin);
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        if (coins.size() >= SNAPSHOT_COINS_BATCH || i + 1 == metadata.m_coins_count) {
+            if (!coinsdb.WriteSnapshotCoins(coins, metadata.m_base_blockhash, false)) {
+                error = "Failed to write to coin database";
+                return false;
+            }
+            LogPrintf("Loaded %u of %u coins from snapshot\n", i + 1, metadata.m_coins_count);
+        }
+    }
+
+    const uint256 hash = verifier.GetHash();
+    uint256 committed_hash;
+    file >> committed_hash;
+    if (hash != committed_hash) {
+        error = "The snapshot is corrupted, its contents do not match its hash";
+        return false;
+    }
+    if (!expected_hash.IsNull() && hash != expected_hash) {
+        error = strprintf("The snapshot hash %s is not the expected %s", hash.ToString(), expected_hash.ToString());
+        return false;
+    }
+    return true;
+}
+
+bool CChainState::LoadSnapshot(const fs::path& path, const uint256& expected_hash, const CChainParams& chainparams, SnapshotMetadata& metadata, std::string& error)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Cannot open snapshot file %s", path.string());
+        return false;
+    }
+
+    LOCK(cs_main);
+    CValidationState state;
+    if (!FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
+        error = strprintf("Failed to flush the chain state: %s", FormatStateMessage(state));
+        return false;
+    }
+    CCoinsViewDB& coinsdb = CoinsDB();
+    if (m_chain.Height() != 0 || !coinsdb.IsEmpty()) {
+        error = "A snapshot can only be loaded while the chain is at the genesis block";
+        return false;
+    }
+
+    const uint256 hashOld = coinsdb.GetBestBlock();
+    std::vector<std::pair<unsigned int, CTxOut>> vBlocks;
+    bool fWritten = false;
+    bool fLoaded = false;
+    try {
+        fLoaded = ReadSnapshot(file, coinsdb, m_chain, expected_hash, consensusParams, metadata, vBlocks, fWritten, error);
+    } catch (const std::exception& e) {
+        error = strprintf("Cannot read snapshot: %s", e.what());
+    }
+    if (!fLoaded) {
+        if (fWritten && !coinsdb.EraseSnapshot(hashOld))
+            return AbortNode("Failed to erase the snapshot from coin database");
+        return false;
+    }
+
+    // The blocks up to the base have their transactions, pruned
+    CBlockIndex* pindexBase = LookupBlockIndex(metadata.m_base_blockhash);
+    for (int nHeight = 1; nHeight <= pindexBase->nHeight; nHeight++) {
+        CBlockIndex* pindex = pindexBase->GetAncestor(nHeight);
+        if (pindex->nTx == 0) {
+            pindex->nTx = vBlocks[nHeight - 1].first;
+            pindex->SetMinerRewardTxOut(vBlocks[nHeight - 1].second);
+        }
+        if (IsWitnessEnabled(pindex->pprev, consensusParams)) {
+            pindex->nStatus |= BLOCK_OPT_WITNESS;
+        }
+        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        setDirtyBlockIndex.insert(pindex);
+        if (!pindex->HaveTxsDownloaded()) {
+            LinkBlockTransactions(pindex);
+        }
+    }
+    if (!fHavePruned) {
+        pblocktree->WriteFlag("prunedblockfiles", true);
+        fHavePruned = true;
+    }
+
+    // The coin database becomes consistent with the base block once flushed, after the block index
+    CoinsTip().SetBestBlock(metadata.m_base_blockhash);
+    LoadChainTip(chainparams);
+    mempool.clear();
+    CheckBlockIndex(consensusParams);
+    if (!FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS)) {
+        error = strprintf("Failed to flush the chain state: %s", FormatStateMessage(state));
+        return false;
+    }
+    LogPrintf("Loaded snapshot of %u coins at block %s\n", metadata.m_coins_count, metadata.m_base_blockhash.ToString());
+    return true;
+}
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks...").translated, 0, false);
@@ -4925,6 +6000,7 @@ void CChainState::UnloadBlockIndex() {
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    g_block_prefetcher.Reset();
     ::ChainActive().SetTip(nullptr);
     g_blockman.Unload();
     pindexBestInvalid = nullptr;
@@ -4939,6 +6015,7 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
     fHavePruned = false;
+    g_recent_block_undos.clear();
 
     ::ChainstateActive().UnloadBlockIndex();
 }
@@ -4981,7 +6058,7 @@ bool CChainState::LoadGenesisBlock(const CChainParams& chainparams)
         FlatFilePos blockPos = SaveBlockToDisk(block, 0, chainparams, nullptr);
         if (blockPos.IsNull())
             return error("%s: writing genesis block to disk failed", __func__);
-        CBlockIndex *pindex = m_blockman.AddToBlockIndex(block);
+        CBlockIndex *pindex = m_blockman.AddToBlockIndex(CHashedBlockHeader(block));
         ReceivedBlockTransactions(block, pindex, blockPos, chainparams.GetConsensus());
     } catch (const std::runtime_error& e) {
         return error("%s: failed to write genesis block: %s", __func__, e.what());
@@ -4995,6 +6072,241 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
+//! Max threads deserializing the blocks read ahead from a block file
+static const int MAX_BLOCK_PREFETCH_THREADS = 4;
+//! Max bytes of blocks read ahead from a block file
+static const size_t MAX_BLOCK_PREFETCH_BYTES = 64 << 20;
+//! Bytes of a block file the OS is asked to read ahead at once
+static const int64_t BLOCK_FILE_READAHEAD_BYTES = 16 << 20;
+
+namespace {
+/** A block located in a block file, deserialized and hashed ahead of its submission */
+struct PrefetchedBlock
+{
+    //! Position of the message start ahead of the block, and of the block itself
+    uint64_t nHeaderPos;
+    uint64_t nBlockPos;
+    //! Size written ahead of the block, and the size its deserialization consumed
+    unsigned int nSize;
+    unsigned int nConsumed;
+    //! Whether the block is stored compressed
+    bool fCompressed;
+    std::vector<char> data;
+    std::shared_ptr<CBlock> block;
+    uint256 hash;
+    //! Why the block failed to deserialize, when block is null
+    std::string error;
+    bool fReady;
+
+    PrefetchedBlock(uint64_t nHeaderPosIn, unsigned int nSizeIn, bool fCompressedIn) :
+        nHeaderPos(nHeaderPosIn), nBlockPos(nHeaderPosIn + CMessageHeader::MESSAGE_START_SIZE + sizeof(nSizeIn)), nSize(nSizeIn), nConsumed(0),
+        fCompressed(fCompressedIn), fReady(false) {}
+};
+typedef std::shared_ptr<PrefetchedBlock> PrefetchedBlockRef;
+
+/**
+ * Reads the blocks of a block file ahead of their submission. A reader thread locates the blocks, the way
+ * LoadExternalBlockFile() does, and copies them out of the file. Worker threads deserialize and hash them, and Next()
+ * hands them out in file order.
+ */
+class BlockFilePrefetcher
+{
+public:
+    BlockFilePrefetcher(FILE* fileIn, const CMessageHeader::MessageStartChars& messageStartIn) : file(fileIn) {
+        memcpy(messageStart, messageStartIn, sizeof(messageStart));
+        GetCompressedMessageStart(messageStart, compressedStart);
+        const int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_BLOCK_PREFETCH_THREADS));
+        for (int i = 0; i < nThreads; i++) {
+            workerThreads.emplace_back([this, i]() {
+                util::ThreadRename(strprintf("loadblk.%i", i));
+                WorkerThread();
+            });
+        }
+        StartReader(0);
+    }
+
+    ~BlockFilePrefetcher() {
+        StopReader();
+        {
+            LOCK(cs);
+            fShutdown = true;
+        }
+        cond.notify_all();
+        for (std::thread& thread : workerThreads) {
+            thread.join();
+        }
+        fclose(file);
+    }
+
+    //! The next block located in the file, or nullptr at its end
+    PrefetchedBlockRef Next() {
+        WAIT_LOCK(cs, lock);
+        cond.wait(lock, [this]() { return entries.empty() ? fReaderDone : entries.front()->fReady; });
+        if (entries.empty()) {
+            return nullptr;
+        }
+        PrefetchedBlockRef entry = entries.front();
+        entries.pop_front();
+        nBytesAhead -= entry->nSize;
+        cond.notify_all();
+        return entry;
+    }
+
+    //! Drop the blocks read ahead, and continue locating blocks at nPos
+    void Restart(uint64_t nPos) {
+        StopReader();
+        StartReader(nPos);
+    }
+
+private:
+    void StartReader(uint64_t nPos) {
+        {
+            LOCK(cs);
+            entries.clear();
+            pending.clear();
+            nBytesAhead = 0;
+            fReaderDone = false;
+            fStopReader = false;
+        }
+        readerThread = std::thread([this, nPos]() {
+            util::ThreadRename("loadblkread");
+            ReaderThread(nPos);
+        });
+    }
+
+    void StopReader() {
+        {
+            LOCK(cs);
+            fStopReader = true;
+        }
+        cond.notify_all();
+        readerThread.join();
+    }
+
+    void ReaderThread(uint64_t nPos) {
+        bool fSeek = true;
+        int64_t nReadAheadPos = nPos;
+        while (true) {
+            {
+                WAIT_LOCK(cs, lock);
+                cond.wait(lock, [this]() { return fStopReader || nBytesAhead < MAX_BLOCK_PREFETCH_BYTES; });
+                if (fStopReader) {
+                    return;
+                }
+            }
+            if (fSeek && fseek(file, nPos, SEEK_SET) != 0) {
+                break;
+            }
+            fSeek = false;
+            if ((int64_t) nPos + BLOCK_FILE_READAHEAD_BYTES / 2 > nReadAheadPos) {
+                ReadAheadFileRange(file, nReadAheadPos, BLOCK_FILE_READAHEAD_BYTES);
+                nReadAheadPos += BLOCK_FILE_READAHEAD_BYTES;
+            }
+
+            // locate a header
+            int c;
+            while ((c = getc(file)) != EOF && c != messageStart[0] && c != compressedStart[0]) {
+                nPos++;
+            }
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int)];
+            buf[0] = c;
+            if (c == EOF || fread(buf + 1, 1, sizeof(buf) - 1, file) != sizeof(buf) - 1) {
+                // no valid block header found; don't complain
+                break;
+            }
+            const unsigned int nSize = ReadLE32(buf + CMessageHeader::MESSAGE_START_SIZE);
+            const bool fCompressed = memcmp(buf, compressedStart, CMessageHeader::MESSAGE_START_SIZE) == 0;
+            if ((!fCompressed && memcmp(buf, messageStart, CMessageHeader::MESSAGE_START_SIZE)) ||
+                    nSize < (fCompressed ? sizeof(uint32_t) : 80) || nSize > MAX_BLOCK_SERIALIZED_SIZE) {
+                // start one byte further next time
+                nPos++;
+                fSeek = true;
+                continue;
+            }
+
+            // read block
+            PrefetchedBlockRef entry = std::make_shared<PrefetchedBlock>(nPos, nSize, fCompressed);
+            entry->data.resize(nSize);
+            if (fread(entry->data.data(), 1, nSize, file) != nSize) {
+                break;
+            }
+            nPos = entry->nBlockPos + nSize;
+            {
+                LOCK(cs);
+                if (fStopReader) {
+                    return;
+                }
+                entries.push_back(entry);
+                pending.push_back(entry);
+                nBytesAhead += nSize;
+            }
+            cond.notify_all();
+        }
+
+        {
+            LOCK(cs);
+            fReaderDone = true;
+        }
+        cond.notify_all();
+    }
+
+    void WorkerThread() {
+        while (true) {
+            PrefetchedBlockRef entry;
+            {
+                WAIT_LOCK(cs, lock);
+                cond.wait(lock, [this]() { return fShutdown || !pending.empty(); });
+                if (fShutdown) {
+                    return;
+                }
+                entry = pending.front();
+                pending.pop_front();
+            }
+
+            try {
+                CDataStream ss(SER_DISK, CLIENT_VERSION);
+                if (!entry->fCompressed) {
+                    ss.write(entry->data.data(), entry->data.size());
+                } else if (!DecompressFromDisk((const unsigned char*)entry->data.data(), entry->data.size(), ss)) {
+                    throw std::runtime_error("failed to decompress block");
+                }
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                ss >> *pblock;
+                // A compressed block is consumed as a whole
+                entry->nConsumed = entry->fCompressed ? entry->nSize : entry->nSize - ss.size();
+                entry->hash = pblock->GetHash();
+                entry->block = std::move(pblock);
+            } catch (const std::exception& e) {
+                entry->error = e.what();
+            }
+            std::vector<char>().swap(entry->data);
+
+            {
+                LOCK(cs);
+                entry->fReady = true;
+            }
+            cond.notify_all();
+        }
+    }
+
+    FILE* file;
+    CMessageHeader::MessageStartChars messageStart;
+    CMessageHeader::MessageStartChars compressedStart;
+    Mutex cs;
+    std::condition_variable cond;
+    //! Blocks located ahead, in file order
+    std::deque<PrefetchedBlockRef> entries GUARDED_BY(cs);
+    //! Blocks located ahead waiting for a worker thread
+    std::deque<PrefetchedBlockRef> pending GUARDED_BY(cs);
+    size_t nBytesAhead GUARDED_BY(cs) = 0;
+    bool fReaderDone GUARDED_BY(cs) = false;
+    bool fStopReader GUARDED_BY(cs) = false;
+    bool fShutdown GUARDED_BY(cs) = false;
+    std::thread readerThread;
+    std::vector<std::thread> workerThreads;
+};
+} // namespace
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -5003,45 +6315,29 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
 
     int nLoaded = 0;
     try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
+        // This takes over fileIn and calls fclose() on it in the BlockFilePrefetcher destructor
+        BlockFilePrefetcher prefetcher(fileIn, chainparams.MessageStart());
+        PrefetchedBlockRef entry;
+        while ((entry = prefetcher.Next()) != nullptr) {
             boost::this_thread::interruption_point();
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+            if (!entry->block) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, entry->error);
+                // start one byte further, in case of failure
+                prefetcher.Restart(entry->nHeaderPos + 1);
+                continue;
+            }
+            if (entry->nConsumed < entry->nSize) {
+                // continue after the block, rather than after the size written ahead of it
+                prefetcher.Restart(entry->nBlockPos + entry->nConsumed);
             }
             try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    dbp->nPos = entry->nBlockPos;
+                std::shared_ptr<CBlock> pblock = entry->block;
                 CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
 
-                uint256 hash = block.GetHash();
+                const uint256& hash = entry->hash;
                 {
                     LOCK(cs_main);
                     // detect out of order blocks, and store them for later
@@ -5331,7 +6627,81 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(::ChainActive().Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Dumps of version 1 hold the transactions alone, which are validated again when loaded
+static const uint64_t MEMPOOL_DUMP_VERSION_UNVALIDATED = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+
+namespace {
+/**
+ * A mempool entry with the results of its validation, dumped along with the tip they hold on.
+ * Entries are dumped parents first, so that they can be restored in the same order.
+ */
+struct MempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    CAmount nFee;
+    int64_t nSigOpCost;
+    unsigned int nHeight;
+    bool fSpendsCoinbase;
+    int nLockHeight;
+    int64_t nLockTime;
+    int nMaxInputHeight; //!< Height of the LockPoints maxInputBlock, -1 if there is none
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tx);
+        READWRITE(nTime);
+        READWRITE(nFeeDelta);
+        READWRITE(nFee);
+        READWRITE(nSigOpCost);
+        READWRITE(nHeight);
+        READWRITE(fSpendsCoinbase);
+        READWRITE(nLockHeight);
+        READWRITE(nLockTime);
+        READWRITE(nMaxInputHeight);
+    }
+};
+} // namespace
+
+/**
+ * Add a dumped entry to the pool without validating it again, which holds as long as the tip it was
+ * validated on is still the tip. Returns false if it now conflicts with the pool and needs validation.
+ */
+static bool RestoreMempoolEntry(CTxMemPool& pool, const MempoolDumpEntry& dumped) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    LOCK(pool.cs);
+    const CTransaction& tx = *dumped.tx;
+    if (pool.exists(tx.GetHash()))
+        return false;
+    // Transactions added meanwhile, e.g. by wallets, may spend the same coins
+    for (const CTxIn& txin : tx.vin) {
+        if (pool.mapNextTx.count(txin.prevout) || (!pool.exists(txin.prevout.hash) && !::ChainstateActive().CoinsTip().HaveCoin(txin.prevout)))
+            return false;
+    }
+
+    LockPoints lp;
+    lp.height = dumped.nLockHeight;
+    lp.time = dumped.nLockTime;
+    lp.maxInputBlock = dumped.nMaxInputHeight >= 0 ? ::ChainActive()[dumped.nMaxInputHeight] : nullptr;
+    const CTxMemPoolEntry entry(dumped.tx, dumped.nFee, dumped.nTime, dumped.nHeight, dumped.fSpendsCoinbase, dumped.nSigOpCost, lp);
+    if (entry.GetBindPlotterId() != 0 && !pool.GetBindPlotterTxs(entry.GetBindPlotterId()).empty())
+        return false;
+
+    pool.addUnchecked(entry, false);
+    GetMainSignals().TransactionAddedToMempool(dumped.tx);
+
+#ifdef ENABLE_OMNICORE
+    if (omnicore_api::Enabled()) {
+        omnicore_api::TryToAddToMarkerCache(dumped.tx);
+    }
+#endif
+
+    return true;
+}
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -5345,35 +6715,62 @@ bool LoadMempool(CTxMemPool& pool)
     }
 
     int64_t count = 0;
+    int64_t restored = 0;
     int64_t expired = 0;
     int64_t failed = 0;
     int64_t already_there = 0;
     int64_t nNow = GetTime();
 
     try {
+        // Read the whole dump first, its checksum has to hold before any validation result is trusted
+        CHashVerifier<CAutoFile> verifier(&file);
         uint64_t version;
-        file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        verifier >> version;
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_UNVALIDATED) {
             return false;
         }
+        uint256 hashTip;
+        if (version == MEMPOOL_DUMP_VERSION)
+            verifier >> hashTip;
         uint64_t num;
-        file >> num;
+        verifier >> num;
+        std::vector<MempoolDumpEntry> vEntries;
+        vEntries.reserve(std::min<uint64_t>(num, MAX_BLOCK_WEIGHT));
         while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
+            vEntries.emplace_back();
+            MempoolDumpEntry& dumped = vEntries.back();
+            if (version == MEMPOOL_DUMP_VERSION) {
+                verifier >> dumped;
+            } else {
+                verifier >> dumped.tx;
+                verifier >> dumped.nTime;
+                verifier >> dumped.nFeeDelta;
+            }
+        }
+        std::map<uint256, CAmount> mapDeltas;
+        verifier >> mapDeltas;
+        if (version == MEMPOOL_DUMP_VERSION) {
+            uint256 hashChecksum;
+            file >> hashChecksum;
+            if (hashChecksum != verifier.GetHash())
+                throw std::runtime_error("checksum mismatch");
+        }
+
+        for (const MempoolDumpEntry& dumped : vEntries) {
+            const CTransactionRef& tx = dumped.tx;
+            CAmount amountdelta = dumped.nFeeDelta;
             if (amountdelta) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+            if (dumped.nTime + nExpiryTimeout > nNow) {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, nTime,
+                if (!hashTip.IsNull() && hashTip == ::ChainActive().Tip()->GetBlockHash() && RestoreMempoolEntry(pool, dumped)) {
+                    ++count;
+                    ++restored;
+                    continue;
+                }
+                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, dumped.nTime,
                                            nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
                                            false /* test_accept */);
                 if (state.IsValid()) {
@@ -5395,18 +6792,22 @@ bool LoadMempool(CTxMemPool& pool)
             if (ShutdownRequested())
                 return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
 
         for (const auto& i : mapDeltas) {
             pool.PrioritiseTransaction(i.first, i.second);
         }
+
+        if (restored > 0) {
+            // Restored entries skipped the size limit of acceptance
+            LOCK2(cs_main, pool.cs);
+            LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, nExpiryTimeout);
+        }
     } catch (const std::exception& e) {
         LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded (%i without validation), %i failed, %i expired, %i already there\n", count, restored, failed, expired, already_there);
     return true;
 }
 
@@ -5415,17 +6816,27 @@ bool DumpMempool(const CTxMemPool& pool)
     int64_t start = GetTimeMicros();
 
     std::map<uint256, CAmount> mapDeltas;
-    std::vector<TxMempoolInfo> vinfo;
+    std::vector<MempoolDumpEntry> vEntries;
+    uint256 hashTip;
 
     static Mutex dump_mutex;
     LOCK(dump_mutex);
 
     {
-        LOCK(pool.cs);
+        LOCK2(cs_main, pool.cs);
         for (const auto &i : pool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
-        vinfo = pool.infoAll();
+        if (::ChainActive().Tip())
+            hashTip = ::ChainActive().Tip()->GetBlockHash();
+        const std::vector<TxMempoolInfo> vinfo = pool.infoAll();
+        vEntries.reserve(vinfo.size());
+        for (const auto& i : vinfo) {
+            const CTxMemPoolEntry& entry = *pool.mapTx.find(i.tx->GetHash());
+            const LockPoints& lp = entry.GetLockPoints();
+            vEntries.push_back(MempoolDumpEntry{i.tx, i.nTime, i.nFeeDelta, entry.GetFee(), entry.GetSigOpCost(), entry.GetHeight(),
+                entry.GetSpendsCoinbase(), lp.height, lp.time, lp.maxInputBlock ? lp.maxInputBlock->nHeight : -1});
+        }
     }
 
     int64_t mid = GetTimeMicros();
@@ -5437,19 +6848,20 @@ bool DumpMempool(const CTxMemPool& pool)
         }
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        CHashedWriter<CAutoFile> writer(&file);
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
+        writer << version;
+        writer << hashTip;
 
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
+        writer << (uint64_t)vEntries.size();
+        for (const auto& dumped : vEntries) {
+            writer << dumped;
+            mapDeltas.erase(dumped.tx->GetHash());
         }
 
-        file << mapDeltas;
+        writer << mapDeltas;
+        file << writer.GetHash();
         if (!FileCommit(file.Get()))
             throw std::runtime_error("FileCommit failed");
         file.fclose();
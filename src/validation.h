@@ -43,6 +43,7 @@ class CScriptCheck;
 class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
+class SnapshotMetadata;
 struct ChainTxData;
 
 struct DisconnectedBlockTransactions;
@@ -112,8 +113,13 @@ static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 /** Maximum age of our tip in seconds for us to be considered current for fee estimation */
 static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 
+/** Default for -maxprocessmem, 0 = the coins cache keeps to -dbcache */
+static const int64_t DEFAULT_MAX_PROCESS_MEMORY = 0;
+
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
+static const bool DEFAULT_ACCOUNTHISTORYINDEX = false;
+static const bool DEFAULT_BINDPLOTTERINDEX = false;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -162,6 +168,8 @@ extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern bool fCheckWork;
 extern size_t nCoinCacheUsage;
+/** Resident memory of the process the coins cache adapts to, 0 = off */
+extern int64_t nMaxProcessMemory;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -188,6 +196,21 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 960;
 /** Minimum blocks required to signal NODE_NETWORK_LIMITED */
 static const unsigned int NODE_NETWORK_LIMITED_MIN_BLOCKS = 960;
 
+/** zstd compression level of new block and undo data, 0 = stored raw. Compressed data is read back regardless. */
+extern int nBlockCompressionLevel;
+static const int DEFAULT_BLOCK_COMPRESSION_LEVEL = 0;
+static const int MAX_BLOCK_COMPRESSION_LEVEL = 19;
+/** Whether this build can read and write compressed block and undo data */
+bool IsBlockCompressionSupported();
+
+/** Number of the most recently connected blocks whose undo data is kept in memory for short reorgs */
+extern int nReorgUndoCacheBlocks;
+static const int DEFAULT_REORG_UNDO_CACHE_BLOCKS = 6;
+static const int MAX_REORG_UNDO_CACHE_BLOCKS = 100;
+
+/** Default for -maxheadersigcachesize, in MiB. Enough for the headers of a few days */
+static const int64_t DEFAULT_MAX_HEADER_SIG_CACHE_SIZE = 1;
+
 static const signed int DEFAULT_CHECKBLOCKS = 6;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
 
@@ -237,6 +260,36 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
 
+/** Same as above, for headers whose hashes are already computed */
+bool ProcessNewBlockHeaders(const std::vector<CHashedBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+
+/** Time spent in the stages of connecting blocks since startup, in microseconds, as logged in the BCLog::BENCH category */
+struct BlockConnectTimings
+{
+    int64_t nBlocks{0};
+    // ConnectBlock()
+    int64_t nTimeCheck{0};
+    int64_t nTimeForks{0};
+    int64_t nTimeConnect{0};
+    int64_t nTimeReward{0};
+    int64_t nTimeVerify{0};
+    int64_t nTimeIndex{0};
+    int64_t nTimeCallbacks{0};
+    // ConnectTip()
+    int64_t nTimeReadFromDisk{0};
+    int64_t nTimeConnectTotal{0};
+    int64_t nTimeFlush{0};
+    int64_t nTimeChainState{0};
+    int64_t nTimePostConnect{0};
+    int64_t nTimeOmni{0};
+    int64_t nTimeTotal{0};
+    // Header checks, including the batched checks of received headers
+    int64_t nTimePoC{0};
+    int64_t nTimePoS{0};
+};
+
+BlockConnectTimings GetBlockConnectTimings() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Open a block file (blk?????.dat) */
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
@@ -252,6 +305,8 @@ bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck(int worker_num);
+/** Run an instance of the block header signature checking thread */
+void ThreadHeaderSignatureCheck(int worker_num);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
 /**
@@ -277,6 +332,8 @@ const CBlockIndex* GetEpochInitIndex(const CBlockIndex* pindex, const Consensus:
 uint256 GetEpochHash(const CBlockIndex* pindex, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 uint256 GetCurrentEpochHash(const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 uint256 GetSpendEpochHash(const CCoinsViewCache& inputs, const Consensus::Params& params);
+/** Get the staking pool subsidy of the blocks generated by the pool since the epoch of pindex began, paid out by the next snapshot */
+CAmount GetStakingPoolEpochReward(const CBlockIndex* pindex, const CAccountID& poolID, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 /** Guess verification progress (as a fraction between 0.0=genesis and 1.0=current tip). */
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex* pindex);
@@ -389,12 +446,20 @@ public:
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
+/** Initializes the cache of bind plotter payloads verified by the mempool */
+void InitBindPayloadCache();
+
+/** Initializes the cache of verified block header signatures */
+void InitHeaderSignatureCache();
+
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/** Read the transaction nTxOffset bytes behind the header of the block at pos, and the hash of the block */
+bool ReadTxFromDisk(CTransactionRef& tx, uint256& hashBlock, const FlatFilePos& pos, unsigned int nTxOffset);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
@@ -465,6 +530,10 @@ struct CBlockIndexWorkComparator
  * candidate tips is not maintained here.
  */
 class BlockManager {
+private:
+    //! Owns the entries of m_block_index
+    CBlockIndexArena m_block_index_arena GUARDED_BY(cs_main);
+
 public:
     BlockMap m_block_index GUARDED_BY(cs_main);
 
@@ -511,7 +580,7 @@ public:
     /** Clear all data members. */
     void Unload() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    CBlockIndex* AddToBlockIndex(const CBlockHeader& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* AddToBlockIndex(const CHashedBlockHeader& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -520,7 +589,7 @@ public:
      * that it doesn't descend from an invalid block, and then add it to m_block_index.
      */
     bool AcceptBlockHeader(
-        const CBlockHeader& block,
+        const CHashedBlockHeader& block,
         CValidationState& state,
         const CChainParams& chainparams,
         CBlockIndex** ppindex,
@@ -546,11 +615,15 @@ public:
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
+    //! This view passes flushes to the database, or with -backgroundflush writes them on a
+    //! background thread while the cache above it keeps going.
+    CCoinsViewBackgroundWriter m_writerview GUARDED_BY(cs_main);
+
     //! This is the top layer of the cache hierarchy - it keeps as many coins in memory as
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
 
-    //! This constructor initializes CCoinsViewDB and CCoinsViewErrorCatcher instances, but it
+    //! This constructor initializes CCoinsViewDB, CCoinsViewErrorCatcher and CCoinsViewBackgroundWriter instances, but it
     //! *does not* create a CCoinsViewCache instance by default. This is done separately because the
     //! presence of the cache has implications on whether or not we're allowed to flush the cache's
     //! state to disk, which should not be done until the health of the database is verified.
@@ -657,9 +730,10 @@ public:
         return *m_coins_views->m_cacheview.get();
     }
 
-    //! @returns A reference to the on-disk UTXO set database.
+    //! @returns A reference to the on-disk UTXO set database, once the background write in flight completed.
     CCoinsViewDB& CoinsDB() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     {
+        m_coins_views->m_writerview.Wait();
         return m_coins_views->m_dbview;
     }
 
@@ -719,7 +793,7 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
                       CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
                       /* Track removals from the UTXO DB for this block */ std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -754,13 +828,22 @@ public:
     /** Update the chain tip based on database information, i.e. CoinsTip()'s best block. */
     bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Load a UTXO set snapshot written by dumptxoutset into the empty coin database of a chain still at the genesis
+     * block, and make its base block the tip. The blocks up to the base look pruned afterwards. The snapshot must
+     * match its hash, and expected_hash unless null, or it is erased again.
+     */
+    bool LoadSnapshot(const fs::path& path, const uint256& expected_hash, const CChainParams& chainparams, SnapshotMetadata& metadata, std::string& error) LOCKS_EXCLUDED(cs_main);
+
 private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
-    bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, const CBlockIndex* pindexNext = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
 
     void InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Set nChainTx of a block whose parents all have their transactions, and of its descendants waiting for it
+    void LinkBlockTransactions(CBlockIndex* pindexNew) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -805,6 +888,21 @@ extern std::unique_ptr<CBlockTreeDB> pblocktree;
  */
 int GetSpendHeight(const CCoinsViewCache& inputs);
 
+/** What the inputs of a transaction are checked against when spent on top of a view's best block */
+struct CSpendContext
+{
+    uint256 hashBestBlock;
+    int nSpendHeight = 0;
+    uint256 epochHash;
+};
+
+/**
+ * Return the spend height and spend epoch hash of inputs.GetBestBlock(). The
+ * context of the last best block asked for is cached, so that accepting
+ * transactions on top of the same tip does not look it up each time.
+ */
+CSpendContext GetSpendContext(const CCoinsViewCache& inputs, const Consensus::Params& params);
+
 extern VersionBitsCache versionbitscache;
 
 /**
@@ -5,15 +5,26 @@
 
 #include <validationinterface.h>
 
+#include <logging.h>
 #include <primitives/block.h>
 #include <scheduler.h>
 #include <txmempool.h>
+#include <util/system.h>
+#include <util/time.h>
+
+#include <assert.h>
 
 #include <list>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <map>
+#include <thread>
+#include <typeinfo>
 #include <utility>
 
+#include <boost/core/demangle.hpp>
 #include <boost/signals2/signal.hpp>
 
 struct ValidationInterfaceConnections {
@@ -27,6 +38,232 @@ struct ValidationInterfaceConnections {
     boost::signals2::scoped_connection NewPoWValidBlock;
 };
 
+std::string ValidationCallbackName(ValidationCallback callback)
+{
+    switch (callback) {
+    case ValidationCallback::UPDATED_BLOCK_TIP: return "updated_block_tip";
+    case ValidationCallback::TRANSACTION_ADDED_TO_MEMPOOL: return "transaction_added_to_mempool";
+    case ValidationCallback::BLOCK_CONNECTED: return "block_connected";
+    case ValidationCallback::BLOCK_DISCONNECTED: return "block_disconnected";
+    case ValidationCallback::TRANSACTION_REMOVED_FROM_MEMPOOL: return "transaction_removed_from_mempool";
+    case ValidationCallback::CHAINSTATE_FLUSHED: return "chainstate_flushed";
+    case ValidationCallback::BLOCK_CHECKED: return "block_checked";
+    case ValidationCallback::NEW_POW_VALID_BLOCK: return "new_pow_valid_block";
+    }
+    assert(false);
+}
+
+namespace {
+
+//! Count and durations of timed calls, updated without a lock
+struct CallbackTimer {
+    std::atomic<uint64_t> nCalls{0};
+    std::atomic<int64_t> nTotalMicros{0};
+    std::atomic<int64_t> nMaxMicros{0};
+
+    void Add(int64_t nMicros)
+    {
+        nCalls.fetch_add(1, std::memory_order_relaxed);
+        nTotalMicros.fetch_add(nMicros, std::memory_order_relaxed);
+        int64_t nMax = nMaxMicros.load(std::memory_order_relaxed);
+        while (nMicros > nMax && !nMaxMicros.compare_exchange_weak(nMax, nMicros, std::memory_order_relaxed)) {}
+    }
+
+    ValidationCallbackTimings Get() const
+    {
+        ValidationCallbackTimings timings;
+        timings.nCalls = nCalls.load(std::memory_order_relaxed);
+        timings.nTotalMicros = nTotalMicros.load(std::memory_order_relaxed);
+        timings.nMaxMicros = nMaxMicros.load(std::memory_order_relaxed);
+        return timings;
+    }
+};
+
+//! Timers of the listeners of one type
+struct ListenerTimers {
+    const std::string name;
+    const bool fOwnThread;
+    std::array<CallbackTimer, VALIDATION_CALLBACK_COUNT> callbacks;
+    CallbackTimer queueWait;
+    std::atomic<int64_t> nQueueDepth{0};
+    std::atomic<bool> fQueueWarned{false};
+
+    ListenerTimers(const std::string& nameIn, bool fOwnThreadIn) : name(nameIn), fOwnThread(fOwnThreadIn) {}
+};
+
+//! Type of the listener without its namespaces, e.g. TxIndex
+std::string ListenerName(CValidationInterface* callbacks)
+{
+    std::string name = boost::core::demangle(typeid(*callbacks).name());
+    size_t pos = name.rfind("::");
+    return pos == std::string::npos ? name : name.substr(pos + 2);
+}
+
+//! Deliver the callback to the listener, timed unless the listener times its deliveries itself
+template <typename Callable>
+void DeliverCallback(ListenerTimers* timers, ValidationCallback callback, Callable&& func)
+{
+    if (!timers) {
+        func();
+        return;
+    }
+    const int64_t nTimeStart = GetTimeMicros();
+    func();
+    timers->callbacks[static_cast<size_t>(callback)].Add(GetTimeMicros() - nTimeStart);
+}
+
+//! Wrap the slot of a signal to time its deliveries, unless there are no timers
+template <typename... Args, typename Callable>
+std::function<void(Args...)> TimedCallback(std::shared_ptr<ListenerTimers> timers, ValidationCallback callback, Callable func)
+{
+    if (!timers)
+        return func;
+    return [timers, callback, func](Args... args) {
+        DeliverCallback(timers.get(), callback, [&] { func(args...); });
+    };
+}
+
+//! Log once when the queue grows beyond VALIDATION_QUEUE_WARNING_DEPTH, and again after it drained to half of it
+void CheckQueueDepth(const std::string& queue, int64_t nDepth, std::atomic<bool>& fWarned)
+{
+    if (nDepth > VALIDATION_QUEUE_WARNING_DEPTH) {
+        if (!fWarned.exchange(true))
+            LogPrintf("Warning: %d validation callbacks pending in the queue of %s, a slow listener is holding up the others\n", nDepth, queue);
+    } else if (nDepth < VALIDATION_QUEUE_WARNING_DEPTH / 2 && fWarned.load(std::memory_order_relaxed)) {
+        fWarned = false;
+    }
+}
+
+} // namespace
+
+/**
+ * Listener standing in for a CValidationInterface registered on its own thread. The queued
+ * callbacks it gets from the scheduler thread are handed on in order on its worker thread,
+ * while the synchronous BlockChecked and NewPoWValidBlock callbacks are passed on directly.
+ */
+class ValidationInterfaceWorker final : public CValidationInterface
+{
+public:
+    ValidationInterfaceWorker(CValidationInterface* callbacks, std::shared_ptr<ListenerTimers> timers) : m_callbacks(callbacks), m_timers(std::move(timers))
+    {
+        m_thread = std::thread(&TraceThread<std::function<void()>>, "valworker", std::function<void()>(std::bind(&ValidationInterfaceWorker::ThreadProcess, this)));
+    }
+
+    ~ValidationInterfaceWorker() { Stop(); }
+
+    //! Drop the callbacks not yet delivered and wait for the one being delivered
+    void Stop()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+            m_timers->nQueueDepth -= m_queue.size();
+            m_queue.clear();
+        }
+        m_cond.notify_all();
+        if (m_thread.joinable()) {
+            if (m_thread.get_id() == std::this_thread::get_id()) {
+                m_thread.detach();
+            } else {
+                m_thread.join();
+            }
+        }
+    }
+
+    //! Block until every callback queued so far has been delivered
+    void Wait()
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || (m_queue.empty() && !m_busy); });
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        Add(ValidationCallback::UPDATED_BLOCK_TIP, [=] { m_callbacks->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    }
+    void TransactionAddedToMempool(const CTransactionRef& ptx) override
+    {
+        Add(ValidationCallback::TRANSACTION_ADDED_TO_MEMPOOL, [=] { m_callbacks->TransactionAddedToMempool(ptx); });
+    }
+    void TransactionRemovedFromMempool(const CTransactionRef& ptx) override
+    {
+        Add(ValidationCallback::TRANSACTION_REMOVED_FROM_MEMPOOL, [=] { m_callbacks->TransactionRemovedFromMempool(ptx); });
+    }
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override
+    {
+        Add(ValidationCallback::BLOCK_CONNECTED, [=] { m_callbacks->BlockConnected(block, pindex, txnConflicted); });
+    }
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block) override
+    {
+        Add(ValidationCallback::BLOCK_DISCONNECTED, [=] { m_callbacks->BlockDisconnected(block); });
+    }
+    void ChainStateFlushed(const CBlockLocator& locator) override
+    {
+        Add(ValidationCallback::CHAINSTATE_FLUSHED, [=] { m_callbacks->ChainStateFlushed(locator); });
+    }
+    void BlockChecked(const CBlock& block, const CValidationState& state) override
+    {
+        DeliverCallback(m_timers.get(), ValidationCallback::BLOCK_CHECKED, [&] { m_callbacks->BlockChecked(block, state); });
+    }
+    void NewPoWValidBlock(const CBlockIndex* pindex, const std::shared_ptr<const CBlock>& block) override
+    {
+        DeliverCallback(m_timers.get(), ValidationCallback::NEW_POW_VALID_BLOCK, [&] { m_callbacks->NewPoWValidBlock(pindex, block); });
+    }
+
+private:
+    struct QueuedCallback {
+        ValidationCallback callback;
+        int64_t nTimeQueued;
+        std::function<void()> func;
+    };
+
+    CValidationInterface* const m_callbacks;
+    const std::shared_ptr<ListenerTimers> m_timers;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<QueuedCallback> m_queue GUARDED_BY(m_mutex);
+    bool m_busy GUARDED_BY(m_mutex) = false;
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::thread m_thread;
+
+    void Add(ValidationCallback callback, std::function<void()> func)
+    {
+        int64_t nDepth;
+        {
+            LOCK(m_mutex);
+            if (m_stop) return;
+            m_queue.push_back(QueuedCallback{callback, GetTimeMicros(), std::move(func)});
+            nDepth = ++m_timers->nQueueDepth;
+        }
+        CheckQueueDepth(m_timers->name, nDepth, m_timers->fQueueWarned);
+        m_cond.notify_all();
+    }
+
+    void ThreadProcess()
+    {
+        while (true) {
+            QueuedCallback queued;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                if (m_busy) {
+                    m_busy = false;
+                    m_cond.notify_all();
+                }
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_queue.empty(); });
+                if (m_stop) return;
+                queued = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_timers->nQueueDepth--;
+                m_busy = true;
+            }
+            m_timers->queueWait.Add(GetTimeMicros() - queued.nTimeQueued);
+            DeliverCallback(m_timers.get(), queued.callback, queued.func);
+        }
+    }
+};
+
 struct MainSignalsInstance {
     boost::signals2::signal<void (const CBlockIndex *, const CBlockIndex *, bool fInitialDownload)> UpdatedBlockTip;
     boost::signals2::signal<void (const CTransactionRef &)> TransactionAddedToMempool;
@@ -43,7 +280,42 @@ struct MainSignalsInstance {
     SingleThreadedSchedulerClient m_schedulerClient;
     std::unordered_map<CValidationInterface*, ValidationInterfaceConnections> m_connMainSignals;
 
+    //! Workers of the listeners registered on their own thread, by listener
+    Mutex m_workers_mutex;
+    std::map<CValidationInterface*, std::shared_ptr<ValidationInterfaceWorker>> m_workers GUARDED_BY(m_workers_mutex);
+
+    //! Timers of the listeners by type, kept after the listeners are unregistered
+    Mutex m_timers_mutex;
+    std::map<std::string, std::shared_ptr<ListenerTimers>> m_timers GUARDED_BY(m_timers_mutex);
+
+    //! Time callbacks waited in m_schedulerClient, and callbacks pending in it
+    CallbackTimer m_queue_wait;
+    std::atomic<int64_t> m_queue_depth{0};
+    std::atomic<bool> m_queue_warned{false};
+
     explicit MainSignalsInstance(CScheduler *pscheduler) : m_schedulerClient(pscheduler) {}
+
+    std::shared_ptr<ListenerTimers> GetTimers(CValidationInterface* callbacks, bool fOwnThread)
+    {
+        const std::string name = ListenerName(callbacks);
+        LOCK(m_timers_mutex);
+        std::shared_ptr<ListenerTimers>& timers = m_timers[fOwnThread ? name + " (own thread)" : name];
+        if (!timers)
+            timers = std::make_shared<ListenerTimers>(name, fOwnThread);
+        return timers;
+    }
+
+    //! Queue the callbacks of an event, see SingleThreadedSchedulerClient::AddToProcessQueue()
+    void AddToProcessQueue(std::function<void()> func)
+    {
+        CheckQueueDepth("the scheduler thread", ++m_queue_depth, m_queue_warned);
+        const int64_t nTimeQueued = GetTimeMicros();
+        m_schedulerClient.AddToProcessQueue([this, nTimeQueued, func] {
+            m_queue_depth--;
+            m_queue_wait.Add(GetTimeMicros() - nTimeQueued);
+            func();
+        });
+    }
 };
 
 static CMainSignals g_signals;
@@ -73,6 +345,28 @@ size_t CMainSignals::CallbacksPending() {
     return m_internals->m_schedulerClient.CallbacksPending();
 }
 
+ValidationInterfaceStats CMainSignals::GetStats() {
+    ValidationInterfaceStats stats;
+    if (!m_internals) return stats;
+    stats.queueWait = m_internals->m_queue_wait.Get();
+    stats.nQueueDepth = m_internals->m_queue_depth.load();
+
+    LOCK(m_internals->m_timers_mutex);
+    for (const auto& entry : m_internals->m_timers) {
+        const ListenerTimers& timers = *entry.second;
+        ValidationListenerStats listener;
+        listener.name = timers.name;
+        listener.fOwnThread = timers.fOwnThread;
+        for (size_t i = 0; i < VALIDATION_CALLBACK_COUNT; i++) {
+            listener.callbacks[i] = timers.callbacks[i].Get();
+        }
+        listener.queueWait = timers.queueWait.Get();
+        listener.nQueueDepth = timers.nQueueDepth.load();
+        stats.listeners.push_back(std::move(listener));
+    }
+    return stats;
+}
+
 void CMainSignals::RegisterWithMempoolSignals(CTxMemPool& pool) {
     g_connNotifyEntryRemoved.emplace(std::piecewise_construct,
         std::forward_as_tuple(&pool),
@@ -90,20 +384,45 @@ CMainSignals& GetMainSignals()
 }
 
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
+    using namespace std::placeholders;
+    // Workers of listeners on their own thread time the deliveries on their thread
+    std::shared_ptr<ListenerTimers> timers;
+    if (!dynamic_cast<ValidationInterfaceWorker*>(pwalletIn))
+        timers = g_signals.m_internals->GetTimers(pwalletIn, false);
+
     ValidationInterfaceConnections& conns = g_signals.m_internals->m_connMainSignals[pwalletIn];
-    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, std::placeholders::_1));
-    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(std::bind(&CValidationInterface::BlockConnected, pwalletIn, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
-    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, std::placeholders::_1));
-    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, std::placeholders::_1));
-    conns.ChainStateFlushed = g_signals.m_internals->ChainStateFlushed.connect(std::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, std::placeholders::_1));
-    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
-    conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.UpdatedBlockTip = g_signals.m_internals->UpdatedBlockTip.connect(TimedCallback<const CBlockIndex*, const CBlockIndex*, bool>(timers, ValidationCallback::UPDATED_BLOCK_TIP, std::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1, _2, _3)));
+    conns.TransactionAddedToMempool = g_signals.m_internals->TransactionAddedToMempool.connect(TimedCallback<const CTransactionRef&>(timers, ValidationCallback::TRANSACTION_ADDED_TO_MEMPOOL, std::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1)));
+    conns.BlockConnected = g_signals.m_internals->BlockConnected.connect(TimedCallback<const std::shared_ptr<const CBlock>&, const CBlockIndex*, const std::vector<CTransactionRef>&>(timers, ValidationCallback::BLOCK_CONNECTED, std::bind(&CValidationInterface::BlockConnected, pwalletIn, _1, _2, _3)));
+    conns.BlockDisconnected = g_signals.m_internals->BlockDisconnected.connect(TimedCallback<const std::shared_ptr<const CBlock>&>(timers, ValidationCallback::BLOCK_DISCONNECTED, std::bind(&CValidationInterface::BlockDisconnected, pwalletIn, _1)));
+    conns.TransactionRemovedFromMempool = g_signals.m_internals->TransactionRemovedFromMempool.connect(TimedCallback<const CTransactionRef&>(timers, ValidationCallback::TRANSACTION_REMOVED_FROM_MEMPOOL, std::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1)));
+    conns.ChainStateFlushed = g_signals.m_internals->ChainStateFlushed.connect(TimedCallback<const CBlockLocator&>(timers, ValidationCallback::CHAINSTATE_FLUSHED, std::bind(&CValidationInterface::ChainStateFlushed, pwalletIn, _1)));
+    conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(TimedCallback<const CBlock&, const CValidationState&>(timers, ValidationCallback::BLOCK_CHECKED, std::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2)));
+    conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(TimedCallback<const CBlockIndex*, const std::shared_ptr<const CBlock>&>(timers, ValidationCallback::NEW_POW_VALID_BLOCK, std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, _1, _2)));
+}
+
+void RegisterValidationInterfaceOnOwnThread(CValidationInterface* pwalletIn) {
+    auto worker = std::make_shared<ValidationInterfaceWorker>(pwalletIn, g_signals.m_internals->GetTimers(pwalletIn, true));
+    {
+        LOCK(g_signals.m_internals->m_workers_mutex);
+        g_signals.m_internals->m_workers[pwalletIn] = worker;
+    }
+    RegisterValidationInterface(worker.get());
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     if (g_signals.m_internals) {
-        g_signals.m_internals->m_connMainSignals.erase(pwalletIn);
+        std::shared_ptr<ValidationInterfaceWorker> worker;
+        {
+            LOCK(g_signals.m_internals->m_workers_mutex);
+            auto it = g_signals.m_internals->m_workers.find(pwalletIn);
+            if (it != g_signals.m_internals->m_workers.end()) {
+                worker = std::move(it->second);
+                g_signals.m_internals->m_workers.erase(it);
+            }
+        }
+        g_signals.m_internals->m_connMainSignals.erase(worker ? worker.get() : pwalletIn);
+        if (worker) worker->Stop();
     }
 }
 
@@ -112,10 +431,18 @@ void UnregisterAllValidationInterfaces() {
         return;
     }
     g_signals.m_internals->m_connMainSignals.clear();
+    std::map<CValidationInterface*, std::shared_ptr<ValidationInterfaceWorker>> workers;
+    {
+        LOCK(g_signals.m_internals->m_workers_mutex);
+        workers.swap(g_signals.m_internals->m_workers);
+    }
+    for (const auto& entry : workers) {
+        entry.second->Stop();
+    }
 }
 
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func) {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->AddToProcessQueue(std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue() {
@@ -126,11 +453,23 @@ void SyncWithValidationInterfaceQueue() {
         promise.set_value();
     });
     promise.get_future().wait();
+
+    // Everything queued above has now been handed on to the workers
+    std::vector<std::shared_ptr<ValidationInterfaceWorker>> workers;
+    {
+        LOCK(g_signals.m_internals->m_workers_mutex);
+        for (const auto& entry : g_signals.m_internals->m_workers) {
+            workers.push_back(entry.second);
+        }
+    }
+    for (const auto& worker : workers) {
+        worker->Wait();
+    }
 }
 
 void CMainSignals::MempoolEntryRemoved(CTransactionRef ptx, MemPoolRemovalReason reason) {
     if (reason != MemPoolRemovalReason::BLOCK && reason != MemPoolRemovalReason::CONFLICT) {
-        m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
+        m_internals->AddToProcessQueue([ptx, this] {
             m_internals->TransactionRemovedFromMempool(ptx);
         });
     }
@@ -141,31 +480,31 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    m_internals->m_schedulerClient.AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
+    m_internals->AddToProcessQueue([pindexNew, pindexFork, fInitialDownload, this] {
         m_internals->UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     });
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef &ptx) {
-    m_internals->m_schedulerClient.AddToProcessQueue([ptx, this] {
+    m_internals->AddToProcessQueue([ptx, this] {
         m_internals->TransactionAddedToMempool(ptx);
     });
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>>& pvtxConflicted) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
+    m_internals->AddToProcessQueue([pblock, pindex, pvtxConflicted, this] {
         m_internals->BlockConnected(pblock, pindex, *pvtxConflicted);
     });
 }
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock> &pblock) {
-    m_internals->m_schedulerClient.AddToProcessQueue([pblock, this] {
+    m_internals->AddToProcessQueue([pblock, this] {
         m_internals->BlockDisconnected(pblock);
     });
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    m_internals->m_schedulerClient.AddToProcessQueue([locator, this] {
+    m_internals->AddToProcessQueue([locator, this] {
         m_internals->ChainStateFlushed(locator);
     });
 }
@@ -9,8 +9,12 @@
 #include <primitives/transaction.h> // CTransaction(Ref)
 #include <sync.h>
 
+#include <array>
 #include <functional>
 #include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 extern CCriticalSection cs_main;
 class CBlock;
@@ -18,6 +22,7 @@ class CBlockIndex;
 struct CBlockLocator;
 class CConnman;
 class CValidationInterface;
+class ValidationInterfaceWorker;
 class CValidationState;
 class uint256;
 class CScheduler;
@@ -28,6 +33,11 @@ enum class MemPoolRemovalReason;
 
 /** Register a wallet to receive updates from core */
 void RegisterValidationInterface(CValidationInterface* pwalletIn);
+/**
+ * Register a wallet to receive updates from core on a thread of its own. The queued
+ * callbacks keep their order, but a slow wallet no longer holds up the other listeners
+ */
+void RegisterValidationInterfaceOnOwnThread(CValidationInterface* pwalletIn);
 /** Unregister a wallet from core */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
@@ -50,6 +60,7 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  *         promise.set_value();
  *     });
  *     promise.get_future().wait();
+ * followed by waiting for the wallets registered on their own thread to catch up.
  */
 void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
 
@@ -146,6 +157,50 @@ protected:
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend class ::ValidationInterfaceWorker;
+};
+
+/** Callbacks of CValidationInterface, the deliveries of which are timed per listener */
+enum class ValidationCallback : size_t {
+    UPDATED_BLOCK_TIP,
+    TRANSACTION_ADDED_TO_MEMPOOL,
+    BLOCK_CONNECTED,
+    BLOCK_DISCONNECTED,
+    TRANSACTION_REMOVED_FROM_MEMPOOL,
+    CHAINSTATE_FLUSHED,
+    BLOCK_CHECKED,
+    NEW_POW_VALID_BLOCK,
+};
+static const size_t VALIDATION_CALLBACK_COUNT = 8;
+
+/** Name of the callback, e.g. "block_connected" */
+std::string ValidationCallbackName(ValidationCallback callback);
+
+/** Pending callbacks of a queue above which a warning about a slow listener is logged */
+static const int64_t VALIDATION_QUEUE_WARNING_DEPTH = 1000;
+
+/** Count and durations of timed calls */
+struct ValidationCallbackTimings {
+    uint64_t nCalls{0};
+    int64_t nTotalMicros{0};
+    int64_t nMaxMicros{0};
+};
+
+/** Timings of the listeners of one type, e.g. all wallets */
+struct ValidationListenerStats {
+    std::string name;
+    bool fOwnThread{false};
+    std::array<ValidationCallbackTimings, VALIDATION_CALLBACK_COUNT> callbacks;
+    //! Listeners registered on their own thread: time callbacks waited in their queue, and callbacks pending in it
+    ValidationCallbackTimings queueWait;
+    int64_t nQueueDepth{0};
+};
+
+struct ValidationInterfaceStats {
+    //! Time callbacks waited in the queue of the scheduler thread, and callbacks pending in it
+    ValidationCallbackTimings queueWait;
+    int64_t nQueueDepth{0};
+    std::vector<ValidationListenerStats> listeners;
 };
 
 struct MainSignalsInstance;
@@ -154,9 +209,11 @@ private:
     std::unique_ptr<MainSignalsInstance> m_internals;
 
     friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterfaceOnOwnThread(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::SyncWithValidationInterfaceQueue();
 
     void MempoolEntryRemoved(CTransactionRef tx, MemPoolRemovalReason reason);
 
@@ -170,6 +227,9 @@ public:
 
     size_t CallbacksPending();
 
+    /** Get the queue wait times and the callback durations per listener type since the scheduler was registered */
+    ValidationInterfaceStats GetStats();
+
     /** Register with mempool to call TransactionRemovedFromMempool callbacks */
     void RegisterWithMempoolSignals(CTxMemPool& pool);
     /** Unregister with mempool */
@@ -9,7 +9,7 @@
  * network protocol versioning
  */
 
-static const int PROTOCOL_VERSION = 80021;
+static const int PROTOCOL_VERSION = 80023;
 
 //! initial proto version, to be increased after version/verack negotiation
 static const int INIT_PROTO_VERSION = 209;
@@ -51,4 +51,10 @@ static const int QTC_MERCURY_VERSION = 80020;
 //! Saturn version
 static const int QTC_SATURN_VERSION = 80021;
 
+//! "sendcheaders" and "cheaders" messages start with this version
+static const int COMPRESSED_HEADERS_VERSION = 80022;
+
+//! "sendrecon" and the transaction reconciliation messages start with this version
+static const int TX_RECONCILIATION_VERSION = 80023;
+
 #endif // BITCOIN_VERSION_H
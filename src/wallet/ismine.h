@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <bitset>
+#include <vector>
 
 class CWallet;
 class CScript;
@@ -43,15 +44,32 @@ struct CachableAmount
 {
     // NO and ALL are never (supposed to be) cached
     std::bitset<ISMINE_ENUM_ELEMENTS> m_cached;
-    CAmount m_value[ISMINE_ENUM_ELEMENTS];
+    // Only the few filters actually asked for are stored. A full array of ISMINE_ENUM_ELEMENTS
+    // values per amount type would take kilobytes for every transaction of the wallet
+    std::vector<std::pair<isminefilter, CAmount>> m_values;
     inline void Reset()
     {
         m_cached.reset();
+        m_values.clear();
     }
     void Set(isminefilter filter, CAmount value)
     {
         m_cached.set(filter);
-        m_value[filter] = value;
+        for (auto& item : m_values) {
+            if (item.first == filter) {
+                item.second = value;
+                return;
+            }
+        }
+        m_values.emplace_back(filter, value);
+    }
+    CAmount Get(isminefilter filter) const
+    {
+        for (const auto& item : m_values) {
+            if (item.first == filter)
+                return item.second;
+        }
+        return 0;
     }
 };
 
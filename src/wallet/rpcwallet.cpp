@@ -47,6 +47,9 @@
 
 static const std::string WALLET_ENDPOINT_BASE = "/wallet/";
 
+//! Default number of recipients paid by each transaction of sendpayouts
+static const int DEFAULT_PAYOUT_OUTPUTS_PER_TX = 500;
+
 static inline bool GetAvoidReuseFlag(CWallet * const pwallet, const UniValue& param) {
     bool can_avoid_reuse = pwallet->IsWalletFlagSet(WALLET_FLAG_AVOID_REUSE);
     bool avoid_reuse = param.isNull() ? can_avoid_reuse : param.get_bool();
@@ -963,6 +966,156 @@ static UniValue sendmany(const JSONRPCRequest& request)
     return tx->GetHash().GetHex();
 }
 
+static UniValue sendpayouts(const JSONRPCRequest& request)
+{
+    std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
+    CWallet* const pwallet = wallet.get();
+
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp)) {
+        return NullUniValue;
+    }
+
+    RPCHelpMan{"sendpayouts",
+                "\nPay many recipients at once, spreading them over as many transactions as needed.\n"
+                "Every transaction is created before any is committed, so either all of them are sent or none when funds are short." +
+                    HelpRequiringPassphrase(pwallet) + "\n",
+                {
+                    {"amounts", RPCArg::Type::OBJ, RPCArg::Optional::NO, "A json object with addresses and amounts",
+                        {
+                            {"address", RPCArg::Type::AMOUNT, RPCArg::Optional::NO, "The qitcoin address is the key, the numeric amount (can be string) in " + CURRENCY_UNIT + " is the value"},
+                        },
+                    },
+                    {"outputs_per_tx", RPCArg::Type::NUM, /* default */ std::to_string(DEFAULT_PAYOUT_OUTPUTS_PER_TX), "The most recipients paid by one transaction"},
+                    {"comment", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "A comment stored with every transaction"},
+                    {"replaceable", RPCArg::Type::BOOL, /* default */ "wallet default", "Allow the transactions to be replaced by transactions with higher fees via BIP 125"},
+                    {"conf_target", RPCArg::Type::NUM, /* default */ "wallet default", "Confirmation target (in blocks)"},
+                    {"estimate_mode", RPCArg::Type::STR, /* default */ "UNSET", "The fee estimate mode, must be one of:\n"
+            "       \"UNSET\"\n"
+            "       \"ECONOMICAL\"\n"
+            "       \"CONSERVATIVE\""},
+                },
+                RPCResult{
+            "[                        (json array of string)\n"
+            "  \"txid\"                 (string) The transaction id of each transaction sent\n"
+            "  ,...\n"
+            "]\n"
+                },
+                RPCExamples{
+            "\nPay two addresses, one transaction each:\n"
+            + HelpExampleCli("sendpayouts", "\"{\\\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\\\":0.01,\\\"1353tsE8YMTA4EuV7dgUXGjNFf9KpVvKHz\\\":0.02}\" 1") +
+            "\nAs a JSON-RPC call\n"
+            + HelpExampleRpc("sendpayouts", "{\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XX\":0.01,\"1353tsE8YMTA4EuV7dgUXGjNFf9KpVvKHz\":0.02}, 1")
+                },
+    }.Check(request);
+
+    // Make sure the results are valid at least up to the most recent block
+    // the user could have gotten from another RPC command prior to now
+    pwallet->BlockUntilSyncedToCurrentChain();
+
+    auto locked_chain = pwallet->chain().lock();
+    LOCK(pwallet->cs_wallet);
+
+    UniValue sendTo = request.params[0].get_obj();
+
+    int nOutputsPerTx = DEFAULT_PAYOUT_OUTPUTS_PER_TX;
+    if (!request.params[1].isNull()) {
+        nOutputsPerTx = request.params[1].get_int();
+        if (nOutputsPerTx <= 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid outputs_per_tx");
+    }
+
+    mapValue_t mapValue;
+    if (!request.params[2].isNull() && !request.params[2].get_str().empty())
+        mapValue["comment"] = request.params[2].get_str();
+
+    CCoinControl coin_control;
+    if (!request.params[3].isNull()) {
+        coin_control.m_signal_bip125_rbf = request.params[3].get_bool();
+    }
+
+    if (!request.params[4].isNull()) {
+        coin_control.m_confirm_target = ParseConfirmTarget(request.params[4], pwallet->chain().estimateMaxBlocks());
+    }
+
+    if (!request.params[5].isNull()) {
+        if (!FeeModeFromString(request.params[5].get_str(), coin_control.m_fee_mode)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid estimate_mode parameter");
+        }
+    }
+
+    std::set<CTxDestination> destinations;
+    std::vector<CRecipient> vecSend;
+
+    std::vector<std::string> keys = sendTo.getKeys();
+    for (const std::string& name_ : keys) {
+        CTxDestination dest = DecodeDestination(name_);
+        if (!IsValidDestination(dest)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, std::string("Invalid Qitcoin address: ") + name_);
+        }
+
+        if (destinations.count(dest)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, std::string("Invalid parameter, duplicated address: ") + name_);
+        }
+        destinations.insert(dest);
+
+        CScript scriptPubKey = GetScriptForDestination(dest);
+        CAmount nAmount = AmountFromValue(sendTo[name_]);
+        if (nAmount <= 0)
+            throw JSONRPCError(RPC_TYPE_ERROR, "Invalid amount for send");
+
+        CRecipient recipient = {scriptPubKey, nAmount, false};
+        vecSend.push_back(recipient);
+    }
+    if (vecSend.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "No recipients");
+
+    EnsureWalletIsUnlocked(pwallet);
+
+    // Shuffle recipient list
+    std::shuffle(vecSend.begin(), vecSend.end(), FastRandomContext());
+
+    // Create every transaction first. The inputs of the ones created are locked meanwhile, so that the
+    // following ones select other coins
+    std::vector<CTransactionRef> vTx;
+    std::vector<COutPoint> vLockedCoins;
+    std::string strFailReason;
+    bool fCreated = true;
+    for (size_t nBegin = 0; nBegin < vecSend.size() && fCreated; nBegin += nOutputsPerTx) {
+        const size_t nEnd = std::min(vecSend.size(), nBegin + nOutputsPerTx);
+        const std::vector<CRecipient> vecPayouts(vecSend.begin() + nBegin, vecSend.begin() + nEnd);
+        CAmount nFeeRequired = 0;
+        int nChangePosRet = -1;
+        CTransactionRef tx;
+        fCreated = pwallet->CreateTransaction(*locked_chain, vecPayouts, tx, nFeeRequired, nChangePosRet, strFailReason, coin_control);
+        if (fCreated) {
+            for (const CTxIn& txin : tx->vin) {
+                pwallet->LockCoin(txin.prevout);
+                vLockedCoins.push_back(txin.prevout);
+            }
+            vTx.push_back(tx);
+        }
+    }
+    for (const COutPoint& outpoint : vLockedCoins) {
+        pwallet->UnlockCoin(outpoint);
+    }
+    if (!fCreated)
+        throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strFailReason);
+
+    // One wallet database flush for all of them
+    WalletFlushDeferral flush_deferral(*pwallet);
+    UniValue result(UniValue::VARR);
+    for (const CTransactionRef& tx : vTx) {
+        CValidationState state;
+        if (!pwallet->CommitTransaction(tx, mapValue, {} /* orderForm */, state)) {
+            strFailReason = strprintf("Transaction commit failed after %u of %u transactions:: %s", result.size(), vTx.size(), FormatStateMessage(state));
+            throw JSONRPCError(RPC_WALLET_ERROR, strFailReason);
+        }
+        result.push_back(tx->GetHash().GetHex());
+    }
+
+    return result;
+}
+
 static UniValue addmultisigaddress(const JSONRPCRequest& request)
 {
     std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
@@ -4635,9 +4788,12 @@ static UniValue listbindplotters(const JSONRPCRequest& request)
         bool fWatchonly;
     } TxBindPlotter;
     std::multimap<int64_t, TxBindPlotter> mapTxBindPlotter;
-    for (const std::pair<const uint256, CWalletTx>& pairWtx : pwallet->mapWallet) {
-        const CWalletTx& wtx = pairWtx.second;
-        if (!locked_chain->checkFinalTx(*wtx.tx) || wtx.GetMapValue("payload_t") != "bindplotter")
+    const auto itPayloadTxs = pwallet->mapPayloadTxs.find("bindplotter");
+    if (itPayloadTxs == pwallet->mapPayloadTxs.end())
+        return ret;
+    for (const std::pair<int64_t, uint256>& payloadTx : itPayloadTxs->second) {
+        const CWalletTx& wtx = pwallet->mapWallet.at(payloadTx.second);
+        if (!locked_chain->checkFinalTx(*wtx.tx))
             continue;
 
         CTxDestination toDest = DecodeDestination(wtx.GetMapValue("to"));
@@ -4983,9 +5139,12 @@ static UniValue listpoints(const JSONRPCRequest& request)
         bool fToWatchonly;
     } TxPoint;
     std::multimap<int64_t, TxPoint> mapTxPoint;
-    for (const std::pair<const uint256, CWalletTx>& pairWtx : pwallet->mapWallet) {
-        const CWalletTx& wtx = pairWtx.second;
-        if (!locked_chain->checkFinalTx(*wtx.tx) || wtx.GetMapValue("payload_t") != "point")
+    const auto itPayloadTxs = pwallet->mapPayloadTxs.find("point");
+    if (itPayloadTxs == pwallet->mapPayloadTxs.end())
+        return ret;
+    for (const std::pair<int64_t, uint256>& payloadTx : itPayloadTxs->second) {
+        const CWalletTx& wtx = pwallet->mapWallet.at(payloadTx.second);
+        if (!locked_chain->checkFinalTx(*wtx.tx))
             continue;
 
         CTxDestination fromDest = DecodeDestination(wtx.GetMapValue("from"));
@@ -5339,9 +5498,12 @@ static UniValue liststakings(const JSONRPCRequest& request)
         bool fToWatchonly;
     } TxStaking;
     std::multimap<int64_t, TxStaking> mapTxStaking;
-    for (const std::pair<const uint256, CWalletTx>& pairWtx : pwallet->mapWallet) {
-        const CWalletTx& wtx = pairWtx.second;
-        if (!locked_chain->checkFinalTx(*wtx.tx) || wtx.GetMapValue("payload_t") != "staking")
+    const auto itPayloadTxs = pwallet->mapPayloadTxs.find("staking");
+    if (itPayloadTxs == pwallet->mapPayloadTxs.end())
+        return ret;
+    for (const std::pair<int64_t, uint256>& payloadTx : itPayloadTxs->second) {
+        const CWalletTx& wtx = pwallet->mapWallet.at(payloadTx.second);
+        if (!locked_chain->checkFinalTx(*wtx.tx))
             continue;
 
         CTxDestination fromDest = DecodeDestination(wtx.GetMapValue("from"));
@@ -5607,6 +5769,7 @@ static const CRPCCommand commands[] =
     { "wallet",             "removeprunedfunds",                &removeprunedfunds,             {"txid"} },
     { "wallet",             "rescanblockchain",                 &rescanblockchain,              {"start_height", "stop_height"} },
     { "wallet",             "sendmany",                         &sendmany,                      {"dummy","amounts","minconf","comment","subtractfeefrom","replaceable","conf_target","estimate_mode","changeaddress"} },
+    { "wallet",             "sendpayouts",                      &sendpayouts,                   {"amounts","outputs_per_tx","comment","replaceable","conf_target","estimate_mode"} },
     { "wallet",             "sendtoaddress",                    &sendtoaddress,                 {"address","amount","comment","comment_to","subtractfeefromamount","replaceable","conf_target","estimate_mode","changeaddress","avoid_reuse"} },
     { "wallet",             "sethdseed",                        &sethdseed,                     {"newkeypool","seed"} },
     { "wallet",             "setlabel",                         &setlabel,                      {"address","label"} },
@@ -395,4 +395,30 @@ BOOST_AUTO_TEST_CASE(ismine_standard)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ismine_accountid)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CAccountID accountID = ExtractAccountID(key.GetPubKey());
+    const CScript scriptPubKey = GetScriptForAccountID(accountID);
+    std::unique_ptr<interfaces::Chain> chain = interfaces::MakeChain();
+
+    CWallet keystore(chain.get(), WalletLocation(), WalletDatabase::CreateDummy());
+    LOCK(keystore.cs_wallet);
+
+    // Memoized results follow the keys and watch-only scripts of the wallet
+    BOOST_CHECK_EQUAL(keystore.IsMine(accountID), ISMINE_NO);
+    BOOST_CHECK_EQUAL(keystore.IsMine(accountID), ISMINE_NO);
+
+    BOOST_CHECK(keystore.AddWatchOnly(scriptPubKey, 0));
+    BOOST_CHECK_EQUAL(keystore.IsMine(accountID), ISMINE_WATCH_ONLY);
+
+    BOOST_CHECK(keystore.RemoveWatchOnly(scriptPubKey));
+    BOOST_CHECK_EQUAL(keystore.IsMine(accountID), ISMINE_NO);
+
+    BOOST_CHECK(keystore.AddKey(key));
+    BOOST_CHECK_EQUAL(keystore.IsMine(accountID), ISMINE_SPENDABLE);
+    BOOST_CHECK_EQUAL(IsMine(keystore, scriptPubKey), ISMINE_SPENDABLE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
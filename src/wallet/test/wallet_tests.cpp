@@ -262,6 +262,26 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(wtx.GetImmatureCredit(*locked_chain), 50*COIN);
 }
 
+BOOST_AUTO_TEST_CASE(cachable_amount)
+{
+    CachableAmount amount;
+    BOOST_CHECK(!amount.m_cached[ISMINE_SPENDABLE]);
+
+    amount.Set(ISMINE_SPENDABLE, 5 * COIN);
+    amount.Set(ISMINE_WATCH_ONLY | ISMINE_POINT, 2 * COIN);
+    amount.Set(ISMINE_SPENDABLE, 7 * COIN);
+    BOOST_CHECK(amount.m_cached[ISMINE_SPENDABLE]);
+    BOOST_CHECK(amount.m_cached[ISMINE_WATCH_ONLY | ISMINE_POINT]);
+    BOOST_CHECK(!amount.m_cached[ISMINE_WATCH_ONLY]);
+    BOOST_CHECK_EQUAL(amount.Get(ISMINE_SPENDABLE), 7 * COIN);
+    BOOST_CHECK_EQUAL(amount.Get(ISMINE_WATCH_ONLY | ISMINE_POINT), 2 * COIN);
+    BOOST_CHECK_EQUAL(amount.m_values.size(), 2U);
+
+    amount.Reset();
+    BOOST_CHECK(!amount.m_cached[ISMINE_SPENDABLE]);
+    BOOST_CHECK(amount.m_values.empty());
+}
+
 static int64_t AddTx(CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -460,6 +480,33 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+BOOST_FIXTURE_TEST_CASE(balance_cache, ListCoinsTestingSetup)
+{
+    // Check initial balance from one mature coinbase transaction, computed
+    // once and then remembered for the same tip.
+    BOOST_CHECK_EQUAL(wallet->GetBalance().m_mine_trusted, 50 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance().m_mine_trusted, 50 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance(1).m_mine_trusted, 50 * COIN);
+
+    // Spending the coinbase has to replace the remembered totals.
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false /* subtract fee */});
+    const CAmount trusted = wallet->GetBalance().m_mine_trusted;
+    BOOST_CHECK(trusted < 49 * COIN);
+    BOOST_CHECK(trusted > 48 * COIN);
+    BOOST_CHECK_EQUAL(wallet->GetBalance(1).m_mine_trusted, trusted);
+
+    // So has a change of the state of a transaction at the same tip.
+    {
+        LOCK(wallet->cs_wallet);
+        for (auto& entry : wallet->mapWallet) {
+            if (entry.second.IsCoinBase()) continue;
+            entry.second.setUnconfirmed();
+            entry.second.MarkDirty();
+        }
+    }
+    BOOST_CHECK_EQUAL(wallet->GetBalance(1).m_mine_trusted, 0);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     auto chain = interfaces::MakeChain();
@@ -285,7 +285,7 @@ Result CreateUnfreezeTransaction(CWallet* wallet, const COutPoint& outpoint,
     } else if (coin.IsPoint()) {
         int nSpendHeight = locked_chain->getHeight().get_value_or(0) + 1;
         if (nSpendHeight < Params().GetConsensus().nSaturnActiveHeight) {
-            int nActiveHeight = coin.nHeight + PointPayload::As(coin.payload)->GetLockBlocks();
+            int nActiveHeight = coin.nHeight + PointPayload::As(coin.GetPayload())->GetLockBlocks();
             if (nSpendHeight < nActiveHeight) {
                 errors.push_back(strprintf("Withdraw point active on %d block height (%d blocks after, about %d minute)",
                         nActiveHeight,
@@ -297,7 +297,7 @@ Result CreateUnfreezeTransaction(CWallet* wallet, const COutPoint& outpoint,
     } else if (coin.IsStaking()) {
         int nSpendHeight = locked_chain->getHeight().get_value_or(0) + 1;
         if (nSpendHeight < Params().GetConsensus().nSaturnActiveHeight || coin.nHeight > Params().GetConsensus().nSaturnActiveHeight) {
-            int nActiveHeight = coin.nHeight + StakingPayload::As(coin.payload)->GetLockBlocks();
+            int nActiveHeight = coin.nHeight + StakingPayload::As(coin.GetPayload())->GetLockBlocks();
             if (nSpendHeight < nActiveHeight) {
                 errors.push_back(strprintf("Withdraw staking active on %d block height (%d blocks after, about %d minute)",
                         nActiveHeight,
@@ -34,7 +34,10 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -507,6 +510,8 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 
 bool CWallet::AddCScriptWithDB(WalletBatch& batch, const CScript& redeemScript)
 {
+    WITH_LOCK(cs_KeyStore, ForgetAccountIsMine());
+    fSpendableCandidatesStale = true;
     if (!FillableSigningProvider::AddCScript(redeemScript))
         return false;
     if (batch.WriteCScript(Hash160(redeemScript), redeemScript)) {
@@ -528,6 +533,7 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
         return true;
     }
 
+    WITH_LOCK(cs_KeyStore, ForgetAccountIsMine());
     return FillableSigningProvider::AddCScript(redeemScript);
 }
 
@@ -541,6 +547,8 @@ static bool ExtractPubKey(const CScript &dest, CPubKey& pubKeyOut)
 bool CWallet::AddWatchOnlyInMem(const CScript &dest)
 {
     LOCK(cs_KeyStore);
+    ForgetAccountIsMine();
+    fSpendableCandidatesStale = true;
     setWatchOnly.insert(dest);
     CPubKey pubKey;
     if (ExtractPubKey(dest, pubKey)) {
@@ -587,6 +595,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     {
         LOCK(cs_KeyStore);
+        ForgetAccountIsMine();
         setWatchOnly.erase(dest);
         CPubKey pubKey;
         if (ExtractPubKey(dest, pubKey)) {
@@ -1072,8 +1081,10 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
-        for (std::pair<const uint256, CWalletTx>& item : mapWallet)
+        for (std::pair<const uint256, CWalletTx>& item : mapWallet) {
             item.second.MarkDirty();
+            setSpendableCandidates.insert(item.first);
+        }
     }
 }
 
@@ -1153,11 +1164,48 @@ bool CWallet::IsUsedDestination(const uint256& hash, unsigned int n) const
     return false;
 }
 
+static void ErasePayloadItem(std::map<std::string, CWallet::PayloadTxItems>& mapPayloadTxs, const std::string& payloadType, const std::pair<int64_t, uint256>& item)
+{
+    auto it = mapPayloadTxs.find(payloadType);
+    if (it != mapPayloadTxs.end()) {
+        it->second.erase(item);
+        if (it->second.empty())
+            mapPayloadTxs.erase(it);
+    }
+}
+
+void CWallet::UpdatePayloadIndex(const CWalletTx& wtx, const std::string& prevPayloadType)
+{
+    AssertLockHeld(cs_wallet);
+    const std::pair<int64_t, uint256> item(wtx.nTimeReceived, wtx.GetHash());
+    if (!prevPayloadType.empty())
+        ErasePayloadItem(mapPayloadTxs, prevPayloadType, item);
+    const std::string payloadType = wtx.GetMapValue("payload_t");
+    if (!payloadType.empty())
+        mapPayloadTxs[payloadType].insert(item);
+}
+
+WalletFlushDeferral::~WalletFlushDeferral()
+{
+    AssertLockHeld(m_wallet.cs_wallet);
+    if (--m_wallet.nFlushDeferrals == 0 && m_wallet.fFlushDeferred) {
+        m_wallet.fFlushDeferred = false;
+        WalletBatch(*m_wallet.database, "r+", false).Flush();
+    }
+}
+
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 {
     auto locked_chain = chain().lock();
     LOCK(cs_wallet);
 
+    // Flushing is left to the periodic flush, or to the end of the enclosing WalletFlushDeferral
+    if (fFlushOnClose && m_async_flush) {
+        fFlushOnClose = false;
+    } else if (fFlushOnClose && nFlushDeferrals > 0) {
+        fFlushDeferred = true;
+        fFlushOnClose = false;
+    }
     WalletBatch batch(*database, "r+", fFlushOnClose);
 
     uint256 hash = wtxIn.GetHash();
@@ -1179,6 +1227,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     CWalletTx& wtx = (*ret.first).second;
     wtx.BindWallet(this);
     bool fInsertedNew = ret.second;
+    const std::string prevPayloadType = fInsertedNew ? std::string() : wtx.GetMapValue("payload_t");
     if (fInsertedNew) {
         wtx.nTimeReceived = chain().getAdjustedTime();
         wtx.nOrderPos = IncOrderPosNext(&batch);
@@ -1291,6 +1340,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
             wtx.mapValue.erase("frozen");
             wtx.mapValue.erase("payload_t");
         }
+        UpdatePayloadIndex(wtx, prevPayloadType);
     }
 
     //// debug print
@@ -1303,6 +1353,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
     // Break debit/credit balance caches:
     wtx.MarkDirty();
+    setSpendableCandidates.insert(hash);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1336,11 +1387,13 @@ void CWallet::LoadToWallet(CWalletTx& wtxIn)
         }
     }
     uint256 hash = wtxIn.GetHash();
-    const auto& ins = mapWallet.emplace(hash, wtxIn);
+    const auto& ins = mapWallet.emplace(hash, std::move(wtxIn));
     CWalletTx& wtx = ins.first->second;
     wtx.BindWallet(this);
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
+        UpdatePayloadIndex(wtx, std::string());
+        setSpendableCandidates.insert(hash);
     }
     AddToSpends(hash);
     for (const CTxIn& txin : wtx.tx->vin) {
@@ -1403,6 +1456,7 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
             it->second.MarkDirty();
+            setSpendableCandidates.insert(it->first);
         }
     }
 }
@@ -1534,6 +1588,7 @@ void CWallet::TransactionAddedToMempool(const CTransactionRef& ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = true;
+        ++nBalanceGeneration;
     }
 }
 
@@ -1542,6 +1597,7 @@ void CWallet::TransactionRemovedFromMempool(const CTransactionRef &ptx) {
     auto it = mapWallet.find(ptx->GetHash());
     if (it != mapWallet.end()) {
         it->second.fInMempool = false;
+        ++nBalanceGeneration;
     }
 }
 
@@ -1592,7 +1648,17 @@ void CWallet::BlockUntilSyncedToCurrentChain() {
 
 isminetype CWallet::IsMine(const CAccountID &accountID) const
 {
-    return ::IsMine(*this, ExtractDestination(accountID));
+    // Held across the lookup so that a key or script added meanwhile can not leave a stale result behind
+    LOCK(cs_KeyStore);
+    auto it = mapAccountIsMine.find(accountID);
+    if (it != mapAccountIsMine.end())
+        return it->second;
+
+    if (mapAccountIsMine.size() >= MAX_ACCOUNT_ISMINE_CACHE_SIZE)
+        mapAccountIsMine.clear();
+    isminetype mine = ::IsMine(*this, ExtractDestination(accountID));
+    mapAccountIsMine.emplace(accountID, mine);
+    return mine;
 }
 
 isminetype CWallet::IsMine(const CTxIn &txin) const
@@ -2101,6 +2167,23 @@ int CalculateMaximumSignedInputSize(const CTxOut& txout, const CWallet* wallet,
     return GetVirtualTransactionInputSize(txn.vin[0]);
 }
 
+void CWalletTx::MarkDirty()
+{
+    m_amounts[DEBIT].Reset();
+    m_amounts[CREDIT].Reset();
+    m_amounts[IMMATURE_CREDIT].Reset();
+    m_amounts[AVAILABLE_CREDIT].Reset();
+    m_amounts[FREEZE_CREDIT].Reset();
+    m_amounts[POINT_SEND_CREDIT].Reset();
+    m_amounts[POINT_RECEIVE_CREDIT].Reset();
+    m_amounts[STAKING_SEND_CREDIT].Reset();
+    m_amounts[STAKING_RECEIVE_CREDIT].Reset();
+    fChangeCached = false;
+    if (pwallet) {
+        ++pwallet->nBalanceGeneration;
+    }
+}
+
 void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
                            std::list<COutputEntry>& listSent, CAmount& nFee, const isminefilter& filter) const
 {
@@ -2191,6 +2274,109 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+namespace {
+
+//! Blocks past the one being scanned that a rescan reads ahead
+static const int RESCAN_READ_AHEAD_BLOCKS = 32;
+//! Most threads reading blocks ahead of a rescan
+static const int MAX_RESCAN_READ_THREADS = 4;
+
+/**
+ * Reads and deserializes the blocks a rescan is about to scan on worker
+ * threads, so that block reads overlap each other and the scan itself.
+ */
+class RescanBlockReader
+{
+private:
+    interfaces::Chain& m_chain;
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    //! Requested blocks no worker has started reading yet, in request order
+    std::deque<uint256> m_pending GUARDED_BY(m_mutex);
+    //! Requested blocks not taken yet
+    std::set<uint256> m_requested GUARDED_BY(m_mutex);
+    //! Blocks read and not taken yet, null when they could not be read
+    std::map<uint256, std::shared_ptr<CBlock>> m_read GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::vector<std::thread> m_threads;
+
+    void ThreadRead()
+    {
+        while (true) {
+            uint256 hash;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || !m_pending.empty(); });
+                if (m_stop) return;
+                hash = m_pending.front();
+                m_pending.pop_front();
+            }
+            std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+            if (!m_chain.findBlock(hash, block.get()) || block->IsNull()) {
+                block.reset();
+            }
+            {
+                LOCK(m_mutex);
+                m_read[hash] = std::move(block);
+            }
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    explicit RescanBlockReader(interfaces::Chain& chain) : m_chain(chain)
+    {
+        const int threads = std::max(1, std::min(MAX_RESCAN_READ_THREADS, GetNumCores() - 1));
+        for (int i = 0; i < threads; i++) {
+            m_threads.emplace_back(&TraceThread<std::function<void()>>, "rescanread", std::function<void()>(std::bind(&RescanBlockReader::ThreadRead, this)));
+        }
+    }
+
+    ~RescanBlockReader()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    //! Start reading a block the scan will take later
+    void Request(const uint256& hash)
+    {
+        {
+            LOCK(m_mutex);
+            if (!m_requested.insert(hash).second) return;
+            m_pending.push_back(hash);
+        }
+        m_cond.notify_one();
+    }
+
+    //! Get a block, waiting for it when it was requested and reading it directly otherwise. False when it can not be read
+    bool Take(const uint256& hash, CBlock& block)
+    {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            if (m_requested.count(hash)) {
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_read.count(hash) != 0; });
+                auto it = m_read.find(hash);
+                std::shared_ptr<CBlock> read = std::move(it->second);
+                m_read.erase(it);
+                m_requested.erase(hash);
+                if (!read) return false;
+                block = std::move(*read);
+                return true;
+            }
+        }
+        return m_chain.findBlock(hash, &block) && !block.IsNull();
+    }
+};
+
+} // namespace
+
 /**
  * Scan the block chain (starting in start_block) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -2231,12 +2417,31 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     Optional<int> block_height = MakeOptional(false, int());
     double progress_begin;
     double progress_end;
+    // Blocks up to read_height are being read ahead, never past stop_block
+    RescanBlockReader reader(chain());
+    Optional<int> stop_height = MakeOptional(false, int());
+    int read_height = -1;
+    auto read_ahead = [&](interfaces::Chain::Lock& locked_chain, int tip_height) {
+        int last_height = std::min(tip_height, *block_height + RESCAN_READ_AHEAD_BLOCKS);
+        if (stop_height) last_height = std::min(last_height, *stop_height);
+        for (int height = std::max(read_height + 1, *block_height); height <= last_height; height++) {
+            reader.Request(locked_chain.getBlockHash(height));
+            read_height = height;
+        }
+    };
     {
         auto locked_chain = chain().lock();
-        if (Optional<int> tip_height = locked_chain->getHeight()) {
+        Optional<int> tip_height = locked_chain->getHeight();
+        if (tip_height) {
             tip_hash = locked_chain->getBlockHash(*tip_height);
         }
         block_height = locked_chain->getBlockHeight(block_hash);
+        if (!stop_block.IsNull()) {
+            stop_height = locked_chain->getBlockHeight(stop_block);
+        }
+        if (block_height && tip_height) {
+            read_ahead(*locked_chain, *tip_height);
+        }
         progress_begin = chain().guessVerificationProgress(block_hash);
         progress_end = chain().guessVerificationProgress(stop_block.IsNull() ? tip_hash : stop_block);
     }
@@ -2252,7 +2457,7 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
         }
 
         CBlock block;
-        if (chain().findBlock(block_hash, &block) && !block.IsNull()) {
+        if (reader.Take(block_hash, block)) {
             auto locked_chain = chain().lock();
             LOCK(cs_wallet);
             if (!locked_chain->getBlockHeight(block_hash)) {
@@ -2290,6 +2495,7 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             // increment block and verification progress
             block_hash = locked_chain->getBlockHash(++*block_height);
             progress_current = chain().guessVerificationProgress(block_hash);
+            read_ahead(*locked_chain, *tip_height);
 
             // handle updated tip hash
             const uint256 prev_tip_hash = tip_hash;
@@ -2449,7 +2655,7 @@ CAmount CWalletTx::GetCachableAmount(AmountType type, const isminefilter& filter
     if (recalculate || !amount.m_cached[filter & (ISMINE_ENUM_ELEMENTS - 1)]) {
         amount.Set(filter, type == DEBIT ? pwallet->GetDebit(*tx, filter) : pwallet->GetCredit(*tx, filter));
     }
-    return amount.m_value[filter];
+    return amount.Get(filter);
 }
 
 CAmount CWalletTx::GetDebit(const isminefilter& filter) const
@@ -2510,7 +2716,7 @@ CAmount CWalletTx::GetAvailableCredit(interfaces::Chain::Lock& locked_chain, boo
         return 0;
 
     if (fUseCache && allow_cache && m_amounts[AVAILABLE_CREDIT].m_cached[filter2]) {
-        return m_amounts[AVAILABLE_CREDIT].m_value[filter2];
+        return m_amounts[AVAILABLE_CREDIT].Get(filter2);
     }
 
     bool allow_used_addresses = (filter2 & ISMINE_USED) || !pwallet->IsWalletFlagSet(WALLET_FLAG_AVOID_REUSE);
@@ -2669,9 +2875,32 @@ CWallet::Balance CWallet::GetBalance(const int min_depth, bool avoid_reuse) cons
     {
         auto locked_chain = chain().lock();
         LOCK(cs_wallet);
-        for (const auto& entry : mapWallet)
+
+        // Depth and trust of every transaction only move with the tip, so the totals of the last call hold
+        // until either the tip or the state of one of the transactions changes
+        const Optional<int> tip_height = locked_chain->getHeight();
+        const uint256 tip = tip_height ? locked_chain->getBlockHash(*tip_height) : uint256();
+        const uint64_t generation = nBalanceGeneration;
+        const auto itCached = mapCachedBalances.find(std::make_pair(min_depth, avoid_reuse));
+        if (itCached != mapCachedBalances.end() && itCached->second.tip == tip && itCached->second.generation == generation) {
+            return itCached->second.balance;
+        }
+
+        // Only transactions with unspent outputs of the wallet add to any of the totals
+        if (fSpendableCandidatesStale.exchange(false)) {
+            for (const auto& entry : mapWallet)
+                setSpendableCandidates.insert(setSpendableCandidates.end(), entry.first);
+        }
+        for (auto itCandidate = setSpendableCandidates.begin(); itCandidate != setSpendableCandidates.end(); )
         {
-            const CWalletTx& wtx = entry.second;
+            const auto entryIt = mapWallet.find(*itCandidate);
+            if (entryIt == mapWallet.end() || !HasUnspentOutputs(*locked_chain, entryIt->second)) {
+                itCandidate = setSpendableCandidates.erase(itCandidate);
+                continue;
+            }
+            ++itCandidate;
+
+            const CWalletTx& wtx = entryIt->second;
             const bool is_trusted{wtx.IsTrusted(*locked_chain)};
             const int tx_depth{wtx.GetDepthInMainChain(*locked_chain)};
             const CAmount tx_credit_mine{wtx.GetAvailableCredit(*locked_chain, /* fUseCache */ true, ISMINE_SPENDABLE | reuse_filter)};
@@ -2697,10 +2926,24 @@ CWallet::Balance CWallet::GetBalance(const int min_depth, bool avoid_reuse) cons
             ret.m_watchonly_point_received += wtx.GetAvailableCredit(*locked_chain, /* fUseCache */ true, ISMINE_POINT | ISMINE_WATCH_ONLY);
             ret.m_watchonly_staking_received += wtx.GetAvailableCredit(*locked_chain, /* fUseCache */ true, ISMINE_STAKING | ISMINE_WATCH_ONLY);
         }
+
+        mapCachedBalances[std::make_pair(min_depth, avoid_reuse)] = CachedBalance{tip, generation, ret};
     }
     return ret;
 }
 
+bool CWallet::HasUnspentOutputs(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+
+    const uint256& wtxid = wtx.GetHash();
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        if (IsMine(wtx.tx->vout[i]) != ISMINE_NO && !IsSpent(locked_chain, wtxid, i))
+            return true;
+    }
+    return false;
+}
+
 CAmount CWallet::GetAvailableBalance(const CCoinControl* coinControl) const
 {
     auto locked_chain = chain().lock();
@@ -2729,8 +2972,21 @@ void CWallet::AvailableCoins(interfaces::Chain::Lock& locked_chain, std::vector<
     const int min_depth = {coinControl ? coinControl->m_min_depth : DEFAULT_MIN_DEPTH};
     const int max_depth = {coinControl ? coinControl->m_max_depth : DEFAULT_MAX_DEPTH};
 
-    for (const auto& entry : mapWallet)
+    if (fSpendableCandidatesStale.exchange(false)) {
+        for (const auto& entry : mapWallet)
+            setSpendableCandidates.insert(setSpendableCandidates.end(), entry.first);
+    }
+    for (auto itCandidate = setSpendableCandidates.begin(); itCandidate != setSpendableCandidates.end(); )
     {
+        const auto entryIt = mapWallet.find(*itCandidate);
+        // Forget transactions whose outputs of the wallet are all spent
+        if (entryIt == mapWallet.end() || !HasUnspentOutputs(locked_chain, entryIt->second)) {
+            itCandidate = setSpendableCandidates.erase(itCandidate);
+            continue;
+        }
+        ++itCandidate;
+
+        const auto& entry = *entryIt;
         const uint256& wtxid = entry.first;
         const CWalletTx& wtx = entry.second;
 
@@ -3063,31 +3319,28 @@ bool CWallet::SignTransaction(CMutableTransaction& tx)
     }
 
     // sign the new tx
-    int nIn = 0;
-    for (auto& input : tx.vin) {
-        SignatureData sigdata;
+    std::vector<SigningInput> inputs;
+    for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+        const CTxIn& input = tx.vin[nIn];
         std::map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(input.prevout.hash);
         if(mi == mapWallet.end() || input.prevout.n >= mi->second.tx->vout.size()) {
             const Coin &coin = chain().accessCoin(input.prevout);
-            if (!coin.IsSpent()) {
-                const CScript& scriptPubKey = coin.out.scriptPubKey;
-                const CAmount& amount = coin.out.nValue;
-                if (!ProduceSignature(*this, MutableTransactionSignatureCreator(&tx, nIn, amount, SIGHASH_ALL), scriptPubKey, sigdata)) {
-                    return false;
-                }
-            }
-        } else {
-            const CScript& scriptPubKey = mi->second.tx->vout[input.prevout.n].scriptPubKey;
-            const CAmount& amount = mi->second.tx->vout[input.prevout.n].nValue;
-            if (!ProduceSignature(*this, MutableTransactionSignatureCreator(&tx, nIn, amount, SIGHASH_ALL), scriptPubKey, sigdata)) {
+            if (coin.IsSpent())
                 return false;
-            }
+            inputs.push_back({nIn, coin.out.scriptPubKey, coin.out.nValue, SIGHASH_ALL});
+        } else {
+            const CTxOut& txout = mi->second.tx->vout[input.prevout.n];
+            inputs.push_back({nIn, txout.scriptPubKey, txout.nValue, SIGHASH_ALL});
         }
-        if (!sigdata.complete)
+    }
+    std::vector<SignatureData> sigdata(inputs.size());
+    ProduceSignatures(*this, tx, inputs, sigdata);
+    for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+        if (!sigdata[nIn].complete)
             return false;
-
-        UpdateInput(input, sigdata);
-        nIn++;
+    }
+    for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+        UpdateInput(tx.vin[nIn], sigdata[nIn]);
     }
     return true;
 }
@@ -3570,21 +3823,18 @@ bool CWallet::CreateTransaction(interfaces::Chain::Lock& locked_chain, const std
             }
 
             // sign the new tx
-            int nIn = 0;
-            for (const auto& coin : selected_coins)
-            {
-                const CScript& scriptPubKey = coin.txout.scriptPubKey;
-                SignatureData sigdata;
-
-                if (!ProduceSignature(*this, MutableTransactionSignatureCreator(&txNew, nIn, coin.txout.nValue, SIGHASH_ALL), scriptPubKey, sigdata))
-                {
+            std::vector<SigningInput> inputs;
+            for (const auto& coin : selected_coins) {
+                inputs.push_back({(unsigned int) inputs.size(), coin.txout.scriptPubKey, coin.txout.nValue, SIGHASH_ALL});
+            }
+            std::vector<SignatureData> sigdata(inputs.size());
+            ProduceSignatures(*this, txNew, inputs, sigdata);
+            for (size_t nIn = 0; nIn < sigdata.size(); nIn++) {
+                if (!sigdata[nIn].complete) {
                     strFailReason = _("Signing transaction failed").translated;
                     return false;
-                } else {
-                    UpdateInput(txNew.vin.at(nIn), sigdata);
                 }
-
-                nIn++;
+                UpdateInput(txNew.vin.at(nIn), sigdata[nIn]);
             }
         }
 
@@ -3718,6 +3968,12 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     for (uint256 hash : vHashOut) {
         const auto& it = mapWallet.find(hash);
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
+        for (const CTxIn& txin : it->second.tx->vin) {
+            if (mapWallet.count(txin.prevout.hash))
+                setSpendableCandidates.insert(txin.prevout.hash);
+        }
+        setSpendableCandidates.erase(hash);
+        ErasePayloadItem(mapPayloadTxs, it->second.GetMapValue("payload_t"), std::make_pair(it->second.nTimeReceived, hash));
         mapWallet.erase(it);
         NotifyTransactionChanged(this, hash, CT_DELETED);
     }
@@ -4761,6 +5017,8 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(interfaces::Chain& chain,
 
     walletInstance->m_confirm_target = gArgs.GetArg("-txconfirmtarget", DEFAULT_TX_CONFIRM_TARGET);
     walletInstance->m_spend_zero_conf_change = gArgs.GetBoolArg("-spendzeroconfchange", DEFAULT_SPEND_ZEROCONF_CHANGE);
+    walletInstance->m_async_flush = gArgs.GetBoolArg("-walletasyncflush", DEFAULT_WALLET_ASYNC_FLUSH);
+    walletInstance->m_notify_thread = gArgs.GetBoolArg("-walletnotifythread", DEFAULT_WALLET_NOTIFY_THREAD);
     walletInstance->m_signal_rbf = gArgs.GetBoolArg("-walletrbf", DEFAULT_WALLET_RBF);
 
     walletInstance->WalletLogPrintf("Wallet completed loading in %15dms\n", GetTimeMillis() - nStart);
@@ -4860,12 +5118,14 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(interfaces::Chain& chain,
                 {
                     const CWalletTx* copyFrom = &wtxOld;
                     CWalletTx* copyTo = &mi->second;
+                    ErasePayloadItem(walletInstance->mapPayloadTxs, copyTo->GetMapValue("payload_t"), std::make_pair(copyTo->nTimeReceived, hash));
                     copyTo->mapValue = copyFrom->mapValue;
                     copyTo->vOrderForm = copyFrom->vOrderForm;
                     copyTo->nTimeReceived = copyFrom->nTimeReceived;
                     copyTo->nTimeSmart = copyFrom->nTimeSmart;
                     copyTo->fFromMe = copyFrom->fFromMe;
                     copyTo->nOrderPos = copyFrom->nOrderPos;
+                    walletInstance->UpdatePayloadIndex(*copyTo, std::string());
                     batch.WriteTx(*copyTo);
                 }
             }
@@ -4896,7 +5156,7 @@ std::shared_ptr<CWallet> CWallet::CreateWalletFromFile(interfaces::Chain& chain,
 
 void CWallet::handleNotifications()
 {
-    m_chain_notifications_handler = m_chain->handleNotifications(*this);
+    m_chain_notifications_handler = m_chain->handleNotifications(*this, m_notify_thread);
 }
 
 void CWallet::postInitProcess()
@@ -5207,6 +5467,7 @@ bool CWallet::EncryptKeys(CKeyingMaterial& vMasterKeyIn)
 bool CWallet::AddKeyPubKeyInner(const CKey& key, const CPubKey &pubkey)
 {
     LOCK(cs_KeyStore);
+    ForgetAccountIsMine();
     if (!IsCrypted()) {
         return FillableSigningProvider::AddKeyPubKey(key, pubkey);
     }
@@ -5235,6 +5496,7 @@ bool CWallet::AddCryptedKeyInner(const CPubKey &vchPubKey, const std::vector<uns
         return false;
     }
 
+    ForgetAccountIsMine();
     mapCryptedKeys[vchPubKey.GetID()] = make_pair(vchPubKey, vchCryptedSecret);
     ImplicitlyLearnRelatedKeyScripts(vchPubKey);
     return true;
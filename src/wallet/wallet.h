@@ -31,6 +31,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -75,6 +76,10 @@ static const CAmount DEFAULT_TRANSACTION_MINFEE = 1000;
 static const CAmount WALLET_INCREMENTAL_RELAY_FEE = 5000;
 //! Default for -spendzeroconfchange
 static const bool DEFAULT_SPEND_ZEROCONF_CHANGE = true;
+//! Default for -walletasyncflush
+static const bool DEFAULT_WALLET_ASYNC_FLUSH = false;
+//! Default for -walletnotifythread
+static const bool DEFAULT_WALLET_NOTIFY_THREAD = false;
 //! Default for -walletrejectlongchains
 static const bool DEFAULT_WALLET_REJECT_LONG_CHAINS = false;
 //! Default for -avoidpartialspends
@@ -95,6 +100,9 @@ constexpr CAmount HIGH_MAX_TX_FEE{100 * HIGH_TX_FEE_PER_KB};
 //! Pre-calculated constants for input size estimation in *virtual size*
 static constexpr size_t DUMMY_NESTED_P2WPKH_INPUT_SIZE = 91;
 
+//! Most account IDs whose ownership is memoized per wallet before the memo is started over
+static const size_t MAX_ACCOUNT_ISMINE_CACHE_SIZE = 100000;
+
 class CCoinControl;
 class COutput;
 class CScript;
@@ -565,19 +573,7 @@ public:
     }
 
     //! make sure balances are recalculated
-    void MarkDirty()
-    {
-        m_amounts[DEBIT].Reset();
-        m_amounts[CREDIT].Reset();
-        m_amounts[IMMATURE_CREDIT].Reset();
-        m_amounts[AVAILABLE_CREDIT].Reset();
-        m_amounts[FREEZE_CREDIT].Reset();
-        m_amounts[POINT_SEND_CREDIT].Reset();
-        m_amounts[POINT_RECEIVE_CREDIT].Reset();
-        m_amounts[STAKING_SEND_CREDIT].Reset();
-        m_amounts[STAKING_RECEIVE_CREDIT].Reset();
-        fChangeCached = false;
-    }
+    void MarkDirty();
 
     void BindWallet(CWallet *pwalletIn)
     {
@@ -813,12 +809,24 @@ private:
     bool AddCryptedKeyInner(const CPubKey &vchPubKey, const std::vector<unsigned char> &vchCryptedSecret);
     bool AddKeyPubKeyInner(const CKey& key, const CPubKey &pubkey);
 
+    struct AccountIDHasher {
+        size_t operator()(const CAccountID& id) const noexcept { return (size_t) id.GetUint64(0); }
+    };
+    //! Memoized IsMine(const CAccountID&) results. Dropped whenever keys, scripts or watch-only scripts change
+    mutable std::unordered_map<CAccountID, isminetype, AccountIDHasher> mapAccountIsMine GUARDED_BY(cs_KeyStore);
+    void ForgetAccountIsMine() EXCLUSIVE_LOCKS_REQUIRED(cs_KeyStore) { mapAccountIsMine.clear(); ++nBalanceGeneration; }
+
     std::atomic<bool> fAbortRescan{false};
     std::atomic<bool> fScanningWallet{false}; // controlled by WalletRescanReserver
     std::atomic<int64_t> m_scanning_start{0};
     std::atomic<double> m_scanning_progress{0};
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
+    friend class WalletFlushDeferral;
+
+    //! Open WalletFlushDeferral scopes, and whether a transaction was added without flushing meanwhile
+    int nFlushDeferrals GUARDED_BY(cs_wallet) = 0;
+    bool fFlushDeferred GUARDED_BY(cs_wallet) = false;
 
     WalletBatch *encrypted_batch GUARDED_BY(cs_wallet) = nullptr;
 
@@ -1007,6 +1015,22 @@ public:
 
     std::map<uint256, CWalletTx> mapWallet GUARDED_BY(cs_wallet);
 
+    //! Transactions of mapWallet that may still hold unspent outputs of the wallet. AvailableCoins only scans
+    //! these, dropping the ones it finds spent, and any change that can free an output adds its transaction back
+    mutable std::set<uint256> setSpendableCandidates GUARDED_BY(cs_wallet);
+    //! Set when scripts or watch-only scripts are added, which can make outputs of any transaction ours
+    mutable std::atomic<bool> fSpendableCandidatesStale{false};
+    //! Bumped whenever the credit, debit or mempool state of a transaction may have changed, which
+    //! invalidates the balances GetBalance remembered for the current chain tip
+    mutable std::atomic<uint64_t> nBalanceGeneration{0};
+
+    //! Transactions of mapWallet with a "payload_t" value, by that value and ordered by the time received
+    typedef std::set<std::pair<int64_t, uint256>> PayloadTxItems;
+    std::map<std::string, PayloadTxItems> mapPayloadTxs GUARDED_BY(cs_wallet);
+
+    //! Move a transaction of mapWallet to the payload index of its current "payload_t", out of prevPayloadType
+    void UpdatePayloadIndex(const CWalletTx& wtx, const std::string& prevPayloadType) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     typedef std::multimap<int64_t, CWalletTx*> TxItems;
     TxItems wtxOrdered;
 
@@ -1156,6 +1180,7 @@ public:
 
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose=true);
+    //! Moves wtxIn into mapWallet
     void LoadToWallet(CWalletTx& wtxIn) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
     void BlockConnected(const CBlock& block, const std::vector<CTransactionRef>& vtxConflicted) override;
@@ -1199,6 +1224,17 @@ public:
         CAmount m_watchonly_staking_received{0};
     };
     Balance GetBalance(int min_depth = 0, bool avoid_reuse = true) const;
+private:
+    struct CachedBalance {
+        uint256 tip;
+        uint64_t generation;
+        Balance balance;
+    };
+    //! Results of GetBalance by (min_depth, avoid_reuse), reused while the chain tip and nBalanceGeneration stay the same
+    mutable std::map<std::pair<int, bool>, CachedBalance> mapCachedBalances GUARDED_BY(cs_wallet);
+    //! Whether a transaction of setSpendableCandidates still has an unspent output of the wallet
+    bool HasUnspentOutputs(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+public:
     CAmount GetAvailableBalance(const CCoinControl* coinControl = nullptr) const;
 
     OutputType TransactionChangeType(OutputType change_type, const std::vector<CRecipient>& vecSend);
@@ -1236,6 +1272,10 @@ public:
     CFeeRate m_pay_tx_fee{DEFAULT_PAY_TX_FEE};
     unsigned int m_confirm_target{DEFAULT_TX_CONFIRM_TARGET};
     bool m_spend_zero_conf_change{DEFAULT_SPEND_ZEROCONF_CHANGE};
+    //! Leave flushing added transactions to the periodic and shutdown flushes. Override with -walletasyncflush
+    bool m_async_flush{DEFAULT_WALLET_ASYNC_FLUSH};
+    //! Take chain notifications on a thread of this wallet's own. Override with -walletnotifythread
+    bool m_notify_thread{DEFAULT_WALLET_NOTIFY_THREAD};
     bool m_signal_rbf{DEFAULT_WALLET_RBF};
     bool m_allow_fallback_fee{true}; //!< will be defined via chainparams
     CFeeRate m_min_fee{DEFAULT_TRANSACTION_MINFEE}; //!< Override with -mintxfee
@@ -1534,6 +1574,24 @@ public:
     }
 };
 
+/**
+ * RAII object making the transactions a wallet adds while it is alive share one database flush, done when the
+ * outermost one is destroyed. cs_wallet must be held for its whole life.
+ */
+class WalletFlushDeferral
+{
+private:
+    CWallet& m_wallet;
+public:
+    explicit WalletFlushDeferral(CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet) : m_wallet(wallet)
+    {
+        AssertLockHeld(m_wallet.cs_wallet);
+        m_wallet.nFlushDeferrals++;
+    }
+
+    ~WalletFlushDeferral();
+};
+
 // Calculate the size of the transaction assuming all signatures are max size
 // Use DummySignatureCreator, which inserts 71 byte signatures everywhere.
 // NOTE: this requires that all inputs must be in mapWallet (eg the tx should
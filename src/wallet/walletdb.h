@@ -213,6 +213,9 @@ public:
     WalletBatch(const WalletBatch&) = delete;
     WalletBatch& operator=(const WalletBatch&) = delete;
 
+    //! Flush database activity from memory pool to disk log
+    void Flush() { m_batch.Flush(); }
+
     bool WriteName(const std::string& strAddress, const std::string& strName);
     bool EraseName(const std::string& strAddress);
 
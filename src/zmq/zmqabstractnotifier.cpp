@@ -20,3 +20,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyAccountChanges(const CZMQAccountChanges &/*changes*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyOmniStateChanges(const mastercore::StateChanges &/*changes*/)
+{
+    return true;
+}
@@ -7,9 +7,49 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <amount.h>
+#include <script/standard.h>
+
+#include <map>
+#include <vector>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+namespace mastercore {
+struct StateChanges;
+}
+
+/** A bind plotter or staking coin created or spent by a block */
+struct CZMQAccountCoinChange
+{
+    COutPoint outpoint;
+    //! The account the coin belongs to
+    CAccountID accountID;
+    //! Plotter ID of a bind plotter coin, receiver pool of a staking coin
+    uint64_t plotterId;
+    CAccountID receiverID;
+    CAmount nAmount;
+    //! Whether the coin now is in the UTXO set
+    bool fAdded;
+
+    CZMQAccountCoinChange() : plotterId(0), nAmount(0), fAdded(false) {}
+};
+
+/** Account state changed by connecting or disconnecting a block, derived from its coins and undo data */
+struct CZMQAccountChanges
+{
+    uint256 hashBlock;
+    int nHeight;
+    bool fConnected;
+    //! Net balance change of each account, accounts that did not change are left out
+    std::map<CAccountID, CAmount> mapBalanceDelta;
+    std::vector<CZMQAccountCoinChange> vBindPlotter;
+    std::vector<CZMQAccountCoinChange> vStaking;
+
+    CZMQAccountChanges() : nHeight(-1), fConnected(false) {}
+};
+
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
@@ -42,6 +82,8 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyAccountChanges(const CZMQAccountChanges &changes);
+    virtual bool NotifyOmniStateChanges(const mastercore::StateChanges &changes);
 
 protected:
     void *psocket;
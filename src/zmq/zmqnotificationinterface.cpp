@@ -5,16 +5,26 @@
 #include <zmq/zmqnotificationinterface.h>
 #include <zmq/zmqpublishnotifier.h>
 
+#include <chain.h>
+#include <omnicore/notifications.h>
+#include <undo.h>
 #include <version.h>
 #include <validation.h>
 #include <util/system.h>
 
+#include <set>
+
+//! Notifiers of CZMQAbstractNotifier::NotifyAccountChanges
+static const std::set<std::string> setAccountChangesNotifiers = {"pubaccountdelta", "pubbindplotter", "pubstakingpool"};
+//! Notifiers of CZMQAbstractNotifier::NotifyOmniStateChanges
+static const std::set<std::string> setOmniStateChangesNotifiers = {"pubomnitx", "pubomnitally"};
+
 void zmqError(const char *str)
 {
     LogPrint(BCLog::ZMQ, "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr), fAccountChanges(false)
 {
 }
 
@@ -47,6 +57,12 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubminingjob"] = CZMQAbstractNotifier::Create<CZMQPublishMiningJobNotifier>;
+    factories["pubaccountdelta"] = CZMQAbstractNotifier::Create<CZMQPublishAccountDeltaNotifier>;
+    factories["pubbindplotter"] = CZMQAbstractNotifier::Create<CZMQPublishBindPlotterNotifier>;
+    factories["pubstakingpool"] = CZMQAbstractNotifier::Create<CZMQPublishStakingPoolNotifier>;
+    factories["pubomnitx"] = CZMQAbstractNotifier::Create<CZMQPublishOmniTransactionNotifier>;
+    factories["pubomnitally"] = CZMQAbstractNotifier::Create<CZMQPublishOmniTallyNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -67,6 +83,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
+        for (const CZMQAbstractNotifier* notifier : notifiers) {
+            if (setAccountChangesNotifiers.count(notifier->GetType()))
+                notificationInterface->fAccountChanges = true;
+        }
 
         if (!notificationInterface->Initialize())
         {
@@ -116,6 +136,16 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    for (const CZMQAbstractNotifier* notifier : notifiers) {
+        if (setOmniStateChangesNotifiers.count(notifier->GetType())) {
+            // The changes are collected by the block processing, and published on the same queue as the blocks
+            mastercore::SetStateChangesHandler([this](const std::shared_ptr<const mastercore::StateChanges>& changes) {
+                CallFunctionInValidationInterfaceQueue([this, changes] { NotifyOmniStateChanges(*changes); });
+            });
+            break;
+        }
+    }
+
     return true;
 }
 
@@ -125,6 +155,7 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        mastercore::SetStateChangesHandler(nullptr);
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -184,6 +215,8 @@ void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBloc
         // Do a normal notify for each transaction added in the block
         TransactionAddedToMempool(ptx);
     }
+    if (fAccountChanges)
+        NotifyAccountChanges(*pblock, true);
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
@@ -192,6 +225,106 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
         // Do a normal notify for each transaction removed in block disconnection
         TransactionAddedToMempool(ptx);
     }
+    if (fAccountChanges)
+        NotifyAccountChanges(*pblock, false);
+}
+
+static void AddAccountCoinChange(CZMQAccountChanges& changes, const COutPoint& outpoint, const Coin& coin, bool fAdded)
+{
+    const CAccountID& accountID = coin.GetAccountID();
+    if (accountID.IsNull())
+        return;
+    changes.mapBalanceDelta[accountID] += fAdded ? coin.out.nValue : -coin.out.nValue;
+
+    if (coin.IsBindPlotter() || coin.IsStaking()) {
+        CZMQAccountCoinChange change;
+        change.outpoint = outpoint;
+        change.accountID = accountID;
+        change.fAdded = fAdded;
+        if (coin.IsBindPlotter()) {
+            change.plotterId = BindPlotterPayload::As(coin.GetPayload())->GetId();
+            changes.vBindPlotter.push_back(std::move(change));
+        } else {
+            change.receiverID = StakingPayload::As(coin.GetPayload())->GetReceiverID();
+            change.nAmount = StakingPayload::As(coin.GetPayload())->GetAmount();
+            changes.vStaking.push_back(std::move(change));
+        }
+    }
+}
+
+void CZMQNotificationInterface::NotifyAccountChanges(const CBlock& block, bool fConnected)
+{
+    CZMQAccountChanges changes;
+    changes.hashBlock = block.GetHash();
+    changes.fConnected = fConnected;
+
+    // The spent coins of the block, still on disk after it was disconnected
+    CBlockUndo blockUndo;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(changes.hashBlock);
+        if (!pindex || (pindex->nHeight > 0 && !UndoReadFromDisk(blockUndo, pindex))) {
+            zmqError("Can't read block undo data from disk");
+            return;
+        }
+        changes.nHeight = pindex->nHeight;
+    }
+    if (changes.nHeight > 0 && blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
+        zmqError("Block undo data does not match block");
+        return;
+    }
+
+    // Created coins are added when connecting, spent coins restored when disconnecting
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        for (size_t n = 0; n < tx.vout.size(); n++) {
+            if (tx.vout[n].scriptPubKey.IsUnspendable())
+                continue;
+            AddAccountCoinChange(changes, COutPoint(tx.GetHash(), n), Coin(tx.vout[n], changes.nHeight, tx.IsCoinBase()), fConnected);
+        }
+        if (i == 0)
+            continue;
+        const CTxUndo& txundo = blockUndo.vtxundo[i - 1];
+        for (size_t j = 0; j < tx.vin.size() && j < txundo.vprevout.size(); j++)
+            AddAccountCoinChange(changes, tx.vin[j].prevout, txundo.vprevout[j], !fConnected);
+    }
+    for (auto it = changes.mapBalanceDelta.begin(); it != changes.mapBalanceDelta.end(); ) {
+        if (it->second == 0)
+            it = changes.mapBalanceDelta.erase(it);
+        else
+            ++it;
+    }
+
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyAccountChanges(changes))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void CZMQNotificationInterface::NotifyOmniStateChanges(const mastercore::StateChanges& changes)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyOmniStateChanges(changes))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
@@ -13,6 +13,10 @@
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+namespace mastercore {
+struct StateChanges;
+}
+
 class CZMQNotificationInterface final : public CValidationInterface
 {
 public:
@@ -35,7 +39,14 @@ protected:
 private:
     CZMQNotificationInterface();
 
+    //! Publish the account changes of a block to the notifiers that want them
+    void NotifyAccountChanges(const CBlock& block, bool fConnected);
+    //! Publish the Omni state changes of a block, called on the validation interface queue
+    void NotifyOmniStateChanges(const mastercore::StateChanges& changes);
+
     void *pcontext;
+    //! Whether any notifier publishes account changes, which need the undo data of each block read
+    bool fAccountChanges;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
 
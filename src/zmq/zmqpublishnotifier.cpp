@@ -4,18 +4,30 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <core_io.h>
+#include <key_io.h>
+#include <omnicore/notifications.h>
+#include <poc/poc.h>
 #include <streams.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
 #include <util/system.h>
 #include <rpc/server.h>
 
+#include <univalue.h>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
 static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_MININGJOB = "miningjob";
+static const char *MSG_ACCOUNTDELTA = "accountdelta";
+static const char *MSG_BINDPLOTTER = "bindplotter";
+static const char *MSG_STAKINGPOOL = "stakingpool";
+static const char *MSG_OMNITX = "omnitx";
+static const char *MSG_OMNITALLY = "omnitally";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -207,3 +219,130 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishMiningJobNotifier::NotifyBlock(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish miningjob %d\n", pindex->nHeight + 1);
+    std::string data = poc::GetMiningJob(*pindex).write();
+    return SendMessage(MSG_MININGJOB, data.data(), data.size());
+}
+
+static UniValue AccountChangesToJSON(const CZMQAccountChanges &changes)
+{
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("hash", changes.hashBlock.GetHex());
+    result.pushKV("height", changes.nHeight);
+    result.pushKV("connected", changes.fConnected);
+    return result;
+}
+
+static UniValue AccountCoinChangesToJSON(const std::vector<CZMQAccountCoinChange> &coins, bool fStaking)
+{
+    UniValue result(UniValue::VARR);
+    for (const CZMQAccountCoinChange& coin : coins) {
+        UniValue item(UniValue::VOBJ);
+        item.pushKV("address", EncodeDestination(ScriptHash(coin.accountID)));
+        if (fStaking) {
+            item.pushKV("pool", EncodeDestination(ScriptHash(coin.receiverID)));
+            item.pushKV("amount", ValueFromAmount(coin.nAmount));
+        } else {
+            item.pushKV("plotterId", std::to_string(coin.plotterId));
+        }
+        item.pushKV("txid", coin.outpoint.hash.GetHex());
+        item.pushKV("vout", (int)coin.outpoint.n);
+        item.pushKV("added", coin.fAdded);
+        result.push_back(item);
+    }
+    return result;
+}
+
+bool CZMQPublishAccountDeltaNotifier::NotifyAccountChanges(const CZMQAccountChanges &changes)
+{
+    if (changes.mapBalanceDelta.empty())
+        return true;
+    LogPrint(BCLog::ZMQ, "zmq: Publish accountdelta %s (%u accounts)\n", changes.hashBlock.GetHex(), changes.mapBalanceDelta.size());
+    UniValue result = AccountChangesToJSON(changes);
+    UniValue accounts(UniValue::VARR);
+    for (const auto& pair : changes.mapBalanceDelta) {
+        UniValue item(UniValue::VOBJ);
+        item.pushKV("address", EncodeDestination(ScriptHash(pair.first)));
+        item.pushKV("delta", ValueFromAmount(pair.second));
+        accounts.push_back(item);
+    }
+    result.pushKV("accounts", accounts);
+    std::string data = result.write();
+    return SendMessage(MSG_ACCOUNTDELTA, data.data(), data.size());
+}
+
+bool CZMQPublishBindPlotterNotifier::NotifyAccountChanges(const CZMQAccountChanges &changes)
+{
+    if (changes.vBindPlotter.empty())
+        return true;
+    LogPrint(BCLog::ZMQ, "zmq: Publish bindplotter %s (%u coins)\n", changes.hashBlock.GetHex(), changes.vBindPlotter.size());
+    UniValue result = AccountChangesToJSON(changes);
+    result.pushKV("coins", AccountCoinChangesToJSON(changes.vBindPlotter, false));
+    std::string data = result.write();
+    return SendMessage(MSG_BINDPLOTTER, data.data(), data.size());
+}
+
+bool CZMQPublishStakingPoolNotifier::NotifyAccountChanges(const CZMQAccountChanges &changes)
+{
+    if (changes.vStaking.empty())
+        return true;
+    LogPrint(BCLog::ZMQ, "zmq: Publish stakingpool %s (%u coins)\n", changes.hashBlock.GetHex(), changes.vStaking.size());
+    UniValue result = AccountChangesToJSON(changes);
+    result.pushKV("coins", AccountCoinChangesToJSON(changes.vStaking, true));
+    std::string data = result.write();
+    return SendMessage(MSG_STAKINGPOOL, data.data(), data.size());
+}
+
+bool CZMQPublishOmniTransactionNotifier::NotifyOmniStateChanges(const mastercore::StateChanges &changes)
+{
+    for (const mastercore::StateChangeTx& tx : changes.transactions) {
+        LogPrint(BCLog::ZMQ, "zmq: Publish omnitx %s\n", tx.txid.GetHex());
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("txid", tx.txid.GetHex());
+        result.pushKV("sendingaddress", tx.sender);
+        if (!tx.receiver.empty())
+            result.pushKV("referenceaddress", tx.receiver);
+        result.pushKV("valid", tx.result >= 0);
+        if (tx.result < 0)
+            result.pushKV("invalidreason", tx.result);
+        result.pushKV("type_int", (uint64_t)tx.type);
+        result.pushKV("propertyid", (uint64_t)tx.propertyId);
+        result.pushKV("amount", tx.amount);
+        result.pushKV("blockhash", changes.blockHash.GetHex());
+        result.pushKV("block", changes.block);
+        result.pushKV("positioninblock", (uint64_t)tx.idx);
+        std::string data = result.write();
+        if (!SendMessage(MSG_OMNITX, data.data(), data.size()))
+            return false;
+    }
+    return true;
+}
+
+bool CZMQPublishOmniTallyNotifier::NotifyOmniStateChanges(const mastercore::StateChanges &changes)
+{
+    if (!changes.rewind && changes.tallyDeltas.empty())
+        return true;
+    LogPrint(BCLog::ZMQ, "zmq: Publish omnitally %d (%u balances%s)\n", changes.block, changes.tallyDeltas.size(), changes.rewind ? ", rewind" : "");
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("block", changes.block);
+    result.pushKV("blockhash", changes.blockHash.GetHex());
+    result.pushKV("rewind", changes.rewind);
+    UniValue balances(UniValue::VARR);
+    for (const auto& entry : changes.tallyDeltas) {
+        UniValue item(UniValue::VOBJ);
+        item.pushKV("address", entry.first.first);
+        item.pushKV("propertyid", (uint64_t)entry.first.second);
+        item.pushKV("balance", entry.second[BALANCE]);
+        item.pushKV("selloffer_reserve", entry.second[SELLOFFER_RESERVE]);
+        item.pushKV("accept_reserve", entry.second[ACCEPT_RESERVE]);
+        item.pushKV("pending", entry.second[PENDING]);
+        item.pushKV("metadex_reserve", entry.second[METADEX_RESERVE]);
+        balances.push_back(item);
+    }
+    result.pushKV("balances", balances);
+    std::string data = result.write();
+    return SendMessage(MSG_OMNITALLY, data.data(), data.size());
+}
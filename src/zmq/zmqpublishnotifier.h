@@ -52,4 +52,46 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/** Publishes the getMiningInfo reply of the next block, so that miners start scanning a round without polling */
+class CZMQPublishMiningJobNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlock(const CBlockIndex *pindex) override;
+};
+
+/** Publishes the net balance change of each account touched by a connected or disconnected block */
+class CZMQPublishAccountDeltaNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyAccountChanges(const CZMQAccountChanges &changes) override;
+};
+
+/** Publishes the bind plotter coins created and spent by a connected or disconnected block */
+class CZMQPublishBindPlotterNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyAccountChanges(const CZMQAccountChanges &changes) override;
+};
+
+/** Publishes the staking coins created and spent by a connected or disconnected block, by receiver pool */
+class CZMQPublishStakingPoolNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyAccountChanges(const CZMQAccountChanges &changes) override;
+};
+
+/** Publishes each Omni transaction processed in a block */
+class CZMQPublishOmniTransactionNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyOmniStateChanges(const mastercore::StateChanges &changes) override;
+};
+
+/** Publishes the Omni balance changes of each processed block, and rewinds of the Omni state */
+class CZMQPublishOmniTallyNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyOmniStateChanges(const mastercore::StateChanges &changes) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The Qitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the account history index and its getaccounthistory and getbalanceofheight RPCs."""
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal, assert_raises_rpc_error,
+    connect_nodes, disconnect_nodes, sync_blocks, wait_until
+    )
+
+
+class AccountHistoryIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-accounthistoryindex"], []]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def wait_for_index(self, node):
+        # The RPCs refuse to answer until the index caught up with the chain
+        def synced():
+            try:
+                node.getbalanceofheight(self.miner_address)
+                return True
+            except Exception:
+                return False
+        wait_until(synced, timeout=30)
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.miner_address = node.getnewaddress()
+        node.generatetoaddress(110, self.miner_address)
+        self.wait_for_index(node)
+
+        self.log.info("Check the mined coins of the history")
+        history = node.getaccounthistory(self.miner_address)
+        assert_equal(len(history), 110)
+        assert_equal([entry['blockheight'] for entry in history], list(range(110, 0, -1)))
+        balance = sum(entry['amount'] for entry in history)
+        assert_equal(history[0]['balance'], balance)
+        assert_equal(node.getbalanceofheight(self.miner_address), balance)
+        for entry in history:
+            assert_equal(node.getbalanceofheight(self.miner_address, entry['blockheight']), entry['balance'])
+            assert_equal(entry['blockhash'], node.getblockhash(entry['blockheight']))
+            assert 'type' not in entry
+        assert_equal(node.getbalanceofheight(self.miner_address, 0), 0)
+
+        self.log.info("Check the paging and the height range")
+        assert_equal(node.getaccounthistory(self.miner_address, {'count': 10, 'skip': 5}), history[5:15])
+        assert_equal(node.getaccounthistory(self.miner_address, {'min_height': 20, 'max_height': 29}), history[81:91])
+        assert_equal(node.getaccounthistory(self.miner_address, {'type': 'point'}), [])
+
+        self.log.info("Check a received payment")
+        receiver = node.getnewaddress()
+        txid = node.sendtoaddress(receiver, 10)
+        node.generatetoaddress(1, self.miner_address)
+        self.wait_for_index(node)
+        receiver_history = node.getaccounthistory(receiver)
+        assert_equal(len(receiver_history), 1)
+        assert_equal(receiver_history[0]['txid'], txid)
+        assert_equal(receiver_history[0]['amount'], Decimal('10'))
+        assert_equal(receiver_history[0]['balance'], Decimal('10'))
+        assert_equal(node.getbalanceofheight(receiver), Decimal('10'))
+        assert_equal(node.getbalanceofheight(receiver, 110), 0)
+
+        self.log.info("Check that disconnected blocks are removed from the history")
+        disconnect_nodes(self.nodes[0], 1)
+        node.generatetoaddress(2, self.miner_address)
+        self.nodes[1].generatetoaddress(4, self.nodes[1].getnewaddress())
+        connect_nodes(self.nodes[0], 1)
+        sync_blocks(self.nodes)
+        self.wait_for_index(node)
+        assert_equal(node.getblockcount(), 115)
+        assert_equal(node.getaccounthistory(self.miner_address, {'min_height': 112}), [])
+        assert_equal(node.getbalanceofheight(self.miner_address, 115), node.getbalanceofheight(self.miner_address, 111))
+
+        self.log.info("Check the errors")
+        assert_raises_rpc_error(-8, "Invalid address", node.getaccounthistory, "invalid")
+        assert_raises_rpc_error(-8, "Invalid type", node.getaccounthistory, self.miner_address, {'type': 'unknown'})
+        assert_raises_rpc_error(-8, "Block height out of range", node.getbalanceofheight, self.miner_address, 1000)
+        assert_raises_rpc_error(-1, "Requires -accounthistoryindex", self.nodes[1].getaccounthistory, self.miner_address)
+
+
+if __name__ == '__main__':
+    AccountHistoryIndexTest().main()
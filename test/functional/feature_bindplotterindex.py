@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The Qitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the bind plotter index and its history RPCs."""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal, assert_raises_rpc_error
+    )
+
+PASSPHRASE = "root minute ancient won check dove second spot book thump retreat add"
+
+
+class BindPlotterIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-bindplotterindex"], []]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def bind(self, address):
+        node = self.nodes[0]
+        hexdata = node.createbindplotterdata(address, PASSPHRASE)
+        txid = node.bindplotter(address, hexdata, True)
+        node.generate(1)
+        return node.decodebindplotterdata(hexdata)['plotterId'], txid
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(110)
+        address_a = node.getnewaddress()
+        address_b = node.getnewaddress()
+
+        self.log.info("Bind a plotter to an address, and then to another one")
+        plotter_id, txid_a = self.bind(address_a)
+        height_a = node.getblockcount()
+        plotter_id_b, txid_b = self.bind(address_b)
+        height_b = node.getblockcount()
+        assert_equal(plotter_id_b, plotter_id)
+
+        history = node.listbindplotterhistory(plotter_id)
+        assert_equal([event['txid'] for event in history], [txid_b, txid_a])
+        assert_equal([event['address'] for event in history], [address_b, address_a])
+        assert_equal([event['blockheight'] for event in history], [height_b, height_a])
+        for event in history:
+            assert_equal(event['plotterId'], plotter_id)
+            assert_equal(event['blockhash'], node.getblockhash(event['blockheight']))
+            if 'unbindheight' in event:
+                assert event['unbindheight'] >= height_b
+        assert_equal(node.listbindplotterhistory(plotter_id, 1), history[:1])
+
+        self.log.info("Check the binds of the addresses")
+        assert_equal(node.listbindplotterhistoryofaddress(address_a), history[1:])
+        assert_equal(node.listbindplotterhistoryofaddress(address_b, plotter_id), history[:1])
+        assert_equal(node.listbindplotterhistoryofaddress(address_b, "1"), [])
+
+        self.log.info("Check which address controlled the plotter at a height")
+        assert_equal(node.getbindplotterofheight(plotter_id, height_a - 1), None)
+        assert_equal(node.getbindplotterofheight(plotter_id, height_a)['address'], address_a)
+        assert_equal(node.getbindplotterofheight(plotter_id, height_b)['address'], address_b)
+        assert_equal(node.getbindplotterofheight(plotter_id)['address'], address_b)
+
+        self.log.info("Check the errors")
+        assert_raises_rpc_error(-3, "Invalid plotter ID", node.listbindplotterhistory, "invalid")
+        assert_raises_rpc_error(-8, "Block height out of range", node.getbindplotterofheight, plotter_id, 1000)
+        assert_raises_rpc_error(-1, "Requires -bindplotterindex", self.nodes[1].listbindplotterhistory, plotter_id)
+
+
+if __name__ == '__main__':
+    BindPlotterIndexTest().main()
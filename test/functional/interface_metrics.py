@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021-2022 The Qitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Prometheus metrics endpoint enabled with -metrics."""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+import http.client
+import urllib.parse
+
+class MetricsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.extra_args = [["-metrics"], []]
+
+    def get_metrics(self, node, status=200):
+        url = urllib.parse.urlparse(node.url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/metrics')
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        if status != 200:
+            return None
+        assert resp.getheader('Content-Type').startswith('text/plain')
+        samples = {}
+        for line in resp.read().decode('utf-8').splitlines():
+            if line.startswith('#'):
+                continue
+            name, value = line.rsplit(' ', 1)
+            samples[name] = float(value)
+        return samples
+
+    def run_test(self):
+        self.log.info("Check the endpoint is disabled by default")
+        self.get_metrics(self.nodes[1], status=404)
+
+        self.log.info("Check the metrics of the node")
+        before = self.get_metrics(self.nodes[0])
+        for name in ['qitcoin_mempool_transactions', 'qitcoin_coins_cache_hits_total', 'qitcoin_coins_cache_misses_total',
+                     'qitcoin_poc_nonces_submitted_total', 'qitcoin_mempool_accept_seconds_count',
+                     'qitcoin_http_work_queue_depth{lane="normal"}', 'qitcoin_net_messages_received_total{type="ping"}',
+                     'qitcoin_block_connect_seconds_total{stage="omni"}', 'qitcoin_validation_queue_depth{queue="scheduler"}']:
+            assert name in before, name
+        assert_equal(before['qitcoin_poc_deadline_check_seconds_bucket{le="+Inf"}'], before['qitcoin_poc_deadline_check_seconds_count'])
+
+        self.nodes[0].generate(1)
+        after = self.get_metrics(self.nodes[0])
+        assert_equal(after['qitcoin_blocks_connected_total'], before['qitcoin_blocks_connected_total'] + 1)
+        assert after['qitcoin_net_messages_received_total{type="version"}'] >= 1
+
+if __name__ == '__main__':
+    MetricsTest().main()
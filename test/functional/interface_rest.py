@@ -324,5 +324,37 @@ class RESTTest (BitcoinTestFramework):
         json_obj = self.test_rest_request("/chaininfo")
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        self.log.info("Test the /account, /bindplotters and /pledge URIs")
+
+        json_obj = self.test_rest_request("/account/{}".format(not_related_address))
+        assert_equal(json_obj['chainHeight'], self.nodes[0].getblockcount())
+        assert_equal(json_obj['chaintipHash'], bb_hash)
+        assert_equal(json_obj['balance'], self.nodes[0].getpledgeofaddress(not_related_address)['balance'])
+        assert_greater_than(json_obj['balance'], 0)
+
+        bin_response = self.test_rest_request("/account/{}".format(not_related_address), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(len(bin_response), 4 + 32 + 6 * 8)
+        assert_equal(unpack('<i', bin_response[0:4])[0], json_obj['chainHeight'])
+        assert_equal(bin_response[4:36][::-1].hex(), bb_hash)
+        assert_equal(Decimal(unpack('<q', bin_response[36:44])[0]) / 100000000, json_obj['balance'])
+
+        hex_response = self.test_rest_request("/account/{}".format(not_related_address), req_type=ReqType.HEX, ret_type=RetType.OBJ)
+        assert_equal(hex_str_to_bytes(hex_response.read().decode('utf-8').rstrip()), bin_response)
+
+        json_obj = self.test_rest_request("/bindplotters/{}".format(not_related_address))
+        assert_equal(json_obj['plotters'], [])
+        bin_response = self.test_rest_request("/bindplotters/{}".format(not_related_address), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(bin_response[36:], b'\x00')
+
+        for kind in ['loan', 'debit']:
+            json_obj = self.test_rest_request("/pledge/{}/{}".format(kind, not_related_address))
+            assert_equal(json_obj['coins'], [])
+            assert 'next' not in json_obj
+            bin_response = self.test_rest_request("/pledge/{}/{}".format(kind, not_related_address), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+            assert_equal(bin_response[36:], b'\x00' + b'\x00' * 32 + b'\xff' * 4)
+
+        self.test_rest_request("/account/invalid", status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/pledge/loan/{}/{}".format(not_related_address, "0" * 64), status=400, ret_type=RetType.OBJ)
+
 if __name__ == '__main__':
     RESTTest().main()
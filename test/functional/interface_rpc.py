@@ -20,8 +20,9 @@ def expect_http_status(expected_http_status, expected_rpc_code,
 
 class RPCInterfaceTest(BitcoinTestFramework):
     def set_test_params(self):
-        self.num_nodes = 1
+        self.num_nodes = 2
         self.setup_clean_chain = True
+        self.extra_args = [[], ["-rpcbatchthreads=4", "-rpccachesize=1"]]
 
     def test_getrpcinfo(self):
         self.log.info("Testing getrpcinfo...")
@@ -34,6 +35,12 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_greater_than_or_equal(command['duration'], 0)
         assert_equal(info['logpath'], os.path.join(self.nodes[0].datadir, 'regtest', 'debug.log'))
 
+        normal = info['work_queues']['normal']
+        assert_greater_than_or_equal(normal['requests'], 1)
+        assert_equal(normal['rejected'], 0)
+        assert_greater_than_or_equal(normal['max_wait'], normal['avg_wait'])
+        assert_equal(info['work_queues']['priority']['requests'], 0)
+
     def test_batch_request(self):
         self.log.info("Testing basic JSON-RPC batch request...")
 
@@ -60,6 +67,46 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_equal(result_by_id[3]['error'], None)
         assert result_by_id[3]['result'] is not None
 
+    def test_parallel_batch_request(self):
+        self.log.info("Testing JSON-RPC batch request run in parallel...")
+
+        requests = [{"method": "getblockhash", "params": [0], "id": i} for i in range(100)]
+        requests.append({"method": "invalidmethod", "id": 100})
+        results = self.nodes[1].batch(requests)
+
+        # Replies keep the request order
+        assert_equal([res["id"] for res in results], list(range(101)))
+        genesis = self.nodes[1].getblockhash(0)
+        for res in results[:100]:
+            assert_equal(res['error'], None)
+            assert_equal(res['result'], genesis)
+        assert_equal(results[100]['error']['code'], -32601)
+
+    def test_response_cache(self):
+        self.log.info("Testing the RPC response cache...")
+
+        node = self.nodes[1]
+        assert_equal(self.nodes[0].getrpcinfo()['response_cache']['max_usage'], 0)
+        node.generate(10)
+        blockhash = node.getblockhash(1)
+        block = node.getblock(blockhash)
+        cache = node.getrpcinfo()['response_cache']
+        assert_equal(cache['max_usage'], 1 << 20)
+        assert_greater_than_or_equal(cache['entries'], 1)
+        assert_equal(node.getblock(blockhash), block)
+        assert_equal(node.getrpcinfo()['response_cache']['hits'], cache['hits'] + 1)
+
+        # Confirmations follow the tip
+        node.generate(1)
+        block['confirmations'] += 1
+        assert_equal(node.getblock(blockhash), block)
+
+        # Responses about disconnected successors are dropped
+        node.invalidateblock(node.getblockhash(2))
+        assert 'nextblockhash' not in node.getblock(blockhash)
+        node.reconsiderblock(block['nextblockhash'])
+        assert_equal(node.getblock(blockhash), block)
+
     def test_http_status_codes(self):
         self.log.info("Testing HTTP status codes for JSON-RPC requests...")
 
@@ -69,6 +116,8 @@ class RPCInterfaceTest(BitcoinTestFramework):
     def run_test(self):
         self.test_getrpcinfo()
         self.test_batch_request()
+        self.test_parallel_batch_request()
+        self.test_response_cache()
         self.test_http_status_codes()
 
 
@@ -3,6 +3,7 @@
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the ZMQ notification interface."""
+import json
 import struct
 
 from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
@@ -48,6 +49,7 @@ class ZMQTest (BitcoinTestFramework):
         try:
             self.test_basic()
             self.test_reorg()
+            self.test_account_delta()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -156,5 +158,35 @@ class ZMQTest (BitcoinTestFramework):
         # Should receive nodes[1] tip
         assert_equal(self.nodes[1].getbestblockhash(), hashblock.receive().hex())
 
+    def test_account_delta(self):
+        import zmq
+        address = 'tcp://127.0.0.1:28334'
+        socket = self.ctx.socket(zmq.SUB)
+        socket.set(zmq.RCVTIMEO, 60000)
+        accountdelta = ZMQSubscriber(socket, b'accountdelta')
+
+        self.restart_node(0, ['-zmqpub%s=%s' % (accountdelta.topic.decode(), address)])
+        socket.connect(address)
+        # Relax so that the subscriber is ready before publishing zmq messages
+        sleep(0.2)
+
+        # The coinbase reward is credited when connecting the block and debited when disconnecting it
+        miner_address = self.nodes[0].getnewaddress()
+        blockhash = self.nodes[0].generatetoaddress(1, miner_address)[0]
+        connected = json.loads(accountdelta.receive().decode())
+        assert_equal(connected['hash'], blockhash)
+        assert_equal(connected['height'], self.nodes[0].getblockcount())
+        assert_equal(connected['connected'], True)
+        deltas = {account['address']: account['delta'] for account in connected['accounts']}
+        assert miner_address in deltas
+        assert deltas[miner_address] > 0
+
+        self.nodes[0].invalidateblock(blockhash)
+        disconnected = json.loads(accountdelta.receive().decode())
+        assert_equal(disconnected['hash'], blockhash)
+        assert_equal(disconnected['connected'], False)
+        assert_equal({account['address']: -account['delta'] for account in disconnected['accounts']}, deltas)
+        self.nodes[0].reconsiderblock(blockhash)
+
 if __name__ == '__main__':
     ZMQTest().main()
@@ -61,6 +61,7 @@ class BlockchainTest(BitcoinTestFramework):
         self._test_getdifficulty()
         self._test_getnetworkhashps()
         self._test_stopatheight()
+        self._test_getblockconnecttimings()
         self._test_waitforblockheight()
         assert self.nodes[0].verifychain(4, 0)
 
@@ -294,6 +295,21 @@ class BlockchainTest(BitcoinTestFramework):
         self.start_node(0)
         assert_equal(self.nodes[0].getblockcount(), 207)
 
+    def _test_getblockconnecttimings(self):
+        self.log.info("Test getblockconnecttimings")
+        node = self.nodes[0]
+        keys = ['blocks', 'callbacks', 'chainstate', 'check', 'connect', 'connect_total', 'flush', 'forks', 'index',
+                'omni', 'poc', 'pos', 'post_connect', 'read_from_disk', 'reward', 'total', 'verify']
+        res = node.getblockconnecttimings()
+        assert_equal(sorted(res.keys()), keys)
+        assert_equal(res['blocks'], 0)
+
+        node.generatetoaddress(1, node.get_deterministic_priv_key().address)
+        res = node.getblockconnecttimings()
+        assert_equal(res['blocks'], 1)
+        assert_greater_than(res['total'], 0)
+        assert_greater_than_or_equal(res['total'], res['connect_total'])
+
     def _test_waitforblockheight(self):
         self.log.info("Test waitforblockheight")
         node = self.nodes[0]
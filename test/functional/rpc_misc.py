@@ -53,6 +53,33 @@ class RpcMiscTest(BitcoinTestFramework):
         node.logging(include=['qt'])
         assert_equal(node.logging()['qt'], True)
 
+        self.log.info("test getminingroundstats")
+        node.generate(1)
+        tip = node.getbestblockhash()
+        round = node.getminingroundstats()[-1]
+        assert_equal(round['prevblockhash'], tip)
+        assert_equal(round['height'], node.getblockcount() + 1)
+        assert_equal(round['result'], 'pending')
+        assert_equal(round['nonces_submitted'], 0)
+        assert_equal(round['best_deadlines'], [])
+        node.generate(1)
+        rounds = node.getminingroundstats(2)
+        assert_equal(len(rounds), 2)
+        assert_equal(rounds[0]['prevblockhash'], tip)
+        assert_equal(rounds[0]['result'], 'lost')
+        assert_equal(rounds[0]['winner'], node.getbestblockhash())
+        assert_equal(rounds[1]['result'], 'pending')
+        assert_raises_rpc_error(-8, "Negative count", node.getminingroundstats, -1)
+
+        self.log.info("test getvalidationinterfacestats")
+        node.syncwithvalidationinterfacequeue()
+        stats = node.getvalidationinterfacestats()
+        assert_greater_than(stats['queue_wait']['calls'], 0)
+        assert_greater_than_or_equal(stats['queue_wait']['total_us'], stats['queue_wait']['max_us'])
+        listeners = {listener['name']: listener for listener in stats['listeners']}
+        assert_greater_than_or_equal(listeners['PeerLogicValidation']['callbacks']['block_connected']['calls'], 2)
+        assert_equal(listeners['PeerLogicValidation']['own_thread'], False)
+
 
 if __name__ == '__main__':
     RpcMiscTest().main()
@@ -107,6 +107,8 @@ BASE_SCRIPTS = [
     'feature_bip68_sequence.py',
     'p2p_feefilter.py',
     'feature_reindex.py',
+    'feature_accounthistoryindex.py',
+    'feature_bindplotterindex.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
     'wallet_keypool_topup.py',
@@ -121,6 +123,7 @@ BASE_SCRIPTS = [
     'rpc_getchaintips.py',
     'rpc_misc.py',
     'interface_rest.py',
+    'interface_metrics.py',
     'mempool_spend_coinbase.py',
     'wallet_avoidreuse.py',
     'mempool_reorg.py',
@@ -217,6 +217,21 @@ class WalletTest(BitcoinTestFramework):
         assert_equal(self.nodes[2].getbalance(), node_2_bal)
         node_0_bal = self.check_fee_amount(self.nodes[0].getbalance(), node_0_bal + Decimal('10'), fee_per_byte, self.get_vsize(self.nodes[2].gettransaction(txid)['hex']))
 
+        # Sendpayouts 3 BTC to three addresses, two recipients per transaction
+        payouts = {self.nodes[0].getnewaddress(): 1 for _ in range(3)}
+        assert_raises_rpc_error(-8, "Invalid outputs_per_tx", self.nodes[2].sendpayouts, payouts, 0)
+        assert_raises_rpc_error(-6, "Insufficient funds", self.nodes[2].sendpayouts, {address: 1, self.nodes[0].getnewaddress(): 1000}, 1)
+        txids = self.nodes[2].sendpayouts(payouts, 2)
+        assert_equal(len(txids), 2)
+        # Transactions of the same batch never spend the same coin
+        vins = [(txin['txid'], txin['vout']) for txid in txids for txin in self.nodes[2].decoderawtransaction(self.nodes[2].gettransaction(txid)['hex'])['vin']]
+        assert_equal(len(vins), len(set(vins)))
+        self.nodes[2].generate(1)
+        self.sync_all(self.nodes[0:3])
+        node_0_bal += Decimal('3')
+        assert_equal(self.nodes[0].getbalance(), node_0_bal)
+        node_2_bal = self.nodes[2].getbalance()
+
         self.start_node(3)
         connect_nodes(self.nodes[0], 3)
         self.sync_all()